@@ -0,0 +1,241 @@
+const assert = require('assert');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const beamHelper = require('./build/Release/cBeamHelper');
+
+// Reference encoder with the layout of generateBeamBuffer in beam-file-helper.ts.
+const vint = (value) => {
+  const bytes = [];
+  while (value > 127) {
+    bytes.push((value % 128) + 128);
+    value = Math.floor(value / 128);
+  }
+  bytes.push(value);
+  return Buffer.from(bytes);
+};
+const block = (type, payload) => Buffer.concat([Buffer.from([type]), vint(payload.length), payload]);
+const referenceBeam = ({ metadata, svg, images, thumbnail, misc }) => {
+  const svgBlock = block(1, Buffer.from(svg));
+  const imageBlock = block(
+    2,
+    Buffer.concat(
+      Object.keys(images).flatMap((id) => {
+        const image = Buffer.from(images[id]);
+        return [Buffer.from([Buffer.from(id).length]), Buffer.from(id), vint(image.length), image];
+      }),
+    ),
+  );
+  const thumbnailBlock = thumbnail ? block(3, Buffer.from(thumbnail)) : Buffer.alloc(0);
+  const miscBlock = block(4, Buffer.from(misc));
+  const metadataBuf = Buffer.from(metadata);
+  const header = Buffer.concat([
+    vint(metadataBuf.length),
+    metadataBuf,
+    vint(svgBlock.length),
+    vint(imageBlock.length),
+    vint(thumbnailBlock.length),
+    vint(miscBlock.length),
+  ]);
+  return Buffer.concat([
+    Buffer.from([66, 101, 97, 109, 2]),
+    vint(header.length),
+    header,
+    svgBlock,
+    imageBlock,
+    thumbnailBlock,
+    miscBlock,
+    Buffer.from([0]),
+  ]);
+};
+
+const bytes = (length, seed) => Uint8Array.from({ length }, (_, i) => (i * 31 + seed) & 255).buffer;
+const document = {
+  metadata: JSON.stringify({ contents: [1, 2, 3, 4], version: '2.5.0' }),
+  svg: `<svg data-workarea="ado1">${'<rect/>'.repeat(40)}é\ud800</svg>`,
+  images: { svg_3: bytes(300, 1), 12: new Uint8Array(bytes(20000, 2), 100, 5000), 'svg_圖': bytes(0, 3) },
+  thumbnail: bytes(130, 4),
+  misc: '{}',
+};
+
+(async () => {
+  const expected = referenceBeam(document);
+  assert.deepStrictEqual(Buffer.from(beamHelper.encodeBeam(document)), expected);
+  assert.deepStrictEqual(
+    Buffer.from(beamHelper.encodeBeam({ ...document, thumbnail: undefined })),
+    referenceBeam({ ...document, thumbnail: undefined }),
+  );
+
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'beam-test-'));
+  const file = path.join(dir, 'project.beam');
+  assert.strictEqual(await beamHelper.writeBeam(file, document), expected.length);
+  assert.deepStrictEqual(fs.readFileSync(file), expected);
+
+  // More images than one writev batch takes.
+  const many = { ...document, images: {} };
+  for (let i = 0; i < 3000; i += 1) many.images[`svg_${i}`] = bytes(i % 200, i);
+  await beamHelper.writeBeam(file, many);
+  assert.deepStrictEqual(fs.readFileSync(file), referenceBeam(many));
+  assert.deepStrictEqual(fs.readdirSync(dir), ['project.beam']);
+
+  await assert.rejects(beamHelper.writeBeam(path.join(dir, 'missing', 'a.beam'), document), /cannot open/);
+  assert.throws(() => beamHelper.encodeBeam({ ...document, images: { ['x'.repeat(256)]: bytes(1, 0) } }), RangeError);
+  assert.throws(() => beamHelper.encodeBeam({ ...document, svg: undefined }), TypeError);
+
+  // openBeam / readBeamInfo
+  await beamHelper.writeBeam(file, document);
+  const beamFile = beamHelper.openBeam(file);
+  assert.strictEqual(beamFile.version, 2);
+  assert.strictEqual(beamFile.metadata, document.metadata);
+  assert.deepStrictEqual(beamFile.imageIds, ['12', 'svg_3', 'svg_圖']);
+  assert.strictEqual(beamFile.svg(), Buffer.from(document.svg).toString());
+  assert.strictEqual(beamFile.misc(), '{}');
+  assert.deepStrictEqual(Buffer.from(beamFile.image('12')), Buffer.from(document.images[12]));
+  assert.strictEqual(beamFile.image('svg_圖').length, 0);
+  assert.strictEqual(beamFile.image('missing'), undefined);
+  assert.deepStrictEqual(Buffer.from(beamFile.thumbnail()), Buffer.from(document.thumbnail));
+  beamFile.close();
+  assert.throws(() => beamFile.svg(), /closed/);
+
+  assert.deepStrictEqual(beamHelper.readBeamInfo(file), {
+    version: 2,
+    thumbnail: new Uint8Array(document.thumbnail),
+    workarea: 'ado1',
+  });
+  await beamHelper.writeBeam(file, { ...document, svg: '<svg/>', thumbnail: null });
+  assert.deepStrictEqual(beamHelper.readBeamInfo(file), { version: 2, thumbnail: null, workarea: null });
+
+  // The info lookup skips over the image entries without parsing them.
+  const corrupt = referenceBeam({ ...document, images: { Q: bytes(10, 0) } });
+  corrupt[corrupt.indexOf('Q') - 1] = 200;
+  fs.writeFileSync(file, corrupt);
+  assert.throws(() => beamHelper.openBeam(file), /invalid beam image block/);
+  assert.strictEqual(beamHelper.readBeamInfo(file).thumbnail.length, 130);
+  fs.writeFileSync(file, expected.subarray(0, 100));
+  assert.throws(() => beamHelper.openBeam(file), /truncated/);
+  fs.writeFileSync(file, 'not a beam');
+  assert.throws(() => beamHelper.readBeamInfo(file), /not a beam file/);
+  assert.throws(() => beamHelper.openBeam(path.join(dir, 'missing.beam')), /cannot open/);
+
+  // Version 3: distinct images stored once, LZ4 text blocks, same content back.
+  const photo = bytes(50000, 9);
+  const copies = { ...document, images: { a: photo, b: photo.slice(0), c: new Uint8Array(photo), d: bytes(10, 1) } };
+  const v2Size = beamHelper.encodeBeam(copies).length;
+  const v3 = beamHelper.encodeBeam(copies, { version: 3 });
+  assert.ok(v2Size > 150000 && v3.length > 50000 && v3.length < 51000);
+  const compressed = beamHelper.encodeBeam(copies, { version: 3, compress: true });
+  assert.ok(compressed.length < v3.length);
+  // XXH64('abc') is stored little-endian in the image table.
+  const abc = Buffer.from(beamHelper.encodeBeam({ ...document, images: { x: Buffer.from('abc') } }, { version: 3 }));
+  assert.ok(abc.includes(Buffer.from('44bc2cf5ad770999', 'hex').reverse()));
+
+  await beamHelper.writeBeam(file, copies, { version: 3, compress: true });
+  assert.deepStrictEqual(fs.readFileSync(file), Buffer.from(compressed));
+  const v3File = beamHelper.openBeam(file);
+  assert.strictEqual(v3File.version, 3);
+  assert.deepStrictEqual(v3File.imageIds, ['a', 'b', 'c', 'd']);
+  assert.deepStrictEqual(Buffer.from(v3File.image('c')), Buffer.from(photo));
+  assert.deepStrictEqual(Buffer.from(v3File.image('d')), Buffer.from(copies.images.d));
+  assert.strictEqual(v3File.svg(), Buffer.from(document.svg).toString());
+  assert.strictEqual(v3File.misc(), '{}');
+  v3File.close();
+  assert.deepStrictEqual(beamHelper.readBeamInfo(file), {
+    version: 3,
+    thumbnail: new Uint8Array(document.thumbnail),
+    workarea: 'ado1',
+  });
+
+  // An LZ4 block from the reference implementation (lz4 -9) decodes.
+  const svg = `<svg>${'<rect x="1"/>'.repeat(30)}</svg>`;
+  const reference = Buffer.from('ff023c7376673e3c7265637420783d2231222f0d00ff69502f7376673e', 'hex');
+  const index = [vint(1), Buffer.from([1, 1]), vint(0), vint(29), vint(401)];
+  const header = Buffer.concat([vint(2), Buffer.from('{}'), ...index]);
+  const prefix = Buffer.concat([Buffer.from('Beam\x03'), vint(header.length), header]);
+  fs.writeFileSync(file, Buffer.concat([prefix, reference]));
+  assert.strictEqual(beamHelper.openBeam(file).svg(), svg);
+  fs.writeFileSync(file, Buffer.concat([prefix, reference.subarray(0, 20)]));
+  assert.throws(() => beamHelper.openBeam(file), /truncated/);
+  fs.writeFileSync(file, Buffer.from('Beam\x04\x00'));
+  assert.throws(() => beamHelper.openBeam(file), /unsupported beam version/);
+
+  // Autosave journal: saves append only what changed and replay to the last complete one.
+  const autosave = path.join(dir, 'autosave');
+  const journalPath = `${autosave}.journal`;
+  const big = new Uint8Array(100000).fill(7);
+  let saved = { metadata: '{"v":1}', svg: `<svg>${'<g/>'.repeat(1000)}</svg>`, images: { a: big }, misc: '{}' };
+  assert.strictEqual(await beamHelper.replayJournal(autosave).catch(() => 'missing'), 'missing');
+  let journal = beamHelper.createJournal(autosave, { compactBytes: 250000 });
+  assert.strictEqual(await beamHelper.replayJournal(autosave), null);
+  assert.strictEqual((await journal.append(saved)).compacted, false);
+  const edited = { ...saved, svg: saved.svg.replace('<g/>', '<g id="x"/>'), images: { a: big, b: big } };
+  const small = await journal.append(edited);
+  assert.ok(small.bytes < 100, `incremental save wrote ${small.bytes} bytes`);
+  let replayed = await beamHelper.replayJournal(autosave);
+  assert.strictEqual(replayed.svg, edited.svg);
+  assert.strictEqual(replayed.metadata, edited.metadata);
+  assert.deepStrictEqual(Object.keys(replayed.images), ['a', 'b']);
+  assert.deepStrictEqual(Buffer.from(replayed.images.b), Buffer.from(big));
+  assert.strictEqual(replayed.thumbnail, undefined);
+
+  // A torn write leaves the previous save.
+  fs.appendFileSync(journalPath, fs.readFileSync(journalPath).subarray(-30, -5));
+  assert.strictEqual((await beamHelper.replayJournal(autosave)).svg, edited.svg);
+  const flipped = fs.readFileSync(journalPath);
+  flipped[flipped.length - 40] ^= 1;
+  fs.writeFileSync(journalPath, flipped);
+  assert.strictEqual((await beamHelper.replayJournal(autosave)).svg, saved.svg);
+
+  // New images grow the journal past compactBytes and fold it into a base file.
+  journal = beamHelper.createJournal(autosave, { compactBytes: 250000 });
+  const saves = [];
+  for (let i = 0; i < 4; i += 1) {
+    saved = { ...saved, images: { ...saved.images, [`n${i}`]: new Uint8Array(100000).fill(i) }, thumbnail: big };
+    saves.push(journal.append(saved));
+  }
+  const results = await Promise.all(saves);
+  assert.deepStrictEqual(
+    results.map((result) => result.compacted),
+    [false, true, false, false],
+  );
+  assert.ok(fs.existsSync(`${autosave}.1.beam`));
+
+  // Queued saves wait outside the thread pool, so other pool work is not stuck behind them.
+  let settled = 0;
+  const queued = [];
+  for (let i = 0; i < 12; i += 1) {
+    saved = { ...saved, svg: saved.svg.replace('<g/>', `<g id="q${i}"/>`) };
+    queued.push(journal.append(saved).then(() => (settled += 1)));
+  }
+  await fs.promises.readFile(journalPath);
+  assert.ok(settled < 12, `file read waited for ${settled} saves`);
+  await Promise.all(queued);
+  replayed = await beamHelper.replayJournal(autosave);
+  assert.strictEqual(replayed.svg, saved.svg);
+  assert.deepStrictEqual(Object.keys(replayed.images), ['a', 'n0', 'n1', 'n2', 'n3']);
+  assert.deepStrictEqual(Buffer.from(replayed.images.n3), Buffer.from(saved.images.n3));
+  assert.deepStrictEqual(Buffer.from(replayed.thumbnail), Buffer.from(big));
+  await journal.compact(saved);
+  assert.ok(!fs.existsSync(`${autosave}.1.beam`) && fs.existsSync(`${autosave}.2.beam`));
+  assert.strictEqual((await beamHelper.replayJournal(autosave)).svg, saved.svg);
+  // Buffers saved before are not hashed again; a new buffer under an old id is stored.
+  saved = { ...saved, images: { ...saved.images, a: new Uint8Array(100000).fill(9) } };
+  assert.ok((await journal.append(saved)).bytes > 100000);
+  assert.ok((await journal.append({ ...saved })).bytes < 100);
+  assert.deepStrictEqual(Buffer.from((await beamHelper.replayJournal(autosave)).images.a), Buffer.from(saved.images.a));
+  // Methods borrowed onto the other kind of object, or any other object, throw instead of misreading it.
+  const opened = beamHelper.openBeam(`${autosave}.2.beam`);
+  assert.throws(() => journal.append.call(opened, saved), /called on a journal/);
+  assert.throws(() => opened.svg.call(journal), /called on a beam file/);
+  assert.throws(() => opened.svg.call({}), TypeError);
+  opened.close.call(journal);
+  journal.close.call(opened);
+  assert.strictEqual(opened.svg(), saved.svg);
+  opened.close();
+  journal.close();
+  assert.throws(() => journal.append(saved), /journal is closed/);
+  beamHelper.createJournal(autosave);
+  assert.ok(!fs.existsSync(`${autosave}.2.beam`));
+  fs.rmSync(dir, { recursive: true });
+
+  console.log('beam tests passed');
+})();
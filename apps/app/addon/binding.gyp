@@ -1,8 +1,151 @@
 {
+  "target_defaults": {
+    "cflags_cc": [ "-O3", "-std=c++17" ],
+    "xcode_settings": {
+      "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+      "GCC_OPTIMIZATION_LEVEL": "3",
+      "MACOSX_DEPLOYMENT_TARGET": "11.0"
+    },
+    "msvs_settings": {
+      "VCCLCompilerTool": { "AdditionalOptions": [ "/std:c++17", "/O2" ] }
+    }
+  },
   "targets": [
     {
       "target_name": "cSTLHelper",
       "sources": [ "cSTLHelper.cc" ]
+    },
+    {
+      "target_name": "cGeometryHelper",
+      "sources": [
+        "cGeometryHelper.cc",
+        "src/bezier-fit.cc",
+        "src/flatten.cc",
+        "src/path-hull.cc",
+        "src/polygon.cc",
+        "src/simplify.cc",
+        "src/svg-path.cc"
+      ]
+    },
+    {
+      "target_name": "cNestHelper",
+      "sources": [
+        "cNestHelper.cc",
+        "src/nest.cc",
+        "src/polygon.cc",
+        "src/simplify.cc"
+      ]
+    },
+    {
+      "target_name": "cSurfaceHelper",
+      "sources": [
+        "cSurfaceHelper.cc",
+        "src/delaunay.cc",
+        "src/height-field.cc",
+        "src/surface-mesh.cc"
+      ]
+    },
+    {
+      "target_name": "cBeamHelper",
+      "sources": [
+        "cBeamHelper.cc",
+        "src/beam-reader.cc",
+        "src/beam-writer.cc",
+        "src/file-io.cc",
+        "src/journal.cc",
+        "src/lz4.cc",
+        "src/xxhash.cc"
+      ]
+    },
+    {
+      "target_name": "cTaskHelper",
+      "sources": [
+        "cTaskHelper.cc",
+        "src/crc32.cc",
+        "src/fcode-reader.cc",
+        "src/fcode-writer.cc",
+        "src/file-io.cc"
+      ]
+    },
+    {
+      "target_name": "cTransferHelper",
+      "sources": [
+        "cTransferHelper.cc",
+        "src/crc32.cc",
+        "src/file-io.cc",
+        "src/sha1.cc",
+        "src/sha256.cc",
+        "src/socket.cc",
+        "src/ws-client.cc",
+        "src/ws-upload.cc"
+      ],
+      "conditions": [
+        [ "OS=='win'", { "libraries": [ "ws2_32.lib" ] } ]
+      ]
+    },
+    {
+      "target_name": "cImageHelper",
+      "sources": [
+        "cImageHelper.cc",
+        "src/jpeg-codec.cc",
+        "src/jpeg-transform.cc"
+      ]
+    },
+    {
+      "target_name": "cDxfHelper",
+      "sources": [
+        "cDxfHelper.cc",
+        "src/dxf-reader.cc",
+        "src/file-io.cc",
+        "src/flatten.cc"
+      ]
+    },
+    {
+      "target_name": "cFontHelper",
+      "sources": [
+        "cFontHelper.cc",
+        "src/cff-outline.cc",
+        "src/code128.cc",
+        "src/file-io.cc",
+        "src/font-index.cc",
+        "src/font-layout.cc",
+        "src/font.cc",
+        "src/qr-code.cc",
+        "src/variable-job.cc",
+        "src/variable-text.cc",
+        "src/xxhash.cc"
+      ]
+    },
+    {
+      "target_name": "cCanvasHelper",
+      "sources": [
+        "cCanvasHelper.cc",
+        "src/aabb-tree.cc",
+        "src/element-index.cc",
+        "src/snap-index.cc"
+      ]
+    },
+    {
+      "target_name": "cRasterHelper",
+      "sources": [
+        "cRasterHelper.cc",
+        "src/flatten.cc",
+        "src/rasterizer.cc",
+        "src/raster-scene.cc"
+      ]
+    },
+    {
+      "target_name": "cNetworkHelper",
+      "sources": [
+        "cNetworkHelper.cc",
+        "src/discovery.cc",
+        "src/mdns.cc",
+        "src/prober.cc",
+        "src/socket.cc"
+      ],
+      "conditions": [
+        [ "OS=='win'", { "libraries": [ "ws2_32.lib" ] } ]
+      ]
     }
   ]
 }
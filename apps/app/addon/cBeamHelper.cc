@@ -0,0 +1,737 @@
+// Native .beam project files: serializes documents straight from the JS-owned image buffers without concatenation,
+// and reads them through a memory map so only the parts that are used get loaded.
+#include <node.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/async-task.h"
+#include "src/beam-format.h"
+#include "src/beam-reader.h"
+#include "src/beam-writer.h"
+#include "src/file-io.h"
+#include "src/journal.h"
+#include "src/node-utils.h"
+#include "src/xxhash.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::BackingStore;
+using v8::FunctionCallbackInfo;
+using v8::Global;
+using v8::Number;
+using v8::ObjectTemplate;
+using v8::Uint8Array;
+using v8::WeakCallbackInfo;
+
+namespace {
+
+// createJournal compacts once the journal would grow past this many bytes.
+constexpr double kDefaultCompactBytes = 32 * 1024 * 1024;
+
+// readBeamFileInfo looks for the workarea in this many bytes at the start of the file.
+constexpr size_t kWorkareaScanSize = 1000;
+
+// A document plus the backing stores its spans point into.
+struct DocumentInput {
+  BeamDocument document;
+  std::vector<std::shared_ptr<BackingStore>> stores;
+};
+
+bool ReadSpan(DocumentInput& input, Local<Value> value, ByteSpan* span) {
+  std::shared_ptr<BackingStore> store;
+  size_t offset;
+  size_t length;
+
+  if (!ReadBytes(value, &store, &offset, &length)) return false;
+  span->data = static_cast<const uint8_t*>(store->Data()) + offset;
+  span->size = length;
+  input.stores.push_back(std::move(store));
+
+  return true;
+}
+
+bool ReadString(Isolate* isolate, Local<Object> object, const char* key, std::string* out) {
+  Local<Value> value = GetProperty(isolate, object, key);
+
+  if (!value->IsString()) {
+    std::string message = std::string(key) + " must be a string";
+
+    ThrowTypeError(isolate, message.c_str());
+
+    return false;
+  }
+  *out = ToUtf8(isolate, value.As<String>());
+
+  return true;
+}
+
+// { metadata, svg, images: { [id]: ArrayBuffer | ArrayBufferView }, thumbnail?, misc }; images keep Object.keys order.
+bool ReadDocument(Isolate* isolate, Local<Value> value, DocumentInput& input) {
+  if (!value->IsObject()) {
+    ThrowTypeError(isolate, "document must be an object");
+
+    return false;
+  }
+
+  Local<Object> object = value.As<Object>();
+  BeamDocument& document = input.document;
+
+  if (!ReadString(isolate, object, "metadata", &document.metadata) ||
+      !ReadString(isolate, object, "svg", &document.svg) || !ReadString(isolate, object, "misc", &document.misc)) {
+    return false;
+  }
+
+  Local<Context> context = isolate->GetCurrentContext();
+  Local<Value> images = GetProperty(isolate, object, "images");
+
+  if (images->IsObject()) {
+    Local<Array> ids;
+
+    if (!images.As<Object>()->GetOwnPropertyNames(context).ToLocal(&ids)) return false;
+    document.images.resize(ids->Length());
+    for (uint32_t i = 0; i < ids->Length(); i += 1) {
+      Local<Value> id = ids->Get(context, i).ToLocalChecked();
+      Local<Value> image;
+      Local<String> idString;
+
+      if (!id->ToString(context).ToLocal(&idString) || !images.As<Object>()->Get(context, id).ToLocal(&image)) {
+        return false;
+      }
+      document.images[i].id = ToUtf8(isolate, idString);
+      if (document.images[i].id.size() > kMaxImageIdSize) {
+        isolate->ThrowException(v8::Exception::RangeError(NewString(isolate, "image id is longer than 255 bytes")));
+
+        return false;
+      }
+      if (!ReadSpan(input, image, &document.images[i].data)) {
+        ThrowTypeError(isolate, "images must map ids to ArrayBuffers or views");
+
+        return false;
+      }
+    }
+  } else if (!images->IsUndefined()) {
+    ThrowTypeError(isolate, "images must be an object");
+
+    return false;
+  }
+
+  Local<Value> thumbnail = GetProperty(isolate, object, "thumbnail");
+
+  if (!thumbnail->IsUndefined() && !thumbnail->IsNull()) {
+    if (!ReadSpan(input, thumbnail, &document.thumbnail)) {
+      ThrowTypeError(isolate, "thumbnail must be an ArrayBuffer or view");
+
+      return false;
+    }
+    document.hasThumbnail = true;
+  }
+
+  return true;
+}
+
+// { version = 2, compress = false }
+bool ReadWriteOptions(Isolate* isolate, Local<Value> value, BeamWriteOptions* options) {
+  double version = GetNumberOption(isolate, value, "version", kBeamVersion2);
+
+  if (version != kBeamVersion2 && version != kBeamVersion3) {
+    ThrowTypeError(isolate, "version must be 2 or 3");
+
+    return false;
+  }
+  options->version = static_cast<uint8_t>(version);
+  options->compress = GetBooleanOption(isolate, value, "compress", false);
+
+  return true;
+}
+
+class WriteBeamTask : public AsyncTask {
+ public:
+  WriteBeamTask(std::string path, std::unique_ptr<DocumentInput> input, const BeamWriteOptions& options)
+      : path_(std::move(path)), input_(std::move(input)), options_(options) {}
+
+ protected:
+  void Execute() override {
+    BeamSerializer serializer(input_->document, options_);
+
+    if (serializer.WriteFile(path_, &error_)) size_ = serializer.Size();
+  }
+
+  Local<Value> Result(Isolate* isolate) override { return Number::New(isolate, static_cast<double>(size_)); }
+
+ private:
+  std::string path_;
+  std::unique_ptr<DocumentInput> input_;
+  BeamWriteOptions options_;
+  uint64_t size_ = 0;
+};
+
+Local<Uint8Array> SpanToArray(Isolate* isolate, const ByteSpan& span) {
+  return NewTypedArray<Uint8Array>(isolate, span.data, span.size);
+}
+
+bool SpanToString(Isolate* isolate, const ByteSpan& span, Local<Value>* out) {
+  Local<String> string;
+
+  if (span.size > static_cast<size_t>(INT32_MAX) ||
+      !String::NewFromUtf8(isolate, reinterpret_cast<const char*>(span.data), v8::NewStringType::kNormal,
+                           static_cast<int>(span.size))
+           .ToLocal(&string)) {
+    ThrowError(isolate, "beam block is too large for a string");
+
+    return false;
+  }
+  *out = string;
+
+  return true;
+}
+
+bool TextToString(Isolate* isolate, const std::string& text, Local<Value>* out) {
+  return SpanToString(isolate, {reinterpret_cast<const uint8_t*>(text.data()), text.size()}, out);
+}
+
+bool BlockToString(Isolate* isolate, const BeamBlock& block, Local<Value>* out) {
+  std::vector<uint8_t> storage;
+  ByteSpan span;
+  std::string error;
+
+  if (!DecodeBeamBlock(block, block.size, &storage, &span, &error)) {
+    ThrowError(isolate, error.c_str());
+
+    return false;
+  }
+
+  return SpanToString(isolate, span, out);
+}
+
+// Mark the second internal field of beam file and journal objects, which tells the two kinds apart.
+int kBeamFileTag;
+int kJournalTag;
+
+// The handle in the first internal field of `self` when the second one holds `tag`.
+void* GetTaggedHandle(Local<Object> self, const int* tag) {
+  if (self->InternalFieldCount() < 2 || self->GetAlignedPointerFromInternalField(1) != tag) return nullptr;
+
+  return self->GetAlignedPointerFromInternalField(0);
+}
+
+// Owns the mapping behind a JS BeamFile object; unmapped by close() or when the object is collected.
+struct BeamFileHandle {
+  Global<Object> object;
+  MappedFile file;
+  BeamIndex index;
+  // Later entries win, as they did when readImageSource applied them in order.
+  std::unordered_map<std::string, size_t> imageById;
+
+  static void OnCollected(const WeakCallbackInfo<BeamFileHandle>& info) {
+    BeamFileHandle* handle = info.GetParameter();
+
+    handle->object.Reset();
+    delete handle;
+  }
+};
+
+BeamFileHandle* GetOpenHandle(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  BeamFileHandle* handle = static_cast<BeamFileHandle*>(GetTaggedHandle(args.This(), &kBeamFileTag));
+
+  if (!handle) {
+    ThrowTypeError(isolate, "method must be called on a beam file");
+
+    return nullptr;
+  }
+  if (!handle->file.Data()) {
+    ThrowError(isolate, "beam file is closed");
+
+    return nullptr;
+  }
+
+  return handle;
+}
+
+// svg() => string | undefined
+void SvgMethod(const FunctionCallbackInfo<Value>& args) {
+  BeamFileHandle* handle = GetOpenHandle(args);
+  Local<Value> svg;
+
+  if (!handle || !handle->index.svg.present) return;
+  if (BlockToString(args.GetIsolate(), handle->index.svg, &svg)) args.GetReturnValue().Set(svg);
+}
+
+// misc() => string | undefined, the misc-data JSON.
+void MiscMethod(const FunctionCallbackInfo<Value>& args) {
+  BeamFileHandle* handle = GetOpenHandle(args);
+  Local<Value> misc;
+
+  if (!handle || !handle->index.misc.present) return;
+  if (BlockToString(args.GetIsolate(), handle->index.misc, &misc)) args.GetReturnValue().Set(misc);
+}
+
+// image(id) => Uint8Array | undefined. Copies one image source out of the mapping; call it when the image is first
+// displayed.
+void ImageMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  BeamFileHandle* handle = GetOpenHandle(args);
+
+  if (!handle) return;
+
+  auto found = handle->imageById.find(ToStdString(isolate, args[0]));
+
+  if (found == handle->imageById.end()) return;
+  args.GetReturnValue().Set(SpanToArray(isolate, handle->index.images[found->second].data));
+}
+
+// thumbnail() => Uint8Array | null
+void ThumbnailMethod(const FunctionCallbackInfo<Value>& args) {
+  BeamFileHandle* handle = GetOpenHandle(args);
+
+  if (!handle) return;
+  if (!handle->index.thumbnail.present) {
+    args.GetReturnValue().SetNull();
+
+    return;
+  }
+  args.GetReturnValue().Set(SpanToArray(args.GetIsolate(), handle->index.thumbnail.stored));
+}
+
+// close() unmaps the file; later calls to the other methods throw.
+void CloseMethod(const FunctionCallbackInfo<Value>& args) {
+  BeamFileHandle* handle = static_cast<BeamFileHandle*>(GetTaggedHandle(args.This(), &kBeamFileTag));
+
+  if (!handle) return;
+  handle->file.Close();
+  handle->index = BeamIndex();
+  handle->imageById.clear();
+}
+
+class JournalTask;
+
+// XXH64 of the blobs of the last save by address and size. Holding their stores keeps that memory from being reused
+// for other bytes, so a buffer saved again is not hashed again.
+struct BlobHashCache {
+  std::map<std::pair<const uint8_t*, size_t>, uint64_t> hashes;
+  std::vector<std::shared_ptr<BackingStore>> stores;
+};
+
+// A journal shared by its JS object and the task writing to it. Saves reach the file in the order they were made:
+// one task is on the thread pool at a time and starts the next queued one when it settles, so waiting saves never
+// hold a pool thread. `queued` and `running` are only touched on the JS thread. `journal` and `blobHashes` belong to
+// the running task: its Execute reads and swaps the cache on a pool thread, and the next task only starts from
+// Settled on the JS thread, so the two never run at once. Nothing else may touch them while `running` is set.
+struct JournalState : std::enable_shared_from_this<JournalState> {
+  JournalState(std::string prefix, uint64_t compactBytes) : journal(std::move(prefix), compactBytes) {}
+
+  void Submit(JournalTask* task);
+  void StartNext();
+
+  Journal journal;
+  BlobHashCache blobHashes;
+  std::deque<std::unique_ptr<JournalTask>> queued;
+  bool running = false;
+};
+
+class JournalTask : public AsyncTask {
+ public:
+  JournalTask(std::unique_ptr<DocumentInput> input, bool compact) : input_(std::move(input)), compact_(compact) {}
+
+  // Set when the task starts; a queued task does not keep the journal alive.
+  std::shared_ptr<JournalState> state;
+
+ protected:
+  void Execute() override {
+    BeamDocument& document = input_->document;
+    BlobHashCache& cache = state->blobHashes;
+    BlobHashCache next;
+    BlobHashes hashes;
+    auto hash = [&](const ByteSpan& span) {
+      auto key = std::make_pair(span.data, span.size);
+      auto found = cache.hashes.find(key);
+      uint64_t value = found != cache.hashes.end() ? found->second : Xxh64(span.data, span.size);
+
+      next.hashes.emplace(key, value);
+
+      return value;
+    };
+
+    for (const BeamImage& image : document.images) hashes.images.push_back(hash(image.data));
+    if (document.hasThumbnail) hashes.thumbnail = hash(document.thumbnail);
+    next.stores = input_->stores;
+    // The replaced stores are released with the task on the JS thread.
+    std::swap(cache, next);
+    replaced_ = std::move(next);
+    if (compact_) {
+      compacted_ = state->journal.Compact(std::move(document), hashes, &written_, &error_);
+    } else {
+      state->journal.Append(std::move(document), hashes, &written_, &compacted_, &error_);
+    }
+  }
+
+  void Settled() override { state->StartNext(); }
+
+  Local<Value> Result(Isolate* isolate) override {
+    Local<Object> output = Object::New(isolate);
+
+    SetProperty(isolate, output, "bytes", Number::New(isolate, static_cast<double>(written_)));
+    SetProperty(isolate, output, "compacted", v8::Boolean::New(isolate, compacted_));
+
+    return output;
+  }
+
+ private:
+  std::unique_ptr<DocumentInput> input_;
+  BlobHashCache replaced_;
+  bool compact_;
+  uint64_t written_ = 0;
+  bool compacted_ = false;
+};
+
+void JournalState::Submit(JournalTask* task) {
+  queued.emplace_back(task);
+  if (!running) StartNext();
+}
+
+void JournalState::StartNext() {
+  running = !queued.empty();
+  if (!running) return;
+
+  JournalTask* task = queued.front().release();
+
+  queued.pop_front();
+  task->state = shared_from_this();
+  task->Start();
+}
+
+class ReplayJournalTask : public AsyncTask {
+ public:
+  explicit ReplayJournalTask(std::string prefix) : prefix_(std::move(prefix)) {}
+
+ protected:
+  void Execute() override { ReplayJournal(prefix_, &replay_, &error_); }
+
+  Local<Value> Result(Isolate* isolate) override {
+    const BeamDocument& document = replay_.document;
+
+    if (!replay_.base.Data() && replay_.records == 0) return v8::Null(isolate);
+
+    Local<Context> context = isolate->GetCurrentContext();
+    Local<Object> output = Object::New(isolate);
+    Local<Object> images = Object::New(isolate);
+    Local<Value> metadata;
+    Local<Value> svg;
+    Local<Value> misc;
+    Local<Value> id;
+
+    // Rejects with the thrown error when a replayed string is longer than V8 allows.
+    if (!TextToString(isolate, document.metadata, &metadata) || !TextToString(isolate, document.svg, &svg) ||
+        !TextToString(isolate, document.misc, &misc)) {
+      return Local<Value>();
+    }
+    for (const BeamImage& image : document.images) {
+      if (!TextToString(isolate, image.id, &id)) return Local<Value>();
+      images->Set(context, id, SpanToArray(isolate, image.data)).Check();
+    }
+    SetProperty(isolate, output, "metadata", metadata);
+    SetProperty(isolate, output, "svg", svg);
+    SetProperty(isolate, output, "images", images);
+    if (document.hasThumbnail) SetProperty(isolate, output, "thumbnail", SpanToArray(isolate, document.thumbnail));
+    SetProperty(isolate, output, "misc", misc);
+
+    return output;
+  }
+
+ private:
+  std::string prefix_;
+  JournalReplay replay_;
+};
+
+struct JournalHandle {
+  Global<Object> object;
+  std::shared_ptr<JournalState> state;
+
+  static void OnCollected(const WeakCallbackInfo<JournalHandle>& info) {
+    JournalHandle* handle = info.GetParameter();
+
+    handle->object.Reset();
+    delete handle;
+  }
+};
+
+void QueueJournalTask(const FunctionCallbackInfo<Value>& args, bool compact) {
+  Isolate* isolate = args.GetIsolate();
+  JournalHandle* handle = static_cast<JournalHandle*>(GetTaggedHandle(args.This(), &kJournalTag));
+  std::unique_ptr<DocumentInput> input(new DocumentInput());
+
+  if (!handle) {
+    ThrowTypeError(isolate, "method must be called on a journal");
+
+    return;
+  }
+  if (!handle->state) {
+    ThrowError(isolate, "journal is closed");
+
+    return;
+  }
+  if (!ReadDocument(isolate, args[0], *input)) return;
+
+  JournalTask* task = new JournalTask(std::move(input), compact);
+
+  args.GetReturnValue().Set(AsyncTask::Defer(isolate, task));
+  handle->state->Submit(task);
+}
+
+// append(document) => Promise<{ bytes, compacted }>
+void JournalAppendMethod(const FunctionCallbackInfo<Value>& args) { QueueJournalTask(args, false); }
+
+// compact(document) => Promise<{ bytes, compacted }>
+void JournalCompactMethod(const FunctionCallbackInfo<Value>& args) { QueueJournalTask(args, true); }
+
+// close() stops accepting saves; pending ones still complete.
+void JournalCloseMethod(const FunctionCallbackInfo<Value>& args) {
+  JournalHandle* handle = static_cast<JournalHandle*>(GetTaggedHandle(args.This(), &kJournalTag));
+
+  if (handle) handle->state.reset();
+}
+
+}  // namespace
+
+// encodeBeam(document, options?) => Uint8Array with the whole file, for uploads and other in-memory consumers.
+// options.version 3 stores identical images once and adds a block index; options.compress also LZ4-compresses the
+// svg and misc blocks of a version 3 file.
+void EncodeBeamMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  DocumentInput input;
+  BeamWriteOptions options;
+
+  if (!ReadDocument(isolate, args[0], input) || !ReadWriteOptions(isolate, args[1], &options)) return;
+
+  BeamSerializer serializer(input.document, options);
+  Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, serializer.Size());
+
+  serializer.CopyTo(reinterpret_cast<uint8_t*>(ArrayBufferData(buffer)));
+  args.GetReturnValue().Set(Uint8Array::New(buffer, 0, serializer.Size()));
+}
+
+// writeBeam(path, document, options?) => Promise<bytes written>, with encodeBeam's options. The file is written on the
+// thread pool with vectored writes straight from the image buffers, which must not be modified until the promise
+// settles, and replaces `path` atomically.
+void WriteBeamMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsString()) {
+    ThrowTypeError(isolate, "path must be a string");
+
+    return;
+  }
+
+  std::unique_ptr<DocumentInput> input(new DocumentInput());
+
+  BeamWriteOptions options;
+
+  if (!ReadDocument(isolate, args[1], *input) || !ReadWriteOptions(isolate, args[2], &options)) return;
+
+  WriteBeamTask* task = new WriteBeamTask(ToStdString(isolate, args[0]), std::move(input), options);
+
+  args.GetReturnValue().Set(AsyncTask::Queue(isolate, task));
+}
+
+// openBeam(path) => { version, metadata, imageIds, svg(), misc(), image(id), thumbnail(), close() }
+// Reads versions 2 and 3. Maps the file and parses only the header and block framing. Blocks are decoded when their
+// method is called, so images in hidden layers are never read from disk. Throws when the file cannot be opened or is
+// not a beam file.
+void OpenBeamMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext();
+
+  if (!args[0]->IsString()) {
+    ThrowTypeError(isolate, "path must be a string");
+
+    return;
+  }
+
+  std::unique_ptr<BeamFileHandle> handle(new BeamFileHandle());
+  std::string error;
+
+  if (!handle->file.Open(ToStdString(isolate, args[0]), &error) ||
+      !ReadBeamIndex(handle->file.Data(), handle->file.Size(), BeamReadMode::kFull, &handle->index, &error)) {
+    ThrowError(isolate, error.c_str());
+
+    return;
+  }
+
+  const BeamIndex& index = handle->index;
+  Local<Array> imageIds = Array::New(isolate);
+  Local<Value> metadata;
+
+  if (!SpanToString(isolate, index.metadata, &metadata)) return;
+  for (size_t i = 0; i < index.images.size(); i += 1) {
+    std::string id(reinterpret_cast<const char*>(index.images[i].id.data), index.images[i].id.size);
+    auto inserted = handle->imageById.emplace(id, i);
+
+    if (inserted.second) {
+      Local<Value> idString;
+
+      if (!SpanToString(isolate, index.images[i].id, &idString)) return;
+      imageIds->Set(context, imageIds->Length(), idString).Check();
+    } else {
+      inserted.first->second = i;
+    }
+  }
+
+  Local<ObjectTemplate> objectTemplate = ObjectTemplate::New(isolate);
+
+  objectTemplate->SetInternalFieldCount(2);
+
+  Local<Object> object = objectTemplate->NewInstance(context).ToLocalChecked();
+
+  SetProperty(isolate, object, "version", Number::New(isolate, index.version));
+  SetProperty(isolate, object, "metadata", metadata);
+  SetProperty(isolate, object, "imageIds", imageIds);
+  NODE_SET_METHOD(object, "svg", SvgMethod);
+  NODE_SET_METHOD(object, "misc", MiscMethod);
+  NODE_SET_METHOD(object, "image", ImageMethod);
+  NODE_SET_METHOD(object, "thumbnail", ThumbnailMethod);
+  NODE_SET_METHOD(object, "close", CloseMethod);
+  handle->object.Reset(isolate, object);
+  handle->object.SetWeak(handle.get(), BeamFileHandle::OnCollected, v8::WeakCallbackType::kParameter);
+  object->SetAlignedPointerInInternalField(0, handle.release());
+  object->SetAlignedPointerInInternalField(1, &kBeamFileTag);
+  args.GetReturnValue().Set(object);
+}
+
+// readBeamInfo(path) => { version, thumbnail: Uint8Array | null, workarea: string | null }
+// What the recent-file and cloud-file lists show. Reads the first kilobyte and the block framing up to the
+// thumbnail, whatever the size of the project.
+void ReadBeamInfoMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsString()) {
+    ThrowTypeError(isolate, "path must be a string");
+
+    return;
+  }
+
+  MappedFile file;
+  BeamIndex index;
+  std::string error;
+
+  if (!file.Open(ToStdString(isolate, args[0]), &error) ||
+      !ReadBeamIndex(file.Data(), file.Size(), BeamReadMode::kThumbnail, &index, &error)) {
+    ThrowError(isolate, error.c_str());
+
+    return;
+  }
+
+  Local<Object> output = Object::New(isolate);
+  std::vector<uint8_t> storage;
+  ByteSpan prefix = {file.Data(), std::min(file.Size(), kWorkareaScanSize)};
+
+  // Version 3 svg blocks may be compressed and no longer sit near the start of the file; look at their first bytes.
+  if (index.version >= kBeamVersion3 && index.svg.present &&
+      !DecodeBeamBlock(index.svg, kWorkareaScanSize, &storage, &prefix, &error)) {
+    ThrowError(isolate, error.c_str());
+
+    return;
+  }
+
+  const char* begin = reinterpret_cast<const char*>(prefix.data);
+  const char* end = begin + prefix.size;
+  const char kAttribute[] = "data-workarea=\"";
+  const char* value = std::search(begin, end, kAttribute, kAttribute + sizeof(kAttribute) - 1);
+  Local<Value> workarea = v8::Null(isolate);
+
+  if (value != end) {
+    value += sizeof(kAttribute) - 1;
+
+    const char* quote = std::find(value, end, '"');
+
+    if (quote != end && quote != value) {
+      workarea = String::NewFromUtf8(isolate, value, v8::NewStringType::kNormal, static_cast<int>(quote - value))
+                     .ToLocalChecked();
+    }
+  }
+  SetProperty(isolate, output, "version", Number::New(isolate, index.version));
+  SetProperty(isolate, output, "thumbnail",
+              index.thumbnail.present ? SpanToArray(isolate, index.thumbnail.stored).As<Value>()
+                                      : v8::Null(isolate).As<Value>());
+  SetProperty(isolate, output, "workarea", workarea);
+  args.GetReturnValue().Set(output);
+}
+
+// createJournal(prefix, { compactBytes = 32 MiB }?) => { append(document), compact(document), close() }
+// Autosave journal for a project, replacing any previous journal under `prefix` (see src/journal.h for the files).
+// append() takes writeBeam documents and writes only what changed since the previous save, flushed to disk before
+// the promise resolves. Saved buffers must not be modified afterwards: one passed again is recognized by identity and
+// not hashed again, so pass a new buffer when an image changes.
+void CreateJournalMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext();
+
+  if (!args[0]->IsString()) {
+    ThrowTypeError(isolate, "prefix must be a string");
+
+    return;
+  }
+
+  double compactBytes = GetNumberOption(isolate, args[1], "compactBytes", kDefaultCompactBytes);
+  std::unique_ptr<JournalHandle> handle(new JournalHandle());
+  std::string error;
+
+  if (!(compactBytes >= 0)) {
+    ThrowTypeError(isolate, "compactBytes must not be negative");
+
+    return;
+  }
+  handle->state = std::make_shared<JournalState>(ToStdString(isolate, args[0]), static_cast<uint64_t>(compactBytes));
+  if (!handle->state->journal.Create(&error)) {
+    ThrowError(isolate, error.c_str());
+
+    return;
+  }
+
+  Local<ObjectTemplate> objectTemplate = ObjectTemplate::New(isolate);
+
+  objectTemplate->SetInternalFieldCount(2);
+
+  Local<Object> object = objectTemplate->NewInstance(context).ToLocalChecked();
+
+  NODE_SET_METHOD(object, "append", JournalAppendMethod);
+  NODE_SET_METHOD(object, "compact", JournalCompactMethod);
+  NODE_SET_METHOD(object, "close", JournalCloseMethod);
+  handle->object.Reset(isolate, object);
+  handle->object.SetWeak(handle.get(), JournalHandle::OnCollected, v8::WeakCallbackType::kParameter);
+  object->SetAlignedPointerInInternalField(0, handle.release());
+  object->SetAlignedPointerInInternalField(1, &kJournalTag);
+  args.GetReturnValue().Set(object);
+}
+
+// replayJournal(prefix) => Promise<document | null>, the last complete save as a writeBeam document, or null when
+// nothing was saved. A torn or corrupt tail is ignored.
+void ReplayJournalMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsString()) {
+    ThrowTypeError(isolate, "prefix must be a string");
+
+    return;
+  }
+  args.GetReturnValue().Set(AsyncTask::Queue(isolate, new ReplayJournalTask(ToStdString(isolate, args[0]))));
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "encodeBeam", beam::EncodeBeamMethod);
+  NODE_SET_METHOD(exports, "writeBeam", beam::WriteBeamMethod);
+  NODE_SET_METHOD(exports, "openBeam", beam::OpenBeamMethod);
+  NODE_SET_METHOD(exports, "readBeamInfo", beam::ReadBeamInfoMethod);
+  NODE_SET_METHOD(exports, "createJournal", beam::CreateJournalMethod);
+  NODE_SET_METHOD(exports, "replayJournal", beam::ReplayJournalMethod);
+}
@@ -0,0 +1,502 @@
+// Native indexes for the editor canvas: a spatial index of element bounding boxes kept in sync with the document, so
+// hit tests, rubber-band selection and bounding box unions no longer walk the DOM and call getBBox(), and an index of
+// smart-snap align points answering a dragged selection's snap queries in logarithmic time.
+#include <node.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "src/element-index.h"
+#include "src/node-utils.h"
+#include "src/snap-index.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::Float64Array;
+using v8::FunctionCallbackInfo;
+using v8::Global;
+using v8::Number;
+using v8::ObjectTemplate;
+using v8::WeakCallbackInfo;
+
+namespace {
+
+// Owns the native index of a JS SpatialIndex or SnapIndex object. Its size changes with every edit, so the reported
+// external memory is updated after each one.
+template <typename Index>
+struct IndexHandle {
+  Global<Object> object;
+  std::unique_ptr<Index> index;
+  int64_t memory = 0;
+
+  void UpdateMemory(Isolate* isolate) {
+    int64_t usage = static_cast<int64_t>(index->MemoryUsage());
+
+    isolate->AdjustAmountOfExternalAllocatedMemory(usage - memory);
+    memory = usage;
+  }
+
+  static void OnCollected(const WeakCallbackInfo<IndexHandle>& info) {
+    IndexHandle* handle = info.GetParameter();
+
+    info.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-handle->memory);
+    handle->object.Reset();
+    delete handle;
+  }
+};
+
+typedef IndexHandle<ElementIndex> SpatialIndexHandle;
+typedef IndexHandle<SnapIndex> SnapIndexHandle;
+
+// Mark the second internal field of index objects, which tells the two kinds apart.
+int kSpatialIndexTag;
+int kSnapIndexTag;
+
+template <typename Handle>
+Handle* GetHandle(const FunctionCallbackInfo<Value>& args, const char* method) {
+  const int* tag = std::is_same<Handle, SnapIndexHandle>::value ? &kSnapIndexTag : &kSpatialIndexTag;
+  Local<Object> self = args.This();
+
+  if (self->InternalFieldCount() < 2 || self->GetAlignedPointerFromInternalField(1) != tag) {
+    std::string message =
+        std::string(method) + " must be called on a " + (tag == &kSnapIndexTag ? "snap index" : "spatial index");
+
+    ThrowTypeError(args.GetIsolate(), message.c_str());
+
+    return nullptr;
+  }
+
+  return static_cast<Handle*>(self->GetAlignedPointerFromInternalField(0));
+}
+
+template <typename Handle>
+Local<Object> NewIndexObject(Isolate* isolate, Handle* handle) {
+  Local<ObjectTemplate> objectTemplate = ObjectTemplate::New(isolate);
+
+  objectTemplate->SetInternalFieldCount(2);
+
+  Local<Object> object = objectTemplate->NewInstance(isolate->GetCurrentContext()).ToLocalChecked();
+
+  handle->object.Reset(isolate, object);
+  handle->object.SetWeak(handle, Handle::OnCollected, v8::WeakCallbackType::kParameter);
+  handle->UpdateMemory(isolate);
+  object->SetAlignedPointerInInternalField(0, handle);
+  object->SetAlignedPointerInInternalField(
+      1, std::is_same<Handle, SnapIndexHandle>::value ? &kSnapIndexTag : &kSpatialIndexTag);
+
+  return object;
+}
+
+// An SVGRect-like { x, y, width, height } with finite values and no negative size.
+bool ReadBox(Isolate* isolate, Local<Value> value, Bounds* box) {
+  double x = GetNumberOption(isolate, value, "x", NAN);
+  double y = GetNumberOption(isolate, value, "y", NAN);
+  double width = GetNumberOption(isolate, value, "width", NAN);
+  double height = GetNumberOption(isolate, value, "height", NAN);
+
+  if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(width) || !std::isfinite(height) || width < 0 ||
+      height < 0) {
+    ThrowTypeError(isolate, "box must be { x, y, width, height } with finite values and no negative size");
+
+    return false;
+  }
+  *box = Bounds{x, y, x + width, y + height};
+
+  return true;
+}
+
+Local<Value> BoxToObject(Isolate* isolate, const Bounds& box) {
+  if (box.IsEmpty()) return v8::Null(isolate);
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "x", Number::New(isolate, box.minX));
+  SetProperty(isolate, output, "y", Number::New(isolate, box.minY));
+  SetProperty(isolate, output, "width", Number::New(isolate, box.Width()));
+  SetProperty(isolate, output, "height", Number::New(isolate, box.Height()));
+
+  return output;
+}
+
+Local<Array> IdsToArray(Isolate* isolate, const ElementIndex& index, const std::vector<uint32_t>& elements) {
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  Local<Array> output = Array::New(isolate, static_cast<int>(elements.size()));
+
+  for (size_t i = 0; i < elements.size(); i += 1) {
+    const std::string& id = index.Id(elements[i]);
+    int length = static_cast<int>(id.size());
+
+    output->Set(context, static_cast<uint32_t>(i),
+                String::NewFromUtf8(isolate, id.data(), v8::NewStringType::kNormal, length).ToLocalChecked())
+        .Check();
+  }
+
+  return output;
+}
+
+bool ReadId(Isolate* isolate, Local<Value> value, std::string* id) {
+  if (!value->IsString()) {
+    ThrowTypeError(isolate, "id must be a string");
+
+    return false;
+  }
+  *id = ToUtf8(isolate, value.As<String>());
+
+  return true;
+}
+
+// insert(id: string, box, order?: number)
+// Adds the element or moves it when already indexed. order places it in query results (document order); by default
+// a new element comes after all others and a known one keeps its place.
+void InsertMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "insert");
+  std::string id;
+  Bounds box;
+
+  if (!handle || !ReadId(isolate, args[0], &id) || !ReadBox(isolate, args[1], &box)) return;
+
+  double order = args[2]->IsNumber() ? args[2].As<Number>()->Value() : NAN;
+
+  handle->index->Set(id, box, order);
+  handle->UpdateMemory(isolate);
+}
+
+// update(id: string, box) => boolean
+// Moves an indexed element; false when the id is unknown.
+void UpdateMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "update");
+  std::string id;
+  Bounds box;
+
+  if (!handle || !ReadId(isolate, args[0], &id) || !ReadBox(isolate, args[1], &box)) return;
+  args.GetReturnValue().Set(handle->index->Update(id, box));
+}
+
+// remove(id: string) => boolean
+void RemoveMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "remove");
+  std::string id;
+
+  if (!handle || !ReadId(isolate, args[0], &id)) return;
+  args.GetReturnValue().Set(handle->index->Remove(id));
+  handle->UpdateMemory(isolate);
+}
+
+// load(ids: string[], boxes: Float64Array)
+// Replaces the contents in one go, e.g. when a document opens: boxes holds x, y, width, height per id and ids are in
+// document order.
+void LoadMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "load");
+
+  if (!handle) return;
+  if (!args[0]->IsArray() || !args[1]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "ids must be an Array and boxes a Float64Array");
+
+    return;
+  }
+
+  Local<Array> idArray = args[0].As<Array>();
+  Local<Float64Array> boxArray = args[1].As<Float64Array>();
+  const double* data = TypedArrayData<double>(boxArray);
+  uint32_t count = idArray->Length();
+
+  if (boxArray->Length() != 4 * static_cast<size_t>(count)) {
+    ThrowTypeError(isolate, "boxes must hold x, y, width and height for every id");
+
+    return;
+  }
+
+  std::vector<std::string> ids(count);
+  std::vector<Bounds> boxes(count);
+
+  for (uint32_t i = 0; i < count; i += 1) {
+    const double* b = data + 4 * static_cast<size_t>(i);
+
+    if (!std::isfinite(b[0]) || !std::isfinite(b[1]) || !std::isfinite(b[2]) || !std::isfinite(b[3]) || b[2] < 0 ||
+        b[3] < 0) {
+      ThrowTypeError(isolate, "boxes must be finite with no negative size");
+
+      return;
+    }
+    if (!ReadId(isolate, idArray->Get(context, i).ToLocalChecked(), &ids[i])) return;
+    boxes[i] = Bounds{b[0], b[1], b[0] + b[2], b[1] + b[3]};
+  }
+  handle->index->Load(ids, boxes);
+  handle->UpdateMemory(isolate);
+}
+
+// queryRect(box, options?) => string[]
+// Ids of the elements whose box meets `box`, in document order. options.contained (default false) keeps only the
+// boxes wholly inside it.
+void QueryRectMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "queryRect");
+  Bounds box;
+
+  if (!handle || !ReadBox(isolate, args[0], &box)) return;
+
+  std::vector<uint32_t> elements;
+
+  handle->index->QueryRect(box, GetBooleanOption(isolate, args[1], "contained", false), elements);
+  args.GetReturnValue().Set(IdsToArray(isolate, *handle->index, elements));
+}
+
+// queryPoint(x: number, y: number, options?) => string[]
+// Ids of the elements whose box, grown by options.tolerance (default 0), contains the point, in document order: the
+// topmost element is the last.
+void QueryPointMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "queryPoint");
+
+  if (!handle) return;
+
+  double x = args[0]->IsNumber() ? args[0].As<Number>()->Value() : NAN;
+  double y = args[1]->IsNumber() ? args[1].As<Number>()->Value() : NAN;
+  double tolerance = GetNumberOption(isolate, args[2], "tolerance", 0);
+
+  if (!std::isfinite(x) || !std::isfinite(y) || !(tolerance >= 0)) {
+    ThrowTypeError(isolate, "x and y must be finite and tolerance not negative");
+
+    return;
+  }
+
+  std::vector<uint32_t> elements;
+
+  handle->index->QueryPoint(Vec2{x, y}, tolerance, elements);
+  args.GetReturnValue().Set(IdsToArray(isolate, *handle->index, elements));
+}
+
+// unionBBox(ids?: string[]) => { x, y, width, height } | null
+// The union of every indexed box, kept up to date by each edit, or of the listed elements only. Unknown ids are
+// skipped; null when no box is left.
+void UnionBBoxMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "unionBBox");
+
+  if (!handle) return;
+  if (args[0]->IsUndefined()) {
+    args.GetReturnValue().Set(BoxToObject(isolate, handle->index->Union()));
+
+    return;
+  }
+  if (!args[0]->IsArray()) {
+    ThrowTypeError(isolate, "ids must be an Array");
+
+    return;
+  }
+
+  Local<Array> ids = args[0].As<Array>();
+  Bounds total;
+  std::string id;
+
+  for (uint32_t i = 0; i < ids->Length(); i += 1) {
+    Bounds box;
+
+    if (!ReadId(isolate, ids->Get(context, i).ToLocalChecked(), &id)) return;
+    if (handle->index->Box(id, &box)) total.Add(box);
+  }
+  args.GetReturnValue().Set(BoxToObject(isolate, total));
+}
+
+// getBBox(id: string) => { x, y, width, height } | null
+void GetBBoxMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "getBBox");
+  std::string id;
+  Bounds box;
+
+  if (!handle || !ReadId(isolate, args[0], &id)) return;
+  args.GetReturnValue().Set(handle->index->Box(id, &box) ? BoxToObject(isolate, box) : v8::Null(isolate).As<Value>());
+}
+
+// size() => number
+void SizeMethod(const FunctionCallbackInfo<Value>& args) {
+  SpatialIndexHandle* handle = GetHandle<SpatialIndexHandle>(args, "size");
+
+  if (handle) args.GetReturnValue().Set(static_cast<double>(handle->index->Size()));
+}
+
+// Reads a Float64Array of x, y pairs; false after throwing when `value` is not one.
+bool ReadPoints(Isolate* isolate, Local<Value> value, const double** xy, size_t* count) {
+  if (!value->IsFloat64Array() || value.As<Float64Array>()->Length() % 2 != 0) {
+    ThrowTypeError(isolate, "points must be a Float64Array of x, y pairs");
+
+    return false;
+  }
+
+  Local<Float64Array> points = value.As<Float64Array>();
+
+  *xy = TypedArrayData<double>(points);
+  *count = points->Length() / 2;
+  for (size_t i = 0; i < 2 * *count; i += 1) {
+    if (!std::isfinite((*xy)[i])) {
+      ThrowTypeError(isolate, "points must be finite");
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void SnapLoadMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SnapIndexHandle* handle = GetHandle<SnapIndexHandle>(args, "load");
+  const double* xy;
+  size_t count;
+
+  if (!handle || !ReadPoints(isolate, args[0], &xy, &count)) return;
+  handle->index->Load(xy, count);
+  handle->UpdateMemory(isolate);
+}
+
+void SnapAddMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SnapIndexHandle* handle = GetHandle<SnapIndexHandle>(args, "add");
+  const double* xy;
+  size_t count;
+
+  if (!handle || !ReadPoints(isolate, args[0], &xy, &count)) return;
+  handle->index->Add(xy, count);
+  handle->UpdateMemory(isolate);
+}
+
+void SnapRemoveMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SnapIndexHandle* handle = GetHandle<SnapIndexHandle>(args, "remove");
+  const double* xy;
+  size_t count;
+
+  if (!handle || !ReadPoints(isolate, args[0], &xy, &count)) return;
+
+  size_t removed = handle->index->Remove(xy, count);
+
+  handle->UpdateMemory(isolate);
+  args.GetReturnValue().Set(static_cast<double>(removed));
+}
+
+// findAlignPoints(points: Float64Array, fuzzyRange: number, out?: Float64Array) => Float64Array
+// For every x, y pair of `points` writes 8 numbers: the nearest and farthest align points matching its x, then those
+// matching its y, as x, y pairs (NaN when nothing matches), like findNearestAndFarthestAlignPoints. Pass the same `out`
+// every frame to keep dragging free of allocations.
+void FindAlignPointsMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SnapIndexHandle* handle = GetHandle<SnapIndexHandle>(args, "findAlignPoints");
+  const double* xy;
+  size_t count;
+
+  if (!handle || !ReadPoints(isolate, args[0], &xy, &count)) return;
+  if (!args[1]->IsNumber() || !(args[1].As<Number>()->Value() >= 0)) {
+    ThrowTypeError(isolate, "fuzzyRange must be a non-negative number");
+
+    return;
+  }
+
+  double range = args[1].As<Number>()->Value();
+  Local<Float64Array> out;
+
+  if (args[2]->IsFloat64Array()) {
+    out = args[2].As<Float64Array>();
+    if (out->Length() < 8 * count) {
+      ThrowTypeError(isolate, "out must hold 8 numbers for every point");
+
+      return;
+    }
+  } else if (args[2]->IsUndefined()) {
+    out = Float64Array::New(v8::ArrayBuffer::New(isolate, 8 * count * sizeof(double)), 0, 8 * count);
+  } else {
+    ThrowTypeError(isolate, "out must be a Float64Array");
+
+    return;
+  }
+
+  double* result = TypedArrayData<double>(out);
+
+  for (size_t i = 0; i < count; i += 1) {
+    Vec2 target{xy[2 * i], xy[2 * i + 1]};
+
+    for (int axis = 0; axis < 2; axis += 1) {
+      double* slot = result + 8 * i + 4 * axis;
+      Vec2 nearest;
+      Vec2 farthest;
+
+      if (handle->index->Match(target, axis, range, &nearest, &farthest)) {
+        slot[0] = nearest.x;
+        slot[1] = nearest.y;
+        slot[2] = farthest.x;
+        slot[3] = farthest.y;
+      } else {
+        std::fill(slot, slot + 4, NAN);
+      }
+    }
+  }
+  args.GetReturnValue().Set(out);
+}
+
+void SnapSizeMethod(const FunctionCallbackInfo<Value>& args) {
+  SnapIndexHandle* handle = GetHandle<SnapIndexHandle>(args, "size");
+
+  if (handle) args.GetReturnValue().Set(static_cast<double>(handle->index->Size()));
+}
+
+}  // namespace
+
+// createSpatialIndex() => { insert, update, remove, load, queryRect, queryPoint, unionBBox, getBBox, size }
+// An empty index of element bounding boxes keyed by element id, meant to follow the document through its history
+// commands. Edits and queries are O(log n) in the number of elements (plus the size of the answer).
+void CreateSpatialIndexMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SpatialIndexHandle* handle = new SpatialIndexHandle();
+
+  handle->index.reset(new ElementIndex());
+
+  Local<Object> object = NewIndexObject(isolate, handle);
+
+  NODE_SET_METHOD(object, "insert", InsertMethod);
+  NODE_SET_METHOD(object, "update", UpdateMethod);
+  NODE_SET_METHOD(object, "remove", RemoveMethod);
+  NODE_SET_METHOD(object, "load", LoadMethod);
+  NODE_SET_METHOD(object, "queryRect", QueryRectMethod);
+  NODE_SET_METHOD(object, "queryPoint", QueryPointMethod);
+  NODE_SET_METHOD(object, "unionBBox", UnionBBoxMethod);
+  NODE_SET_METHOD(object, "getBBox", GetBBoxMethod);
+  NODE_SET_METHOD(object, "size", SizeMethod);
+  args.GetReturnValue().Set(object);
+}
+
+// createSnapIndex() => { load, add, remove, findAlignPoints, size }
+// An empty index of smart-snap align points. Points are added and removed as x, y pairs in Float64Arrays; a query
+// costs a few binary searches in the number of points, independent of how many fall within the fuzzy range.
+void CreateSnapIndexMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  SnapIndexHandle* handle = new SnapIndexHandle();
+
+  handle->index.reset(new SnapIndex());
+
+  Local<Object> object = NewIndexObject(isolate, handle);
+
+  NODE_SET_METHOD(object, "load", SnapLoadMethod);
+  NODE_SET_METHOD(object, "add", SnapAddMethod);
+  NODE_SET_METHOD(object, "remove", SnapRemoveMethod);
+  NODE_SET_METHOD(object, "findAlignPoints", FindAlignPointsMethod);
+  NODE_SET_METHOD(object, "size", SnapSizeMethod);
+  args.GetReturnValue().Set(object);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "createSpatialIndex", beam::CreateSpatialIndexMethod);
+  NODE_SET_METHOD(exports, "createSnapIndex", beam::CreateSnapIndexMethod);
+}
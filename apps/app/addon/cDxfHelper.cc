@@ -0,0 +1,266 @@
+// Native DXF import: reads and flattens CAD drawings on a worker thread, so large files neither block nor exhaust the
+// renderer the way parsing them into dxf2svg's entity tree does.
+#include <node.h>
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "src/background-job.h"
+#include "src/dxf-reader.h"
+#include "src/file-io.h"
+#include "src/node-utils.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::BackingStore;
+using v8::Float64Array;
+using v8::Function;
+using v8::FunctionCallbackInfo;
+using v8::Global;
+using v8::Number;
+using v8::Uint8Array;
+
+namespace {
+
+class DxfJob;
+
+std::mutex registryMutex;
+std::unordered_map<uint32_t, DxfJob*> registry;
+uint32_t nextJobId = 1;
+
+Local<Object> BoundsToObject(Isolate* isolate, const DxfBounds& bounds) {
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "minX", Number::New(isolate, bounds.minX));
+  SetProperty(isolate, output, "minY", Number::New(isolate, bounds.minY));
+  SetProperty(isolate, output, "maxX", Number::New(isolate, bounds.maxX));
+  SetProperty(isolate, output, "maxY", Number::New(isolate, bounds.maxY));
+  SetProperty(isolate, output, "width", Number::New(isolate, bounds.maxX - bounds.minX));
+  SetProperty(isolate, output, "height", Number::New(isolate, bounds.maxY - bounds.minY));
+
+  return output;
+}
+
+Local<Object> LayerToObject(Isolate* isolate, const DxfLayerPaths& layer) {
+  Local<Object> output = Object::New(isolate);
+  char color[8];
+
+  snprintf(color, sizeof(color), "#%06X", layer.color);
+  SetProperty(isolate, output, "name", NewString(isolate, layer.name.c_str()));
+  SetProperty(isolate, output, "color", NewString(isolate, color));
+  SetProperty(isolate, output, "commands", NewTypedArray<Uint8Array>(isolate, layer.path.commands));
+  SetProperty(isolate, output, "coords", NewTypedArray<Float64Array>(isolate, layer.path.coords));
+  SetProperty(isolate, output, "bounds", BoundsToObject(isolate, layer.bounds));
+  SetProperty(isolate, output, "entities", Number::New(isolate, static_cast<double>(layer.entities)));
+
+  return output;
+}
+
+class DxfJob : public BackgroundJob {
+ public:
+  DxfJob(Isolate* isolate, uint32_t id, const DxfOptions& options)
+      : BackgroundJob(isolate), id_(id), options_(options) {}
+  ~DxfJob() override { Unregister(); }
+
+  // The drawing comes from a file mapped on the worker thread or from JS-owned bytes.
+  void SetSource(std::string path, std::shared_ptr<BackingStore> store, const ByteSpan& bytes) {
+    path_ = std::move(path);
+    store_ = std::move(store);
+    bytes_ = bytes;
+  }
+
+  void SetCallbacks(Isolate* isolate, Local<Value> callbacks) {
+    if (!callbacks->IsObject()) return;
+
+    Local<Object> object = callbacks.As<Object>();
+    auto read = [&](const char* key, Global<Function>& target) {
+      Local<Value> value = GetProperty(isolate, object, key);
+
+      if (value->IsFunction()) target.Reset(isolate, value.As<Function>());
+    };
+
+    read("onProgress", onProgress_);
+    read("onDone", onDone_);
+  }
+
+ protected:
+  void Run() override {
+    MappedFile file;
+    ByteSpan data = bytes_;
+
+    if (!path_.empty()) {
+      if (!file.Open(path_, &error_)) return;
+      data = {file.Data(), file.Size()};
+    }
+    ok_ = ReadDxf(data.data, data.size, options_, stop_, [this](double progress) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      progress_ = progress;
+      hasProgress_ = true;
+      Notify();
+    }, &drawing_, &error_);
+  }
+
+  void Deliver(Isolate* isolate, bool finished) override {
+    double progress;
+    bool hasProgress;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      progress = progress_;
+      hasProgress = hasProgress_;
+      hasProgress_ = false;
+    }
+    if (hasProgress && !finished) {
+      Local<Value> progressArgs[] = {Number::New(isolate, progress)};
+
+      Call(isolate, onProgress_, 1, progressArgs);
+    }
+    if (!finished) return;
+
+    // The id is dead once onDone runs. The worker has exited, so the drawing is no longer written.
+    Unregister();
+
+    Local<Object> output = Object::New(isolate);
+    Local<Value> doneArgs[] = {output};
+
+    SetProperty(isolate, output, "ok", v8::Boolean::New(isolate, ok_));
+    if (!ok_) {
+      SetProperty(isolate, output, "error", NewString(isolate, error_.c_str()));
+      Call(isolate, onDone_, 1, doneArgs);
+
+      return;
+    }
+
+    Local<Context> context = isolate->GetCurrentContext();
+    Local<Array> layers = Array::New(isolate, static_cast<int>(drawing_.layers.size()));
+
+    for (size_t i = 0; i < drawing_.layers.size(); i += 1) {
+      layers->Set(context, static_cast<uint32_t>(i), LayerToObject(isolate, drawing_.layers[i])).Check();
+    }
+    SetProperty(isolate, output, "version", NewString(isolate, drawing_.version.c_str()));
+    SetProperty(isolate, output, "insunits", Number::New(isolate, drawing_.insunits));
+    SetProperty(isolate, output, "bounds", BoundsToObject(isolate, drawing_.bounds));
+    SetProperty(isolate, output, "layers", layers);
+    SetProperty(isolate, output, "entities", Number::New(isolate, static_cast<double>(drawing_.entities)));
+    SetProperty(isolate, output, "skipped", Number::New(isolate, static_cast<double>(drawing_.skipped)));
+    Call(isolate, onDone_, 1, doneArgs);
+  }
+
+ private:
+  void Unregister() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    registry.erase(id_);
+  }
+
+  uint32_t id_;
+  DxfOptions options_;
+  std::string path_;
+  std::shared_ptr<BackingStore> store_;
+  ByteSpan bytes_;
+  Global<Function> onProgress_;
+  Global<Function> onDone_;
+  bool ok_ = false;
+  std::string error_;
+  DxfDrawing drawing_;
+
+  std::mutex mutex_;
+  double progress_ = 0;
+  bool hasProgress_ = false;
+};
+
+}  // namespace
+
+// startDxfImport(data, options?, callbacks?) => id
+// Reads an ASCII DXF (a file path or an ArrayBuffer / view, which must not be modified until onDone) on a worker
+// thread. Block inserts are expanded and arcs, ellipses, splines and bulged polylines are flattened to lines.
+// options: scale (output units per drawing unit, default 1), tolerance (maximum chord error in output units, default
+// 0.1), hatches and dimensions (also draw hatch boundaries and dimension blocks, default false). callbacks:
+// onProgress(fraction read), onDone({ ok, error?, version, insunits, bounds, layers, entities, skipped }), where
+// layers is [{ name, color: '#RRGGBB', commands: Uint8Array, coords: Float64Array, bounds, entities }] with
+// path-buffer.h commands in dxf2svg's y-down layout, and bounds are { minX, minY, maxX, maxY, width, height }: the
+// drawing's in scaled drawing coordinates, each layer's in output coordinates.
+void StartDxfImportMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  std::string path;
+  std::shared_ptr<BackingStore> store;
+  ByteSpan bytes;
+  size_t offset;
+  size_t length;
+
+  if (args[0]->IsString()) {
+    path = ToStdString(isolate, args[0]);
+  } else if (ReadBytes(args[0], &store, &offset, &length)) {
+    bytes = {static_cast<const uint8_t*>(store->Data()) + offset, length};
+  } else {
+    ThrowTypeError(isolate, "data must be a path, an ArrayBuffer or a view");
+
+    return;
+  }
+
+  DxfOptions options;
+
+  options.scale = GetNumberOption(isolate, args[1], "scale", options.scale);
+  options.tolerance = GetNumberOption(isolate, args[1], "tolerance", options.tolerance);
+  options.hatches = GetBooleanOption(isolate, args[1], "hatches", options.hatches);
+  options.dimensions = GetBooleanOption(isolate, args[1], "dimensions", options.dimensions);
+  if (!(options.scale > 0) || !std::isfinite(options.scale) || !(options.tolerance > 0)) {
+    ThrowTypeError(isolate, "scale and tolerance must be positive");
+
+    return;
+  }
+
+  uint32_t id;
+  DxfJob* job;
+
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    id = nextJobId++;
+    job = new DxfJob(isolate, id, options);
+    registry[id] = job;
+  }
+  job->SetSource(std::move(path), std::move(store), bytes);
+  job->SetCallbacks(isolate, args[2]);
+  job->Start();
+  args.GetReturnValue().Set(Number::New(isolate, id));
+}
+
+// cancelDxfImport(id) => boolean; the import still finishes through onDone, with error "cancelled".
+void CancelDxfImportMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsNumber()) {
+    ThrowTypeError(isolate, "id must be a number");
+
+    return;
+  }
+
+  uint32_t id = static_cast<uint32_t>(args[0].As<Number>()->Value());
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto found = registry.find(id);
+
+  if (found == registry.end()) {
+    args.GetReturnValue().Set(false);
+
+    return;
+  }
+  found->second->Stop();
+  args.GetReturnValue().Set(true);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "startDxfImport", beam::StartDxfImportMethod);
+  NODE_SET_METHOD(exports, "cancelDxfImport", beam::CancelDxfImportMethod);
+}
@@ -0,0 +1,841 @@
+// Native font engine: an index of the installed fonts for discovery, text-to-path conversion that parses a font once,
+// keeps every decoded glyph outline and lays out whole strings (or batches of strings) into packed path buffers, and
+// variable text production runs built from those outlines plus QR code and barcode encoders.
+#include <node.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/async-task.h"
+#include "src/file-io.h"
+#include "src/font-index.h"
+#include "src/font-layout.h"
+#include "src/font.h"
+#include "src/node-utils.h"
+#include "src/path-buffer.h"
+#include "src/variable-job.h"
+#include "src/vec2.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::BackingStore;
+using v8::Boolean;
+using v8::Float64Array;
+using v8::FunctionCallbackInfo;
+using v8::Global;
+using v8::Int32Array;
+using v8::Number;
+using v8::ObjectTemplate;
+using v8::Uint16Array;
+using v8::Uint32Array;
+using v8::Uint8Array;
+using v8::WeakCallbackInfo;
+
+namespace {
+
+// CSS default font size, used when options.fontSize is missing.
+constexpr double kDefaultFontSize = 16;
+// Pieces of one generateVariableBatch call, and the serial numbers that stay exact as JS numbers.
+constexpr double kMaxPieces = 1e7;
+constexpr double kMaxSerial = 9007199254740991;
+
+// Owns the native font of a JS Font object and frees it when the object is collected. The outline cache grows with
+// use, so the reported external memory is updated after every call.
+struct FontHandle {
+  Global<Object> object;
+  std::unique_ptr<Font> font;
+  std::unique_ptr<TextShaper> shaper;
+  int64_t memory = 0;
+
+  void UpdateMemory(Isolate* isolate) {
+    int64_t usage = static_cast<int64_t>(font->MemoryUsage());
+
+    isolate->AdjustAmountOfExternalAllocatedMemory(usage - memory);
+    memory = usage;
+  }
+
+  static void OnCollected(const WeakCallbackInfo<FontHandle>& info) {
+    FontHandle* handle = info.GetParameter();
+
+    info.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-handle->memory);
+    handle->object.Reset();
+    delete handle;
+  }
+};
+
+// Marks the second internal field of Font objects, which tells them apart from other wrapped objects when a font is
+// passed as an argument.
+int kFontTag;
+
+FontHandle* UnwrapFont(Local<Value> value) {
+  if (!value->IsObject()) return nullptr;
+
+  Local<Object> object = value.As<Object>();
+
+  if (object->InternalFieldCount() < 2 || object->GetAlignedPointerFromInternalField(1) != &kFontTag) return nullptr;
+
+  return static_cast<FontHandle*>(object->GetAlignedPointerFromInternalField(0));
+}
+
+FontHandle* GetHandle(const FunctionCallbackInfo<Value>& args, const char* method) {
+  FontHandle* handle = UnwrapFont(args.This());
+
+  if (!handle) {
+    std::string message = std::string(method) + " must be called on a font";
+
+    ThrowTypeError(args.GetIsolate(), message.c_str());
+  }
+
+  return handle;
+}
+
+LayoutOptions ReadLayoutOptions(Isolate* isolate, Local<Value> options) {
+  LayoutOptions layout;
+
+  layout.kerning = GetBooleanOption(isolate, options, "kerning", layout.kerning);
+  layout.ligatures = GetBooleanOption(isolate, options, "ligatures", layout.ligatures);
+
+  return layout;
+}
+
+// Appends the cached outline of `glyph` mapped from font units by the affine matrix m = [a, b, c, d, e, f].
+void AppendGlyph(Font* font, uint16_t glyph, const double* m, PathBuffer* out) {
+  GlyphOutline outline = font->Outline(glyph);
+  size_t start = out->coords.size();
+
+  out->commands.insert(out->commands.end(), outline.commands, outline.commands + outline.commandCount);
+  out->coords.resize(start + outline.coordCount);
+
+  double* coords = out->coords.data() + start;
+
+  for (size_t k = 0; k + 1 < outline.coordCount; k += 2) {
+    double x = outline.coords[k];
+    double y = outline.coords[k + 1];
+
+    coords[k] = m[0] * x + m[2] * y + m[4];
+    coords[k + 1] = m[1] * x + m[3] * y + m[5];
+  }
+}
+
+// layout(text, options?) => { glyphs: Uint16Array, clusters: Uint32Array, advances: Int32Array }
+// Advances are in font units with kerning applied; clusters are the UTF-16 index each glyph starts at. options:
+// kerning and ligatures (default true).
+void LayoutMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  FontHandle* handle = GetHandle(args, "layout");
+
+  if (!handle) return;
+  if (!args[0]->IsString()) {
+    ThrowTypeError(isolate, "text must be a string");
+
+    return;
+  }
+
+  std::vector<uint16_t> text;
+  GlyphRun run;
+
+  ToUtf16(isolate, args[0].As<String>(), &text);
+  handle->shaper->Shape(text.data(), text.size(), ReadLayoutOptions(isolate, args[1]), &run);
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "glyphs", NewTypedArray<Uint16Array>(isolate, run.glyphs));
+  SetProperty(isolate, output, "clusters", NewTypedArray<Uint32Array>(isolate, run.clusters));
+  SetProperty(isolate, output, "advances", NewTypedArray<Int32Array>(isolate, run.advances));
+  args.GetReturnValue().Set(output);
+}
+
+// textToPath(text: string | string[], options?) => { commands, coords, offsets: Uint32Array, advances: Float64Array }
+// Lays out each string on a baseline starting at (options.x, options.y) and returns one path-buffer.h path in y-down
+// user units for the whole batch. offsets[i]..offsets[i + 1] is the command range of string i and advances[i] its
+// width. options: fontSize (default 16), x and y (default 0), letterSpacing (added after every glyph, default 0),
+// kerning and ligatures (default true).
+void TextToPathMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  FontHandle* handle = GetHandle(args, "textToPath");
+
+  if (!handle) return;
+
+  std::vector<Local<String>> strings;
+
+  if (args[0]->IsString()) {
+    strings.push_back(args[0].As<String>());
+  } else if (args[0]->IsArray()) {
+    Local<Array> array = args[0].As<Array>();
+
+    for (uint32_t i = 0; i < array->Length(); i += 1) {
+      Local<Value> item;
+
+      if (!array->Get(context, i).ToLocal(&item) || !item->IsString()) {
+        ThrowTypeError(isolate, "text must be a string or an array of strings");
+
+        return;
+      }
+      strings.push_back(item.As<String>());
+    }
+  } else {
+    ThrowTypeError(isolate, "text must be a string or an array of strings");
+
+    return;
+  }
+
+  Font* font = handle->font.get();
+  double fontSize = GetNumberOption(isolate, args[1], "fontSize", kDefaultFontSize);
+  double originX = GetNumberOption(isolate, args[1], "x", 0);
+  double originY = GetNumberOption(isolate, args[1], "y", 0);
+  double letterSpacing = GetNumberOption(isolate, args[1], "letterSpacing", 0);
+  LayoutOptions layout = ReadLayoutOptions(isolate, args[1]);
+
+  if (!std::isfinite(fontSize) || !std::isfinite(originX) || !std::isfinite(originY) ||
+      !std::isfinite(letterSpacing)) {
+    ThrowTypeError(isolate, "fontSize, x, y and letterSpacing must be finite");
+
+    return;
+  }
+
+  double scale = fontSize / font->UnitsPerEm();
+  std::vector<uint16_t> text;
+  GlyphRun run;
+  PathBuffer path;
+  std::vector<uint32_t> offsets(1, 0);
+  std::vector<double> advances;
+
+  for (const Local<String>& string : strings) {
+    double pen = 0;
+
+    ToUtf16(isolate, string, &text);
+    handle->shaper->Shape(text.data(), text.size(), layout, &run);
+    for (size_t i = 0; i < run.glyphs.size(); i += 1) {
+      double matrix[6] = {scale, 0, 0, -scale, originX + pen, originY};
+
+      AppendGlyph(font, run.glyphs[i], matrix, &path);
+      pen += run.advances[i] * scale + letterSpacing;
+    }
+    offsets.push_back(static_cast<uint32_t>(path.commands.size()));
+    advances.push_back(pen);
+  }
+  handle->UpdateMemory(isolate);
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "commands", NewTypedArray<Uint8Array>(isolate, path.commands));
+  SetProperty(isolate, output, "coords", NewTypedArray<Float64Array>(isolate, path.coords));
+  SetProperty(isolate, output, "offsets", NewTypedArray<Uint32Array>(isolate, offsets));
+  SetProperty(isolate, output, "advances", NewTypedArray<Float64Array>(isolate, advances));
+  args.GetReturnValue().Set(output);
+}
+
+// glyphPath(glyphs: Uint16Array, placements: Float64Array, options?) => { commands, coords }
+// Outlines of glyphs placed individually, e.g. along an SVG textPath: placements holds x, y (baseline origin) and a
+// rotation in degrees per glyph, in y-down user units. options.fontSize defaults to 16.
+void GlyphPathMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  FontHandle* handle = GetHandle(args, "glyphPath");
+
+  if (!handle) return;
+  if (!args[0]->IsUint16Array() || !args[1]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "glyphs must be a Uint16Array and placements a Float64Array");
+
+    return;
+  }
+
+  Local<Uint16Array> glyphs = args[0].As<Uint16Array>();
+  Local<Float64Array> placements = args[1].As<Float64Array>();
+
+  if (placements->Length() != 3 * glyphs->Length()) {
+    ThrowTypeError(isolate, "placements must hold x, y and rotation per glyph");
+
+    return;
+  }
+
+  Font* font = handle->font.get();
+  const uint16_t* ids = TypedArrayData<uint16_t>(glyphs);
+  const double* place = TypedArrayData<double>(placements);
+  double scale = GetNumberOption(isolate, args[2], "fontSize", kDefaultFontSize) / font->UnitsPerEm();
+  PathBuffer path;
+
+  for (size_t i = 0; i < glyphs->Length(); i += 1) {
+    double angle = place[3 * i + 2] * kPi / 180;
+    double cosine = std::cos(angle) * scale;
+    double sine = std::sin(angle) * scale;
+    // Scale with the y flip, then rotate clockwise on screen and move to the placement.
+    double matrix[6] = {cosine, sine, sine, -cosine, place[3 * i], place[3 * i + 1]};
+
+    AppendGlyph(font, ids[i], matrix, &path);
+  }
+  handle->UpdateMemory(isolate);
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "commands", NewTypedArray<Uint8Array>(isolate, path.commands));
+  SetProperty(isolate, output, "coords", NewTypedArray<Float64Array>(isolate, path.coords));
+  args.GetReturnValue().Set(output);
+}
+
+// Owns the native index of a JS FontIndex object.
+struct FontIndexHandle {
+  Global<Object> object;
+  std::unique_ptr<FontIndex> index;
+  int64_t memory;
+
+  static void OnCollected(const WeakCallbackInfo<FontIndexHandle>& info) {
+    FontIndexHandle* handle = info.GetParameter();
+
+    info.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-handle->memory);
+    handle->object.Reset();
+    delete handle;
+  }
+};
+
+// Marks the second internal field of font index objects, as kFontTag does for fonts.
+int kFontIndexTag;
+
+const FontIndex* GetIndex(const FunctionCallbackInfo<Value>& args, const char* method) {
+  Local<Object> self = args.This();
+
+  if (self->InternalFieldCount() < 2 || self->GetAlignedPointerFromInternalField(1) != &kFontIndexTag) {
+    std::string message = std::string(method) + " must be called on a font index";
+
+    ThrowTypeError(args.GetIsolate(), message.c_str());
+
+    return nullptr;
+  }
+
+  return static_cast<FontIndexHandle*>(self->GetAlignedPointerFromInternalField(0))->index.get();
+}
+
+Local<String> ViewToString(Isolate* isolate, std::string_view text) {
+  return String::NewFromUtf8(isolate, text.data(), v8::NewStringType::kNormal, static_cast<int>(text.size()))
+      .ToLocalChecked();
+}
+
+// The FontDescriptor shape font-scanner returns, plus the face index within a collection.
+Local<Object> FaceToObject(Isolate* isolate, const FontFaceView& face) {
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "path", ViewToString(isolate, face.path));
+  SetProperty(isolate, output, "index", Number::New(isolate, face.index));
+  SetProperty(isolate, output, "postscriptName", ViewToString(isolate, face.postscriptName));
+  SetProperty(isolate, output, "family", ViewToString(isolate, face.family));
+  SetProperty(isolate, output, "style", ViewToString(isolate, face.style));
+  SetProperty(isolate, output, "weight", Number::New(isolate, face.weight));
+  SetProperty(isolate, output, "width", Number::New(isolate, face.width));
+  SetProperty(isolate, output, "italic", Boolean::New(isolate, face.italic));
+  SetProperty(isolate, output, "monospace", Boolean::New(isolate, face.monospace));
+
+  return output;
+}
+
+FontQuery ReadQuery(Isolate* isolate, Local<Value> value) {
+  FontQuery query;
+
+  if (!value->IsObject()) return query;
+
+  Local<Object> object = value.As<Object>();
+  auto readString = [&](const char* key, std::string* target) {
+    Local<Value> field = GetProperty(isolate, object, key);
+
+    if (field->IsString()) *target = ToStdString(isolate, field);
+  };
+  auto readFlag = [&](const char* key, int* target) {
+    Local<Value> field = GetProperty(isolate, object, key);
+
+    if (field->IsBoolean()) *target = field->IsTrue() ? 1 : 0;
+  };
+
+  readString("family", &query.family);
+  readString("style", &query.style);
+  readString("postscriptName", &query.postscriptName);
+  query.weight = static_cast<int>(GetNumberOption(isolate, value, "weight", -1));
+  query.width = static_cast<int>(GetNumberOption(isolate, value, "width", -1));
+  readFlag("italic", &query.italic);
+  readFlag("monospace", &query.monospace);
+
+  return query;
+}
+
+// list() => FontDescriptor[], sorted by family and style.
+void ListFontsMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  const FontIndex* index = GetIndex(args, "list");
+
+  if (!index) return;
+
+  Local<Array> output = Array::New(isolate, static_cast<int>(index->FaceCount()));
+
+  for (uint32_t i = 0; i < index->FaceCount(); i += 1) {
+    output->Set(context, i, FaceToObject(isolate, index->Face(i))).Check();
+  }
+  args.GetReturnValue().Set(output);
+}
+
+// findFonts(query) => FontDescriptor[]: the faces of query.family matching every other field given.
+void FindFontsMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  const FontIndex* index = GetIndex(args, "findFonts");
+
+  if (!index) return;
+
+  std::vector<uint32_t> matches = index->FindAll(ReadQuery(isolate, args[0]));
+  Local<Array> output = Array::New(isolate, static_cast<int>(matches.size()));
+
+  for (uint32_t i = 0; i < matches.size(); i += 1) {
+    output->Set(context, i, FaceToObject(isolate, index->Face(matches[i]))).Check();
+  }
+  args.GetReturnValue().Set(output);
+}
+
+// findFont(query) => FontDescriptor | undefined
+// An exact postscriptName match, else the first face of query.family narrowed by italic, style (default "Regular")
+// and weight while anything still matches; an unknown family gives the first face of the index.
+void FindFontMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  const FontIndex* index = GetIndex(args, "findFont");
+
+  if (!index) return;
+
+  int64_t found = index->FindBest(ReadQuery(isolate, args[0]));
+
+  if (found >= 0) args.GetReturnValue().Set(FaceToObject(isolate, index->Face(static_cast<uint32_t>(found))));
+}
+
+class OpenFontIndexTask : public AsyncTask {
+ public:
+  OpenFontIndexTask(std::vector<std::string> directories, std::string cachePath)
+      : directories_(std::move(directories)), cachePath_(std::move(cachePath)), index_(new FontIndex()) {}
+
+ protected:
+  void Execute() override {
+    if (!index_->Build(directories_, cachePath_, &warning_)) error_ = "font index could not be built";
+  }
+
+  Local<Value> Result(Isolate* isolate) override {
+    Local<v8::Context> context = isolate->GetCurrentContext();
+    Local<ObjectTemplate> objectTemplate = ObjectTemplate::New(isolate);
+
+    objectTemplate->SetInternalFieldCount(2);
+
+    Local<Object> object = objectTemplate->NewInstance(context).ToLocalChecked();
+    FontIndexHandle* handle = new FontIndexHandle();
+
+    SetProperty(isolate, object, "count", Number::New(isolate, index_->FaceCount()));
+    SetProperty(isolate, object, "fromCache", Boolean::New(isolate, index_->FromCache()));
+    if (!warning_.empty()) SetProperty(isolate, object, "warning", NewString(isolate, warning_.c_str()));
+    handle->index = std::move(index_);
+    handle->memory = static_cast<int64_t>(handle->index->MemoryUsage());
+    handle->object.Reset(isolate, object);
+    handle->object.SetWeak(handle, FontIndexHandle::OnCollected, v8::WeakCallbackType::kParameter);
+    isolate->AdjustAmountOfExternalAllocatedMemory(handle->memory);
+    object->SetAlignedPointerInInternalField(0, handle);
+    object->SetAlignedPointerInInternalField(1, &kFontIndexTag);
+    NODE_SET_METHOD(object, "list", ListFontsMethod);
+    NODE_SET_METHOD(object, "findFont", FindFontMethod);
+    NODE_SET_METHOD(object, "findFonts", FindFontsMethod);
+
+    return object;
+  }
+
+ private:
+  std::vector<std::string> directories_;
+  std::string cachePath_;
+  std::unique_ptr<FontIndex> index_;
+  std::string warning_;
+};
+
+// Reads a slot of generateVariableBatch; returns what is wrong with it, or an empty string.
+std::string ReadSlot(Isolate* isolate, Local<Value> value, VariableSlot* slot) {
+  Local<v8::Context> context = isolate->GetCurrentContext();
+
+  if (!value->IsObject()) return "must be an object";
+
+  Local<Object> object = value.As<Object>();
+  Local<Value> content = GetProperty(isolate, object, "content");
+  Local<Value> code = GetProperty(isolate, object, "code");
+  Local<Value> matrix = GetProperty(isolate, object, "matrix");
+  double type = GetNumberOption(isolate, value, "type", 0);
+
+  if (!content->IsString()) return "content must be a string";
+  if (type != 0 && type != 1 && type != 2 && type != 3) return "type must be a VariableTextType";
+  slot->source = static_cast<SlotSource>(static_cast<int>(type));
+  slot->content = ToUtf8(isolate, content.As<String>());
+  slot->offset = static_cast<int64_t>(GetNumberOption(isolate, value, "offset", 0));
+  slot->invert = GetBooleanOption(isolate, value, "invert", false);
+  if (matrix->IsArray() && matrix.As<Array>()->Length() == 6) {
+    for (uint32_t i = 0; i < 6; i += 1) {
+      Local<Value> item;
+
+      if (!matrix.As<Array>()->Get(context, i).ToLocal(&item) || !item->IsNumber() ||
+          !std::isfinite(item.As<Number>()->Value())) {
+        return "matrix must hold 6 finite numbers";
+      }
+      slot->matrix[i] = item.As<Number>()->Value();
+    }
+  } else if (!matrix->IsUndefined()) {
+    return "matrix must hold 6 finite numbers";
+  }
+
+  std::string kind = code->IsString() ? ToStdString(isolate, code) : "text";
+
+  if (kind == "text") {
+    FontHandle* handle = UnwrapFont(GetProperty(isolate, object, "font"));
+    Local<Value> align = GetProperty(isolate, object, "align");
+    std::string alignment = align->IsString() ? ToStdString(isolate, align) : "start";
+
+    if (!handle) return "font must be a Font";
+    slot->code = SlotCode::kText;
+    slot->font = handle->font.get();
+    slot->shaper = handle->shaper.get();
+    slot->fontSize = GetNumberOption(isolate, value, "fontSize", kDefaultFontSize);
+    slot->letterSpacing = GetNumberOption(isolate, value, "letterSpacing", 0);
+    slot->lineSpacing = GetNumberOption(isolate, value, "lineSpacing", 1);
+    slot->layout = ReadLayoutOptions(isolate, value);
+    if (!std::isfinite(slot->fontSize) || !std::isfinite(slot->letterSpacing) || !std::isfinite(slot->lineSpacing)) {
+      return "fontSize, letterSpacing and lineSpacing must be finite";
+    }
+    if (alignment == "start") {
+      slot->align = TextAlign::kStart;
+    } else if (alignment == "middle") {
+      slot->align = TextAlign::kMiddle;
+    } else if (alignment == "end") {
+      slot->align = TextAlign::kEnd;
+    } else {
+      return "align must be start, middle or end";
+    }
+  } else if (kind == "qrcode") {
+    Local<Value> level = GetProperty(isolate, object, "errorLevel");
+    std::string name = level->IsString() ? ToStdString(isolate, level) : "L";
+    double margin = GetNumberOption(isolate, value, "margin", 0);
+    const char* levels[] = {"L", "M", "Q", "H"};
+    auto found = std::find(std::begin(levels), std::end(levels), name);
+
+    if (found == std::end(levels)) return "errorLevel must be L, M, Q or H";
+    if (!(margin >= 0 && margin <= 100) || margin != std::floor(margin)) {
+      return "margin must be an integer module count";
+    }
+    slot->code = SlotCode::kQrCode;
+    slot->errorLevel = static_cast<QrErrorCorrection>(found - std::begin(levels));
+    slot->margin = static_cast<int>(margin);
+  } else if (kind == "barcode") {
+    Local<Value> format = GetProperty(isolate, object, "format");
+    std::string name = format->IsString() ? ToStdString(isolate, format) : "CODE128";
+
+    if (name == "CODE128") {
+      slot->barcodeSet = Code128Set::kAuto;
+    } else if (name == "CODE128A") {
+      slot->barcodeSet = Code128Set::kA;
+    } else if (name == "CODE128B") {
+      slot->barcodeSet = Code128Set::kB;
+    } else if (name == "CODE128C") {
+      slot->barcodeSet = Code128Set::kC;
+    } else {
+      return "format must be CODE128, CODE128A, CODE128B or CODE128C";
+    }
+    slot->code = SlotCode::kBarcode;
+    slot->barWidth = GetNumberOption(isolate, value, "width", slot->barWidth);
+    slot->barHeight = GetNumberOption(isolate, value, "height", slot->barHeight);
+    slot->barMargin = GetNumberOption(isolate, value, "margin", slot->barMargin);
+    if (!(slot->barWidth > 0) || !std::isfinite(slot->barWidth) || !(slot->barHeight >= 0) ||
+        !std::isfinite(slot->barHeight) || !(slot->barMargin >= 0) || !std::isfinite(slot->barMargin)) {
+      return "width, height and margin must be finite and not negative";
+    }
+  } else {
+    return "code must be text, qrcode or barcode";
+  }
+
+  return "";
+}
+
+// Reads the production run options of generateVariableBatch; returns what is wrong with them, or an empty string.
+std::string ReadRun(Isolate* isolate, Local<Value> options, VariableRun* run) {
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  double count = GetNumberOption(isolate, options, "count", 1);
+  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+  double time = GetNumberOption(isolate, options, "time", static_cast<double>(now.count()));
+  double numbers[4] = {
+      GetNumberOption(isolate, options, "start", static_cast<double>(run->start)),
+      GetNumberOption(isolate, options, "end", static_cast<double>(run->end)),
+      GetNumberOption(isolate, options, "current", static_cast<double>(run->current)),
+      GetNumberOption(isolate, options, "advanceBy", static_cast<double>(run->advanceBy)),
+  };
+
+  if (!(count >= 0 && count <= kMaxPieces) || count != std::floor(count)) return "count must be an integer";
+  for (double number : numbers) {
+    if (!(std::fabs(number) <= kMaxSerial) || number != std::floor(number)) {
+      return "start, end, current and advanceBy must be integers";
+    }
+  }
+  if (!std::isfinite(time)) return "time must be finite";
+  run->count = static_cast<size_t>(count);
+  run->start = static_cast<int64_t>(numbers[0]);
+  run->end = static_cast<int64_t>(numbers[1]);
+  run->current = static_cast<int64_t>(numbers[2]);
+  run->advanceBy = static_cast<int64_t>(numbers[3]);
+  run->time = static_cast<int64_t>(time);
+  run->utcOffset = static_cast<int>(GetNumberOption(isolate, options, "utcOffset", LocalUtcOffset(run->time)));
+
+  if (!options->IsObject()) return "";
+
+  Local<Value> csv = GetProperty(isolate, options.As<Object>(), "csv");
+  Local<Value> locale = GetProperty(isolate, options.As<Object>(), "locale");
+
+  if (csv->IsArray()) {
+    Local<Array> rows = csv.As<Array>();
+
+    run->csv.resize(rows->Length());
+    for (uint32_t i = 0; i < rows->Length(); i += 1) {
+      Local<Value> row;
+
+      if (!rows->Get(context, i).ToLocal(&row) || !row->IsArray()) continue;
+      run->csv[i].resize(row.As<Array>()->Length());
+      for (uint32_t k = 0; k < row.As<Array>()->Length(); k += 1) {
+        Local<Value> cell;
+
+        // Missing cells read as empty, like the editor's `|| ''`.
+        if (row.As<Array>()->Get(context, k).ToLocal(&cell) && cell->IsString()) {
+          run->csv[i][k] = ToUtf8(isolate, cell.As<String>());
+        }
+      }
+    }
+  } else if (!csv->IsUndefined()) {
+    return "csv must be an array of rows";
+  }
+  if (locale->IsObject()) {
+    const char* keys[] = {"months", "monthsShort", "weekdays", "weekdaysShort", "weekdaysMin"};
+    std::vector<std::string>* lists[] = {&run->locale.months, &run->locale.monthsShort, &run->locale.weekdays,
+                                         &run->locale.weekdaysShort, &run->locale.weekdaysMin};
+
+    for (size_t i = 0; i < 5; i += 1) {
+      Local<Value> names = GetProperty(isolate, locale.As<Object>(), keys[i]);
+
+      // Missing short names are cut from the long ones, as dayjs does.
+      lists[i]->clear();
+      if (names->IsUndefined()) continue;
+      if (!names->IsArray()) return std::string("locale.") + keys[i] + " must be an array of strings";
+      lists[i]->clear();
+      for (uint32_t k = 0; k < names.As<Array>()->Length(); k += 1) {
+        Local<Value> name;
+
+        if (!names.As<Array>()->Get(context, k).ToLocal(&name) || !name->IsString()) {
+          return std::string("locale.") + keys[i] + " must be an array of strings";
+        }
+        lists[i]->push_back(ToUtf8(isolate, name.As<String>()));
+      }
+    }
+  }
+
+  return "";
+}
+
+}  // namespace
+
+// openFontIndex(options?) => Promise<FontIndex>
+// Scans font directories on the thread pool, reading only the naming and style tables of each face. options:
+// directories (default: the platform's system and user font directories) and cachePath, an index file reused while
+// the directories' modification times are unchanged; changed directories are rescanned and the file rewritten. The
+// FontIndex has count, fromCache, warning (set when the cache could not be saved) and the methods list, findFont and
+// findFonts, which answer from hash tables without rescanning.
+void OpenFontIndexMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  std::vector<std::string> directories = DefaultFontDirectories();
+  std::string cachePath;
+
+  if (args[0]->IsObject()) {
+    Local<Value> list = GetProperty(isolate, args[0].As<Object>(), "directories");
+    Local<Value> cache = GetProperty(isolate, args[0].As<Object>(), "cachePath");
+
+    if (list->IsArray()) {
+      Local<Array> array = list.As<Array>();
+
+      directories.clear();
+      for (uint32_t i = 0; i < array->Length(); i += 1) {
+        Local<Value> item;
+
+        if (!array->Get(context, i).ToLocal(&item) || !item->IsString()) {
+          ThrowTypeError(isolate, "directories must be an array of strings");
+
+          return;
+        }
+        directories.push_back(ToStdString(isolate, item));
+      }
+    } else if (!list->IsUndefined()) {
+      ThrowTypeError(isolate, "directories must be an array of strings");
+
+      return;
+    }
+    if (cache->IsString()) cachePath = ToStdString(isolate, cache);
+  }
+  args.GetReturnValue().Set(AsyncTask::Queue(isolate, new OpenFontIndexTask(std::move(directories), cachePath)));
+}
+
+// loadFont(data, options?) => Font
+// Parses a TTF, OTF (CFF outlines) or TTC from a file path or an ArrayBuffer / view (copied). options.index picks the
+// face of a collection. The Font has postscriptName, familyName, subfamilyName, unitsPerEm, ascender, descender,
+// lineGap and glyphCount, and the methods layout, textToPath and glyphPath. Glyph outlines are decoded on first use
+// and kept in font units for the life of the Font, so every size reuses them.
+void LoadFontMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+  std::vector<uint8_t> data;
+  std::shared_ptr<BackingStore> store;
+  size_t offset;
+  size_t length;
+  std::string error;
+
+  if (args[0]->IsString()) {
+    MappedFile file;
+
+    if (!file.Open(ToStdString(isolate, args[0]), &error)) {
+      ThrowError(isolate, error.c_str());
+
+      return;
+    }
+    data.assign(file.Data(), file.Data() + file.Size());
+  } else if (ReadBytes(args[0], &store, &offset, &length)) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(store->Data()) + offset;
+
+    data.assign(bytes, bytes + length);
+  } else {
+    ThrowTypeError(isolate, "data must be a path, an ArrayBuffer or a view");
+
+    return;
+  }
+
+  double index = GetNumberOption(isolate, args[1], "index", 0);
+
+  if (!(index >= 0) || index != std::floor(index) || index > UINT32_MAX) {
+    ThrowTypeError(isolate, "index must be a non-negative integer");
+
+    return;
+  }
+
+  std::unique_ptr<Font> font = Font::Load(std::move(data), static_cast<uint32_t>(index), &error);
+
+  if (!font) {
+    ThrowError(isolate, error.c_str());
+
+    return;
+  }
+
+  Local<ObjectTemplate> objectTemplate = ObjectTemplate::New(isolate);
+
+  objectTemplate->SetInternalFieldCount(2);
+
+  Local<Object> object = objectTemplate->NewInstance(context).ToLocalChecked();
+  FontHandle* handle = new FontHandle();
+
+  handle->font = std::move(font);
+  handle->shaper.reset(new TextShaper(*handle->font));
+  handle->object.Reset(isolate, object);
+  handle->object.SetWeak(handle, FontHandle::OnCollected, v8::WeakCallbackType::kParameter);
+  handle->UpdateMemory(isolate);
+  object->SetAlignedPointerInInternalField(0, handle);
+  object->SetAlignedPointerInInternalField(1, &kFontTag);
+
+  const Font& loaded = *handle->font;
+
+  SetProperty(isolate, object, "postscriptName", NewString(isolate, loaded.PostscriptName().c_str()));
+  SetProperty(isolate, object, "familyName", NewString(isolate, loaded.FamilyName().c_str()));
+  SetProperty(isolate, object, "subfamilyName", NewString(isolate, loaded.SubfamilyName().c_str()));
+  SetProperty(isolate, object, "unitsPerEm", Number::New(isolate, loaded.UnitsPerEm()));
+  SetProperty(isolate, object, "ascender", Number::New(isolate, loaded.Ascender()));
+  SetProperty(isolate, object, "descender", Number::New(isolate, loaded.Descender()));
+  SetProperty(isolate, object, "lineGap", Number::New(isolate, loaded.LineGap()));
+  SetProperty(isolate, object, "glyphCount", Number::New(isolate, loaded.GlyphCount()));
+  NODE_SET_METHOD(object, "layout", LayoutMethod);
+  NODE_SET_METHOD(object, "textToPath", TextToPathMethod);
+  NODE_SET_METHOD(object, "glyphPath", GlyphPathMethod);
+  args.GetReturnValue().Set(object);
+}
+
+// generateVariableBatch(slots, options?) => { commands, coords, offsets: Uint32Array, values: string[] }
+// Generates a production run of variable text without touching the DOM: every slot is evaluated for options.count
+// pieces, as convertVariableText would for each, and drawn natively. A slot has content and type (VariableTextType:
+// 0 fixed, 1 serial number, 2 time, 3 CSV), offset (data-vt-offset), matrix ([a, b, c, d, e, f] placing its local
+// geometry) and code, one of
+//   text (default): font (a Font), fontSize, letterSpacing, lineSpacing (default 1), align (start, middle or end),
+//     kerning and ligatures; lines split at U+0085 with the first baseline at the origin;
+//   qrcode: errorLevel (L, M, Q or H), margin in modules (default 0) and invert; one unit per module;
+//   barcode: format (CODE128, CODE128A, CODE128B or CODE128C), width, height and margin as in JsBarcode, and invert.
+// options: start, end, current and advanceBy of the variable text settings, count (default 1), csv (rows of
+// strings), and time (ms since the epoch, default now) with utcOffset (minutes, default the local zone) and locale
+// (dayjs month and weekday names) for TIME slots. Pieces are built on all cores; offsets[i * slots + s] starts the
+// command range of slot s of piece i and values holds the formatted values in the same order. Throws when a value
+// does not fit its QR code or barcode.
+void GenerateVariableBatchMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+
+  if (!args[0]->IsArray()) {
+    ThrowTypeError(isolate, "slots must be an array");
+
+    return;
+  }
+
+  Local<Array> list = args[0].As<Array>();
+  std::vector<VariableSlot> slots(list->Length());
+  std::vector<FontHandle*> fonts;
+
+  for (uint32_t i = 0; i < list->Length(); i += 1) {
+    Local<Value> item;
+    std::string problem = list->Get(context, i).ToLocal(&item) ? ReadSlot(isolate, item, &slots[i]) : "is missing";
+
+    if (!problem.empty()) {
+      std::string message = "slots[" + std::to_string(i) + "]: " + problem;
+
+      ThrowTypeError(isolate, message.c_str());
+
+      return;
+    }
+    if (slots[i].code == SlotCode::kText) fonts.push_back(UnwrapFont(GetProperty(isolate, item.As<Object>(), "font")));
+  }
+
+  VariableRun run;
+  std::string problem = ReadRun(isolate, args[1], &run);
+
+  if (!problem.empty()) {
+    ThrowTypeError(isolate, problem.c_str());
+
+    return;
+  }
+
+  VariableBatch batch;
+  std::string error;
+  bool generated = GenerateVariableBatch(slots, run, &batch, &error);
+
+  for (FontHandle* handle : fonts) handle->UpdateMemory(isolate);
+  if (!generated) {
+    ThrowError(isolate, error.c_str());
+
+    return;
+  }
+
+  Local<Object> output = Object::New(isolate);
+  Local<Array> values = Array::New(isolate, static_cast<int>(batch.values.size()));
+
+  for (uint32_t i = 0; i < batch.values.size(); i += 1) {
+    values->Set(context, i, ViewToString(isolate, batch.values[i])).Check();
+  }
+  SetProperty(isolate, output, "commands", NewTypedArray<Uint8Array>(isolate, batch.path.commands));
+  SetProperty(isolate, output, "coords", NewTypedArray<Float64Array>(isolate, batch.path.coords));
+  SetProperty(isolate, output, "offsets", NewTypedArray<Uint32Array>(isolate, batch.offsets));
+  SetProperty(isolate, output, "values", values);
+  args.GetReturnValue().Set(output);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "openFontIndex", beam::OpenFontIndexMethod);
+  NODE_SET_METHOD(exports, "loadFont", beam::LoadFontMethod);
+  NODE_SET_METHOD(exports, "generateVariableBatch", beam::GenerateVariableBatchMethod);
+}
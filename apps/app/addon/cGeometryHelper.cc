@@ -0,0 +1,439 @@
+// Native geometry kernels for path editing, tracing and framing.
+#include <node.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/bezier-fit.h"
+#include "src/flatten.h"
+#include "src/node-utils.h"
+#include "src/parallel.h"
+#include "src/path-buffer.h"
+#include "src/path-hull.h"
+#include "src/simplify.h"
+#include "src/svg-path.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::BackingStore;
+using v8::Float64Array;
+using v8::FunctionCallbackInfo;
+using v8::Number;
+using v8::Uint32Array;
+using v8::Uint8Array;
+
+namespace {
+
+Local<Object> PolylinesToObject(Isolate* isolate, const Polylines& polylines) {
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "points", NewTypedArray<Float64Array>(isolate, polylines.points));
+  SetProperty(isolate, output, "offsets", NewTypedArray<Uint32Array>(isolate, polylines.offsets));
+  SetProperty(isolate, output, "closed", NewTypedArray<Uint8Array>(isolate, polylines.closed));
+
+  return output;
+}
+
+// options.matrix: [a, b, c, d, e, f] as an Array or Float64Array; leaves `matrix` alone when missing.
+bool ReadMatrix(Isolate* isolate, Local<Value> options, double* matrix) {
+  if (!options->IsObject()) return true;
+
+  Local<Value> value = GetProperty(isolate, options.As<Object>(), "matrix");
+
+  if (value->IsUndefined()) return true;
+  if (value->IsFloat64Array() && value.As<Float64Array>()->Length() == 6) {
+    const double* data = TypedArrayData<double>(value.As<Float64Array>());
+
+    std::copy(data, data + 6, matrix);
+  } else if (value->IsArray() && value.As<Array>()->Length() == 6) {
+    Local<Context> context = isolate->GetCurrentContext();
+
+    for (uint32_t i = 0; i < 6; i += 1) {
+      Local<Value> element = value.As<Array>()->Get(context, i).ToLocalChecked();
+
+      matrix[i] = element->IsNumber() ? element.As<Number>()->Value() : NAN;
+    }
+  } else {
+    matrix[0] = NAN;
+  }
+  for (int i = 0; i < 6; i += 1) {
+    if (!std::isfinite(matrix[i])) {
+      ThrowTypeError(isolate, "matrix must be 6 finite numbers");
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+// fitPath(points: Float64Array, offsets?: Uint32Array, options?) => { segments: Float64Array, offsets: Uint32Array }
+// points holds xy pairs, offsets splits them into independent subpaths which are fitted in parallel.
+// options: maxIterations, angleThreshold, allowedDistFactor, minAllowedDist, totalDist (number or Float64Array per
+// subpath, same meaning as the totalDist argument of bezier-fit-curve fitPath).
+// segments is packed with kFitSegmentStride doubles per segment, the returned offsets index segments per subpath.
+void FitPathMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "points must be a Float64Array");
+
+    return;
+  }
+
+  Local<Float64Array> points = args[0].As<Float64Array>();
+  const double* xy = TypedArrayData<double>(points);
+  size_t pointCount = points->Length() / 2;
+  std::vector<uint32_t> offsets;
+
+  if (!ReadOffsets(isolate, args[1], pointCount, offsets)) return;
+
+  Local<Value> options = args[2];
+  BezierFitOptions fitOptions;
+
+  fitOptions.maxIterations = static_cast<int>(GetNumberOption(isolate, options, "maxIterations", 4));
+  fitOptions.angleThreshold = GetNumberOption(isolate, options, "angleThreshold", fitOptions.angleThreshold);
+  fitOptions.allowedDistFactor = GetNumberOption(isolate, options, "allowedDistFactor", fitOptions.allowedDistFactor);
+  fitOptions.minAllowedDist = GetNumberOption(isolate, options, "minAllowedDist", fitOptions.minAllowedDist);
+
+  size_t subpathCount = offsets.size() - 1;
+  std::vector<double> totalDists(subpathCount, NAN);
+
+  if (options->IsObject()) {
+    Local<Value> totalDist = GetProperty(isolate, options.As<Object>(), "totalDist");
+
+    if (totalDist->IsNumber()) {
+      totalDists.assign(subpathCount, totalDist.As<v8::Number>()->Value());
+    } else if (totalDist->IsFloat64Array()) {
+      Local<Float64Array> array = totalDist.As<Float64Array>();
+      const double* data = TypedArrayData<double>(array);
+
+      for (size_t i = 0; i < subpathCount && i < array->Length(); i += 1) totalDists[i] = data[i];
+    }
+  }
+
+  std::vector<std::vector<double>> results(subpathCount);
+
+  ParallelFor(subpathCount, [&](size_t i) {
+    FitPath(xy + 2 * static_cast<size_t>(offsets[i]), offsets[i + 1] - offsets[i], totalDists[i], fitOptions,
+            results[i]);
+  });
+
+  std::vector<uint32_t> segmentOffsets(subpathCount + 1, 0);
+  size_t total = 0;
+
+  for (size_t i = 0; i < subpathCount; i += 1) {
+    total += results[i].size();
+    segmentOffsets[i + 1] = static_cast<uint32_t>(total / kFitSegmentStride);
+  }
+
+  Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, total * sizeof(double));
+  double* cursor = reinterpret_cast<double*>(ArrayBufferData(buffer));
+
+  for (const std::vector<double>& result : results) {
+    std::copy(result.begin(), result.end(), cursor);
+    cursor += result.size();
+  }
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "segments", Float64Array::New(buffer, 0, total));
+  SetProperty(isolate, output, "offsets", NewTypedArray<Uint32Array>(isolate, segmentOffsets));
+  args.GetReturnValue().Set(output);
+}
+
+// flattenPath(commands: Uint8Array, coords: Float64Array, options?) => { points, offsets, closed }
+// Flattens a packed path (path-buffer.h command codes) so that every chord stays within options.tolerance
+// (default 0.1) of the curve. Subpaths are flattened in parallel; closed[i] is 1 when subpath i ended with Z.
+void FlattenPathMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsUint8Array() || !args[1]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "commands must be a Uint8Array and coords a Float64Array");
+
+    return;
+  }
+
+  Local<Uint8Array> commandArray = args[0].As<Uint8Array>();
+  Local<Float64Array> coordArray = args[1].As<Float64Array>();
+  const uint8_t* commands = TypedArrayData<uint8_t>(commandArray);
+  const double* coords = TypedArrayData<double>(coordArray);
+  size_t commandCount = commandArray->Length();
+  double tolerance = GetNumberOption(isolate, args[2], "tolerance", 0.1);
+
+  if (!IsValidPathBuffer(commands, commandCount, coordArray->Length())) {
+    ThrowTypeError(isolate, "coords do not match commands");
+
+    return;
+  }
+  if (!(tolerance > 0)) {
+    ThrowTypeError(isolate, "tolerance must be positive");
+
+    return;
+  }
+
+  // Every moveTo starts an independent job.
+  std::vector<size_t> commandStarts;
+  std::vector<size_t> coordStarts;
+  size_t coordIndex = 0;
+
+  for (size_t i = 0; i < commandCount; i += 1) {
+    if (commands[i] == kMoveTo || i == 0) {
+      commandStarts.push_back(i);
+      coordStarts.push_back(coordIndex);
+    }
+    coordIndex += kPathCommandArity[commands[i]];
+  }
+  commandStarts.push_back(commandCount);
+
+  std::vector<Polylines> results(coordStarts.size());
+
+  ParallelFor(results.size(), [&](size_t i) {
+    FlattenPath(commands + commandStarts[i], commandStarts[i + 1] - commandStarts[i], coords + coordStarts[i],
+                tolerance, results[i]);
+  });
+
+  Polylines merged;
+
+  for (const Polylines& result : results) AppendPolylines(merged, result);
+  args.GetReturnValue().Set(PolylinesToObject(isolate, merged));
+}
+
+// simplifyPolyline(points: Float64Array, offsets?: Uint32Array, options?) => { points, offsets }
+// options.method is 'rdp' (default, options.tolerance is a distance, default 1) or 'visvalingam'
+// (options.tolerance is the minimum triangle area to keep). The first and last point of every run are kept.
+void SimplifyPolylineMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "points must be a Float64Array");
+
+    return;
+  }
+
+  Local<Float64Array> points = args[0].As<Float64Array>();
+  const double* xy = TypedArrayData<double>(points);
+  std::vector<uint32_t> offsets;
+
+  if (!ReadOffsets(isolate, args[1], points->Length() / 2, offsets)) return;
+
+  Local<Value> options = args[2];
+  double tolerance = GetNumberOption(isolate, options, "tolerance", 1);
+  bool visvalingam = false;
+
+  if (options->IsObject()) {
+    Local<Value> method = GetProperty(isolate, options.As<Object>(), "method");
+
+    visvalingam = method->IsString() && ToStdString(isolate, method) == "visvalingam";
+  }
+
+  size_t subpathCount = offsets.size() - 1;
+  std::vector<std::vector<double>> results(subpathCount);
+
+  ParallelFor(subpathCount, [&](size_t i) {
+    const double* start = xy + 2 * static_cast<size_t>(offsets[i]);
+    size_t count = offsets[i + 1] - offsets[i];
+
+    if (visvalingam) {
+      SimplifyVisvalingam(start, count, tolerance, results[i]);
+    } else {
+      SimplifyRdp(start, count, tolerance, results[i]);
+    }
+  });
+
+  Polylines merged;
+
+  for (const std::vector<double>& result : results) {
+    merged.points.insert(merged.points.end(), result.begin(), result.end());
+    merged.offsets.push_back(static_cast<uint32_t>(merged.PointCount()));
+  }
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "points", NewTypedArray<Float64Array>(isolate, merged.points));
+  SetProperty(isolate, output, "offsets", NewTypedArray<Uint32Array>(isolate, merged.offsets));
+  args.GetReturnValue().Set(output);
+}
+
+// parsePath(d: string | ArrayBuffer | view, options?) => { commands: Uint8Array, coords: Float64Array, errorOffset? }
+// Normalizes SVG path data to a packed path (path-buffer.h command codes) with absolute coordinates, H/V as lines and
+// S/T with explicit control points. options: matrix ([a, b, c, d, e, f], baked into the coordinates), keepArcs
+// (default false: arcs become cubics). On a syntax error the segments before it are returned, as SVG draws them,
+// with errorOffset set to the position of the error.
+void ParsePathMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  std::string text;
+  std::shared_ptr<BackingStore> store;
+  const char* data;
+  size_t offset;
+  size_t length;
+
+  if (args[0]->IsString()) {
+    text = ToUtf8(isolate, args[0].As<String>());
+    data = text.data();
+    length = text.size();
+  } else if (ReadBytes(args[0], &store, &offset, &length)) {
+    data = static_cast<const char*>(store->Data()) + offset;
+  } else {
+    ThrowTypeError(isolate, "d must be a string, an ArrayBuffer or a view");
+
+    return;
+  }
+
+  SvgPathParseOptions options;
+
+  if (!ReadMatrix(isolate, args[1], options.matrix)) return;
+  options.arcsToCubics = !GetBooleanOption(isolate, args[1], "keepArcs", false);
+
+  PathBuffer path;
+  size_t errorOffset;
+  bool ok = ParseSvgPath(data, length, options, &path, &errorOffset);
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "commands", NewTypedArray<Uint8Array>(isolate, path.commands));
+  SetProperty(isolate, output, "coords", NewTypedArray<Float64Array>(isolate, path.coords));
+  if (!ok) SetProperty(isolate, output, "errorOffset", Number::New(isolate, static_cast<double>(errorOffset)));
+  args.GetReturnValue().Set(output);
+}
+
+// serializePath(commands: Uint8Array, coords: Float64Array, options?) => string
+// Writes a packed path as SVG path data in svgedit's convertPath form ("M1,2L3,4z"). options: precision (digits after
+// the decimal point, default 5, trailing zeros dropped), relative (default false: lowercase relative commands).
+void SerializePathMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsUint8Array() || !args[1]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "commands must be a Uint8Array and coords a Float64Array");
+
+    return;
+  }
+
+  Local<Uint8Array> commandArray = args[0].As<Uint8Array>();
+  Local<Float64Array> coordArray = args[1].As<Float64Array>();
+  const uint8_t* commands = TypedArrayData<uint8_t>(commandArray);
+  size_t commandCount = commandArray->Length();
+
+  if (!IsValidPathBuffer(commands, commandCount, coordArray->Length())) {
+    ThrowTypeError(isolate, "coords do not match commands");
+
+    return;
+  }
+
+  SvgPathWriteOptions options;
+  double precision = GetNumberOption(isolate, args[2], "precision", options.precision);
+
+  if (!(precision >= 0 && precision <= 20)) {
+    ThrowTypeError(isolate, "precision must be between 0 and 20");
+
+    return;
+  }
+  options.precision = static_cast<int>(precision);
+  options.relative = GetBooleanOption(isolate, args[2], "relative", options.relative);
+
+  std::string d;
+
+  WriteSvgPath(commands, commandCount, TypedArrayData<double>(coordArray), options, &d);
+  Local<String> output;
+
+  if (d.size() > static_cast<size_t>(String::kMaxLength) ||
+      !String::NewFromOneByte(isolate, reinterpret_cast<const uint8_t*>(d.data()), v8::NewStringType::kNormal,
+                              static_cast<int>(d.size()))
+           .ToLocal(&output)) {
+    ThrowError(isolate, "path data is too long for a string");
+
+    return;
+  }
+  args.GetReturnValue().Set(output);
+}
+
+// framingHull(commands: Uint8Array, coords: Float64Array, options?) => { points: Float64Array, outOfBounds: boolean }
+// The hull framing traces around a job, computed from the packed path (path-buffer.h command codes) of everything it
+// engraves instead of from a render. options: width and height (the workarea the job is cropped to, default
+// unbounded), top (the workarea's minY; geometry between it and y = 0 sets outOfBounds, default 0), strokeWidth
+// (default 0), tolerance (chord tolerance for curves, default 0.25) and scale (points are divided by it, e.g. dpmm).
+// points is the convex hull in ConvexHull order (polygon.h) without a repeated first point, empty when nothing shows.
+void FramingHullMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsUint8Array() || !args[1]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "commands must be a Uint8Array and coords a Float64Array");
+
+    return;
+  }
+
+  Local<Uint8Array> commandArray = args[0].As<Uint8Array>();
+  Local<Float64Array> coordArray = args[1].As<Float64Array>();
+  const uint8_t* commands = TypedArrayData<uint8_t>(commandArray);
+  size_t commandCount = commandArray->Length();
+
+  if (!IsValidPathBuffer(commands, commandCount, coordArray->Length())) {
+    ThrowTypeError(isolate, "coords do not match commands");
+
+    return;
+  }
+
+  Local<Value> options = args[2];
+  double width = GetNumberOption(isolate, options, "width", INFINITY);
+  double height = GetNumberOption(isolate, options, "height", INFINITY);
+  double top = GetNumberOption(isolate, options, "top", 0);
+  double strokeWidth = GetNumberOption(isolate, options, "strokeWidth", 0);
+  double tolerance = GetNumberOption(isolate, options, "tolerance", 0.25);
+  double scale = GetNumberOption(isolate, options, "scale", 1);
+
+  if (!(width >= 0 && height >= 0 && top <= 0 && strokeWidth >= 0)) {
+    ThrowTypeError(isolate, "width, height and strokeWidth must not be negative, nor top positive");
+
+    return;
+  }
+  if (!(tolerance > 0) || !(scale > 0)) {
+    ThrowTypeError(isolate, "tolerance and scale must be positive");
+
+    return;
+  }
+
+  const double* coords = TypedArrayData<double>(coordArray);
+  PathHullOptions hullOptions;
+  Polygon hull;
+  bool outOfBounds = false;
+
+  hullOptions.strokeWidth = strokeWidth;
+  hullOptions.tolerance = tolerance;
+  if (top < 0) {
+    hullOptions.window = Bounds{0, top, width, 0};
+    PathWindowHull(commands, commandCount, coords, hullOptions, hull);
+    outOfBounds = std::any_of(hull.begin(), hull.end(), [](Vec2 p) { return p.y < 0; });
+  }
+  hullOptions.window = Bounds{0, 0, width, height};
+  PathWindowHull(commands, commandCount, coords, hullOptions, hull);
+
+  std::vector<double> points;
+
+  points.reserve(2 * hull.size());
+  for (Vec2 p : hull) {
+    points.push_back(p.x / scale);
+    points.push_back(p.y / scale);
+  }
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "points", NewTypedArray<Float64Array>(isolate, points));
+  SetProperty(isolate, output, "outOfBounds", v8::Boolean::New(isolate, outOfBounds));
+  args.GetReturnValue().Set(output);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "fitPath", beam::FitPathMethod);
+  NODE_SET_METHOD(exports, "flattenPath", beam::FlattenPathMethod);
+  NODE_SET_METHOD(exports, "simplifyPolyline", beam::SimplifyPolylineMethod);
+  NODE_SET_METHOD(exports, "parsePath", beam::ParsePathMethod);
+  NODE_SET_METHOD(exports, "serializePath", beam::SerializePathMethod);
+  NODE_SET_METHOD(exports, "framingHull", beam::FramingHullMethod);
+}
@@ -0,0 +1,213 @@
+// Native camera frame handling: checks JPEG frames without loading them into an Image and crops or rotates them on
+// the thread pool, in the DCT domain when the geometry allows it, instead of a canvas draw and re-encode per frame.
+#include <node.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/async-task.h"
+#include "src/jpeg-codec.h"
+#include "src/jpeg-transform.h"
+#include "src/node-utils.h"
+
+namespace beam {
+
+using v8::BackingStore;
+using v8::FunctionCallbackInfo;
+using v8::Number;
+using v8::Uint8Array;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Milliseconds(Clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+bool ReadJpegBytes(Isolate* isolate, Local<Value> value, std::shared_ptr<BackingStore>* store, const uint8_t** data,
+                   size_t* size) {
+  size_t offset;
+
+  if (!ReadBytes(value, store, &offset, size)) {
+    ThrowTypeError(isolate, "jpeg must be an ArrayBuffer or a view");
+
+    return false;
+  }
+  *data = static_cast<const uint8_t*>((*store)->Data()) + offset;
+
+  return true;
+}
+
+// Reads a non-negative integer field; missing fields keep `fallback`.
+bool GetIntegerOption(Isolate* isolate, Local<Value> options, const char* key, int fallback, int* value) {
+  double number = GetNumberOption(isolate, options, key, fallback);
+
+  if (!(number >= 0) || number > INT32_MAX || std::floor(number) != number) return false;
+  *value = static_cast<int>(number);
+
+  return true;
+}
+
+bool ReadTransform(Isolate* isolate, Local<Value> options, JpegTransform* transform) {
+  if (options->IsUndefined()) return true;
+  if (!options->IsObject()) {
+    ThrowTypeError(isolate, "options must be an object");
+
+    return false;
+  }
+
+  double rotate = GetNumberOption(isolate, options, "rotate", 0);
+  Local<Value> crop = GetProperty(isolate, options.As<Object>(), "crop");
+
+  if (!GetIntegerOption(isolate, options, "scale", 1, &transform->scale) ||
+      (transform->scale != 1 && transform->scale != 2 && transform->scale != 4 && transform->scale != 8)) {
+    ThrowTypeError(isolate, "scale must be 1, 2, 4 or 8");
+
+    return false;
+  }
+  if (std::fmod(rotate, 90) != 0) {
+    ThrowTypeError(isolate, "rotate must be a multiple of 90");
+
+    return false;
+  }
+  transform->rotate = static_cast<int>(std::fmod(std::fmod(rotate, 360) + 360, 360));
+  if (crop->IsUndefined() || crop->IsNull()) return true;
+  if (!crop->IsObject() || !GetIntegerOption(isolate, crop, "x", -1, &transform->cropX) ||
+      !GetIntegerOption(isolate, crop, "y", -1, &transform->cropY) ||
+      !GetIntegerOption(isolate, crop, "width", 0, &transform->cropWidth) ||
+      !GetIntegerOption(isolate, crop, "height", 0, &transform->cropHeight) || transform->cropWidth == 0 ||
+      transform->cropHeight == 0) {
+    ThrowTypeError(isolate, "crop must be { x, y, width, height } in whole pixels");
+
+    return false;
+  }
+
+  return true;
+}
+
+class ProcessJpegTask : public AsyncTask {
+ public:
+  ProcessJpegTask(std::shared_ptr<BackingStore> store, const uint8_t* data, size_t size, JpegTransform transform)
+      : store_(std::move(store)), data_(data), size_(size), transform_(transform) {}
+
+ protected:
+  void Execute() override {
+    Clock::time_point start = Clock::now();
+    JpegImage source;
+    JpegImage result;
+
+    if (!DecodeJpeg(data_, size_, &source, &error_)) return;
+    decodeMs_ = Milliseconds(start);
+
+    int width;
+    int height;
+
+    RotatedSize(source, transform_, &width, &height);
+    if (transform_.cropWidth > 0 &&
+        (transform_.cropX + transform_.cropWidth > width || transform_.cropY + transform_.cropHeight > height)) {
+      error_ = "crop is outside the frame";
+
+      return;
+    }
+    start = Clock::now();
+    lossless_ = IsLosslessTransform(source, transform_);
+    if (lossless_) {
+      TransformCoefficients(source, transform_, &result);
+    } else {
+      TransformSamples(source, transform_, &result);
+    }
+    transformMs_ = Milliseconds(start);
+    start = Clock::now();
+    EncodeJpeg(result, &output_);
+    encodeMs_ = Milliseconds(start);
+    width_ = result.width;
+    height_ = result.height;
+  }
+
+  Local<Value> Result(Isolate* isolate) override {
+    Local<Object> output = Object::New(isolate);
+
+    SetProperty(isolate, output, "jpeg", NewTypedArray<Uint8Array>(isolate, output_));
+    SetProperty(isolate, output, "width", Number::New(isolate, width_));
+    SetProperty(isolate, output, "height", Number::New(isolate, height_));
+    SetProperty(isolate, output, "lossless", v8::Boolean::New(isolate, lossless_));
+    SetProperty(isolate, output, "decodeMs", Number::New(isolate, decodeMs_));
+    SetProperty(isolate, output, "transformMs", Number::New(isolate, transformMs_));
+    SetProperty(isolate, output, "encodeMs", Number::New(isolate, encodeMs_));
+
+    return output;
+  }
+
+ private:
+  std::shared_ptr<BackingStore> store_;
+  const uint8_t* data_;
+  size_t size_;
+  JpegTransform transform_;
+  std::vector<uint8_t> output_;
+  int width_ = 0;
+  int height_ = 0;
+  bool lossless_ = false;
+  double decodeMs_ = 0;
+  double transformMs_ = 0;
+  double encodeMs_ = 0;
+};
+
+}  // namespace
+
+// validateJpeg(jpeg) => { width, height, components, progressive } | null
+// Checks the SOI and EOI markers and the frame header of an ArrayBuffer / view without decoding the scan, which is
+// enough to reject the cut-off or garbled frames a camera stream sometimes delivers.
+void ValidateJpegMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  std::shared_ptr<BackingStore> store;
+  const uint8_t* data;
+  size_t size;
+  JpegInfo info;
+  std::string error;
+
+  if (!ReadJpegBytes(isolate, args[0], &store, &data, &size)) return;
+  if (!ReadJpegInfo(data, size, &info, &error)) {
+    args.GetReturnValue().SetNull();
+
+    return;
+  }
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "width", Number::New(isolate, info.width));
+  SetProperty(isolate, output, "height", Number::New(isolate, info.height));
+  SetProperty(isolate, output, "components", Number::New(isolate, info.components));
+  SetProperty(isolate, output, "progressive", v8::Boolean::New(isolate, info.progressive));
+  args.GetReturnValue().Set(output);
+}
+
+// processJpeg(jpeg, { scale?, rotate?, crop?: { x, y, width, height } }?) =>
+//   Promise<{ jpeg: Uint8Array, width, height, lossless, decodeMs, transformMs, encodeMs }>
+// Downscales a baseline JPEG by `scale` (1, 2, 4 or 8), rotates it clockwise by `rotate` degrees and keeps the
+// `crop` rectangle of the result. When only whole MCUs move (no scaling, MCU-aligned crop origin and mirrored edges)
+// the coefficients are rearranged without loss (`lossless`); otherwise the frame is decoded, resampled and encoded
+// again with its own quantization tables. `jpeg` must not be modified until the promise settles. Rejects for
+// progressive or corrupt frames and crops outside the frame.
+void ProcessJpegMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  std::shared_ptr<BackingStore> store;
+  const uint8_t* data;
+  size_t size;
+  JpegTransform transform;
+
+  if (!ReadJpegBytes(isolate, args[0], &store, &data, &size) || !ReadTransform(isolate, args[1], &transform)) return;
+  args.GetReturnValue().Set(AsyncTask::Queue(isolate, new ProcessJpegTask(std::move(store), data, size, transform)));
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "validateJpeg", beam::ValidateJpegMethod);
+  NODE_SET_METHOD(exports, "processJpeg", beam::ProcessJpegMethod);
+}
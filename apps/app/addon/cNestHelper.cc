@@ -0,0 +1,270 @@
+// Native nesting: runs the genetic nesting engine on a worker thread and streams progress and improved results to JS.
+#include <node.h>
+
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "src/background-job.h"
+#include "src/nest.h"
+#include "src/node-utils.h"
+
+namespace beam {
+
+using v8::Float64Array;
+using v8::Function;
+using v8::FunctionCallbackInfo;
+using v8::Global;
+using v8::Number;
+
+namespace {
+
+constexpr size_t kPlacementStride = 5;
+
+class NestJob;
+
+std::mutex registryMutex;
+std::unordered_map<uint32_t, NestJob*> registry;
+uint32_t nextJobId = 1;
+
+Local<Object> ResultToObject(Isolate* isolate, const NestResult& result, int generation) {
+  Local<Object> output = Object::New(isolate);
+  std::vector<double> placements;
+  uint32_t bins = 0;
+
+  placements.reserve(result.placements.size() * kPlacementStride);
+  for (const NestPlacement& placement : result.placements) {
+    placements.push_back(placement.part);
+    placements.push_back(placement.bin);
+    placements.push_back(placement.x);
+    placements.push_back(placement.y);
+    placements.push_back(placement.rotation);
+    if (placement.bin + 1 > bins) bins = placement.bin + 1;
+  }
+  SetProperty(isolate, output, "placements", NewTypedArray<Float64Array>(isolate, placements));
+  SetProperty(isolate, output, "fitness", Number::New(isolate, result.fitness));
+  SetProperty(isolate, output, "generation", Number::New(isolate, generation));
+  SetProperty(isolate, output, "unplaced", Number::New(isolate, static_cast<double>(result.unplaced)));
+  SetProperty(isolate, output, "bins", Number::New(isolate, bins));
+
+  return output;
+}
+
+class NestJob : public BackgroundJob {
+ public:
+  NestJob(Isolate* isolate, uint32_t id, Polygon container, std::vector<Polygon> parts, const NestConfig& config,
+          int maxGenerations)
+      : BackgroundJob(isolate),
+        id_(id),
+        container_(std::move(container)),
+        parts_(std::move(parts)),
+        config_(config),
+        maxGenerations_(maxGenerations) {}
+  ~NestJob() override {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    registry.erase(id_);
+  }
+
+  void SetCallbacks(Isolate* isolate, Local<Value> callbacks) {
+    if (!callbacks->IsObject()) return;
+
+    Local<Object> object = callbacks.As<Object>();
+    auto read = [&](const char* key, Global<Function>& target) {
+      Local<Value> value = GetProperty(isolate, object, key);
+
+      if (value->IsFunction()) target.Reset(isolate, value.As<Function>());
+    };
+
+    read("onProgress", onProgress_);
+    read("onImprove", onImprove_);
+    read("onDone", onDone_);
+  }
+
+ protected:
+  void Run() override {
+    NestEngine engine(container_, parts_, config_);
+
+    while (!stop_ && (maxGenerations_ <= 0 || engine.Generation() < maxGenerations_)) {
+      int generation = engine.Generation();
+      bool improved = engine.Step(stop_, [this, generation](double progress) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (progress > progress_) progress_ = progress;
+        generation_ = generation;
+        Notify();
+      });
+
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      generation_ = engine.Generation();
+      progress_ = 0;
+      if (improved) {
+        best_ = engine.Best();
+        bestGeneration_ = engine.Generation();
+        hasImproved_ = true;
+      }
+      Notify();
+    }
+  }
+
+  void Deliver(Isolate* isolate, bool finished) override {
+    double progress;
+    int generation;
+    bool improved;
+    NestResult best;
+    int bestGeneration;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      progress = progress_;
+      generation = generation_;
+      improved = hasImproved_;
+      hasImproved_ = false;
+      if (improved || finished) best = best_;
+      bestGeneration = bestGeneration_;
+    }
+
+    Local<Value> progressArgs[] = {Number::New(isolate, progress), Number::New(isolate, generation)};
+
+    Call(isolate, onProgress_, 2, progressArgs);
+    if (improved) {
+      Local<Value> improveArgs[] = {ResultToObject(isolate, best, bestGeneration)};
+
+      Call(isolate, onImprove_, 1, improveArgs);
+    }
+    if (finished) {
+      Local<Value> doneArgs[] = {ResultToObject(isolate, best, bestGeneration)};
+
+      Call(isolate, onDone_, 1, doneArgs);
+    }
+  }
+
+ private:
+  uint32_t id_;
+  Polygon container_;
+  std::vector<Polygon> parts_;
+  NestConfig config_;
+  int maxGenerations_;
+  Global<Function> onProgress_;
+  Global<Function> onImprove_;
+  Global<Function> onDone_;
+
+  std::mutex mutex_;
+  double progress_ = 0;
+  int generation_ = 0;
+  NestResult best_;
+  int bestGeneration_ = 0;
+  bool hasImproved_ = false;
+};
+
+Polygon ReadPolygon(const double* xy, size_t begin, size_t end) {
+  Polygon polygon;
+
+  for (size_t i = begin; i < end; i += 1) polygon.push_back({xy[2 * i], xy[2 * i + 1]});
+
+  return polygon;
+}
+
+}  // namespace
+
+// startNest(container: Float64Array, parts: Float64Array, partOffsets?: Uint32Array, config?, callbacks?) => id
+// container and parts hold xy pairs of simple polygons, partOffsets splits parts into one polygon per part.
+// config: spacing, rotations, populationSize, mutationRate (percent), curveTolerance, seed, maxGenerations (0 runs
+// until stopNest). callbacks: onProgress(progress, generation), onImprove(result), onDone(result), where result is
+// { placements: Float64Array, fitness, generation, unplaced, bins } with kPlacementStride values per placed part:
+// [part, bin, x, y, rotation]. Rotate the part by rotation degrees around its origin, then translate by (x, y).
+void StartNestMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsFloat64Array() || !args[1]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "container and parts must be Float64Arrays");
+
+    return;
+  }
+
+  Local<Float64Array> containerArray = args[0].As<Float64Array>();
+  Local<Float64Array> partsArray = args[1].As<Float64Array>();
+  size_t partPointCount = partsArray->Length() / 2;
+  std::vector<uint32_t> offsets;
+
+  if (containerArray->Length() < 6) {
+    ThrowTypeError(isolate, "container must have at least 3 points");
+
+    return;
+  }
+  if (!ReadOffsets(isolate, args[2], partPointCount, offsets)) return;
+
+  const double* partXy = TypedArrayData<double>(partsArray);
+  std::vector<Polygon> parts;
+
+  for (size_t i = 0; i + 1 < offsets.size(); i += 1) parts.push_back(ReadPolygon(partXy, offsets[i], offsets[i + 1]));
+
+  Local<Value> options = args[3];
+  NestConfig config;
+
+  config.spacing = GetNumberOption(isolate, options, "spacing", 0);
+  config.rotations = static_cast<int>(GetNumberOption(isolate, options, "rotations", 4));
+  config.populationSize = static_cast<int>(GetNumberOption(isolate, options, "populationSize", 10));
+  config.mutationRate = static_cast<int>(GetNumberOption(isolate, options, "mutationRate", 10));
+  config.curveTolerance = GetNumberOption(isolate, options, "curveTolerance", 0.3);
+  config.seed = static_cast<uint32_t>(GetNumberOption(isolate, options, "seed", 0));
+
+  int maxGenerations = static_cast<int>(GetNumberOption(isolate, options, "maxGenerations", 0));
+
+  if (config.rotations < 1 || config.rotations > 360 || config.populationSize < 1 || !std::isfinite(config.spacing) ||
+      config.spacing < 0) {
+    ThrowTypeError(isolate, "invalid nest config");
+
+    return;
+  }
+
+  uint32_t id;
+  NestJob* job;
+
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    id = nextJobId++;
+    job = new NestJob(isolate, id, ReadPolygon(TypedArrayData<double>(containerArray), 0, containerArray->Length() / 2),
+                      std::move(parts), config, maxGenerations);
+    registry[id] = job;
+  }
+  job->SetCallbacks(isolate, args[4]);
+  job->Start();
+  args.GetReturnValue().Set(Number::New(isolate, id));
+}
+
+// stopNest(id) => boolean; the job still reports its best result through onDone.
+void StopNestMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsNumber()) {
+    ThrowTypeError(isolate, "id must be a number");
+
+    return;
+  }
+
+  uint32_t id = static_cast<uint32_t>(args[0].As<Number>()->Value());
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto found = registry.find(id);
+
+  if (found == registry.end()) {
+    args.GetReturnValue().Set(false);
+
+    return;
+  }
+  found->second->Stop();
+  args.GetReturnValue().Set(true);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "startNest", beam::StartNestMethod);
+  NODE_SET_METHOD(exports, "stopNest", beam::StopNestMethod);
+}
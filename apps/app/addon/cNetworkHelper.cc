@@ -0,0 +1,652 @@
+// Native network services: reachability probes of one host or a whole sweep on a single worker thread, so the
+// network test and IP checks no longer spawn a ping process per packet, and device discovery over UDP and mDNS that
+// keeps its own device table and reports only what changed.
+#include <node.h>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "src/background-job.h"
+#include "src/discovery.h"
+#include "src/node-utils.h"
+#include "src/prober.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::BackingStore;
+using v8::Function;
+using v8::FunctionCallbackInfo;
+using v8::Global;
+using v8::Number;
+using v8::String;
+using v8::Uint32Array;
+using v8::Uint8Array;
+
+namespace {
+
+class ProbeJob;
+class DiscoveryJob;
+
+std::mutex registryMutex;
+std::unordered_map<uint32_t, ProbeJob*> registry;
+std::unordered_map<uint32_t, DiscoveryJob*> discoveryRegistry;
+uint32_t nextJobId = 1;
+
+const char* MethodName(ProbeMethod method) { return method == ProbeMethod::kIcmp ? "icmp" : "tcp"; }
+
+class ProbeJob : public BackgroundJob {
+ public:
+  ProbeJob(Isolate* isolate, uint32_t id, ProbeOptions options)
+      : BackgroundJob(isolate), id_(id), options_(std::move(options)) {}
+  ~ProbeJob() override { Unregister(); }
+
+  void SetCallbacks(Isolate* isolate, Local<Value> callbacks) {
+    if (!callbacks->IsObject()) return;
+
+    Local<Object> object = callbacks.As<Object>();
+    auto read = [&](const char* key, Global<Function>& target) {
+      Local<Value> value = GetProperty(isolate, object, key);
+
+      if (value->IsFunction()) target.Reset(isolate, value.As<Function>());
+    };
+
+    read("onProgress", onProgress_);
+    read("onDone", onDone_);
+  }
+
+ protected:
+  void Run() override {
+    RunProbes(options_, stop_, [this](const ProbeProgress& progress) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      progress_ = progress;
+      hasProgress_ = true;
+      Notify();
+    }, &result_);
+    if (stop_) result_.error = "cancelled";
+  }
+
+  void Deliver(Isolate* isolate, bool finished) override {
+    ProbeProgress progress;
+    bool hasProgress;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      progress = progress_;
+      hasProgress = hasProgress_;
+      hasProgress_ = false;
+    }
+    if (hasProgress && !finished) {
+      Local<Object> output = Object::New(isolate);
+      Local<Value> progressArgs[] = {output};
+
+      SetProperty(isolate, output, "sent", Number::New(isolate, progress.sent));
+      SetProperty(isolate, output, "received", Number::New(isolate, progress.received));
+      SetProperty(isolate, output, "lost", Number::New(isolate, progress.lost));
+      SetProperty(isolate, output, "fraction", Number::New(isolate, progress.fraction));
+      Call(isolate, onProgress_, 1, progressArgs);
+    }
+    if (!finished) return;
+
+    // The id is dead once onDone runs. The worker has exited, so result_ is no longer written.
+    Unregister();
+
+    Local<Object> output = Object::New(isolate);
+    Local<Array> results = Array::New(isolate, static_cast<int>(result_.hosts.size()));
+    Local<Value> doneArgs[] = {output};
+
+    for (size_t i = 0; i < result_.hosts.size(); i += 1) {
+      const ProbeStats& stats = result_.hosts[i];
+      Local<Object> entry = Object::New(isolate);
+      bool answered = stats.received > 0;
+      auto timing = [&](double ms) -> Local<Value> {
+        if (!answered) return v8::Null(isolate);
+
+        return Number::New(isolate, ms);
+      };
+
+      SetProperty(isolate, entry, "host", NewString(isolate, stats.host.c_str()));
+      SetProperty(isolate, entry, "address", NewString(isolate, stats.address.c_str()));
+      SetProperty(isolate, entry, "method", NewString(isolate, MethodName(stats.method)));
+      if (!stats.error.empty()) SetProperty(isolate, entry, "error", NewString(isolate, stats.error.c_str()));
+      SetProperty(isolate, entry, "sent", Number::New(isolate, stats.sent));
+      SetProperty(isolate, entry, "received", Number::New(isolate, stats.received));
+      SetProperty(isolate, entry, "loss",
+                  Number::New(isolate, stats.sent > 0 ? 1 - static_cast<double>(stats.received) / stats.sent : 1));
+      SetProperty(isolate, entry, "minMs", timing(stats.minMs));
+      SetProperty(isolate, entry, "avgMs", timing(answered ? stats.sumMs / stats.received : 0));
+      SetProperty(isolate, entry, "maxMs", timing(stats.maxMs));
+      SetProperty(isolate, entry, "jitterMs", timing(stats.jitterMs));
+      SetProperty(isolate, entry, "histogram", NewTypedArray<Uint32Array>(isolate, stats.histogram));
+      results->Set(isolate->GetCurrentContext(), static_cast<uint32_t>(i), entry).Check();
+    }
+    SetProperty(isolate, output, "ok", v8::Boolean::New(isolate, result_.error.empty()));
+    if (!result_.error.empty()) SetProperty(isolate, output, "error", NewString(isolate, result_.error.c_str()));
+    SetProperty(isolate, output, "results", results);
+    SetProperty(isolate, output, "elapsedMs", Number::New(isolate, result_.elapsedMs));
+    Call(isolate, onDone_, 1, doneArgs);
+  }
+
+ private:
+  void Unregister() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    registry.erase(id_);
+  }
+
+  uint32_t id_;
+  ProbeOptions options_;
+  Global<Function> onProgress_;
+  Global<Function> onDone_;
+  ProbeResult result_;
+
+  std::mutex mutex_;
+  ProbeProgress progress_;
+  bool hasProgress_ = false;
+};
+
+class DiscoveryJob : public BackgroundJob {
+ public:
+  DiscoveryJob(Isolate* isolate, uint32_t id, DiscoveryOptions options)
+      : BackgroundJob(isolate), id_(id), service_(std::move(options)) {}
+  ~DiscoveryJob() override { Unregister(); }
+
+  void SetCallbacks(Isolate* isolate, Local<Value> callbacks) {
+    if (!callbacks->IsObject()) return;
+
+    Local<Object> object = callbacks.As<Object>();
+    auto read = [&](const char* key, Global<Function>& target) {
+      Local<Value> value = GetProperty(isolate, object, key);
+
+      if (value->IsFunction()) target.Reset(isolate, value.As<Function>());
+    };
+
+    read("onChange", onChange_);
+    read("onDone", onDone_);
+  }
+
+  void Poke(const std::string& host) { service_.Poke(host); }
+
+ protected:
+  void Run() override {
+    if (!service_.Open(&error_)) return;
+    service_.Run(stop_, [this](DiscoveryDelta&& delta) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      deltas_.push_back(std::move(delta));
+      Notify();
+    });
+  }
+
+  void Deliver(Isolate* isolate, bool finished) override {
+    std::vector<DiscoveryDelta> deltas;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      deltas.swap(deltas_);
+    }
+    for (const DiscoveryDelta& delta : deltas) {
+      Local<Object> output = Object::New(isolate);
+      Local<Value> changeArgs[] = {output};
+      auto devices = [&](const std::vector<DiscoveredDevice>& list) {
+        Local<Array> array = Array::New(isolate, static_cast<int>(list.size()));
+
+        for (size_t i = 0; i < list.size(); i += 1) {
+          array->Set(isolate->GetCurrentContext(), static_cast<uint32_t>(i), DeviceObject(isolate, list[i])).Check();
+        }
+
+        return array;
+      };
+      Local<Array> removed = Array::New(isolate, static_cast<int>(delta.removed.size()));
+
+      for (size_t i = 0; i < delta.removed.size(); i += 1) {
+        removed->Set(isolate->GetCurrentContext(), static_cast<uint32_t>(i),
+                     NewString(isolate, delta.removed[i].c_str())).Check();
+      }
+      SetProperty(isolate, output, "added", devices(delta.added));
+      SetProperty(isolate, output, "updated", devices(delta.updated));
+      SetProperty(isolate, output, "removed", removed);
+      Call(isolate, onChange_, 1, changeArgs);
+    }
+    if (!finished) return;
+
+    Unregister();
+
+    Local<Object> output = Object::New(isolate);
+    Local<Value> doneArgs[] = {output};
+
+    SetProperty(isolate, output, "ok", v8::Boolean::New(isolate, error_.empty()));
+    if (!error_.empty()) SetProperty(isolate, output, "error", NewString(isolate, error_.c_str()));
+    Call(isolate, onDone_, 1, doneArgs);
+  }
+
+ private:
+  static Local<Object> DeviceObject(Isolate* isolate, const DiscoveredDevice& device) {
+    Local<Object> output = Object::New(isolate);
+    bool mdns = device.source == DeviceSource::kMdns;
+
+    SetProperty(isolate, output, "key", NewString(isolate, device.key.c_str()));
+    SetProperty(isolate, output, "source", NewString(isolate, mdns ? "mdns" : "udp"));
+    SetProperty(isolate, output, "address", NewString(isolate, device.address.c_str()));
+    SetProperty(isolate, output, "port", Number::New(isolate, device.port));
+    if (!device.identity.empty()) SetProperty(isolate, output, "identity", NewString(isolate, device.identity.c_str()));
+    if (mdns) {
+      Local<Array> txt = Array::New(isolate, static_cast<int>(device.txt.size()));
+
+      for (size_t i = 0; i < device.txt.size(); i += 1) {
+        txt->Set(isolate->GetCurrentContext(), static_cast<uint32_t>(i), NewString(isolate, device.txt[i].c_str()))
+            .Check();
+      }
+      SetProperty(isolate, output, "name", NewString(isolate, device.name.c_str()));
+      SetProperty(isolate, output, "txt", txt);
+    } else {
+      SetProperty(isolate, output, "payload", NewTypedArray<Uint8Array>(isolate, device.payload));
+    }
+
+    return output;
+  }
+
+  void Unregister() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    discoveryRegistry.erase(id_);
+  }
+
+  uint32_t id_;
+  DiscoveryService service_;
+  Global<Function> onChange_;
+  Global<Function> onDone_;
+  std::string error_;
+
+  std::mutex mutex_;
+  std::vector<DiscoveryDelta> deltas_;
+};
+
+// Reads a whole number option in [min, max]; false when it is present but not such a number.
+bool GetIntegerOption(Isolate* isolate, Local<Value> options, const char* key, int fallback, int min, int max,
+                      int* result) {
+  double value = GetNumberOption(isolate, options, key, fallback);
+
+  if (!(value >= min && value <= max) || std::floor(value) != value) return false;
+  *result = static_cast<int>(value);
+
+  return true;
+}
+
+// Reads an Array of port numbers; false when it is not one.
+bool ReadPorts(Isolate* isolate, Local<Value> value, std::vector<uint16_t>* ports) {
+  if (!value->IsArray()) return false;
+
+  Local<Array> array = value.As<Array>();
+
+  ports->clear();
+  for (uint32_t i = 0; i < array->Length(); i += 1) {
+    Local<Value> port;
+
+    if (!array->Get(isolate->GetCurrentContext(), i).ToLocal(&port)) return false;
+
+    double number = port->IsNumber() ? port.As<Number>()->Value() : 0;
+
+    if (!(number >= 1 && number <= 65535) || std::floor(number) != number) return false;
+    ports->push_back(static_cast<uint16_t>(number));
+  }
+
+  return true;
+}
+
+// Reads an Array of strings; false when it is not one.
+bool ReadStrings(Isolate* isolate, Local<Value> value, std::vector<std::string>* strings) {
+  if (!value->IsArray()) return false;
+
+  Local<Array> array = value.As<Array>();
+
+  strings->clear();
+  for (uint32_t i = 0; i < array->Length(); i += 1) {
+    Local<Value> item;
+
+    if (!array->Get(isolate->GetCurrentContext(), i).ToLocal(&item) || !item->IsString()) return false;
+    strings->push_back(ToStdString(isolate, item));
+  }
+
+  return true;
+}
+
+// Reads the probe options into `options`, or throws and returns false.
+bool ReadProbeOptions(Isolate* isolate, Local<Value> value, ProbeOptions* options) {
+  if (value->IsUndefined()) return true;
+  if (!value->IsObject()) {
+    ThrowTypeError(isolate, "options must be an object");
+
+    return false;
+  }
+
+  Local<Object> object = value.As<Object>();
+  Local<Value> method = GetProperty(isolate, object, "method");
+  Local<Value> ports = GetProperty(isolate, object, "ports");
+
+  if (!GetIntegerOption(isolate, value, "count", options->count, 0, INT32_MAX, &options->count) ||
+      !GetIntegerOption(isolate, value, "durationMs", options->durationMs, 0, INT32_MAX, &options->durationMs) ||
+      !GetIntegerOption(isolate, value, "intervalMs", options->intervalMs, 1, INT32_MAX, &options->intervalMs) ||
+      !GetIntegerOption(isolate, value, "timeoutMs", options->timeoutMs, 1, INT32_MAX, &options->timeoutMs) ||
+      !GetIntegerOption(isolate, value, "concurrency", options->concurrency, 1, 4096, &options->concurrency) ||
+      !GetIntegerOption(isolate, value, "bins", options->bins, 1, 10000, &options->bins)) {
+    ThrowTypeError(isolate, "count, durationMs, intervalMs, timeoutMs, concurrency and bins must be whole numbers");
+
+    return false;
+  }
+  if (options->count == 0 && options->durationMs == 0) {
+    ThrowTypeError(isolate, "count or durationMs must be positive");
+
+    return false;
+  }
+  options->binMs = GetNumberOption(isolate, value, "binMs", options->binMs);
+  if (!(options->binMs > 0) || !std::isfinite(options->binMs)) {
+    ThrowTypeError(isolate, "binMs must be positive");
+
+    return false;
+  }
+  options->untilReply = GetBooleanOption(isolate, value, "untilReply", options->untilReply);
+  if (!method->IsUndefined()) {
+    std::string name = method->IsString() ? ToStdString(isolate, method) : "";
+
+    if (name == "auto") {
+      options->method = ProbeMethod::kAuto;
+    } else if (name == "icmp") {
+      options->method = ProbeMethod::kIcmp;
+    } else if (name == "tcp") {
+      options->method = ProbeMethod::kTcp;
+    } else {
+      ThrowTypeError(isolate, "method must be 'auto', 'icmp' or 'tcp'");
+
+      return false;
+    }
+  }
+  if (!ports->IsUndefined() && (!ReadPorts(isolate, ports, &options->ports) || options->ports.empty())) {
+    ThrowTypeError(isolate, "ports must be a non-empty Array of numbers from 1 to 65535");
+
+    return false;
+  }
+
+  return true;
+}
+
+// Reads the discovery options into `options`, or throws and returns false.
+bool ReadDiscoveryOptions(Isolate* isolate, Local<Value> value, DiscoveryOptions* options) {
+  if (!value->IsObject()) {
+    ThrowTypeError(isolate, "options must be an object");
+
+    return false;
+  }
+
+  Local<Object> object = value.As<Object>();
+  Local<Value> listenPorts = GetProperty(isolate, object, "listenPorts");
+  Local<Value> groups = GetProperty(isolate, object, "multicastGroups");
+  Local<Value> mdnsHosts = GetProperty(isolate, object, "mdnsHosts");
+  Local<Value> mdnsServices = GetProperty(isolate, object, "mdnsServices");
+  Local<Value> mdnsAddress = GetProperty(isolate, object, "mdnsAddress");
+  Local<Value> pokes = GetProperty(isolate, object, "pokes");
+  Local<Value> identityFields = GetProperty(isolate, object, "identityFields");
+  int mdnsPort = options->mdnsPort;
+  int identityOffset = 0;
+  int identityLength = 0;
+
+  if ((!listenPorts->IsUndefined() && !ReadPorts(isolate, listenPorts, &options->listenPorts)) ||
+      (!groups->IsUndefined() && !ReadStrings(isolate, groups, &options->multicastGroups)) ||
+      (!mdnsHosts->IsUndefined() && !ReadStrings(isolate, mdnsHosts, &options->mdnsHosts)) ||
+      (!mdnsServices->IsUndefined() && !ReadStrings(isolate, mdnsServices, &options->mdnsServices)) ||
+      (!identityFields->IsUndefined() && !ReadStrings(isolate, identityFields, &options->identityFields))) {
+    ThrowTypeError(isolate,
+                   "listenPorts must hold port numbers, multicastGroups, mdnsHosts, mdnsServices and identityFields "
+                   "strings");
+
+    return false;
+  }
+  if (!GetIntegerOption(isolate, value, "pokeIntervalMs", options->pokeIntervalMs, 1, INT32_MAX,
+                        &options->pokeIntervalMs) ||
+      !GetIntegerOption(isolate, value, "mdnsIntervalMs", options->mdnsIntervalMs, 1, INT32_MAX,
+                        &options->mdnsIntervalMs) ||
+      !GetIntegerOption(isolate, value, "ttlMs", options->ttlMs, 1, INT32_MAX, &options->ttlMs) ||
+      !GetIntegerOption(isolate, value, "updateIntervalMs", options->updateIntervalMs, 0, INT32_MAX,
+                        &options->updateIntervalMs) ||
+      !GetIntegerOption(isolate, value, "mdnsPort", mdnsPort, 1, 65535, &mdnsPort)) {
+    ThrowTypeError(isolate, "intervals and ttlMs must be whole numbers of milliseconds, mdnsPort a port number");
+
+    return false;
+  }
+  if (!GetIntegerOption(isolate, value, "identityOffset", 0, 0, 65535, &identityOffset) ||
+      !GetIntegerOption(isolate, value, "identityLength", 0, 0, 64, &identityLength)) {
+    ThrowTypeError(isolate, "identityOffset must be a byte offset, identityLength from 0 to 64 bytes");
+
+    return false;
+  }
+  options->mdnsPort = static_cast<uint16_t>(mdnsPort);
+  options->identityOffset = static_cast<size_t>(identityOffset);
+  options->identityLength = static_cast<size_t>(identityLength);
+  if (!mdnsAddress->IsUndefined()) {
+    if (!mdnsAddress->IsString()) {
+      ThrowTypeError(isolate, "mdnsAddress must be a string");
+
+      return false;
+    }
+    options->mdnsAddress = ToStdString(isolate, mdnsAddress);
+  }
+  if (pokes->IsUndefined()) return true;
+  if (!pokes->IsArray()) {
+    ThrowTypeError(isolate, "pokes must be an Array");
+
+    return false;
+  }
+
+  Local<Array> pokeArray = pokes.As<Array>();
+
+  for (uint32_t i = 0; i < pokeArray->Length(); i += 1) {
+    Local<Value> item;
+    DiscoveryPoke poke;
+    int port = 0;
+
+    if (!pokeArray->Get(isolate->GetCurrentContext(), i).ToLocal(&item)) return false;
+    if (!item->IsObject() || !GetIntegerOption(isolate, item, "port", 0, 1, 65535, &port)) {
+      ThrowTypeError(isolate, "pokes must be objects with a port from 1 to 65535");
+
+      return false;
+    }
+
+    Local<Value> host = GetProperty(isolate, item.As<Object>(), "host");
+    Local<Value> payload = GetProperty(isolate, item.As<Object>(), "payload");
+    std::shared_ptr<BackingStore> store;
+    size_t offset;
+    size_t length;
+
+    poke.port = static_cast<uint16_t>(port);
+    poke.host = host->IsString() ? ToStdString(isolate, host) : "255.255.255.255";
+    if (payload->IsString()) {
+      std::string text = ToUtf8(isolate, payload.As<String>());
+
+      poke.payload.assign(text.begin(), text.end());
+    } else if (ReadBytes(payload, &store, &offset, &length)) {
+      const uint8_t* bytes = static_cast<const uint8_t*>(store->Data()) + offset;
+
+      poke.payload.assign(bytes, bytes + length);
+    } else {
+      ThrowTypeError(isolate, "poke payloads must be strings, ArrayBuffers or views");
+
+      return false;
+    }
+    options->pokes.push_back(std::move(poke));
+  }
+
+  return true;
+}
+
+}  // namespace
+
+// startProbe(hosts, options?, callbacks?) => id
+// Probes every host name or address in `hosts` concurrently from one worker thread: ICMP echo where unprivileged
+// echo sockets are available, else a TCP connect to each of `ports` at once, where an accepted or refused connection
+// both count as a reply. options: method ('auto' (default), 'icmp' or 'tcp'), count (probes per host, default 4, 0
+// to probe until durationMs), durationMs (stop sending after this long, default 0 = no limit), intervalMs (between
+// the probes of a host, default 1000), timeoutMs (default 3000), concurrency (probes in flight, default 256),
+// untilReply (stop probing a host once it answered, default false), ports (default [80, 443, 22]), binMs and bins
+// (round-trip histogram, default 100 bins of 1 ms, the last also counting slower replies). callbacks:
+// onProgress({ sent, received, lost, fraction }), onDone({ ok, error?, results, elapsedMs }), where results holds
+// { host, address, method, error?, sent, received, loss, minMs, avgMs, maxMs, jitterMs, histogram: Uint32Array }
+// per host in order, with null timings for hosts that never answered; jitterMs is the mean absolute difference of
+// consecutive round-trip times.
+void StartProbeMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  ProbeOptions options;
+
+  if (!args[0]->IsArray()) {
+    ThrowTypeError(isolate, "hosts must be an Array");
+
+    return;
+  }
+  if (!ReadStrings(isolate, args[0], &options.hosts)) {
+    ThrowTypeError(isolate, "hosts must be strings");
+
+    return;
+  }
+  if (!ReadProbeOptions(isolate, args[1], &options)) return;
+
+  uint32_t id;
+  ProbeJob* job;
+
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    id = nextJobId++;
+    job = new ProbeJob(isolate, id, std::move(options));
+    registry[id] = job;
+  }
+  job->SetCallbacks(isolate, args[2]);
+  job->Start();
+  args.GetReturnValue().Set(Number::New(isolate, id));
+}
+
+// cancelProbe(id) => boolean; the probes still finish through onDone, with error "cancelled" and the results so far.
+void CancelProbeMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsNumber()) {
+    ThrowTypeError(isolate, "id must be a number");
+
+    return;
+  }
+
+  uint32_t id = static_cast<uint32_t>(args[0].As<Number>()->Value());
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto found = registry.find(id);
+
+  if (found == registry.end()) {
+    args.GetReturnValue().Set(false);
+
+    return;
+  }
+  found->second->Stop();
+  args.GetReturnValue().Set(true);
+}
+
+// startDiscovery(options, callbacks?) => id
+// Discovers devices on the LAN from a worker thread until stopDiscovery. options: listenPorts (UDP ports where
+// announcements arrive, e.g. [1901]) and multicastGroups (IPv4 groups joined on them); pokes ([{ host?, port,
+// payload }], datagrams sent every pokeIntervalMs (default 5000) to host, default 255.255.255.255, whose replies count
+// as announcements); mdnsHosts (names such as 'raspberrypi.local' resolved to IPv4 addresses) and mdnsServices
+// (service types such as '_http._tcp.local' whose instances are listed), queried every mdnsIntervalMs (default
+// 5000) at mdnsAddress:mdnsPort (default 224.0.0.251:5353); ttlMs (default 15000), after which a device not heard
+// from is removed; updateIntervalMs (default 1000), the shortest time between two updates of one device;
+// identityFields (names such as 'uuid' or 'serial' tried in order as TXT keys and as fields of JSON payloads) and
+// identityOffset and identityLength (the bytes of other UDP payloads that identify the device, default none). Every
+// device has a key, "id:<identity>" when its announcement has one, so that it stays one device across transports and
+// address changes, else "udp:<address>:<local port>" (local port 0 for poke replies) or "mdns:<name>", and the shape
+// { key, identity?, source: 'udp' | 'mdns', address, port, payload: Uint8Array } for UDP or { ..., name,
+// txt: string[] } for mDNS, where port is the datagram's source port or the service's SRV port and source the
+// transport last heard on. callbacks: onChange({ added, updated,
+// removed }) with devices that are new or whose content changed and the keys of those that expired, only when
+// something did; onDone({ ok, error? }) once stopped, or when a socket could not be opened.
+void StartDiscoveryMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  DiscoveryOptions options;
+
+  if (!ReadDiscoveryOptions(isolate, args[0], &options)) return;
+
+  uint32_t id;
+  DiscoveryJob* job;
+
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    id = nextJobId++;
+    job = new DiscoveryJob(isolate, id, std::move(options));
+    discoveryRegistry[id] = job;
+  }
+  job->SetCallbacks(isolate, args[1]);
+  job->Start();
+  args.GetReturnValue().Set(Number::New(isolate, id));
+}
+
+// pokeDiscovery(id, host) => boolean
+// Sends the poke payloads of discovery `id` to `host` right away, as for an address the user typed in.
+void PokeDiscoveryMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsNumber() || !args[1]->IsString()) {
+    ThrowTypeError(isolate, "id must be a number and host a string");
+
+    return;
+  }
+
+  uint32_t id = static_cast<uint32_t>(args[0].As<Number>()->Value());
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto found = discoveryRegistry.find(id);
+
+  if (found == discoveryRegistry.end()) {
+    args.GetReturnValue().Set(false);
+
+    return;
+  }
+  found->second->Poke(ToStdString(isolate, args[1]));
+  args.GetReturnValue().Set(true);
+}
+
+// stopDiscovery(id) => boolean; discovery then ends through onDone.
+void StopDiscoveryMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsNumber()) {
+    ThrowTypeError(isolate, "id must be a number");
+
+    return;
+  }
+
+  uint32_t id = static_cast<uint32_t>(args[0].As<Number>()->Value());
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto found = discoveryRegistry.find(id);
+
+  if (found == discoveryRegistry.end()) {
+    args.GetReturnValue().Set(false);
+
+    return;
+  }
+  found->second->Stop();
+  args.GetReturnValue().Set(true);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "startProbe", beam::StartProbeMethod);
+  NODE_SET_METHOD(exports, "cancelProbe", beam::CancelProbeMethod);
+  NODE_SET_METHOD(exports, "startDiscovery", beam::StartDiscoveryMethod);
+  NODE_SET_METHOD(exports, "pokeDiscovery", beam::PokeDiscoveryMethod);
+  NODE_SET_METHOD(exports, "stopDiscovery", beam::StopDiscoveryMethod);
+}
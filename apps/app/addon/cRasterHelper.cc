@@ -0,0 +1,558 @@
+// Native rasterization of packed path geometry and RGBA images: scene thumbnails on the thread pool, so saving no
+// longer waits for the browser to render the serialized SVG of the whole scene, and layer bitmaps at any resolution
+// streamed in bands, so printing and layer export no longer depend on one browser canvas holding the whole workarea.
+#include <node.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/async-task.h"
+#include "src/background-job.h"
+#include "src/node-utils.h"
+#include "src/parallel.h"
+#include "src/raster-scene.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::BackingStore;
+using v8::Float64Array;
+using v8::Function;
+using v8::FunctionCallbackInfo;
+using v8::Global;
+using v8::Number;
+using v8::Uint8Array;
+using v8::Uint8ClampedArray;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Largest thumbnail side accepted, well above the 256-512 px the file browser shows.
+constexpr int kMaxThumbnailSize = 4096;
+// Largest layer bitmap side: a 3 m workarea at 20 dots per mm.
+constexpr int kMaxLayerSize = 65536;
+// Layer bitmaps are drawn in tiles of this many columns by each worker; a band is a row of tiles.
+constexpr int kTileWidth = 256;
+// Bands rendered ahead of JS at most, which bounds the memory of a layer bitmap of any size.
+constexpr size_t kMaxQueuedBands = 2;
+
+class LayerRasterJob;
+
+std::mutex registryMutex;
+std::unordered_map<uint32_t, LayerRasterJob*> registry;
+uint32_t nextJobId = 1;
+
+// Document region drawn and the bitmap it is stretched to.
+struct RasterTarget {
+  double x = 0;
+  double y = 0;
+  double width = 0;
+  double height = 0;
+  int pixelWidth = 500;
+  int pixelHeight = 0;
+  bool hasBackground = false;
+  uint32_t background = 0;
+
+  Affine View() const {
+    double scaleX = pixelWidth / width;
+    double scaleY = pixelHeight / height;
+
+    return {scaleX, 0, 0, scaleY, -x * scaleX, -y * scaleY};
+  }
+};
+
+// Reads a whole number in [min, max]; missing fields keep `fallback`.
+bool GetIntegerOption(Isolate* isolate, Local<Value> options, const char* key, int fallback, int min, int max,
+                      int* value) {
+  double number = GetNumberOption(isolate, options, key, fallback);
+
+  if (!(number >= min) || number > max || std::floor(number) != number) return false;
+  *value = static_cast<int>(number);
+
+  return true;
+}
+
+// Reads an optional 0xRRGGBB color; false when it is present but not one.
+bool ReadColor(Local<Value> value, bool* present, uint32_t* color) {
+  *present = !value->IsUndefined() && !value->IsNull();
+  if (!*present) return true;
+  if (!value->IsNumber()) return false;
+
+  double number = value.As<Number>()->Value();
+
+  if (!(number >= 0) || number > 0xffffff || std::floor(number) != number) return false;
+  *color = static_cast<uint32_t>(number);
+
+  return true;
+}
+
+std::string ReadMatrix(Isolate* isolate, Local<Value> value, Affine* matrix) {
+  if (value->IsUndefined()) return "";
+  if (!value->IsArray() || value.As<Array>()->Length() != 6) return "matrix must hold 6 finite numbers";
+
+  double m[6];
+
+  for (uint32_t i = 0; i < 6; i += 1) {
+    Local<Value> item;
+
+    if (!value.As<Array>()->Get(isolate->GetCurrentContext(), i).ToLocal(&item) || !item->IsNumber() ||
+        !std::isfinite(item.As<Number>()->Value())) {
+      return "matrix must hold 6 finite numbers";
+    }
+    m[i] = item.As<Number>()->Value();
+  }
+  *matrix = {m[0], m[1], m[2], m[3], m[4], m[5]};
+
+  return "";
+}
+
+// Reads an item of renderThumbnail; returns what is wrong with it, or an empty string. Image pixels stay in the
+// caller's buffer, kept alive by `stores`.
+std::string ReadItem(Isolate* isolate, Local<Value> value, RasterItem* item,
+                     std::vector<std::shared_ptr<BackingStore>>* stores) {
+  if (!value->IsObject()) return "must be an object";
+
+  Local<Object> object = value.As<Object>();
+  std::string error = ReadMatrix(isolate, GetProperty(isolate, object, "matrix"), &item->matrix);
+
+  if (!error.empty()) return error;
+  item->opacity = GetNumberOption(isolate, value, "opacity", 1);
+  if (!(item->opacity >= 0 && item->opacity <= 1)) return "opacity must be in [0, 1]";
+
+  Local<Value> pixels = GetProperty(isolate, object, "pixels");
+
+  if (!pixels->IsUndefined()) {
+    std::shared_ptr<BackingStore> store;
+    size_t offset;
+    size_t length;
+
+    if (!ReadBytes(pixels, &store, &offset, &length)) return "pixels must be an ArrayBuffer or a view";
+    if (!GetIntegerOption(isolate, value, "width", 0, 1, INT32_MAX, &item->imageWidth) ||
+        !GetIntegerOption(isolate, value, "height", 0, 1, INT32_MAX, &item->imageHeight)) {
+      return "width and height must be positive whole numbers";
+    }
+    if (length != 4 * static_cast<size_t>(item->imageWidth) * item->imageHeight) {
+      return "pixels must hold width * height RGBA pixels";
+    }
+    item->pixels = static_cast<const uint8_t*>(store->Data()) + offset;
+    stores->push_back(std::move(store));
+
+    return "";
+  }
+
+  Local<Value> commands = GetProperty(isolate, object, "commands");
+  Local<Value> coords = GetProperty(isolate, object, "coords");
+
+  if (!commands->IsUint8Array() || !coords->IsFloat64Array()) {
+    return "commands must be a Uint8Array and coords a Float64Array";
+  }
+
+  const uint8_t* commandData = TypedArrayData<uint8_t>(commands.As<Uint8Array>());
+  const double* coordData = TypedArrayData<double>(coords.As<Float64Array>());
+  size_t commandCount = commands.As<Uint8Array>()->Length();
+  size_t coordCount = coords.As<Float64Array>()->Length();
+
+  if (!IsValidPathBuffer(commandData, commandCount, coordCount)) return "coords do not match commands";
+  item->path.commands.assign(commandData, commandData + commandCount);
+  item->path.coords.assign(coordData, coordData + coordCount);
+  if (!ReadColor(GetProperty(isolate, object, "fill"), &item->hasFill, &item->fill) ||
+      !ReadColor(GetProperty(isolate, object, "stroke"), &item->hasStroke, &item->stroke)) {
+    return "fill and stroke must be 0xRRGGBB numbers";
+  }
+
+  Local<Value> fillRule = GetProperty(isolate, object, "fillRule");
+
+  if (!fillRule->IsUndefined()) {
+    std::string rule = fillRule->IsString() ? ToStdString(isolate, fillRule) : "";
+
+    if (rule != "nonzero" && rule != "evenodd") return "fillRule must be 'nonzero' or 'evenodd'";
+    item->fillRule = rule == "evenodd" ? FillRule::kEvenOdd : FillRule::kNonZero;
+  }
+  item->strokeWidth = GetNumberOption(isolate, value, "strokeWidth", 1);
+  if (!(item->strokeWidth >= 0) || !std::isfinite(item->strokeWidth)) return "strokeWidth must not be negative";
+
+  return "";
+}
+
+// Reads x, y, width, height and background; the pixel size is up to the caller.
+bool ReadTarget(Isolate* isolate, Local<Value> value, RasterTarget* target) {
+  if (!value->IsObject()) {
+    ThrowTypeError(isolate, "options must be an object");
+
+    return false;
+  }
+  target->x = GetNumberOption(isolate, value, "x", 0);
+  target->y = GetNumberOption(isolate, value, "y", 0);
+  target->width = GetNumberOption(isolate, value, "width", 0);
+  target->height = GetNumberOption(isolate, value, "height", 0);
+  if (!std::isfinite(target->x) || !std::isfinite(target->y) || !(target->width > 0) || !(target->height > 0) ||
+      !std::isfinite(target->width) || !std::isfinite(target->height)) {
+    ThrowTypeError(isolate, "x, y, width and height must be finite with a positive size");
+
+    return false;
+  }
+  if (!ReadColor(GetProperty(isolate, value.As<Object>(), "background"), &target->hasBackground,
+                 &target->background)) {
+    ThrowTypeError(isolate, "background must be a 0xRRGGBB number");
+
+    return false;
+  }
+
+  return true;
+}
+
+bool ReadItems(Isolate* isolate, Local<Value> value, std::vector<RasterItem>* items,
+               std::vector<std::shared_ptr<BackingStore>>* stores) {
+  if (!value->IsArray()) {
+    ThrowTypeError(isolate, "items must be an Array");
+
+    return false;
+  }
+
+  Local<Array> itemArray = value.As<Array>();
+
+  items->resize(itemArray->Length());
+  for (uint32_t i = 0; i < itemArray->Length(); i += 1) {
+    Local<Value> item;
+
+    if (!itemArray->Get(isolate->GetCurrentContext(), i).ToLocal(&item)) return false;
+
+    std::string error = ReadItem(isolate, item, &(*items)[i], stores);
+
+    if (!error.empty()) {
+      std::string message = "items[" + std::to_string(i) + "]: " + error;
+
+      ThrowTypeError(isolate, message.c_str());
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+class ThumbnailTask : public AsyncTask {
+ public:
+  ThumbnailTask(std::vector<RasterItem> items, const RasterTarget& target,
+                std::vector<std::shared_ptr<BackingStore>> stores)
+      : items_(std::move(items)), target_(target), stores_(std::move(stores)) {}
+
+ protected:
+  void Execute() override {
+    Clock::time_point start = Clock::now();
+    RasterScene scene(items_, target_.View());
+    TileScratch scratch;
+
+    if (target_.hasBackground) scene.SetBackground(target_.background);
+    pixels_.resize(static_cast<size_t>(target_.pixelWidth) * target_.pixelHeight * 4);
+    scene.RenderTile(0, 0, target_.pixelWidth, target_.pixelHeight, scratch, pixels_.data(),
+                     static_cast<size_t>(target_.pixelWidth) * 4);
+    renderMs_ = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  Local<Value> Result(Isolate* isolate) override {
+    Local<Object> output = Object::New(isolate);
+
+    SetProperty(isolate, output, "pixels", NewTypedArray<Uint8ClampedArray>(isolate, pixels_));
+    SetProperty(isolate, output, "width", Number::New(isolate, target_.pixelWidth));
+    SetProperty(isolate, output, "height", Number::New(isolate, target_.pixelHeight));
+    SetProperty(isolate, output, "renderMs", Number::New(isolate, renderMs_));
+
+    return output;
+  }
+
+ private:
+  std::vector<RasterItem> items_;
+  RasterTarget target_;
+  std::vector<std::shared_ptr<BackingStore>> stores_;
+  std::vector<uint8_t> pixels_;
+  double renderMs_ = 0;
+};
+
+class LayerRasterJob : public BackgroundJob {
+ public:
+  LayerRasterJob(Isolate* isolate, uint32_t id, std::vector<RasterItem> items, const RasterTarget& target,
+                 int bandHeight, std::vector<std::shared_ptr<BackingStore>> stores)
+      : BackgroundJob(isolate),
+        id_(id),
+        items_(std::move(items)),
+        target_(target),
+        bandHeight_(bandHeight),
+        stores_(std::move(stores)) {}
+  ~LayerRasterJob() override { Unregister(); }
+
+  void SetCallbacks(Isolate* isolate, Local<Value> callbacks) {
+    if (!callbacks->IsObject()) return;
+
+    Local<Object> object = callbacks.As<Object>();
+    auto read = [&](const char* key, Global<Function>& target) {
+      Local<Value> value = GetProperty(isolate, object, key);
+
+      if (value->IsFunction()) target.Reset(isolate, value.As<Function>());
+    };
+
+    read("onBand", onBand_);
+    read("onDone", onDone_);
+  }
+
+ protected:
+  void Run() override {
+    Clock::time_point start = Clock::now();
+    RasterScene scene(items_, target_.View());
+    int width = target_.pixelWidth;
+    int tileCount = (width + kTileWidth - 1) / kTileWidth;
+    std::vector<TileScratch> scratches(std::min<size_t>(WorkerCount(), tileCount));
+
+    if (target_.hasBackground) scene.SetBackground(target_.background);
+    for (int y = 0; y < target_.pixelHeight && !stop_; y += bandHeight_) {
+      Band band{y, std::min(bandHeight_, target_.pixelHeight - y), {}};
+      std::atomic<int> nextTile(0);
+
+      band.pixels.resize(static_cast<size_t>(width) * band.height * 4);
+      ParallelFor(scratches.size(), [&](size_t worker) {
+        for (int tile = nextTile.fetch_add(1); tile < tileCount; tile = nextTile.fetch_add(1)) {
+          int x = tile * kTileWidth;
+
+          scene.RenderTile(x, y, std::min(kTileWidth, width - x), band.height, scratches[worker],
+                           &band.pixels[static_cast<size_t>(x) * 4], static_cast<size_t>(width) * 4);
+        }
+      });
+      if (!AddToBounds(band)) continue;
+
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      bands_.push_back(std::move(band));
+      Notify();
+      while (bands_.size() >= kMaxQueuedBands && !stop_) consumed_.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    renderMs_ = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  void Deliver(Isolate* isolate, bool finished) override {
+    std::deque<Band> bands;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      bands.swap(bands_);
+    }
+    consumed_.notify_one();
+    for (const Band& band : bands) {
+      Local<Object> output = Object::New(isolate);
+      Local<Value> bandArgs[] = {output};
+
+      SetProperty(isolate, output, "y", Number::New(isolate, band.y));
+      SetProperty(isolate, output, "height", Number::New(isolate, band.height));
+      SetProperty(isolate, output, "pixels", NewTypedArray<Uint8ClampedArray>(isolate, band.pixels));
+      Call(isolate, onBand_, 1, bandArgs);
+    }
+    if (!finished) return;
+
+    Unregister();
+
+    Local<Object> output = Object::New(isolate);
+    Local<Value> doneArgs[] = {output};
+
+    SetProperty(isolate, output, "ok", v8::Boolean::New(isolate, !stop_));
+    if (stop_) {
+      SetProperty(isolate, output, "error", NewString(isolate, "cancelled"));
+      Call(isolate, onDone_, 1, doneArgs);
+
+      return;
+    }
+    SetProperty(isolate, output, "width", Number::New(isolate, target_.pixelWidth));
+    SetProperty(isolate, output, "height", Number::New(isolate, target_.pixelHeight));
+    if (maxX_ < 0) {
+      SetProperty(isolate, output, "bbox", v8::Null(isolate));
+    } else {
+      Local<Object> bbox = Object::New(isolate);
+
+      SetProperty(isolate, bbox, "x", Number::New(isolate, minX_));
+      SetProperty(isolate, bbox, "y", Number::New(isolate, minY_));
+      SetProperty(isolate, bbox, "width", Number::New(isolate, maxX_ - minX_ + 1));
+      SetProperty(isolate, bbox, "height", Number::New(isolate, maxY_ - minY_ + 1));
+      SetProperty(isolate, output, "bbox", bbox);
+    }
+    SetProperty(isolate, output, "renderMs", Number::New(isolate, renderMs_));
+    Call(isolate, onDone_, 1, doneArgs);
+  }
+
+ private:
+  struct Band {
+    int y;
+    int height;
+    std::vector<uint8_t> pixels;
+  };
+
+  // Grows the bounds of the drawn pixels by those of `band`; false when the band is fully transparent.
+  bool AddToBounds(const Band& band) {
+    bool drawn = false;
+
+    for (int row = 0; row < band.height; row += 1) {
+      const uint8_t* pixels = &band.pixels[static_cast<size_t>(row) * target_.pixelWidth * 4];
+      int first = 0;
+      int last = target_.pixelWidth - 1;
+
+      while (first <= last && pixels[4 * first + 3] == 0) first += 1;
+      if (first > last) continue;
+      while (pixels[4 * last + 3] == 0) last -= 1;
+      drawn = true;
+      minX_ = std::min(minX_, first);
+      maxX_ = std::max(maxX_, last);
+      minY_ = std::min(minY_, band.y + row);
+      maxY_ = band.y + row;
+    }
+
+    return drawn;
+  }
+
+  void Unregister() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    registry.erase(id_);
+  }
+
+  uint32_t id_;
+  std::vector<RasterItem> items_;
+  RasterTarget target_;
+  int bandHeight_;
+  std::vector<std::shared_ptr<BackingStore>> stores_;
+  Global<Function> onBand_;
+  Global<Function> onDone_;
+  double renderMs_ = 0;
+  // Bounds of the pixels that are not transparent; maxX_ < 0 while there are none.
+  int minX_ = INT32_MAX;
+  int minY_ = INT32_MAX;
+  int maxX_ = -1;
+  int maxY_ = -1;
+
+  std::mutex mutex_;
+  std::condition_variable consumed_;
+  std::deque<Band> bands_;
+};
+
+}  // namespace
+
+// renderThumbnail(items, { x, y, width, height, pixelWidth?, background? }) =>
+//   Promise<{ pixels: Uint8ClampedArray, width, height, renderMs }>
+// Draws `items` in order over the document region { x, y, width, height } into straight RGBA pixels (ready for
+// new ImageData) pixelWidth wide (default 500), with the height following the region, on the thread pool. Items are
+//   { commands, coords, matrix?, fill?, stroke?, strokeWidth?, fillRule?, opacity? } for packed paths
+//     (path-buffer.h command codes), with 0xRRGGBB colors and strokeWidth in output pixels (default 1), or
+//   { pixels, width, height, matrix?, opacity? } for straight RGBA images, placed by matrix from image pixels.
+// matrix = [a, b, c, d, e, f] maps to document coordinates. Image pixels must not be modified until the promise
+// settles. The background is transparent unless given.
+void RenderThumbnailMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  RasterTarget target;
+  std::vector<RasterItem> items;
+  std::vector<std::shared_ptr<BackingStore>> stores;
+
+  if (!ReadTarget(isolate, args[1], &target)) return;
+  if (!GetIntegerOption(isolate, args[1], "pixelWidth", target.pixelWidth, 1, kMaxThumbnailSize,
+                        &target.pixelWidth)) {
+    ThrowTypeError(isolate, "pixelWidth must be a whole number from 1 to 4096");
+
+    return;
+  }
+
+  double pixelHeight = std::max(1.0, std::ceil(target.height * target.pixelWidth / target.width));
+
+  if (pixelHeight > kMaxThumbnailSize) {
+    ThrowTypeError(isolate, "the thumbnail must not be more than 4096 pixels high");
+
+    return;
+  }
+  target.pixelHeight = static_cast<int>(pixelHeight);
+  if (!ReadItems(isolate, args[0], &items, &stores)) return;
+  args.GetReturnValue().Set(AsyncTask::Queue(isolate, new ThumbnailTask(std::move(items), target, std::move(stores))));
+}
+
+// startLayerRaster(items, { x, y, width, height, pixelWidth, pixelHeight, bandHeight?, background? }, callbacks?) =>
+//   id
+// Draws `items` (as for renderThumbnail, with strokeWidth in bitmap pixels) over the document region { x, y, width,
+// height } stretched to a pixelWidth x pixelHeight bitmap, on worker threads in bands of bandHeight rows (default
+// 128). Only a couple of bands wait for JS at any time, so memory does not grow with the bitmap. callbacks:
+// onBand({ y, height, pixels: Uint8ClampedArray }) for every band, top to bottom, with straight RGBA rows
+// pixelWidth wide (fully transparent bands are skipped), and onDone({ ok, error?, width, height, bbox, renderMs }),
+// where bbox = { x, y, width, height } bounds the pixels that are not transparent, or is null. Image pixels must not
+// be modified until onDone.
+void StartLayerRasterMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  RasterTarget target;
+  int bandHeight;
+  std::vector<RasterItem> items;
+  std::vector<std::shared_ptr<BackingStore>> stores;
+
+  if (!ReadTarget(isolate, args[1], &target)) return;
+  if (!GetIntegerOption(isolate, args[1], "pixelWidth", 0, 1, kMaxLayerSize, &target.pixelWidth) ||
+      !GetIntegerOption(isolate, args[1], "pixelHeight", 0, 1, kMaxLayerSize, &target.pixelHeight)) {
+    ThrowTypeError(isolate, "pixelWidth and pixelHeight must be whole numbers from 1 to 65536");
+
+    return;
+  }
+  if (!GetIntegerOption(isolate, args[1], "bandHeight", 128, 1, 4096, &bandHeight)) {
+    ThrowTypeError(isolate, "bandHeight must be a whole number from 1 to 4096");
+
+    return;
+  }
+  if (!ReadItems(isolate, args[0], &items, &stores)) return;
+
+  uint32_t id;
+  LayerRasterJob* job;
+
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    id = nextJobId++;
+    job = new LayerRasterJob(isolate, id, std::move(items), target, bandHeight, std::move(stores));
+    registry[id] = job;
+  }
+  job->SetCallbacks(isolate, args[2]);
+  job->Start();
+  args.GetReturnValue().Set(Number::New(isolate, id));
+}
+
+// cancelLayerRaster(id) => boolean; the job still finishes through onDone, with error "cancelled".
+void CancelLayerRasterMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsNumber()) {
+    ThrowTypeError(isolate, "id must be a number");
+
+    return;
+  }
+
+  uint32_t id = static_cast<uint32_t>(args[0].As<Number>()->Value());
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto found = registry.find(id);
+
+  if (found == registry.end()) {
+    args.GetReturnValue().Set(false);
+
+    return;
+  }
+  found->second->Stop();
+  args.GetReturnValue().Set(true);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "renderThumbnail", beam::RenderThumbnailMethod);
+  NODE_SET_METHOD(exports, "startLayerRaster", beam::StartLayerRasterMethod);
+  NODE_SET_METHOD(exports, "cancelLayerRaster", beam::CancelLayerRasterMethod);
+}
@@ -0,0 +1,357 @@
+// Native surface building for curve engraving: triangulates the measured height points and produces the preview meshes.
+#include <node.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "src/delaunay.h"
+#include "src/height-field.h"
+#include "src/node-utils.h"
+#include "src/parallel.h"
+#include "src/surface-mesh.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::Float32Array;
+using v8::Float64Array;
+using v8::FunctionCallbackInfo;
+using v8::Int32Array;
+using v8::Global;
+using v8::Number;
+using v8::ObjectTemplate;
+using v8::Uint32Array;
+using v8::WeakCallbackInfo;
+
+namespace {
+
+struct ColorOptions {
+  double angleThreshold = 45;
+  float alertColor[3] = {1, 2.0f / 3, 2.0f / 3};
+  float defaultColor[3] = {1, 1, 1};
+};
+
+void ReadColor(Isolate* isolate, Local<Value> options, const char* key, float* color) {
+  if (!options->IsObject()) return;
+
+  Local<Value> value = GetProperty(isolate, options.As<Object>(), key);
+
+  if (!value->IsArray()) return;
+
+  Local<Array> array = value.As<Array>();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+
+  for (uint32_t i = 0; i < 3 && i < array->Length(); i += 1) {
+    Local<Value> component;
+
+    if (array->Get(context, i).ToLocal(&component) && component->IsNumber()) {
+      color[i] = static_cast<float>(component.As<Number>()->Value());
+    }
+  }
+}
+
+// Unrolls the mesh into three vertices per face, the layout createTriangularGeometry and three-subdivide produce, so
+// every face can carry its own slope colour. Normals are the flat face normals computeVertexNormals would give.
+Local<Object> MeshToObject(Isolate* isolate, const SurfaceMesh& mesh, const ColorOptions& colors) {
+  size_t triangleCount = mesh.TriangleCount();
+  std::vector<float> position(triangleCount * 9);
+  std::vector<float> normal(triangleCount * 9);
+  std::vector<float> uv(triangleCount * 6);
+  std::vector<float> color(triangleCount * 9);
+  std::vector<uint32_t> index(triangleCount * 3);
+  double maxAngle = 0;
+
+  for (size_t t = 0; t < triangleCount; t += 1) {
+    double angle = FaceSlopeAngle(mesh, t);
+    const float* faceColor = angle > colors.angleThreshold ? colors.alertColor : colors.defaultColor;
+    const double* a = &mesh.positions[3 * mesh.indices[3 * t]];
+    const double* b = &mesh.positions[3 * mesh.indices[3 * t + 1]];
+    const double* c = &mesh.positions[3 * mesh.indices[3 * t + 2]];
+    double cb[3] = {c[0] - b[0], c[1] - b[1], c[2] - b[2]};
+    double ab[3] = {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+    double n[3] = {cb[1] * ab[2] - cb[2] * ab[1], cb[2] * ab[0] - cb[0] * ab[2], cb[0] * ab[1] - cb[1] * ab[0]};
+    double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+    if (length > 0) {
+      for (double& component : n) component /= length;
+    }
+    if (angle > maxAngle) maxAngle = angle;
+    for (int k = 0; k < 3; k += 1) {
+      uint32_t vertex = mesh.indices[3 * t + k];
+      size_t out = 3 * t + k;
+
+      for (int axis = 0; axis < 3; axis += 1) {
+        position[3 * out + axis] = static_cast<float>(mesh.positions[3 * vertex + axis]);
+        normal[3 * out + axis] = static_cast<float>(n[axis]);
+        color[3 * out + axis] = faceColor[axis];
+      }
+      uv[2 * out] = static_cast<float>(mesh.uvs[2 * vertex]);
+      uv[2 * out + 1] = static_cast<float>(mesh.uvs[2 * vertex + 1]);
+      index[out] = static_cast<uint32_t>(out);
+    }
+  }
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "position", NewTypedArray<Float32Array>(isolate, position));
+  SetProperty(isolate, output, "normal", NewTypedArray<Float32Array>(isolate, normal));
+  SetProperty(isolate, output, "uv", NewTypedArray<Float32Array>(isolate, uv));
+  SetProperty(isolate, output, "color", NewTypedArray<Float32Array>(isolate, color));
+  SetProperty(isolate, output, "index", NewTypedArray<Uint32Array>(isolate, index));
+  SetProperty(isolate, output, "maxAngle", Number::New(isolate, maxAngle));
+  SetProperty(isolate, output, "vertices", NewTypedArray<Float64Array>(isolate, mesh.positions));
+  SetProperty(isolate, output, "triangles", NewTypedArray<Uint32Array>(isolate, mesh.indices));
+
+  return output;
+}
+
+// Points per sampling job; each job keeps its own triangle hint so sequential toolpath points stay cheap.
+constexpr size_t kSampleChunk = 1 << 16;
+
+// Owns the native field of a JS HeightField object and frees it when the object is collected.
+struct HeightFieldHandle {
+  Global<Object> object;
+  std::unique_ptr<HeightField> field;
+  int64_t memory;
+
+  static void OnCollected(const WeakCallbackInfo<HeightFieldHandle>& info) {
+    HeightFieldHandle* handle = info.GetParameter();
+
+    info.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-handle->memory);
+    handle->object.Reset();
+    delete handle;
+  }
+};
+
+// Marks the second internal field of HeightField objects, so sampleZ called on another wrapped object throws instead of
+// reading it as a field.
+int kHeightFieldTag;
+
+// sampleZ(points: Float64Array, options?) => Float64Array
+// points holds xy pairs; the result has one z per point, or options.outside (default NaN) where no triangle
+// contains the point.
+void SampleZMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<Object> self = args.This();
+
+  if (self->InternalFieldCount() < 2 || self->GetAlignedPointerFromInternalField(1) != &kHeightFieldTag) {
+    ThrowTypeError(isolate, "sampleZ must be called on a height field");
+
+    return;
+  }
+  if (!args[0]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "points must be a Float64Array");
+
+    return;
+  }
+
+  const HeightField& field = *static_cast<HeightFieldHandle*>(self->GetAlignedPointerFromInternalField(0))->field;
+  Local<Float64Array> points = args[0].As<Float64Array>();
+  const double* xy = TypedArrayData<double>(points);
+  size_t count = points->Length() / 2;
+  double outside = GetNumberOption(isolate, args[1], "outside", NAN);
+  Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, count * sizeof(double));
+  double* z = reinterpret_cast<double*>(ArrayBufferData(buffer));
+
+  ParallelFor((count + kSampleChunk - 1) / kSampleChunk, [&](size_t chunk) {
+    uint32_t hint = 0;
+    size_t end = std::min(count, (chunk + 1) * kSampleChunk);
+
+    for (size_t i = chunk * kSampleChunk; i < end; i += 1) {
+      z[i] = field.Sample(xy[2 * i], xy[2 * i + 1], outside, &hint);
+    }
+  });
+  args.GetReturnValue().Set(Float64Array::New(buffer, 0, count));
+}
+
+}  // namespace
+
+// triangulate(points: Float64Array, stride = 2) => { triangles: Uint32Array, halfedges: Int32Array, hull: Uint32Array }
+// Same output as `new Delaunator(coords)`; stride 3 triangulates xyz points by their xy.
+void TriangulateMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "points must be a Float64Array");
+
+    return;
+  }
+
+  size_t stride = args[1]->IsNumber() ? static_cast<size_t>(args[1].As<Number>()->Value()) : 2;
+
+  if (stride < 2) {
+    ThrowTypeError(isolate, "stride must be at least 2");
+
+    return;
+  }
+
+  Local<Float64Array> points = args[0].As<Float64Array>();
+  Delaunay delaunay;
+
+  DelaunayTriangulate(TypedArrayData<double>(points), points->Length() / stride, stride, delaunay);
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "triangles", NewTypedArray<Uint32Array>(isolate, delaunay.triangles));
+  SetProperty(isolate, output, "halfedges", NewTypedArray<Int32Array>(isolate, delaunay.halfedges));
+  SetProperty(isolate, output, "hull", NewTypedArray<Uint32Array>(isolate, delaunay.hull));
+  args.GetReturnValue().Set(output);
+}
+
+// buildSurface(points: Float64Array, triangles?: Uint32Array, options?) => { geometry, subdivided }
+// points holds xyz per measured point (display coordinates, as preprocessData passes to createTriangularGeometry).
+// triangles reuses an earlier triangulate() result so only the refinement reruns when the options change.
+// options: width, height (uv scale, default the point extent), interpolateLength (0 = none), subdivisionIterations
+// (default 2), preserveEdges (default true), maxTriangles (Loop steps stop before exceeding it), angleThreshold
+// (default 45), alertColor, defaultColor ([r, g, b]).
+// Both meshes are { position, normal, uv, color: Float32Array, index: Uint32Array, maxAngle, vertices: Float64Array,
+// triangles: Uint32Array }: the Float32 buffers hold three unshared vertices per face and can be uploaded as
+// BufferAttributes directly; vertices/triangles are the shared indexed mesh.
+void BuildSurfaceMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsFloat64Array()) {
+    ThrowTypeError(isolate, "points must be a Float64Array");
+
+    return;
+  }
+
+  Local<Float64Array> points = args[0].As<Float64Array>();
+  const double* xyz = TypedArrayData<double>(points);
+  size_t pointCount = points->Length() / 3;
+  SurfaceMesh mesh;
+
+  if (args[1]->IsUint32Array()) {
+    Local<Uint32Array> triangles = args[1].As<Uint32Array>();
+    const uint32_t* data = TypedArrayData<uint32_t>(triangles);
+
+    if (triangles->Length() % 3 != 0) {
+      ThrowTypeError(isolate, "triangles must hold three indices per triangle");
+
+      return;
+    }
+    for (size_t i = 0; i < triangles->Length(); i += 1) {
+      if (data[i] >= pointCount) {
+        ThrowTypeError(isolate, "triangle index out of range");
+
+        return;
+      }
+    }
+    mesh.indices.assign(data, data + triangles->Length());
+  } else if (!args[1]->IsUndefined() && !args[1]->IsNull()) {
+    ThrowTypeError(isolate, "triangles must be a Uint32Array");
+
+    return;
+  } else {
+    Delaunay delaunay;
+
+    DelaunayTriangulate(xyz, pointCount, 3, delaunay);
+    mesh.indices.swap(delaunay.triangles);
+  }
+
+  double minX = INFINITY;
+  double minY = INFINITY;
+  double maxX = -INFINITY;
+  double maxY = -INFINITY;
+
+  for (size_t i = 0; i < pointCount; i += 1) {
+    minX = std::min(minX, xyz[3 * i]);
+    maxX = std::max(maxX, xyz[3 * i]);
+    minY = std::min(minY, xyz[3 * i + 1]);
+    maxY = std::max(maxY, xyz[3 * i + 1]);
+  }
+
+  Local<Value> options = args[2];
+  double width = GetNumberOption(isolate, options, "width", pointCount > 0 ? maxX - minX : 1);
+  double height = GetNumberOption(isolate, options, "height", pointCount > 0 ? maxY - minY : 1);
+  double interpolateLength = GetNumberOption(isolate, options, "interpolateLength", 0);
+  int iterations = static_cast<int>(GetNumberOption(isolate, options, "subdivisionIterations", 2));
+  bool preserveEdges = GetBooleanOption(isolate, options, "preserveEdges", true);
+  double maxTriangles = GetNumberOption(isolate, options, "maxTriangles", INFINITY);
+  ColorOptions colors;
+
+  colors.angleThreshold = GetNumberOption(isolate, options, "angleThreshold", 45);
+  ReadColor(isolate, options, "alertColor", colors.alertColor);
+  ReadColor(isolate, options, "defaultColor", colors.defaultColor);
+
+  mesh.positions.assign(xyz, xyz + pointCount * 3);
+  mesh.uvs.resize(pointCount * 2);
+  for (size_t i = 0; i < pointCount; i += 1) {
+    mesh.uvs[2 * i] = xyz[3 * i] / width + 0.5;
+    mesh.uvs[2 * i + 1] = xyz[3 * i + 1] / height + 0.5;
+  }
+  if (interpolateLength > 0) SubdivideByEdgeLength(mesh, interpolateLength);
+
+  SurfaceMesh subdivided = mesh;
+
+  for (int i = 0; i < iterations && subdivided.TriangleCount() * 4.0 <= maxTriangles; i += 1) {
+    LoopSubdivide(subdivided, preserveEdges);
+  }
+
+  Local<Object> output = Object::New(isolate);
+
+  SetProperty(isolate, output, "geometry", MeshToObject(isolate, mesh, colors));
+  SetProperty(isolate, output, "subdivided", MeshToObject(isolate, subdivided, colors));
+  args.GetReturnValue().Set(output);
+}
+
+// createHeightField(vertices: Float64Array, triangles: Uint32Array, options?) => { sampleZ }
+// vertices holds xyz per vertex (e.g. the measured points, or buildSurface's subdivided vertices) and triangles three
+// vertex indices per face. options.cellSize sets the bucket grid spacing; by default there is about one triangle per
+// cell. The index is built once, so Z-annotating a whole toolpath is one sampleZ call.
+void CreateHeightFieldMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<v8::Context> context = isolate->GetCurrentContext();
+
+  if (!args[0]->IsFloat64Array() || !args[1]->IsUint32Array()) {
+    ThrowTypeError(isolate, "vertices must be a Float64Array and triangles a Uint32Array");
+
+    return;
+  }
+
+  Local<Float64Array> vertices = args[0].As<Float64Array>();
+  Local<Uint32Array> triangles = args[1].As<Uint32Array>();
+  const uint32_t* indices = TypedArrayData<uint32_t>(triangles);
+  size_t vertexCount = vertices->Length() / 3;
+
+  if (triangles->Length() % 3 != 0) {
+    ThrowTypeError(isolate, "triangles must hold three indices per triangle");
+
+    return;
+  }
+  for (size_t i = 0; i < triangles->Length(); i += 1) {
+    if (indices[i] >= vertexCount) {
+      ThrowTypeError(isolate, "triangle index out of range");
+
+      return;
+    }
+  }
+
+  Local<ObjectTemplate> objectTemplate = ObjectTemplate::New(isolate);
+
+  objectTemplate->SetInternalFieldCount(2);
+
+  Local<Object> object = objectTemplate->NewInstance(context).ToLocalChecked();
+  HeightFieldHandle* handle = new HeightFieldHandle();
+
+  handle->field.reset(new HeightField(TypedArrayData<double>(vertices), indices, triangles->Length() / 3,
+                                      GetNumberOption(isolate, args[2], "cellSize", 0)));
+  handle->memory = static_cast<int64_t>(handle->field->MemoryUsage());
+  handle->object.Reset(isolate, object);
+  handle->object.SetWeak(handle, HeightFieldHandle::OnCollected, v8::WeakCallbackType::kParameter);
+  isolate->AdjustAmountOfExternalAllocatedMemory(handle->memory);
+  object->SetAlignedPointerInInternalField(0, handle);
+  object->SetAlignedPointerInInternalField(1, &kHeightFieldTag);
+  NODE_SET_METHOD(object, "sampleZ", SampleZMethod);
+  args.GetReturnValue().Set(object);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "triangulate", beam::TriangulateMethod);
+  NODE_SET_METHOD(exports, "buildSurface", beam::BuildSurfaceMethod);
+  NODE_SET_METHOD(exports, "createHeightField", beam::CreateHeightFieldMethod);
+}
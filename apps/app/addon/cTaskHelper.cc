@@ -0,0 +1,309 @@
+// Native task code (.fc) handling: converts G-code to version 1 task code on the thread pool instead of the backend
+// g2f round trip, and reads task code for the thumbnail, metadata and path preview.
+#include <node.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/async-task.h"
+#include "src/fcode-reader.h"
+#include "src/fcode-writer.h"
+#include "src/file-io.h"
+#include "src/node-utils.h"
+
+namespace beam {
+
+using v8::Array;
+using v8::BackingStore;
+using v8::Float32Array;
+using v8::FunctionCallbackInfo;
+using v8::Number;
+using v8::Uint8Array;
+
+namespace {
+
+// Mapped G-code is converted in pieces of this size, so pages are read in order.
+constexpr size_t kFeedSize = 16 << 20;
+
+// G-code from a file or from JS-owned bytes, plus the preview and metadata to store with it.
+struct FcodeInput {
+  std::string sourcePath;
+  std::shared_ptr<BackingStore> source;
+  ByteSpan sourceBytes;
+  std::string outputPath;
+  std::vector<std::shared_ptr<BackingStore>> stores;
+  std::vector<ByteSpan> previews;
+  std::vector<std::pair<std::string, std::string>> metadata;
+};
+
+bool ReadFcodeOptions(Isolate* isolate, Local<Value> value, FcodeInput* input) {
+  if (value->IsUndefined()) return true;
+  if (!value->IsObject()) {
+    ThrowTypeError(isolate, "options must be an object");
+
+    return false;
+  }
+
+  Local<Context> context = isolate->GetCurrentContext();
+  Local<Object> options = value.As<Object>();
+  Local<Value> output = GetProperty(isolate, options, "output");
+  Local<Value> thumbnail = GetProperty(isolate, options, "thumbnail");
+  Local<Value> metadata = GetProperty(isolate, options, "metadata");
+
+  if (output->IsString()) {
+    input->outputPath = ToStdString(isolate, output);
+  } else if (!output->IsUndefined()) {
+    ThrowTypeError(isolate, "output must be a path");
+
+    return false;
+  }
+  if (!thumbnail->IsUndefined() && !thumbnail->IsNull()) {
+    std::shared_ptr<BackingStore> store;
+    size_t offset;
+    size_t length;
+
+    if (!ReadBytes(thumbnail, &store, &offset, &length)) {
+      ThrowTypeError(isolate, "thumbnail must be an ArrayBuffer or view");
+
+      return false;
+    }
+    input->previews.push_back({static_cast<const uint8_t*>(store->Data()) + offset, length});
+    input->stores.push_back(std::move(store));
+  }
+  if (metadata->IsObject()) {
+    Local<Array> keys;
+
+    if (!metadata.As<Object>()->GetOwnPropertyNames(context).ToLocal(&keys)) return false;
+    for (uint32_t i = 0; i < keys->Length(); i += 1) {
+      Local<Value> key = keys->Get(context, i).ToLocalChecked();
+      Local<Value> entry;
+      Local<String> keyString;
+      Local<String> entryString;
+
+      if (!key->ToString(context).ToLocal(&keyString) || !metadata.As<Object>()->Get(context, key).ToLocal(&entry) ||
+          !entry->ToString(context).ToLocal(&entryString)) {
+        return false;
+      }
+      input->metadata.emplace_back(ToUtf8(isolate, keyString), ToUtf8(isolate, entryString));
+    }
+  } else if (!metadata->IsUndefined()) {
+    ThrowTypeError(isolate, "metadata must be an object");
+
+    return false;
+  }
+
+  return true;
+}
+
+class GcodeToFcodeTask : public AsyncTask {
+ public:
+  explicit GcodeToFcodeTask(std::unique_ptr<FcodeInput> input) : input_(std::move(input)) {}
+
+ protected:
+  void Execute() override {
+    MappedFile file;
+    ByteSpan gcode = input_->sourceBytes;
+
+    if (!input_->sourcePath.empty()) {
+      if (!file.Open(input_->sourcePath, &error_)) return;
+      gcode = {file.Data(), file.Size()};
+    }
+    for (size_t offset = 0; offset < gcode.size; offset += kFeedSize) {
+      encoder_.Feed(reinterpret_cast<const char*>(gcode.data) + offset, std::min(kFeedSize, gcode.size - offset));
+    }
+    encoder_.Finish();
+    if (encoder_.ScriptSize() > UINT32_MAX) {
+      error_ = "task code is too large";
+
+      return;
+    }
+    serializer_.reset(new FcodeSerializer(encoder_, input_->metadata, input_->previews));
+    if (!input_->outputPath.empty()) serializer_->WriteFile(input_->outputPath, &error_);
+  }
+
+  Local<Value> Result(Isolate* isolate) override {
+    const FcodeSummary& summary = encoder_.Summary();
+    Local<Object> output = Object::New(isolate);
+
+    if (input_->outputPath.empty()) {
+      Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, serializer_->Size());
+
+      serializer_->CopyTo(reinterpret_cast<uint8_t*>(ArrayBufferData(buffer)));
+      SetProperty(isolate, output, "fcode", Uint8Array::New(buffer, 0, serializer_->Size()));
+    }
+    SetProperty(isolate, output, "bytes", Number::New(isolate, static_cast<double>(serializer_->Size())));
+    SetProperty(isolate, output, "time", Number::New(isolate, summary.time));
+    SetProperty(isolate, output, "travelDistance", Number::New(isolate, summary.travelDistance));
+    SetProperty(isolate, output, "maxZ", Number::New(isolate, summary.maxZ));
+    SetProperty(isolate, output, "skippedLines", Number::New(isolate, static_cast<double>(summary.skippedLines)));
+
+    return output;
+  }
+
+ private:
+  std::unique_ptr<FcodeInput> input_;
+  FcodeEncoder encoder_;
+  std::unique_ptr<FcodeSerializer> serializer_;
+};
+
+// Task code from a mapped file or from JS-owned bytes, which must stay unmodified while it is read.
+struct FcodeSource {
+  std::string path;
+  std::shared_ptr<BackingStore> store;
+  ByteSpan bytes;
+  MappedFile file;
+
+  bool Read(Isolate* isolate, Local<Value> value) {
+    size_t offset;
+    size_t length;
+
+    if (value->IsString()) {
+      path = ToStdString(isolate, value);
+    } else if (ReadBytes(value, &store, &offset, &length)) {
+      bytes = {static_cast<const uint8_t*>(store->Data()) + offset, length};
+    } else {
+      ThrowTypeError(isolate, "task code must be a path, an ArrayBuffer or a view");
+
+      return false;
+    }
+
+    return true;
+  }
+
+  bool Index(FcodeIndex* index, std::string* error) {
+    if (!path.empty()) {
+      if (!file.Open(path, error)) return false;
+      bytes = {file.Data(), file.Size()};
+    }
+
+    return ReadFcodeIndex(bytes.data, bytes.size, index, error);
+  }
+};
+
+class DecodeFcodeTask : public AsyncTask {
+ public:
+  explicit DecodeFcodeTask(std::unique_ptr<FcodeSource> source) : source_(std::move(source)) {}
+
+ protected:
+  void Execute() override {
+    FcodeIndex index;
+
+    if (source_->Index(&index, &error_)) DecodeFcodeMotion(index, &parsed_, &error_);
+  }
+
+  Local<Value> Result(Isolate* isolate) override {
+    return NewTypedArray<Float32Array>(isolate, parsed_);
+  }
+
+ private:
+  std::unique_ptr<FcodeSource> source_;
+  std::vector<float> parsed_;
+};
+
+}  // namespace
+
+// gcodeToFcode(gcode, { output?, thumbnail?, metadata? }?) =>
+//   Promise<{ fcode?: Uint8Array, bytes, time, travelDistance, maxZ, skippedLines }>
+// `gcode` is a file path or an ArrayBuffer / view, which must not be modified until the promise settles. The task
+// code is written to options.output when given, otherwise returned as `fcode`. options.thumbnail is stored as the
+// preview image and options.metadata entries are added to, or replace, the computed VERSION, HEAD_TYPE, TIME_COST,
+// TRAVEL_DIST and MAX_X/Y/Z/R entries. `time` is in seconds at the programmed feedrates. skippedLines counts the
+// lines left out for want of a command (see src/fcode-writer.h); a job with any is not complete.
+void GcodeToFcodeMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  std::unique_ptr<FcodeInput> input(new FcodeInput());
+  size_t offset;
+  size_t length;
+
+  if (args[0]->IsString()) {
+    input->sourcePath = ToStdString(isolate, args[0]);
+  } else if (ReadBytes(args[0], &input->source, &offset, &length)) {
+    input->sourceBytes = {static_cast<const uint8_t*>(input->source->Data()) + offset, length};
+  } else {
+    ThrowTypeError(isolate, "gcode must be a path, an ArrayBuffer or a view");
+
+    return;
+  }
+  if (!ReadFcodeOptions(isolate, args[1], input.get())) return;
+  args.GetReturnValue().Set(AsyncTask::Queue(isolate, new GcodeToFcodeTask(std::move(input))));
+}
+
+// readFcodeInfo(fcode) => { version, metadata, thumbnail: Uint8Array | null, previews: Uint8Array[] }
+// `fcode` is a file path or an ArrayBuffer / view. Reads the framing, metadata and previews only, whatever the size of
+// the commands; throws when it is not task code or the metadata checksum does not match. `metadata` maps the KEY=VALUE
+// entries of version 1 to strings and is the parsed FILE JSON of versions 2 and 3.
+void ReadFcodeInfoMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext();
+  FcodeSource source;
+  FcodeIndex index;
+  std::string error;
+
+  if (!source.Read(isolate, args[0])) return;
+  if (!source.Index(&index, &error)) {
+    ThrowError(isolate, error.c_str());
+
+    return;
+  }
+
+  Local<Object> output = Object::New(isolate);
+  Local<Value> metadata;
+  Local<Array> previews = Array::New(isolate, static_cast<int>(index.previews.size()));
+
+  if (index.version == 1) {
+    Local<Object> entries = Object::New(isolate);
+
+    for (const auto& entry : index.metadata) {
+      entries->Set(context, NewString(isolate, entry.first.c_str()), NewString(isolate, entry.second.c_str())).Check();
+    }
+    metadata = entries;
+  } else {
+    Local<String> text;
+
+    if (index.metadataJson.size > static_cast<size_t>(INT32_MAX) ||
+        !String::NewFromUtf8(isolate, reinterpret_cast<const char*>(index.metadataJson.data),
+                             v8::NewStringType::kNormal, static_cast<int>(index.metadataJson.size))
+             .ToLocal(&text)) {
+      ThrowError(isolate, "task code metadata is too large for a string");
+
+      return;
+    }
+    // Throws the SyntaxError when the metadata is not JSON.
+    if (!v8::JSON::Parse(context, text).ToLocal(&metadata)) return;
+  }
+  for (size_t i = 0; i < index.previews.size(); i += 1) {
+    const ByteSpan& preview = index.previews[i];
+
+    previews->Set(context, static_cast<uint32_t>(i), NewTypedArray<Uint8Array>(isolate, preview.data, preview.size))
+        .Check();
+  }
+  SetProperty(isolate, output, "version", Number::New(isolate, index.version));
+  SetProperty(isolate, output, "metadata", metadata);
+  SetProperty(isolate, output, "thumbnail",
+              index.previews.empty() ? v8::Null(isolate).As<Value>() : previews->Get(context, 0).ToLocalChecked());
+  SetProperty(isolate, output, "previews", previews);
+  args.GetReturnValue().Set(output);
+}
+
+// decodeFcode(fcode) => Promise<Float32Array>, the motion of a task as the parsed G-code that
+// GcodePreview.setParsedGcode reads (9 floats per move, see src/fcode-reader.h). Verifies the content checksum on the
+// thread pool and rejects when it does not match or the task uses commands src/fcode-format.h does not describe.
+void DecodeFcodeMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+  std::unique_ptr<FcodeSource> source(new FcodeSource());
+
+  if (!source->Read(isolate, args[0])) return;
+  args.GetReturnValue().Set(AsyncTask::Queue(isolate, new DecodeFcodeTask(std::move(source))));
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "gcodeToFcode", beam::GcodeToFcodeMethod);
+  NODE_SET_METHOD(exports, "readFcodeInfo", beam::ReadFcodeInfoMethod);
+  NODE_SET_METHOD(exports, "decodeFcode", beam::DecodeFcodeMethod);
+}
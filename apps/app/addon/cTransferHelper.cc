@@ -0,0 +1,247 @@
+// Native task transfer: streams uploads to the backend and devices over websocket on a worker thread, so large tasks
+// are not cut into thousands of 4 KB frames by JS.
+#include <node.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "src/background-job.h"
+#include "src/file-io.h"
+#include "src/node-utils.h"
+#include "src/ws-upload.h"
+
+namespace beam {
+
+using v8::BackingStore;
+using v8::Function;
+using v8::FunctionCallbackInfo;
+using v8::Global;
+using v8::Number;
+
+namespace {
+
+class UploadJob;
+
+std::mutex registryMutex;
+std::unordered_map<uint32_t, UploadJob*> registry;
+uint32_t nextJobId = 1;
+
+class UploadJob : public BackgroundJob {
+ public:
+  UploadJob(Isolate* isolate, uint32_t id, UploadOptions options)
+      : BackgroundJob(isolate), id_(id), options_(std::move(options)) {}
+  ~UploadJob() override { Unregister(); }
+
+  // The data comes from a file mapped on the worker thread or from JS-owned bytes.
+  void SetSource(std::string path, std::shared_ptr<BackingStore> store, const ByteSpan& bytes) {
+    path_ = std::move(path);
+    store_ = std::move(store);
+    bytes_ = bytes;
+  }
+
+  void SetCallbacks(Isolate* isolate, Local<Value> callbacks) {
+    if (!callbacks->IsObject()) return;
+
+    Local<Object> object = callbacks.As<Object>();
+    auto read = [&](const char* key, Global<Function>& target) {
+      Local<Value> value = GetProperty(isolate, object, key);
+
+      if (value->IsFunction()) target.Reset(isolate, value.As<Function>());
+    };
+
+    read("onProgress", onProgress_);
+    read("onDone", onDone_);
+  }
+
+ protected:
+  void Run() override {
+    MappedFile file;
+    ByteSpan data = bytes_;
+
+    if (!path_.empty()) {
+      if (!file.Open(path_, &result_.error)) return;
+      data = {file.Data(), file.Size()};
+    }
+    RunUpload(options_, data, stop_, [this](const UploadProgress& progress) {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      progress_ = progress;
+      hasProgress_ = true;
+      Notify();
+    }, &result_);
+    if (stop_ && !result_.ok) result_.error = "cancelled";
+  }
+
+  void Deliver(Isolate* isolate, bool finished) override {
+    UploadProgress progress;
+    bool hasProgress;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      progress = progress_;
+      hasProgress = hasProgress_;
+      hasProgress_ = false;
+    }
+    if (hasProgress) {
+      Local<Object> output = Object::New(isolate);
+      Local<Value> progressArgs[] = {output};
+
+      SetProperty(isolate, output, "sent", Number::New(isolate, static_cast<double>(progress.sent)));
+      SetProperty(isolate, output, "acknowledged", Number::New(isolate, static_cast<double>(progress.acknowledged)));
+      SetProperty(isolate, output, "total", Number::New(isolate, static_cast<double>(progress.total)));
+      SetProperty(isolate, output, "bytesPerSecond", Number::New(isolate, progress.bytesPerSecond));
+      SetProperty(isolate, output, "frameSize", Number::New(isolate, static_cast<double>(progress.frameSize)));
+      Call(isolate, onProgress_, 1, progressArgs);
+    }
+    if (!finished) return;
+
+    // The id is dead once onDone runs. The worker has exited, so result_ is no longer written.
+    Unregister();
+
+    Local<Object> output = Object::New(isolate);
+    Local<Value> doneArgs[] = {output};
+
+    SetProperty(isolate, output, "ok", v8::Boolean::New(isolate, result_.ok));
+    if (!result_.error.empty()) SetProperty(isolate, output, "error", NewString(isolate, result_.error.c_str()));
+    SetProperty(isolate, output, "response", NewString(isolate, result_.response.c_str()));
+    SetProperty(isolate, output, "bytes", Number::New(isolate, static_cast<double>(result_.bytes)));
+    SetProperty(isolate, output, "seconds", Number::New(isolate, result_.seconds));
+    SetProperty(isolate, output, "bytesPerSecond",
+                Number::New(isolate, result_.seconds > 0 ? result_.bytes / result_.seconds : 0));
+    if (!result_.sha256.empty()) {
+      SetProperty(isolate, output, "crc32", Number::New(isolate, result_.crc32));
+      SetProperty(isolate, output, "sha256", NewString(isolate, result_.sha256.c_str()));
+    }
+    Call(isolate, onDone_, 1, doneArgs);
+  }
+
+ private:
+  void Unregister() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    registry.erase(id_);
+  }
+
+  uint32_t id_;
+  UploadOptions options_;
+  std::string path_;
+  std::shared_ptr<BackingStore> store_;
+  ByteSpan bytes_;
+  Global<Function> onProgress_;
+  Global<Function> onDone_;
+  UploadResult result_;
+
+  std::mutex mutex_;
+  UploadProgress progress_;
+  bool hasProgress_ = false;
+};
+
+}  // namespace
+
+// startUpload(url, command, data, options?, callbacks?) => id
+// Connects to the websocket at `url` (ws://host:port/path), sends `command` (e.g. "file upload application/fcode
+// 1234") and, once the server replies "continue", streams `data` (a file path or an ArrayBuffer / view, which must
+// not be modified until onDone) as binary messages. options: timeout (ms, default 30000), minFrame and maxFrame
+// (bytes, default 64 KiB and 1 MiB), window (socket send buffer, default 4 MiB), inFlight (bytes sent beyond the
+// last "sent" count of the server's "uploading" replies, e.g. 8 MiB for `file upload`; default 0, no cap, as
+// `upload` on /ws/utils sends no such replies).
+// callbacks: onProgress({ sent, acknowledged, total, bytesPerSecond, frameSize }), onDone({ ok, error?, response,
+// bytes, seconds, bytesPerSecond, crc32?, sha256? }), where response is the last message from the server and ok
+// means its status was "ok". The checksums are present once all data was sent.
+void StartUploadMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsString() || !args[1]->IsString()) {
+    ThrowTypeError(isolate, "url and command must be strings");
+
+    return;
+  }
+
+  UploadOptions options;
+  std::string path;
+  std::shared_ptr<BackingStore> store;
+  ByteSpan bytes;
+  size_t offset;
+  size_t length;
+
+  options.url = ToStdString(isolate, args[0]);
+  options.command = ToUtf8(isolate, args[1].As<String>());
+  if (args[2]->IsString()) {
+    path = ToStdString(isolate, args[2]);
+  } else if (ReadBytes(args[2], &store, &offset, &length)) {
+    bytes = {static_cast<const uint8_t*>(store->Data()) + offset, length};
+  } else {
+    ThrowTypeError(isolate, "data must be a path, an ArrayBuffer or a view");
+
+    return;
+  }
+
+  double timeout = GetNumberOption(isolate, args[3], "timeout", options.timeoutMs);
+  double minFrame = GetNumberOption(isolate, args[3], "minFrame", static_cast<double>(options.minFrame));
+  double maxFrame = GetNumberOption(isolate, args[3], "maxFrame", static_cast<double>(options.maxFrame));
+  double window = GetNumberOption(isolate, args[3], "window", options.window);
+  double inFlight = GetNumberOption(isolate, args[3], "inFlight", static_cast<double>(options.inFlight));
+
+  if (!(timeout > 0) || !(minFrame >= 1) || !(maxFrame >= minFrame) || maxFrame > (1 << 30) || !(window >= 1) ||
+      window > INT32_MAX || !(inFlight >= 0) || inFlight > 9007199254740991.0) {
+    ThrowTypeError(isolate, "invalid upload options");
+
+    return;
+  }
+  options.timeoutMs = static_cast<int>(std::min(timeout, static_cast<double>(INT32_MAX)));
+  options.minFrame = static_cast<size_t>(minFrame);
+  options.maxFrame = static_cast<size_t>(maxFrame);
+  options.window = static_cast<int>(window);
+  options.inFlight = static_cast<uint64_t>(inFlight);
+
+  uint32_t id;
+  UploadJob* job;
+
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    id = nextJobId++;
+    job = new UploadJob(isolate, id, std::move(options));
+    registry[id] = job;
+  }
+  job->SetSource(std::move(path), std::move(store), bytes);
+  job->SetCallbacks(isolate, args[4]);
+  job->Start();
+  args.GetReturnValue().Set(Number::New(isolate, id));
+}
+
+// cancelUpload(id) => boolean; the upload still finishes through onDone, with error "cancelled".
+void CancelUploadMethod(const FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = args.GetIsolate();
+
+  if (!args[0]->IsNumber()) {
+    ThrowTypeError(isolate, "id must be a number");
+
+    return;
+  }
+
+  uint32_t id = static_cast<uint32_t>(args[0].As<Number>()->Value());
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  auto found = registry.find(id);
+
+  if (found == registry.end()) {
+    args.GetReturnValue().Set(false);
+
+    return;
+  }
+  found->second->Stop();
+  args.GetReturnValue().Set(true);
+}
+
+}  // namespace beam
+
+NODE_MODULE_INIT(/* exports, module, context */) {
+  NODE_SET_METHOD(exports, "startUpload", beam::StartUploadMethod);
+  NODE_SET_METHOD(exports, "cancelUpload", beam::CancelUploadMethod);
+}
@@ -0,0 +1,123 @@
+const assert = require('assert');
+const canvas = require('./build/Release/cCanvasHelper');
+
+const box = (x, y, width, height) => ({ x, y, width, height });
+
+// createSpatialIndex: hit tests and rubber-band queries in document order
+{
+  const index = canvas.createSpatialIndex();
+  index.insert('svg_1', box(0, 0, 10, 10));
+  index.insert('svg_2', box(5, 5, 10, 10));
+  index.insert('svg_3', box(100, 100, 1, 1));
+  index.insert('svg_0', box(8, 8, 1, 1), -1);
+  assert.deepStrictEqual(index.queryPoint(8.5, 8.5), ['svg_0', 'svg_1', 'svg_2']);
+  assert.deepStrictEqual(index.queryPoint(16, 5), []);
+  assert.deepStrictEqual(index.queryPoint(16, 5, { tolerance: 1 }), ['svg_2']);
+  assert.deepStrictEqual(index.queryRect(box(-1, -1, 12, 12)), ['svg_0', 'svg_1', 'svg_2']);
+  assert.deepStrictEqual(index.queryRect(box(-1, -1, 12, 12), { contained: true }), ['svg_0', 'svg_1']);
+  assert.deepStrictEqual(index.unionBBox(), box(0, 0, 101, 101));
+  assert.deepStrictEqual(index.unionBBox(['svg_1', 'svg_2', 'missing']), box(0, 0, 15, 15));
+  assert.strictEqual(index.unionBBox(['missing']), null);
+
+  assert.strictEqual(index.update('svg_3', box(20, 0, 5, 5)), true);
+  assert.strictEqual(index.update('missing', box(0, 0, 1, 1)), false);
+  assert.deepStrictEqual(index.unionBBox(), box(0, 0, 25, 15));
+  assert.strictEqual(index.remove('svg_2'), true);
+  assert.strictEqual(index.remove('svg_2'), false);
+  assert.deepStrictEqual(index.getBBox('svg_3'), box(20, 0, 5, 5));
+  assert.strictEqual(index.getBBox('svg_2'), null);
+  assert.deepStrictEqual(index.unionBBox(), box(0, 0, 25, 10));
+  assert.strictEqual(index.size(), 3);
+  assert.throws(() => index.insert('svg_4', box(0, 0, -1, 1)), TypeError);
+  assert.throws(() => index.insert(4, box(0, 0, 1, 1)), TypeError);
+}
+
+// createSpatialIndex: a loaded index stays exact through random edits
+{
+  const index = canvas.createSpatialIndex();
+  const boxes = new Map();
+  const random = () => box(Math.random() * 1000, Math.random() * 1000, Math.random() * 40, Math.random() * 40);
+  const ids = [];
+  const packed = new Float64Array(4 * 3000);
+  for (let i = 0; i < 3000; i += 1) {
+    const b = random();
+    ids.push(`svg_${i}`);
+    packed.set([b.x, b.y, b.width, b.height], 4 * i);
+    boxes.set(`svg_${i}`, b);
+  }
+  index.load(ids, packed);
+  for (let i = 0; i < 2000; i += 1) {
+    const id = `svg_${Math.floor(Math.random() * 3500)}`;
+    if (i % 4 === 0) {
+      assert.strictEqual(index.remove(id), boxes.delete(id));
+    } else {
+      const b = random();
+      index.insert(id, b);
+      boxes.set(id, b);
+    }
+  }
+  const rect = box(300, 200, 250, 400);
+  const expected = [...boxes]
+    .filter(([, b]) => b.x <= 550 && b.x + b.width >= 300 && b.y <= 600 && b.y + b.height >= 200)
+    .map(([id]) => id)
+    .sort();
+  assert.deepStrictEqual(index.queryRect(rect).sort(), expected);
+  assert.strictEqual(index.size(), boxes.size);
+  const all = [...boxes.values()];
+  const minX = Math.min(...all.map((b) => b.x));
+  const maxX = Math.max(...all.map((b) => b.x + b.width));
+  const union = index.unionBBox();
+  assert.strictEqual(union.x, minX);
+  assert.ok(Math.abs(union.x + union.width - maxX) < 1e-9);
+  assert.throws(() => index.load(['a'], new Float64Array(3)), TypeError);
+}
+
+// createSnapIndex: same align points as findNearestAndFarthestAlignPoints
+{
+  // Straight port of the editor's search, as a reference.
+  const reference = (points, target, dimension, fuzzyRange) => {
+    const sub = dimension === 'x' ? 'y' : 'x';
+    const window = points.filter((p) => Math.abs(p[dimension] - target[dimension]) <= fuzzyRange);
+    if (window.length === 0) return [null, null];
+    const distance = (p) => Math.abs(p[sub] - target[sub]);
+    const nearest = window.reduce((prev, curr) => (distance(prev) < distance(curr) ? prev : curr));
+    const dir = nearest[sub] - target[sub];
+    const farthest = window
+      .filter((p) => (p[sub] - target[sub]) * dir > 0 && p[dimension] === nearest[dimension])
+      .reduce((prev, curr) => (distance(prev) > distance(curr) ? prev : curr), nearest);
+    return [nearest, farthest];
+  };
+  // Integer coordinates on the matched axis so points line up; fractional ones on the other so distances never tie.
+  const randomPoint = () => ({ x: Math.floor(Math.random() * 200), y: Math.floor(Math.random() * 200) + Math.random() });
+  const pack = (points) => new Float64Array(points.flatMap((p) => [p.x, p.y]));
+  const points = [];
+  for (let i = 0; i < 2000; i += 1) points.push(randomPoint());
+  const index = canvas.createSnapIndex();
+  index.load(pack(points.slice(0, 1500)));
+  index.add(pack(points.slice(1500)));
+  const removed = points.splice(0, 300);
+  assert.strictEqual(index.remove(pack([...removed, { x: -5, y: -5 }])), 300);
+  assert.strictEqual(index.size(), points.length);
+
+  const targets = [];
+  for (let i = 0; i < 500; i += 1) targets.push({ x: Math.random() * 220 - 10, y: Math.random() * 220 - 10 });
+  const out = new Float64Array(8 * targets.length);
+  assert.strictEqual(index.findAlignPoints(pack(targets), 0.5, out), out);
+  targets.forEach((target, i) => {
+    const byX = [...points].sort((a, b) => a.x - b.x);
+    const byY = [...points].sort((a, b) => a.y - b.y);
+    const expectedX = reference(byX, target, 'x', 0.5);
+    const expectedY = reference(byY, target, 'y', 0.5);
+    const actual = Array.from(out.subarray(8 * i, 8 * i + 8));
+    const flat = [...expectedX, ...expectedY].flatMap((p) => (p ? [p.x, p.y] : [NaN, NaN]));
+    assert.deepStrictEqual(actual, flat);
+  });
+
+  const empty = canvas.createSnapIndex();
+  assert.ok(empty.findAlignPoints(new Float64Array([1, 2]), 8).every(Number.isNaN));
+  assert.throws(() => empty.add(new Float64Array(3)), TypeError);
+  assert.throws(() => empty.findAlignPoints(new Float64Array(2), 8, new Float64Array(4)), TypeError);
+  assert.throws(() => empty.findAlignPoints.call(canvas.createSpatialIndex(), new Float64Array(2), 8), TypeError);
+}
+
+console.log('canvas tests passed');
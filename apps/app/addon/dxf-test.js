@@ -0,0 +1,280 @@
+const assert = require('assert');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const dxfHelper = require('./build/Release/cDxfHelper');
+
+// Group code / value pairs as a DXF writer lays them out.
+const groups = (...pairs) => {
+  const lines = [];
+  for (let i = 0; i < pairs.length; i += 2) lines.push(String(pairs[i]).padStart(3), String(pairs[i + 1]));
+  return lines.join('\r\n');
+};
+const drawing = ({ header = '', tables = '', blocks = '', entities = '' }) =>
+  [
+    groups(0, 'SECTION', 2, 'HEADER', 9, '$ACADVER', 1, 'AC1027', 9, '$INSUNITS', 70, 4),
+    header,
+    groups(0, 'ENDSEC', 0, 'SECTION', 2, 'TABLES', 0, 'TABLE', 2, 'LAYER', 70, 2),
+    tables,
+    groups(0, 'ENDTAB', 0, 'ENDSEC', 0, 'SECTION', 2, 'BLOCKS'),
+    blocks,
+    groups(0, 'ENDSEC', 0, 'SECTION', 2, 'ENTITIES'),
+    entities,
+    groups(0, 'ENDSEC', 0, 'EOF'),
+  ]
+    .filter(Boolean)
+    .join('\r\n');
+
+const importDxf = (data, options, onProgress) =>
+  new Promise((resolve) => {
+    const id = dxfHelper.startDxfImport(data, options, { onProgress, onDone: resolve });
+    assert.strictEqual(typeof id, 'number');
+  });
+
+// Subpaths of a layer back in drawing coordinates: [{ points: [[x, y], ...], closed }].
+const subpaths = (result, layer) => {
+  const { commands, coords } = layer;
+  const output = [];
+  let c = 0;
+  for (const command of commands) {
+    if (command === 5) {
+      output[output.length - 1].closed = true;
+      continue;
+    }
+    const point = [coords[c] + result.bounds.minX, result.bounds.maxY - coords[c + 1]];
+    c += 2;
+    if (command === 0) output.push({ points: [point], closed: false });
+    else output[output.length - 1].points.push(point);
+  }
+  assert.strictEqual(c, coords.length);
+  return output;
+};
+const near = (actual, expected, tolerance = 1e-9) =>
+  assert.ok(
+    actual.every((value, i) => Math.abs(value - expected[i]) <= tolerance),
+    `${actual} != ${expected}`,
+  );
+
+(async () => {
+  // Lines meeting end to start join into one subpath; colors come from the entity or the layer table.
+  {
+    const result = await importDxf(
+      Buffer.from(
+        drawing({
+          tables: groups(0, 'LAYER', 2, 'Cut', 70, 0, 62, 1, 0, 'LAYER', 2, 'White', 62, 7),
+          entities: [
+            groups(0, 'LINE', 8, 'Cut', 10, 0, 20, 0, 11, 10, 21, 0),
+            groups(0, 'LINE', 8, 'Cut', 10, 10, 20, 0, 11, 10, 21, 5),
+            groups(0, 'LINE', 8, 'Cut', 10, 10, 20, 5, 11, 0, 21, 0),
+            groups(0, 'LINE', 8, 'White', 62, 5, 10, 20, 20, 20, 11, 30, 21, 20),
+            groups(0, 'LINE', 8, 'White', 10, 40, 20, 20, 11, 50, 21, 20),
+            groups(0, 'MTEXT', 8, 'Cut', 10, 0, 20, 0, 1, 'label'),
+          ].join('\r\n'),
+        }),
+      ),
+    );
+    assert.strictEqual(result.ok, true, result.error);
+    assert.strictEqual(result.version, 'AC1027');
+    assert.strictEqual(result.insunits, 4);
+    assert.deepStrictEqual(result.bounds, { minX: 0, minY: 0, maxX: 50, maxY: 20, width: 50, height: 20 });
+    assert.strictEqual(result.entities, 5);
+    assert.strictEqual(result.skipped, 1);
+    assert.deepStrictEqual(
+      result.layers.map(({ name, color, entities }) => [name, color, entities]),
+      [
+        ['Cut', '#FF0000', 3],
+        ['White', '#0000FF', 2],
+      ],
+    );
+    assert.deepStrictEqual(Array.from(result.layers[0].commands), [0, 1, 1, 5]);
+    assert.deepStrictEqual(Array.from(result.layers[0].coords), [0, 20, 10, 20, 10, 15]);
+    assert.deepStrictEqual(result.layers[0].bounds, { minX: 0, minY: 15, maxX: 10, maxY: 20, width: 10, height: 5 });
+    assert.deepStrictEqual(Array.from(result.layers[1].commands), [0, 1, 0, 1]);
+  }
+
+  // Bulges, old-style polylines, ellipses, splines and mirrored arcs, flattened within the tolerance.
+  {
+    const tolerance = 0.01;
+    const result = await importDxf(
+      Buffer.from(
+        drawing({
+          entities: [
+          groups(0, 'LWPOLYLINE', 8, 'A', 90, 2, 70, 1, 10, 0, 20, 0, 42, 1, 10, 10, 20, 0, 42, 1),
+          groups(0, 'POLYLINE', 8, 'B', 66, 1, 70, 0, 10, 0, 20, 0),
+          groups(0, 'VERTEX', 8, 'B', 10, 0, 20, 20),
+          groups(0, 'VERTEX', 8, 'B', 10, 5, 20, 25, 70, 16),
+          groups(0, 'VERTEX', 8, 'B', 10, 10, 20, 20),
+          groups(0, 'SEQEND', 8, 'B'),
+          groups(0, 'ELLIPSE', 8, 'C', 10, 30, 20, 0, 11, 0, 21, 4, 40, 0.5, 41, 0, 42, 2 * Math.PI),
+          groups(0, 'SPLINE', 8, 'D', 70, 8, 71, 3, 72, 8, 73, 4, 40, 0, 40, 0, 40, 0, 40, 0, 40, 1, 40, 1, 40, 1),
+          groups(40, 1, 10, 40, 20, 0, 10, 41, 20, 3, 10, 44, 20, 3, 10, 45, 20, 0),
+          groups(0, 'ARC', 8, 'E', 10, 50, 20, 0, 40, 2, 50, 0, 51, 90, 210, 0, 220, 0, 230, -1),
+        ].join('\n'),
+        }),
+      ),
+      { tolerance },
+    );
+    assert.strictEqual(result.ok, true, result.error);
+    const [circle, polyline, ellipse, spline, arc] = result.layers.map((layer) => subpaths(result, layer));
+
+    assert.strictEqual(circle.length, 1);
+    assert.strictEqual(circle[0].closed, true);
+    assert.ok(circle[0].points.length > 20);
+    circle[0].points.forEach(([x, y]) => assert.ok(Math.abs(Math.hypot(x - 5, y) - 5) < 1e-9));
+    assert.ok(circle[0].points.some(([, y]) => y < -4.99) && circle[0].points.some(([, y]) => y > 4.99));
+
+    // The POLYLINE's own point only carries the elevation and the spline frame vertex (flag 16) is not drawn.
+    assert.deepStrictEqual(polyline, [
+      {
+        points: [
+          [0, 20],
+          [10, 20],
+        ],
+        closed: false,
+      },
+    ]);
+
+    assert.strictEqual(ellipse[0].closed, true);
+    ellipse[0].points.forEach(([x, y]) => assert.ok(Math.abs(((x - 30) / 2) ** 2 + (y / 4) ** 2 - 1) < 1e-9));
+
+    near(spline[0].points[0], [40, 0]);
+    near(spline[0].points[spline[0].points.length - 1], [45, 0]);
+    spline[0].points.forEach(([x, y]) => assert.ok(x >= 40 && x <= 45 && y >= 0 && y <= 2.25 + 1e-9));
+
+    // Extrusion (0, 0, -1) mirrors the arc's object coordinates in x.
+    near(arc[0].points[0], [-52, 0]);
+    near(arc[0].points[arc[0].points.length - 1], [-50, 2]);
+  }
+
+  // Inserts: base point, scale, rotation and arrays, layer 0 and BYBLOCK colors inherited, cycles skipped.
+  {
+    const result = await importDxf(
+      Buffer.from(
+        drawing({
+        blocks: [
+          groups(0, 'BLOCK', 8, '0', 2, 'Tick', 70, 0, 10, 1, 20, 1),
+          groups(0, 'LINE', 8, '0', 62, 0, 10, 1, 20, 1, 11, 2, 21, 1),
+          groups(0, 'LINE', 8, 'Own', 10, 1, 20, 1, 11, 1, 21, 2),
+          groups(0, 'ENDBLK', 8, '0'),
+          groups(0, 'BLOCK', 2, 'Loop', 10, 0, 20, 0),
+          groups(0, 'INSERT', 8, '0', 2, 'Loop', 10, 1, 20, 0),
+          groups(0, 'ENDBLK'),
+          groups(0, 'BLOCK', 2, 'Nested', 10, 0, 20, 0),
+          groups(0, 'INSERT', 8, '0', 2, 'Tick', 10, 0, 20, 0, 41, 2, 42, 2),
+          groups(0, 'ENDBLK'),
+        ].join('\r\n'),
+        entities: [
+          groups(0, 'INSERT', 8, 'Marks', 62, 3, 2, 'Tick', 10, 10, 20, 10, 41, 2, 42, 2, 50, 90),
+          groups(0, 'INSERT', 8, 'Grid', 2, 'Tick', 10, 0, 20, 0, 70, 3, 71, 2, 44, 5, 45, 7),
+          groups(0, 'INSERT', 8, 'Grid', 2, 'Nested', 10, 100, 20, 100),
+          groups(0, 'INSERT', 8, 'Grid', 2, 'Loop', 10, 0, 20, 0),
+          groups(0, 'INSERT', 8, 'Grid', 2, 'Missing', 10, 0, 20, 0),
+        ].join('\r\n'),
+        }),
+      ),
+    );
+    assert.strictEqual(result.ok, true, result.error);
+    assert.deepStrictEqual(
+      result.layers.map(({ name, color, entities }) => [name, color, entities]),
+      [
+        ['Marks', '#00FF00', 1],
+        ['Own', '#000000', 8],
+        ['Grid', '#000000', 7],
+      ],
+    );
+    const [marks, own, grid] = result.layers.map((layer) => subpaths(result, layer));
+    // (1, 1) is the base point: it lands on the insertion point, +x turns to +y and scales by 2.
+    near(marks[0].points.flat(), [10, 10, 10, 12]);
+    near(own[0].points.flat(), [10, 10, 8, 10]);
+    assert.deepStrictEqual(
+      grid.map(({ points }) => points[0]),
+      [
+        [0, 0],
+        [5, 0],
+        [10, 0],
+        [0, 7],
+        [5, 7],
+        [10, 7],
+        [100, 100],
+      ],
+    );
+    near(grid[6].points[1], [102, 100]);
+    // The cycle through Loop is cut at the first repeat and the missing block is skipped.
+    assert.strictEqual(result.skipped, 2);
+  }
+
+  // Hatch boundaries and dimension blocks only on request.
+  {
+    const hatch = [
+      groups(0, 'HATCH', 8, 'Fill', 10, 0, 20, 0, 30, 0, 2, 'SOLID', 70, 1, 71, 0, 91, 2),
+      groups(92, 1, 93, 3, 72, 1, 10, 0, 20, 0, 11, 10, 21, 0, 72, 1, 10, 10, 20, 0, 11, 0, 21, 10),
+      groups(72, 2, 10, 0, 20, 0, 40, 10, 50, 90, 51, 0, 73, 0, 97, 0),
+      groups(92, 2, 72, 0, 73, 1, 93, 3, 10, 20, 20, 0, 10, 30, 20, 0, 10, 30, 20, 10, 97, 0),
+      groups(75, 0, 76, 1, 98, 1, 10, 5, 20, 5),
+    ].join('\n');
+    const line = groups(0, 'LINE', 8, 'Line', 10, 0, 20, 0, 11, 1, 21, 0);
+    const data = Buffer.from(drawing({ entities: `${hatch}\n${line}` }));
+    const without = await importDxf(data);
+    assert.deepStrictEqual(
+      without.layers.map(({ name }) => name),
+      ['Line'],
+    );
+    const withHatches = await importDxf(data, { hatches: true });
+    const loops = subpaths(withHatches, withHatches.layers[0]);
+    assert.deepStrictEqual(
+      loops.map(({ closed }) => closed),
+      [true, true],
+    );
+    // The clockwise arc edge runs from 90 degrees down to 0, closing the quarter disc.
+    near(loops[0].points[0], [0, 0]);
+    near(loops[0].points[1], [10, 0]);
+    near(loops[0].points[2], [0, 10]);
+    loops[0].points.slice(2).forEach(([x, y]) => assert.ok(Math.abs(Math.hypot(x, y) - 10) < 1e-9));
+    assert.ok(loops[0].points.length > 5);
+    near(loops[1].points.flat(), [20, 0, 30, 0, 30, 10]);
+  }
+
+  // Files, progress, scale and failures.
+  {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'dxf-test-'));
+    const file = path.join(dir, 'lines.dxf');
+    const lines = [];
+    for (let i = 0; i < 20000; i += 1) lines.push(groups(0, 'LINE', 8, `L${i % 3}`, 10, i, 20, 0, 11, i, 21, 1));
+    fs.writeFileSync(file, drawing({ entities: lines.join('\r\n') }));
+    const progress = [];
+    const fromFile = await importDxf(file, { scale: 10 }, (fraction) => progress.push(fraction));
+    assert.strictEqual(fromFile.ok, true, fromFile.error);
+    assert.strictEqual(fromFile.entities, 20000);
+    assert.deepStrictEqual(
+      fromFile.layers.map(({ name }) => name),
+      ['L0', 'L1', 'L2'],
+    );
+    assert.strictEqual(fromFile.bounds.width, 199990);
+    assert.strictEqual(fromFile.bounds.height, 10);
+    assert.ok(progress.length > 0);
+    assert.ok(progress.every((fraction, i) => fraction > 0 && fraction <= 1 && (!i || fraction >= progress[i - 1])));
+
+    const missing = await importDxf(path.join(dir, 'missing.dxf'));
+    assert.strictEqual(missing.ok, false);
+    assert.match(missing.error, /cannot open/);
+    const binary = await importDxf(Buffer.from('AutoCAD Binary DXF\r\n\x1a\0'));
+    assert.match(binary.error, /binary/);
+    assert.match((await importDxf(Buffer.from('%PDF-1.4\n'))).error, /not a DXF/);
+    assert.match((await importDxf(Buffer.from(`${groups(0, 'SECTION', 2, 'ENTITIES')}\nLINE\n8`))).error, /line 5/);
+    const empty = await importDxf(Buffer.from(groups(0, 'SECTION', 2, 'ENTITIES', 0, 'ENDSEC', 0, 'EOF')));
+    assert.strictEqual(empty.ok, true);
+    assert.deepStrictEqual(empty.layers, []);
+
+    const cancelled = new Promise((resolve) => {
+      const id = dxfHelper.startDxfImport(file, {}, { onDone: resolve });
+      assert.strictEqual(dxfHelper.cancelDxfImport(id), true);
+    });
+    assert.strictEqual((await cancelled).error, 'cancelled');
+    assert.strictEqual(dxfHelper.cancelDxfImport(12345), false);
+    assert.throws(() => dxfHelper.startDxfImport(42), TypeError);
+    assert.throws(() => dxfHelper.startDxfImport(file, { tolerance: 0 }), TypeError);
+    fs.rmSync(dir, { recursive: true });
+  }
+
+  console.log('dxf tests passed');
+})();
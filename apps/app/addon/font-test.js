@@ -0,0 +1,250 @@
+const assert = require('assert');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const fontHelper = require('./build/Release/cFontHelper');
+
+const fontsDir = path.join(__dirname, '../public/fonts');
+const trueType = fontHelper.loadFont(path.join(fontsDir, 'fontawesome-webfont.ttf'));
+const cff = fontHelper.loadFont(fs.readFileSync(path.join(fontsDir, 'FontAwesome.otf')));
+
+const bounds = ({ coords }, from = 0, to = coords.length) => {
+  const box = [Infinity, Infinity, -Infinity, -Infinity];
+  for (let i = from; i < to; i += 2) {
+    box[0] = Math.min(box[0], coords[i]);
+    box[1] = Math.min(box[1], coords[i + 1]);
+    box[2] = Math.max(box[2], coords[i]);
+    box[3] = Math.max(box[3], coords[i + 1]);
+  }
+  return box;
+};
+const assertClose = (actual, expected, tolerance) =>
+  actual.forEach((value, i) => assert.ok(Math.abs(value - expected[i]) <= tolerance, `${actual} vs ${expected}`));
+// Coordinates used by commands [from, to), with path-buffer.h arities.
+const coordIndex = (commands, to) => {
+  const arity = [2, 2, 4, 6, 7, 0];
+  let index = 0;
+  for (let i = 0; i < to; i += 1) index += arity[commands[i]];
+  return index;
+};
+
+// Metadata and character map: Font Awesome maps its icons into the private use area.
+for (const font of [trueType, cff]) {
+  assert.strictEqual(font.familyName, 'FontAwesome');
+  assert.strictEqual(font.postscriptName, 'FontAwesome');
+  assert.strictEqual(font.subfamilyName, 'Regular');
+  assert.strictEqual(font.unitsPerEm, 1792);
+  assert.strictEqual(font.ascender, 1536);
+  assert.strictEqual(font.descender, -256);
+  const { glyphs, clusters, advances } = font.layout('\uf000 \uf001\ud800A');
+  assert.ok(glyphs[0] > 0 && glyphs[1] > 0 && glyphs[2] > 0);
+  assert.deepStrictEqual(Array.from(glyphs.slice(3)), [0, 0], 'lone surrogates and unmapped characters use .notdef');
+  assert.deepStrictEqual(Array.from(clusters), [0, 1, 2, 3, 4]);
+  assert.deepStrictEqual(Array.from(advances.slice(0, 3)), [1792, 448, 1536]);
+}
+
+// TrueType quadratics and CFF cubics describe the same icons.
+{
+  const icons = '\uf000\uf001\uf002\uf015\uf0c9';
+  const quadratic = trueType.textToPath(icons, { fontSize: 100 });
+  const cubic = cff.textToPath(icons, { fontSize: 100 });
+  assert.ok(quadratic.commands.includes(2) && !quadratic.commands.includes(3));
+  assert.ok(cubic.commands.includes(3) && !cubic.commands.includes(2));
+  assert.strictEqual(quadratic.commands[0], 0);
+  assert.strictEqual(quadratic.commands[quadratic.commands.length - 1], 5);
+  assert.strictEqual(cubic.commands[cubic.commands.length - 1], 5);
+  assertClose(bounds(cubic), bounds(quadratic), 0.5);
+  assertClose(bounds(quadratic, 0, coordIndex(quadratic.commands, 26)), [5.19, -78.57, 94.81, 14.29], 0.01);
+  assert.strictEqual(quadratic.advances[0], cubic.advances[0]);
+}
+
+// Batches, baseline origin, letter spacing and y-down output.
+{
+  const one = trueType.textToPath('\uf000', { fontSize: 100 });
+  const options = { fontSize: 100, x: 10, y: 200, letterSpacing: 5 };
+  const batch = trueType.textToPath(['\uf000', '', '\uf000\uf000'], options);
+  const n = one.commands.length;
+  assert.deepStrictEqual(Array.from(batch.offsets), [0, n, n, 3 * n]);
+  assert.deepStrictEqual(Array.from(batch.advances), [105, 0, 210]);
+  assert.strictEqual(batch.coords.length, 3 * one.coords.length);
+  for (let i = 0; i < one.coords.length; i += 2) {
+    assert.ok(Math.abs(batch.coords[i] - one.coords[i] - 10) < 1e-9);
+    assert.ok(Math.abs(batch.coords[i + 1] - one.coords[i + 1] - 200) < 1e-9);
+    assert.ok(Math.abs(batch.coords[2 * one.coords.length + i] - one.coords[i] - 115) < 1e-9);
+  }
+  assert.ok(bounds(one)[1] < 0, 'glyphs rise above the baseline towards negative y');
+  const small = trueType.textToPath('\uf000', { fontSize: 10 });
+  assertClose(Array.from(small.coords), Array.from(one.coords, (v) => v / 10), 1e-9);
+}
+
+// Individually placed glyphs, e.g. along a text path.
+{
+  const glyph = trueType.layout('\uf000').glyphs;
+  const upright = trueType.glyphPath(glyph, new Float64Array([0, 0, 0]), { fontSize: 100 });
+  const turned = trueType.glyphPath(glyph, new Float64Array([50, 60, 90]), { fontSize: 100 });
+  const [minX, minY, maxX, maxY] = bounds(upright);
+  assertClose(bounds(turned), [50 - maxY, 60 + minX, 50 - minY, 60 + maxX], 1e-9);
+  assert.deepStrictEqual(Array.from(turned.commands), Array.from(upright.commands));
+  assert.throws(() => trueType.glyphPath(glyph, new Float64Array(2)), TypeError);
+}
+
+// Many strings reuse the cached outlines.
+{
+  const names = Array.from({ length: 2000 }, (_, i) => `\uf000\uf001 ${i}`);
+  const start = process.hrtime.bigint();
+  const result = cff.textToPath(names, { fontSize: 12 });
+  const elapsed = Number(process.hrtime.bigint() - start) / 1e6;
+  assert.strictEqual(result.offsets.length, 2001);
+  assert.ok(elapsed < 1000, `batch took ${elapsed} ms`);
+}
+
+assert.throws(() => fontHelper.loadFont(Buffer.from('not a font at all')), /not a TrueType or OpenType font/);
+assert.throws(() => fontHelper.loadFont(Buffer.from('wOFF0000000000000000')), /WOFF/);
+assert.throws(() => fontHelper.loadFont(path.join(fontsDir, 'fontawesome-webfont.ttf'), { index: 1 }), /index/);
+assert.throws(() => fontHelper.loadFont(path.join(fontsDir, 'missing.ttf')));
+assert.throws(() => fontHelper.loadFont(42), TypeError);
+assert.throws(() => trueType.layout.call({}, 'a'), TypeError);
+assert.throws(() => trueType.textToPath([1]), TypeError);
+
+// Variable text production runs: serial numbers, CSV rows and dates formatted per piece.
+{
+  const run = { start: 0, end: 999, current: 998, count: 3, csv: [['a', 'b'], ['c']] };
+  const time = { time: Date.UTC(2024, 1, 29, 23, 5, 9, 7), utcOffset: 480 };
+  const { values, offsets } = fontHelper.generateVariableBatch(
+    [
+      { type: 1, content: 'No. 0ddd', font: trueType },
+      { type: 1, content: '0HHHH h', offset: 1, font: trueType },
+      { type: 3, content: '%0/%1/%12', font: trueType },
+      { type: 2, content: 'YYYY-MM-DD HH:mm:ss.SSS [at] ddd MMM A h Z ZZ', font: trueType },
+    ],
+    { ...run, ...time },
+  );
+  const date = '2024-03-01 07:05:09.007 at Fri Mar AM 7 +08:00 +0800';
+  assert.deepStrictEqual(values, [
+    ...['No. 998', '03E7 h', '//', date],
+    ...['No. 999', '0000 h', '//', date],
+    ...['No. 000', '0001 h', 'a/b/', date],
+  ]);
+  assert.strictEqual(offsets.length, 13);
+  const { values: named } = fontHelper.generateVariableBatch([{ type: 2, content: 'dddd D MMMM', font: trueType }], {
+    time: 0,
+    utcOffset: -90,
+    locale: { months: ['', '', '', '', '', '', '', '', '', '', '', 'Dezember'], weekdays: ['', '', '', 'Mittwoch'] },
+  });
+  assert.deepStrictEqual(named, ['Mittwoch 31 Dezember']);
+}
+
+// Each piece's text matches textToPath of its value, placed by the slot matrix.
+{
+  const slot = { type: 1, content: '\uf000 0d \uf001', font: trueType, fontSize: 50, letterSpacing: 3 };
+  const batch = fontHelper.generateVariableBatch([{ ...slot, matrix: [1, 0, 0, 1, 10, 20] }], { current: 5, count: 2 });
+  const expected = trueType.textToPath(['\uf000 5 \uf001', '\uf000 6 \uf001'], { ...slot, x: 10, y: 20 });
+  assert.deepStrictEqual(Array.from(batch.offsets), Array.from(expected.offsets));
+  assert.deepStrictEqual(Array.from(batch.commands), Array.from(expected.commands));
+  assertClose(Array.from(batch.coords), Array.from(expected.coords), 1e-9);
+  assert.ok(batch.commands.length > 0);
+  const one = trueType.textToPath('\uf000', { fontSize: 10 });
+  const lines = fontHelper.generateVariableBatch([
+    { content: '\uf000\u0085\uf000', font: trueType, fontSize: 10, lineSpacing: 1.5, align: 'end' },
+  ]);
+  const [left, top, right, bottom] = bounds(one);
+  assertClose(bounds(lines), [left - one.advances[0], top, right - one.advances[0], bottom + 15], 1e-9);
+}
+
+// QR codes and barcodes as rectangles, in the units of the editor's generated SVGs.
+{
+  const qr = fontHelper.generateVariableBatch([{ code: 'qrcode', content: 'HELLO WORLD' }]);
+  let dark = 0;
+  for (let i = 0; i < qr.coords.length; i += 8) dark += qr.coords[i + 2] - qr.coords[i];
+  assert.deepStrictEqual(bounds(qr), [0, 0, 21, 21]);
+  assert.deepStrictEqual(Array.from(qr.coords.slice(0, 8)), [0, 0, 7, 0, 7, 1, 0, 1], 'finder pattern row');
+  assert.strictEqual(dark, 218);
+  const inverted = fontHelper.generateVariableBatch([
+    { code: 'qrcode', content: 'HELLO WORLD', invert: true, margin: 2 },
+  ]);
+  let light = 0;
+  for (let i = 0; i < inverted.coords.length; i += 8) light += inverted.coords[i + 2] - inverted.coords[i];
+  assert.strictEqual(light, 25 * 25 - 218);
+  assert.ok(bounds(fontHelper.generateVariableBatch([{ code: 'qrcode', content: 'x'.repeat(500) }]))[2] > 21);
+
+  // Start C, four digit pairs, check symbol and stop: 6 * 11 + 13 modules two units wide, inside a 10 unit margin.
+  const barcode = fontHelper.generateVariableBatch([{ code: 'barcode', content: '12345678' }]);
+  assert.deepStrictEqual(bounds(barcode), [10, 10, 10 + 2 * 79, 110]);
+  assert.deepStrictEqual(Array.from(barcode.coords.slice(0, 8)), [10, 10, 14, 10, 14, 110, 10, 110]);
+  // Start B, H, i, code A, newline, 1, code C, 23, 45, check and stop.
+  const mixed = fontHelper.generateVariableBatch([{ code: 'barcode', content: 'Hi\n12345', width: 1, margin: 0 }]);
+  assert.deepStrictEqual(bounds(mixed), [0, 0, 10 * 11 + 13, 100]);
+  const invertedBars = fontHelper.generateVariableBatch([{ code: 'barcode', content: '12345678', invert: true }]);
+  assert.deepStrictEqual(bounds(invertedBars), [0, 0, 20 + 2 * 79, 120]);
+  assert.strictEqual(fontHelper.generateVariableBatch([{ code: 'barcode', content: '' }]).commands.length, 0);
+}
+
+assert.throws(() => fontHelper.generateVariableBatch([{ code: 'barcode', content: 'café' }]), /piece 0, slot 0/);
+assert.throws(() => fontHelper.generateVariableBatch([{ code: 'barcode', content: '123', format: 'CODE128C' }]));
+assert.throws(() => fontHelper.generateVariableBatch([{ code: 'qrcode', content: 'x'.repeat(3000) }]), /QR code/);
+assert.throws(() => fontHelper.generateVariableBatch([{ content: 'x', font: {} }]), /slots\[0\]: font/);
+assert.throws(() => fontHelper.generateVariableBatch([{ content: 'x', code: 'ean13' }]), TypeError);
+assert.throws(() => fontHelper.generateVariableBatch([], { count: 1.5 }), TypeError);
+
+// Installed font index: a scan, the cached image and an incremental rescan.
+(async () => {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'font-test-'));
+  const fontDir = path.join(dir, 'fonts');
+  const cachePath = path.join(dir, 'fonts.idx');
+  fs.mkdirSync(path.join(fontDir, 'nested'), { recursive: true });
+  fs.copyFileSync(path.join(fontsDir, 'fontawesome-webfont.ttf'), path.join(fontDir, 'a.ttf'));
+  fs.writeFileSync(path.join(fontDir, 'broken.otf'), 'not a font');
+  fs.writeFileSync(path.join(fontDir, 'notes.txt'), 'skipped');
+  const options = { directories: [fontDir, path.join(dir, 'missing')], cachePath };
+
+  const scanned = await fontHelper.openFontIndex(options);
+  assert.strictEqual(scanned.count, 1);
+  assert.strictEqual(scanned.fromCache, false);
+  assert.ok(fs.existsSync(cachePath));
+  const [face] = scanned.list();
+  assert.deepStrictEqual(face, {
+    path: path.join(fontDir, 'a.ttf'),
+    index: 0,
+    postscriptName: 'FontAwesome',
+    family: 'FontAwesome',
+    style: 'Regular',
+    weight: 400,
+    width: 5,
+    italic: false,
+    monospace: false,
+  });
+
+  const cached = await fontHelper.openFontIndex(options);
+  assert.strictEqual(cached.fromCache, true);
+  assert.deepStrictEqual(cached.list(), [face]);
+
+  fs.copyFileSync(path.join(fontsDir, 'FontAwesome.otf'), path.join(fontDir, 'nested', 'b.otf'));
+  const rescanned = await fontHelper.openFontIndex(options);
+  assert.strictEqual(rescanned.fromCache, false);
+  assert.strictEqual(rescanned.count, 2);
+  assert.deepStrictEqual(rescanned.findFonts({ family: 'FontAwesome' }).map((font) => path.basename(font.path)), [
+    'a.ttf',
+    'b.otf',
+  ]);
+  assert.deepStrictEqual(rescanned.findFonts({ family: 'FontAwesome', italic: true }), []);
+  assert.deepStrictEqual(rescanned.findFonts({ family: 'Missing' }), []);
+  assert.strictEqual(rescanned.findFont({ postscriptName: 'FontAwesome' }).path, face.path);
+  assert.strictEqual(rescanned.findFont({ family: 'FontAwesome', weight: 700 }).family, 'FontAwesome');
+  assert.strictEqual(rescanned.findFont({ family: 'Missing' }).family, 'FontAwesome', 'falls back to the first font');
+  assert.throws(() => rescanned.findFont.call({}, {}), TypeError);
+  // A font is a wrapped object too, but not an index.
+  assert.throws(() => rescanned.list.call(trueType), /must be called on a font index/);
+  assert.throws(() => trueType.layout.call(rescanned, 'a'), TypeError);
+
+  // A damaged cache is rebuilt; a different directory list does not reuse it.
+  fs.writeFileSync(cachePath, Buffer.alloc(64, 7));
+  assert.strictEqual((await fontHelper.openFontIndex(options)).count, 2);
+  const other = await fontHelper.openFontIndex({ directories: [path.join(fontDir, 'nested')], cachePath });
+  assert.strictEqual(other.fromCache, false);
+  assert.strictEqual(other.count, 1);
+  assert.strictEqual((await fontHelper.openFontIndex({ directories: [] })).findFont({ family: 'x' }), undefined);
+  assert.throws(() => fontHelper.openFontIndex({ directories: [1] }), TypeError);
+  fs.rmSync(dir, { recursive: true });
+
+  console.log('font tests passed');
+})();
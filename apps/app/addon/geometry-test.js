@@ -0,0 +1,197 @@
+const assert = require('assert');
+const geometry = require('./build/Release/cGeometryHelper');
+
+// fitPath: short runs stay as lines, same as bezier-fit-curve.spec.ts
+{
+  const { segments, offsets } = geometry.fitPath(new Float64Array([0, 0, 40, 60, -50, 90, 0, 200]));
+  assert.deepStrictEqual(Array.from(offsets), [0, 3]);
+  assert.deepStrictEqual(Array.from(segments.subarray(0, 5)), [0, 0, 0, 40, 60]);
+  assert.deepStrictEqual(Array.from(segments.subarray(18, 23)), [0, -50, 90, 0, 200]);
+}
+
+// fitPath: independent subpaths fitted to cubics with continuous end points
+{
+  const points = [];
+  for (let i = 0; i <= 200; i += 1) points.push(i, 50 * Math.sin(i / 20));
+  for (let i = 0; i <= 200; i += 1) points.push(100 * Math.cos(i / 32), 100 * Math.sin(i / 32));
+  const { segments, offsets } = geometry.fitPath(new Float64Array(points), new Uint32Array([0, 201, 402]));
+  assert.strictEqual(offsets.length, 3);
+  assert.ok(offsets[1] > 0 && offsets[2] > offsets[1]);
+  for (let i = offsets[0]; i < offsets[1] - 1; i += 1) {
+    const end = segments[i * 9] ? 7 : 3;
+    assert.strictEqual(segments[i * 9 + end], segments[(i + 1) * 9 + 1]);
+  }
+  assert.ok(segments.some((value, i) => i % 9 === 0 && value === 1));
+}
+
+// flattenPath: chords stay within tolerance of a circle drawn with two arcs
+{
+  const commands = new Uint8Array([0, 4, 4, 5, 0, 3]);
+  const coords = new Float64Array([
+    ...[100, 0],
+    ...[100, 100, 0, 0, 1, -100, 0],
+    ...[100, 100, 0, 0, 1, 100, 0],
+    ...[0, 0],
+    ...[0, 100, 100, 100, 100, 0],
+  ]);
+  const { points, offsets, closed } = geometry.flattenPath(commands, coords, { tolerance: 0.05 });
+  assert.strictEqual(offsets.length, 3);
+  assert.deepStrictEqual(Array.from(closed), [1, 0]);
+  for (let i = 1; i < offsets[1]; i += 1) {
+    const mx = (points[2 * i] + points[2 * i - 2]) / 2;
+    const my = (points[2 * i + 1] + points[2 * i - 1]) / 2;
+    assert.ok(100 - Math.hypot(mx, my) <= 0.05 + 1e-9);
+  }
+  assert.deepStrictEqual(Array.from(points.subarray(points.length - 2)), [100, 0]);
+  assert.throws(() => geometry.flattenPath(commands, new Float64Array(3)));
+}
+
+// simplifyPolyline: collinear points disappear, corners stay
+{
+  const points = new Float64Array([0, 0, 1, 0.01, 2, 0, 3, 0, 3, 1, 3, 2, 3, 3]);
+  const rdp = geometry.simplifyPolyline(points, undefined, { tolerance: 0.1 });
+  assert.deepStrictEqual(Array.from(rdp.points), [0, 0, 3, 0, 3, 3]);
+  const vw = geometry.simplifyPolyline(points, new Uint32Array([0, 4, 7]), { method: 'visvalingam', tolerance: 0.1 });
+  assert.deepStrictEqual(Array.from(vw.offsets), [0, 2, 4]);
+  assert.deepStrictEqual(Array.from(vw.points), [0, 0, 3, 0, 3, 1, 3, 3]);
+}
+
+// parsePath: relative, shorthand and implicit commands normalized to absolute lines and curves
+{
+  const { commands, coords, errorOffset } = geometry.parsePath('m1.5.5.5 1 1e1-2h5V0z l1 1 S 4 4 5 5 s1 1 2 2 T9 9');
+  assert.strictEqual(errorOffset, undefined);
+  assert.deepStrictEqual(Array.from(commands), [0, 1, 1, 1, 1, 5, 1, 3, 3, 2]);
+  assert.deepStrictEqual(
+    Array.from(coords),
+    [1.5, 0.5, 2, 1.5, 12, -0.5, 17, -0.5, 17, 0, 2.5, 1.5, 2.5, 1.5, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7, 9, 9],
+  );
+  assert.strictEqual(
+    geometry.serializePath(commands, coords),
+    'M1.5,0.5L2,1.5L12,-0.5L17,-0.5L17,0zL2.5,1.5C2.5,1.5 4,4 5,5C6,6 6,6 7,7Q7,7 9,9',
+  );
+  assert.strictEqual(
+    geometry.serializePath(commands, coords, { relative: true, precision: 0 }),
+    'm2,1l0,1l10,-3l5,0l0,1zl1,1c0,0 1,2 2,3c1,1 1,1 2,2q0,0 2,2',
+  );
+}
+
+// parsePath: arcs as cubics or kept, with the ellipse carried through a transform
+{
+  const quarter = geometry.parsePath('M0 0A10 10 0 0 1 20 0');
+  assert.deepStrictEqual(Array.from(quarter.commands), [0, 3, 3]);
+  const handle = (4 / 3) * Math.tan(Math.PI / 8) * 10;
+  [0, -handle, 10 - handle, -10, 10, -10].forEach((value, i) => {
+    assert.ok(Math.abs(quarter.coords[2 + i] - value) < 1e-9);
+  });
+  assert.deepStrictEqual(Array.from(quarter.coords.subarray(-2)), [20, 0]);
+
+  const d = 'M0 0a10 5 30 1020 0';
+  const matrix = [2, 0.5, 0, -1, 5, 5];
+  const kept = geometry.parsePath(d, { keepArcs: true, matrix });
+  const cubics = geometry.parsePath(d, { matrix: new Float64Array(matrix) });
+  assert.deepStrictEqual(Array.from(kept.commands), [0, 4]);
+  assert.deepStrictEqual(Array.from(kept.coords.subarray(-2)), [45, 15]);
+  const a = geometry.flattenPath(kept.commands, kept.coords, { tolerance: 0.001 }).points;
+  const b = geometry.flattenPath(cubics.commands, cubics.coords, { tolerance: 0.001 }).points;
+  for (let i = 0; i < a.length; i += 2) {
+    let best = Infinity;
+    for (let j = 2; j < b.length; j += 2) {
+      const [dx, dy] = [b[j] - b[j - 2], b[j + 1] - b[j - 1]];
+      const t = Math.max(0, Math.min(1, ((a[i] - b[j - 2]) * dx + (a[i + 1] - b[j - 1]) * dy) / (dx * dx + dy * dy)));
+      best = Math.min(best, Math.hypot(a[i] - b[j - 2] - t * dx, a[i + 1] - b[j - 1] - t * dy));
+    }
+    assert.ok(best < 0.01, `${a[i]},${a[i + 1]} is ${best} away`);
+  }
+  const arc = geometry.parsePath('M0 0A5 5 0 1 0 10 0', { keepArcs: true });
+  assert.strictEqual(geometry.serializePath(arc.commands, arc.coords), 'M0,0A5,5 0 1 0 10,0');
+}
+
+// serializePath: numbers print as svgedit's shortFloat, +value.toFixed(precision), exact halves included
+{
+  const values = [0.015625, -0.015625, 9.5, -9.5, 2.5, 0.125, -0.000001, 1e20, 123456.789, 0.5];
+  for (let i = 0; i < 500; i += 1) {
+    values.push(Math.round((Math.random() - 0.5) * 1e6) / 64, (Math.random() - 0.5) * 1e4);
+  }
+  for (const precision of [0, 2, 5]) {
+    const commands = new Uint8Array(values.length / 2).fill(1);
+    const d = geometry.serializePath(commands, new Float64Array(values), { precision });
+    const expected = values.map((value) => `${+value.toFixed(precision)}`);
+    assert.deepStrictEqual(d.slice(1).split(/L|,/), expected);
+  }
+}
+
+// parsePath: segments up to a syntax error are kept
+{
+  const broken = geometry.parsePath('M0 0L1 2 3');
+  assert.strictEqual(broken.errorOffset, 10);
+  assert.deepStrictEqual(Array.from(broken.coords), [0, 0, 1, 2]);
+  assert.strictEqual(geometry.parsePath('M0 0L1 2,L3 4').errorOffset, 9);
+  assert.strictEqual(geometry.parsePath('L0 0').commands.length, 0);
+  assert.deepStrictEqual(Array.from(geometry.parsePath(Buffer.from(' M1 2 ')).coords), [1, 2]);
+  assert.throws(() => geometry.parsePath('M0 0', { matrix: [1, 0, 0, 1] }), TypeError);
+  assert.throws(() => geometry.serializePath(new Uint8Array([1]), new Float64Array(1)), TypeError);
+}
+
+// framingHull: geometry cropped to the workarea, what reaches above it sets outOfBounds
+{
+  const commands = new Uint8Array([0, 1, 1, 1, 5, 0, 1]);
+  const coords = new Float64Array([10, 10, 20, 10, 20, 20, 10, 20, -5, -5, 30, 5]);
+  const options = { width: 100, height: 100, top: -50 };
+  const { points, outOfBounds } = geometry.framingHull(commands, coords, options);
+  assert.deepStrictEqual(Array.from(points), [10, 10, 12.5, 0, 30, 5, 20, 20, 10, 20]);
+  assert.strictEqual(outOfBounds, true);
+  assert.strictEqual(geometry.framingHull(commands.subarray(0, 5), coords.subarray(0, 8), options).outOfBounds, false);
+  const line = geometry.framingHull(new Uint8Array([0, 1]), new Float64Array([10, 0, 20, 0]), options);
+  assert.deepStrictEqual(Array.from(line.points), [10, 0, 20, 0]);
+  assert.strictEqual(line.outOfBounds, false);
+  const stroked = geometry.framingHull(new Uint8Array([0, 1]), new Float64Array([10, 0, 20, 0]), {
+    ...options,
+    strokeWidth: 2,
+  });
+  assert.strictEqual(stroked.points.length, 20);
+  assert.ok(stroked.points.every((value, i) => (i % 2 ? value >= 0 && value <= 1 : value >= 9 && value <= 21)));
+  assert.strictEqual(stroked.outOfBounds, true);
+  assert.throws(() => geometry.framingHull(commands, coords, { top: 1 }), TypeError);
+}
+
+// framingHull: a filled shape around the workarea covers it, scaled to mm
+{
+  const cover = geometry.framingHull(
+    new Uint8Array([0, 3, 1, 1, 5]),
+    new Float64Array([-10, -10, 50, -30, 150, 10, 210, -10, 210, 210, -10, 210]),
+    { width: 100, height: 50, scale: 10 },
+  );
+  assert.deepStrictEqual(Array.from(cover.points), [0, 0, 10, 0, 10, 5, 0, 5]);
+  const empty = geometry.framingHull(new Uint8Array([0, 1]), new Float64Array([200, 0, 300, 0]), { width: 100 });
+  assert.strictEqual(empty.points.length, 0);
+}
+
+// framingHull: every flattened point inside the workarea lies within the hull of random curves
+{
+  const commands = [];
+  const coords = [];
+  const random = () => Math.random() * 240 - 20;
+  for (let i = 0; i < 300; i += 1) {
+    commands.push(0, 3, 2, 1);
+    coords.push(random(), random(), random(), random(), random(), random(), random(), random());
+    coords.push(random(), random(), random(), random(), random(), random());
+  }
+  const path = [new Uint8Array(commands), new Float64Array(coords)];
+  const { points } = geometry.framingHull(...path, { width: 200, height: 150, tolerance: 0.01 });
+  const flat = geometry.flattenPath(...path, { tolerance: 0.01 }).points;
+  assert.ok(points.length >= 6);
+  for (let i = 0; i < points.length; i += 2) {
+    assert.ok(points[i] >= 0 && points[i] <= 200 && points[i + 1] >= 0 && points[i + 1] <= 150);
+  }
+  for (let i = 0; i < flat.length; i += 2) {
+    if (flat[i] < 0 || flat[i] > 200 || flat[i + 1] < 0 || flat[i + 1] > 150) continue;
+    for (let j = 0; j < points.length; j += 2) {
+      const k = (j + 2) % points.length;
+      const dx = points[k] - points[j];
+      const dy = points[k + 1] - points[j + 1];
+      assert.ok(dx * (flat[i + 1] - points[j + 1]) - dy * (flat[i] - points[j]) >= -0.05 * Math.hypot(dx, dy));
+    }
+  }
+}
+
+console.log('geometry tests passed');
@@ -0,0 +1,72 @@
+const assert = require('assert');
+const imageHelper = require('./build/Release/cImageHelper');
+
+// 32x16 RGB 4:2:0 frame with a restart marker after every MCU.
+const frame = Buffer.from(
+  '/9j/4AAQSkZJRgABAQAAAQABAAD/2wBDAAgGBgcGBQgHBwcJCQgKDBQNDAsLDBkSEw8UHRofHh0aHBwgJC4nICIsIxwcKDcpLDAxNDQ0Hyc5PTgy' +
+  'PC4zNDL/2wBDAQkJCQwLDBgNDRgyIRwhMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjIyMjL/wAARCAAQACAD' +
+  'ASIAAhEBAxEB/8QAHwAAAQUBAQEBAQEAAAAAAAAAAAECAwQFBgcICQoL/8QAtRAAAgEDAwIEAwUFBAQAAAF9AQIDAAQRBRIhMUEGE1FhByJxFDKB' +
+  'kaEII0KxwRVS0fAkM2JyggkKFhcYGRolJicoKSo0NTY3ODk6Q0RFRkdISUpTVFVWV1hZWmNkZWZnaGlqc3R1dnd4eXqDhIWGh4iJipKTlJWWl5iZ' +
+  'mqKjpKWmp6ipqrKztLW2t7i5usLDxMXGx8jJytLT1NXW19jZ2uHi4+Tl5ufo6erx8vP09fb3+Pn6/8QAHwEAAwEBAQEBAQEBAQAAAAAAAAECAwQF' +
+  'BgcICQoL/8QAtREAAgECBAQDBAcFBAQAAQJ3AAECAxEEBSExBhJBUQdhcRMiMoEIFEKRobHBCSMzUvAVYnLRChYkNOEl8RcYGRomJygpKjU2Nzg5' +
+  'OkNERUZHSElKU1RVVldYWVpjZGVmZ2hpanN0dXZ3eHl6goOEhYaHiImKkpOUlZaXmJmaoqOkpaanqKmqsrO0tba3uLm6wsPExcbHyMnK0tPU1dbX' +
+  '2Nna4uPk5ebn6Onq8vP09fb3+Pn6/90ABAAB/9oADAMBAAIRAxEAPwDyiDQunyV2EGhdPkruYNC6fJVWDQunyV2Vc1/1Z6+09p/27bl/8Cvfm8tj' +
+  'xMvzv21tbWP/0OOg0Lp8ldjBoXT5K7iDQunyVVg0Pp8lYVc1/wBWevtPaf8AbtuX/wACvfm8tj3svzv21tbWP//Z',  'base64',
+);
+
+(async () => {
+  assert.deepStrictEqual(imageHelper.validateJpeg(frame), { width: 32, height: 16, components: 3, progressive: false });
+  assert.deepStrictEqual(imageHelper.validateJpeg(new Uint8Array(frame).buffer).width, 32);
+  assert.strictEqual(imageHelper.validateJpeg(frame.subarray(0, frame.length - 20)), null);
+  assert.strictEqual(imageHelper.validateJpeg(Buffer.from('not a jpeg at all')), null);
+  assert.throws(() => imageHelper.validateJpeg('frame'), TypeError);
+
+  const progressive = Buffer.from(frame);
+  progressive[progressive.indexOf(Buffer.from([0xff, 0xc0])) + 1] = 0xc2;
+  assert.strictEqual(imageHelper.validateJpeg(progressive).progressive, true);
+  await assert.rejects(imageHelper.processJpeg(progressive), /progressive/);
+
+  // Whole-MCU transforms round-trip exactly.
+  const base = await imageHelper.processJpeg(frame);
+  assert.strictEqual(base.lossless, true);
+  assert.deepStrictEqual([base.width, base.height], [32, 16]);
+  assert.deepStrictEqual(imageHelper.validateJpeg(base.jpeg), imageHelper.validateJpeg(frame));
+  for (const key of ['decodeMs', 'transformMs', 'encodeMs']) assert.ok(base[key] >= 0, key);
+  const turned = await imageHelper.processJpeg(frame, { rotate: 90 });
+  assert.strictEqual(turned.lossless, true);
+  assert.deepStrictEqual([turned.width, turned.height], [16, 32]);
+  const back = await imageHelper.processJpeg(turned.jpeg, { rotate: -90 });
+  assert.deepStrictEqual(Buffer.from(back.jpeg), Buffer.from(base.jpeg));
+  const flipped = await imageHelper.processJpeg(frame, { rotate: 180 });
+  const unflipped = await imageHelper.processJpeg(flipped.jpeg, { rotate: 540 });
+  assert.deepStrictEqual(Buffer.from(unflipped.jpeg), Buffer.from(base.jpeg));
+  const half = await imageHelper.processJpeg(frame, { crop: { x: 16, y: 0, width: 16, height: 16 } });
+  assert.strictEqual(half.lossless, true);
+  assert.deepStrictEqual(imageHelper.validateJpeg(half.jpeg).width, 16);
+
+  // Anything else is resampled and encoded again.
+  const crop = { x: 3, y: 5, width: 20, height: 8 };
+  const cropped = await imageHelper.processJpeg(frame, { crop });
+  assert.strictEqual(cropped.lossless, false);
+  assert.deepStrictEqual(imageHelper.validateJpeg(cropped.jpeg), {
+    width: 20,
+    height: 8,
+    components: 3,
+    progressive: false,
+  });
+  assert.deepStrictEqual((await imageHelper.processJpeg(frame, { crop })).jpeg, cropped.jpeg);
+  const small = await imageHelper.processJpeg(frame, { scale: 2, rotate: 270 });
+  assert.strictEqual(small.lossless, false);
+  assert.deepStrictEqual([small.width, small.height], [8, 16]);
+  await imageHelper.processJpeg(small.jpeg);
+
+  await assert.rejects(imageHelper.processJpeg(frame, { crop: { x: 20, y: 0, width: 16, height: 16 } }), /outside/);
+  await assert.rejects(imageHelper.processJpeg(frame.subarray(0, 300)));
+  assert.throws(() => imageHelper.processJpeg(42), TypeError);
+  assert.throws(() => imageHelper.processJpeg(frame, 'rotate'), TypeError);
+  assert.throws(() => imageHelper.processJpeg(frame, { scale: 3 }), TypeError);
+  assert.throws(() => imageHelper.processJpeg(frame, { rotate: 45 }), TypeError);
+  assert.throws(() => imageHelper.processJpeg(frame, { crop: { x: 0, y: 0, width: 1.5, height: 2 } }), TypeError);
+
+  console.log('image tests passed');
+})();
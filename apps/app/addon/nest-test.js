@@ -0,0 +1,95 @@
+const assert = require('assert');
+const nest = require('./build/Release/cNestHelper');
+
+const rect = (x, y, w, h) => [x, y, x + w, y, x + w, y + h, x, y + h];
+const lShape = [0, 0, 40, 0, 40, 10, 10, 10, 10, 40, 0, 40];
+
+const transform = (points, placement) => {
+  const [, , x, y, rotation] = placement;
+  const angle = (rotation * Math.PI) / 180;
+  const result = [];
+  for (let i = 0; i < points.length; i += 2) {
+    const px = points[i];
+    const py = points[i + 1];
+    result.push(px * Math.cos(angle) - py * Math.sin(angle) + x, px * Math.sin(angle) + py * Math.cos(angle) + y);
+  }
+  return result;
+};
+
+const bbox = (points) => {
+  const xs = points.filter((_, i) => i % 2 === 0);
+  const ys = points.filter((_, i) => i % 2 === 1);
+  return { minX: Math.min(...xs), maxX: Math.max(...xs), minY: Math.min(...ys), maxY: Math.max(...ys) };
+};
+
+const run = (container, parts, config) =>
+  new Promise((resolve) => {
+    const points = new Float64Array(parts.flat());
+    const offsets = [0];
+    parts.forEach((part) => offsets.push(offsets[offsets.length - 1] + part.length / 2));
+    let progressCalls = 0;
+    nest.startNest(new Float64Array(container), points, new Uint32Array(offsets), config, {
+      onProgress: () => {
+        progressCalls += 1;
+      },
+      onDone: (result) => resolve({ result, progressCalls }),
+    });
+  });
+
+(async () => {
+  // Eight 25x25 squares fit in a 100x50 bin without overlapping.
+  {
+    const parts = Array.from({ length: 8 }, () => rect(0, 0, 25, 25));
+    const { result, progressCalls } = await run(rect(0, 0, 100, 50), parts, { maxGenerations: 3, seed: 1 });
+    assert.strictEqual(result.unplaced, 0);
+    assert.strictEqual(result.bins, 1);
+    assert.strictEqual(result.placements.length, 8 * 5);
+    assert.ok(progressCalls > 0);
+    const boxes = [];
+    for (let i = 0; i < result.placements.length; i += 5) {
+      const placement = result.placements.subarray(i, i + 5);
+      const box = bbox(transform(parts[placement[0]], placement));
+      assert.ok(box.minX > -1e-6 && box.minY > -1e-6 && box.maxX < 100 + 1e-6 && box.maxY < 50 + 1e-6);
+      boxes.forEach((other) => {
+        const overlapX = Math.min(box.maxX, other.maxX) - Math.max(box.minX, other.minX);
+        const overlapY = Math.min(box.maxY, other.maxY) - Math.max(box.minY, other.minY);
+        assert.ok(overlapX < 1e-6 || overlapY < 1e-6);
+      });
+      boxes.push(box);
+    }
+  }
+
+  // Concave parts interlock: four 40x40 L shapes pair up into a 100 wide strip, and spacing is kept to the wall.
+  {
+    const parts = Array.from({ length: 4 }, () => lShape);
+    const { result } = await run(rect(0, 0, 200, 40), parts, { maxGenerations: 10, seed: 7, rotations: 2 });
+    assert.strictEqual(result.unplaced, 0);
+    let maxX = 0;
+    for (let i = 0; i < result.placements.length; i += 5) {
+      maxX = Math.max(maxX, bbox(transform(lShape, result.placements.subarray(i, i + 5))).maxX);
+    }
+    assert.ok(maxX <= 100 + 1e-6, `width ${maxX}`);
+
+    const spaced = await run(rect(0, 0, 200, 60), parts, { maxGenerations: 1, spacing: 5 });
+    for (let i = 0; i < spaced.result.placements.length; i += 5) {
+      const box = bbox(transform(lShape, spaced.result.placements.subarray(i, i + 5)));
+      assert.ok(box.minX > 5 - 1e-6 && box.minY > 5 - 1e-6);
+    }
+  }
+
+  // Parts that do not fit are reported, and stopNest ends an unbounded run.
+  {
+    const { result } = await run(rect(0, 0, 30, 30), [rect(0, 0, 20, 20), rect(0, 0, 50, 50)], { maxGenerations: 1 });
+    assert.strictEqual(result.unplaced, 1);
+
+    const done = new Promise((resolve) => {
+      const id = nest.startNest(new Float64Array(rect(0, 0, 100, 100)), new Float64Array(rect(0, 0, 10, 10)), undefined,
+        {}, { onDone: resolve });
+      setTimeout(() => assert.ok(nest.stopNest(id)), 50);
+    });
+    await done;
+    assert.strictEqual(nest.stopNest(12345), false);
+  }
+
+  console.log('nest tests passed');
+})();
@@ -0,0 +1,359 @@
+const assert = require('assert');
+const dgram = require('dgram');
+const net = require('net');
+const networkHelper = require('./build/Release/cNetworkHelper');
+
+const probe = (hosts, options, onStart) =>
+  new Promise((resolve) => {
+    const progress = [];
+    const id = networkHelper.startProbe(hosts, options, {
+      onProgress: (event) => progress.push(event),
+      onDone: (result) => resolve({ ...result, progress }),
+    });
+    if (onStart) onStart(id);
+  });
+const listen = () =>
+  new Promise((resolve) => {
+    const server = net.createServer((socket) => socket.destroy()).listen(0, '127.0.0.1', () => resolve(server));
+  });
+
+const udpSocket = (port = 0) =>
+  new Promise((resolve) => {
+    const socket = dgram.createSocket('udp4');
+    socket.bind(port, '127.0.0.1', () => resolve(socket));
+  });
+const freeUdpPort = async () => {
+  const socket = await udpSocket();
+  const { port } = socket.address();
+  await new Promise((resolve) => socket.close(resolve));
+  return port;
+};
+const waitFor = async (predicate) => {
+  for (let i = 0; i < 200 && !predicate(); i += 1) await new Promise((resolve) => setTimeout(resolve, 10));
+  assert.ok(predicate());
+};
+const discovery = (options) => {
+  const session = { changes: [], done: null };
+  session.id = networkHelper.startDiscovery(options, {
+    onChange: (change) => session.changes.push(change),
+    onDone: (result) => (session.done = result),
+  });
+  session.stop = async () => {
+    assert.strictEqual(networkHelper.stopDiscovery(session.id), true);
+    await waitFor(() => session.done);
+    return session.done;
+  };
+  return session;
+};
+// DNS names and records for a fake mDNS responder; a name may also be a compression pointer.
+const dnsName = (name) =>
+  Buffer.concat([...name.split('.').map((label) => Buffer.from([label.length, ...Buffer.from(label)])), Buffer.of(0)]);
+const dnsRecord = (name, type, ttl, data) => {
+  const header = Buffer.alloc(10);
+  header.writeUInt16BE(type, 0);
+  header.writeUInt16BE(1, 2);
+  header.writeUInt32BE(ttl, 4);
+  header.writeUInt16BE(data.length, 8);
+  return Buffer.concat([typeof name === 'string' ? dnsName(name) : name, header, data]);
+};
+
+(async () => {
+  const server = await listen();
+  const open = server.address().port;
+  const closedServer = await listen();
+  const closed = closedServer.address().port;
+  await new Promise((resolve) => closedServer.close(resolve));
+
+  // TCP probes time the connect; the histogram, extremes and jitter agree with each other.
+  {
+    const { ok, results } = await probe(['127.0.0.1'], { method: 'tcp', ports: [open], count: 5, intervalMs: 10 });
+    const [result] = results;
+    assert.strictEqual(ok, true);
+    assert.deepStrictEqual([result.method, result.address, result.sent, result.received, result.loss], [
+      'tcp',
+      '127.0.0.1',
+      5,
+      5,
+      0,
+    ]);
+    assert.ok(result.minMs > 0 && result.minMs <= result.avgMs && result.avgMs <= result.maxMs);
+    assert.ok(result.jitterMs >= 0 && result.jitterMs <= result.maxMs - result.minMs);
+    assert.ok(result.histogram instanceof Uint32Array && result.histogram.length === 100);
+    assert.strictEqual(result.histogram.reduce((sum, count) => sum + count, 0), 5);
+  }
+
+  // A refused connection proves the host is up; a whole sweep runs concurrently on one thread.
+  {
+    const hosts = Array.from({ length: 200 }, (_, i) => `127.0.0.${i + 1}`);
+    const { results, elapsedMs } = await probe(hosts, { method: 'tcp', ports: [closed], count: 2, intervalMs: 200 });
+    assert.ok(results.every((result, i) => result.host === hosts[i] && result.received === 2));
+    assert.ok(elapsedMs < 2000);
+  }
+
+  // Probing by time, stopping at the first reply, and hosts that do not resolve.
+  {
+    const timed = await probe(['127.0.0.1'], { ports: [closed], count: 0, durationMs: 300, intervalMs: 20 });
+    const [result] = timed.results;
+    assert.ok(['icmp', 'tcp'].includes(result.method));
+    assert.ok(result.sent >= 10 && result.sent <= 16 && result.received === result.sent);
+    assert.ok(timed.progress.length > 0 && timed.progress.every((event) => event.fraction <= 1));
+
+    const first = await probe(['localhost'], { method: 'tcp', ports: [open], count: 5, untilReply: true });
+    assert.deepStrictEqual([first.results[0].sent, first.results[0].received], [1, 1]);
+
+    const missing = await probe(['no-such-host.invalid'], { count: 1 });
+    assert.deepStrictEqual([missing.ok, missing.results[0].sent, missing.results[0].loss], [true, 0, 1]);
+    assert.ok(/cannot resolve/.test(missing.results[0].error));
+    assert.strictEqual(missing.results[0].avgMs, null);
+  }
+
+  // Cancelling keeps the results so far.
+  {
+    let cancelled = false;
+    const result = await new Promise((resolve) => {
+      const id = networkHelper.startProbe(['127.0.0.1'], { ports: [closed], count: 0, durationMs: 10000 }, {
+        onProgress: () => {
+          if (!cancelled) cancelled = networkHelper.cancelProbe(id);
+        },
+        onDone: resolve,
+      });
+    });
+    assert.deepStrictEqual([cancelled, result.ok, result.error], [true, false, 'cancelled']);
+    assert.ok(result.results[0].sent >= 1);
+    assert.strictEqual(networkHelper.cancelProbe(12345), false);
+  }
+
+  // Announcements on a listen port: repeats are silent, new content is an update, silence past the TTL a removal.
+  {
+    const port = await freeUdpPort();
+    const sender = await udpSocket();
+    const session = discovery({ listenPorts: [port], ttlMs: 300, updateIntervalMs: 0 });
+    const send = (text) => sender.send(text, port, '127.0.0.1');
+    const key = `udp:127.0.0.1:${port}`;
+    await new Promise((resolve) => setTimeout(resolve, 50));
+
+    send('beamo ready');
+    await waitFor(() => session.changes.length === 1);
+    const [device] = session.changes[0].added;
+    assert.deepStrictEqual([device.key, device.source, device.address, device.port], [
+      key,
+      'udp',
+      '127.0.0.1',
+      sender.address().port,
+    ]);
+    assert.strictEqual(Buffer.from(device.payload).toString(), 'beamo ready');
+    send('beamo ready');
+    await new Promise((resolve) => setTimeout(resolve, 100));
+    assert.strictEqual(session.changes.length, 1);
+    send('beamo busy');
+    await waitFor(() => session.changes.length === 2);
+    assert.strictEqual(Buffer.from(session.changes[1].updated[0].payload).toString(), 'beamo busy');
+    await waitFor(() => session.changes.length === 3);
+    assert.deepStrictEqual(session.changes[2], { added: [], updated: [], removed: [key] });
+    assert.deepStrictEqual(await session.stop(), { ok: true });
+    sender.close();
+  }
+
+  // Pokes go out on schedule and on request; replies count as announcements.
+  {
+    const responder = await udpSocket();
+    const pokes = [];
+    responder.on('message', (message, from) => {
+      pokes.push(message.toString());
+      responder.send(`pong ${message}`, from.port, from.address);
+    });
+    const port = responder.address().port;
+    const session = discovery({ pokes: [{ host: '127.0.0.1', port, payload: 'poke' }], pokeIntervalMs: 60000 });
+    await waitFor(() => session.changes.length === 1);
+    const [device] = session.changes[0].added;
+    assert.deepStrictEqual([device.key, Buffer.from(device.payload).toString()], ['udp:127.0.0.1:0', 'pong poke']);
+    assert.strictEqual(networkHelper.pokeDiscovery(session.id, '127.0.0.1'), true);
+    await waitFor(() => pokes.length === 2);
+    await session.stop();
+    assert.strictEqual(networkHelper.pokeDiscovery(session.id, '127.0.0.1'), false);
+    responder.close();
+  }
+
+  // mDNS host and service answers, with compressed names, additional records and a goodbye.
+  {
+    const responder = await udpSocket();
+    const queries = [];
+    let querier = null;
+    const instance = 'Beamo 2._beam._tcp.local';
+    const respond = (to, ttl) => {
+      const header = Buffer.alloc(12);
+      header.writeUInt16BE(0x8400, 2);
+      [1, 2, 0, 3].forEach((count, i) => header.writeUInt16BE(count, 4 + 2 * i));
+      const srv = Buffer.concat([Buffer.from([0, 0, 0, 0, 0x1f, 0x40]), dnsName('beamo.local')]);
+      const txt = Buffer.concat(
+        ['model=fbm2', 'serial=B2'].map((text) => Buffer.from([text.length, ...Buffer.from(text)])),
+      );
+      const response = Buffer.concat([
+        header,
+        dnsName('_beam._tcp.local'),
+        Buffer.from([0, 12, 0, 1]),
+        dnsRecord('Printer.local', 1, 120, Buffer.from([10, 0, 0, 5])),
+        dnsRecord(Buffer.from([0xc0, 12]), 12, ttl, dnsName(instance)),
+        dnsRecord(instance, 33, 120, srv),
+        dnsRecord(instance, 16, 120, txt),
+        dnsRecord('beamo.local', 1, 120, Buffer.from([10, 0, 0, 6])),
+      ]);
+      responder.send(response, to.port, to.address);
+    };
+    responder.on('message', (message, from) => {
+      queries.push(message);
+      querier = from;
+      respond(from, 120);
+    });
+    const session = discovery({
+      mdnsHosts: ['printer.local'],
+      mdnsServices: ['_beam._tcp.local'],
+      mdnsAddress: '127.0.0.1',
+      mdnsPort: responder.address().port,
+    });
+    await waitFor(() => session.changes.length === 1);
+    assert.strictEqual(queries[0].readUInt16BE(4), 2);
+    const added = session.changes[0].added.sort((a, b) => a.key.localeCompare(b.key));
+    assert.deepStrictEqual(added, [
+      {
+        key: 'mdns:beamo 2._beam._tcp.local',
+        source: 'mdns',
+        address: '10.0.0.6',
+        port: 8000,
+        name: instance,
+        txt: ['model=fbm2', 'serial=B2'],
+      },
+      { key: 'mdns:printer.local', source: 'mdns', address: '10.0.0.5', port: 0, name: 'Printer.local', txt: [] },
+    ]);
+    respond(querier, 0);
+    await waitFor(() => session.changes.length === 2);
+    assert.deepStrictEqual(session.changes[1].removed, ['mdns:beamo 2._beam._tcp.local']);
+    await session.stop();
+    responder.close();
+  }
+
+  // A device with an identity is one entry over UDP and mDNS and across an address change, until every transport
+  // has said goodbye or gone quiet.
+  {
+    const port = await freeUdpPort();
+    const responder = await udpSocket();
+    const instance = 'Beamo 2._beam._tcp.local';
+    let querier = null;
+    const respond = (ttl) => {
+      const header = Buffer.alloc(12);
+      header.writeUInt16BE(0x8400, 2);
+      [0, 1, 0, 1].forEach((count, i) => header.writeUInt16BE(count, 4 + 2 * i));
+      const txt = Buffer.concat(
+        ['model=fbm2', 'Serial=B2'].map((text) => Buffer.from([text.length, ...Buffer.from(text)])),
+      );
+      const response = Buffer.concat([
+        header,
+        dnsRecord('_beam._tcp.local', 12, ttl, dnsName(instance)),
+        dnsRecord(instance, 16, 120, txt),
+      ]);
+      responder.send(response, querier.port, querier.address);
+    };
+    responder.on('message', (message, from) => {
+      querier = from;
+      respond(120);
+    });
+    const session = discovery({
+      listenPorts: [port],
+      mdnsServices: ['_beam._tcp.local'],
+      mdnsAddress: '127.0.0.1',
+      mdnsPort: responder.address().port,
+      identityFields: ['uuid', 'serial'],
+      identityOffset: 4,
+      identityLength: 2,
+      ttlMs: 500,
+      updateIntervalMs: 0,
+    });
+    await waitFor(() => session.changes.length === 1);
+    assert.deepStrictEqual(
+      session.changes[0].added.map((device) => [device.key, device.identity, device.source]),
+      [['id:b2', 'B2', 'mdns']],
+    );
+
+    const first = await udpSocket();
+    const moved = await new Promise((resolve) => {
+      const socket = dgram.createSocket('udp4');
+      socket.bind(0, '127.0.0.2', () => resolve(socket));
+    });
+    first.send('{"serial": "b2", "state": "idle"}', port, '127.0.0.1');
+    await waitFor(() => session.changes.length === 2);
+    assert.deepStrictEqual(session.changes[1].added, []);
+    assert.deepStrictEqual([session.changes[1].updated[0].key, session.changes[1].updated[0].source], ['id:b2', 'udp']);
+    moved.send('{"serial": "b2", "state": "idle"}', port, '127.0.0.1');
+    await waitFor(() => session.changes.length === 3);
+    assert.deepStrictEqual([session.changes[2].updated[0].key, session.changes[2].updated[0].address], [
+      'id:b2',
+      '127.0.0.2',
+    ]);
+    first.send(Buffer.from('FLUX\x01\x02'), port, '127.0.0.1');
+    await waitFor(() => session.changes.length === 4);
+    assert.strictEqual(session.changes[3].added[0].key, 'id:0102');
+
+    // The mDNS goodbye leaves the device heard over UDP; it goes once the announcements stop.
+    respond(0);
+    await new Promise((resolve) => setTimeout(resolve, 100));
+    assert.ok(session.changes.every((change) => !change.removed.includes('id:b2')));
+    await waitFor(() => session.changes.some((change) => change.removed.includes('id:b2')));
+    await session.stop();
+    [responder, first, moved].forEach((socket) => socket.close());
+  }
+
+  // A steady device heard on both transports in turn is added and merged once, then left alone.
+  {
+    const port = await freeUdpPort();
+    const responder = await udpSocket();
+    const sender = await udpSocket();
+    const instance = 'Beamo 3._beam._tcp.local';
+    responder.on('message', (message, from) => {
+      const header = Buffer.alloc(12);
+      header.writeUInt16BE(0x8400, 2);
+      [0, 1, 0, 1].forEach((count, i) => header.writeUInt16BE(count, 4 + 2 * i));
+      const txt = Buffer.from([9, ...Buffer.from('serial=B3')]);
+      const response = Buffer.concat([
+        header,
+        dnsRecord('_beam._tcp.local', 12, 120, dnsName(instance)),
+        dnsRecord(instance, 16, 120, txt),
+      ]);
+      responder.send(response, from.port, from.address);
+    });
+    const session = discovery({
+      listenPorts: [port],
+      mdnsServices: ['_beam._tcp.local'],
+      mdnsAddress: '127.0.0.1',
+      mdnsPort: responder.address().port,
+      mdnsIntervalMs: 50,
+      identityFields: ['serial'],
+      updateIntervalMs: 0,
+    });
+    const timer = setInterval(() => sender.send('{"serial": "B3"}', port, '127.0.0.1'), 50);
+    await new Promise((resolve) => setTimeout(resolve, 1000));
+    clearInterval(timer);
+    const changes = session.changes.flatMap(({ added, updated }) => [
+      ...added.map((device) => `added ${device.key}`),
+      ...updated.map((device) => `updated ${device.key}`),
+    ]);
+    assert.deepStrictEqual(changes, ['added id:b3', 'updated id:b3']);
+    await session.stop();
+    [responder, sender].forEach((socket) => socket.close());
+  }
+
+  assert.throws(() => networkHelper.startDiscovery(), TypeError);
+  assert.throws(() => networkHelper.startDiscovery({ listenPorts: [70000] }), TypeError);
+  assert.throws(() => networkHelper.startDiscovery({ pokes: [{ port: 1, payload: 5 }] }), TypeError);
+  assert.throws(() => networkHelper.startDiscovery({ ttlMs: 0 }), TypeError);
+  assert.throws(() => networkHelper.startDiscovery({ identityFields: [1] }), TypeError);
+  assert.throws(() => networkHelper.startDiscovery({ identityLength: 65 }), TypeError);
+  assert.throws(() => networkHelper.startProbe('127.0.0.1'), TypeError);
+  assert.throws(() => networkHelper.startProbe([1]), TypeError);
+  assert.throws(() => networkHelper.startProbe([], { count: 0 }), TypeError);
+  assert.throws(() => networkHelper.startProbe([], { method: 'udp' }), TypeError);
+  assert.throws(() => networkHelper.startProbe([], { ports: [0] }), TypeError);
+  assert.throws(() => networkHelper.startProbe([], { intervalMs: 0.5 }), TypeError);
+
+  server.close();
+  console.log('network tests passed');
+})();
@@ -0,0 +1,221 @@
+const assert = require('assert');
+const raster = require('./build/Release/cRasterHelper');
+
+// Packed path (path-buffer.h command codes) of a polygon, or of an open polyline.
+const polygon = (points, closed = true) => ({
+  commands: new Uint8Array([0, ...points.slice(1).map(() => 1), ...(closed ? [5] : [])]),
+  coords: new Float64Array(points.flat()),
+});
+const rect = (x, y, w, h) => polygon([[x, y], [x + w, y], [x + w, y + h], [x, y + h]]);
+const alphaAt = ({ pixels, width }, x, y) => pixels[4 * (y * width + x) + 3];
+const pixelAt = ({ pixels, width }, x, y) => Array.from(pixels.subarray(4 * (y * width + x), 4 * (y * width + x) + 4));
+const layerRaster = (items, options) => new Promise((resolve) => {
+  const bands = [];
+  raster.startLayerRaster(items, options, {
+    onBand: (band) => bands.push(band),
+    onDone: (result) => resolve({ ...result, bands }),
+  });
+});
+const totalAlpha = ({ pixels }) => pixels.reduce((sum, value, i) => (i % 4 === 3 ? sum + value / 255 : sum), 0);
+
+(async () => {
+  // Exact area coverage on fractional edges; the region maps document units to pixels.
+  {
+    const thumbnail = await raster.renderThumbnail([{ ...rect(2.5, 1, 4.75, 3), fill: 0x336699 }], {
+      x: 0,
+      y: 0,
+      width: 10,
+      height: 5,
+      pixelWidth: 20,
+    });
+    assert.deepStrictEqual([thumbnail.width, thumbnail.height, thumbnail.pixels.length], [20, 10, 800]);
+    assert.ok(thumbnail.pixels instanceof Uint8ClampedArray);
+    assert.deepStrictEqual(pixelAt(thumbnail, 8, 4), [0x33, 0x66, 0x99, 255]);
+    assert.strictEqual(alphaAt(thumbnail, 4, 4), 0);
+    assert.strictEqual(alphaAt(thumbnail, 5, 4), 255);
+    assert.strictEqual(alphaAt(thumbnail, 14, 4), 128);
+    assert.strictEqual(alphaAt(thumbnail, 15, 4), 0);
+    assert.strictEqual(alphaAt(thumbnail, 8, 8), 0);
+    assert.ok(Math.abs(totalAlpha(thumbnail) - 9.5 * 6) < 0.1);
+  }
+
+  // Fill rules, clipping and the background.
+  {
+    const rings = {
+      commands: new Uint8Array([0, 1, 1, 1, 5, 0, 1, 1, 1, 5]),
+      coords: new Float64Array([-10, 0, 8, 0, 8, 8, -10, 8, 2, 2, 6, 2, 6, 6, 2, 6]),
+    };
+    const options = { x: 0, y: 0, width: 8, height: 8, pixelWidth: 8 };
+    const nonzero = await raster.renderThumbnail([{ ...rings, fill: 0 }], options);
+    const evenodd = await raster.renderThumbnail([{ ...rings, fill: 0, fillRule: 'evenodd' }], options);
+    assert.strictEqual(alphaAt(nonzero, 0, 0), 255);
+    assert.strictEqual(alphaAt(nonzero, 4, 4), 255);
+    assert.strictEqual(alphaAt(evenodd, 4, 4), 0);
+    assert.strictEqual(totalAlpha(evenodd), 48);
+
+    const background = await raster.renderThumbnail([{ ...rect(0, 0, 4, 8), fill: 0xff0000, opacity: 0.5 }], {
+      ...options,
+      background: 0xffffff,
+    });
+    assert.deepStrictEqual(pixelAt(background, 6, 1), [255, 255, 255, 255]);
+    assert.deepStrictEqual(pixelAt(background, 1, 1), [255, 128, 128, 255]);
+  }
+
+  // Curves keep their area, less what the 0.2 px chords cut off. Strokes are strokeWidth thumbnail pixels wide.
+  {
+    const circle = {
+      commands: new Uint8Array([0, 4, 4, 5]),
+      coords: new Float64Array([10, 20, 10, 10, 0, 0, 1, 30, 20, 10, 10, 0, 0, 1, 10, 20]),
+    };
+    const options = { x: 0, y: 0, width: 40, height: 40, pixelWidth: 80 };
+    const disc = await raster.renderThumbnail([{ ...circle, fill: 0 }], options);
+    assert.ok(Math.abs(totalAlpha(disc) - Math.PI * 400) < 20);
+
+    const ring = await raster.renderThumbnail([{ ...circle, stroke: 0, strokeWidth: 2 }], options);
+    assert.ok(Math.abs(totalAlpha(ring) - 2 * Math.PI * 20 * 2) < 3);
+    assert.strictEqual(alphaAt(ring, 40, 40), 0);
+
+    const line = polygon([[1, 3], [7, 3], [7, 7]], false);
+    const small = { x: 0, y: 0, width: 10, height: 10, pixelWidth: 10 };
+    const thick = await raster.renderThumbnail([{ ...line, stroke: 0x00ff00, strokeWidth: 2 }], small);
+    assert.deepStrictEqual(pixelAt(thick, 3, 2), [0, 255, 0, 255]);
+    assert.strictEqual(alphaAt(thick, 3, 4), 0);
+    assert.strictEqual(alphaAt(thick, 0, 2), 0);
+    // The outer side of the corner is rounded.
+    assert.ok(alphaAt(thick, 7, 2) > 0 && alphaAt(thick, 7, 2) < 255);
+    const hairline = await raster.renderThumbnail([{ ...line, stroke: 0, strokeWidth: 0.5 }], small);
+    assert.ok(Math.abs(totalAlpha(hairline) - 0.5 * 10) < 0.5);
+    const none = await raster.renderThumbnail([{ ...line, stroke: 0, strokeWidth: 0 }, line], small);
+    assert.strictEqual(totalAlpha(none), 0);
+  }
+
+  // Images are placed by matrix, sampled bilinearly and box-filtered when shrunk.
+  {
+    const image = { pixels: new Uint8Array([255, 0, 0, 255, 0, 0, 255, 255]), width: 2, height: 1 };
+    const options = { x: 0, y: 0, width: 8, height: 4, pixelWidth: 8 };
+    const stretched = await raster.renderThumbnail([{ ...image, matrix: [4, 0, 0, 4, 0, 0] }], options);
+    assert.deepStrictEqual(pixelAt(stretched, 0, 2), [255, 0, 0, 255]);
+    assert.deepStrictEqual(pixelAt(stretched, 7, 2), [0, 0, 255, 255]);
+    assert.ok(pixelAt(stretched, 3, 2)[0] > pixelAt(stretched, 4, 2)[0]);
+    const faded = await raster.renderThumbnail([{ ...image, matrix: [2, 0, 0, 2, 1, 1], opacity: 0.5 }], options);
+    assert.strictEqual(alphaAt(faded, 0, 0), 0);
+    assert.strictEqual(alphaAt(faded, 2, 2), 128);
+
+    const checker = new Uint8Array(256 * 256 * 4);
+    for (let i = 0; i < 256 * 256; i += 1) checker.fill((i + (i >> 8)) % 2 ? 255 : 0, 4 * i, 4 * i + 3);
+    for (let i = 0; i < 256 * 256; i += 1) checker[4 * i + 3] = 255;
+    const shrunk = await raster.renderThumbnail([{ pixels: checker, width: 256, height: 256 }], {
+      x: 0,
+      y: 0,
+      width: 256,
+      height: 256,
+      pixelWidth: 16,
+    });
+    for (let i = 0; i < shrunk.pixels.length; i += 4) assert.ok(Math.abs(shrunk.pixels[i] - 128) <= 2);
+  }
+
+  // A few thousand paths render off the JS thread well within a save.
+  {
+    const items = [];
+    for (let i = 0; i < 5000; i += 1) {
+      const x = (i % 100) * 10;
+      const y = Math.floor(i / 100) * 10;
+      items.push({ ...rect(x, y, 8, 8), fill: i % 2 ? 0x000000 : null, stroke: 0x333333, strokeWidth: 1 });
+    }
+    const thumbnail = await raster.renderThumbnail(items, { x: 0, y: 0, width: 1000, height: 500, pixelWidth: 500 });
+    assert.deepStrictEqual([thumbnail.width, thumbnail.height], [500, 250]);
+    assert.ok(thumbnail.renderMs < 1000);
+  }
+
+  // Layer bitmaps stream in bands that put together match one render of the whole region, tile seams included.
+  {
+    const items = [];
+    for (let i = 0; i < 40; i += 1) {
+      items.push({ ...rect(3 + i * 17.3, 20 + (i % 7) * 9.1, 11.7, 30.2), fill: 0x204080, stroke: 0xff0000 });
+    }
+    items.push({ ...polygon([[0, 10], [700, 90], [350, 120]]), fill: 0x00ff00, opacity: 0.6, fillRule: 'evenodd' });
+    const region = { x: -5, y: 0, width: 720, height: 180 };
+    const whole = await raster.renderThumbnail(items, { ...region, pixelWidth: 1440 });
+    const layer = await layerRaster(items, { ...region, pixelWidth: 1440, pixelHeight: 360, bandHeight: 50 });
+    assert.strictEqual(layer.ok, true);
+    assert.deepStrictEqual([layer.width, layer.height], [whole.width, whole.height]);
+
+    const pixels = new Uint8ClampedArray(whole.pixels.length);
+    let next = 0;
+    for (const band of layer.bands) {
+      assert.ok(band.y >= next && band.y % 50 === 0 && band.pixels.length === band.height * 1440 * 4);
+      pixels.set(band.pixels, band.y * 1440 * 4);
+      next = band.y + band.height;
+    }
+    // The transparent bands below the drawing are skipped.
+    assert.deepStrictEqual(layer.bands.map((band) => band.y), [0, 50, 100, 150, 200]);
+    for (let i = 0; i < pixels.length; i += 1) assert.ok(Math.abs(pixels[i] - whole.pixels[i]) <= 1);
+
+    let [minX, minY, maxX, maxY] = [Infinity, Infinity, -1, -1];
+    for (let y = 0; y < 360; y += 1) {
+      for (let x = 0; x < 1440; x += 1) {
+        if (alphaAt(whole, x, y) === 0) continue;
+        [minX, minY, maxX, maxY] = [Math.min(minX, x), Math.min(minY, y), Math.max(maxX, x), Math.max(maxY, y)];
+      }
+    }
+    assert.deepStrictEqual(layer.bbox, { x: minX, y: minY, width: maxX - minX + 1, height: maxY - minY + 1 });
+
+    const outside = { ...region, x: 100, pixelWidth: 10, pixelHeight: 10 };
+    const empty = await layerRaster([{ ...rect(0, 0, 1, 1), fill: 0 }], outside);
+    assert.deepStrictEqual([empty.ok, empty.bbox, empty.bands.length], [true, null, 0]);
+  }
+
+  // A large layer bitmap keeps streaming while JS holds only the bands it is given, and can be cancelled.
+  {
+    const items = [];
+    for (let i = 0; i < 20000; i += 1) {
+      const x = (i % 200) * 3;
+      const y = Math.floor(i / 200) * 3;
+      items.push({ ...rect(x, y, 2, 2), fill: 0, stroke: 0x333333, strokeWidth: 1 });
+    }
+    const options = { x: 0, y: 0, width: 600, height: 300, pixelWidth: 12000, pixelHeight: 6000 };
+    let rows = 0;
+    const done = await new Promise((resolve) => {
+      raster.startLayerRaster(items, options, { onBand: (band) => (rows += band.height), onDone: resolve });
+    });
+    assert.deepStrictEqual([done.ok, rows], [true, 6000]);
+    assert.ok(done.renderMs < 10000);
+
+    let bands = 0;
+    const cancelled = await new Promise((resolve) => {
+      const id = raster.startLayerRaster(items, options, {
+        onBand: () => {
+          bands += 1;
+          if (bands === 1) assert.strictEqual(raster.cancelLayerRaster(id), true);
+        },
+        onDone: resolve,
+      });
+    });
+    assert.deepStrictEqual(cancelled, { ok: false, error: 'cancelled' });
+    assert.ok(bands < 6000 / 128);
+    assert.strictEqual(raster.cancelLayerRaster(12345), false);
+  }
+
+  assert.throws(() => raster.startLayerRaster([], { width: 1, height: 1, pixelWidth: 10 }), TypeError);
+  assert.throws(() => raster.startLayerRaster([], { width: 1, height: 1, pixelWidth: 1, pixelHeight: 1e6 }), TypeError);
+  const pixel = { width: 1, height: 1, pixelWidth: 1, pixelHeight: 1 };
+  assert.throws(() => raster.startLayerRaster([], { ...pixel, bandHeight: 0 }), TypeError);
+  assert.throws(() => raster.renderThumbnail({}, { width: 1, height: 1 }), TypeError);
+  assert.throws(() => raster.renderThumbnail([], { width: 0, height: 1 }), TypeError);
+  assert.throws(() => raster.renderThumbnail([], { width: 1, height: 1, pixelWidth: 1.5 }), TypeError);
+  assert.throws(() => raster.renderThumbnail([], { width: 1, height: 1, background: '#fff' }), TypeError);
+  assert.throws(() => raster.renderThumbnail([{ commands: new Uint8Array([1]), coords: new Float64Array(1) }], {
+    width: 1,
+    height: 1,
+  }), /items\[0\]: coords do not match/);
+  assert.throws(() => raster.renderThumbnail([{ ...rect(0, 0, 1, 1), fillRule: 'winding' }], {
+    width: 1,
+    height: 1,
+  }), TypeError);
+  assert.throws(() => raster.renderThumbnail([{ pixels: new Uint8Array(12), width: 2, height: 2 }], {
+    width: 1,
+    height: 1,
+  }), TypeError);
+
+  console.log('raster tests passed');
+})();
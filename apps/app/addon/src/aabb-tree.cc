@@ -0,0 +1,282 @@
+#include "aabb-tree.h"
+
+#include <algorithm>
+
+namespace beam {
+
+namespace {
+
+Bounds Combine(const Bounds& a, const Bounds& b) {
+  Bounds out = a;
+
+  out.Add(b);
+
+  return out;
+}
+
+// Half the perimeter: the 2D surface area heuristic.
+double Cost(const Bounds& box) { return box.IsEmpty() ? 0 : box.Width() + box.Height(); }
+
+bool Encloses(const Bounds& outer, const Bounds& inner) {
+  return outer.minX <= inner.minX && outer.minY <= inner.minY && inner.maxX <= outer.maxX && inner.maxY <= outer.maxY;
+}
+
+}  // namespace
+
+int32_t AabbTree::Allocate() {
+  if (free_ == kNull) {
+    nodes_.emplace_back();
+
+    return static_cast<int32_t>(nodes_.size() - 1);
+  }
+
+  int32_t index = free_;
+
+  free_ = nodes_[index].parent;
+  nodes_[index] = Node();
+
+  return index;
+}
+
+void AabbTree::Free(int32_t node) {
+  nodes_[node].parent = free_;
+  nodes_[node].height = kNull;
+  free_ = node;
+}
+
+int32_t AabbTree::Insert(const Bounds& box, uint32_t value) {
+  int32_t leaf = Allocate();
+
+  nodes_[leaf].box = box;
+  nodes_[leaf].value = value;
+  InsertLeaf(leaf);
+  leafCount_ += 1;
+
+  return leaf;
+}
+
+void AabbTree::Remove(int32_t leaf) {
+  RemoveLeaf(leaf);
+  Free(leaf);
+  leafCount_ -= 1;
+}
+
+void AabbTree::Update(int32_t leaf, const Bounds& box) {
+  Bounds old = nodes_[leaf].box;
+
+  nodes_[leaf].box = box;
+  if (Encloses(old, box) && nodes_[leaf].parent != kNull) {
+    Refit(nodes_[leaf].parent);
+
+    return;
+  }
+  RemoveLeaf(leaf);
+  InsertLeaf(leaf);
+}
+
+void AabbTree::Clear() {
+  nodes_.clear();
+  root_ = kNull;
+  free_ = kNull;
+  leafCount_ = 0;
+}
+
+void AabbTree::InsertLeaf(int32_t leaf) {
+  if (root_ == kNull) {
+    root_ = leaf;
+    nodes_[leaf].parent = kNull;
+
+    return;
+  }
+
+  // Walk down to the sibling that grows the total cost least (Box2D's descent).
+  Bounds box = nodes_[leaf].box;
+  int32_t index = root_;
+
+  while (!nodes_[index].IsLeaf()) {
+    const Node& node = nodes_[index];
+    double area = Cost(node.box);
+    double combined = Cost(Combine(node.box, box));
+    double cost = 2 * combined;
+    double inheritance = 2 * (combined - area);
+    auto descend = [&](int32_t child) {
+      double grown = Cost(Combine(nodes_[child].box, box));
+
+      return (nodes_[child].IsLeaf() ? grown : grown - Cost(nodes_[child].box)) + inheritance;
+    };
+    double cost1 = descend(node.child1);
+    double cost2 = descend(node.child2);
+
+    if (cost < cost1 && cost < cost2) break;
+    index = cost1 < cost2 ? node.child1 : node.child2;
+  }
+
+  int32_t sibling = index;
+  int32_t oldParent = nodes_[sibling].parent;
+  int32_t newParent = Allocate();
+
+  nodes_[newParent].parent = oldParent;
+  nodes_[newParent].box = Combine(box, nodes_[sibling].box);
+  nodes_[newParent].height = nodes_[sibling].height + 1;
+  nodes_[newParent].child1 = sibling;
+  nodes_[newParent].child2 = leaf;
+  nodes_[sibling].parent = newParent;
+  nodes_[leaf].parent = newParent;
+  if (oldParent == kNull) {
+    root_ = newParent;
+  } else if (nodes_[oldParent].child1 == sibling) {
+    nodes_[oldParent].child1 = newParent;
+  } else {
+    nodes_[oldParent].child2 = newParent;
+  }
+  Refit(nodes_[leaf].parent);
+}
+
+void AabbTree::RemoveLeaf(int32_t leaf) {
+  if (leaf == root_) {
+    root_ = kNull;
+
+    return;
+  }
+
+  int32_t parent = nodes_[leaf].parent;
+  int32_t grandParent = nodes_[parent].parent;
+  int32_t sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+
+  if (grandParent == kNull) {
+    root_ = sibling;
+    nodes_[sibling].parent = kNull;
+    Free(parent);
+
+    return;
+  }
+  if (nodes_[grandParent].child1 == parent) {
+    nodes_[grandParent].child1 = sibling;
+  } else {
+    nodes_[grandParent].child2 = sibling;
+  }
+  nodes_[sibling].parent = grandParent;
+  Free(parent);
+  Refit(grandParent);
+}
+
+void AabbTree::Refit(int32_t index) {
+  while (index != kNull) {
+    index = Balance(index);
+
+    Node& node = nodes_[index];
+
+    node.height = 1 + std::max(nodes_[node.child1].height, nodes_[node.child2].height);
+    node.box = Combine(nodes_[node.child1].box, nodes_[node.child2].box);
+    index = node.parent;
+  }
+}
+
+// Rotates the taller grandchild up when the children of `a` differ in height by more than one; returns the node that
+// now stands where `a` stood.
+int32_t AabbTree::Balance(int32_t a) {
+  Node& nodeA = nodes_[a];
+
+  if (nodeA.IsLeaf() || nodeA.height < 2) return a;
+
+  int32_t b = nodeA.child1;
+  int32_t c = nodeA.child2;
+  int32_t balance = nodes_[c].height - nodes_[b].height;
+
+  if (balance > 1 || balance < -1) {
+    // Promote the taller child `up` of `a`; `other` is the child that stays.
+    bool right = balance > 1;
+    int32_t up = right ? c : b;
+    int32_t f = nodes_[up].child1;
+    int32_t g = nodes_[up].child2;
+    Node& nodeUp = nodes_[up];
+
+    nodeUp.child1 = a;
+    nodeUp.parent = nodeA.parent;
+    nodeA.parent = up;
+    if (nodeUp.parent == kNull) {
+      root_ = up;
+    } else if (nodes_[nodeUp.parent].child1 == a) {
+      nodes_[nodeUp.parent].child1 = up;
+    } else {
+      nodes_[nodeUp.parent].child2 = up;
+    }
+
+    // The taller grandchild stays under `up`, the other one takes the promoted child's place under `a`.
+    int32_t keep = nodes_[f].height > nodes_[g].height ? f : g;
+    int32_t move = keep == f ? g : f;
+
+    nodeUp.child2 = keep;
+    if (right) {
+      nodeA.child2 = move;
+    } else {
+      nodeA.child1 = move;
+    }
+    nodes_[move].parent = a;
+    nodeA.box = Combine(nodes_[nodeA.child1].box, nodes_[nodeA.child2].box);
+    nodeA.height = 1 + std::max(nodes_[nodeA.child1].height, nodes_[nodeA.child2].height);
+    nodeUp.box = Combine(nodeA.box, nodes_[keep].box);
+    nodeUp.height = 1 + std::max(nodeA.height, nodes_[keep].height);
+
+    return up;
+  }
+
+  return a;
+}
+
+void AabbTree::Build(const std::vector<Bounds>& boxes, std::vector<int32_t>& leaves) {
+  Clear();
+  nodes_.reserve(boxes.size() * 2);
+  leaves.resize(boxes.size());
+  for (size_t i = 0; i < boxes.size(); i += 1) {
+    leaves[i] = Allocate();
+    nodes_[leaves[i]].box = boxes[i];
+    nodes_[leaves[i]].value = static_cast<uint32_t>(i);
+  }
+  leafCount_ = boxes.size();
+  if (boxes.empty()) return;
+
+  std::vector<int32_t> order(leaves);
+
+  root_ = BuildRange(order, 0, order.size());
+  nodes_[root_].parent = kNull;
+}
+
+// Splits at the median centre along the longer side of the range's centre bounds.
+int32_t AabbTree::BuildRange(std::vector<int32_t>& leaves, size_t begin, size_t end) {
+  if (end - begin == 1) return leaves[begin];
+
+  Bounds centres;
+
+  for (size_t i = begin; i < end; i += 1) {
+    const Bounds& box = nodes_[leaves[i]].box;
+
+    centres.Add(Vec2{box.minX + box.maxX, box.minY + box.maxY});
+  }
+
+  bool alongX = centres.Width() >= centres.Height();
+  size_t middle = begin + (end - begin) / 2;
+
+  std::nth_element(leaves.begin() + begin, leaves.begin() + middle, leaves.begin() + end, [&](int32_t a, int32_t b) {
+    const Bounds& boxA = nodes_[a].box;
+    const Bounds& boxB = nodes_[b].box;
+
+    return alongX ? boxA.minX + boxA.maxX < boxB.minX + boxB.maxX : boxA.minY + boxA.maxY < boxB.minY + boxB.maxY;
+  });
+
+  int32_t child1 = BuildRange(leaves, begin, middle);
+  int32_t child2 = BuildRange(leaves, middle, end);
+  int32_t node = Allocate();
+  Node& parent = nodes_[node];
+
+  parent.child1 = child1;
+  parent.child2 = child2;
+  parent.box = Combine(nodes_[child1].box, nodes_[child2].box);
+  parent.height = 1 + std::max(nodes_[child1].height, nodes_[child2].height);
+  nodes_[child1].parent = node;
+  nodes_[child2].parent = node;
+
+  return node;
+}
+
+}  // namespace beam
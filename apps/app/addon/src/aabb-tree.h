@@ -0,0 +1,88 @@
+// Dynamic bounding volume hierarchy over axis-aligned boxes, after Box2D's b2DynamicTree. Leaves keep their exact boxes
+// (no fattening), so every internal box is the exact union below it and the root box is the union of everything.
+#ifndef BEAM_ADDON_AABB_TREE_H_
+#define BEAM_ADDON_AABB_TREE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "polygon.h"
+
+namespace beam {
+
+class AabbTree {
+ public:
+  static constexpr int32_t kNull = -1;
+
+  // Adds a leaf carrying `value` and returns its node, stable until the leaf is removed. O(log n).
+  int32_t Insert(const Bounds& box, uint32_t value);
+  void Remove(int32_t leaf);
+  // Moves a leaf; a box that stays within the old one only refits the ancestors.
+  void Update(int32_t leaf, const Bounds& box);
+  // Replaces the whole tree by one built top-down from `boxes`, better balanced than inserting them one by one.
+  // leaves[i] receives the node of boxes[i], which carries the value i.
+  void Build(const std::vector<Bounds>& boxes, std::vector<int32_t>& leaves);
+  void Clear();
+
+  const Bounds& Box(int32_t leaf) const { return nodes_[leaf].box; }
+  uint32_t Value(int32_t leaf) const { return nodes_[leaf].value; }
+  size_t LeafCount() const { return leafCount_; }
+  // Union of all boxes, empty when there are none.
+  Bounds Union() const { return root_ == kNull ? Bounds() : nodes_[root_].box; }
+  int Height() const { return root_ == kNull ? 0 : nodes_[root_].height; }
+  size_t MemoryUsage() const { return nodes_.capacity() * sizeof(Node) + stack_.capacity() * sizeof(int32_t); }
+
+  // Calls fn(leaf) for every leaf whose box passes `test`, descending only into nodes whose box passes `enter`.
+  template <typename Enter, typename Test, typename Fn>
+  void Query(Enter&& enter, Test&& test, Fn&& fn) const {
+    if (root_ == kNull) return;
+    stack_.clear();
+    stack_.push_back(root_);
+    while (!stack_.empty()) {
+      const Node& node = nodes_[stack_.back()];
+      int32_t index = stack_.back();
+
+      stack_.pop_back();
+      if (node.IsLeaf()) {
+        if (test(node.box)) fn(index);
+      } else if (enter(node.box)) {
+        stack_.push_back(node.child2);
+        stack_.push_back(node.child1);
+      }
+    }
+  }
+
+ private:
+  struct Node {
+    Bounds box;
+    int32_t parent = kNull;
+    int32_t child1 = kNull;
+    int32_t child2 = kNull;
+    // 0 for leaves; kNull marks free nodes, whose `parent` links the free list.
+    int32_t height = 0;
+    uint32_t value = 0;
+
+    bool IsLeaf() const { return child1 == kNull; }
+  };
+
+  int32_t Allocate();
+  void Free(int32_t node);
+  void InsertLeaf(int32_t leaf);
+  void RemoveLeaf(int32_t leaf);
+  // Refits boxes and heights from `index` to the root, rotating unbalanced nodes on the way.
+  void Refit(int32_t index);
+  int32_t Balance(int32_t a);
+  int32_t BuildRange(std::vector<int32_t>& leaves, size_t begin, size_t end);
+
+  std::vector<Node> nodes_;
+  int32_t root_ = kNull;
+  int32_t free_ = kNull;
+  size_t leafCount_ = 0;
+  // Traversal stack reused across queries.
+  mutable std::vector<int32_t> stack_;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_AABB_TREE_H_
@@ -0,0 +1,49 @@
+// 2D affine transforms in SVG matrix order: [a c e; b d f] maps (x, y) to (a x + c y + e, b x + d y + f).
+#ifndef BEAM_ADDON_AFFINE_H_
+#define BEAM_ADDON_AFFINE_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "vec2.h"
+
+namespace beam {
+
+struct Affine {
+  double a = 1;
+  double b = 0;
+  double c = 0;
+  double d = 1;
+  double e = 0;
+  double f = 0;
+
+  Vec2 Apply(Vec2 p) const { return {a * p.x + c * p.y + e, b * p.x + d * p.y + f}; }
+
+  // This transform applied after `inner`.
+  Affine operator*(const Affine& inner) const {
+    return {a * inner.a + c * inner.b, b * inner.a + d * inner.b, a * inner.c + c * inner.d,
+            b * inner.c + d * inner.d, a * inner.e + c * inner.f + e, b * inner.e + d * inner.f + f};
+  }
+
+  // Largest singular value: how much the transform can stretch a chord.
+  double MaxScale() const {
+    double sum = a * a + b * b + c * c + d * d;
+    double determinant = a * d - b * c;
+
+    return std::sqrt((sum + std::sqrt(std::max(0.0, sum * sum - 4 * determinant * determinant))) / 2);
+  }
+
+  // All zeros when the transform is singular.
+  Affine Inverse() const {
+    double determinant = a * d - b * c;
+
+    if (determinant == 0) return {0, 0, 0, 0, 0, 0};
+
+    return {d / determinant, -b / determinant, -c / determinant, a / determinant, (c * f - d * e) / determinant,
+            (b * e - a * f) / determinant};
+  }
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_AFFINE_H_
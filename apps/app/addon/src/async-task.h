@@ -0,0 +1,107 @@
+// One-shot work on the libuv thread pool that settles a Promise on the JS thread. Subclasses do the work in Execute()
+// and build the resolved value in Result(); setting error_ rejects the promise instead. The task deletes itself
+// once the promise is settled.
+#ifndef BEAM_ADDON_ASYNC_TASK_H_
+#define BEAM_ADDON_ASYNC_TASK_H_
+
+#include <node.h>
+#include <uv.h>
+
+#include <string>
+
+namespace beam {
+
+class AsyncTask {
+ public:
+  virtual ~AsyncTask() = default;
+
+  AsyncTask(const AsyncTask&) = delete;
+  AsyncTask& operator=(const AsyncTask&) = delete;
+
+  // Must be called on the JS thread; takes ownership of `task`.
+  static v8::Local<v8::Promise> Queue(v8::Isolate* isolate, AsyncTask* task) {
+    v8::Local<v8::Promise> promise = Defer(isolate, task);
+
+    task->Start();
+
+    return promise;
+  }
+
+  // Like Queue(), but the work waits for Start(), so tasks that must run one after another do not hold thread pool
+  // threads while they wait. The caller owns `task` until then.
+  static v8::Local<v8::Promise> Defer(v8::Isolate* isolate, AsyncTask* task) {
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(context).ToLocalChecked();
+
+    task->isolate_ = isolate;
+    task->context_.Reset(isolate, context);
+    task->resolver_.Reset(isolate, resolver);
+    task->work_.data = task;
+
+    return resolver->GetPromise();
+  }
+
+  // JS thread; hands the task over to the thread pool.
+  void Start() { uv_queue_work(node::GetCurrentEventLoop(isolate_), &work_, OnWork, OnDone); }
+
+ protected:
+  AsyncTask() = default;
+
+  // Thread pool; must not touch V8.
+  virtual void Execute() = 0;
+  // JS thread, inside a handle and context scope; only called when error_ is empty. May throw and return an empty
+  // handle instead, which rejects the promise with the exception.
+  virtual v8::Local<v8::Value> Result(v8::Isolate* isolate) = 0;
+  // JS thread, once the promise is settled and before the task is deleted.
+  virtual void Settled() {}
+
+  std::string error_;
+
+ private:
+  static void OnWork(uv_work_t* work) { static_cast<AsyncTask*>(work->data)->Execute(); }
+
+  static void OnDone(uv_work_t* work, int status) {
+    AsyncTask* task = static_cast<AsyncTask*>(work->data);
+
+    // Cancelled during environment teardown; there is no JS left to notify.
+    if (status == UV_ECANCELED) {
+      delete task;
+
+      return;
+    }
+
+    v8::Isolate* isolate = task->isolate_;
+    v8::HandleScope handleScope(isolate);
+    v8::Local<v8::Context> context = task->context_.Get(isolate);
+    v8::Context::Scope contextScope(context);
+    // Drains microtasks on exit, so `await` continuations run right away.
+    node::CallbackScope callbackScope(isolate, v8::Object::New(isolate), {0, 0});
+    v8::Local<v8::Promise::Resolver> resolver = task->resolver_.Get(isolate);
+
+    if (task->error_.empty()) {
+      v8::TryCatch tryCatch(isolate);
+      v8::Local<v8::Value> result = task->Result(isolate);
+
+      if (result.IsEmpty()) {
+        resolver->Reject(context, tryCatch.Exception()).FromMaybe(false);
+      } else {
+        resolver->Resolve(context, result).FromMaybe(false);
+      }
+    } else {
+      v8::Local<v8::String> message = v8::String::NewFromUtf8(isolate, task->error_.c_str()).ToLocalChecked();
+
+      resolver->Reject(context, v8::Exception::Error(message)).FromMaybe(false);
+    }
+    task->Settled();
+    delete task;
+  }
+
+  uv_work_t work_;
+  v8::Isolate* isolate_ = nullptr;
+  v8::Global<v8::Context> context_;
+  v8::Global<v8::Promise::Resolver> resolver_;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_ASYNC_TASK_H_
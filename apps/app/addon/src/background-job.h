@@ -0,0 +1,99 @@
+// Long-running native work on a dedicated thread that reports back to JS through a uv_async_t.
+// The worker publishes state under its own lock and calls Notify(); uv coalesces notifications, so Deliver() always
+// sees the latest state on the JS thread. The job deletes itself after the final Deliver().
+#ifndef BEAM_ADDON_BACKGROUND_JOB_H_
+#define BEAM_ADDON_BACKGROUND_JOB_H_
+
+#include <node.h>
+#include <uv.h>
+
+#include <atomic>
+#include <thread>
+
+namespace beam {
+
+class BackgroundJob {
+ public:
+  explicit BackgroundJob(v8::Isolate* isolate) : isolate_(isolate) {
+    context_.Reset(isolate, isolate->GetCurrentContext());
+  }
+  virtual ~BackgroundJob() = default;
+
+  BackgroundJob(const BackgroundJob&) = delete;
+  BackgroundJob& operator=(const BackgroundJob&) = delete;
+
+  // Must be called on the JS thread.
+  void Start() {
+    uv_async_init(node::GetCurrentEventLoop(isolate_), &async_, OnAsync);
+    async_.data = this;
+    node::AddEnvironmentCleanupHook(isolate_, OnCleanup, this);
+    thread_ = std::thread([this]() {
+      Run();
+      finished_ = true;
+      uv_async_send(&async_);
+    });
+  }
+
+  // Asks Run() to return early; safe from any thread.
+  void Stop() { stop_ = true; }
+
+ protected:
+  // Worker thread. Should poll stop_ regularly.
+  virtual void Run() = 0;
+  // JS thread, inside a handle and context scope. `finished` is true exactly once, after Run() returned.
+  virtual void Deliver(v8::Isolate* isolate, bool finished) = 0;
+
+  void Notify() { uv_async_send(&async_); }
+
+  // Calls a JS callback the way node does for async work, draining microtasks afterwards.
+  void Call(v8::Isolate* isolate, const v8::Global<v8::Function>& callback, int argc, v8::Local<v8::Value>* argv) {
+    if (callback.IsEmpty()) return;
+
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+
+    node::MakeCallback(isolate, context->Global(), callback.Get(isolate), argc, argv, {0, 0});
+  }
+
+  std::atomic<bool> stop_{false};
+  v8::Isolate* isolate_;
+
+ private:
+  static void OnAsync(uv_async_t* handle) {
+    BackgroundJob* job = static_cast<BackgroundJob*>(handle->data);
+    v8::Isolate* isolate = job->isolate_;
+    v8::HandleScope handleScope(isolate);
+    v8::Local<v8::Context> context = job->context_.Get(isolate);
+    v8::Context::Scope contextScope(context);
+    bool finished = job->finished_;
+
+    job->Deliver(isolate, finished);
+    if (finished) job->Close();
+  }
+
+  // Environment teardown (window reload, app quit) while the job still runs.
+  static void OnCleanup(void* data) {
+    BackgroundJob* job = static_cast<BackgroundJob*>(data);
+
+    job->Stop();
+    job->Close();
+  }
+
+  void Close() {
+    if (closing_) return;
+    closing_ = true;
+    if (thread_.joinable()) thread_.join();
+    node::RemoveEnvironmentCleanupHook(isolate_, OnCleanup, this);
+    uv_close(reinterpret_cast<uv_handle_t*>(&async_),
+             [](uv_handle_t* handle) { delete static_cast<BackgroundJob*>(handle->data); });
+  }
+
+  v8::Global<v8::Context> context_;
+  uv_async_t async_;
+  std::thread thread_;
+  std::atomic<bool> finished_{false};
+  bool closing_ = false;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_BACKGROUND_JOB_H_
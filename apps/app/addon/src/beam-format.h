@@ -0,0 +1,86 @@
+// Layout constants and VINT coding of the .beam project container; the format is documented at the top of
+// packages/core/src/web/helpers/beam-file-helper.ts.
+#ifndef BEAM_ADDON_BEAM_FORMAT_H_
+#define BEAM_ADDON_BEAM_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace beam {
+
+constexpr size_t kBeamSignatureSize = 5;
+constexpr uint8_t kBeamSignature[kBeamSignatureSize - 1] = {'B', 'e', 'a', 'm'};
+constexpr uint8_t kBeamVersion2 = 2;
+constexpr uint8_t kBeamVersion3 = 3;
+constexpr size_t kMaxVintSize = 10;
+constexpr size_t kMaxImageIdSize = 255;
+
+enum BeamBlockType : uint8_t {
+  kBeamBlockEnd = 0,
+  kBeamBlockSvg = 1,
+  kBeamBlockImages = 2,
+  kBeamBlockThumbnail = 3,
+  kBeamBlockMisc = 4,
+  // Version 3 only: the deduplicated image bytes that the image table (block 2) points into.
+  kBeamBlockImageData = 5,
+};
+
+// Version 3 keeps the version 2 signature and header length, then replaces the header and block framing with an
+// offset index so every block can be reached without scanning:
+//
+//   header     VINT metadata length, metadata JSON, VINT block count, then per block:
+//              u8 type, u8 codec, VINT offset from the end of the header, VINT stored size, VINT decoded size
+//   block 2    per image: u8 id length, id, u64 little-endian XXH64 of the bytes, VINT offset into block 5, VINT size
+//   block 5    each distinct image once
+enum BeamCodec : uint8_t {
+  kBeamCodecStored = 0,
+  kBeamCodecLz4 = 1,
+};
+
+// Little-endian base-128: 7 value bits per byte, high bit set on every byte but the last.
+inline size_t VintSize(uint64_t value) {
+  size_t size = 1;
+
+  while (value > 127) {
+    value >>= 7;
+    size += 1;
+  }
+
+  return size;
+}
+
+inline size_t WriteVint(uint64_t value, uint8_t* out) {
+  size_t size = 0;
+
+  while (value > 127) {
+    out[size++] = static_cast<uint8_t>((value & 127) | 128);
+    value >>= 7;
+  }
+  out[size++] = static_cast<uint8_t>(value);
+
+  return size;
+}
+
+// Reads the VINT at *offset and advances past it. Returns false on truncated input or more than 64 value bits.
+inline bool ReadVint(const uint8_t* data, size_t size, size_t* offset, uint64_t* value) {
+  uint64_t result = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*offset >= size) return false;
+
+    uint8_t byte = data[(*offset)++];
+
+    result |= static_cast<uint64_t>(byte & 127) << shift;
+    if (byte < 128) {
+      *value = result;
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_BEAM_FORMAT_H_
@@ -0,0 +1,227 @@
+#include "beam-reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "beam-format.h"
+#include "lz4.h"
+
+namespace beam {
+
+namespace {
+
+// Reads a VINT length and checks that that many bytes follow it.
+bool ReadSpan(const uint8_t* data, size_t size, size_t* offset, ByteSpan* span) {
+  uint64_t length;
+
+  if (!ReadVint(data, size, offset, &length) || length > size - *offset) return false;
+  span->data = data + *offset;
+  span->size = static_cast<size_t>(length);
+  *offset += span->size;
+
+  return true;
+}
+
+BeamBlock StoredBlock(const ByteSpan& span) { return {true, kBeamCodecStored, span, span.size}; }
+
+bool ReadImageEntries(const ByteSpan& block, std::vector<BeamImageEntry>* images) {
+  size_t offset = 0;
+
+  while (offset < block.size) {
+    BeamImageEntry entry;
+    size_t idSize = block.data[offset];
+
+    offset += 1;
+    if (idSize > block.size - offset) return false;
+    entry.id = {block.data + offset, idSize};
+    offset += idSize;
+    if (!ReadSpan(block.data, block.size, &offset, &entry.data)) return false;
+    images->push_back(entry);
+  }
+
+  return true;
+}
+
+// Version 3 image table: ids with a hash and a range of the image data block.
+bool ReadImageTable(const ByteSpan& table, const ByteSpan& imageData, std::vector<BeamImageEntry>* images) {
+  size_t offset = 0;
+
+  while (offset < table.size) {
+    BeamImageEntry entry;
+    size_t idSize = table.data[offset];
+    uint64_t start;
+    uint64_t length;
+
+    offset += 1;
+    if (idSize + 8 > table.size - offset) return false;
+    entry.id = {table.data + offset, idSize};
+    offset += idSize;
+    for (int k = 0; k < 8; k += 1) entry.hash |= static_cast<uint64_t>(table.data[offset + k]) << (8 * k);
+    offset += 8;
+    if (!ReadVint(table.data, table.size, &offset, &start) || !ReadVint(table.data, table.size, &offset, &length) ||
+        start > imageData.size || length > imageData.size - start) {
+      return false;
+    }
+    entry.data = {imageData.data + start, static_cast<size_t>(length)};
+    images->push_back(entry);
+  }
+
+  return true;
+}
+
+bool ReadVersion3(const uint8_t* data, size_t size, const ByteSpan& header, size_t headerOffset, BeamReadMode mode,
+                  BeamIndex* index, std::string* error) {
+  size_t base = static_cast<size_t>(header.data + header.size - data);
+  uint64_t count;
+  BeamBlock table;
+  BeamBlock imageData;
+
+  if (!ReadVint(header.data, header.size, &headerOffset, &count)) {
+    *error = "invalid beam header";
+
+    return false;
+  }
+  for (uint64_t i = 0; i < count; i += 1) {
+    BeamBlock block;
+    uint64_t offset;
+    uint64_t stored;
+
+    if (header.size - headerOffset < 2) {
+      *error = "invalid beam header";
+
+      return false;
+    }
+
+    uint8_t type = header.data[headerOffset];
+
+    block.present = true;
+    block.codec = header.data[headerOffset + 1];
+    headerOffset += 2;
+    if (!ReadVint(header.data, header.size, &headerOffset, &offset) ||
+        !ReadVint(header.data, header.size, &headerOffset, &stored) ||
+        !ReadVint(header.data, header.size, &headerOffset, &block.size)) {
+      *error = "invalid beam header";
+
+      return false;
+    }
+    if (offset > size - base || stored > size - base - offset ||
+        (block.codec == kBeamCodecStored && stored != block.size)) {
+      *error = "truncated beam block";
+
+      return false;
+    }
+    block.stored = {data + base + offset, static_cast<size_t>(stored)};
+    // Unknown types come from newer writers and are skipped.
+    if (type == kBeamBlockSvg) {
+      index->svg = block;
+    } else if (type == kBeamBlockImages) {
+      table = block;
+    } else if (type == kBeamBlockThumbnail) {
+      index->thumbnail = block;
+    } else if (type == kBeamBlockMisc) {
+      index->misc = block;
+    } else if (type == kBeamBlockImageData) {
+      imageData = block;
+    }
+  }
+
+  if (mode == BeamReadMode::kThumbnail || !table.present) return true;
+  if (table.codec != kBeamCodecStored || imageData.codec != kBeamCodecStored) {
+    *error = "unsupported beam codec";
+
+    return false;
+  }
+  if (!ReadImageTable(table.stored, imageData.stored, &index->images)) {
+    *error = "invalid beam image block";
+
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+bool ReadBeamIndex(const uint8_t* data, size_t size, BeamReadMode mode, BeamIndex* index, std::string* error) {
+  if (size < kBeamSignatureSize || memcmp(data, kBeamSignature, sizeof(kBeamSignature)) != 0) {
+    *error = "not a beam file";
+
+    return false;
+  }
+  index->version = data[kBeamSignatureSize - 1];
+  if (index->version > kBeamVersion3) {
+    *error = "unsupported beam version " + std::to_string(index->version);
+
+    return false;
+  }
+
+  size_t offset = kBeamSignatureSize;
+  ByteSpan header;
+  size_t headerOffset = 0;
+
+  if (!ReadSpan(data, size, &offset, &header) ||
+      !ReadSpan(header.data, header.size, &headerOffset, &index->metadata)) {
+    *error = "invalid beam header";
+
+    return false;
+  }
+  if (index->version == kBeamVersion3) return ReadVersion3(data, size, header, headerOffset, mode, index, error);
+
+  // Only the metadata is needed from a version 2 header; block lengths are taken from the blocks themselves, which
+  // also covers old files whose header lists fewer blocks.
+  while (offset < size) {
+    uint8_t type = data[offset];
+    ByteSpan block;
+
+    offset += 1;
+    if (type == kBeamBlockEnd || type > kBeamBlockMisc) break;
+    if (!ReadSpan(data, size, &offset, &block)) {
+      *error = "truncated beam block";
+
+      return false;
+    }
+    if (type == kBeamBlockSvg) {
+      index->svg = StoredBlock(block);
+    } else if (type == kBeamBlockImages) {
+      if (mode == BeamReadMode::kFull && !ReadImageEntries(block, &index->images)) {
+        *error = "invalid beam image block";
+
+        return false;
+      }
+    } else if (type == kBeamBlockThumbnail) {
+      index->thumbnail = StoredBlock(block);
+      if (mode == BeamReadMode::kThumbnail) break;
+    } else {
+      index->misc = StoredBlock(block);
+    }
+  }
+
+  return true;
+}
+
+bool DecodeBeamBlock(const BeamBlock& block, uint64_t limit, std::vector<uint8_t>* storage, ByteSpan* out,
+                     std::string* error) {
+  size_t size = static_cast<size_t>(std::min(block.size, limit));
+
+  if (block.codec == kBeamCodecStored) {
+    *out = {block.stored.data, size};
+
+    return true;
+  }
+  if (block.codec != kBeamCodecLz4) {
+    *error = "unsupported beam codec";
+
+    return false;
+  }
+  storage->resize(size);
+  if (Lz4Decompress(block.stored.data, block.stored.size, storage->data(), size) != size) {
+    *error = "corrupt beam block";
+
+    return false;
+  }
+  *out = {storage->data(), size};
+
+  return true;
+}
+
+}  // namespace beam
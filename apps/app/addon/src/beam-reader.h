@@ -0,0 +1,55 @@
+// Index of a .beam project held in memory (usually a MappedFile): the header and block framing are parsed, payloads
+// are left in place as spans into the file.
+#ifndef BEAM_ADDON_BEAM_READER_H_
+#define BEAM_ADDON_BEAM_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file-io.h"
+
+namespace beam {
+
+// A block as stored in the file; `size` is its length after decoding.
+struct BeamBlock {
+  bool present = false;
+  uint8_t codec = 0;
+  ByteSpan stored;
+  uint64_t size = 0;
+};
+
+struct BeamImageEntry {
+  ByteSpan id;
+  ByteSpan data;
+  uint64_t hash = 0;  // XXH64 of data; version 3 only.
+};
+
+struct BeamIndex {
+  uint8_t version = 0;
+  ByteSpan metadata;
+  BeamBlock svg;
+  std::vector<BeamImageEntry> images;
+  BeamBlock thumbnail;
+  BeamBlock misc;
+};
+
+enum class BeamReadMode {
+  kFull,
+  // Stops at the thumbnail block and skips over image entries, so only the framing bytes before it are touched.
+  kThumbnail,
+};
+
+// Version 3 files are read through their block index. Older versions follow readBeam: blocks are read until the end
+// block, the end of the data or an unknown block type. Returns false with a message in `error` when the signature,
+// header or a block length is malformed, or the version is newer than 3.
+bool ReadBeamIndex(const uint8_t* data, size_t size, BeamReadMode mode, BeamIndex* index, std::string* error);
+
+// The first `limit` decoded bytes of a block: the stored bytes themselves, or `storage` filled by decompression.
+bool DecodeBeamBlock(const BeamBlock& block, uint64_t limit, std::vector<uint8_t>* storage, ByteSpan* out,
+                     std::string* error);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_BEAM_READER_H_
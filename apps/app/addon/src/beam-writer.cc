@@ -0,0 +1,227 @@
+#include "beam-writer.h"
+
+#include <cstring>
+#include <unordered_map>
+
+#include "lz4.h"
+#include "xxhash.h"
+
+namespace beam {
+
+namespace {
+
+uint64_t BlockSize(uint64_t payloadSize) { return 1 + VintSize(payloadSize) + payloadSize; }
+
+void PushVint(std::vector<uint8_t>& out, uint64_t value) {
+  uint8_t bytes[kMaxVintSize];
+
+  out.insert(out.end(), bytes, bytes + WriteVint(value, bytes));
+}
+
+void PushBytes(std::vector<uint8_t>& out, const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+}  // namespace
+
+struct BeamSerializer::Block {
+  uint8_t type;
+  uint8_t codec;
+  std::vector<ByteSpan> parts;
+  uint64_t storedSize;
+  uint64_t size;
+};
+
+BeamSerializer::BeamSerializer(const BeamDocument& document, const BeamWriteOptions& options) {
+  if (options.version >= kBeamVersion3) {
+    BuildVersion3(document, options.compress);
+  } else {
+    BuildVersion2(document);
+  }
+}
+
+void BeamSerializer::BuildVersion2(const BeamDocument& document) {
+  uint64_t imagesSize = 0;
+
+  for (const BeamImage& image : document.images) {
+    imagesSize += 1 + image.id.size() + VintSize(image.data.size) + image.data.size;
+  }
+
+  uint64_t svgBlock = BlockSize(document.svg.size());
+  uint64_t imagesBlock = BlockSize(imagesSize);
+  uint64_t thumbnailBlock = document.hasThumbnail ? BlockSize(document.thumbnail.size) : 0;
+  uint64_t miscBlock = BlockSize(document.misc.size());
+  uint64_t headerSize = VintSize(document.metadata.size()) + document.metadata.size() + VintSize(svgBlock) +
+                        VintSize(imagesBlock) + VintSize(thumbnailBlock) + VintSize(miscBlock);
+
+  framing_.reserve(kBeamSignatureSize + 10 * kMaxVintSize + 5 + document.images.size() * (1 + kMaxVintSize));
+  chunks_.reserve(8 + document.images.size() * 3);
+
+  for (uint8_t byte : kBeamSignature) AppendByte(byte);
+  AppendByte(kBeamVersion2);
+  AppendVint(headerSize);
+  AppendVint(document.metadata.size());
+  AppendPayload(document.metadata.data(), document.metadata.size());
+  AppendVint(svgBlock);
+  AppendVint(imagesBlock);
+  AppendVint(thumbnailBlock);
+  AppendVint(miscBlock);
+
+  AppendByte(kBeamBlockSvg);
+  AppendVint(document.svg.size());
+  AppendPayload(document.svg.data(), document.svg.size());
+
+  AppendByte(kBeamBlockImages);
+  AppendVint(imagesSize);
+  for (const BeamImage& image : document.images) {
+    AppendByte(static_cast<uint8_t>(image.id.size()));
+    AppendPayload(image.id.data(), image.id.size());
+    AppendVint(image.data.size);
+    AppendPayload(image.data.data, image.data.size);
+  }
+
+  if (document.hasThumbnail) {
+    AppendByte(kBeamBlockThumbnail);
+    AppendVint(document.thumbnail.size);
+    AppendPayload(document.thumbnail.data, document.thumbnail.size);
+  }
+
+  AppendByte(kBeamBlockMisc);
+  AppendVint(document.misc.size());
+  AppendPayload(document.misc.data(), document.misc.size());
+  AppendByte(kBeamBlockEnd);
+}
+
+void BeamSerializer::BuildVersion3(const BeamDocument& document, bool compress) {
+  std::vector<uint8_t>& table = NewBuffer();
+  Block imageData = {kBeamBlockImageData, kBeamCodecStored, {}, 0, 0};
+  std::vector<uint64_t> offsets;
+  std::unordered_multimap<uint64_t, size_t> distinct;
+
+  // Identical images are stored once; equal hashes are confirmed byte by byte.
+  for (const BeamImage& image : document.images) {
+    uint64_t hash = Xxh64(image.data.data, image.data.size);
+    auto range = distinct.equal_range(hash);
+    size_t blob = imageData.parts.size();
+
+    for (auto it = range.first; it != range.second; ++it) {
+      const ByteSpan& stored = imageData.parts[it->second];
+
+      if (stored.size == image.data.size && memcmp(stored.data, image.data.data, stored.size) == 0) {
+        blob = it->second;
+        break;
+      }
+    }
+    if (blob == imageData.parts.size()) {
+      distinct.emplace(hash, blob);
+      imageData.parts.push_back(image.data);
+      offsets.push_back(imageData.size);
+      imageData.size += image.data.size;
+    }
+    table.push_back(static_cast<uint8_t>(image.id.size()));
+    PushBytes(table, image.id.data(), image.id.size());
+    for (int k = 0; k < 8; k += 1) table.push_back(static_cast<uint8_t>(hash >> (8 * k)));
+    PushVint(table, offsets[blob]);
+    PushVint(table, image.data.size);
+  }
+  imageData.storedSize = imageData.size;
+
+  std::vector<Block> blocks;
+
+  blocks.push_back(TextBlock(kBeamBlockSvg, document.svg, compress));
+  blocks.push_back({kBeamBlockImages, kBeamCodecStored, {{table.data(), table.size()}}, table.size(), table.size()});
+  if (document.hasThumbnail) {
+    blocks.push_back({kBeamBlockThumbnail, kBeamCodecStored, {document.thumbnail}, document.thumbnail.size,
+                      document.thumbnail.size});
+  }
+  blocks.push_back(TextBlock(kBeamBlockMisc, document.misc, compress));
+  // Last, so the small blocks share the first pages of the file.
+  blocks.push_back(std::move(imageData));
+
+  std::vector<uint8_t>& header = NewBuffer();
+  uint64_t offset = 0;
+
+  PushVint(header, document.metadata.size());
+  PushBytes(header, document.metadata.data(), document.metadata.size());
+  PushVint(header, blocks.size());
+  for (const Block& block : blocks) {
+    header.push_back(block.type);
+    header.push_back(block.codec);
+    PushVint(header, offset);
+    PushVint(header, block.storedSize);
+    PushVint(header, block.size);
+    offset += block.storedSize;
+  }
+
+  framing_.reserve(kBeamSignatureSize + kMaxVintSize);
+  for (uint8_t byte : kBeamSignature) AppendByte(byte);
+  AppendByte(kBeamVersion3);
+  AppendVint(header.size());
+  AppendPayload(header.data(), header.size());
+  for (const Block& block : blocks) {
+    for (const ByteSpan& part : block.parts) AppendPayload(part.data, part.size);
+  }
+}
+
+BeamSerializer::Block BeamSerializer::TextBlock(uint8_t type, const std::string& text, bool compress) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+
+  if (compress && !text.empty()) {
+    std::vector<uint8_t>& buffer = NewBuffer();
+
+    buffer.resize(Lz4CompressBound(text.size()));
+    buffer.resize(Lz4Compress(data, text.size(), buffer.data()));
+    if (buffer.size() < text.size()) {
+      return {type, kBeamCodecLz4, {{buffer.data(), buffer.size()}}, buffer.size(), text.size()};
+    }
+  }
+
+  return {type, kBeamCodecStored, {{data, text.size()}}, text.size(), text.size()};
+}
+
+std::vector<uint8_t>& BeamSerializer::NewBuffer() {
+  buffers_.emplace_back();
+
+  return buffers_.back();
+}
+
+void BeamSerializer::AppendByte(uint8_t value) {
+  uint8_t* end = framing_.data() + framing_.size();
+
+  framing_.push_back(value);
+  // Consecutive framing bytes share one chunk.
+  if (!chunks_.empty() && chunks_.back().data + chunks_.back().size == end) {
+    chunks_.back().size += 1;
+  } else {
+    chunks_.push_back({end, 1});
+  }
+  size_ += 1;
+}
+
+void BeamSerializer::AppendVint(uint64_t value) {
+  uint8_t bytes[kMaxVintSize];
+  size_t count = WriteVint(value, bytes);
+
+  for (size_t i = 0; i < count; i += 1) AppendByte(bytes[i]);
+}
+
+void BeamSerializer::AppendPayload(const void* data, size_t size) {
+  if (size == 0) return;
+  chunks_.push_back({static_cast<const uint8_t*>(data), size});
+  size_ += size;
+}
+
+void BeamSerializer::CopyTo(uint8_t* out) const {
+  for (const ByteSpan& chunk : chunks_) {
+    memcpy(out, chunk.data, chunk.size);
+    out += chunk.size;
+  }
+}
+
+bool BeamSerializer::WriteFile(const std::string& path, std::string* error) const {
+  return WriteFileAtomically(path, chunks_, error);
+}
+
+}  // namespace beam
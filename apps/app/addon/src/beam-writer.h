@@ -0,0 +1,75 @@
+// Serializer for .beam project files that never concatenates payloads: the document becomes a scatter list of
+// small framing runs and pointers into the caller's svg, image and thumbnail bytes.
+#ifndef BEAM_ADDON_BEAM_WRITER_H_
+#define BEAM_ADDON_BEAM_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "beam-format.h"
+#include "file-io.h"
+
+namespace beam {
+
+struct BeamImage {
+  std::string id;  // At most kMaxImageIdSize bytes.
+  ByteSpan data;
+};
+
+// Strings are UTF-8. Payload spans must outlive the serializer.
+struct BeamDocument {
+  std::string metadata;
+  std::string svg;
+  std::vector<BeamImage> images;
+  bool hasThumbnail = false;
+  ByteSpan thumbnail;
+  std::string misc;
+};
+
+struct BeamWriteOptions {
+  // kBeamVersion2 stays readable by older app versions; kBeamVersion3 stores each distinct image once and indexes
+  // the blocks.
+  uint8_t version = kBeamVersion2;
+  // Version 3 only: LZ4 for the svg and misc blocks, kept only when it makes them smaller.
+  bool compress = false;
+};
+
+class BeamSerializer {
+ public:
+  BeamSerializer(const BeamDocument& document, const BeamWriteOptions& options);
+
+  BeamSerializer(const BeamSerializer&) = delete;
+  BeamSerializer& operator=(const BeamSerializer&) = delete;
+
+  uint64_t Size() const { return size_; }
+  const std::vector<ByteSpan>& Chunks() const { return chunks_; }
+
+  void CopyTo(uint8_t* out) const;
+  bool WriteFile(const std::string& path, std::string* error) const;
+
+ private:
+  struct Block;
+
+  void BuildVersion2(const BeamDocument& document);
+  void BuildVersion3(const BeamDocument& document, bool compress);
+  Block TextBlock(uint8_t type, const std::string& text, bool compress);
+  std::vector<uint8_t>& NewBuffer();
+
+  void AppendByte(uint8_t value);
+  void AppendVint(uint64_t value);
+  void AppendPayload(const void* data, size_t size);
+
+  // Reserved up front for the worst case, so chunks can point into it while it grows.
+  std::vector<uint8_t> framing_;
+  // Version 3 header, image table and compressed blocks; a deque keeps their addresses stable.
+  std::deque<std::vector<uint8_t>> buffers_;
+  std::vector<ByteSpan> chunks_;
+  uint64_t size_ = 0;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_BEAM_WRITER_H_
@@ -0,0 +1,293 @@
+#include "bezier-fit.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace beam {
+
+namespace {
+
+// fitPath divides the accumulated segment length by this to get the allowed squared error.
+constexpr double kAllowedErrorDivisor = 30;
+
+inline double B0(double t) {
+  double temp = 1 - t;
+
+  return temp * temp * temp;
+}
+
+inline double B1(double t) {
+  double temp = 1 - t;
+
+  return 3 * t * temp * temp;
+}
+
+inline double B2(double t) {
+  double temp = 1 - t;
+
+  return 3 * t * t * temp;
+}
+
+inline double B3(double t) { return t * t * t; }
+
+// De Casteljau evaluation, kept in the same operation order as bezierCurveValue so results match the JS fitter.
+inline Vec2 BezierValue(int degree, const Vec2* controlPoints, double t) {
+  Vec2 temp[4];
+
+  for (int i = 0; i <= degree; i += 1) temp[i] = controlPoints[i];
+  for (int i = 1; i <= degree; i += 1) {
+    for (int j = 0; j <= degree - i; j += 1) {
+      temp[j].x = (1 - t) * temp[j].x + t * temp[j + 1].x;
+      temp[j].y = (1 - t) * temp[j].y + t * temp[j + 1].y;
+    }
+  }
+
+  return temp[0];
+}
+
+class Fitter {
+ public:
+  Fitter(const double* xy, const BezierFitOptions& options, std::vector<double>& out)
+      : xy_(xy), options_(options), out_(out) {}
+
+  void FitSegment(size_t start, size_t end, Vec2 vStart, Vec2 vEnd, double allowedError);
+
+  Vec2 Point(size_t i) const { return {xy_[2 * i], xy_[2 * i + 1]}; }
+  Vec2 LeftTangent(size_t index) const { return Normalize(Point(index + 1) - Point(index)); }
+  Vec2 RightTangent(size_t index) const { return Normalize(Point(index - 1) - Point(index)); }
+
+ private:
+  struct Job {
+    size_t start;
+    size_t end;
+    Vec2 vStart;
+    Vec2 vEnd;
+  };
+
+  Vec2 CenterTangent(size_t index) const;
+  void ChordLengthParameterize(size_t start, size_t end);
+  void GenerateBezier(size_t start, size_t end, Vec2 vStart, Vec2 vEnd, Vec2* bezier) const;
+  void Reparameterize(size_t start, size_t end, const Vec2* bezier);
+  double ComputeMaxError(size_t start, size_t end, const Vec2* bezier, size_t* splitPoint) const;
+  void EmitLine(Vec2 p0, Vec2 p1);
+  void EmitCubic(const Vec2* bezier);
+
+  const double* xy_;
+  const BezierFitOptions& options_;
+  std::vector<double>& out_;
+  // Scratch buffers reused by every segment instead of allocating per call.
+  std::vector<double> u_;
+  std::vector<Job> stack_;
+};
+
+Vec2 Fitter::CenterTangent(size_t index) const {
+  Vec2 v1 = Point(index - 1) - Point(index);
+  Vec2 v2 = Point(index) - Point(index + 1);
+
+  return Normalize({(v1.x + v2.x) / 2, (v1.y + v2.y) / 2});
+}
+
+void Fitter::ChordLengthParameterize(size_t start, size_t end) {
+  size_t n = end - start;
+
+  u_.assign(n + 1, 0);
+  for (size_t i = 1; i <= n; i += 1) u_[i] = u_[i - 1] + Distance(Point(start + i - 1), Point(start + i));
+  for (size_t i = 1; i <= n; i += 1) u_[i] = u_[n] > 0 ? u_[i] / u_[n] : 0;
+}
+
+// Least-squares fit of the two inner control points along the fixed end tangents.
+void Fitter::GenerateBezier(size_t start, size_t end, Vec2 vStart, Vec2 vEnd, Vec2* bezier) const {
+  size_t numPoints = end - start + 1;
+  Vec2 first = Point(start);
+  Vec2 last = Point(end);
+  double c00 = 0, c01 = 0, c11 = 0, x0 = 0, x1 = 0;
+
+  for (size_t i = 0; i < numPoints; i += 1) {
+    double t = u_[i];
+    Vec2 a0 = vStart * B1(t);
+    Vec2 a1 = vEnd * B2(t);
+    Vec2 tmp = first * B0(t) + first * B1(t) + last * B2(t) + last * B3(t);
+
+    c00 += Dot(a0, a0);
+    c01 += Dot(a0, a1);
+    c11 += Dot(a1, a1);
+    tmp = Point(start + i) - tmp;
+    x0 += Dot(a0, tmp);
+    x1 += Dot(a1, tmp);
+  }
+
+  double detC0C1 = c00 * c11 - c01 * c01;
+  double detC0X = c00 * x1 - c01 * x0;
+  double detXC1 = x0 * c11 - x1 * c01;
+
+  if (detC0C1 == 0) detC0C1 = c00 * c11 * 1e-11;
+
+  double alphaL = std::fabs(detC0C1) > 0 ? detXC1 / detC0C1 : 0;
+  double alphaR = std::fabs(detC0C1) > 0 ? detC0X / detC0C1 : 0;
+
+  if (std::fabs(alphaL) < 1e-6 || std::fabs(alphaR) < 1e-6) {
+    double dist = Distance(first, last);
+
+    alphaL = dist / 3;
+    alphaR = dist / 3;
+  }
+
+  bezier[0] = first;
+  bezier[1] = first + vStart * alphaL;
+  bezier[2] = last + vEnd * alphaR;
+  bezier[3] = last;
+}
+
+void Fitter::Reparameterize(size_t start, size_t end, const Vec2* bezier) {
+  Vec2 q1[3];
+  Vec2 q2[2];
+
+  for (int i = 0; i <= 2; i += 1) q1[i] = {(bezier[i + 1].x - bezier[i].x) * 3, (bezier[i + 1].y - bezier[i].y) * 3};
+  for (int i = 0; i <= 1; i += 1) q2[i] = {(q1[i + 1].x - q1[i].x) * 2, (q1[i + 1].y - q1[i].y) * 2};
+
+  for (size_t i = start; i <= end; i += 1) {
+    double currentU = u_[i - start];
+    Vec2 point = Point(i);
+    Vec2 pointU = BezierValue(3, bezier, currentU);
+    Vec2 point1U = BezierValue(2, q1, currentU);
+    Vec2 point2U = BezierValue(1, q2, currentU);
+    double numerator = (pointU.x - point.x) * point1U.x + (pointU.y - point.y) * point1U.y;
+    double denominator = point1U.x * point1U.x + point1U.y * point1U.y + (pointU.x - point.x) * point2U.x +
+                         (pointU.y - point.y) * point2U.y;
+
+    // Same update rule as NewtonRaphsonRootFind in bezier-fit-curve.ts, so both fitters produce identical curves.
+    u_[i - start] = currentU * (numerator / denominator);
+  }
+}
+
+// Returns the largest squared distance between the points and the curve and where it happens.
+double Fitter::ComputeMaxError(size_t start, size_t end, const Vec2* bezier, size_t* splitPoint) const {
+  double maxError = 0;
+
+  *splitPoint = (end - start + 1) / 2;
+  for (size_t i = start + 1; i < end; i += 1) {
+    double dist = Length(Point(i) - BezierValue(3, bezier, u_[i - start]));
+
+    dist *= dist;
+    if (dist > maxError) {
+      maxError = dist;
+      *splitPoint = i;
+    }
+  }
+
+  return maxError;
+}
+
+void Fitter::EmitLine(Vec2 p0, Vec2 p1) {
+  double record[kFitSegmentStride] = {kFitSegmentLine, p0.x, p0.y, p1.x, p1.y, 0, 0, 0, 0};
+
+  out_.insert(out_.end(), record, record + kFitSegmentStride);
+}
+
+void Fitter::EmitCubic(const Vec2* bezier) {
+  double record[kFitSegmentStride] = {kFitSegmentCubic, bezier[0].x, bezier[0].y, bezier[1].x, bezier[1].y,
+                                      bezier[2].x,      bezier[2].y, bezier[3].x, bezier[3].y};
+
+  out_.insert(out_.end(), record, record + kFitSegmentStride);
+}
+
+// Iterative version of fitSegment: the explicit stack keeps the left-before-right output order of the recursion
+// without risking deep native recursion on long traced runs.
+void Fitter::FitSegment(size_t start, size_t end, Vec2 vStart, Vec2 vEnd, double allowedError) {
+  double allowedIterationError = allowedError > 1 ? allowedError * allowedError : std::sqrt(allowedError);
+  Vec2 bezier[4];
+
+  // NaN errors (from NaN input) would make the JS version recurse until the stack overflows; stop right away instead.
+  if (!(allowedError > 0)) return;
+
+  stack_.clear();
+  stack_.push_back({start, end, vStart, vEnd});
+
+  while (!stack_.empty()) {
+    Job job = stack_.back();
+    size_t numPoints = job.end - job.start + 1;
+
+    stack_.pop_back();
+    if (job.end <= job.start) continue;
+    if (numPoints <= 4) {
+      for (size_t i = job.start; i < job.end; i += 1) EmitLine(Point(i), Point(i + 1));
+      continue;
+    }
+
+    size_t splitPoint;
+
+    ChordLengthParameterize(job.start, job.end);
+    GenerateBezier(job.start, job.end, job.vStart, job.vEnd, bezier);
+
+    double maxError = ComputeMaxError(job.start, job.end, bezier, &splitPoint);
+    bool fitted = maxError < allowedError;
+
+    if (!fitted && maxError < allowedIterationError) {
+      for (int i = 0; i < options_.maxIterations && !fitted; i += 1) {
+        Reparameterize(job.start, job.end, bezier);
+        GenerateBezier(job.start, job.end, job.vStart, job.vEnd, bezier);
+        fitted = ComputeMaxError(job.start, job.end, bezier, &splitPoint) < allowedError;
+      }
+    }
+
+    if (fitted) {
+      EmitCubic(bezier);
+      continue;
+    }
+
+    if (splitPoint <= job.start || splitPoint >= job.end) {
+      for (size_t i = job.start; i < job.end; i += 1) EmitLine(Point(i), Point(i + 1));
+      continue;
+    }
+
+    Vec2 vCenter = CenterTangent(splitPoint);
+
+    stack_.push_back({splitPoint, job.end, -vCenter, job.vEnd});
+    stack_.push_back({job.start, splitPoint, job.vStart, vCenter});
+  }
+}
+
+}  // namespace
+
+void FitPath(const double* xy, size_t count, double totalDist, const BezierFitOptions& options,
+             std::vector<double>& out) {
+  if (count < 2) return;
+
+  Fitter fitter(xy, options, out);
+  Vec2 currentVector = fitter.Point(0) - fitter.Point(count - 1);
+  double accumulatedDist = 0;
+  size_t start = 0;
+
+  if (totalDist == 0 || std::isnan(totalDist)) {
+    totalDist = 0;
+    for (size_t i = 1; i < count; i += 1) totalDist += Distance(fitter.Point(i), fitter.Point(i - 1));
+  }
+
+  double allowedDist = std::min(totalDist / options.allowedDistFactor, options.minAllowedDist);
+
+  for (size_t i = 1; i < count; i += 1) {
+    Vec2 v = fitter.Point(i) - fitter.Point(i - 1);
+    double dist = Length(v);
+    double angle = Angle(currentVector, v);
+
+    if (accumulatedDist + dist >= allowedDist || angle > options.angleThreshold) {
+      if (start != i - 1) {
+        fitter.FitSegment(start, i - 1, fitter.LeftTangent(start), fitter.RightTangent(i - 1),
+                          accumulatedDist / kAllowedErrorDivisor);
+      }
+
+      start = i - 1;
+      accumulatedDist = 0;
+    }
+
+    accumulatedDist += dist;
+    currentVector = v;
+
+    if (i == count - 1) {
+      fitter.FitSegment(start, i, fitter.LeftTangent(start), fitter.RightTangent(i),
+                        accumulatedDist / kAllowedErrorDivisor);
+    }
+  }
+}
+
+}  // namespace beam
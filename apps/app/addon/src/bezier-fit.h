@@ -0,0 +1,32 @@
+// Schneider-style cubic Bézier fitting, a native port of packages/core/src/web/helpers/bezier-fit-curve.ts.
+#ifndef BEAM_ADDON_BEZIER_FIT_H_
+#define BEAM_ADDON_BEZIER_FIT_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "vec2.h"
+
+namespace beam {
+
+struct BezierFitOptions {
+  int maxIterations = 4;
+  double angleThreshold = kPi / 3;  // rad
+  double allowedDistFactor = 30;
+  double minAllowedDist = 200;  // pixel
+};
+
+// Every fitted segment is written as [type, x0, y0, x1, y1, x2, y2, x3, y3].
+// type 0 is a line and only uses (x0, y0, x1, y1); type 1 is a cubic with all four points.
+constexpr size_t kFitSegmentStride = 9;
+constexpr double kFitSegmentLine = 0;
+constexpr double kFitSegmentCubic = 1;
+
+// Fits `count` points stored as interleaved xy pairs and appends the segments to `out`.
+// totalDist of 0 or NaN means "use the polyline length", like calling fitPath without totalDist.
+void FitPath(const double* xy, size_t count, double totalDist, const BezierFitOptions& options,
+             std::vector<double>& out);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_BEZIER_FIT_H_
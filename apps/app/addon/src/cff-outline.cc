@@ -0,0 +1,457 @@
+#include "cff-outline.h"
+
+#include <cmath>
+
+namespace beam {
+
+namespace {
+
+// Type 2 limits: argument stack depth and subroutine nesting.
+constexpr int kMaxStack = 48;
+constexpr int kMaxSubrDepth = 10;
+
+// Two-byte operators (12 x) are numbered 1200 + x.
+constexpr int kCharStrings = 17;
+constexpr int kPrivate = 18;
+constexpr int kSubrs = 19;
+constexpr int kCharstringType = 1206;
+constexpr int kFdArray = 1236;
+constexpr int kFdSelect = 1237;
+
+size_t ToOffset(double value) { return value > 0 && value < 1e9 ? static_cast<size_t>(value) : 0; }
+
+// Calls visit(op, operands, count) for every entry of a DICT. Real numbers are skipped (read as 0): only the
+// integer entries above are used.
+template <typename Visit>
+void ReadDict(FontSpan dict, Visit visit) {
+  double operands[kMaxStack];
+  int count = 0;
+  size_t p = 0;
+
+  while (p < dict.size) {
+    uint8_t b0 = dict.U8(p);
+    double value = 0;
+
+    if (b0 <= 21) {
+      int op = b0;
+
+      p += 1;
+      if (b0 == 12) op = 1200 + dict.U8(p++);
+      visit(op, operands, count);
+      count = 0;
+      continue;
+    }
+    if (b0 == 28) {
+      value = dict.S16(p + 1);
+      p += 3;
+    } else if (b0 == 29) {
+      value = static_cast<int32_t>(dict.U32(p + 1));
+      p += 5;
+    } else if (b0 == 30) {
+      // Nibbles up to and including an 0xF terminator.
+      for (p += 1; p < dict.size && (dict.U8(p) & 0x0F) != 0x0F && (dict.U8(p) & 0xF0) != 0xF0; p += 1) {
+      }
+      p += 1;
+    } else if (b0 >= 32 && b0 <= 246) {
+      value = b0 - 139;
+      p += 1;
+    } else if (b0 >= 247 && b0 <= 250) {
+      value = (b0 - 247) * 256 + dict.U8(p + 1) + 108;
+      p += 2;
+    } else if (b0 >= 251 && b0 <= 254) {
+      value = -(b0 - 251) * 256 - dict.U8(p + 1) - 108;
+      p += 2;
+    } else {
+      p += 1;
+      continue;
+    }
+    if (count < kMaxStack) operands[count++] = value;
+  }
+}
+
+int SubrBias(uint32_t count) { return count < 1240 ? 107 : count < 33900 ? 1131 : 32768; }
+
+// Type 2 charstring interpreter drawing into a path buffer. Hints are skipped; seac-style accented endchar is not
+// supported (OpenType fonts use composed glyphs instead).
+class CharstringRunner {
+ public:
+  CharstringRunner(const CffIndex& global, const CffIndex* local, PathBuffer* out)
+      : global_(global), local_(local), out_(out) {}
+
+  void Run(FontSpan code, int depth) {
+    size_t p = 0;
+
+    while (p < code.size && !done_) {
+      uint8_t b0 = code.U8(p);
+
+      if (b0 >= 32 || b0 == 28) {
+        double value;
+
+        if (b0 == 28) {
+          value = code.S16(p + 1);
+          p += 3;
+        } else if (b0 <= 246) {
+          value = b0 - 139;
+          p += 1;
+        } else if (b0 <= 250) {
+          value = (b0 - 247) * 256 + code.U8(p + 1) + 108;
+          p += 2;
+        } else if (b0 <= 254) {
+          value = -(b0 - 251) * 256 - code.U8(p + 1) - 108;
+          p += 2;
+        } else {
+          value = static_cast<int32_t>(code.U32(p + 1)) / 65536.0;
+          p += 5;
+        }
+        if (count_ < kMaxStack) stack_[count_++] = value;
+        continue;
+      }
+      p += 1;
+
+      int op = b0 == 12 ? 1200 + code.U8(p++) : b0;
+
+      switch (op) {
+        case 1:     // hstem
+        case 3:     // vstem
+        case 18:    // hstemhm
+        case 23:    // vstemhm
+          stems_ += count_ / 2;
+          count_ = 0;
+          break;
+        case 19:    // hintmask
+        case 20:    // cntrmask
+          // Arguments here are the vstems of an omitted vstemhm.
+          stems_ += count_ / 2;
+          count_ = 0;
+          p += (stems_ + 7) / 8;
+          break;
+        case 21:    // rmoveto
+          MoveTo(Arg(count_ - 2), Arg(count_ - 1));
+          break;
+        case 22:    // hmoveto
+          MoveTo(Arg(count_ - 1), 0);
+          break;
+        case 4:     // vmoveto
+          MoveTo(0, Arg(count_ - 1));
+          break;
+        case 5:     // rlineto
+          for (int i = 0; i + 1 < count_; i += 2) LineTo(stack_[i], stack_[i + 1]);
+          count_ = 0;
+          break;
+        case 6:     // hlineto
+        case 7: {   // vlineto
+          bool horizontal = op == 6;
+
+          for (int i = 0; i < count_; i += 1, horizontal = !horizontal) {
+            LineTo(horizontal ? stack_[i] : 0, horizontal ? 0 : stack_[i]);
+          }
+          count_ = 0;
+          break;
+        }
+        case 8:     // rrcurveto
+          for (int i = 0; i + 5 < count_; i += 6) Curve(&stack_[i]);
+          count_ = 0;
+          break;
+        case 24: {  // rcurveline
+          int i = 0;
+
+          for (; i + 7 < count_; i += 6) Curve(&stack_[i]);
+          if (i + 1 < count_) LineTo(stack_[i], stack_[i + 1]);
+          count_ = 0;
+          break;
+        }
+        case 25: {  // rlinecurve
+          int i = 0;
+
+          for (; i + 7 < count_; i += 2) LineTo(stack_[i], stack_[i + 1]);
+          if (i + 5 < count_) Curve(&stack_[i]);
+          count_ = 0;
+          break;
+        }
+        case 26:    // vvcurveto
+        case 27: {  // hhcurveto
+          bool vertical = op == 26;
+          int i = count_ % 2;
+          double across = i ? stack_[0] : 0;
+
+          for (; i + 3 < count_; i += 4) {
+            const double* s = &stack_[i];
+            double d[6] = {vertical ? across : s[0], vertical ? s[0] : across, s[1], s[2],
+                           vertical ? 0 : s[3],      vertical ? s[3] : 0};
+
+            Curve(d);
+            across = 0;
+          }
+          count_ = 0;
+          break;
+        }
+        case 30:    // vhcurveto
+        case 31: {  // hvcurveto
+          bool vertical = op == 30;
+
+          for (int i = 0; i + 3 < count_; i += 4, vertical = !vertical) {
+            const double* s = &stack_[i];
+            double last = count_ - i == 5 ? s[4] : 0;
+            double d[6] = {vertical ? 0 : s[0], vertical ? s[0] : 0, s[1], s[2],
+                           vertical ? s[3] : last, vertical ? last : s[3]};
+
+            Curve(d);
+          }
+          count_ = 0;
+          break;
+        }
+        case 10:    // callsubr
+        case 29: {  // callgsubr
+          const CffIndex* subrs = op == 10 ? local_ : &global_;
+
+          if (count_ == 0 || !subrs) return;
+
+          double index = stack_[--count_] + SubrBias(subrs->count);
+
+          if (depth >= kMaxSubrDepth || index < 0 || index >= subrs->count) {
+            done_ = true;
+
+            return;
+          }
+          Run(subrs->Item(static_cast<uint32_t>(index)), depth + 1);
+          break;
+        }
+        case 11:    // return
+          return;
+        case 14:    // endchar
+          ClosePath();
+          done_ = true;
+          return;
+        case 1235:  // flex
+          if (count_ >= 12) {
+            Curve(&stack_[0]);
+            Curve(&stack_[6]);
+          }
+          count_ = 0;
+          break;
+        case 1234: {  // hflex
+          if (count_ >= 7) {
+            const double* s = stack_;
+            double first[6] = {s[0], 0, s[1], s[2], s[3], 0};
+            double second[6] = {s[4], 0, s[5], -s[2], s[6], 0};
+
+            Curve(first);
+            Curve(second);
+          }
+          count_ = 0;
+          break;
+        }
+        case 1236: {  // hflex1
+          if (count_ >= 9) {
+            const double* s = stack_;
+            double first[6] = {s[0], s[1], s[2], s[3], s[4], 0};
+            double second[6] = {s[5], 0, s[6], s[7], s[8], -(s[1] + s[3] + s[7])};
+
+            Curve(first);
+            Curve(second);
+          }
+          count_ = 0;
+          break;
+        }
+        case 1237: {  // flex1
+          if (count_ >= 11) {
+            const double* s = stack_;
+            double dx = s[0] + s[2] + s[4] + s[6] + s[8];
+            double dy = s[1] + s[3] + s[5] + s[7] + s[9];
+            bool horizontal = std::fabs(dx) > std::fabs(dy);
+            double second[6] = {s[6], s[7], s[8], s[9], horizontal ? s[10] : -dx, horizontal ? -dy : s[10]};
+
+            Curve(&stack_[0]);
+            Curve(second);
+          }
+          count_ = 0;
+          break;
+        }
+        default:
+          // Arithmetic and storage operators are not used by real fonts; drop their arguments.
+          count_ = 0;
+          break;
+      }
+    }
+  }
+
+  void ClosePath() {
+    if (open_) out_->Close();
+    open_ = false;
+  }
+
+ private:
+  // Argument i of the stack, 0 when missing. A leading advance width makes the count odd and is never used here.
+  double Arg(int i) const { return i >= 0 && i < count_ ? stack_[i] : 0; }
+
+  void MoveTo(double dx, double dy) {
+    ClosePath();
+    x_ += dx;
+    y_ += dy;
+    out_->MoveTo(x_, y_);
+    open_ = true;
+    count_ = 0;
+  }
+
+  void Begin() {
+    if (!open_) {
+      out_->MoveTo(x_, y_);
+      open_ = true;
+    }
+  }
+
+  void LineTo(double dx, double dy) {
+    Begin();
+    x_ += dx;
+    y_ += dy;
+    out_->LineTo(x_, y_);
+  }
+
+  // Relative cubic: three deltas, each from the previous point.
+  void Curve(const double* d) {
+    Begin();
+
+    double x1 = x_ + d[0];
+    double y1 = y_ + d[1];
+    double x2 = x1 + d[2];
+    double y2 = y1 + d[3];
+
+    x_ = x2 + d[4];
+    y_ = y2 + d[5];
+    out_->CubicTo(x1, y1, x2, y2, x_, y_);
+  }
+
+  const CffIndex& global_;
+  const CffIndex* local_;
+  PathBuffer* out_;
+  double stack_[kMaxStack];
+  int count_ = 0;
+  int stems_ = 0;
+  double x_ = 0;
+  double y_ = 0;
+  bool open_ = false;
+  bool done_ = false;
+};
+
+}  // namespace
+
+bool CffIndex::Read(FontSpan cff, size_t offset) {
+  data = cff;
+  count = cff.U16(offset);
+  if (count == 0) {
+    end = offset + 2;
+
+    return end <= cff.size;
+  }
+  offsetSize = cff.U8(offset + 2);
+  if (offsetSize < 1 || offsetSize > 4) return false;
+  offsets = offset + 3;
+  base = offsets + (static_cast<size_t>(count) + 1) * offsetSize - 1;
+
+  size_t last = 0;
+
+  for (uint8_t i = 0; i < offsetSize; i += 1) last = last << 8 | cff.U8(offsets + count * offsetSize + i);
+  end = base + last;
+
+  return end <= cff.size;
+}
+
+FontSpan CffIndex::Item(uint32_t i) const {
+  if (i >= count) return {};
+
+  size_t start = 0;
+  size_t next = 0;
+
+  for (uint8_t k = 0; k < offsetSize; k += 1) {
+    start = start << 8 | data.U8(offsets + i * offsetSize + k);
+    next = next << 8 | data.U8(offsets + (i + 1) * offsetSize + k);
+  }
+  if (next < start) return {};
+
+  return data.Slice(base + start, next - start);
+}
+
+bool CffOutlines::ReadPrivate(FontSpan dict, CffIndex* subrs) const {
+  size_t privateSize = 0;
+  size_t privateOffset = 0;
+  size_t subrsOffset = 0;
+
+  ReadDict(dict, [&](int op, const double* operands, int count) {
+    if (op == kPrivate && count >= 2) {
+      privateSize = ToOffset(operands[count - 2]);
+      privateOffset = ToOffset(operands[count - 1]);
+    }
+  });
+  if (privateSize == 0) return true;
+  ReadDict(cff_.Slice(privateOffset, privateSize), [&](int op, const double* operands, int count) {
+    if (op == kSubrs && count >= 1) subrsOffset = ToOffset(operands[count - 1]);
+  });
+
+  return subrsOffset == 0 || subrs->Read(cff_, privateOffset + subrsOffset);
+}
+
+bool CffOutlines::Parse(FontSpan cff) {
+  CffIndex names;
+  CffIndex topDicts;
+  CffIndex strings;
+
+  cff_ = cff;
+  if (cff.U8(0) != 1 || !names.Read(cff, cff.U8(2)) || !topDicts.Read(cff, names.end) ||
+      !strings.Read(cff, topDicts.end) || !globalSubrs_.Read(cff, strings.end)) {
+    return false;
+  }
+
+  FontSpan top = topDicts.Item(0);
+  size_t charStringsOffset = 0;
+  size_t fdArrayOffset = 0;
+  size_t fdSelectOffset = 0;
+  int charstringType = 2;
+
+  ReadDict(top, [&](int op, const double* operands, int count) {
+    if (count < 1) return;
+    if (op == kCharStrings) charStringsOffset = ToOffset(operands[count - 1]);
+    if (op == kCharstringType) charstringType = static_cast<int>(operands[count - 1]);
+    if (op == kFdArray) fdArrayOffset = ToOffset(operands[count - 1]);
+    if (op == kFdSelect) fdSelectOffset = ToOffset(operands[count - 1]);
+  });
+  if (charstringType != 2 || charStringsOffset == 0 || !charStrings_.Read(cff, charStringsOffset)) return false;
+  if (fdArrayOffset == 0) {
+    localSubrs_.resize(1);
+
+    return ReadPrivate(top, &localSubrs_[0]);
+  }
+
+  CffIndex fdArray;
+
+  if (!fdArray.Read(cff, fdArrayOffset) || fdSelectOffset == 0) return false;
+  localSubrs_.resize(fdArray.count);
+  for (uint32_t i = 0; i < fdArray.count; i += 1) {
+    if (!ReadPrivate(fdArray.Item(i), &localSubrs_[i])) return false;
+  }
+  fdSelect_ = cff.Slice(fdSelectOffset);
+
+  return true;
+}
+
+void CffOutlines::Decode(uint16_t glyph, PathBuffer* out) const {
+  size_t fd = 0;
+
+  if (!fdSelect_.Empty()) {
+    if (fdSelect_.U8(0) == 0) {
+      fd = fdSelect_.U8(1 + static_cast<size_t>(glyph));
+    } else if (fdSelect_.U8(0) == 3) {
+      // Ranges of [first glyph, font dict], ending with a sentinel glyph.
+      for (size_t i = 0; i < fdSelect_.U16(1) && fdSelect_.U16(3 + 3 * i) <= glyph; i += 1) {
+        fd = fdSelect_.U8(5 + 3 * i);
+      }
+    }
+  }
+
+  const CffIndex* local = fd < localSubrs_.size() ? &localSubrs_[fd] : nullptr;
+  CharstringRunner runner(globalSubrs_, local, out);
+
+  runner.Run(charStrings_.Item(glyph), 0);
+  runner.ClosePath();
+}
+
+}  // namespace beam
@@ -0,0 +1,49 @@
+// CFF (Type 2 charstring) glyph outlines for OpenType fonts with PostScript outlines, including CID-keyed fonts.
+#ifndef BEAM_ADDON_CFF_OUTLINE_H_
+#define BEAM_ADDON_CFF_OUTLINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "font.h"
+#include "path-buffer.h"
+
+namespace beam {
+
+// Offsets of the items of a CFF INDEX structure.
+struct CffIndex {
+  FontSpan data;
+  uint32_t count = 0;
+  uint8_t offsetSize = 0;
+  // Start of the offset array and of the item data (offsets are 1-based from there), and the end of the INDEX.
+  size_t offsets = 0;
+  size_t base = 0;
+  size_t end = 0;
+
+  // Reads the INDEX at `offset` of `data`; false when it runs past the end.
+  bool Read(FontSpan cff, size_t offset);
+  FontSpan Item(uint32_t i) const;
+};
+
+class CffOutlines {
+ public:
+  // Reads the CFF table's top dict, charstrings and subroutines; false when it is not a usable CFF version 1 table.
+  bool Parse(FontSpan cff);
+  // Appends the cubic outline of `glyph` in font units to `out`, every contour closed.
+  void Decode(uint16_t glyph, PathBuffer* out) const;
+
+ private:
+  bool ReadPrivate(FontSpan dict, CffIndex* subrs) const;
+
+  FontSpan cff_;
+  CffIndex charStrings_;
+  CffIndex globalSubrs_;
+  // Local subroutines: one set, or one per font dict of a CID-keyed font with fdSelect_ picking it per glyph.
+  std::vector<CffIndex> localSubrs_;
+  FontSpan fdSelect_;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_CFF_OUTLINE_H_
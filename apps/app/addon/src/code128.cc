@@ -0,0 +1,183 @@
+#include "code128.h"
+
+#include <string>
+
+namespace beam {
+
+namespace {
+
+// Bar and space widths of symbol values 0-105; the stop pattern follows separately.
+constexpr const char* kPatterns[106] = {
+    "212222", "222122", "222221", "121223", "121322", "131222", "122213", "122312", "132212", "221213", "221312",
+    "231212", "112232", "122132", "122231", "113222", "123122", "123221", "223211", "221132", "221231", "213212",
+    "223112", "312131", "311222", "321122", "321221", "312212", "322112", "322211", "212123", "212321", "232121",
+    "111323", "131123", "131321", "112313", "132113", "132311", "211313", "231113", "231311", "112133", "112331",
+    "132131", "113123", "113321", "133121", "313121", "211331", "231131", "213113", "213311", "213131", "311123",
+    "311321", "331121", "312113", "312311", "332111", "314111", "221411", "431111", "111224", "111422", "121124",
+    "121421", "141122", "141221", "112214", "112412", "122114", "122411", "142112", "142211", "241211", "221114",
+    "413111", "241112", "134111", "111242", "121142", "121241", "114212", "124112", "124211", "411212", "421112",
+    "421211", "212141", "214121", "412121", "111143", "111341", "131141", "114113", "114311", "411113", "411311",
+    "113141", "114131", "311141", "411131", "211412", "211214", "211232",
+};
+constexpr const char* kStopPattern = "2331112";
+
+// Symbol values with a meaning of their own.
+constexpr int kShift = 98;
+constexpr int kCodeC = 99;
+constexpr int kCodeB = 100;
+constexpr int kCodeA = 101;
+constexpr int kStartA = 103;
+constexpr int kModulo = 103;
+
+// Control markers in the character stream JsBarcode builds before encoding, which stay apart from ASCII: switches to
+// set C, B and A, a shift, and the start symbols.
+constexpr int kMarker = 1000;
+constexpr int kToC = kMarker + kCodeC;
+constexpr int kToB = kMarker + kCodeB;
+constexpr int kToA = kMarker + kCodeA;
+constexpr int kShiftMarker = kMarker + kShift;
+
+bool InSetA(char c) { return static_cast<unsigned char>(c) <= 0x5F; }
+bool InSetB(char c) { return c >= 0x20 && static_cast<unsigned char>(c) <= 0x7F; }
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+size_t LeadingRun(std::string_view text, bool (*inSet)(char)) {
+  size_t n = 0;
+
+  while (n < text.size() && inSet(text[n])) n += 1;
+
+  return n;
+}
+
+// Leading digits usable by set C: an even count.
+size_t LeadingPairs(std::string_view text) {
+  size_t n = LeadingRun(text, IsDigit);
+
+  return n - n % 2;
+}
+
+void SelectFromC(std::string_view text, std::vector<int>* out);
+
+// JsBarcode's autoSelectFromAB: stay in set A or B up to the shortest prefix followed by an even run of four or more
+// digits that ends the text or a non-digit, then switch to C; otherwise switch sets where the characters run out.
+void SelectFromAB(std::string_view text, bool setA, std::vector<int>* out) {
+  bool (*inSet)(char) = setA ? InSetA : InSetB;
+
+  for (size_t prefix = 1; prefix < text.size() && inSet(text[prefix - 1]); prefix += 1) {
+    size_t digits = LeadingRun(text.substr(prefix), IsDigit);
+
+    if (digits >= 4 && digits % 2 == 0) {
+      out->insert(out->end(), text.begin(), text.begin() + prefix);
+      out->push_back(kToC);
+      SelectFromC(text.substr(prefix), out);
+
+      return;
+    }
+  }
+
+  size_t run = LeadingRun(text, inSet);
+
+  out->insert(out->end(), text.begin(), text.begin() + run);
+  if (run == text.size()) return;
+  out->push_back(setA ? kToB : kToA);
+  SelectFromAB(text.substr(run), !setA, out);
+}
+
+void SelectFromC(std::string_view text, std::vector<int>* out) {
+  size_t pairs = LeadingPairs(text);
+
+  out->insert(out->end(), text.begin(), text.begin() + pairs);
+  if (pairs == text.size()) return;
+
+  std::string_view rest = text.substr(pairs);
+  bool setA = LeadingRun(rest, InSetA) >= LeadingRun(rest, InSetB);
+
+  out->push_back(setA ? kToA : kToB);
+  SelectFromAB(rest, setA, out);
+}
+
+}  // namespace
+
+bool EncodeCode128(std::string_view text, Code128Set set, std::vector<uint8_t>* modules) {
+  if (text.empty()) return false;
+
+  for (char c : text) {
+    if (static_cast<unsigned char>(c) > 0x7F) return false;
+  }
+
+  // Start symbol value, then characters and markers.
+  std::vector<int> stream;
+
+  if (set == Code128Set::kA || set == Code128Set::kB) {
+    if (LeadingRun(text, set == Code128Set::kA ? InSetA : InSetB) != text.size()) return false;
+    stream.push_back(set == Code128Set::kA ? kStartA : kStartA + 1);
+    stream.insert(stream.end(), text.begin(), text.end());
+  } else if (set == Code128Set::kC) {
+    if (LeadingPairs(text) != text.size()) return false;
+    stream.push_back(kStartA + 2);
+    stream.insert(stream.end(), text.begin(), text.end());
+  } else if (LeadingPairs(text) >= 2) {
+    stream.push_back(kStartA + 2);
+    SelectFromC(text, &stream);
+  } else {
+    bool setA = LeadingRun(text, InSetA) > LeadingRun(text, InSetB);
+
+    stream.push_back(setA ? kStartA : kStartA + 1);
+    SelectFromAB(text, setA, &stream);
+  }
+
+  // A single character between two switches becomes a shift instead, once, as JsBarcode does.
+  for (size_t i = 1; i + 2 < stream.size(); i += 1) {
+    bool switchBefore = stream[i] == kToA || stream[i] == kToB;
+    bool switchAfter = stream[i + 2] == kToA || stream[i + 2] == kToB;
+
+    if (switchBefore && switchAfter) {
+      stream[i] = kShiftMarker;
+      stream.erase(stream.begin() + i + 2);
+      break;
+    }
+  }
+
+  std::vector<int> values(1, stream[0]);
+  int current = stream[0] - kStartA;
+  long checksum = stream[0];
+
+  for (size_t i = 1; i < stream.size(); i += 1) {
+    int value;
+
+    if (stream[i] >= kMarker) {
+      value = stream[i] - kMarker;
+      if (value == kCodeA) current = 0;
+      if (value == kCodeB) current = 1;
+      if (value == kCodeC) current = 2;
+      if (value == kShift && i + 1 < stream.size()) {
+        // The shifted character is read in the other of sets A and B.
+        int& next = stream[i + 1];
+
+        if (current == 0 && next > 95) next -= 96;
+        if (current == 1 && next < 32) next += 96;
+      }
+    } else if (current == 0) {
+      value = stream[i] < 32 ? stream[i] + 64 : stream[i] - 32;
+    } else if (current == 1) {
+      value = stream[i] - 32;
+    } else {
+      value = (stream[i] - '0') * 10 + stream[i + 1] - '0';
+      i += 1;
+    }
+    checksum += static_cast<long>(value) * static_cast<long>(values.size());
+    values.push_back(value);
+  }
+  values.push_back(static_cast<int>(checksum % kModulo));
+
+  auto append = [modules](const char* widths) {
+    for (size_t k = 0; widths[k]; k += 1) modules->insert(modules->end(), widths[k] - '0', k % 2 == 0 ? 1 : 0);
+  };
+
+  for (int value : values) append(kPatterns[value]);
+  append(kStopPattern);
+
+  return true;
+}
+
+}  // namespace beam
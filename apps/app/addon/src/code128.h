@@ -0,0 +1,22 @@
+// Code 128 barcode encoder producing the same symbols as JsBarcode, which draws the editor's barcodes: the CODE128
+// format picks code sets with JsBarcode's rules (set C for runs of digit pairs, shifts for single characters of the
+// other set), CODE128A, CODE128B and CODE128C force one set.
+#ifndef BEAM_ADDON_CODE128_H_
+#define BEAM_ADDON_CODE128_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace beam {
+
+enum class Code128Set { kAuto, kA, kB, kC };
+
+// Appends the modules of `text` to `modules`, 1 for a bar and 0 for a space, from the start symbol to the stop
+// pattern. False when the set cannot encode the text: characters outside ASCII, characters missing from a forced
+// set, or an odd number of digits for set C.
+bool EncodeCode128(std::string_view text, Code128Set set, std::vector<uint8_t>* modules);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_CODE128_H_
@@ -0,0 +1,61 @@
+#include "crc32.h"
+
+#include <cstring>
+
+namespace beam {
+
+namespace {
+
+// Slicing-by-8: table[k][b] is the CRC of byte b followed by k zero bytes.
+struct Crc32Tables {
+  uint32_t table[8][256];
+
+  Crc32Tables() {
+    for (uint32_t b = 0; b < 256; b += 1) {
+      uint32_t crc = b;
+
+      for (int bit = 0; bit < 8; bit += 1) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+      table[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; b += 1) {
+      for (int k = 1; k < 8; k += 1) table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+    }
+  }
+};
+
+const Crc32Tables& Tables() {
+  static const Crc32Tables tables;
+
+  return tables;
+}
+
+}  // namespace
+
+uint32_t Crc32(const void* data, size_t size, uint32_t crc) {
+  const uint32_t(*table)[256] = Tables().table;
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+
+  crc = ~crc;
+  // Little-endian loads, like xxhash.cc.
+  while (size >= 8) {
+    uint32_t low;
+    uint32_t high;
+
+    memcpy(&low, p, 4);
+    memcpy(&high, p + 4, 4);
+    low ^= crc;
+    crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+          table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+    p += 8;
+    size -= 8;
+  }
+  while (size > 0) {
+    crc = (crc >> 8) ^ table[0][(crc ^ *p) & 0xFF];
+    p += 1;
+    size -= 1;
+  }
+
+  return ~crc;
+}
+
+}  // namespace beam
@@ -0,0 +1,15 @@
+// CRC-32 as used by zlib and PNG (reflected polynomial 0xEDB88320), for the FCode section checksums.
+#ifndef BEAM_ADDON_CRC32_H_
+#define BEAM_ADDON_CRC32_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace beam {
+
+// Continues `crc` over `data`; start from 0.
+uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_CRC32_H_
@@ -0,0 +1,481 @@
+#include "delaunay.h"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace beam {
+
+namespace {
+
+constexpr double kEpsilon = 2.220446049250313e-16;  // 2^-52, the duplicate point threshold used by Delaunator
+
+double Dist(double ax, double ay, double bx, double by) {
+  double dx = ax - bx;
+  double dy = ay - by;
+
+  return dx * dx + dy * dy;
+}
+
+// Negative when (r) lies to the left of p -> q, i.e. p, q, r are counter-clockwise.
+double Orient(double px, double py, double qx, double qy, double rx, double ry) {
+  return (qy - py) * (rx - qx) - (qx - px) * (ry - qy);
+}
+
+bool InCircle(double ax, double ay, double bx, double by, double cx, double cy, double px, double py) {
+  double dx = ax - px;
+  double dy = ay - py;
+  double ex = bx - px;
+  double ey = by - py;
+  double fx = cx - px;
+  double fy = cy - py;
+  double ap = dx * dx + dy * dy;
+  double bp = ex * ex + ey * ey;
+  double cp = fx * fx + fy * fy;
+
+  return dx * (ey * cp - bp * fy) - dy * (ex * cp - bp * fx) + ap * (ex * fy - ey * fx) < 0;
+}
+
+double Circumradius(double ax, double ay, double bx, double by, double cx, double cy) {
+  double dx = bx - ax;
+  double dy = by - ay;
+  double ex = cx - ax;
+  double ey = cy - ay;
+  double bl = dx * dx + dy * dy;
+  double cl = ex * ex + ey * ey;
+  double d = 0.5 / (dx * ey - dy * ex);
+  double x = (ey * bl - dy * cl) * d;
+  double y = (dx * cl - ex * bl) * d;
+
+  return x * x + y * y;
+}
+
+void Circumcenter(double ax, double ay, double bx, double by, double cx, double cy, double* x, double* y) {
+  double dx = bx - ax;
+  double dy = by - ay;
+  double ex = cx - ax;
+  double ey = cy - ay;
+  double bl = dx * dx + dy * dy;
+  double cl = ex * ex + ey * ey;
+  double d = 0.5 / (dx * ey - dy * ex);
+
+  *x = ax + (ey * bl - dy * cl) * d;
+  *y = ay + (dx * cl - ex * bl) * d;
+}
+
+// Monotonically increases with the real angle of (dx, dy) but needs no trigonometry.
+double PseudoAngle(double dx, double dy) {
+  double p = dx / (std::fabs(dx) + std::fabs(dy));
+
+  return (dy > 0 ? 3 - p : 1 + p) / 4;
+}
+
+// Same quicksort as Delaunator, so points at equal distances from the seed are inserted in the same order.
+void Quicksort(std::vector<uint32_t>& ids, const std::vector<double>& dists, int64_t left, int64_t right) {
+  if (right - left <= 20) {
+    for (int64_t i = left + 1; i <= right; i += 1) {
+      uint32_t temp = ids[i];
+      double tempDist = dists[temp];
+      int64_t j = i - 1;
+
+      while (j >= left && dists[ids[j]] > tempDist) {
+        ids[j + 1] = ids[j];
+        j -= 1;
+      }
+      ids[j + 1] = temp;
+    }
+
+    return;
+  }
+
+  int64_t median = (left + right) >> 1;
+  int64_t i = left + 1;
+  int64_t j = right;
+
+  std::swap(ids[median], ids[i]);
+  if (dists[ids[left]] > dists[ids[right]]) std::swap(ids[left], ids[right]);
+  if (dists[ids[i]] > dists[ids[right]]) std::swap(ids[i], ids[right]);
+  if (dists[ids[left]] > dists[ids[i]]) std::swap(ids[left], ids[i]);
+
+  uint32_t temp = ids[i];
+  double tempDist = dists[temp];
+
+  while (true) {
+    do i += 1;
+    while (dists[ids[i]] < tempDist);
+    do j -= 1;
+    while (dists[ids[j]] > tempDist);
+    if (j < i) break;
+    std::swap(ids[i], ids[j]);
+  }
+  ids[left + 1] = ids[j];
+  ids[j] = temp;
+
+  if (right - i + 1 >= j - left) {
+    Quicksort(ids, dists, i, right);
+    Quicksort(ids, dists, left, j - 1);
+  } else {
+    Quicksort(ids, dists, left, j - 1);
+    Quicksort(ids, dists, i, right);
+  }
+}
+
+class Triangulator {
+ public:
+  Triangulator(const double* xy, size_t count, size_t stride, Delaunay& out)
+      : n_(count), coords_(2 * count), triangles_(out.triangles), halfedges_(out.halfedges), hull_(out.hull) {
+    for (size_t i = 0; i < count; i += 1) {
+      coords_[2 * i] = xy[i * stride];
+      coords_[2 * i + 1] = xy[i * stride + 1];
+    }
+  }
+
+  void Run() {
+    size_t maxTriangles = n_ > 2 ? 2 * n_ - 5 : 0;
+
+    triangles_.assign(maxTriangles * 3, 0);
+    halfedges_.assign(maxTriangles * 3, -1);
+    hull_.clear();
+    if (n_ == 0) {
+      triangles_.clear();
+      halfedges_.clear();
+
+      return;
+    }
+
+    hashSize_ = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n_))));
+    hullPrev_.assign(n_, 0);
+    hullNext_.assign(n_, 0);
+    hullTri_.assign(n_, 0);
+    hullHash_.assign(hashSize_, -1);
+
+    std::vector<uint32_t> ids(n_);
+    std::vector<double> dists(n_);
+    double minX = INFINITY;
+    double minY = INFINITY;
+    double maxX = -INFINITY;
+    double maxY = -INFINITY;
+
+    for (size_t i = 0; i < n_; i += 1) {
+      double x = coords_[2 * i];
+      double y = coords_[2 * i + 1];
+
+      if (x < minX) minX = x;
+      if (y < minY) minY = y;
+      if (x > maxX) maxX = x;
+      if (y > maxY) maxY = y;
+      ids[i] = static_cast<uint32_t>(i);
+    }
+
+    double cx = (minX + maxX) / 2;
+    double cy = (minY + maxY) / 2;
+    uint32_t i0 = 0;
+    uint32_t i1 = 0;
+    uint32_t i2 = 0;
+    double minDist = INFINITY;
+
+    // Seed triangle: the point closest to the center, its nearest neighbour, and the point with the smallest
+    // circumcircle through both.
+    for (uint32_t i = 0; i < n_; i += 1) {
+      double d = Dist(cx, cy, X(i), Y(i));
+
+      if (d < minDist) {
+        i0 = i;
+        minDist = d;
+      }
+    }
+    minDist = INFINITY;
+    for (uint32_t i = 0; i < n_; i += 1) {
+      if (i == i0) continue;
+
+      double d = Dist(X(i0), Y(i0), X(i), Y(i));
+
+      if (d < minDist && d > 0) {
+        i1 = i;
+        minDist = d;
+      }
+    }
+
+    double minRadius = INFINITY;
+
+    for (uint32_t i = 0; i < n_; i += 1) {
+      if (i == i0 || i == i1) continue;
+
+      double r = Circumradius(X(i0), Y(i0), X(i1), Y(i1), X(i), Y(i));
+
+      if (r < minRadius) {
+        i2 = i;
+        minRadius = r;
+      }
+    }
+
+    if (minRadius == INFINITY) {
+      // Collinear (or fewer than three distinct) points: order them along the line and return an empty
+      // triangulation.
+      for (size_t i = 0; i < n_; i += 1) {
+        double d = coords_[2 * i] - coords_[0];
+
+        dists[i] = d != 0 ? d : coords_[2 * i + 1] - coords_[1];
+      }
+      Quicksort(ids, dists, 0, static_cast<int64_t>(n_) - 1);
+
+      double d0 = -INFINITY;
+
+      for (size_t i = 0; i < n_; i += 1) {
+        uint32_t id = ids[i];
+
+        if (dists[id] > d0) {
+          hull_.push_back(id);
+          d0 = dists[id];
+        }
+      }
+      triangles_.clear();
+      halfedges_.clear();
+
+      return;
+    }
+
+    // Make the seed triangle clockwise, as Delaunator does.
+    if (Orient(X(i0), Y(i0), X(i1), Y(i1), X(i2), Y(i2)) < 0) std::swap(i1, i2);
+
+    Circumcenter(X(i0), Y(i0), X(i1), Y(i1), X(i2), Y(i2), &cx_, &cy_);
+    for (size_t i = 0; i < n_; i += 1) dists[i] = Dist(coords_[2 * i], coords_[2 * i + 1], cx_, cy_);
+    Quicksort(ids, dists, 0, static_cast<int64_t>(n_) - 1);
+
+    hullStart_ = i0;
+
+    size_t hullSize = 3;
+
+    hullNext_[i0] = hullPrev_[i2] = i1;
+    hullNext_[i1] = hullPrev_[i0] = i2;
+    hullNext_[i2] = hullPrev_[i1] = i0;
+    hullTri_[i0] = 0;
+    hullTri_[i1] = 1;
+    hullTri_[i2] = 2;
+    hullHash_[HashKey(X(i0), Y(i0))] = i0;
+    hullHash_[HashKey(X(i1), Y(i1))] = i1;
+    hullHash_[HashKey(X(i2), Y(i2))] = i2;
+
+    trianglesLength_ = 0;
+    AddTriangle(i0, i1, i2, -1, -1, -1);
+
+    double xp = 0;
+    double yp = 0;
+
+    for (size_t k = 0; k < n_; k += 1) {
+      uint32_t i = ids[k];
+      double x = X(i);
+      double y = Y(i);
+
+      // Skip near-duplicate points.
+      if (k > 0 && std::fabs(x - xp) <= kEpsilon && std::fabs(y - yp) <= kEpsilon) continue;
+      xp = x;
+      yp = y;
+      if (i == i0 || i == i1 || i == i2) continue;
+
+      // Find a visible edge on the convex hull using the edge hash.
+      int64_t start = 0;
+      size_t key = HashKey(x, y);
+
+      for (size_t j = 0; j < hashSize_; j += 1) {
+        start = hullHash_[(key + j) % hashSize_];
+        if (start != -1 && start != hullNext_[start]) break;
+      }
+      start = hullPrev_[start];
+
+      int64_t e = start;
+      uint32_t q;
+
+      while (q = hullNext_[e], Orient(x, y, X(e), Y(e), X(q), Y(q)) >= 0) {
+        e = q;
+        if (e == start) {
+          e = -1;
+          break;
+        }
+      }
+      // Likely a near-duplicate point; skip it.
+      if (e == -1) continue;
+
+      // Add the first triangle from the point.
+      uint32_t t = AddTriangle(static_cast<uint32_t>(e), i, hullNext_[e], -1, -1, hullTri_[e]);
+
+      // Recursively flip triangles from the point until they satisfy the Delaunay condition.
+      hullTri_[i] = Legalize(t + 2);
+      hullTri_[e] = t;
+      hullSize += 1;
+
+      // Walk forward through the hull, adding more triangles and flipping recursively.
+      uint32_t next = hullNext_[e];
+
+      while (q = hullNext_[next], Orient(x, y, X(next), Y(next), X(q), Y(q)) < 0) {
+        t = AddTriangle(next, i, q, hullTri_[i], -1, hullTri_[next]);
+        hullTri_[i] = Legalize(t + 2);
+        hullNext_[next] = next;  // mark as removed
+        hullSize -= 1;
+        next = q;
+      }
+
+      // Walk backward from the other side, adding more triangles and flipping.
+      if (e == start) {
+        while (q = hullPrev_[e], Orient(x, y, X(q), Y(q), X(e), Y(e)) < 0) {
+          t = AddTriangle(q, i, static_cast<uint32_t>(e), -1, hullTri_[e], hullTri_[q]);
+          Legalize(t + 2);
+          hullTri_[q] = t;
+          hullNext_[e] = static_cast<uint32_t>(e);  // mark as removed
+          hullSize -= 1;
+          e = q;
+        }
+      }
+
+      // Update the hull indices.
+      hullStart_ = hullPrev_[i] = static_cast<uint32_t>(e);
+      hullNext_[e] = hullPrev_[next] = i;
+      hullNext_[i] = next;
+
+      // Save the two new edges in the hash table.
+      hullHash_[HashKey(x, y)] = i;
+      hullHash_[HashKey(X(e), Y(e))] = static_cast<int32_t>(e);
+    }
+
+    hull_.resize(hullSize);
+    for (size_t i = 0, e = hullStart_; i < hullSize; i += 1) {
+      hull_[i] = static_cast<uint32_t>(e);
+      e = hullNext_[e];
+    }
+    triangles_.resize(trianglesLength_);
+    halfedges_.resize(trianglesLength_);
+  }
+
+ private:
+  double X(size_t i) const { return coords_[2 * i]; }
+  double Y(size_t i) const { return coords_[2 * i + 1]; }
+
+  size_t HashKey(double x, double y) const {
+    double angle = PseudoAngle(x - cx_, y - cy_);
+
+    // A point exactly on the seed circumcenter has no angle.
+    if (std::isnan(angle)) return 0;
+
+    return static_cast<size_t>(std::floor(angle * hashSize_)) % hashSize_;
+  }
+
+  void Link(size_t a, int64_t b) {
+    halfedges_[a] = static_cast<int32_t>(b);
+    if (b != -1) halfedges_[b] = static_cast<int32_t>(a);
+  }
+
+  uint32_t AddTriangle(uint32_t i0, uint32_t i1, uint32_t i2, int64_t a, int64_t b, int64_t c) {
+    size_t t = trianglesLength_;
+
+    triangles_[t] = i0;
+    triangles_[t + 1] = i1;
+    triangles_[t + 2] = i2;
+    Link(t, a);
+    Link(t + 1, b);
+    Link(t + 2, c);
+    trianglesLength_ += 3;
+
+    return static_cast<uint32_t>(t);
+  }
+
+  uint32_t Legalize(uint32_t a) {
+    size_t i = 0;
+    uint32_t ar = 0;
+
+    // Iterative edge flipping with a fixed stack, like Delaunator, instead of recursion.
+    while (true) {
+      int32_t b = halfedges_[a];
+
+      /* if the pair of triangles doesn't satisfy the Delaunay condition (p1 is inside the circumcircle of
+       * [p0, pl, pr]), flip them, then do the same check/flip recursively for the new pair of triangles
+       *
+       *           pl                    pl
+       *          /||\                  /  \
+       *       al/ || \bl            al/    \a
+       *        /  ||  \              /      \
+       *       /  a||b  \    flip    /___ar___\
+       *     p0\   ||   /p1   =>   p0\---bl---/p1
+       *        \  ||  /              \      /
+       *       ar\ || /br             b\    /br
+       *          \||/                  \  /
+       *           pr                    pr
+       */
+      uint32_t a0 = a - a % 3;
+
+      ar = a0 + (a + 2) % 3;
+      if (b == -1) {
+        // Convex hull edge.
+        if (i == 0) break;
+        a = edgeStack_[--i];
+        continue;
+      }
+
+      uint32_t b0 = b - b % 3;
+      uint32_t al = a0 + (a + 1) % 3;
+      uint32_t bl = b0 + (b + 2) % 3;
+      uint32_t p0 = triangles_[ar];
+      uint32_t pr = triangles_[a];
+      uint32_t pl = triangles_[al];
+      uint32_t p1 = triangles_[bl];
+
+      if (InCircle(X(p0), Y(p0), X(pr), Y(pr), X(pl), Y(pl), X(p1), Y(p1))) {
+        triangles_[a] = p1;
+        triangles_[b] = p0;
+
+        int32_t hbl = halfedges_[bl];
+
+        // The edge was swapped on the other side of the hull (rare); fix the halfedge reference.
+        if (hbl == -1) {
+          uint32_t e = hullStart_;
+
+          do {
+            if (hullTri_[e] == bl) {
+              hullTri_[e] = a;
+              break;
+            }
+            e = hullPrev_[e];
+          } while (e != hullStart_);
+        }
+        Link(a, hbl);
+        Link(b, halfedges_[ar]);
+        Link(ar, bl);
+
+        uint32_t br = b0 + (b + 1) % 3;
+
+        // Don't worry about hitting the cap: it can only happen on extremely degenerate input.
+        if (i < kEdgeStackSize) edgeStack_[i++] = br;
+      } else {
+        if (i == 0) break;
+        a = edgeStack_[--i];
+      }
+    }
+
+    return ar;
+  }
+
+  static constexpr size_t kEdgeStackSize = 512;
+
+  size_t n_;
+  std::vector<double> coords_;
+  std::vector<uint32_t>& triangles_;
+  std::vector<int32_t>& halfedges_;
+  std::vector<uint32_t>& hull_;
+  std::vector<uint32_t> hullPrev_;
+  std::vector<uint32_t> hullNext_;
+  std::vector<uint32_t> hullTri_;
+  std::vector<int32_t> hullHash_;
+  size_t hashSize_ = 0;
+  size_t trianglesLength_ = 0;
+  uint32_t hullStart_ = 0;
+  double cx_ = 0;
+  double cy_ = 0;
+  uint32_t edgeStack_[kEdgeStackSize];
+};
+
+}  // namespace
+
+void DelaunayTriangulate(const double* xy, size_t count, size_t stride, Delaunay& out) {
+  Triangulator(xy, count, stride, out).Run();
+}
+
+}  // namespace beam
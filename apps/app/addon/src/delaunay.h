@@ -0,0 +1,27 @@
+// Delaunay triangulation by sweep hull, a port of the Delaunator library used by the curve engraving preview, so the
+// native and JS meshes have the same triangles and winding.
+#ifndef BEAM_ADDON_DELAUNAY_H_
+#define BEAM_ADDON_DELAUNAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace beam {
+
+struct Delaunay {
+  // Vertex indices, three per triangle.
+  std::vector<uint32_t> triangles;
+  // Opposite half-edge of every triangle edge, -1 on the convex hull.
+  std::vector<int32_t> halfedges;
+  // Convex hull vertex indices.
+  std::vector<uint32_t> hull;
+};
+
+// Triangulates `count` points read at `xy[i * stride]`, `xy[i * stride + 1]`. Duplicate points are skipped; collinear
+// input gives no triangles and a hull ordered along the line.
+void DelaunayTriangulate(const double* xy, size_t count, size_t stride, Delaunay& out);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_DELAUNAY_H_
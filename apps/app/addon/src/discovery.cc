@@ -0,0 +1,513 @@
+#include "discovery.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+#include "mdns.h"
+
+namespace beam {
+
+namespace {
+
+// Large enough for any datagram on an Ethernet LAN, jumbo frames included.
+constexpr size_t kDatagramSize = 9216;
+
+bool ResolveIPv4(const std::string& host, uint16_t port, sockaddr_in* address) {
+  *address = {};
+  address->sin_family = AF_INET;
+  address->sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &address->sin_addr) == 1) return true;
+
+  addrinfo hints = {};
+  addrinfo* addresses = nullptr;
+
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (getaddrinfo(host.c_str(), nullptr, &hints, &addresses) != 0 || !addresses) return false;
+  address->sin_addr = reinterpret_cast<const sockaddr_in*>(addresses->ai_addr)->sin_addr;
+  freeaddrinfo(addresses);
+
+  return true;
+}
+
+// A non-blocking UDP socket bound to `port` on all interfaces, or kInvalidSocket with `error` set.
+SocketHandle OpenUdpSocket(uint16_t port, std::string* error) {
+  SocketHandle handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int one = 1;
+  sockaddr_in address = {};
+
+  if (handle == kInvalidSocket) {
+    *error = SocketErrorText(LastSocketError());
+
+    return kInvalidSocket;
+  }
+  // Other discovery clients on the machine, such as the backend, may listen on the same port.
+  setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+#ifdef SO_REUSEPORT
+  setsockopt(handle, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&one), sizeof(one));
+#endif
+  setsockopt(handle, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<const char*>(&one), sizeof(one));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || !SetNonBlocking(handle)) {
+    *error = SocketErrorText(LastSocketError());
+    CloseSocket(handle);
+
+    return kInvalidSocket;
+  }
+
+  return handle;
+}
+
+std::string Lowercase(std::string text) {
+  for (char& c : text) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + 32);
+  }
+
+  return text;
+}
+
+// The string or number value of the first `"name":` in a JSON text, or an empty string.
+std::string JsonField(const std::string& text, const std::string& name) {
+  std::string quoted = "\"" + name + "\"";
+
+  for (size_t found = text.find(quoted); found != std::string::npos; found = text.find(quoted, found + 1)) {
+    size_t value = text.find_first_not_of(" \t\r\n", found + quoted.size());
+
+    if (value == std::string::npos || text[value] != ':') continue;
+    value = text.find_first_not_of(" \t\r\n", value + 1);
+    if (value == std::string::npos) return std::string();
+    if (text[value] == '"') {
+      size_t close = text.find('"', value + 1);
+
+      return close == std::string::npos ? std::string() : text.substr(value + 1, close - value - 1);
+    }
+    if (text[value] != '-' && (text[value] < '0' || text[value] > '9')) return std::string();
+
+    return text.substr(value, text.find_first_of(",}] \t\r\n", value) - value);
+  }
+
+  return std::string();
+}
+
+// The TTL of an mDNS record in milliseconds, capped at `limit`; 0 for a goodbye.
+int RecordTtlMs(uint32_t ttl, int limit) { return static_cast<int>(std::min<int64_t>(ttl * int64_t{1000}, limit)); }
+
+}  // namespace
+
+bool DiscoveredDevice::SameContent(const DiscoveredDevice& other) const {
+  return source == other.source && identity == other.identity && name == other.name && address == other.address &&
+         port == other.port && payload == other.payload && txt == other.txt;
+}
+
+DiscoveryService::DiscoveryService(DiscoveryOptions options) : options_(std::move(options)) {}
+
+DiscoveryService::~DiscoveryService() {
+  for (SocketHandle handle : listen_) CloseSocket(handle);
+  if (pokeSocket_ != kInvalidSocket) CloseSocket(pokeSocket_);
+  if (mdnsSocket_ != kInvalidSocket) CloseSocket(mdnsSocket_);
+}
+
+bool DiscoveryService::Open(std::string* error) {
+  std::string reason;
+
+  for (uint16_t port : options_.listenPorts) {
+    SocketHandle handle = OpenUdpSocket(port, &reason);
+
+    if (handle == kInvalidSocket) {
+      *error = "cannot listen on UDP port " + std::to_string(port) + ": " + reason;
+
+      return false;
+    }
+    listen_.push_back(handle);
+    for (const std::string& group : options_.multicastGroups) {
+      ip_mreq membership = {};
+
+      membership.imr_interface.s_addr = htonl(INADDR_ANY);
+      if (inet_pton(AF_INET, group.c_str(), &membership.imr_multiaddr) != 1 ||
+          setsockopt(handle, IPPROTO_IP, IP_ADD_MEMBERSHIP, reinterpret_cast<const char*>(&membership),
+                     sizeof(membership)) != 0) {
+        *error = "cannot join multicast group '" + group + "'";
+
+        return false;
+      }
+    }
+  }
+  if (!options_.pokes.empty()) {
+    pokeSocket_ = OpenUdpSocket(0, &reason);
+    if (pokeSocket_ == kInvalidSocket) {
+      *error = "cannot open the poke socket: " + reason;
+
+      return false;
+    }
+  }
+  if (!options_.mdnsHosts.empty() || !options_.mdnsServices.empty()) {
+    // Link-local multicast is sent with TTL 255, as responders check.
+    int ttl = 255;
+
+    mdnsSocket_ = OpenUdpSocket(0, &reason);
+    if (mdnsSocket_ == kInvalidSocket) {
+      *error = "cannot open the mDNS socket: " + reason;
+
+      return false;
+    }
+    setsockopt(mdnsSocket_, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&ttl), sizeof(ttl));
+  }
+
+  return true;
+}
+
+void DiscoveryService::Poke(const std::string& host) {
+  std::lock_guard<std::mutex> lock(pokeMutex_);
+
+  pendingPokes_.push_back(host);
+}
+
+void DiscoveryService::Run(const std::atomic<bool>& stop, const std::function<void(DiscoveryDelta&&)>& changed) {
+  Clock::time_point nextPoke = Clock::now();
+  Clock::time_point nextQuery = nextPoke;
+  std::vector<PollEntry> entries;
+  std::vector<uint16_t> localPorts;
+
+  for (size_t i = 0; i < listen_.size(); i += 1) {
+    entries.push_back({listen_[i], POLLIN, 0});
+    localPorts.push_back(options_.listenPorts[i]);
+  }
+  for (SocketHandle handle : {pokeSocket_, mdnsSocket_}) {
+    if (handle == kInvalidSocket) continue;
+    entries.push_back({handle, POLLIN, 0});
+    localPorts.push_back(0);
+  }
+  while (!stop) {
+    Clock::time_point now = Clock::now();
+    std::vector<std::string> pokes;
+
+    if (pokeSocket_ != kInvalidSocket && now >= nextPoke) {
+      for (const DiscoveryPoke& poke : options_.pokes) SendPoke(poke.host, poke);
+      nextPoke = now + std::chrono::milliseconds(options_.pokeIntervalMs);
+    }
+    {
+      std::lock_guard<std::mutex> lock(pokeMutex_);
+
+      pokes.swap(pendingPokes_);
+    }
+    for (const std::string& host : pokes) {
+      for (const DiscoveryPoke& poke : options_.pokes) SendPoke(host, poke);
+    }
+    if (mdnsSocket_ != kInvalidSocket && now >= nextQuery) {
+      SendQuery();
+      nextQuery = now + std::chrono::milliseconds(options_.mdnsIntervalMs);
+    }
+
+    Clock::time_point wake = std::min(Sweep(now), now + std::chrono::milliseconds(kSocketPollSlice));
+
+    if (pokeSocket_ != kInvalidSocket) wake = std::min(wake, nextPoke);
+    if (mdnsSocket_ != kInvalidSocket) wake = std::min(wake, nextQuery);
+    if (!changeOrder_.empty()) {
+      DiscoveryDelta delta = TakeDelta();
+
+      if (!delta.Empty()) changed(std::move(delta));
+    }
+
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(wake - Clock::now()).count();
+    int waitMs = static_cast<int>(std::max<int64_t>(0, micros + 999) / 1000);
+
+    if (PollSockets(entries.data(), entries.size(), waitMs) <= 0) continue;
+    now = Clock::now();
+    for (size_t i = 0; i < entries.size(); i += 1) {
+      if (entries[i].revents) Receive(entries[i].handle, localPorts[i], now);
+    }
+  }
+}
+
+void DiscoveryService::SendPoke(const std::string& host, const DiscoveryPoke& poke) {
+  sockaddr_in address;
+
+  if (!ResolveIPv4(host, poke.port, &address)) return;
+  sendto(pokeSocket_, reinterpret_cast<const char*>(poke.payload.data()), static_cast<int>(poke.payload.size()), 0,
+         reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+void DiscoveryService::SendQuery() {
+  std::vector<DnsQuestion> questions;
+  sockaddr_in address;
+
+  for (const std::string& host : options_.mdnsHosts) questions.push_back({host, kDnsA});
+  for (const std::string& service : options_.mdnsServices) questions.push_back({service, kDnsPtr});
+  if (!ResolveIPv4(options_.mdnsAddress, options_.mdnsPort, &address)) return;
+
+  std::vector<uint8_t> query = BuildDnsQuery(questions, queryId_);
+
+  queryId_ += 1;
+  sendto(mdnsSocket_, reinterpret_cast<const char*>(query.data()), static_cast<int>(query.size()), 0,
+         reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+void DiscoveryService::Receive(SocketHandle handle, uint16_t localPort, Clock::time_point now) {
+  std::vector<uint8_t> buffer(kDatagramSize);
+
+  while (true) {
+    sockaddr_in from = {};
+    socklen_t fromLength = sizeof(from);
+    int size = static_cast<int>(recvfrom(handle, reinterpret_cast<char*>(buffer.data()),
+                                         static_cast<int>(buffer.size()), 0, reinterpret_cast<sockaddr*>(&from),
+                                         &fromLength));
+    char text[INET_ADDRSTRLEN];
+
+    if (size < 0) return;
+    if (from.sin_family != AF_INET || !inet_ntop(AF_INET, &from.sin_addr, text, sizeof(text))) continue;
+    if (handle == mdnsSocket_) {
+      OnDnsResponse(buffer.data(), static_cast<size_t>(size), text, now);
+      continue;
+    }
+
+    DiscoveredDevice device;
+
+    device.key = "udp:" + std::string(text) + ":" + std::to_string(localPort);
+    device.address = text;
+    device.port = ntohs(from.sin_port);
+    device.payload.assign(buffer.begin(), buffer.begin() + size);
+    Upsert(std::move(device), options_.ttlMs, now);
+  }
+}
+
+void DiscoveryService::OnDnsResponse(const uint8_t* data, size_t size, const std::string& from,
+                                     Clock::time_point now) {
+  std::vector<DnsRecord> records;
+  auto queried = [](const std::vector<std::string>& names, const std::string& name) {
+    return std::any_of(names.begin(), names.end(), [&](const std::string& item) { return SameDnsName(item, name); });
+  };
+
+  if (!ParseDnsResponse(data, size, &records)) return;
+  for (const DnsRecord& record : records) {
+    DiscoveredDevice device;
+
+    device.source = DeviceSource::kMdns;
+    if (record.type == kDnsA && queried(options_.mdnsHosts, record.name)) {
+      device.name = record.name;
+      device.address = record.data;
+    } else if (record.type == kDnsPtr && queried(options_.mdnsServices, record.name)) {
+      std::string target;
+
+      // The instance's SRV, TXT and address records usually ride along as additional records.
+      device.name = record.data;
+      device.address = from;
+      for (const DnsRecord& other : records) {
+        if (other.type == kDnsSrv && SameDnsName(other.name, record.data)) {
+          device.port = other.port;
+          target = other.data;
+        } else if (other.type == kDnsTxt && SameDnsName(other.name, record.data)) {
+          device.txt = other.strings;
+        }
+      }
+      for (const DnsRecord& other : records) {
+        if (other.type == kDnsA && !target.empty() && SameDnsName(other.name, target)) {
+          device.address = other.data;
+          break;
+        }
+      }
+    } else {
+      continue;
+    }
+    if (!device.name.empty() && device.name.back() == '.') device.name.pop_back();
+    device.key = "mdns:" + Lowercase(device.name);
+    Upsert(std::move(device), RecordTtlMs(record.ttl, options_.ttlMs), now);
+  }
+}
+
+std::string DiscoveryService::Identity(const DiscoveredDevice& device) const {
+  if (device.source == DeviceSource::kMdns) {
+    // TXT keys are case-insensitive (RFC 6763 section 6.4).
+    for (const std::string& field : options_.identityFields) {
+      for (const std::string& entry : device.txt) {
+        size_t separator = entry.find('=');
+
+        if (separator != std::string::npos && separator + 1 < entry.size() &&
+            Lowercase(entry.substr(0, separator)) == Lowercase(field)) {
+          return entry.substr(separator + 1);
+        }
+      }
+    }
+
+    return std::string();
+  }
+
+  std::string text(device.payload.begin(), device.payload.end());
+  size_t start = text.find_first_not_of(" \t\r\n");
+
+  if (start != std::string::npos && text[start] == '{') {
+    for (const std::string& field : options_.identityFields) {
+      std::string value = JsonField(text, field);
+
+      if (!value.empty()) return value;
+    }
+
+    return std::string();
+  }
+  if (options_.identityLength == 0 || device.payload.size() < options_.identityOffset ||
+      device.payload.size() - options_.identityOffset < options_.identityLength) {
+    return std::string();
+  }
+
+  static const char kHex[] = "0123456789abcdef";
+  std::string hex;
+
+  for (size_t i = 0; i < options_.identityLength; i += 1) {
+    uint8_t byte = device.payload[options_.identityOffset + i];
+
+    hex.push_back(kHex[byte >> 4]);
+    hex.push_back(kHex[byte & 15]);
+  }
+
+  return hex;
+}
+
+void DiscoveryService::Upsert(DiscoveredDevice device, int ttlMs, Clock::time_point now) {
+  std::string heardAs = device.key;
+  auto alias = aliases_.find(heardAs);
+
+  device.identity = Identity(device);
+  if (!device.identity.empty()) {
+    device.key = "id:" + Lowercase(device.identity);
+  } else if (alias != aliases_.end()) {
+    device.key = alias->second;
+  }
+  if (ttlMs <= 0) {
+    auto found = table_.find(device.key);
+
+    // A goodbye on one transport leaves the device listed while it is still heard on another.
+    if (alias != aliases_.end()) aliases_.erase(alias);
+    if (found != table_.end()) found->second.heard.erase(heardAs);
+    if (std::none_of(aliases_.begin(), aliases_.end(), [&](const auto& item) { return item.second == device.key; })) {
+      Remove(device.key);
+    }
+
+    return;
+  }
+
+  Clock::time_point expires = now + std::chrono::milliseconds(ttlMs);
+  auto found = table_.find(device.key);
+
+  if (device.key != heardAs) aliases_[heardAs] = device.key;
+  if (found == table_.end()) {
+    std::string key = device.key;
+    Entry entry{device, {}, expires, now, false};
+
+    entry.heard.emplace(heardAs, std::move(device));
+    table_.emplace(key, std::move(entry));
+    Mark(key, Change::kAdded);
+
+    return;
+  }
+
+  Entry& entry = found->second;
+  auto last = entry.heard.find(heardAs);
+
+  entry.expires = expires;
+  // An answer without the identity, such as a PTR record whose TXT record did not ride along, only keeps it listed.
+  if (device.identity.empty() && !entry.device.identity.empty()) return;
+  // Comparing with what this transport said last, not with the entry, keeps alternating transports from reading as
+  // changes.
+  if (last != entry.heard.end() && last->second.SameContent(device)) return;
+  entry.heard[heardAs] = device;
+  if (entry.device.SameContent(device)) return;
+  entry.device = std::move(device);
+  entry.dirty = true;
+}
+
+void DiscoveryService::Remove(const std::string& key) {
+  if (table_.erase(key) == 0) return;
+  Forget(key);
+  Mark(key, Change::kRemoved);
+}
+
+void DiscoveryService::Forget(const std::string& key) {
+  for (auto it = aliases_.begin(); it != aliases_.end();) {
+    it = it->second == key ? aliases_.erase(it) : std::next(it);
+  }
+}
+
+void DiscoveryService::Mark(const std::string& key, Change change) {
+  auto found = changes_.find(key);
+
+  if (found == changes_.end()) {
+    changes_.emplace(key, change);
+    changeOrder_.push_back(key);
+
+    return;
+  }
+  // Within one pass, an added entry stays added until it goes away again, and one that came back was updated.
+  if (found->second == Change::kAdded && change == Change::kRemoved) {
+    changes_.erase(found);
+  } else if (found->second == Change::kRemoved && change == Change::kAdded) {
+    found->second = Change::kUpdated;
+  } else if (found->second != Change::kAdded) {
+    found->second = change;
+  }
+}
+
+DiscoveryService::Clock::time_point DiscoveryService::Sweep(Clock::time_point now) {
+  Clock::time_point next = Clock::time_point::max();
+  std::chrono::milliseconds updateInterval(options_.updateIntervalMs);
+
+  for (auto it = table_.begin(); it != table_.end();) {
+    Entry& entry = it->second;
+
+    if (entry.expires <= now) {
+      Forget(it->first);
+      Mark(it->first, Change::kRemoved);
+      it = table_.erase(it);
+      continue;
+    }
+    next = std::min(next, entry.expires);
+    if (entry.dirty && entry.reported + updateInterval <= now) {
+      entry.dirty = false;
+      entry.reported = now;
+      Mark(it->first, Change::kUpdated);
+    } else if (entry.dirty) {
+      next = std::min(next, entry.reported + updateInterval);
+    }
+    ++it;
+  }
+
+  return next;
+}
+
+DiscoveryDelta DiscoveryService::TakeDelta() {
+  DiscoveryDelta delta;
+
+  for (const std::string& key : changeOrder_) {
+    auto found = changes_.find(key);
+
+    if (found == changes_.end()) continue;
+
+    Change change = found->second;
+    auto entry = table_.find(key);
+
+    changes_.erase(found);
+    if (change == Change::kRemoved) {
+      delta.removed.push_back(key);
+    } else if (entry != table_.end()) {
+      (change == Change::kAdded ? delta.added : delta.updated).push_back(entry->second.device);
+    }
+  }
+  changeOrder_.clear();
+
+  return delta;
+}
+
+}  // namespace beam
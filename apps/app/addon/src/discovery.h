@@ -0,0 +1,148 @@
+// Device discovery on the local network: announcements received on UDP ports (e.g. the FLUX discover port 1901,
+// joined to its multicast group), replies to UDP pokes sent to broadcast or known addresses, and mDNS answers for
+// host names and service types. Everything seen goes into one table keyed per device, where an entry lives for a TTL
+// after it was last heard from, and only additions, content changes and expiries are reported. A device whose
+// announcement carries an identity (a serial or uuid) is one entry whichever transport and address it is heard on.
+//
+// mDNS queries are legacy unicast ones (RFC 6762 section 6.7), sent from an ephemeral port, so responders answer
+// directly and nothing has to share port 5353 with the system's own responder.
+#ifndef BEAM_ADDON_DISCOVERY_H_
+#define BEAM_ADDON_DISCOVERY_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "socket.h"
+
+namespace beam {
+
+struct DiscoveryPoke {
+  // IPv4 address or host name; 255.255.255.255 and subnet broadcast addresses are allowed.
+  std::string host;
+  uint16_t port;
+  std::vector<uint8_t> payload;
+};
+
+struct DiscoveryOptions {
+  std::vector<uint16_t> listenPorts;
+  // IPv4 multicast groups joined on every listen port.
+  std::vector<std::string> multicastGroups;
+  std::vector<DiscoveryPoke> pokes;
+  int pokeIntervalMs = 5000;
+  // Names queried for their addresses, and service types for their instances.
+  std::vector<std::string> mdnsHosts;
+  std::vector<std::string> mdnsServices;
+  std::string mdnsAddress = "224.0.0.251";
+  uint16_t mdnsPort = 5353;
+  int mdnsIntervalMs = 5000;
+  // An entry not heard from for this long is removed; mDNS records with a shorter TTL expire sooner.
+  int ttlMs = 15000;
+  // A device whose content keeps changing is reported at most this often, with its latest content.
+  int updateIntervalMs = 1000;
+  // Names of the device identity, such as "uuid" or "serial", tried in order as mDNS TXT keys and as fields of UDP
+  // payloads that are JSON objects.
+  std::vector<std::string> identityFields;
+  // Other UDP payloads: the identity is identityLength bytes from identityOffset, in hex; 0 for none.
+  size_t identityOffset = 0;
+  size_t identityLength = 0;
+};
+
+enum class DeviceSource : uint8_t { kUdp, kMdns };
+
+struct DiscoveredDevice {
+  // "id:<identity>" when the announcement has one, else "udp:<address>:<local port>" (local port 0 for replies to
+  // pokes) or "mdns:<name>"; lowercase.
+  std::string key;
+  std::string identity;
+  DeviceSource source = DeviceSource::kUdp;
+  // mDNS host or service instance name.
+  std::string name;
+  std::string address;
+  // Source port of a UDP datagram, or the SRV port of a service instance.
+  uint16_t port = 0;
+  // The last UDP datagram.
+  std::vector<uint8_t> payload;
+  std::vector<std::string> txt;
+
+  bool SameContent(const DiscoveredDevice& other) const;
+};
+
+struct DiscoveryDelta {
+  std::vector<DiscoveredDevice> added;
+  std::vector<DiscoveredDevice> updated;
+  std::vector<std::string> removed;
+
+  bool Empty() const { return added.empty() && updated.empty() && removed.empty(); }
+};
+
+class DiscoveryService {
+ public:
+  explicit DiscoveryService(DiscoveryOptions options);
+  ~DiscoveryService();
+
+  DiscoveryService(const DiscoveryService&) = delete;
+  DiscoveryService& operator=(const DiscoveryService&) = delete;
+
+  // Opens and binds the sockets; false with `error` set when a listen port or group is unavailable.
+  bool Open(std::string* error);
+  // Sends pokes and queries on schedule and takes in answers until `stop`. `changed` is called with the changes of
+  // every pass that had any.
+  void Run(const std::atomic<bool>& stop, const std::function<void(DiscoveryDelta&&)>& changed);
+  // Sends the configured poke payloads to `host` as well, on the next pass; safe from any thread.
+  void Poke(const std::string& host);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Change : uint8_t { kAdded, kUpdated, kRemoved };
+
+  struct Entry {
+    // The last announcement reported, from whichever transport.
+    DiscoveredDevice device;
+    // The last announcement per transport key, so a device heard on several only changes when one of them does.
+    std::unordered_map<std::string, DiscoveredDevice> heard;
+    Clock::time_point expires;
+    Clock::time_point reported;
+    // Content changed since it was last reported.
+    bool dirty = false;
+  };
+
+  void SendPoke(const std::string& host, const DiscoveryPoke& poke);
+  void SendQuery();
+  void Receive(SocketHandle handle, uint16_t localPort, Clock::time_point now);
+  void OnDnsResponse(const uint8_t* data, size_t size, const std::string& from, Clock::time_point now);
+  std::string Identity(const DiscoveredDevice& device) const;
+  void Upsert(DiscoveredDevice device, int ttlMs, Clock::time_point now);
+  void Remove(const std::string& key);
+  // Drops the transport keys of a removed entry.
+  void Forget(const std::string& key);
+  void Mark(const std::string& key, Change change);
+  // Reports dirty entries that are due and expires stale ones; returns the next time either is needed.
+  Clock::time_point Sweep(Clock::time_point now);
+  DiscoveryDelta TakeDelta();
+
+  DiscoveryOptions options_;
+  std::vector<SocketHandle> listen_;
+  SocketHandle pokeSocket_ = kInvalidSocket;
+  SocketHandle mdnsSocket_ = kInvalidSocket;
+  std::unordered_map<std::string, Entry> table_;
+  // Transport key ("udp:..." or "mdns:...") of each way an identified entry is heard, to the entry's key.
+  std::unordered_map<std::string, std::string> aliases_;
+  // Changes of the current pass, in order.
+  std::unordered_map<std::string, Change> changes_;
+  std::vector<std::string> changeOrder_;
+  uint16_t queryId_ = 1;
+
+  std::mutex pokeMutex_;
+  std::vector<std::string> pendingPokes_;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_DISCOVERY_H_
@@ -0,0 +1,1230 @@
+#include "dxf-reader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "affine.h"
+#include "flatten.h"
+#include "vec2.h"
+
+namespace beam {
+
+namespace {
+
+// AutoCAD Color Index to 0xRRGGBB, the table dxf2svg uses.
+constexpr uint32_t kAciColors[256] = {
+    0x000000, 0xFF0000, 0xFFFF00, 0x00FF00, 0x00FFFF, 0x0000FF, 0xFF00FF, 0xFFFFFF, 0x414141, 0x808080, 0xFF0000,
+    0xFFAAAA, 0xBD0000, 0xBD7E7E, 0x810000, 0x815656, 0x680000, 0x684545, 0x4F0000, 0x4F3535, 0xFF3F00, 0xFFBFAA,
+    0xBD2E00, 0xBD8D7E, 0x811F00, 0x816056, 0x681900, 0x684E45, 0x4F1300, 0x4F3B35, 0xFF7F00, 0xFFD4AA, 0xBD5E00,
+    0xBD9D7E, 0x814000, 0x816B56, 0x683400, 0x685645, 0x4F2700, 0x4F4235, 0xFFBF00, 0xFFEAAA, 0xBD8D00, 0xBDAD7E,
+    0x816000, 0x817656, 0x684E00, 0x685F45, 0x4F3B00, 0x4F4935, 0xFFFF00, 0xFFFFAA, 0xBDBD00, 0xBDBD7E, 0x818100,
+    0x818156, 0x686800, 0x686845, 0x4F4F00, 0x4F4F35, 0xBFFF00, 0xEAFFAA, 0x8DBD00, 0xADBD7E, 0x608100, 0x768156,
+    0x4E6800, 0x5F6845, 0x3B4F00, 0x494F35, 0x7FFF00, 0xD4FFAA, 0x5EBD00, 0x9DBD7E, 0x408100, 0x6B8156, 0x346800,
+    0x566845, 0x274F00, 0x424F35, 0x3FFF00, 0xBFFFAA, 0x2EBD00, 0x8DBD7E, 0x1F8100, 0x608156, 0x196800, 0x4E6845,
+    0x134F00, 0x3B4F35, 0x00FF00, 0xAAFFAA, 0x00BD00, 0x7EBD7E, 0x008100, 0x568156, 0x006800, 0x456845, 0x004F00,
+    0x354F35, 0x00FF3F, 0xAAFFBF, 0x00BD2E, 0x7EBD8D, 0x00811F, 0x568160, 0x006819, 0x45684E, 0x004F13, 0x354F3B,
+    0x00FF7F, 0xAAFFD4, 0x00BD5E, 0x7EBD9D, 0x008140, 0x56816B, 0x006834, 0x456856, 0x004F27, 0x354F42, 0x00FFBF,
+    0xAAFFEA, 0x00BD8D, 0x7EBDAD, 0x008160, 0x568176, 0x00684E, 0x45685F, 0x004F3B, 0x354F49, 0x00FFFF, 0xAAFFFF,
+    0x00BDBD, 0x7EBDBD, 0x008181, 0x568181, 0x006868, 0x456868, 0x004F4F, 0x354F4F, 0x00BFFF, 0xAAEAFF, 0x008DBD,
+    0x7EADBD, 0x006081, 0x567681, 0x004E68, 0x455F68, 0x003B4F, 0x35494F, 0x007FFF, 0xAAD4FF, 0x005EBD, 0x7E9DBD,
+    0x004081, 0x566B81, 0x003468, 0x455668, 0x00274F, 0x35424F, 0x003FFF, 0xAABFFF, 0x002EBD, 0x7E8DBD, 0x001F81,
+    0x566081, 0x001968, 0x454E68, 0x00134F, 0x353B4F, 0x0000FF, 0xAAAAFF, 0x0000BD, 0x7E7EBD, 0x000081, 0x565681,
+    0x000068, 0x454568, 0x00004F, 0x35354F, 0x3F00FF, 0xBFAAFF, 0x2E00BD, 0x8D7EBD, 0x1F0081, 0x605681, 0x190068,
+    0x4E4568, 0x13004F, 0x3B354F, 0x7F00FF, 0xD4AAFF, 0x5E00BD, 0x9D7EBD, 0x400081, 0x6B5681, 0x340068, 0x564568,
+    0x27004F, 0x42354F, 0xBF00FF, 0xEAAAFF, 0x8D00BD, 0xAD7EBD, 0x600081, 0x765681, 0x4E0068, 0x5F4568, 0x3B004F,
+    0x49354F, 0xFF00FF, 0xFFAAFF, 0xBD00BD, 0xBD7EBD, 0x810081, 0x815681, 0x680068, 0x684568, 0x4F004F, 0x4F354F,
+    0xFF00BF, 0xFFAAEA, 0xBD008D, 0xBD7EAD, 0x810060, 0x815676, 0x68004E, 0x68455F, 0x4F003B, 0x4F3549, 0xFF007F,
+    0xFFAAD4, 0xBD005E, 0xBD7E9D, 0x810040, 0x81566B, 0x680034, 0x684556, 0x4F0027, 0x4F3542, 0xFF003F, 0xFFAABF,
+    0xBD002E, 0xBD7E8D, 0x81001F, 0x815660, 0x680019, 0x68454E, 0x4F0013, 0x4F353B, 0x333333, 0x505050, 0x696969,
+    0x828282, 0xBEBEBE, 0xFFFFFF,
+};
+
+// Entity colors that are not resolved until drawing: BYLAYER (and an unset color) and BYBLOCK.
+constexpr int64_t kByLayer = -1;
+constexpr int64_t kByBlock = -2;
+constexpr uint32_t kWhite = 0xFFFFFF;
+// Nested inserts deeper than this are treated as a block cycle.
+constexpr int kMaxInsertDepth = 32;
+// A single insert array never draws more instances than this.
+constexpr int64_t kMaxInsertInstances = 1 << 20;
+constexpr int kMaxSplineSegments = 1 << 14;
+// Points closer than this (output units) join runs and close subpaths; dxf2svg rounds its output to 4 decimals.
+constexpr double kJoinEpsilon = 1e-4;
+// Groups between two checks of the stop flag.
+constexpr uint32_t kStopCheckInterval = 1 << 14;
+
+constexpr double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+std::string_view Trim(std::string_view text) {
+  while (!text.empty() && IsSpace(text.front())) text.remove_prefix(1);
+  while (!text.empty() && IsSpace(text.back())) text.remove_suffix(1);
+
+  return text;
+}
+
+// Decimal with optional sign, fraction and exponent. The first 19 significant digits are kept exactly, which is more
+// than a double holds.
+bool ParseDouble(std::string_view text, double* value) {
+  const char* p = text.data();
+  const char* end = p + text.size();
+  bool negative = false;
+  bool digits = false;
+  uint64_t mantissa = 0;
+  int significant = 0;
+  int exponent = 0;
+
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    p += 1;
+  }
+  for (; p < end && IsDigit(*p); p += 1) {
+    digits = true;
+    if (significant < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa > 0) significant += 1;
+    } else {
+      exponent += 1;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p += 1; p < end && IsDigit(*p); p += 1) {
+      digits = true;
+      if (significant < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa > 0) significant += 1;
+        exponent -= 1;
+      }
+    }
+  }
+  if (!digits) return false;
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    bool negativeExponent = false;
+    int power = 0;
+
+    p += 1;
+    if (p < end && (*p == '+' || *p == '-')) {
+      negativeExponent = *p == '-';
+      p += 1;
+    }
+    if (p == end || !IsDigit(*p)) return false;
+    for (; p < end && IsDigit(*p); p += 1) power = std::min(power * 10 + (*p - '0'), 10000);
+    exponent += negativeExponent ? -power : power;
+  }
+  if (p != end) return false;
+
+  double result = static_cast<double>(mantissa);
+
+  if (exponent >= -22 && exponent <= 22) {
+    result = exponent < 0 ? result / kPow10[-exponent] : result * kPow10[exponent];
+  } else {
+    result *= std::pow(10.0, exponent);
+  }
+  *value = negative ? -result : result;
+
+  return true;
+}
+
+// Splits the text into group code / value line pairs in place.
+class GroupReader {
+ public:
+  GroupReader(const char* data, size_t size) : begin_(data), p_(data), end_(data + size) {}
+
+  // False at the end of the data, or with Malformed() set when a group code is not a number.
+  bool Next() {
+    std::string_view codeLine;
+    std::string_view valueLine;
+    double code;
+
+    if (!ReadLine(&codeLine)) return false;
+    codeLine = Trim(codeLine);
+    if (codeLine.empty() && p_ == end_) return false;
+    if (!ParseDouble(codeLine, &code) || code != std::floor(code) || !ReadLine(&valueLine)) {
+      malformed_ = true;
+
+      return false;
+    }
+    code_ = static_cast<int>(code);
+    value_ = Trim(valueLine);
+
+    return true;
+  }
+
+  int Code() const { return code_; }
+  std::string_view Value() const { return value_; }
+  double Number() const {
+    double value;
+
+    return ParseDouble(value_, &value) ? value : 0;
+  }
+  int64_t Integer() const { return static_cast<int64_t>(Number()); }
+
+  size_t Offset() const { return static_cast<size_t>(p_ - begin_); }
+  size_t Line() const { return line_; }
+  bool Malformed() const { return malformed_; }
+
+ private:
+  bool ReadLine(std::string_view* line) {
+    if (p_ == end_) return false;
+
+    const char* newline = static_cast<const char*>(memchr(p_, '\n', static_cast<size_t>(end_ - p_)));
+    const char* lineEnd = newline ? newline : end_;
+
+    *line = std::string_view(p_, static_cast<size_t>(lineEnd - p_));
+    p_ = newline ? newline + 1 : end_;
+    line_ += 1;
+
+    return true;
+  }
+
+  const char* begin_;
+  const char* p_;
+  const char* end_;
+  int code_ = 0;
+  std::string_view value_;
+  size_t line_ = 0;
+  bool malformed_ = false;
+};
+
+constexpr Affine kMirrorX = {-1, 0, 0, 1, 0, 0};
+
+enum class EntityKind : uint8_t {
+  kNone,
+  kLine,
+  kPolyline,
+  kVertex,
+  kCircle,
+  kArc,
+  kEllipse,
+  kSpline,
+  kFace,
+  kInsert,
+  kHatch,
+};
+
+struct Vertex {
+  double x = 0;
+  double y = 0;
+  // Polyline bulge, or the weight of a spline control point.
+  double bulge = 0;
+};
+
+struct Entity {
+  EntityKind kind = EntityKind::kNone;
+  int layer = 0;
+  // 0xRRGGBB, kByLayer or kByBlock.
+  int64_t color = kByLayer;
+  int flags = 0;
+  bool invisible = false;
+  // Object coordinates with extrusion (0, 0, -1): x is mirrored into world coordinates.
+  bool mirrored = false;
+  bool closed = false;
+  // Line end points, polyline vertices, face corners or spline control points.
+  std::vector<Vertex> vertices;
+  // Circles, arcs and ellipses; angles in radians, counter-clockwise unless `clockwise`. A negative ratio puts the
+  // minor axis clockwise from the major one.
+  Vec2 center = {0, 0};
+  double radius = 0;
+  Vec2 major = {1, 0};
+  double ratio = 1;
+  double start = 0;
+  double end = 2 * kPi;
+  bool clockwise = false;
+  // Splines.
+  int degree = 3;
+  std::vector<double> knots;
+  std::vector<Vec2> fitPoints;
+  // Weights read so far; they follow the control points in order.
+  size_t weights = 0;
+  // Inserts and dimensions.
+  std::string block;
+  Vec2 insertScale = {1, 1};
+  double rotation = 0;
+  int columns = 1;
+  int rows = 1;
+  double columnSpacing = 0;
+  double rowSpacing = 0;
+  // Hatch boundary edges, with loop boundaries as edge indices ([0, n0, n0 + n1, ...]).
+  std::vector<Entity> edges;
+  std::vector<uint32_t> loops;
+
+  // Back to the defaults, keeping the vector capacity.
+  void Reset() {
+    std::vector<Vertex> keepVertices = std::move(vertices);
+    std::vector<double> keepKnots = std::move(knots);
+    std::vector<Vec2> keepFitPoints = std::move(fitPoints);
+    std::vector<Entity> keepEdges = std::move(edges);
+    std::vector<uint32_t> keepLoops = std::move(loops);
+
+    *this = Entity();
+    vertices = std::move(keepVertices);
+    vertices.clear();
+    knots = std::move(keepKnots);
+    knots.clear();
+    fitPoints = std::move(keepFitPoints);
+    fitPoints.clear();
+    edges = std::move(keepEdges);
+    edges.clear();
+    loops = std::move(keepLoops);
+    loops.clear();
+  }
+
+  Vertex& Corner(size_t index) {
+    if (vertices.size() <= index) vertices.resize(index + 1);
+
+    return vertices[index];
+  }
+};
+
+struct Block {
+  std::string name;
+  Vec2 base = {0, 0};
+  std::vector<Entity> entities;
+  // Being drawn; an insert of it now is a cycle.
+  bool active = false;
+};
+
+// Per output layer: the subpath still open for joining.
+struct RunState {
+  bool open = false;
+  Vec2 start = {0, 0};
+  Vec2 last = {0, 0};
+  int64_t firstColor = kByLayer;
+};
+
+inline bool Near(Vec2 a, Vec2 b) {
+  return std::fabs(a.x - b.x) <= kJoinEpsilon && std::fabs(a.y - b.y) <= kJoinEpsilon;
+}
+
+// Sweep from start to end in (0, 2 pi], mirrored for clockwise arcs.
+void ResolveSweep(const Entity& entity, double* start, double* sweep) {
+  double span = std::fmod(entity.end - entity.start, 2 * kPi);
+
+  if (span <= 1e-12) span += 2 * kPi;
+  *start = entity.clockwise ? -entity.start : entity.start;
+  *sweep = entity.clockwise ? -span : span;
+}
+
+// Arc of a polyline segment; `bulge` is the tangent of a quarter of the included angle, negative for clockwise.
+void FlattenBulge(Vec2 from, Vec2 to, double bulge, double tolerance, Polylines& out) {
+  Vec2 chord = to - from;
+
+  if (bulge == 0 || (chord.x == 0 && chord.y == 0)) {
+    out.Add(to);
+
+    return;
+  }
+
+  double offset = (1 - bulge * bulge) / (4 * bulge);
+  Vec2 center = {from.x + chord.x / 2 - chord.y * offset, from.y + chord.y / 2 + chord.x * offset};
+  Vec2 radial = from - center;
+
+  FlattenEllipticalArc(center, Length(radial), Length(radial), 0, std::atan2(radial.y, radial.x),
+                       4 * std::atan(bulge), tolerance, out);
+  out.points[out.points.size() - 2] = to.x;
+  out.points[out.points.size() - 1] = to.y;
+}
+
+void FlattenPolyline(const Entity& entity, double tolerance, Polylines& out) {
+  const std::vector<Vertex>& vertices = entity.vertices;
+  size_t count = vertices.size();
+
+  if (count == 0) return;
+  out.Add({vertices[0].x, vertices[0].y});
+  for (size_t i = 0; i + 1 < count || (entity.closed && i + 1 == count && count > 1); i += 1) {
+    const Vertex& next = vertices[(i + 1) % count];
+
+    FlattenBulge({vertices[i].x, vertices[i].y}, {next.x, next.y}, vertices[i].bulge, tolerance, out);
+  }
+  out.EndSubpath(entity.closed);
+}
+
+void FlattenEllipse(const Entity& entity, double tolerance, Polylines& out) {
+  double start;
+  double sweep;
+  double rx = Length(entity.major);
+  double ry = entity.ratio * rx;
+  double rotation = std::atan2(entity.major.y, entity.major.x);
+  double cosRotation = std::cos(rotation);
+  double sinRotation = std::sin(rotation);
+
+  ResolveSweep(entity, &start, &sweep);
+  out.Add({entity.center.x + cosRotation * rx * std::cos(start) - sinRotation * ry * std::sin(start),
+           entity.center.y + sinRotation * rx * std::cos(start) + cosRotation * ry * std::sin(start)});
+  FlattenEllipticalArc(entity.center, rx, ry, rotation, start, sweep, tolerance, out);
+  out.EndSubpath(std::fabs(std::fabs(sweep) - 2 * kPi) < 1e-9);
+}
+
+void FlattenCircle(const Entity& entity, double tolerance, Polylines& out) {
+  double start = 0;
+  double sweep = 2 * kPi;
+
+  if (entity.kind == EntityKind::kArc) ResolveSweep(entity, &start, &sweep);
+  out.Add({entity.center.x + entity.radius * std::cos(start), entity.center.y + entity.radius * std::sin(start)});
+  FlattenEllipticalArc(entity.center, entity.radius, entity.radius, 0, start, sweep, tolerance, out);
+  out.EndSubpath(entity.kind == EntityKind::kCircle);
+}
+
+// Rational de Boor evaluation at `t` in knot span `span`.
+Vec2 EvaluateSpline(const Entity& entity, size_t span, double t, std::vector<double>& scratch) {
+  int degree = entity.degree;
+
+  scratch.resize(3 * static_cast<size_t>(degree + 1));
+  for (int j = 0; j <= degree; j += 1) {
+    const Vertex& point = entity.vertices[span - degree + j];
+
+    scratch[3 * j] = point.x * point.bulge;
+    scratch[3 * j + 1] = point.y * point.bulge;
+    scratch[3 * j + 2] = point.bulge;
+  }
+  for (int r = 1; r <= degree; r += 1) {
+    for (int j = degree; j >= r; j -= 1) {
+      double left = entity.knots[span - degree + j];
+      double right = entity.knots[span + 1 + j - r];
+      double alpha = right > left ? (t - left) / (right - left) : 0;
+
+      for (int k = 0; k < 3; k += 1) {
+        scratch[3 * j + k] = (1 - alpha) * scratch[3 * (j - 1) + k] + alpha * scratch[3 * j + k];
+      }
+    }
+  }
+
+  double w = scratch[3 * degree + 2];
+
+  return w != 0 ? Vec2{scratch[3 * degree] / w, scratch[3 * degree + 1] / w} : Vec2{0, 0};
+}
+
+void FlattenSpline(const Entity& entity, double tolerance, Polylines& out, std::vector<double>& scratch) {
+  size_t count = entity.vertices.size();
+  int degree = entity.degree;
+
+  if (degree < 1 || count < static_cast<size_t>(degree) + 1 || entity.knots.size() != count + degree + 1) {
+    // Fit-point splines without a control frame, or a broken definition: connect the points it has.
+    if (entity.fitPoints.size() >= 2) {
+      for (Vec2 p : entity.fitPoints) out.Add(p);
+    } else {
+      for (const Vertex& v : entity.vertices) out.Add({v.x, v.y});
+    }
+    out.EndSubpath(entity.closed);
+
+    return;
+  }
+
+  out.Add(EvaluateSpline(entity, degree, entity.knots[degree], scratch));
+  for (size_t span = degree; span < count; span += 1) {
+    double from = entity.knots[span];
+    double to = entity.knots[span + 1];
+
+    if (!(to > from)) continue;
+
+    // Wang's bound on the span's control points, as if they were its Bezier points.
+    double bend = 0;
+
+    for (size_t j = span - degree; j + 2 <= span; j += 1) {
+      const Vertex& p0 = entity.vertices[j];
+      const Vertex& p1 = entity.vertices[j + 1];
+      const Vertex& p2 = entity.vertices[j + 2];
+
+      bend = std::max(bend, Hypot(p0.x - 2 * p1.x + p2.x, p0.y - 2 * p1.y + p2.y));
+    }
+
+    double estimate = std::sqrt(degree * (degree - 1) / 8.0 * bend / tolerance);
+    int segments = estimate > 1 ? static_cast<int>(std::min(std::ceil(estimate), double{kMaxSplineSegments})) : 1;
+
+    for (int i = 1; i <= segments; i += 1) {
+      out.Add(EvaluateSpline(entity, span, from + (to - from) * i / segments, scratch));
+    }
+  }
+  out.EndSubpath(entity.closed);
+}
+
+// Appends the points of one subpath of `from` to `into`, reversed when that continues it.
+void AppendEdge(const Polylines& from, size_t begin, size_t end, Polylines& into) {
+  bool reverse = false;
+  size_t skip = 0;
+
+  if (into.PointCount() > into.offsets.back()) {
+    Vec2 last = {into.points[into.points.size() - 2], into.points[into.points.size() - 1]};
+    Vec2 first = {from.points[2 * begin], from.points[2 * begin + 1]};
+    Vec2 final = {from.points[2 * end - 2], from.points[2 * end - 1]};
+
+    double gap = std::min(Distance(last, first), Distance(last, final));
+
+    reverse = Distance(last, first) > Distance(last, final);
+    // The shared corner is already there.
+    if (gap <= 1e-9 * std::max({1.0, std::fabs(last.x), std::fabs(last.y)})) skip = 1;
+  }
+  for (size_t i = skip; i < end - begin; i += 1) {
+    size_t index = reverse ? end - 1 - i : begin + i;
+
+    into.Add({from.points[2 * index], from.points[2 * index + 1]});
+  }
+}
+
+void FlattenShape(const Entity& entity, double tolerance, Polylines& out, Polylines& edgeScratch,
+                  std::vector<double>& splineScratch);
+
+void FlattenHatch(const Entity& entity, double tolerance, Polylines& out, Polylines& edgeScratch,
+                  std::vector<double>& splineScratch) {
+  Polylines unused;
+
+  for (size_t loop = 0; loop + 1 < entity.loops.size(); loop += 1) {
+    edgeScratch = Polylines();
+    for (uint32_t i = entity.loops[loop]; i < entity.loops[loop + 1]; i += 1) {
+      FlattenShape(entity.edges[i], tolerance, edgeScratch, unused, splineScratch);
+    }
+    for (size_t i = 0; i + 1 < edgeScratch.offsets.size(); i += 1) {
+      AppendEdge(edgeScratch, edgeScratch.offsets[i], edgeScratch.offsets[i + 1], out);
+    }
+    out.EndSubpath(true);
+  }
+}
+
+void FlattenShape(const Entity& entity, double tolerance, Polylines& out, Polylines& edgeScratch,
+                  std::vector<double>& splineScratch) {
+  switch (entity.kind) {
+    case EntityKind::kLine:
+      for (const Vertex& v : entity.vertices) out.Add({v.x, v.y});
+      out.EndSubpath(false);
+      break;
+    case EntityKind::kPolyline:
+      FlattenPolyline(entity, tolerance, out);
+      break;
+    case EntityKind::kFace:
+      for (const Vertex& v : entity.vertices) out.Add({v.x, v.y});
+      out.EndSubpath(true);
+      break;
+    case EntityKind::kCircle:
+    case EntityKind::kArc:
+      FlattenCircle(entity, tolerance, out);
+      break;
+    case EntityKind::kEllipse:
+      FlattenEllipse(entity, tolerance, out);
+      break;
+    case EntityKind::kSpline:
+      FlattenSpline(entity, tolerance, out, splineScratch);
+      break;
+    case EntityKind::kHatch:
+      FlattenHatch(entity, tolerance, out, edgeScratch, splineScratch);
+      break;
+    default:
+      break;
+  }
+}
+
+enum class Section : uint8_t { kNone, kHeader, kTables, kBlocks, kEntities, kOther };
+
+class DxfParser {
+ public:
+  DxfParser(const DxfOptions& options, DxfDrawing* drawing) : options_(options), drawing_(drawing) {
+    layer0_ = InternLayer("0");
+  }
+
+  bool Parse(const uint8_t* data, size_t size, const std::atomic<bool>& stop,
+             const std::function<void(double)>& progress, std::string* error);
+
+ private:
+  int InternLayer(std::string_view name);
+  void BeginRecord(std::string_view type);
+  void EndRecord();
+  void ReadGroup(const GroupReader& reader);
+  void ReadEntityGroup(const GroupReader& reader, Entity& entity);
+  void ReadHatchGroup(const GroupReader& reader);
+  void Commit(Entity& entity);
+  void Draw(const Entity& entity, const Affine& transform, int layer, int64_t color, int depth);
+  void Emit(const Affine& transform, int layer, int64_t color);
+  void Finish();
+
+  DxfOptions options_;
+  DxfDrawing* drawing_;
+  Section section_ = Section::kNone;
+  bool expectSectionName_ = false;
+  std::string headerVariable_;
+
+  std::unordered_map<std::string, int> layerIndex_;
+  std::vector<std::string> layerNames_;
+  std::vector<int64_t> layerColors_;
+  int layer0_ = 0;
+  // Last interned name, so runs of entities on one layer do not allocate.
+  std::string lastLayerName_;
+  int lastLayer_ = -1;
+
+  // Record being read: a layer table entry, a block header or an entity.
+  std::string recordType_;
+  bool inLayerRecord_ = false;
+  bool inBlockRecord_ = false;
+  Entity entity_;
+  // A POLYLINE collects the VERTEX records after it until SEQEND.
+  Entity polyline_;
+  bool polylineOpen_ = false;
+
+  // Hatch boundary state: loops still to start (-1 before group 91), and whether the current loop is a polyline.
+  int64_t hatchLoopsLeft_ = -1;
+  bool hatchTail_ = false;
+  bool hatchPolylineLoop_ = false;
+
+  std::vector<Block> blocks_;
+  std::unordered_map<std::string, int> blockIndex_;
+  int openBlock_ = -1;
+
+  std::vector<int> outputLayer_;
+  std::vector<RunState> runs_;
+  Polylines shape_;
+  Polylines edgeScratch_;
+  std::vector<double> splineScratch_;
+  std::vector<Vec2> transformed_;
+};
+
+int DxfParser::InternLayer(std::string_view name) {
+  if (lastLayer_ >= 0 && name == lastLayerName_) return lastLayer_;
+  lastLayerName_.assign(name.data(), name.size());
+
+  auto found = layerIndex_.find(lastLayerName_);
+
+  if (found != layerIndex_.end()) {
+    lastLayer_ = found->second;
+  } else {
+    lastLayer_ = static_cast<int>(layerNames_.size());
+    layerIndex_.emplace(lastLayerName_, lastLayer_);
+    layerNames_.push_back(lastLayerName_);
+    layerColors_.push_back(kByLayer);
+  }
+
+  return lastLayer_;
+}
+
+void DxfParser::BeginRecord(std::string_view type) {
+  recordType_.assign(type.data(), type.size());
+  inLayerRecord_ = section_ == Section::kTables && type == "LAYER";
+  inBlockRecord_ = section_ == Section::kBlocks && type == "BLOCK";
+  entity_.Reset();
+  hatchLoopsLeft_ = -1;
+  hatchTail_ = false;
+  if (inLayerRecord_) {
+    entity_.layer = -1;
+  } else if (inBlockRecord_) {
+    blocks_.emplace_back();
+    openBlock_ = static_cast<int>(blocks_.size()) - 1;
+  } else if (type == "ENDBLK") {
+    openBlock_ = -1;
+  }
+  if (section_ != Section::kBlocks && section_ != Section::kEntities) return;
+  if (type == "VERTEX") {
+    entity_.kind = EntityKind::kVertex;
+
+    return;
+  }
+  if (polylineOpen_) {
+    // SEQEND, or a writer that left it out.
+    polylineOpen_ = false;
+    Commit(polyline_);
+  }
+  if (type == "LINE") {
+    entity_.kind = EntityKind::kLine;
+    entity_.vertices.resize(2);
+  } else if (type == "LWPOLYLINE" || type == "POLYLINE") {
+    entity_.kind = EntityKind::kPolyline;
+  } else if (type == "CIRCLE") {
+    entity_.kind = EntityKind::kCircle;
+  } else if (type == "ARC") {
+    entity_.kind = EntityKind::kArc;
+  } else if (type == "ELLIPSE") {
+    entity_.kind = EntityKind::kEllipse;
+  } else if (type == "SPLINE") {
+    entity_.kind = EntityKind::kSpline;
+  } else if (type == "SOLID" || type == "TRACE" || type == "3DFACE") {
+    entity_.kind = EntityKind::kFace;
+  } else if (type == "INSERT" || (type == "DIMENSION" && options_.dimensions)) {
+    entity_.kind = EntityKind::kInsert;
+  } else if (type == "HATCH" && options_.hatches) {
+    entity_.kind = EntityKind::kHatch;
+  } else if (!inBlockRecord_ && type != "ENDBLK" && type != "SEQEND") {
+    drawing_->skipped += 1;
+  }
+}
+
+void DxfParser::EndRecord() {
+  if (inLayerRecord_) {
+    if (entity_.layer >= 0) layerColors_[entity_.layer] = entity_.color;
+    inLayerRecord_ = false;
+
+    return;
+  }
+  if (inBlockRecord_) {
+    inBlockRecord_ = false;
+    if (!blocks_[openBlock_].name.empty()) blockIndex_.emplace(blocks_[openBlock_].name, openBlock_);
+
+    return;
+  }
+
+  Entity& entity = entity_;
+
+  switch (entity.kind) {
+    case EntityKind::kNone:
+      return;
+    case EntityKind::kVertex:
+      // Spline frame control points (flag 16) are not on the curve; mesh vertices have no polyline.
+      if (polylineOpen_ && !(entity.flags & 16)) polyline_.vertices.push_back(entity.Corner(0));
+      return;
+    case EntityKind::kPolyline:
+      entity.closed = entity.flags & 1;
+      // 3D polylines are in world coordinates; polyface and polygon meshes are not drawn.
+      if (entity.flags & 8) entity.mirrored = false;
+      if (entity.flags & (16 | 64)) {
+        drawing_->skipped += 1;
+
+        return;
+      }
+      if (recordType_ == "POLYLINE") {
+        std::swap(polyline_, entity_);
+        polylineOpen_ = true;
+
+        return;
+      }
+      break;
+    case EntityKind::kFace:
+      if (entity.vertices.size() < 4) {
+        entity.vertices.resize(4, entity.vertices.empty() ? Vertex() : entity.vertices.back());
+      }
+      // SOLID and TRACE corners run 1 2 4 3 around the outline.
+      if (recordType_ != "3DFACE") std::swap(entity.vertices[2], entity.vertices[3]);
+      else entity.mirrored = false;
+      break;
+    case EntityKind::kSpline:
+      entity.closed = entity.flags & 1;
+      entity.mirrored = false;
+      break;
+    case EntityKind::kEllipse:
+      // Ellipses are in world coordinates, but the minor axis is the extrusion direction crossed with the major axis.
+      if (entity.mirrored) entity.ratio = -entity.ratio;
+      entity.mirrored = false;
+      break;
+    case EntityKind::kInsert:
+      if (recordType_ == "DIMENSION") entity.mirrored = false;
+      break;
+    case EntityKind::kLine:
+      entity.mirrored = false;
+      break;
+    default:
+      break;
+  }
+  if (!entity.invisible) Commit(entity);
+}
+
+void DxfParser::ReadGroup(const GroupReader& reader) {
+  int code = reader.Code();
+
+  if (section_ == Section::kHeader) {
+    if (code == 9) {
+      headerVariable_.assign(reader.Value().data(), reader.Value().size());
+    } else if (code == 1 && headerVariable_ == "$ACADVER") {
+      drawing_->version.assign(reader.Value().data(), reader.Value().size());
+    } else if (code == 70 && headerVariable_ == "$INSUNITS") {
+      drawing_->insunits = static_cast<int>(reader.Integer());
+    }
+
+    return;
+  }
+  if (inLayerRecord_) {
+    if (code == 2) {
+      entity_.layer = InternLayer(reader.Value());
+    } else if (code == 62) {
+      int64_t index = std::llabs(reader.Integer());
+
+      if (entity_.color < 0 && index < 256) entity_.color = kAciColors[index];
+    } else if (code == 420) {
+      entity_.color = reader.Integer() & 0xFFFFFF;
+    }
+
+    return;
+  }
+  if (inBlockRecord_) {
+    Block& block = blocks_[openBlock_];
+
+    if (code == 2) {
+      block.name.assign(reader.Value().data(), reader.Value().size());
+    } else if (code == 10) {
+      block.base.x = reader.Number();
+    } else if (code == 20) {
+      block.base.y = reader.Number();
+    }
+
+    return;
+  }
+  if (entity_.kind == EntityKind::kHatch && hatchLoopsLeft_ >= 0) {
+    ReadHatchGroup(reader);
+
+    return;
+  }
+  if (entity_.kind != EntityKind::kNone) ReadEntityGroup(reader, entity_);
+}
+
+void DxfParser::ReadEntityGroup(const GroupReader& reader, Entity& entity) {
+  int code = reader.Code();
+  double number = code >= 10 && code < 1072 ? reader.Number() : 0;
+
+  switch (code) {
+    case 8:
+      entity.layer = InternLayer(reader.Value());
+      return;
+    case 60:
+      entity.invisible = number != 0;
+      return;
+    case 62:
+      if (number == 0) {
+        entity.color = kByBlock;
+      } else if (number > 0 && number < 256) {
+        entity.color = kAciColors[static_cast<int>(number)];
+      } else {
+        entity.color = kByLayer;
+      }
+      return;
+    case 420:
+      entity.color = reader.Integer() & 0xFFFFFF;
+      return;
+    case 230:
+      entity.mirrored = number < 0;
+      return;
+    default:
+      break;
+  }
+
+  switch (entity.kind) {
+    case EntityKind::kLine:
+    case EntityKind::kFace:
+      if (code >= 10 && code <= 13) entity.Corner(code - 10).x = number;
+      if (code >= 20 && code <= 23) entity.Corner(code - 20).y = number;
+      break;
+    case EntityKind::kVertex:
+      if (code == 10) entity.Corner(0).x = number;
+      if (code == 20) entity.Corner(0).y = number;
+      if (code == 42) entity.Corner(0).bulge = number;
+      if (code == 70) entity.flags = static_cast<int>(number);
+      break;
+    case EntityKind::kPolyline:
+      if (code == 70) entity.flags = static_cast<int>(number);
+      // LWPOLYLINE vertices; a POLYLINE's own 10/20 is only its elevation.
+      if (recordType_ == "LWPOLYLINE") {
+        if (code == 10) entity.vertices.push_back({number, 0, 0});
+        if (code == 20 && !entity.vertices.empty()) entity.vertices.back().y = number;
+        if (code == 42 && !entity.vertices.empty()) entity.vertices.back().bulge = number;
+      }
+      break;
+    case EntityKind::kCircle:
+    case EntityKind::kArc:
+      if (code == 10) entity.center.x = number;
+      if (code == 20) entity.center.y = number;
+      if (code == 40) entity.radius = number;
+      if (code == 50) entity.start = number * kPi / 180;
+      if (code == 51) entity.end = number * kPi / 180;
+      break;
+    case EntityKind::kEllipse:
+      if (code == 10) entity.center.x = number;
+      if (code == 20) entity.center.y = number;
+      if (code == 11) entity.major.x = number;
+      if (code == 21) entity.major.y = number;
+      if (code == 40) entity.ratio = number;
+      if (code == 41) entity.start = number;
+      if (code == 42) entity.end = number;
+      break;
+    case EntityKind::kSpline:
+      if (code == 70) entity.flags = static_cast<int>(number);
+      if (code == 71) entity.degree = static_cast<int>(number);
+      if (code == 40) entity.knots.push_back(number);
+      if (code == 10) entity.vertices.push_back({number, 0, 1});
+      if (code == 20 && !entity.vertices.empty()) entity.vertices.back().y = number;
+      if (code == 41 && entity.weights < entity.vertices.size()) entity.vertices[entity.weights++].bulge = number;
+      if (code == 11) entity.fitPoints.push_back({number, 0});
+      if (code == 21 && !entity.fitPoints.empty()) entity.fitPoints.back().y = number;
+      break;
+    case EntityKind::kInsert:
+      if (code == 2) entity.block.assign(reader.Value().data(), reader.Value().size());
+      if (recordType_ == "DIMENSION") break;
+      if (code == 10) entity.center.x = number;
+      if (code == 20) entity.center.y = number;
+      if (code == 41) entity.insertScale.x = number;
+      if (code == 42) entity.insertScale.y = number;
+      if (code == 50) entity.rotation = number * kPi / 180;
+      if (code == 70) entity.columns = static_cast<int>(std::max(1.0, std::min(number, 1e6)));
+      if (code == 71) entity.rows = static_cast<int>(std::max(1.0, std::min(number, 1e6)));
+      if (code == 44) entity.columnSpacing = number;
+      if (code == 45) entity.rowSpacing = number;
+      break;
+    case EntityKind::kHatch:
+      if (code == 91) {
+        hatchLoopsLeft_ = static_cast<int64_t>(std::max(0.0, number));
+        entity.loops.assign(1, 0);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// Boundary loops: group 92 starts a loop, which is a polyline (flag 2) or a list of edges, each started by group 72.
+// The codes repeat between edge types, so they are read against the edge being built.
+void DxfParser::ReadHatchGroup(const GroupReader& reader) {
+  Entity& hatch = entity_;
+  int code = reader.Code();
+  double number = reader.Number();
+
+  if (hatchTail_) return;
+  if (code == 92) {
+    if (hatchLoopsLeft_ == 0) {
+      hatchTail_ = true;
+
+      return;
+    }
+    hatchLoopsLeft_ -= 1;
+    hatch.loops.push_back(static_cast<uint32_t>(hatch.edges.size()));
+    hatchPolylineLoop_ = static_cast<int>(number) & 2;
+    if (hatchPolylineLoop_) {
+      hatch.edges.emplace_back();
+      hatch.edges.back().kind = EntityKind::kPolyline;
+      hatch.edges.back().closed = true;
+    }
+    hatch.loops.back() = static_cast<uint32_t>(hatch.edges.size());
+
+    return;
+  }
+  if (hatch.loops.size() < 2) return;
+
+  bool loopCode = code == 72 || code == 73 || code == 74 || code == 93 || code == 94 || code == 95 || code == 96 ||
+                  code == 97 || code == 330 || code == 40 || code == 42 || code == 50 || code == 51 ||
+                  (code >= 10 && code <= 13) || (code >= 20 && code <= 23);
+
+  if (!loopCode) {
+    if (hatchLoopsLeft_ == 0) hatchTail_ = true;
+
+    return;
+  }
+  if (hatchPolylineLoop_) {
+    Entity& polyline = hatch.edges.back();
+
+    if (code == 10) polyline.vertices.push_back({number, 0, 0});
+    if (code == 20 && !polyline.vertices.empty()) polyline.vertices.back().y = number;
+    if (code == 42 && !polyline.vertices.empty()) polyline.vertices.back().bulge = number;
+
+    return;
+  }
+  if (code == 72) {
+    static constexpr EntityKind kEdgeKinds[] = {EntityKind::kNone, EntityKind::kLine, EntityKind::kArc,
+                                                EntityKind::kEllipse, EntityKind::kSpline};
+
+    hatch.edges.emplace_back();
+    hatch.edges.back().kind = number >= 1 && number <= 4 ? kEdgeKinds[static_cast<int>(number)] : EntityKind::kNone;
+    if (hatch.edges.back().kind == EntityKind::kLine) hatch.edges.back().vertices.resize(2);
+    hatch.loops.back() = static_cast<uint32_t>(hatch.edges.size());
+
+    return;
+  }
+  if (hatch.loops.back() == hatch.loops[hatch.loops.size() - 2]) return;
+
+  Entity& edge = hatch.edges.back();
+
+  switch (edge.kind) {
+    case EntityKind::kLine:
+      if (code == 10 || code == 11) edge.vertices[code - 10].x = number;
+      if (code == 20 || code == 21) edge.vertices[code - 20].y = number;
+      break;
+    case EntityKind::kArc:
+    case EntityKind::kEllipse:
+      if (code == 10) edge.center.x = number;
+      if (code == 20) edge.center.y = number;
+      if (code == 11) edge.major.x = number;
+      if (code == 21) edge.major.y = number;
+      if (code == 40) {
+        edge.radius = number;
+        edge.ratio = number;
+      }
+      if (code == 50 || code == 51) {
+        double angle = number * kPi / 180;
+
+        // Elliptic edges give the geometric angle of the end points; the curve needs the parameter.
+        if (edge.kind == EntityKind::kEllipse && edge.ratio != 0) {
+          angle = std::atan2(std::sin(angle) / edge.ratio, std::cos(angle));
+        }
+        (code == 50 ? edge.start : edge.end) = angle;
+      }
+      if (code == 73) edge.clockwise = number == 0;
+      break;
+    case EntityKind::kSpline:
+      if (code == 94) edge.degree = static_cast<int>(number);
+      if (code == 40) edge.knots.push_back(number);
+      if (code == 10) edge.vertices.push_back({number, 0, 1});
+      if (code == 20 && !edge.vertices.empty()) edge.vertices.back().y = number;
+      if (code == 42 && edge.weights < edge.vertices.size()) edge.vertices[edge.weights++].bulge = number;
+      if (code == 11) edge.fitPoints.push_back({number, 0});
+      if (code == 21 && !edge.fitPoints.empty()) edge.fitPoints.back().y = number;
+      break;
+    default:
+      break;
+  }
+}
+
+void DxfParser::Commit(Entity& entity) {
+  if (openBlock_ >= 0 && section_ == Section::kBlocks) {
+    blocks_[openBlock_].entities.push_back(std::move(entity));
+
+    return;
+  }
+  if (section_ != Section::kEntities) return;
+
+  Affine scale;
+
+  scale.a = options_.scale;
+  scale.d = options_.scale;
+  Draw(entity, scale, entity.layer, kByLayer, 0);
+}
+
+void DxfParser::Draw(const Entity& entity, const Affine& transform, int layer, int64_t color, int depth) {
+  Affine local = entity.mirrored ? transform * kMirrorX : transform;
+  int entityLayer = depth > 0 && entity.layer == layer0_ ? layer : entity.layer;
+  int64_t entityColor = entity.color == kByBlock ? color : entity.color;
+
+  if (entity.kind != EntityKind::kInsert) {
+    double scale = local.MaxScale();
+
+    if (!(scale > 0)) return;
+    shape_.points.clear();
+    shape_.offsets.assign(1, 0);
+    shape_.closed.clear();
+    FlattenShape(entity, options_.tolerance / scale, shape_, edgeScratch_, splineScratch_);
+    Emit(local, entityLayer, entityColor);
+
+    return;
+  }
+
+  auto found = blockIndex_.find(entity.block);
+
+  if (found == blockIndex_.end() || depth >= kMaxInsertDepth || blocks_[found->second].active) {
+    drawing_->skipped += 1;
+
+    return;
+  }
+
+  Block& block = blocks_[found->second];
+  double cosRotation = std::cos(entity.rotation);
+  double sinRotation = std::sin(entity.rotation);
+  int64_t columns = entity.columns;
+  int64_t rows = std::min<int64_t>(entity.rows, std::max<int64_t>(1, kMaxInsertInstances / columns));
+
+  block.active = true;
+  for (int64_t row = 0; row < rows; row += 1) {
+    for (int64_t column = 0; column < columns; column += 1) {
+      Vec2 offset = {column * entity.columnSpacing, row * entity.rowSpacing};
+      Affine place;
+
+      place.a = cosRotation * entity.insertScale.x;
+      place.b = sinRotation * entity.insertScale.x;
+      place.c = -sinRotation * entity.insertScale.y;
+      place.d = cosRotation * entity.insertScale.y;
+      place.e = entity.center.x + cosRotation * offset.x - sinRotation * offset.y;
+      place.f = entity.center.y + sinRotation * offset.x + cosRotation * offset.y;
+      place.e -= place.a * block.base.x + place.c * block.base.y;
+      place.f -= place.b * block.base.x + place.d * block.base.y;
+
+      Affine instance = local * place;
+
+      // Indexing, not a range loop: a nested insert may grow blocks_ only while parsing, never while drawing.
+      for (size_t i = 0; i < block.entities.size(); i += 1) {
+        Draw(block.entities[i], instance, entityLayer, entityColor, depth + 1);
+      }
+    }
+  }
+  block.active = false;
+}
+
+void DxfParser::Emit(const Affine& transform, int layer, int64_t color) {
+  if (shape_.offsets.size() < 2) return;
+  if (outputLayer_.size() <= static_cast<size_t>(layer)) outputLayer_.resize(layerNames_.size(), -1);
+  if (outputLayer_[layer] < 0) {
+    outputLayer_[layer] = static_cast<int>(drawing_->layers.size());
+    drawing_->layers.emplace_back();
+    drawing_->layers.back().name = layerNames_[layer];
+    runs_.emplace_back();
+    runs_.back().firstColor = color;
+  }
+
+  DxfLayerPaths& output = drawing_->layers[outputLayer_[layer]];
+  RunState& run = runs_[outputLayer_[layer]];
+  PathBuffer& path = output.path;
+
+  output.entities += 1;
+  drawing_->entities += 1;
+  for (size_t subpath = 0; subpath + 1 < shape_.offsets.size(); subpath += 1) {
+    bool closed = shape_.closed[subpath];
+
+    transformed_.clear();
+    for (uint32_t i = shape_.offsets[subpath]; i < shape_.offsets[subpath + 1]; i += 1) {
+      Vec2 p = transform.Apply({shape_.points[2 * i], shape_.points[2 * i + 1]});
+      bool repeated = !transformed_.empty() && p.x == transformed_.back().x && p.y == transformed_.back().y;
+
+      if (!repeated) transformed_.push_back(p);
+    }
+    if (transformed_.size() < 2) continue;
+    if (closed || !run.open || !Near(run.last, transformed_[0])) {
+      path.MoveTo(transformed_[0].x, transformed_[0].y);
+      run.start = transformed_[0];
+    }
+    for (size_t i = 1; i < transformed_.size(); i += 1) path.LineTo(transformed_[i].x, transformed_[i].y);
+    run.last = transformed_.back();
+    run.open = !closed && !Near(run.last, run.start);
+    if (!run.open) {
+      // The close command draws the last edge back to the start.
+      size_t count = path.commands.size();
+
+      if (Near(run.last, run.start) && path.commands[count - 1] == kLineTo && path.commands[count - 2] != kMoveTo) {
+        path.commands.pop_back();
+        path.coords.resize(path.coords.size() - 2);
+      }
+      path.Close();
+    }
+  }
+}
+
+void DxfParser::Finish() {
+  DxfBounds& bounds = drawing_->bounds;
+  bool empty = true;
+
+  bounds = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+  for (const DxfLayerPaths& layer : drawing_->layers) {
+    for (size_t i = 0; i + 1 < layer.path.coords.size(); i += 2) {
+      bounds.minX = std::min(bounds.minX, layer.path.coords[i]);
+      bounds.maxX = std::max(bounds.maxX, layer.path.coords[i]);
+      bounds.minY = std::min(bounds.minY, layer.path.coords[i + 1]);
+      bounds.maxY = std::max(bounds.maxY, layer.path.coords[i + 1]);
+      empty = false;
+    }
+  }
+  if (empty) bounds = DxfBounds();
+  for (size_t index = 0; index < drawing_->layers.size(); index += 1) {
+    DxfLayerPaths& layer = drawing_->layers[index];
+    int64_t color = runs_[index].firstColor;
+    DxfBounds& layerBounds = layer.bounds;
+
+    if (color < 0) {
+      auto found = layerIndex_.find(layer.name);
+
+      color = found != layerIndex_.end() && layerColors_[found->second] >= 0 ? layerColors_[found->second] : 0;
+    }
+    layer.color = static_cast<uint32_t>(color) == kWhite ? 0 : static_cast<uint32_t>(color);
+    layerBounds = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+    for (size_t i = 0; i + 1 < layer.path.coords.size(); i += 2) {
+      double x = layer.path.coords[i] - bounds.minX;
+      double y = bounds.maxY - layer.path.coords[i + 1];
+
+      layer.path.coords[i] = x;
+      layer.path.coords[i + 1] = y;
+      layerBounds.minX = std::min(layerBounds.minX, x);
+      layerBounds.maxX = std::max(layerBounds.maxX, x);
+      layerBounds.minY = std::min(layerBounds.minY, y);
+      layerBounds.maxY = std::max(layerBounds.maxY, y);
+    }
+  }
+}
+
+bool DxfParser::Parse(const uint8_t* data, size_t size, const std::atomic<bool>& stop,
+                      const std::function<void(double)>& progress, std::string* error) {
+  const char* text = reinterpret_cast<const char*>(data);
+  static constexpr char kBinarySentinel[] = "AutoCAD Binary DXF";
+
+  if (size >= sizeof(kBinarySentinel) - 1 && memcmp(text, kBinarySentinel, sizeof(kBinarySentinel) - 1) == 0) {
+    *error = "binary DXF is not supported";
+
+    return false;
+  }
+  if (size >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0) {
+    text += 3;
+    size -= 3;
+  }
+
+  GroupReader reader(text, size);
+  bool sawSection = false;
+  size_t step = std::max<size_t>(size / 100, 1);
+  size_t nextProgress = step;
+  uint32_t groups = 0;
+
+  while (reader.Next()) {
+    groups += 1;
+    if (groups % kStopCheckInterval == 0 && stop.load(std::memory_order_relaxed)) {
+      *error = "cancelled";
+
+      return false;
+    }
+    if (reader.Offset() >= nextProgress) {
+      progress(static_cast<double>(reader.Offset()) / size);
+      nextProgress = reader.Offset() + step;
+    }
+    if (expectSectionName_) {
+      expectSectionName_ = false;
+      if (reader.Code() == 2) {
+        std::string_view name = reader.Value();
+
+        section_ = name == "HEADER"     ? Section::kHeader
+                   : name == "TABLES"   ? Section::kTables
+                   : name == "BLOCKS"   ? Section::kBlocks
+                   : name == "ENTITIES" ? Section::kEntities
+                                        : Section::kOther;
+        continue;
+      }
+    }
+    if (reader.Code() != 0) {
+      ReadGroup(reader);
+      continue;
+    }
+    EndRecord();
+
+    std::string_view type = reader.Value();
+
+    if (type == "SECTION") {
+      sawSection = true;
+      expectSectionName_ = true;
+      section_ = Section::kNone;
+      entity_.Reset();
+      recordType_.clear();
+    } else if (type == "ENDSEC" || type == "EOF") {
+      if (polylineOpen_) {
+        polylineOpen_ = false;
+        Commit(polyline_);
+      }
+      section_ = Section::kNone;
+      entity_.Reset();
+      if (type == "EOF") break;
+    } else {
+      BeginRecord(type);
+    }
+  }
+  if (reader.Malformed() || !sawSection) {
+    *error = sawSection ? "malformed group code at line " + std::to_string(reader.Line()) : "not a DXF file";
+
+    return false;
+  }
+  EndRecord();
+  if (polylineOpen_) {
+    polylineOpen_ = false;
+    Commit(polyline_);
+  }
+  Finish();
+
+  return true;
+}
+
+}  // namespace
+
+bool ReadDxf(const uint8_t* data, size_t size, const DxfOptions& options, const std::atomic<bool>& stop,
+             const std::function<void(double)>& progress, DxfDrawing* drawing, std::string* error) {
+  DxfParser parser(options, drawing);
+
+  return parser.Parse(data, size, stop, progress, error);
+}
+
+}  // namespace beam
@@ -0,0 +1,67 @@
+// Streaming DXF import: walks the group codes of an ASCII DXF once, without building an entity tree, resolves block
+// inserts and flattens every curve to a chord tolerance straight into one packed path per layer.
+#ifndef BEAM_ADDON_DXF_READER_H_
+#define BEAM_ADDON_DXF_READER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "path-buffer.h"
+
+namespace beam {
+
+struct DxfOptions {
+  // Output units per drawing unit.
+  double scale = 1;
+  // Maximum distance between a chord and its curve, in output units.
+  double tolerance = 0.1;
+  // Hatch boundaries usually retrace outlines that are drawn anyway, and dimensions are annotation, so like dxf2svg
+  // both are skipped unless asked for.
+  bool hatches = false;
+  bool dimensions = false;
+};
+
+struct DxfBounds {
+  double minX = 0;
+  double minY = 0;
+  double maxX = 0;
+  double maxY = 0;
+};
+
+struct DxfLayerPaths {
+  std::string name;
+  // 0xRRGGBB of the first entity drawn on the layer (its own color, else the layer table color); white becomes black.
+  uint32_t color = 0;
+  // Move, line and close commands only. Runs of entities that meet end to start are joined into one subpath and
+  // subpaths that end where they start are closed.
+  PathBuffer path;
+  DxfBounds bounds;
+  size_t entities = 0;
+};
+
+struct DxfDrawing {
+  // $ACADVER (e.g. "AC1027") and $INSUNITS from the header; empty and 0 when missing.
+  std::string version;
+  int insunits = 0;
+  // Layers in the order they are first drawn on. Coordinates and layer bounds are scaled and y-flipped so that the
+  // drawing extents start at 0, 0 with y down, as dxf2svg's toSVG lays them out.
+  std::vector<DxfLayerPaths> layers;
+  // Extents of everything drawn in scaled drawing coordinates (y up), dxf2svg's bbox.
+  DxfBounds bounds;
+  // Entities drawn, counting every entity of every insert, and entities of unsupported types (text, images, ...).
+  size_t entities = 0;
+  size_t skipped = 0;
+};
+
+// Reads an ASCII DXF from memory on the calling thread. `progress` gets the fraction of the input read so far, at
+// most every percent. Returns false with a message in `error` for binary or malformed files, or when `stop` is set.
+bool ReadDxf(const uint8_t* data, size_t size, const DxfOptions& options, const std::atomic<bool>& stop,
+             const std::function<void(double)>& progress, DxfDrawing* drawing, std::string* error);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_DXF_READER_H_
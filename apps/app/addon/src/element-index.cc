@@ -0,0 +1,132 @@
+#include "element-index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace beam {
+
+void ElementIndex::Set(const std::string& id, const Bounds& box, double order) {
+  auto found = byId_.find(id);
+
+  if (found != byId_.end()) {
+    Element& element = elements_[found->second];
+
+    if (!std::isnan(order)) element.order = order;
+    tree_.Update(element.leaf, box);
+
+    return;
+  }
+
+  uint32_t index;
+
+  if (freeElements_.empty()) {
+    index = static_cast<uint32_t>(elements_.size());
+    elements_.emplace_back();
+  } else {
+    index = freeElements_.back();
+    freeElements_.pop_back();
+  }
+
+  Element& element = elements_[index];
+
+  element.id = id;
+  element.order = std::isnan(order) ? nextOrder_ : order;
+  element.leaf = tree_.Insert(box, index);
+  nextOrder_ = std::max(nextOrder_, element.order) + 1;
+  byId_.emplace(id, index);
+  idBytes_ += id.size();
+}
+
+bool ElementIndex::Update(const std::string& id, const Bounds& box) {
+  auto found = byId_.find(id);
+
+  if (found == byId_.end()) return false;
+  tree_.Update(elements_[found->second].leaf, box);
+
+  return true;
+}
+
+bool ElementIndex::Remove(const std::string& id) {
+  auto found = byId_.find(id);
+
+  if (found == byId_.end()) return false;
+
+  Element& element = elements_[found->second];
+
+  tree_.Remove(element.leaf);
+  idBytes_ -= element.id.size();
+  element.id.clear();
+  element.leaf = AabbTree::kNull;
+  freeElements_.push_back(found->second);
+  byId_.erase(found);
+
+  return true;
+}
+
+void ElementIndex::Load(const std::vector<std::string>& ids, const std::vector<Bounds>& boxes) {
+  std::vector<Bounds> unique;
+  std::vector<int32_t> leaves;
+
+  elements_.clear();
+  freeElements_.clear();
+  byId_.clear();
+  idBytes_ = 0;
+  byId_.reserve(ids.size());
+  for (size_t i = 0; i < ids.size(); i += 1) {
+    auto inserted = byId_.emplace(ids[i], static_cast<uint32_t>(elements_.size()));
+
+    if (!inserted.second) {
+      unique[inserted.first->second] = boxes[i];
+      continue;
+    }
+    elements_.push_back({ids[i], static_cast<double>(elements_.size()), AabbTree::kNull});
+    idBytes_ += ids[i].size();
+    unique.push_back(boxes[i]);
+  }
+  tree_.Build(unique, leaves);
+  for (size_t i = 0; i < elements_.size(); i += 1) elements_[i].leaf = leaves[i];
+  nextOrder_ = static_cast<double>(elements_.size());
+}
+
+void ElementIndex::QueryRect(const Bounds& rect, bool contained, std::vector<uint32_t>& elements) const {
+  elements.clear();
+  tree_.Query([&](const Bounds& box) { return box.Intersects(rect); },
+              [&](const Bounds& box) {
+                return contained ? rect.minX <= box.minX && rect.minY <= box.minY && box.maxX <= rect.maxX &&
+                                       box.maxY <= rect.maxY
+                                 : box.Intersects(rect);
+              },
+              [&](int32_t leaf) { elements.push_back(tree_.Value(leaf)); });
+  SortByOrder(elements);
+}
+
+void ElementIndex::QueryPoint(Vec2 p, double tolerance, std::vector<uint32_t>& elements) const {
+  Bounds rect = {p.x - tolerance, p.y - tolerance, p.x + tolerance, p.y + tolerance};
+
+  QueryRect(rect, false, elements);
+}
+
+bool ElementIndex::Box(const std::string& id, Bounds* box) const {
+  auto found = byId_.find(id);
+
+  if (found == byId_.end()) return false;
+  *box = tree_.Box(elements_[found->second].leaf);
+
+  return true;
+}
+
+size_t ElementIndex::MemoryUsage() const {
+  // Every map node holds a copy of its id next to the index and a next pointer.
+  size_t node = sizeof(std::string) + sizeof(uint32_t) + sizeof(void*);
+
+  return tree_.MemoryUsage() + elements_.capacity() * sizeof(Element) + freeElements_.capacity() * sizeof(uint32_t) +
+         byId_.bucket_count() * sizeof(void*) + byId_.size() * node + 2 * idBytes_;
+}
+
+void ElementIndex::SortByOrder(std::vector<uint32_t>& elements) const {
+  std::sort(elements.begin(), elements.end(), [this](uint32_t a, uint32_t b) {
+    return elements_[a].order < elements_[b].order || (elements_[a].order == elements_[b].order && a < b);
+  });
+}
+
+}  // namespace beam
@@ -0,0 +1,60 @@
+// Spatial index of canvas elements keyed by element id: an AABB tree over their bounding boxes for hit tests,
+// rubber-band selection and bounding box unions without touching the DOM.
+#ifndef BEAM_ADDON_ELEMENT_INDEX_H_
+#define BEAM_ADDON_ELEMENT_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aabb-tree.h"
+#include "polygon.h"
+
+namespace beam {
+
+class ElementIndex {
+ public:
+  // Adds element `id` or moves it to `box`. Results list elements by `order` (document order); NaN keeps the order of
+  // a known element and puts a new one after all others.
+  void Set(const std::string& id, const Bounds& box, double order);
+  // Moves a known element; false when `id` is not indexed.
+  bool Update(const std::string& id, const Bounds& box);
+  bool Remove(const std::string& id);
+  // Replaces the contents by `ids` in that order, building a balanced tree at once. A repeated id keeps its last box.
+  void Load(const std::vector<std::string>& ids, const std::vector<Bounds>& boxes);
+
+  // Elements whose box meets `rect`, or lies inside it when `contained`, in order.
+  void QueryRect(const Bounds& rect, bool contained, std::vector<uint32_t>& elements) const;
+  // Elements whose box, grown by `tolerance`, contains p, in order; the topmost comes last.
+  void QueryPoint(Vec2 p, double tolerance, std::vector<uint32_t>& elements) const;
+  bool Box(const std::string& id, Bounds* box) const;
+
+  const std::string& Id(uint32_t element) const { return elements_[element].id; }
+  // Union of all boxes, empty when nothing is indexed.
+  Bounds Union() const { return tree_.Union(); }
+  size_t Size() const { return tree_.LeafCount(); }
+  size_t MemoryUsage() const;
+
+ private:
+  struct Element {
+    std::string id;
+    double order;
+    int32_t leaf;
+  };
+
+  void SortByOrder(std::vector<uint32_t>& elements) const;
+
+  AabbTree tree_;
+  std::vector<Element> elements_;
+  std::vector<uint32_t> freeElements_;
+  std::unordered_map<std::string, uint32_t> byId_;
+  double nextOrder_ = 0;
+  // Characters of all indexed ids, counted twice by MemoryUsage for the copies held by the map.
+  size_t idBytes_ = 0;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_ELEMENT_INDEX_H_
@@ -0,0 +1,106 @@
+// Layout of FLUX task code (.fc), the binary form of a job that the machines run, as fluxclient writes it. All
+// integers are little-endian.
+//
+// Version 1, "FCx0001\n" (beamo, Beambox and Beambox Pro):
+//   u32 script size, script, u32 CRC-32 of the script
+//   u32 metadata size, metadata, u32 CRC-32 of the metadata
+//   per preview image: u32 size, image bytes; then u32 0
+// Metadata is a list of KEY=VALUE entries, each ended by a NUL byte.
+//
+// Versions 2 and 3, "FCx0002\n" and "FCx0003\n" (Ador, Beambox II, beamo II, HEXA RF and later): a list of chunks,
+//   4-byte tag, u32 size, body, u32 CRC-32 of the body (PREV has no checksum)
+//   FILE  metadata as a JSON object
+//   PREV  preview image
+//   CONT  the content, a list of sections:
+//           "xMIN", 4-byte id, u32 size, commands   moves and setup around the tasks
+//           "TASK"                                  marks the start of a task; no size or body
+//           TRAN, MAIN; u32 size, commands          setup and body of the task
+//           INFO; u32 size, JSON                    name, head type and estimates of the task
+//           PREV; u32 size, preview image           preview of the task
+//   POST  JSON array of per-task settings
+//
+// Commands, an opcode byte followed by its operands:
+//   0x80 | axes           move; the axes bits say which float32 operands follow, in the order F X Y Z and three
+//                         head-specific values. Coordinates are absolute mm, F is mm/min
+//   0x01                  home
+//   0x04 f32              dwell
+//   0x05, 0x06            no operands
+//   0x07 u32, 0x08 u32
+//   0x10 sub              raster line: sub 1 u8, sub 2 u32, sub 3 u32 (pixels), sub 4, sub 5 (the next move engraves
+//                         the line), sub 6 (end of raster)
+//   0x11 sub              print head: sub 0 u32 size, sub 1 that many bytes, sub 2 u16, sub 3 u8, sub 4 and sub 14
+//                         (the next move prints a swath), sub 5 u32, sub 10 u8, sub 11 u32 size, sub 12 that many
+//                         bytes, sub 13 u16
+//   0x12 sub u32          module setting; for sub other than 0, a u8 mask and a float32 per bit set in it
+//   0x13 u8 u32
+//   0x14 u8, 0x15 u8, 0x16 u8
+//   0x20 f32              laser power for the following moves; 0 or less is off
+//   0x30 f32
+#ifndef BEAM_ADDON_FCODE_FORMAT_H_
+#define BEAM_ADDON_FCODE_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace beam {
+
+constexpr size_t kFcodeSignatureSize = 8;
+// Followed by the version digit and a newline.
+constexpr char kFcodeSignaturePrefix[] = "FCx000";
+constexpr size_t kFcodeTagSize = 4;
+
+enum FcodeOpcode : uint8_t {
+  kFcodeHome = 0x01,
+  kFcodeDwell = 0x04,
+  kFcode05 = 0x05,
+  kFcode06 = 0x06,
+  kFcode07 = 0x07,
+  kFcode08 = 0x08,
+  kFcodeRaster = 0x10,
+  kFcodePrint = 0x11,
+  kFcodeModule = 0x12,
+  kFcode13 = 0x13,
+  kFcode14 = 0x14,
+  kFcode15 = 0x15,
+  kFcode16 = 0x16,
+  kFcodePower = 0x20,
+  kFcode30 = 0x30,
+  kFcodeMove = 0x80,
+};
+
+enum FcodeAxis : uint8_t {
+  kFcodeAxisF = 0x40,
+  kFcodeAxisX = 0x20,
+  kFcodeAxisY = 0x10,
+  kFcodeAxisZ = 0x08,
+};
+
+// Sub-commands after which the next move engraves or prints.
+constexpr uint8_t kFcodeRasterLine = 5;
+constexpr uint8_t kFcodePrintSwath = 4;
+constexpr uint8_t kFcodePrintInkjetSwath = 14;
+
+inline void WriteU32(uint32_t value, uint8_t* out) {
+  for (int k = 0; k < 4; k += 1) out[k] = static_cast<uint8_t>(value >> (8 * k));
+}
+
+inline uint32_t ReadU32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+         static_cast<uint32_t>(p[3]) << 24;
+}
+
+// float32 operands; every platform the app ships on is little-endian.
+inline void WriteF32(float value, uint8_t* out) { memcpy(out, &value, sizeof(value)); }
+
+inline float ReadF32(const uint8_t* p) {
+  float value;
+
+  memcpy(&value, p, sizeof(value));
+
+  return value;
+}
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_FCODE_FORMAT_H_
@@ -0,0 +1,389 @@
+#include "fcode-reader.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "crc32.h"
+#include "fcode-format.h"
+
+namespace beam {
+
+namespace {
+
+// Reads a u32 size and checks that that many bytes follow it.
+bool ReadSection(const uint8_t* data, size_t size, size_t* offset, ByteSpan* section) {
+  if (size - *offset < 4) return false;
+
+  uint32_t length = ReadU32(data + *offset);
+
+  *offset += 4;
+  if (length > size - *offset) return false;
+  *section = {data + *offset, length};
+  *offset += length;
+
+  return true;
+}
+
+bool ReadChecksum(const uint8_t* data, size_t size, size_t* offset, uint32_t* crc) {
+  if (size - *offset < 4) return false;
+  *crc = ReadU32(data + *offset);
+  *offset += 4;
+
+  return true;
+}
+
+bool IsTag(const uint8_t* data, const char* tag) { return memcmp(data, tag, kFcodeTagSize) == 0; }
+
+std::string TagName(const uint8_t* data) { return std::string(reinterpret_cast<const char*>(data), kFcodeTagSize); }
+
+size_t CountBits(uint8_t bits) {
+  size_t count = 0;
+
+  for (; bits; bits &= bits - 1) count += 1;
+
+  return count;
+}
+
+bool ReadVersion1(const uint8_t* data, size_t size, FcodeIndex* index, std::string* error) {
+  size_t offset = kFcodeSignatureSize;
+  ByteSpan metadata;
+  uint32_t metadataCrc;
+
+  if (!ReadSection(data, size, &offset, &index->content) || !ReadChecksum(data, size, &offset, &index->contentCrc) ||
+      !ReadSection(data, size, &offset, &metadata) || !ReadChecksum(data, size, &offset, &metadataCrc)) {
+    *error = "truncated task code";
+
+    return false;
+  }
+  if (Crc32(metadata.data, metadata.size) != metadataCrc) {
+    *error = "task code metadata checksum mismatch";
+
+    return false;
+  }
+
+  const char* text = reinterpret_cast<const char*>(metadata.data);
+  const char* end = text + metadata.size;
+
+  while (text < end) {
+    const char* entryEnd = static_cast<const char*>(memchr(text, 0, end - text));
+
+    if (!entryEnd) entryEnd = end;
+
+    const char* separator = static_cast<const char*>(memchr(text, '=', entryEnd - text));
+
+    if (separator) index->metadata.emplace_back(std::string(text, separator), std::string(separator + 1, entryEnd));
+    text = entryEnd + 1;
+  }
+
+  ByteSpan preview;
+
+  // Files cut short after the previews are still readable; the list just ends there.
+  while (size - offset >= 4 && ReadU32(data + offset) > 0) {
+    if (!ReadSection(data, size, &offset, &preview)) {
+      *error = "truncated task code";
+
+      return false;
+    }
+    index->previews.push_back(preview);
+  }
+
+  return true;
+}
+
+bool ReadChunks(const uint8_t* data, size_t size, FcodeIndex* index, std::string* error) {
+  size_t offset = kFcodeSignatureSize;
+  bool hasMetadata = false;
+  bool hasContent = false;
+
+  while (offset < size) {
+    const uint8_t* tag = data + offset;
+    ByteSpan body;
+    uint32_t crc;
+
+    if (size - offset < kFcodeTagSize) {
+      *error = "truncated task code";
+
+      return false;
+    }
+    offset += kFcodeTagSize;
+    if (!ReadSection(data, size, &offset, &body) ||
+        (!IsTag(tag, "PREV") && !ReadChecksum(data, size, &offset, &crc))) {
+      *error = "truncated task code";
+
+      return false;
+    }
+    if (IsTag(tag, "PREV")) {
+      index->previews.push_back(body);
+    } else if (IsTag(tag, "FILE")) {
+      if (Crc32(body.data, body.size) != crc) {
+        *error = "task code metadata checksum mismatch";
+
+        return false;
+      }
+      index->metadataJson = body;
+      hasMetadata = true;
+    } else if (IsTag(tag, "CONT")) {
+      index->content = body;
+      index->contentCrc = crc;
+      hasContent = true;
+    } else if (!IsTag(tag, "POST")) {
+      *error = "unknown task code chunk " + TagName(tag);
+
+      return false;
+    }
+  }
+  if (!hasMetadata || !hasContent) {
+    *error = "truncated task code";
+
+    return false;
+  }
+
+  return true;
+}
+
+// Column of each FcodeAxis bit in a parsed record, in operand order. The three low axis bits carry head-specific
+// values that have no column.
+constexpr uint8_t kOperandAxes[4] = {kFcodeAxisF, kFcodeAxisX, kFcodeAxisY, kFcodeAxisZ};
+constexpr size_t kOperandColumns[4] = {5, 1, 2, 3};
+
+constexpr float kUnknownAxis = std::numeric_limits<float>::quiet_NaN();
+
+// Operand bytes after the sub-command byte of raster and print head commands with a fixed size, or -1.
+int SubOperandSize(uint8_t opcode, uint8_t sub) {
+  if (opcode == kFcodeRaster) {
+    constexpr int kSizes[] = {-1, 1, 4, 4, 0, 0, 0};
+
+    return sub < sizeof(kSizes) / sizeof(kSizes[0]) ? kSizes[sub] : -1;
+  }
+
+  constexpr int kSizes[] = {4, -1, 2, 1, 0, 4, -1, -1, -1, -1, 1, 4, -1, 2, 0};
+
+  return sub < sizeof(kSizes) / sizeof(kSizes[0]) ? kSizes[sub] : -1;
+}
+
+// Motion state carried from one command section to the next.
+class MotionDecoder {
+ public:
+  explicit MotionDecoder(std::vector<float>* parsed) : parsed_(parsed), first_(parsed->size()) {}
+
+  bool Decode(const ByteSpan& commands, std::string* error);
+  // Fills in the axes that were never set.
+  void Finish();
+
+ private:
+  void SetColumn(size_t column, float value);
+  void Push();
+
+  std::vector<float>* parsed_;
+  size_t first_;
+  // g, x, y, z, e, f, a, s, t of the last record.
+  float state_[kParsedGcodeStride] = {0, kUnknownAxis, kUnknownAxis, kUnknownAxis, 0, kUnknownAxis, 0, 0, 0};
+  // The next move engraves a raster line or prints a swath.
+  bool marked_ = false;
+  // Sizes of the print head payloads announced by sub-commands 0 and 11.
+  uint32_t printPayload_ = 0;
+  uint32_t swathPayload_ = 0;
+};
+
+void MotionDecoder::SetColumn(size_t column, float value) {
+  // parseGcode gives earlier records the first value an axis gets.
+  if (std::isnan(state_[column])) {
+    for (size_t i = first_ + column; i < parsed_->size(); i += kParsedGcodeStride) (*parsed_)[i] = value;
+  }
+  state_[column] = value;
+}
+
+void MotionDecoder::Push() {
+  state_[0] = marked_ || state_[7] > 0 ? 1 : 0;
+  marked_ = false;
+  parsed_->insert(parsed_->end(), state_, state_ + kParsedGcodeStride);
+}
+
+bool MotionDecoder::Decode(const ByteSpan& commands, std::string* error) {
+  const uint8_t* script = commands.data;
+  size_t size = commands.size;
+  size_t offset = 0;
+
+  while (offset < size) {
+    uint8_t opcode = script[offset];
+    uint8_t sub = size - offset > 1 ? script[offset + 1] : 0;
+    size_t length = 1;
+
+    if (opcode & kFcodeMove) {
+      length += 4 * CountBits(opcode & ~kFcodeMove);
+    } else {
+      switch (opcode) {
+        case kFcodeHome:
+        case kFcode05:
+        case kFcode06:
+          break;
+        case kFcodeDwell:
+        case kFcode07:
+        case kFcode08:
+        case kFcodePower:
+        case kFcode30:
+          length += 4;
+          break;
+        case kFcode14:
+        case kFcode15:
+        case kFcode16:
+          length += 1;
+          break;
+        case kFcode13:
+          length += 5;
+          break;
+        case kFcodeModule:
+          length += 5;
+          // The mask byte is counted even when it is missing, so the command reads as truncated.
+          if (sub != 0) length += 1 + (size - offset > length ? 4 * CountBits(script[offset + length]) : 0);
+          break;
+        case kFcodeRaster:
+        case kFcodePrint: {
+          int fixed = SubOperandSize(opcode, sub);
+          size_t operandSize = fixed < 0 ? 0 : static_cast<size_t>(fixed);
+
+          if (opcode == kFcodePrint && sub == 1) {
+            operandSize = printPayload_;
+          } else if (opcode == kFcodePrint && sub == 12) {
+            operandSize = swathPayload_;
+          } else if (fixed < 0 && size - offset > 1) {
+            *error = "unknown task code command " + std::to_string(opcode) + " " + std::to_string(sub);
+
+            return false;
+          }
+          length += 1 + operandSize;
+          break;
+        }
+        default:
+          *error = "unknown task code command " + std::to_string(opcode);
+
+          return false;
+      }
+    }
+    if (length > size - offset) {
+      *error = "truncated task code command";
+
+      return false;
+    }
+
+    const uint8_t* operands = script + offset + 1;
+
+    if (opcode & kFcodeMove) {
+      for (size_t k = 0; k < 4; k += 1) {
+        if (!(opcode & kOperandAxes[k])) continue;
+
+        float value = ReadF32(operands);
+
+        SetColumn(kOperandColumns[k], kOperandColumns[k] == 2 ? -value : value);
+        operands += 4;
+      }
+      Push();
+    } else if (opcode == kFcodeHome) {
+      SetColumn(1, 0);
+      SetColumn(2, 0);
+      SetColumn(3, 0);
+      Push();
+    } else if (opcode == kFcodePower) {
+      state_[7] = ReadF32(operands);
+    } else if (opcode == kFcodeRaster) {
+      marked_ = marked_ || sub == kFcodeRasterLine;
+    } else if (opcode == kFcodePrint) {
+      marked_ = marked_ || sub == kFcodePrintSwath || sub == kFcodePrintInkjetSwath;
+      if (sub == 0) printPayload_ = ReadU32(operands + 1);
+      if (sub == 11) swathPayload_ = ReadU32(operands + 1);
+    }
+    offset += length;
+  }
+
+  return true;
+}
+
+void MotionDecoder::Finish() {
+  const float defaults[kParsedGcodeStride] = {0, 0, 0, 0, 0, 1000, 0, 0, 0};
+
+  for (size_t column = 1; column < kParsedGcodeStride; column += 1) {
+    if (std::isnan(state_[column])) SetColumn(column, defaults[column]);
+  }
+}
+
+// Decodes the command sections of a CONT chunk in order.
+bool DecodeContent(const ByteSpan& content, MotionDecoder* decoder, std::string* error) {
+  const uint8_t* data = content.data;
+  size_t size = content.size;
+  size_t offset = 0;
+
+  while (offset < size) {
+    const uint8_t* tag = data + offset;
+    ByteSpan section;
+
+    if (size - offset < kFcodeTagSize) {
+      *error = "truncated task code";
+
+      return false;
+    }
+    offset += kFcodeTagSize;
+    if (IsTag(tag, "TASK")) continue;
+
+    bool commands = IsTag(tag, "xMIN") || IsTag(tag, "TRAN") || IsTag(tag, "MAIN");
+
+    if (!commands && !IsTag(tag, "INFO") && !IsTag(tag, "PREV")) {
+      *error = "unknown task code section " + TagName(tag);
+
+      return false;
+    }
+    // xMIN sections carry a 4-byte id before their size.
+    if (IsTag(tag, "xMIN")) offset += kFcodeTagSize;
+    if (offset > size || !ReadSection(data, size, &offset, &section)) {
+      *error = "truncated task code";
+
+      return false;
+    }
+    if (commands && !decoder->Decode(section, error)) return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+bool ReadFcodeIndex(const uint8_t* data, size_t size, FcodeIndex* index, std::string* error) {
+  size_t prefixSize = sizeof(kFcodeSignaturePrefix) - 1;
+
+  if (size < kFcodeSignatureSize || memcmp(data, kFcodeSignaturePrefix, prefixSize) != 0 ||
+      data[kFcodeSignatureSize - 1] != '\n') {
+    *error = "not a task code file";
+
+    return false;
+  }
+
+  char version = static_cast<char>(data[prefixSize]);
+
+  if (version < '1' || version > '3') {
+    *error = std::string("unsupported task code version ") + version;
+
+    return false;
+  }
+  index->version = static_cast<uint8_t>(version - '0');
+
+  return index->version == 1 ? ReadVersion1(data, size, index, error) : ReadChunks(data, size, index, error);
+}
+
+bool DecodeFcodeMotion(const FcodeIndex& index, std::vector<float>* parsed, std::string* error) {
+  if (Crc32(index.content.data, index.content.size) != index.contentCrc) {
+    *error = "task code checksum mismatch";
+
+    return false;
+  }
+
+  MotionDecoder decoder(parsed);
+
+  if (index.version == 1 ? !decoder.Decode(index.content, error) : !DecodeContent(index.content, &decoder, error)) {
+    return false;
+  }
+  decoder.Finish();
+
+  return true;
+}
+
+}  // namespace beam
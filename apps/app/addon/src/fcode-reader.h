@@ -0,0 +1,44 @@
+// Reading task code (.fc) in place: the framing is parsed without touching the commands, which are only read when
+// their checksum is verified or their motion decoded.
+#ifndef BEAM_ADDON_FCODE_READER_H_
+#define BEAM_ADDON_FCODE_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "file-io.h"
+
+namespace beam {
+
+struct FcodeIndex {
+  // 1, 2 or 3; see src/fcode-format.h.
+  uint8_t version = 0;
+  // Version 1 KEY=VALUE entries.
+  std::vector<std::pair<std::string, std::string>> metadata;
+  // Versions 2 and 3: the FILE chunk, a JSON object.
+  ByteSpan metadataJson;
+  std::vector<ByteSpan> previews;
+  // The script of version 1, the CONT chunk of later versions.
+  ByteSpan content;
+  uint32_t contentCrc = 0;
+};
+
+// Parses the framing, metadata and preview list, checking the metadata checksum. Returns false with a message in
+// `error` when the data is not task code, is a version this reader does not know or a section is cut short.
+bool ReadFcodeIndex(const uint8_t* data, size_t size, FcodeIndex* index, std::string* error);
+
+// Number of floats per move in the layout GcodePreview.setParsedGcode reads: g, x, y, z, e, f, a, s, t.
+constexpr size_t kParsedGcodeStride = 9;
+
+// Checks the content checksum and appends one record per move or home to `parsed`, in file order across all command
+// sections, following parseGcode: y is negated, g is 1 while the power is above 0 and for a move that engraves a
+// raster line or prints a swath, and axes not set yet take their first later value, or 0 (1000 for F) when there is
+// none. Fails on commands and sections that are not in src/fcode-format.h rather than guessing their size.
+bool DecodeFcodeMotion(const FcodeIndex& index, std::vector<float>* parsed, std::string* error);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_FCODE_READER_H_
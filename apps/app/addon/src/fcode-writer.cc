@@ -0,0 +1,369 @@
+#include "fcode-writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "crc32.h"
+#include "fcode-format.h"
+
+namespace beam {
+
+namespace {
+
+constexpr char kVersion1Signature[kFcodeSignatureSize + 1] = "FCx0001\n";
+
+// Metadata entries fluxclient writes for laser jobs, filled in by the encoder.
+constexpr char kVersion[] = "VERSION";
+constexpr char kHeadType[] = "HEAD_TYPE";
+constexpr char kTimeCost[] = "TIME_COST";
+constexpr char kTravelDistance[] = "TRAVEL_DIST";
+constexpr char kMaxX[] = "MAX_X";
+constexpr char kMaxY[] = "MAX_Y";
+constexpr char kMaxZ[] = "MAX_Z";
+constexpr char kMaxR[] = "MAX_R";
+
+// Script blocks are allocated at this size, so growing the script never copies it.
+constexpr size_t kBlockSize = 1 << 20;
+constexpr uint8_t kAxisBits[3] = {kFcodeAxisX, kFcodeAxisY, kFcodeAxisZ};
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Optional sign, digits and fraction; spaces may separate the number from its letter, as parseGcode allows.
+bool ParseNumber(const char** cursor, const char* end, double* value) {
+  const char* p = *cursor;
+  bool negative = false;
+  bool digits = false;
+  double result = 0;
+
+  while (p < end && IsSpace(*p)) p += 1;
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    p += 1;
+  }
+  while (p < end && IsDigit(*p)) {
+    result = result * 10 + (*p - '0');
+    digits = true;
+    p += 1;
+  }
+  if (p < end && *p == '.') {
+    double scale = 0.1;
+
+    p += 1;
+    while (p < end && IsDigit(*p)) {
+      result += (*p - '0') * scale;
+      scale *= 0.1;
+      digits = true;
+      p += 1;
+    }
+  }
+  if (!digits) return false;
+  *value = negative ? -result : result;
+  *cursor = p;
+
+  return true;
+}
+
+std::string FormatNumber(double value) {
+  char text[32];
+
+  snprintf(text, sizeof(text), "%.2f", value);
+
+  return text;
+}
+
+}  // namespace
+
+void FcodeEncoder::Feed(const char* data, size_t size) {
+  const char* end = data + size;
+  const char* p = data;
+
+  if (!carry_.empty()) {
+    const char* newline = std::find(p, end, '\n');
+
+    carry_.append(p, newline);
+    if (newline == end) return;
+    ConvertLine(carry_.data(), carry_.data() + carry_.size());
+    carry_.clear();
+    p = newline + 1;
+  }
+  while (p < end) {
+    const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+
+    if (!newline) {
+      carry_.assign(p, end);
+
+      return;
+    }
+    ConvertLine(p, newline);
+    p = newline + 1;
+  }
+}
+
+void FcodeEncoder::Finish() {
+  if (!carry_.empty()) ConvertLine(carry_.data(), carry_.data() + carry_.size());
+  carry_.clear();
+  crc_ = 0;
+  for (const std::vector<uint8_t>& block : blocks_) crc_ = Crc32(block.data(), block.size(), crc_);
+}
+
+void FcodeEncoder::ConvertLine(const char* begin, const char* end) {
+  end = std::find(begin, end, ';');
+  while (begin < end && IsSpace(*begin)) begin += 1;
+  while (end > begin && IsSpace(end[-1])) end -= 1;
+  if (begin == end) return;
+
+  double values[3] = {0, 0, 0};
+  uint8_t axes = 0;
+  double feedrate = 0;
+  double s = 0;
+  double dwellP = 0;
+  bool hasFeedrate = false;
+  bool hasS = false;
+  bool hasP = false;
+  bool move = false;
+  bool dwell = false;
+  bool home = false;
+  bool unsupported = false;
+  int laser = -1;
+  const char* p = begin;
+
+  while (p < end && !unsupported) {
+    if (IsSpace(*p)) {
+      p += 1;
+      continue;
+    }
+
+    char letter = static_cast<char>(*p >= 'a' && *p <= 'z' ? *p - 'a' + 'A' : *p);
+    double value;
+
+    p += 1;
+    // FLUX laser switches G1S0 and G1V0, read the way parseGcode reads them.
+    if (letter == 'G' && end - p >= 2 && p[0] == '1' && (p[1] == 'S' || p[1] == 'V')) {
+      laser = p[1] == 'V' ? 1 : 0;
+      p += 2;
+      ParseNumber(&p, end, &value);
+      move = true;
+      continue;
+    }
+    if (!ParseNumber(&p, end, &value)) {
+      unsupported = true;
+      break;
+    }
+    switch (letter) {
+      case 'G':
+        if (value == 0 || value == 1) {
+          move = true;
+        } else if (value == 4) {
+          dwell = true;
+        } else if (value == 28) {
+          home = true;
+        } else if (value == 90 || value == 91) {
+          relative_ = value == 91;
+        } else if (value != 21) {
+          // G21 (millimetres) is the only unit task code has.
+          unsupported = true;
+        }
+        break;
+      case 'X':
+      case 'Y':
+      case 'Z': {
+        int axis = letter - 'X';
+
+        values[axis] = value;
+        axes |= 1 << axis;
+        break;
+      }
+      case 'F':
+        feedrate = value;
+        hasFeedrate = true;
+        break;
+      case 'S':
+        s = value;
+        hasS = true;
+        break;
+      case 'P':
+        dwellP = value;
+        hasP = true;
+        break;
+      default:
+        // M codes, the rotary A axis and anything else without a command.
+        unsupported = true;
+        break;
+    }
+  }
+  if (unsupported || (hasP && !dwell) || (dwell && (move || home || axes || hasFeedrate)) || (home && move)) {
+    summary_.skippedLines += 1;
+
+    return;
+  }
+  if (laser >= 0) switchedOff_ = laser == 0;
+  if (dwell) {
+    uint8_t command[5] = {kFcodeDwell};
+    double milliseconds = hasP ? dwellP : s * 1000;
+
+    WriteF32(static_cast<float>(milliseconds), command + 1);
+    Emit(command, sizeof(command));
+    summary_.time += std::max(milliseconds, 0.0) / 1000;
+
+    return;
+  }
+  if (home) {
+    uint8_t opcode = kFcodeHome;
+
+    Emit(&opcode, 1);
+    std::fill(position_, position_ + 3, 0);
+
+    return;
+  }
+  if (hasS) power_ = s;
+  UpdatePower();
+  if (axes || hasFeedrate) Move(values, axes, hasFeedrate, feedrate);
+}
+
+void FcodeEncoder::UpdatePower() {
+  double power = switchedOff_ ? 0 : power_;
+
+  if (power == writtenPower_) return;
+
+  uint8_t command[5] = {kFcodePower};
+
+  WriteF32(static_cast<float>(power), command + 1);
+  Emit(command, sizeof(command));
+  writtenPower_ = power;
+}
+
+void FcodeEncoder::Move(const double* values, uint8_t axes, bool hasFeedrate, double feedrate) {
+  uint8_t command[17];
+  size_t size = 1;
+  double target[3];
+
+  command[0] = kFcodeMove;
+  if (hasFeedrate) {
+    command[0] |= kFcodeAxisF;
+    WriteF32(static_cast<float>(feedrate), command + size);
+    size += 4;
+    feedrate_ = feedrate;
+  }
+  for (int axis = 0; axis < 3; axis += 1) {
+    target[axis] = position_[axis];
+    if (!(axes & (1 << axis))) continue;
+    target[axis] = relative_ ? position_[axis] + values[axis] : values[axis];
+    command[0] |= kAxisBits[axis];
+    WriteF32(static_cast<float>(target[axis]), command + size);
+    size += 4;
+  }
+  Emit(command, size);
+  if (!axes) return;
+
+  double dx = target[0] - position_[0];
+  double dy = target[1] - position_[1];
+  double dz = target[2] - position_[2];
+  double distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+  summary_.travelDistance += distance;
+  if (feedrate_ > 0) summary_.time += distance / feedrate_ * 60;
+  if (!moved_) {
+    summary_.maxX = target[0];
+    summary_.maxY = target[1];
+    summary_.maxZ = target[2];
+    summary_.maxR = std::hypot(target[0], target[1]);
+    moved_ = true;
+  } else {
+    summary_.maxX = std::max(summary_.maxX, target[0]);
+    summary_.maxY = std::max(summary_.maxY, target[1]);
+    summary_.maxZ = std::max(summary_.maxZ, target[2]);
+    summary_.maxR = std::max(summary_.maxR, std::hypot(target[0], target[1]));
+  }
+  std::copy(target, target + 3, position_);
+}
+
+void FcodeEncoder::Emit(const void* data, size_t size) {
+  if (blocks_.empty() || blocks_.back().capacity() - blocks_.back().size() < size) {
+    blocks_.emplace_back();
+    blocks_.back().reserve(std::max(kBlockSize, size));
+  }
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+  blocks_.back().insert(blocks_.back().end(), bytes, bytes + size);
+  scriptSize_ += size;
+}
+
+FcodeSerializer::FcodeSerializer(const FcodeEncoder& encoder,
+                                 const std::vector<std::pair<std::string, std::string>>& metadata,
+                                 const std::vector<ByteSpan>& previews) {
+  const FcodeSummary& summary = encoder.Summary();
+  std::vector<std::pair<std::string, std::string>> entries = {
+      {kVersion, "1"},
+      {kHeadType, "LASER"},
+      {kTimeCost, FormatNumber(summary.time)},
+      {kTravelDistance, FormatNumber(summary.travelDistance)},
+      {kMaxX, FormatNumber(summary.maxX)},
+      {kMaxY, FormatNumber(summary.maxY)},
+      {kMaxZ, FormatNumber(summary.maxZ)},
+      {kMaxR, FormatNumber(summary.maxR)},
+  };
+
+  // Caller entries replace computed ones with the same key.
+  for (const auto& entry : metadata) {
+    auto found = std::find_if(entries.begin(), entries.end(), [&](const auto& e) { return e.first == entry.first; });
+
+    if (found == entries.end()) {
+      entries.push_back(entry);
+    } else {
+      found->second = entry.second;
+    }
+  }
+
+  std::vector<uint8_t>& text = buffers_.emplace_back();
+
+  for (const auto& entry : entries) {
+    text.insert(text.end(), entry.first.begin(), entry.first.end());
+    text.push_back('=');
+    text.insert(text.end(), entry.second.begin(), entry.second.end());
+    text.push_back(0);
+  }
+
+  Append(kVersion1Signature, kFcodeSignatureSize);
+  AppendU32(static_cast<uint32_t>(encoder.ScriptSize()));
+  for (const std::vector<uint8_t>& block : encoder.Blocks()) Append(block.data(), block.size());
+  AppendU32(encoder.ScriptCrc());
+  AppendU32(static_cast<uint32_t>(text.size()));
+  Append(text.data(), text.size());
+  AppendU32(Crc32(text.data(), text.size()));
+  for (const ByteSpan& preview : previews) {
+    AppendU32(static_cast<uint32_t>(preview.size));
+    Append(preview.data, preview.size);
+  }
+  AppendU32(0);
+}
+
+void FcodeSerializer::Append(const void* data, size_t size) {
+  if (size == 0) return;
+  chunks_.push_back({static_cast<const uint8_t*>(data), size});
+  size_ += size;
+}
+
+void FcodeSerializer::AppendU32(uint32_t value) {
+  std::vector<uint8_t>& buffer = buffers_.emplace_back(4);
+
+  WriteU32(value, buffer.data());
+  Append(buffer.data(), buffer.size());
+}
+
+void FcodeSerializer::CopyTo(uint8_t* out) const {
+  for (const ByteSpan& chunk : chunks_) {
+    memcpy(out, chunk.data, chunk.size);
+    out += chunk.size;
+  }
+}
+
+bool FcodeSerializer::WriteFile(const std::string& path, std::string* error) const {
+  return WriteFileAtomically(path, chunks_, error);
+}
+
+}  // namespace beam
@@ -0,0 +1,104 @@
+// G-code to version 1 task code (.fc), the "FCx0001" layout of src/fcode-format.h that fluxclient writes for beamo,
+// Beambox and Beambox Pro. The encoder consumes G-code text in pieces of any size, so a file can be fed straight from
+// a memory map, and keeps the script in fixed-size blocks that are written out without concatenation.
+//
+// Only the commands of the format whose meaning is known are written: moves, home, dwell and laser power. The machine
+// preamble fluxclient adds after homing (0x05, 0x07 and negative power values) is not, and G-code lines that need
+// another command are skipped and counted, so callers can fall back to the backend for such jobs.
+#ifndef BEAM_ADDON_FCODE_WRITER_H_
+#define BEAM_ADDON_FCODE_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "file-io.h"
+
+namespace beam {
+
+// What the encoder learned about the job while converting it.
+struct FcodeSummary {
+  // Seconds at the programmed feedrates plus dwells, without acceleration.
+  double time = 0;
+  // Length of every move in mm, travel and engraving alike.
+  double travelDistance = 0;
+  double maxX = 0;
+  double maxY = 0;
+  double maxZ = 0;
+  // Largest distance from the origin in the XY plane.
+  double maxR = 0;
+  // Lines left out because they use words that have no task code command.
+  uint64_t skippedLines = 0;
+};
+
+class FcodeEncoder {
+ public:
+  FcodeEncoder() = default;
+
+  FcodeEncoder(const FcodeEncoder&) = delete;
+  FcodeEncoder& operator=(const FcodeEncoder&) = delete;
+
+  // Consumes more G-code; a line may be split across calls.
+  void Feed(const char* data, size_t size);
+  // Converts the last line when the G-code does not end with a newline.
+  void Finish();
+
+  const FcodeSummary& Summary() const { return summary_; }
+  uint64_t ScriptSize() const { return scriptSize_; }
+  // Valid after Finish().
+  uint32_t ScriptCrc() const { return crc_; }
+  const std::deque<std::vector<uint8_t>>& Blocks() const { return blocks_; }
+
+ private:
+  void ConvertLine(const char* begin, const char* end);
+  void Move(const double* values, uint8_t axes, bool hasFeedrate, double feedrate);
+  // Writes the power the laser should have now when it differs from the last one written.
+  void UpdatePower();
+  void Emit(const void* data, size_t size);
+
+  std::string carry_;
+  std::deque<std::vector<uint8_t>> blocks_;
+  uint64_t scriptSize_ = 0;
+  uint32_t crc_ = 0;
+  FcodeSummary summary_;
+  bool moved_ = false;
+  bool relative_ = false;
+  // X, Y, Z.
+  double position_[3] = {0, 0, 0};
+  double feedrate_ = 0;
+  // The S word, and whether the FLUX G1S0 switch turned the laser off since the last G1V0.
+  double power_ = 0;
+  bool switchedOff_ = false;
+  double writtenPower_ = 0;
+};
+
+// The complete file around an encoded script; preview spans must outlive it.
+class FcodeSerializer {
+ public:
+  FcodeSerializer(const FcodeEncoder& encoder, const std::vector<std::pair<std::string, std::string>>& metadata,
+                  const std::vector<ByteSpan>& previews);
+
+  FcodeSerializer(const FcodeSerializer&) = delete;
+  FcodeSerializer& operator=(const FcodeSerializer&) = delete;
+
+  uint64_t Size() const { return size_; }
+  const std::vector<ByteSpan>& Chunks() const { return chunks_; }
+
+  void CopyTo(uint8_t* out) const;
+  bool WriteFile(const std::string& path, std::string* error) const;
+
+ private:
+  void Append(const void* data, size_t size);
+  void AppendU32(uint32_t value);
+
+  std::deque<std::vector<uint8_t>> buffers_;
+  std::vector<ByteSpan> chunks_;
+  uint64_t size_ = 0;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_FCODE_WRITER_H_
@@ -0,0 +1,407 @@
+#include "file-io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace beam {
+
+namespace {
+
+// macOS rejects a writev whose lengths add up to more than INT_MAX; Windows _write takes an unsigned int.
+constexpr size_t kMaxWriteBytes = size_t(1) << 30;
+
+std::atomic<uint32_t> tempCounter{0};
+
+std::string ErrorMessage(const char* operation, const std::string& path) {
+  return std::string(operation) + " '" + path + "': " + strerror(errno);
+}
+
+#ifdef _WIN32
+
+std::wstring WidePath(const std::string& path) {
+  int length = MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()), nullptr, 0);
+  std::wstring result(length, L'\0');
+
+  MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()), &result[0], length);
+
+  return result;
+}
+
+std::string NarrowPath(const wchar_t* path) {
+  int length = WideCharToMultiByte(CP_UTF8, 0, path, -1, nullptr, 0, nullptr, nullptr);
+  std::string result(length > 0 ? length - 1 : 0, '\0');
+
+  if (length > 1) WideCharToMultiByte(CP_UTF8, 0, path, -1, &result[0], length, nullptr, nullptr);
+
+  return result;
+}
+
+int OpenForWrite(const std::string& path) {
+  return _wopen(WidePath(path).c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+int OpenForAppend(const std::string& path) {
+  return _wopen(WidePath(path).c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+int64_t FileSize(int fd) { return _lseeki64(fd, 0, SEEK_END); }
+
+bool WriteChunks(int fd, const std::vector<ByteSpan>& chunks) {
+  for (const ByteSpan& chunk : chunks) {
+    size_t done = 0;
+
+    while (done < chunk.size) {
+      unsigned int size = static_cast<unsigned int>(std::min(chunk.size - done, kMaxWriteBytes));
+      int written = _write(fd, chunk.data + done, size);
+
+      if (written < 0) return false;
+      done += written;
+    }
+  }
+
+  return true;
+}
+
+bool SyncFile(int fd) { return _commit(fd) == 0; }
+
+int CloseFile(int fd) { return _close(fd); }
+
+bool RenameFile(const std::string& from, const std::string& to) {
+  if (MoveFileExW(WidePath(from).c_str(), WidePath(to).c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+    return true;
+  }
+  errno = EACCES;
+
+  return false;
+}
+
+int Unlink(const std::string& path) { return _wunlink(WidePath(path).c_str()); }
+
+#else
+
+#ifdef IOV_MAX
+constexpr size_t kMaxIovecs = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+constexpr size_t kMaxIovecs = 16;
+#endif
+
+int OpenForWrite(const std::string& path) {
+  return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+}
+
+int OpenForAppend(const std::string& path) {
+  return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+}
+
+int64_t FileSize(int fd) {
+  struct stat info;
+
+  return fstat(fd, &info) == 0 ? static_cast<int64_t>(info.st_size) : -1;
+}
+
+// One writev per batch of up to kMaxIovecs chunks; short writes resume mid-chunk.
+bool WriteChunks(int fd, const std::vector<ByteSpan>& chunks) {
+  size_t index = 0;
+  size_t skip = 0;
+  struct iovec iov[kMaxIovecs];
+
+  while (true) {
+    while (index < chunks.size() && skip == chunks[index].size) {
+      index += 1;
+      skip = 0;
+    }
+    if (index == chunks.size()) return true;
+
+    size_t count = 0;
+    size_t total = 0;
+
+    for (size_t i = index; i < chunks.size() && count < kMaxIovecs && total < kMaxWriteBytes; i += 1) {
+      size_t offset = i == index ? skip : 0;
+      size_t size = std::min(chunks[i].size - offset, kMaxWriteBytes - total);
+
+      if (size == 0) continue;
+      iov[count].iov_base = const_cast<uint8_t*>(chunks[i].data + offset);
+      iov[count].iov_len = size;
+      count += 1;
+      total += size;
+    }
+
+    ssize_t written = writev(fd, iov, static_cast<int>(count));
+
+    if (written < 0) {
+      if (errno == EINTR) continue;
+
+      return false;
+    }
+    for (size_t remaining = static_cast<size_t>(written); remaining > 0;) {
+      size_t step = std::min(remaining, chunks[index].size - skip);
+
+      skip += step;
+      remaining -= step;
+      if (skip == chunks[index].size) {
+        index += 1;
+        skip = 0;
+      }
+    }
+  }
+}
+
+bool SyncFile(int fd) {
+#ifdef __APPLE__
+  // fsync only reaches the drive cache on macOS.
+  if (fcntl(fd, F_FULLFSYNC) == 0) return true;
+#endif
+
+  return fsync(fd) == 0;
+}
+
+int CloseFile(int fd) { return close(fd); }
+
+bool RenameFile(const std::string& from, const std::string& to) { return rename(from.c_str(), to.c_str()) == 0; }
+
+int Unlink(const std::string& path) { return unlink(path.c_str()); }
+
+#endif
+
+}  // namespace
+
+bool WriteFileAtomically(const std::string& path, const std::vector<ByteSpan>& chunks, std::string* error) {
+  std::string tempPath = path + "." + std::to_string(tempCounter.fetch_add(1)) + ".tmp";
+  int fd = OpenForWrite(tempPath);
+
+  if (fd < 0) {
+    *error = ErrorMessage("cannot open", tempPath);
+
+    return false;
+  }
+
+  bool written = WriteChunks(fd, chunks) && SyncFile(fd);
+
+  if (!written) *error = ErrorMessage("cannot write", tempPath);
+  if (CloseFile(fd) != 0 && written) {
+    *error = ErrorMessage("cannot close", tempPath);
+    written = false;
+  }
+  if (written && !RenameFile(tempPath, path)) {
+    *error = ErrorMessage("cannot replace", path);
+    written = false;
+  }
+  if (!written) Unlink(tempPath);
+
+  return written;
+}
+
+bool RemoveFile(const std::string& path) { return Unlink(path) == 0 || errno == ENOENT; }
+
+bool AppendFile::Open(const std::string& path, std::string* error) {
+  Close();
+  fd_ = OpenForAppend(path);
+
+  int64_t size = fd_ >= 0 ? FileSize(fd_) : -1;
+
+  if (size < 0) {
+    *error = ErrorMessage("cannot open", path);
+    Close();
+
+    return false;
+  }
+  path_ = path;
+  size_ = static_cast<uint64_t>(size);
+
+  return true;
+}
+
+bool AppendFile::Append(const std::vector<ByteSpan>& chunks, std::string* error) {
+  if (fd_ < 0 || !WriteChunks(fd_, chunks) || !SyncFile(fd_)) {
+    *error = ErrorMessage("cannot write", path_);
+
+    return false;
+  }
+  for (const ByteSpan& chunk : chunks) size_ += chunk.size;
+
+  return true;
+}
+
+void AppendFile::Close() {
+  if (fd_ >= 0) CloseFile(fd_);
+  fd_ = -1;
+  size_ = 0;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path, std::string* error) {
+  Close();
+
+  DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+  HANDLE file =
+      CreateFileW(WidePath(path).c_str(), GENERIC_READ, share, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  LARGE_INTEGER size;
+
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    errno = ENOENT;
+    *error = ErrorMessage("cannot open", path);
+
+    return false;
+  }
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+
+    return true;
+  }
+
+  // The view keeps the mapping and the file open after their handles are closed.
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+  if (mapping) CloseHandle(mapping);
+  CloseHandle(file);
+  if (!view) {
+    errno = ENOMEM;
+    *error = ErrorMessage("cannot map", path);
+
+    return false;
+  }
+  data_ = static_cast<const uint8_t*>(view);
+  size_ = static_cast<size_t>(size.QuadPart);
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) UnmapViewOfFile(data_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, std::string* error) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat info;
+
+  if (fd < 0 || fstat(fd, &info) != 0) {
+    *error = ErrorMessage("cannot open", path);
+    if (fd >= 0) close(fd);
+
+    return false;
+  }
+  if (info.st_size == 0) {
+    close(fd);
+
+    return true;
+  }
+
+  void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+  if (view == MAP_FAILED) {
+    *error = ErrorMessage("cannot map", path);
+    close(fd);
+
+    return false;
+  }
+  close(fd);
+  data_ = static_cast<const uint8_t*>(view);
+  size_ = static_cast<size_t>(info.st_size);
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
+
+#ifdef _WIN32
+
+bool ListDirectory(const std::string& path, std::vector<DirectoryEntry>* entries) {
+  WIN32_FIND_DATAW data;
+  HANDLE find = FindFirstFileW(WidePath(path + "\\*").c_str(), &data);
+
+  entries->clear();
+  if (find == INVALID_HANDLE_VALUE) return false;
+  do {
+    if (wcscmp(data.cFileName, L".") == 0 || wcscmp(data.cFileName, L"..") == 0) continue;
+    entries->push_back({NarrowPath(data.cFileName), (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0});
+  } while (FindNextFileW(find, &data));
+  FindClose(find);
+
+  return true;
+}
+
+bool ModifiedTime(const std::string& path, int64_t* nanoseconds) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+
+  if (!GetFileAttributesExW(WidePath(path).c_str(), GetFileExInfoStandard, &data)) return false;
+
+  // FILETIME counts 100 ns intervals since 1601.
+  int64_t ticks = static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+
+  *nanoseconds = (ticks - 116444736000000000LL) * 100;
+
+  return true;
+}
+
+#else
+
+bool ListDirectory(const std::string& path, std::vector<DirectoryEntry>* entries) {
+  DIR* directory = opendir(path.c_str());
+
+  entries->clear();
+  if (!directory) return false;
+  while (dirent* entry = readdir(directory)) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+    bool isDirectory = entry->d_type == DT_DIR;
+
+    if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN) {
+      struct stat info;
+
+      isDirectory = stat((path + "/" + entry->d_name).c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    }
+    entries->push_back({entry->d_name, isDirectory});
+  }
+  closedir(directory);
+
+  return true;
+}
+
+bool ModifiedTime(const std::string& path, int64_t* nanoseconds) {
+  struct stat info;
+
+  if (stat(path.c_str(), &info) != 0) return false;
+#ifdef __APPLE__
+  *nanoseconds = static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+  *nanoseconds = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+
+  return true;
+}
+
+#endif
+
+}  // namespace beam
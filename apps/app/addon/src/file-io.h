@@ -0,0 +1,83 @@
+// Plain file I/O shared by the bindings. Paths are UTF-8 on every platform.
+#ifndef BEAM_ADDON_FILE_IO_H_
+#define BEAM_ADDON_FILE_IO_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace beam {
+
+struct ByteSpan {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+// Writes the chunks with vectored writes to a temporary file next to `path`, flushes it to disk and renames it over
+// `path`, so readers see either the old or the new file. Returns false with a message in `error` on failure.
+bool WriteFileAtomically(const std::string& path, const std::vector<ByteSpan>& chunks, std::string* error);
+
+// Deletes a file; missing files count as deleted.
+bool RemoveFile(const std::string& path);
+
+struct DirectoryEntry {
+  std::string name;
+  bool directory = false;
+};
+
+// Lists a directory without "." and "..", following symbolic links to decide what is a directory. Returns false when
+// the directory cannot be read.
+bool ListDirectory(const std::string& path, std::vector<DirectoryEntry>* entries);
+
+// Last modification time in nanoseconds since the epoch; false when the path does not exist.
+bool ModifiedTime(const std::string& path, int64_t* nanoseconds);
+
+// Write end of an append-only log.
+class AppendFile {
+ public:
+  AppendFile() = default;
+  ~AppendFile() { Close(); }
+
+  AppendFile(const AppendFile&) = delete;
+  AppendFile& operator=(const AppendFile&) = delete;
+
+  // Opens `path` for appending, creating it when missing.
+  bool Open(const std::string& path, std::string* error);
+  // Appends the chunks and flushes them to disk.
+  bool Append(const std::vector<ByteSpan>& chunks, std::string* error);
+  void Close();
+
+  uint64_t Size() const { return size_; }
+
+ private:
+  std::string path_;
+  int fd_ = -1;
+  uint64_t size_ = 0;
+};
+
+// Read-only memory map of a whole file; pages are read from disk on first access. Files replaced through
+// WriteFileAtomically keep their old contents mapped, but a file truncated in place by another program faults on
+// access. On Windows the mapping also keeps the file from being replaced until Close().
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::string& path, std::string* error);
+  void Close();
+
+  const uint8_t* Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_FILE_IO_H_
@@ -0,0 +1,236 @@
+#include "flatten.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "path-buffer.h"
+
+namespace beam {
+
+namespace {
+
+// Keeps a single huge curve with a tiny tolerance from exhausting memory.
+constexpr int kMaxCurveSegments = 1 << 14;
+// Arcs are never approximated by chords spanning more than a quarter turn, even with a loose tolerance.
+constexpr double kMaxArcStep = kPi / 2;
+
+int ClampSegmentCount(double count) {
+  if (!(count > 1)) return 1;
+
+  return count >= kMaxCurveSegments ? kMaxCurveSegments : static_cast<int>(std::ceil(count));
+}
+
+Vec2 EllipsePoint(Vec2 center, double rx, double ry, double cosRotation, double sinRotation, double angle) {
+  double x = rx * std::cos(angle);
+  double y = ry * std::sin(angle);
+
+  return {center.x + cosRotation * x - sinRotation * y, center.y + sinRotation * x + cosRotation * y};
+}
+
+double VectorAngle(Vec2 u, Vec2 v) { return std::atan2(Cross(u, v), Dot(u, v)); }
+
+}  // namespace
+
+void Polylines::EndSubpath(bool isClosed) {
+  size_t start = offsets.back();
+  size_t count = PointCount();
+
+  if (count - start >= 2) {
+    offsets.push_back(static_cast<uint32_t>(count));
+    closed.push_back(isClosed ? 1 : 0);
+  } else {
+    points.resize(start * 2);
+  }
+}
+
+int CubicSegmentCount(Vec2 p0, Vec2 p1, Vec2 p2, Vec2 p3, double tolerance) {
+  Vec2 d1 = p0 - p1 * 2 + p2;
+  Vec2 d2 = p1 - p2 * 2 + p3;
+  double m = std::max(Length(d1), Length(d2));
+
+  return ClampSegmentCount(std::sqrt(0.75 * m / tolerance));
+}
+
+int QuadraticSegmentCount(Vec2 p0, Vec2 p1, Vec2 p2, double tolerance) {
+  double m = Length(p0 - p1 * 2 + p2);
+
+  return ClampSegmentCount(std::sqrt(0.25 * m / tolerance));
+}
+
+int ArcSegmentCount(double radius, double sweep, double tolerance) {
+  double step = tolerance < radius ? 2 * std::acos(1 - tolerance / radius) : kMaxArcStep;
+
+  return ClampSegmentCount(std::fabs(sweep) / std::min(step, kMaxArcStep));
+}
+
+void FlattenCubic(Vec2 p0, Vec2 p1, Vec2 p2, Vec2 p3, double tolerance, Polylines& out) {
+  int count = CubicSegmentCount(p0, p1, p2, p3, tolerance);
+
+  for (int i = 1; i < count; i += 1) {
+    double t = static_cast<double>(i) / count;
+    double mt = 1 - t;
+    double a = mt * mt * mt;
+    double b = 3 * t * mt * mt;
+    double c = 3 * t * t * mt;
+    double d = t * t * t;
+
+    out.Add({a * p0.x + b * p1.x + c * p2.x + d * p3.x, a * p0.y + b * p1.y + c * p2.y + d * p3.y});
+  }
+  out.Add(p3);
+}
+
+void FlattenQuadratic(Vec2 p0, Vec2 p1, Vec2 p2, double tolerance, Polylines& out) {
+  int count = QuadraticSegmentCount(p0, p1, p2, tolerance);
+
+  for (int i = 1; i < count; i += 1) {
+    double t = static_cast<double>(i) / count;
+    double mt = 1 - t;
+
+    out.Add({mt * mt * p0.x + 2 * mt * t * p1.x + t * t * p2.x, mt * mt * p0.y + 2 * mt * t * p1.y + t * t * p2.y});
+  }
+  out.Add(p2);
+}
+
+void FlattenEllipticalArc(Vec2 center, double rx, double ry, double rotation, double startAngle, double sweep,
+                          double tolerance, Polylines& out) {
+  int count = ArcSegmentCount(std::max(std::fabs(rx), std::fabs(ry)), sweep, tolerance);
+  double cosRotation = std::cos(rotation);
+  double sinRotation = std::sin(rotation);
+
+  for (int i = 1; i <= count; i += 1) {
+    out.Add(EllipsePoint(center, rx, ry, cosRotation, sinRotation, startAngle + sweep * i / count));
+  }
+}
+
+// Endpoint to center conversion from the SVG implementation notes (F.6.5 and F.6.6).
+bool SvgArcToCenter(Vec2 from, double rx, double ry, double rotationDeg, bool largeArc, bool sweep, Vec2 to,
+                    EllipseArc* arc) {
+  rx = std::fabs(rx);
+  ry = std::fabs(ry);
+  if ((from.x == to.x && from.y == to.y) || rx == 0 || ry == 0) return false;
+
+  double rotation = rotationDeg * kPi / 180;
+  double cosRotation = std::cos(rotation);
+  double sinRotation = std::sin(rotation);
+  double dx2 = (from.x - to.x) / 2;
+  double dy2 = (from.y - to.y) / 2;
+  double x1p = cosRotation * dx2 + sinRotation * dy2;
+  double y1p = -sinRotation * dx2 + cosRotation * dy2;
+  double lambda = (x1p * x1p) / (rx * rx) + (y1p * y1p) / (ry * ry);
+
+  if (lambda > 1) {
+    rx *= std::sqrt(lambda);
+    ry *= std::sqrt(lambda);
+  }
+
+  double rx2 = rx * rx;
+  double ry2 = ry * ry;
+  double numerator = rx2 * ry2 - rx2 * y1p * y1p - ry2 * x1p * x1p;
+  double denominator = rx2 * y1p * y1p + ry2 * x1p * x1p;
+  double coef = (largeArc != sweep ? 1 : -1) * std::sqrt(std::max(0.0, numerator / denominator));
+  double cxp = coef * rx * y1p / ry;
+  double cyp = -coef * ry * x1p / rx;
+  double sweepAngle = VectorAngle({(x1p - cxp) / rx, (y1p - cyp) / ry}, {(-x1p - cxp) / rx, (-y1p - cyp) / ry});
+
+  if (!sweep && sweepAngle > 0) sweepAngle -= 2 * kPi;
+  if (sweep && sweepAngle < 0) sweepAngle += 2 * kPi;
+  arc->center = {cosRotation * cxp - sinRotation * cyp + (from.x + to.x) / 2,
+                 sinRotation * cxp + cosRotation * cyp + (from.y + to.y) / 2};
+  arc->rx = rx;
+  arc->ry = ry;
+  arc->rotation = rotation;
+  arc->startAngle = VectorAngle({1, 0}, {(x1p - cxp) / rx, (y1p - cyp) / ry});
+  arc->sweep = sweepAngle;
+
+  return true;
+}
+
+void FlattenSvgArc(Vec2 from, double rx, double ry, double rotationDeg, bool largeArc, bool sweep, Vec2 to,
+                   double tolerance, Polylines& out) {
+  if (from.x == to.x && from.y == to.y) return;
+
+  EllipseArc arc;
+
+  if (!SvgArcToCenter(from, rx, ry, rotationDeg, largeArc, sweep, to, &arc)) {
+    out.Add(to);
+
+    return;
+  }
+
+  double cosRotation = std::cos(arc.rotation);
+  double sinRotation = std::sin(arc.rotation);
+  int count = ArcSegmentCount(std::max(arc.rx, arc.ry), arc.sweep, tolerance);
+
+  for (int i = 1; i < count; i += 1) {
+    out.Add(EllipsePoint(arc.center, arc.rx, arc.ry, cosRotation, sinRotation, arc.startAngle + arc.sweep * i / count));
+  }
+  // Emit the exact end point so consecutive segments join without drift.
+  out.Add(to);
+}
+
+void FlattenPath(const uint8_t* commands, size_t commandCount, const double* coords, double tolerance,
+                 Polylines& out) {
+  Vec2 current = {0, 0};
+  Vec2 start = {0, 0};
+  bool open = false;
+
+  for (size_t i = 0; i < commandCount; i += 1) {
+    const double* c = coords;
+    uint8_t command = commands[i];
+
+    coords += kPathCommandArity[command];
+    if (command == kMoveTo) {
+      if (open) out.EndSubpath(false);
+      current = start = {c[0], c[1]};
+      out.Add(current);
+      open = true;
+      continue;
+    }
+    if (command == kClose) {
+      if (!open) continue;
+      if (current.x != start.x || current.y != start.y) out.Add(start);
+      out.EndSubpath(true);
+      current = start;
+      open = false;
+      continue;
+    }
+    // Drawing after a close without a new moveTo continues from the subpath start, as in SVG.
+    if (!open) {
+      out.Add(current);
+      start = current;
+      open = true;
+    }
+
+    switch (command) {
+      case kLineTo:
+        current = {c[0], c[1]};
+        out.Add(current);
+        break;
+      case kQuadTo:
+        FlattenQuadratic(current, {c[0], c[1]}, {c[2], c[3]}, tolerance, out);
+        current = {c[2], c[3]};
+        break;
+      case kCubicTo:
+        FlattenCubic(current, {c[0], c[1]}, {c[2], c[3]}, {c[4], c[5]}, tolerance, out);
+        current = {c[4], c[5]};
+        break;
+      case kArcTo:
+        FlattenSvgArc(current, c[0], c[1], c[2], c[3] != 0, c[4] != 0, {c[5], c[6]}, tolerance, out);
+        current = {c[5], c[6]};
+        break;
+      default:
+        break;
+    }
+  }
+  if (open) out.EndSubpath(false);
+}
+
+void AppendPolylines(Polylines& into, const Polylines& from) {
+  uint32_t base = static_cast<uint32_t>(into.PointCount());
+
+  into.points.insert(into.points.end(), from.points.begin(), from.points.end());
+  for (size_t i = 1; i < from.offsets.size(); i += 1) into.offsets.push_back(base + from.offsets[i]);
+  into.closed.insert(into.closed.end(), from.closed.begin(), from.closed.end());
+}
+
+}  // namespace beam
@@ -0,0 +1,69 @@
+// Curve flattening to a chord tolerance: every emitted chord stays within `tolerance` of the true curve.
+#ifndef BEAM_ADDON_FLATTEN_H_
+#define BEAM_ADDON_FLATTEN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vec2.h"
+
+namespace beam {
+
+// Flattened polylines: xy pairs with subpath boundaries as point indices ([0, n0, n0 + n1, ...]).
+struct Polylines {
+  std::vector<double> points;
+  std::vector<uint32_t> offsets{0};
+  std::vector<uint8_t> closed;
+
+  size_t PointCount() const { return points.size() / 2; }
+  void Add(Vec2 p) {
+    points.push_back(p.x);
+    points.push_back(p.y);
+  }
+  // Ends the current subpath; subpaths with fewer than two points are dropped.
+  void EndSubpath(bool isClosed);
+};
+
+// Number of uniform steps needed so a cubic/quadratic stays within tolerance (Wang's formula).
+int CubicSegmentCount(Vec2 p0, Vec2 p1, Vec2 p2, Vec2 p3, double tolerance);
+int QuadraticSegmentCount(Vec2 p0, Vec2 p1, Vec2 p2, double tolerance);
+int ArcSegmentCount(double radius, double sweep, double tolerance);
+
+// Append points after p0 (p0 itself is assumed to be already emitted).
+void FlattenCubic(Vec2 p0, Vec2 p1, Vec2 p2, Vec2 p3, double tolerance, Polylines& out);
+void FlattenQuadratic(Vec2 p0, Vec2 p1, Vec2 p2, double tolerance, Polylines& out);
+
+// Elliptical arc in center parameterization; angles in radians, a negative sweep runs towards decreasing angles.
+struct EllipseArc {
+  Vec2 center;
+  double rx;
+  double ry;
+  double rotation;
+  double startAngle;
+  double sweep;
+};
+
+// Appends points after the start point of the arc given by the EllipseArc fields.
+void FlattenEllipticalArc(Vec2 center, double rx, double ry, double rotation, double startAngle, double sweep,
+                          double tolerance, Polylines& out);
+
+// Converts an SVG A command to center parameterization, scaling out-of-range radii up as SVG does. Returns false
+// when the arc is drawn as a straight line (a zero radius) or not at all (end point equals start point).
+bool SvgArcToCenter(Vec2 from, double rx, double ry, double rotationDeg, bool largeArc, bool sweep, Vec2 to,
+                    EllipseArc* arc);
+
+// Elliptical arc in SVG endpoint parameterization (the A command), including the out-of-range radii correction.
+void FlattenSvgArc(Vec2 from, double rx, double ry, double rotationDeg, bool largeArc, bool sweep, Vec2 to,
+                   double tolerance, Polylines& out);
+
+// Flattens a packed path (see path-buffer.h); each moveTo starts a new polyline.
+void FlattenPath(const uint8_t* commands, size_t commandCount, const double* coords, double tolerance,
+                 Polylines& out);
+
+// Appends all subpaths of `from` to `into`, rebasing the offsets.
+void AppendPolylines(Polylines& into, const Polylines& from);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_FLATTEN_H_
@@ -0,0 +1,587 @@
+#include "font-index.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "xxhash.h"
+
+namespace beam {
+
+namespace {
+
+// Image layout, in little-endian 32-bit words:
+//
+//   header       magic, version, root count, directory count, face count, family buckets, PostScript buckets,
+//                string pool bytes, 4 reserved
+//   roots        per root: string
+//   directories  per directory: string, modification time (low word, high word)
+//   faces        per face: path, PostScript name, family, style (strings), face index, directory, weight | width << 16,
+//                flags (1 italic, 2 monospace)
+//   families     per bucket: first face + 1 (0 when empty), face count
+//   postscript   per bucket: face + 1 (0 when empty)
+//   strings      UTF-8 bytes
+//
+// A string is two words: byte offset into the pool and length. Faces are sorted by family so each family is one run.
+constexpr uint32_t kMagic = 0x49465842;  // "BXFI"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderWords = 12;
+constexpr size_t kRootWords = 2;
+constexpr size_t kDirectoryWords = 4;
+constexpr size_t kFaceWords = 12;
+constexpr size_t kFamilyWords = 2;
+constexpr uint32_t kItalic = 1;
+constexpr uint32_t kMonospace = 2;
+
+// Modification time recorded for a root that does not exist, so the index notices when it appears.
+constexpr int64_t kMissing = INT64_MIN;
+// Symbolic links can make directory cycles; real font trees are a few levels deep.
+constexpr int kMaxDepth = 16;
+
+struct ScannedDirectory {
+  std::string path;
+  int64_t modified;
+};
+
+uint32_t HashOf(std::string_view text) { return static_cast<uint32_t>(Xxh64(text.data(), text.size())); }
+
+uint32_t BucketCount(size_t keys) {
+  uint32_t buckets = 1;
+
+  while (buckets < 2 * keys) buckets <<= 1;
+
+  return buckets;
+}
+
+bool IsFontFile(const std::string& name) {
+  size_t dot = name.rfind('.');
+
+  if (dot == std::string::npos) return false;
+
+  std::string extension = name.substr(dot + 1);
+
+  for (char& c : extension) c = static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+
+  return extension == "ttf" || extension == "otf" || extension == "ttc" || extension == "otc";
+}
+
+std::string JoinPath(const std::string& directory, const std::string& name) {
+  if (!directory.empty() && (directory.back() == '/' || directory.back() == '\\')) return directory + name;
+
+  return directory + "/" + name;
+}
+
+class ImageWriter {
+ public:
+  void Word(uint32_t value) {
+    uint8_t bytes[4] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+                        static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+
+    words_.insert(words_.end(), bytes, bytes + 4);
+  }
+
+  // Identical strings (a collection's path, a family's name) are stored once.
+  void String(const std::string& text) {
+    auto found = offsets_.find(text);
+    uint32_t offset;
+
+    if (found != offsets_.end()) {
+      offset = found->second;
+    } else {
+      offset = static_cast<uint32_t>(pool_.size());
+      offsets_.emplace(text, offset);
+      pool_.insert(pool_.end(), text.begin(), text.end());
+    }
+    Word(offset);
+    Word(static_cast<uint32_t>(text.size()));
+  }
+
+  void SetWord(size_t index, uint32_t value) {
+    for (int k = 0; k < 4; k += 1) words_[4 * index + k] = static_cast<uint8_t>(value >> (8 * k));
+  }
+
+  size_t PoolSize() const { return pool_.size(); }
+
+  std::vector<uint8_t> Finish() {
+    words_.insert(words_.end(), pool_.begin(), pool_.end());
+
+    return std::move(words_);
+  }
+
+ private:
+  std::vector<uint8_t> words_;
+  std::vector<uint8_t> pool_;
+  std::unordered_map<std::string, uint32_t> offsets_;
+};
+
+std::vector<uint8_t> WriteImage(const std::vector<std::string>& roots, const std::vector<ScannedDirectory>& directories,
+                                std::vector<FontFace>* faces) {
+  std::sort(faces->begin(), faces->end(), [](const FontFace& a, const FontFace& b) {
+    return std::tie(a.family, a.style, a.path, a.index) < std::tie(b.family, b.style, b.path, b.index);
+  });
+
+  ImageWriter writer;
+  std::vector<std::pair<uint32_t, uint32_t>> familyRuns;
+
+  for (uint32_t i = 0; i < faces->size(); i += 1) {
+    if (i == 0 || (*faces)[i].family != (*faces)[i - 1].family) familyRuns.push_back({i, 0});
+    familyRuns.back().second += 1;
+  }
+
+  uint32_t familyBuckets = BucketCount(familyRuns.size());
+  uint32_t postscriptBuckets = BucketCount(faces->size());
+  std::vector<uint32_t> families(2 * static_cast<size_t>(familyBuckets), 0);
+  std::vector<uint32_t> postscriptNames(postscriptBuckets, 0);
+
+  for (const auto& run : familyRuns) {
+    uint32_t bucket = HashOf((*faces)[run.first].family) & (familyBuckets - 1);
+
+    while (families[2 * bucket]) bucket = (bucket + 1) & (familyBuckets - 1);
+    families[2 * bucket] = run.first + 1;
+    families[2 * bucket + 1] = run.second;
+  }
+  for (uint32_t i = 0; i < faces->size(); i += 1) {
+    const std::string& name = (*faces)[i].postscriptName;
+    uint32_t bucket = HashOf(name) & (postscriptBuckets - 1);
+    bool duplicate = false;
+
+    // The same face installed twice keeps its first (sorted) copy.
+    while (postscriptNames[bucket] && !duplicate) {
+      duplicate = (*faces)[postscriptNames[bucket] - 1].postscriptName == name;
+      bucket = (bucket + 1) & (postscriptBuckets - 1);
+    }
+    if (!duplicate && !name.empty()) postscriptNames[bucket] = i + 1;
+  }
+
+  for (uint32_t value : {kMagic, kVersion, static_cast<uint32_t>(roots.size()),
+                         static_cast<uint32_t>(directories.size()), static_cast<uint32_t>(faces->size()),
+                         familyBuckets, postscriptBuckets, 0u, 0u, 0u, 0u, 0u}) {
+    writer.Word(value);
+  }
+  for (const std::string& root : roots) writer.String(root);
+  for (const ScannedDirectory& directory : directories) {
+    writer.String(directory.path);
+    writer.Word(static_cast<uint32_t>(static_cast<uint64_t>(directory.modified)));
+    writer.Word(static_cast<uint32_t>(static_cast<uint64_t>(directory.modified) >> 32));
+  }
+  for (const FontFace& face : *faces) {
+    writer.String(face.path);
+    writer.String(face.postscriptName);
+    writer.String(face.family);
+    writer.String(face.style);
+    writer.Word(face.index);
+    writer.Word(face.directory);
+    writer.Word(face.weight | static_cast<uint32_t>(face.width) << 16);
+    writer.Word((face.italic ? kItalic : 0) | (face.monospace ? kMonospace : 0));
+  }
+  for (uint32_t value : families) writer.Word(value);
+  for (uint32_t value : postscriptNames) writer.Word(value);
+  writer.SetWord(7, static_cast<uint32_t>(writer.PoolSize()));
+
+  return writer.Finish();
+}
+
+// Walks the font directories, reusing the faces of directories the previous index saw with the same modification
+// time; a changed directory has its font files read again.
+class Scanner {
+ public:
+  // Groups the previous index's faces by directory.
+  explicit Scanner(const FontIndex& previous) {
+    std::vector<std::vector<FontFace>*> byDirectory;
+
+    for (uint32_t i = 0; i < previous.DirectoryCount(); i += 1) {
+      auto& entry = previousFaces_[std::string(previous.DirectoryPath(i))];
+
+      entry.first = previous.DirectoryModified(i);
+      byDirectory.push_back(&entry.second);
+    }
+    for (uint32_t i = 0; i < previous.FaceCount(); i += 1) {
+      FontFaceView view = previous.Face(i);
+      FontFace face;
+
+      face.path = std::string(view.path);
+      face.index = view.index;
+      face.postscriptName = std::string(view.postscriptName);
+      face.family = std::string(view.family);
+      face.style = std::string(view.style);
+      face.weight = view.weight;
+      face.width = view.width;
+      face.italic = view.italic;
+      face.monospace = view.monospace;
+      byDirectory[view.directory]->push_back(std::move(face));
+    }
+  }
+
+  void Scan(const std::string& path, int depth) {
+    if (depth > kMaxDepth || !visited_.insert(path).second) return;
+
+    int64_t modified;
+    std::vector<DirectoryEntry> entries;
+
+    if (!ModifiedTime(path, &modified) || !ListDirectory(path, &entries)) {
+      if (depth == 0) directories.push_back({path, kMissing});
+
+      return;
+    }
+
+    uint32_t index = static_cast<uint32_t>(directories.size());
+    auto reused = previousFaces_.find(path);
+    bool reuse = reused != previousFaces_.end() && reused->second.first == modified;
+    std::vector<std::string> subdirectories;
+
+    directories.push_back({path, modified});
+    std::sort(entries.begin(), entries.end(),
+              [](const DirectoryEntry& a, const DirectoryEntry& b) { return a.name < b.name; });
+    for (const DirectoryEntry& entry : entries) {
+      std::string full = JoinPath(path, entry.name);
+
+      if (entry.directory) {
+        subdirectories.push_back(std::move(full));
+      } else if (!reuse && IsFontFile(entry.name)) {
+        MappedFile file;
+        std::string error;
+
+        if (file.Open(full, &error)) ReadFontFaces({file.Data(), file.Size()}, full, index, &faces);
+      }
+    }
+    if (reuse) {
+      for (FontFace& face : reused->second.second) {
+        face.directory = index;
+        faces.push_back(std::move(face));
+      }
+    }
+    for (const std::string& subdirectory : subdirectories) Scan(subdirectory, depth + 1);
+  }
+
+  std::vector<ScannedDirectory> directories;
+  std::vector<FontFace> faces;
+
+ private:
+  std::unordered_set<std::string> visited_;
+  std::unordered_map<std::string, std::pair<int64_t, std::vector<FontFace>>> previousFaces_;
+};
+
+}  // namespace
+
+bool ReadFontFaces(FontSpan file, const std::string& path, uint32_t directory, std::vector<FontFace>* faces) {
+  std::vector<size_t> directories = FontFaceDirectories(file);
+
+  for (size_t i = 0; i < directories.size(); i += 1) {
+    FontNames names = ReadFontNames(FindFontTable(file, directories[i], "name"));
+    FontSpan os2 = FindFontTable(file, directories[i], "OS/2");
+    FontSpan head = FindFontTable(file, directories[i], "head");
+    FontSpan post = FindFontTable(file, directories[i], "post");
+    uint16_t macStyle = head.U16(44);
+    FontFace face;
+
+    if (names.family.empty()) continue;
+    face.path = path;
+    face.index = static_cast<uint32_t>(i);
+    face.postscriptName = std::move(names.postscript);
+    face.family = std::move(names.family);
+    face.style = std::move(names.subfamily);
+    face.directory = directory;
+    if (os2.size >= 64) {
+      // fsSelection bit 0 is italic and bit 9 oblique.
+      face.weight = os2.U16(4);
+      face.width = os2.U16(6);
+      face.italic = (os2.U16(62) & 0x201) != 0;
+    } else {
+      face.weight = macStyle & 1 ? 700 : 400;
+      face.italic = (macStyle & 2) != 0;
+    }
+    face.monospace = post.U32(12) != 0;
+    faces->push_back(std::move(face));
+  }
+
+  return !directories.empty();
+}
+
+std::vector<std::string> DefaultFontDirectories() {
+  std::vector<std::string> directories;
+  const char* home = getenv("HOME");
+
+#if defined(_WIN32)
+  const char* windows = getenv("WINDIR");
+  const char* localAppData = getenv("LOCALAPPDATA");
+
+  directories.push_back(std::string(windows ? windows : "C:\\Windows") + "\\Fonts");
+  if (localAppData) directories.push_back(std::string(localAppData) + "\\Microsoft\\Windows\\Fonts");
+#elif defined(__APPLE__)
+  directories.push_back("/System/Library/Fonts");
+  directories.push_back("/Library/Fonts");
+  directories.push_back("/Network/Library/Fonts");
+  if (home) directories.push_back(std::string(home) + "/Library/Fonts");
+#else
+  const char* dataHome = getenv("XDG_DATA_HOME");
+
+  directories.push_back("/usr/share/fonts");
+  directories.push_back("/usr/local/share/fonts");
+  if (home) directories.push_back(std::string(home) + "/.fonts");
+  if (dataHome && *dataHome) {
+    directories.push_back(std::string(dataHome) + "/fonts");
+  } else if (home) {
+    directories.push_back(std::string(home) + "/.local/share/fonts");
+  }
+#endif
+
+  return directories;
+}
+
+bool FontIndex::Build(const std::vector<std::string>& roots, const std::string& cachePath, std::string* warning) {
+  FontIndex previous;
+
+  if (!cachePath.empty() && previous.Open(cachePath) && previous.HasRoots(roots)) {
+    if (previous.Unchanged()) {
+      *this = std::move(previous);
+
+      return true;
+    }
+  } else {
+    previous = FontIndex();
+  }
+
+  Scanner scanner(previous);
+
+  for (const std::string& root : roots) scanner.Scan(root, 0);
+
+  std::vector<uint8_t> image = WriteImage(roots, scanner.directories, &scanner.faces);
+
+  if (!cachePath.empty() && !WriteFileAtomically(cachePath, {{image.data(), image.size()}}, warning)) {
+    *warning = "font index cache not saved: " + *warning;
+  }
+
+  return Adopt(std::move(image));
+}
+
+int64_t FontIndex::DirectoryModified(uint32_t i) const {
+  size_t record = directories_ + kDirectoryWords * i;
+
+  return static_cast<int64_t>(Word(record + 2) | static_cast<uint64_t>(Word(record + 3)) << 32);
+}
+
+bool FontIndex::Open(const std::string& path) {
+  std::string error;
+
+  file_.reset(new MappedFile());
+  if (!file_->Open(path, &error)) {
+    file_.reset();
+
+    return false;
+  }
+  data_ = file_->Data();
+  size_ = file_->Size();
+  if (!Validate()) {
+    file_.reset();
+    data_ = nullptr;
+    size_ = 0;
+
+    return false;
+  }
+
+  return true;
+}
+
+bool FontIndex::Adopt(std::vector<uint8_t> image) {
+  file_.reset();
+  owned_ = std::move(image);
+  data_ = owned_.data();
+  size_ = owned_.size();
+
+  return Validate();
+}
+
+uint32_t FontIndex::Word(size_t i) const {
+  const uint8_t* p = data_ + 4 * i;
+
+  return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+         static_cast<uint32_t>(p[3]) << 24;
+}
+
+std::string_view FontIndex::String(size_t word) const {
+  return {reinterpret_cast<const char*>(data_ + strings_ + Word(word)), Word(word + 1)};
+}
+
+// Checks the section sizes, every string and every table entry once, so lookups need no bounds checks.
+bool FontIndex::Validate() {
+  if (size_ < 4 * kHeaderWords || Word(0) != kMagic || Word(1) != kVersion) return false;
+  rootCount_ = Word(2);
+  directoryCount_ = Word(3);
+  faceCount_ = Word(4);
+  familyBuckets_ = Word(5);
+  postscriptBuckets_ = Word(6);
+  stringBytes_ = Word(7);
+  if (rootCount_ > size_ || directoryCount_ > size_ || faceCount_ > size_ || familyBuckets_ == 0 ||
+      (familyBuckets_ & (familyBuckets_ - 1)) || familyBuckets_ > size_ || postscriptBuckets_ == 0 ||
+      (postscriptBuckets_ & (postscriptBuckets_ - 1)) || postscriptBuckets_ > size_) {
+    return false;
+  }
+  roots_ = kHeaderWords;
+  directories_ = roots_ + kRootWords * rootCount_;
+  faces_ = directories_ + kDirectoryWords * directoryCount_;
+  families_ = faces_ + kFaceWords * faceCount_;
+  postscriptNames_ = families_ + kFamilyWords * familyBuckets_;
+  strings_ = 4 * (postscriptNames_ + postscriptBuckets_);
+  if (strings_ + stringBytes_ != size_) return false;
+
+  auto validString = [this](size_t word) {
+    return Word(word) <= stringBytes_ && Word(word + 1) <= stringBytes_ - Word(word);
+  };
+
+  for (uint32_t i = 0; i < rootCount_; i += 1) {
+    if (!validString(roots_ + kRootWords * i)) return false;
+  }
+  for (uint32_t i = 0; i < directoryCount_; i += 1) {
+    if (!validString(directories_ + kDirectoryWords * i)) return false;
+  }
+  for (uint32_t i = 0; i < faceCount_; i += 1) {
+    size_t record = faces_ + kFaceWords * i;
+
+    for (size_t k = 0; k < 8; k += 2) {
+      if (!validString(record + k)) return false;
+    }
+    if (Word(record + 9) >= directoryCount_) return false;
+  }
+  for (uint32_t i = 0; i < familyBuckets_; i += 1) {
+    uint32_t first = Word(families_ + kFamilyWords * i);
+    uint32_t count = Word(families_ + kFamilyWords * i + 1);
+
+    if (first > faceCount_ || (first && count > faceCount_ - (first - 1))) return false;
+  }
+  for (uint32_t i = 0; i < postscriptBuckets_; i += 1) {
+    if (Word(postscriptNames_ + i) > faceCount_) return false;
+  }
+
+  return true;
+}
+
+bool FontIndex::HasRoots(const std::vector<std::string>& roots) const {
+  if (roots.size() != rootCount_) return false;
+  for (uint32_t i = 0; i < rootCount_; i += 1) {
+    if (String(roots_ + kRootWords * i) != roots[i]) return false;
+  }
+
+  return true;
+}
+
+bool FontIndex::Unchanged() const {
+  for (uint32_t i = 0; i < directoryCount_; i += 1) {
+    int64_t modified;
+
+    if (!ModifiedTime(std::string(DirectoryPath(i)), &modified)) modified = kMissing;
+    if (modified != DirectoryModified(i)) return false;
+  }
+
+  return true;
+}
+
+FontFaceView FontIndex::Face(uint32_t i) const {
+  size_t record = faces_ + kFaceWords * i;
+  uint32_t metrics = Word(record + 10);
+  uint32_t flags = Word(record + 11);
+
+  return {String(record),
+          String(record + 2),
+          String(record + 4),
+          String(record + 6),
+          Word(record + 8),
+          Word(record + 9),
+          static_cast<uint16_t>(metrics),
+          static_cast<uint16_t>(metrics >> 16),
+          (flags & kItalic) != 0,
+          (flags & kMonospace) != 0};
+}
+
+void FontIndex::FamilyRange(std::string_view family, uint32_t* first, uint32_t* count) const {
+  *first = 0;
+  *count = 0;
+  if (faceCount_ == 0) return;
+
+  uint32_t bucket = HashOf(family) & (familyBuckets_ - 1);
+
+  for (uint32_t probes = 0; probes < familyBuckets_; probes += 1) {
+    uint32_t start = Word(families_ + kFamilyWords * bucket);
+
+    if (start == 0) return;
+    if (Face(start - 1).family == family) {
+      *first = start - 1;
+      *count = Word(families_ + kFamilyWords * bucket + 1);
+
+      return;
+    }
+    bucket = (bucket + 1) & (familyBuckets_ - 1);
+  }
+}
+
+int64_t FontIndex::FindPostscriptName(std::string_view name) const {
+  uint32_t bucket = HashOf(name) & (postscriptBuckets_ - 1);
+
+  for (uint32_t probes = 0; probes < postscriptBuckets_ && faceCount_ > 0; probes += 1) {
+    uint32_t face = Word(postscriptNames_ + bucket);
+
+    if (face == 0) break;
+    if (Face(face - 1).postscriptName == name) return face - 1;
+    bucket = (bucket + 1) & (postscriptBuckets_ - 1);
+  }
+
+  return -1;
+}
+
+std::vector<uint32_t> FontIndex::FindAll(const FontQuery& query) const {
+  std::vector<uint32_t> matches;
+  uint32_t first;
+  uint32_t count;
+
+  FamilyRange(query.family, &first, &count);
+  for (uint32_t i = first; i < first + count; i += 1) {
+    FontFaceView face = Face(i);
+
+    if ((!query.style.empty() && face.style != query.style) ||
+        (!query.postscriptName.empty() && face.postscriptName != query.postscriptName) ||
+        (query.weight >= 0 && face.weight != query.weight) || (query.width >= 0 && face.width != query.width) ||
+        (query.italic >= 0 && face.italic != (query.italic != 0)) ||
+        (query.monospace >= 0 && face.monospace != (query.monospace != 0))) {
+      continue;
+    }
+    matches.push_back(i);
+  }
+
+  return matches;
+}
+
+int64_t FontIndex::FindBest(const FontQuery& query) const {
+  if (!query.postscriptName.empty()) {
+    int64_t found = FindPostscriptName(query.postscriptName);
+
+    if (found >= 0) return found;
+  }
+  if (faceCount_ == 0) return -1;
+
+  uint32_t first;
+  uint32_t count;
+  std::string_view style = query.style.empty() ? "Regular" : query.style;
+
+  FamilyRange(query.family, &first, &count);
+
+  std::vector<uint32_t> match;
+  int64_t best = count > 0 ? first : 0;
+
+  for (uint32_t i = first; i < first + count; i += 1) match.push_back(i);
+  // Each filter narrows the candidates; an empty result keeps the previous best.
+  auto narrow = [&](auto keep) {
+    match.erase(std::remove_if(match.begin(), match.end(), [&](uint32_t i) { return !keep(Face(i)); }), match.end());
+    if (!match.empty()) best = match[0];
+  };
+
+  if (query.italic >= 0) narrow([&](const FontFaceView& face) { return face.italic == (query.italic != 0); });
+  narrow([&](const FontFaceView& face) { return face.style == style; });
+  if (query.weight >= 0) narrow([&](const FontFaceView& face) { return face.weight == query.weight; });
+
+  return best;
+}
+
+}  // namespace beam
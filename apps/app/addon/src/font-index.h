@@ -0,0 +1,125 @@
+// Index of the installed fonts: scans font directories, reads only the name, OS/2, head and post tables of each face
+// and keeps the result as one flat image with hash tables for family and PostScript lookups. The image is also the
+// on-disk cache format, mapped as is on the next start while the scanned directories are unchanged.
+#ifndef BEAM_ADDON_FONT_INDEX_H_
+#define BEAM_ADDON_FONT_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "file-io.h"
+#include "font.h"
+
+namespace beam {
+
+// One installed face, with the fields font-scanner reports. `index` is the face within a collection file.
+struct FontFace {
+  std::string path;
+  uint32_t index = 0;
+  std::string postscriptName;
+  std::string family;
+  std::string style;
+  uint16_t weight = 400;
+  uint16_t width = 5;
+  bool italic = false;
+  bool monospace = false;
+  // Scanned directory the file was found in.
+  uint32_t directory = 0;
+};
+
+// A face of the index; the strings point into the index image.
+struct FontFaceView {
+  std::string_view path;
+  std::string_view postscriptName;
+  std::string_view family;
+  std::string_view style;
+  uint32_t index;
+  uint32_t directory;
+  uint16_t weight;
+  uint16_t width;
+  bool italic;
+  bool monospace;
+};
+
+// Appends the faces of a font file; false when it is not a TrueType or OpenType font.
+bool ReadFontFaces(FontSpan file, const std::string& path, uint32_t directory, std::vector<FontFace>* faces);
+
+// The platform's system and per-user font directories.
+std::vector<std::string> DefaultFontDirectories();
+
+// Lookup fields; empty strings and negative numbers match anything.
+struct FontQuery {
+  std::string family;
+  std::string style;
+  std::string postscriptName;
+  int weight = -1;
+  int width = -1;
+  int italic = -1;
+  int monospace = -1;
+};
+
+class FontIndex {
+ public:
+  FontIndex() = default;
+  FontIndex(FontIndex&&) = default;
+  FontIndex& operator=(FontIndex&&) = default;
+
+  // Scans `roots` recursively. When `cachePath` holds an index of the same roots whose directories all kept their
+  // modification times, that file is mapped instead; otherwise only changed directories are read again and the
+  // cache is rewritten. A cache that cannot be written is reported in `warning` but does not fail the build.
+  bool Build(const std::vector<std::string>& roots, const std::string& cachePath, std::string* warning);
+
+  uint32_t FaceCount() const { return faceCount_; }
+  FontFaceView Face(uint32_t i) const;
+  // Every directory scanned, with its modification time at the time.
+  uint32_t DirectoryCount() const { return directoryCount_; }
+  std::string_view DirectoryPath(uint32_t i) const { return String(directories_ + 4 * static_cast<size_t>(i)); }
+  int64_t DirectoryModified(uint32_t i) const;
+  bool FromCache() const { return file_ != nullptr; }
+  size_t MemoryUsage() const { return owned_.size(); }
+
+  // Every face with all the set fields of `query`; a family is required.
+  std::vector<uint32_t> FindAll(const FontQuery& query) const;
+  // The face font-helper's findFontSync picks: an exact PostScript name, else the family narrowed by italic, style
+  // (default "Regular") and weight for as long as something still matches. -1 for an empty index.
+  int64_t FindBest(const FontQuery& query) const;
+  int64_t FindPostscriptName(std::string_view name) const;
+
+ private:
+  bool Open(const std::string& path);
+  bool Adopt(std::vector<uint8_t> image);
+  bool Validate();
+  uint32_t Word(size_t i) const;
+  std::string_view String(size_t word) const;
+  bool HasRoots(const std::vector<std::string>& roots) const;
+  bool Unchanged() const;
+  // Faces of a family, which are stored next to each other.
+  void FamilyRange(std::string_view family, uint32_t* first, uint32_t* count) const;
+
+  std::unique_ptr<MappedFile> file_;
+  std::vector<uint8_t> owned_;
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+
+  // Section starts in 32-bit words, and the string pool in bytes.
+  uint32_t rootCount_ = 0;
+  uint32_t directoryCount_ = 0;
+  uint32_t faceCount_ = 0;
+  uint32_t familyBuckets_ = 0;
+  uint32_t postscriptBuckets_ = 0;
+  size_t roots_ = 0;
+  size_t directories_ = 0;
+  size_t faces_ = 0;
+  size_t families_ = 0;
+  size_t postscriptNames_ = 0;
+  size_t strings_ = 0;
+  size_t stringBytes_ = 0;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_FONT_INDEX_H_
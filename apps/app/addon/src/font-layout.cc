@@ -0,0 +1,383 @@
+#include "font-layout.h"
+
+#include <algorithm>
+
+namespace beam {
+
+namespace {
+
+constexpr uint16_t kSingleSubstitution = 1;
+constexpr uint16_t kMultipleSubstitution = 2;
+constexpr uint16_t kLigatureSubstitution = 4;
+constexpr uint16_t kPairAdjustment = 2;
+
+int BitCount(uint16_t value) {
+  int count = 0;
+
+  for (; value; value &= value - 1) count += 1;
+
+  return count;
+}
+
+// Coverage index of a glyph, -1 when the table does not cover it.
+int32_t CoverageIndex(FontSpan coverage, uint16_t glyph) {
+  size_t low = 0;
+  size_t high = coverage.U16(2);
+
+  if (coverage.U16(0) == 1) {
+    while (low < high) {
+      size_t middle = (low + high) / 2;
+      uint16_t value = coverage.U16(4 + 2 * middle);
+
+      if (value == glyph) return static_cast<int32_t>(middle);
+      if (value < glyph) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+  } else if (coverage.U16(0) == 2) {
+    // Ranges of [start, end, coverage index of start], sorted by glyph.
+    while (low < high) {
+      size_t middle = (low + high) / 2;
+      size_t range = 4 + 6 * middle;
+
+      if (coverage.U16(range + 2) < glyph) {
+        low = middle + 1;
+      } else if (coverage.U16(range) > glyph) {
+        high = middle;
+      } else {
+        return coverage.U16(range + 4) + glyph - coverage.U16(range);
+      }
+    }
+  }
+
+  return -1;
+}
+
+void MarkCoverage(FontSpan coverage, std::vector<bool>* covered) {
+  uint16_t count = coverage.U16(2);
+
+  for (uint16_t i = 0; i < count; i += 1) {
+    if (coverage.U16(0) == 1) {
+      uint16_t glyph = coverage.U16(4 + 2 * i);
+
+      if (glyph < covered->size()) (*covered)[glyph] = true;
+    } else if (coverage.U16(0) == 2) {
+      size_t range = 4 + 6 * static_cast<size_t>(i);
+      size_t last = std::min<size_t>(coverage.U16(range + 2), covered->size() - 1);
+
+      for (size_t glyph = coverage.U16(range); glyph <= last; glyph += 1) {
+        (*covered)[glyph] = true;
+      }
+    }
+  }
+}
+
+uint16_t GlyphClass(FontSpan classDef, uint16_t glyph) {
+  if (classDef.U16(0) == 1) {
+    uint16_t start = classDef.U16(2);
+
+    return glyph >= start && glyph - start < classDef.U16(4) ? classDef.U16(6 + 2 * (glyph - start)) : 0;
+  }
+  if (classDef.U16(0) != 2) return 0;
+
+  size_t low = 0;
+  size_t high = classDef.U16(2);
+
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    size_t range = 4 + 6 * middle;
+
+    if (classDef.U16(range + 2) < glyph) {
+      low = middle + 1;
+    } else if (classDef.U16(range) > glyph) {
+      high = middle;
+    } else {
+      return classDef.U16(range + 4);
+    }
+  }
+
+  return 0;
+}
+
+// XAdvance of a GPOS value record, the only field pair kerning uses in practice.
+int32_t XAdvance(FontSpan data, size_t record, uint16_t valueFormat) {
+  if (!(valueFormat & 4)) return 0;
+
+  return data.S16(record + 2 * BitCount(valueFormat & 3));
+}
+
+// Applies one GSUB subtable at glyph i; on success sets *next to the first glyph after the output.
+bool ApplySubstitution(uint16_t type, FontSpan subtable, GlyphRun* run, size_t i, size_t* next) {
+  std::vector<uint16_t>& glyphs = run->glyphs;
+  int32_t index = CoverageIndex(subtable.Slice(subtable.U16(2)), glyphs[i]);
+
+  if (index < 0) return false;
+
+  uint16_t format = subtable.U16(0);
+
+  if (type == kSingleSubstitution) {
+    if (format == 1) {
+      glyphs[i] = static_cast<uint16_t>(glyphs[i] + subtable.S16(4));
+    } else if (format == 2 && index < subtable.U16(4)) {
+      glyphs[i] = subtable.U16(6 + 2 * index);
+    } else {
+      return false;
+    }
+    *next = i + 1;
+
+    return true;
+  }
+  if (type == kMultipleSubstitution) {
+    if (format != 1 || index >= subtable.U16(4)) return false;
+
+    FontSpan sequence = subtable.Slice(subtable.U16(6 + 2 * index));
+    uint16_t count = sequence.U16(0);
+
+    if (count == 0) return false;
+    glyphs[i] = sequence.U16(2);
+    for (uint16_t k = 1; k < count; k += 1) glyphs.insert(glyphs.begin() + i + k, sequence.U16(2 + 2 * k));
+    run->clusters.insert(run->clusters.begin() + i + 1, count - 1, run->clusters[i]);
+    *next = i + count;
+
+    return true;
+  }
+  if (type != kLigatureSubstitution || format != 1 || index >= subtable.U16(4)) return false;
+
+  // Ligatures of a set are ordered by preference; the first whose components follow glyph i wins.
+  FontSpan ligatureSet = subtable.Slice(subtable.U16(6 + 2 * index));
+
+  for (uint16_t k = 0; k < ligatureSet.U16(0); k += 1) {
+    FontSpan ligature = ligatureSet.Slice(ligatureSet.U16(2 + 2 * k));
+    size_t components = ligature.U16(2);
+
+    if (components == 0 || i + components > glyphs.size()) continue;
+
+    size_t c = 1;
+
+    while (c < components && glyphs[i + c] == ligature.U16(4 + 2 * (c - 1))) c += 1;
+    if (c < components) continue;
+    glyphs[i] = ligature.U16(0);
+    glyphs.erase(glyphs.begin() + i + 1, glyphs.begin() + i + components);
+    run->clusters.erase(run->clusters.begin() + i + 1, run->clusters.begin() + i + components);
+    *next = i + 1;
+
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace
+
+TextShaper::TextShaper(const Font& font) : font_(font) {
+  static const char* const kSubstitutionFeatures[] = {"ccmp", "rlig", "liga", "clig"};
+  static const char* const kPositioningFeatures[] = {"kern"};
+
+  substitutions_ = ReadLookups(font.Table("GSUB"), kSubstitutionFeatures, 4, 7);
+  positioning_ = ReadLookups(font.Table("GPOS"), kPositioningFeatures, 1, 9);
+  positioning_.erase(std::remove_if(positioning_.begin(), positioning_.end(),
+                                    [](const Lookup& lookup) { return lookup.type != kPairAdjustment; }),
+                     positioning_.end());
+  if (!positioning_.empty()) return;
+
+  FontSpan kern = font.Table("kern");
+  size_t offset = 4;
+
+  if (kern.U16(0) != 0) return;
+  for (uint16_t i = 0; i < kern.U16(2) && offset < kern.size; i += 1) {
+    uint16_t length = kern.U16(offset + 2);
+    uint16_t coverage = kern.U16(offset + 4);
+
+    // Format 0, horizontal, not minimum values and not cross-stream.
+    if ((coverage >> 8) == 0 && (coverage & 7) == 1) {
+      kernPairs_ = kern.Slice(offset, length);
+
+      return;
+    }
+    if (length == 0) return;
+    offset += length;
+  }
+}
+
+std::vector<TextShaper::Lookup> TextShaper::ReadLookups(FontSpan table, const char* const* tags, size_t tagCount,
+                                                        uint16_t extensionType) const {
+  std::vector<Lookup> lookups;
+
+  if (table.size < 10) return lookups;
+
+  FontSpan scripts = table.Slice(table.U16(4));
+  FontSpan features = table.Slice(table.U16(6));
+  FontSpan lookupList = table.Slice(table.U16(8));
+  uint16_t scriptCount = scripts.U16(0);
+  size_t scriptOffset = scriptCount > 0 ? scripts.U16(6) : 0;
+
+  // The default script, else Latin, else the first one listed.
+  for (const char* preferred : {"latn", "DFLT"}) {
+    for (uint16_t i = 0; i < scriptCount; i += 1) {
+      if (scripts.U32(2 + 6 * static_cast<size_t>(i)) == FontTag(preferred)) {
+        scriptOffset = scripts.U16(6 + 6 * static_cast<size_t>(i));
+      }
+    }
+  }
+
+  FontSpan script = scripts.Slice(scriptOffset);
+  FontSpan languageSystem = script.U16(0) ? script.Slice(script.U16(0)) : FontSpan();
+  std::vector<bool> used(lookupList.U16(0), false);
+
+  for (uint16_t k = 0; k < languageSystem.U16(4); k += 1) {
+    size_t record = 2 + 6 * static_cast<size_t>(languageSystem.U16(6 + 2 * k));
+    uint32_t tag = features.U32(record);
+
+    if (std::none_of(tags, tags + tagCount, [tag](const char* wanted) { return FontTag(wanted) == tag; })) continue;
+
+    FontSpan feature = features.Slice(features.U16(record + 4));
+
+    for (uint16_t m = 0; m < feature.U16(2); m += 1) {
+      uint16_t index = feature.U16(4 + 2 * m);
+
+      if (index < used.size()) used[index] = true;
+    }
+  }
+  // Lookups apply in lookup list order, whatever order the features name them in.
+  for (size_t index = 0; index < used.size(); index += 1) {
+    if (!used[index]) continue;
+
+    FontSpan lookup = lookupList.Slice(lookupList.U16(2 + 2 * index));
+    Lookup entry = {lookup.U16(0), {}, std::vector<bool>(font_.GlyphCount(), false)};
+
+    for (uint16_t s = 0; s < lookup.U16(4); s += 1) {
+      FontSpan subtable = lookup.Slice(lookup.U16(6 + 2 * s));
+
+      if (lookup.U16(0) == extensionType && subtable.U16(0) == 1) {
+        entry.type = subtable.U16(2);
+        subtable = subtable.Slice(subtable.U32(4));
+      }
+      MarkCoverage(subtable.Slice(subtable.U16(2)), &entry.covered);
+      entry.subtables.push_back(subtable);
+    }
+    lookups.push_back(std::move(entry));
+  }
+
+  return lookups;
+}
+
+void TextShaper::Substitute(GlyphRun* run) const {
+  for (const Lookup& lookup : substitutions_) {
+    for (size_t i = 0; i < run->glyphs.size();) {
+      size_t next = i + 1;
+
+      if (!lookup.covered[run->glyphs[i]]) {
+        i = next;
+        continue;
+      }
+      for (const FontSpan& subtable : lookup.subtables) {
+        if (ApplySubstitution(lookup.type, subtable, run, i, &next)) break;
+      }
+      i = next;
+    }
+  }
+}
+
+int32_t TextShaper::PairAdjustment(uint16_t left, uint16_t right) const {
+  int32_t total = 0;
+
+  for (const Lookup& lookup : positioning_) {
+    if (!lookup.covered[left]) continue;
+    for (const FontSpan& subtable : lookup.subtables) {
+      int32_t index = CoverageIndex(subtable.Slice(subtable.U16(2)), left);
+
+      if (index < 0) continue;
+
+      uint16_t format1 = subtable.U16(4);
+      uint16_t format2 = subtable.U16(6);
+      size_t valueSize = 2 * static_cast<size_t>(BitCount(format1) + BitCount(format2));
+
+      if (subtable.U16(0) == 1) {
+        if (index >= subtable.U16(8)) continue;
+
+        // Pair records sorted by second glyph.
+        FontSpan pairSet = subtable.Slice(subtable.U16(10 + 2 * index));
+        size_t recordSize = 2 + valueSize;
+        size_t low = 0;
+        size_t high = pairSet.U16(0);
+
+        while (low < high) {
+          size_t middle = (low + high) / 2;
+          uint16_t second = pairSet.U16(2 + middle * recordSize);
+
+          if (second < right) {
+            low = middle + 1;
+          } else {
+            high = middle;
+          }
+        }
+        if (low == pairSet.U16(0) || pairSet.U16(2 + low * recordSize) != right) continue;
+        total += XAdvance(pairSet, 4 + low * recordSize, format1);
+        break;
+      }
+      if (subtable.U16(0) == 2) {
+        uint16_t class1 = GlyphClass(subtable.Slice(subtable.U16(8)), left);
+        uint16_t class2 = GlyphClass(subtable.Slice(subtable.U16(10)), right);
+        uint16_t class2Count = subtable.U16(14);
+
+        if (class1 >= subtable.U16(12) || class2 >= class2Count) break;
+        total += XAdvance(subtable, 16 + (static_cast<size_t>(class1) * class2Count + class2) * valueSize, format1);
+        break;
+      }
+    }
+  }
+
+  return total;
+}
+
+int32_t TextShaper::LegacyKerning(uint16_t left, uint16_t right) const {
+  uint32_t key = static_cast<uint32_t>(left) << 16 | right;
+  size_t low = 0;
+  size_t high = kernPairs_.U16(6);
+
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    uint32_t pair = kernPairs_.U32(14 + 6 * middle);
+
+    if (pair == key) return kernPairs_.S16(18 + 6 * middle);
+    if (pair < key) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return 0;
+}
+
+void TextShaper::Shape(const uint16_t* text, size_t length, const LayoutOptions& options, GlyphRun* run) const {
+  run->Clear();
+  for (size_t i = 0; i < length; i += 1) {
+    uint32_t cluster = static_cast<uint32_t>(i);
+    uint32_t unit = text[i];
+    uint16_t glyph = 0;
+
+    if (unit >= 0xD800 && unit < 0xDC00 && i + 1 < length && text[i + 1] >= 0xDC00 && text[i + 1] < 0xE000) {
+      glyph = font_.GlyphForCodePoint(0x10000 + ((unit - 0xD800) << 10) + (text[i + 1] - 0xDC00));
+      i += 1;
+    } else if (unit < 0xD800 || unit >= 0xE000) {
+      glyph = font_.GlyphForCodePoint(unit);
+    }
+    run->glyphs.push_back(glyph);
+    run->clusters.push_back(cluster);
+  }
+  if (options.ligatures) Substitute(run);
+  run->advances.resize(run->glyphs.size());
+  for (size_t i = 0; i < run->glyphs.size(); i += 1) run->advances[i] = font_.AdvanceWidth(run->glyphs[i]);
+  if (!options.kerning || (positioning_.empty() && kernPairs_.Empty())) return;
+  for (size_t i = 0; i + 1 < run->glyphs.size(); i += 1) {
+    uint16_t left = run->glyphs[i];
+    uint16_t right = run->glyphs[i + 1];
+
+    run->advances[i] += positioning_.empty() ? LegacyKerning(left, right) : PairAdjustment(left, right);
+  }
+}
+
+}  // namespace beam
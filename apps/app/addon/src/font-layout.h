@@ -0,0 +1,68 @@
+// Left-to-right text layout for one font: character mapping, the GSUB ligature features and pair kerning from GPOS or
+// the legacy kern table. Complex-script shaping (reordering, mark attachment, bidi) is out of scope.
+#ifndef BEAM_ADDON_FONT_LAYOUT_H_
+#define BEAM_ADDON_FONT_LAYOUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "font.h"
+
+namespace beam {
+
+struct LayoutOptions {
+  bool kerning = true;
+  // Standard ligatures and glyph composition: the ccmp, rlig, liga and clig features.
+  bool ligatures = true;
+};
+
+struct GlyphRun {
+  std::vector<uint16_t> glyphs;
+  // UTF-16 index of the first character each glyph came from; ligatures take the index of their first character.
+  std::vector<uint32_t> clusters;
+  // Advance widths in font units with kerning applied.
+  std::vector<int32_t> advances;
+
+  void Clear() {
+    glyphs.clear();
+    clusters.clear();
+    advances.clear();
+  }
+};
+
+class TextShaper {
+ public:
+  // Collects the lookups once; the shaper keeps a pointer to `font`.
+  explicit TextShaper(const Font& font);
+
+  // Lays out UTF-16 text into `run` (cleared first). Lone surrogates map to .notdef.
+  void Shape(const uint16_t* text, size_t length, const LayoutOptions& options, GlyphRun* run) const;
+
+ private:
+  struct Lookup {
+    uint16_t type;
+    // Subtables with extension lookups already resolved.
+    std::vector<FontSpan> subtables;
+    // Union of the subtables' coverage by glyph, so uncovered glyphs skip the coverage searches.
+    std::vector<bool> covered;
+  };
+
+  // Lookups of the default script's features with the given tags, in lookup list order.
+  std::vector<Lookup> ReadLookups(FontSpan table, const char* const* tags, size_t tagCount,
+                                  uint16_t extensionType) const;
+
+  void Substitute(GlyphRun* run) const;
+  int32_t PairAdjustment(uint16_t left, uint16_t right) const;
+  int32_t LegacyKerning(uint16_t left, uint16_t right) const;
+
+  const Font& font_;
+  std::vector<Lookup> substitutions_;
+  std::vector<Lookup> positioning_;
+  // Horizontal format 0 subtable of the kern table, used when GPOS has no kerning.
+  FontSpan kernPairs_;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_FONT_LAYOUT_H_
@@ -0,0 +1,563 @@
+#include "font.h"
+
+#include <utility>
+
+#include "cff-outline.h"
+
+namespace beam {
+
+namespace {
+
+// Composite glyphs nest a few levels in practice; the limit stops reference cycles.
+constexpr int kMaxCompositeDepth = 8;
+
+// Higher is better: full Unicode before BMP-only before symbol subtables.
+int CmapScore(uint16_t platform, uint16_t encoding, uint16_t format) {
+  if (format != 0 && format != 4 && format != 6 && format != 12) return 0;
+  if (platform == 3 && encoding == 10) return 6;
+  if (platform == 0 && (encoding == 4 || encoding == 6)) return 5;
+  if (platform == 3 && encoding == 1) return 4;
+  if (platform == 0) return 3;
+  if (platform == 3 && encoding == 0) return 2;
+  if (platform == 1 && encoding == 0) return 1;
+
+  return 0;
+}
+
+void AppendUtf8(uint32_t codePoint, std::string* out) {
+  if (codePoint < 0x80) {
+    out->push_back(static_cast<char>(codePoint));
+  } else if (codePoint < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | codePoint >> 6));
+    out->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+  } else if (codePoint < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | codePoint >> 12));
+    out->push_back(static_cast<char>(0x80 | (codePoint >> 6 & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | codePoint >> 18));
+    out->push_back(static_cast<char>(0x80 | (codePoint >> 12 & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (codePoint >> 6 & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+  }
+}
+
+// Windows names are UTF-16BE, Macintosh Roman names are taken as Latin-1.
+std::string DecodeName(FontSpan bytes, bool utf16) {
+  std::string name;
+
+  if (!utf16) {
+    for (size_t i = 0; i < bytes.size; i += 1) AppendUtf8(bytes.data[i], &name);
+
+    return name;
+  }
+  for (size_t i = 0; i + 1 < bytes.size; i += 2) {
+    uint32_t unit = bytes.U16(i);
+
+    if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < bytes.size) {
+      uint32_t low = bytes.U16(i + 2);
+
+      if (low >= 0xDC00 && low < 0xE000) {
+        unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+        i += 2;
+      }
+    }
+    AppendUtf8(unit, &name);
+  }
+
+  return name;
+}
+
+double F2Dot14(FontSpan span, size_t offset) { return span.S16(offset) / 16384.0; }
+
+// Contour of on- and off-curve TrueType points as quadratics: two off-curve points in a row imply the on-curve point
+// midway between them.
+class ContourWriter {
+ public:
+  ContourWriter(const double* transform, PathBuffer* out) : transform_(transform), out_(out) {}
+
+  void Write(const int32_t* xs, const int32_t* ys, const uint8_t* flags, size_t count) {
+    size_t first = 0;
+
+    while (first < count && !(flags[first] & 1)) first += 1;
+
+    double startX;
+    double startY;
+
+    if (first < count) {
+      startX = xs[first];
+      startY = ys[first];
+    } else {
+      // No on-curve point at all: start between the last and the first control point.
+      first = 0;
+      startX = (xs[count - 1] + xs[0]) / 2.0;
+      startY = (ys[count - 1] + ys[0]) / 2.0;
+    }
+    Emit(kMoveTo, nullptr, startX, startY);
+
+    bool pending = false;
+    double controlX = 0;
+    double controlY = 0;
+    bool allOff = !(flags[first] & 1);
+
+    for (size_t k = allOff ? 0 : 1; k <= count; k += 1) {
+      bool closing = k == count;
+      size_t i = (first + k) % count;
+      double x = closing ? startX : xs[i];
+      double y = closing ? startY : ys[i];
+
+      if (closing || (flags[i] & 1)) {
+        if (pending) {
+          double control[2] = {controlX, controlY};
+
+          Emit(kQuadTo, control, x, y);
+        } else if (!closing) {
+          Emit(kLineTo, nullptr, x, y);
+        }
+        pending = false;
+      } else {
+        if (pending) {
+          double control[2] = {controlX, controlY};
+
+          Emit(kQuadTo, control, (controlX + x) / 2, (controlY + y) / 2);
+        }
+        controlX = x;
+        controlY = y;
+        pending = true;
+      }
+    }
+    out_->Close();
+  }
+
+ private:
+  void Emit(PathCommand command, const double* control, double x, double y) {
+    const double* m = transform_;
+
+    out_->commands.push_back(command);
+    if (control) {
+      out_->coords.push_back(m[0] * control[0] + m[2] * control[1] + m[4]);
+      out_->coords.push_back(m[1] * control[0] + m[3] * control[1] + m[5]);
+    }
+    out_->coords.push_back(m[0] * x + m[2] * y + m[4]);
+    out_->coords.push_back(m[1] * x + m[3] * y + m[5]);
+  }
+
+  const double* transform_;
+  PathBuffer* out_;
+};
+
+}  // namespace
+
+FontSpan FindFontTable(FontSpan file, size_t directory, const char* tag) {
+  uint32_t wanted = FontTag(tag);
+
+  for (uint16_t i = 0; i < file.U16(directory + 4); i += 1) {
+    size_t record = directory + 12 + 16 * static_cast<size_t>(i);
+
+    if (file.U32(record) == wanted) return file.Slice(file.U32(record + 8), file.U32(record + 12));
+  }
+
+  return {};
+}
+
+std::vector<size_t> FontFaceDirectories(FontSpan file) {
+  std::vector<size_t> directories;
+  uint32_t signature = file.U32(0);
+
+  if (signature == FontTag("ttcf")) {
+    for (uint32_t i = 0; i < file.U32(8) && 12 + 4 * static_cast<size_t>(i) < file.size; i += 1) {
+      size_t directory = file.U32(12 + 4 * static_cast<size_t>(i));
+      uint32_t face = file.U32(directory);
+
+      if (face == 0x00010000 || face == FontTag("true") || face == FontTag("OTTO")) directories.push_back(directory);
+    }
+  } else if (signature == 0x00010000 || signature == FontTag("true") || signature == FontTag("OTTO")) {
+    directories.push_back(0);
+  }
+
+  return directories;
+}
+
+FontNames ReadFontNames(FontSpan name) {
+  FontSpan strings = name.Slice(name.U16(4));
+  // Name IDs 1 and 2 (family, subfamily), 6 (PostScript) and 16 and 17 (typographic family and subfamily).
+  constexpr uint16_t kIds[] = {1, 2, 6, 16, 17};
+  std::string names[5];
+  int scores[5] = {0, 0, 0, 0, 0};
+
+  for (uint16_t i = 0; i < name.U16(2); i += 1) {
+    size_t record = 6 + 12 * static_cast<size_t>(i);
+    uint16_t platform = name.U16(record);
+    // Windows US English wins, then any Windows language, then Macintosh Roman.
+    int score = platform == 3 ? (name.U16(record + 4) == 0x409 ? 3 : 2) : platform == 1 && name.U16(record + 2) == 0;
+
+    for (int k = 0; k < 5; k += 1) {
+      if (name.U16(record + 6) != kIds[k] || score <= scores[k]) continue;
+      scores[k] = score;
+      names[k] = DecodeName(strings.Slice(name.U16(record + 10), name.U16(record + 8)), platform == 3);
+    }
+  }
+
+  FontNames result;
+
+  result.family = names[3].empty() ? names[0] : names[3];
+  result.subfamily = names[4].empty() ? names[1] : names[4];
+  result.postscript = names[2];
+
+  return result;
+}
+
+Font::~Font() = default;
+
+std::unique_ptr<Font> Font::Load(std::vector<uint8_t> data, uint32_t index, std::string* error) {
+  std::unique_ptr<Font> font(new Font());
+
+  font->data_ = std::move(data);
+  font->file_ = {font->data_.data(), font->data_.size()};
+  if (!font->Parse(index, error)) return nullptr;
+
+  return font;
+}
+
+FontSpan Font::Table(const char* tag) const { return FindFontTable(file_, directory_, tag); }
+
+bool Font::Parse(uint32_t index, std::string* error) {
+  uint32_t signature = file_.U32(0);
+
+  if (signature == FontTag("ttcf")) {
+    if (index >= file_.U32(8)) {
+      *error = "font index out of range";
+
+      return false;
+    }
+    directory_ = file_.U32(12 + 4 * static_cast<size_t>(index));
+    signature = file_.U32(directory_);
+  } else if (index != 0) {
+    *error = "font index out of range";
+
+    return false;
+  }
+  if (signature == FontTag("wOFF") || signature == FontTag("wOF2")) {
+    *error = "WOFF fonts are not supported";
+
+    return false;
+  }
+  if (signature != 0x00010000 && signature != FontTag("true") && signature != FontTag("OTTO")) {
+    *error = "not a TrueType or OpenType font";
+
+    return false;
+  }
+
+  FontSpan head = Table("head");
+  FontSpan hhea = Table("hhea");
+
+  if (head.size < 54 || hhea.size < 36 || Table("maxp").size < 6) {
+    *error = "font is missing its head, hhea or maxp table";
+
+    return false;
+  }
+  unitsPerEm_ = head.U16(18);
+  longLoca_ = head.S16(50) != 0;
+  glyphCount_ = Table("maxp").U16(4);
+  ascender_ = hhea.S16(4);
+  descender_ = hhea.S16(6);
+  lineGap_ = hhea.S16(8);
+  metricCount_ = hhea.U16(34);
+  hmtx_ = Table("hmtx");
+  if (unitsPerEm_ < 16 || glyphCount_ == 0) {
+    *error = "font has invalid units per em or no glyphs";
+
+    return false;
+  }
+
+  FontSpan cmap = Table("cmap");
+  int bestScore = 0;
+
+  for (uint16_t i = 0; i < cmap.U16(2); i += 1) {
+    size_t record = 4 + 8 * static_cast<size_t>(i);
+    FontSpan subtable = cmap.Slice(cmap.U32(record + 4));
+    int score = CmapScore(cmap.U16(record), cmap.U16(record + 2), subtable.U16(0));
+
+    if (score > bestScore) {
+      bestScore = score;
+      cmap_ = subtable;
+      cmapFormat_ = subtable.U16(0);
+      cmapSymbol_ = score == 2;
+    }
+  }
+
+  glyf_ = Table("glyf");
+  loca_ = Table("loca");
+  cff_ = Table("CFF ");
+  if (!cff_.Empty()) {
+    cffOutlines_.reset(new CffOutlines());
+    if (!cffOutlines_->Parse(cff_)) {
+      *error = "damaged CFF table";
+
+      return false;
+    }
+  } else if (glyf_.Empty() || loca_.Empty()) {
+    *error = Table("CFF2").Empty() ? "font has no glyph outlines" : "CFF2 fonts are not supported";
+
+    return false;
+  }
+  slots_.resize(glyphCount_);
+
+  FontNames names = ReadFontNames(Table("name"));
+
+  familyName_ = names.family;
+  subfamilyName_ = names.subfamily;
+  postscriptName_ = names.postscript;
+
+  return true;
+}
+
+uint16_t Font::GlyphForCodePoint(uint32_t codePoint) const {
+  uint32_t glyph = 0;
+
+  switch (cmapFormat_) {
+    case 0:
+      glyph = codePoint < 256 ? cmap_.U8(6 + codePoint) : 0;
+      break;
+    case 4: {
+      if (codePoint > 0xFFFF) break;
+
+      size_t segmentsX2 = cmap_.U16(6);
+      size_t low = 0;
+      size_t high = segmentsX2 / 2;
+
+      // First segment whose end code is at least the code point.
+      while (low < high) {
+        size_t middle = (low + high) / 2;
+
+        if (cmap_.U16(14 + 2 * middle) < codePoint) {
+          low = middle + 1;
+        } else {
+          high = middle;
+        }
+      }
+      if (low == segmentsX2 / 2) break;
+
+      size_t segment = 2 * low;
+      uint16_t start = cmap_.U16(16 + segmentsX2 + segment);
+      uint16_t delta = cmap_.U16(16 + 2 * segmentsX2 + segment);
+      size_t rangeOffsetPosition = 16 + 3 * segmentsX2 + segment;
+      uint16_t rangeOffset = cmap_.U16(rangeOffsetPosition);
+
+      if (codePoint < start) break;
+      if (rangeOffset == 0) {
+        glyph = (codePoint + delta) & 0xFFFF;
+      } else {
+        glyph = cmap_.U16(rangeOffsetPosition + rangeOffset + 2 * (codePoint - start));
+        if (glyph != 0) glyph = (glyph + delta) & 0xFFFF;
+      }
+      break;
+    }
+    case 6: {
+      uint32_t first = cmap_.U16(6);
+
+      if (codePoint >= first && codePoint - first < cmap_.U16(8)) glyph = cmap_.U16(10 + 2 * (codePoint - first));
+      break;
+    }
+    case 12: {
+      size_t low = 0;
+      size_t high = cmap_.U32(12);
+
+      while (low < high) {
+        size_t middle = (low + high) / 2;
+        size_t group = 16 + 12 * middle;
+
+        if (cmap_.U32(group + 4) < codePoint) {
+          low = middle + 1;
+        } else {
+          high = middle;
+        }
+      }
+
+      size_t group = 16 + 12 * low;
+
+      if (low < cmap_.U32(12) && cmap_.U32(group) <= codePoint) {
+        glyph = cmap_.U32(group + 8) + codePoint - cmap_.U32(group);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  // Symbol fonts map their characters into U+F000..U+F0FF.
+  if (glyph == 0 && cmapSymbol_ && codePoint < 0x100) return GlyphForCodePoint(0xF000 | codePoint);
+
+  return glyph < glyphCount_ ? static_cast<uint16_t>(glyph) : 0;
+}
+
+uint16_t Font::AdvanceWidth(uint16_t glyph) const {
+  if (metricCount_ == 0) return 0;
+
+  return hmtx_.U16(4 * static_cast<size_t>(glyph < metricCount_ ? glyph : metricCount_ - 1));
+}
+
+GlyphOutline Font::Outline(uint16_t glyph) {
+  if (glyph >= glyphCount_) return {};
+
+  Slot& slot = slots_[glyph];
+
+  if (slot.commandCount == UINT32_MAX) {
+    static const double kIdentity[6] = {1, 0, 0, 1, 0, 0};
+
+    slot.commandStart = static_cast<uint32_t>(cache_.commands.size());
+    slot.coordStart = static_cast<uint32_t>(cache_.coords.size());
+    if (cffOutlines_) {
+      cffOutlines_->Decode(glyph, &cache_);
+    } else {
+      DecodeTrueType(glyph, kIdentity, 0, &cache_);
+    }
+    slot.commandCount = static_cast<uint32_t>(cache_.commands.size()) - slot.commandStart;
+    slot.coordCount = static_cast<uint32_t>(cache_.coords.size()) - slot.coordStart;
+  }
+
+  return CachedOutline(glyph);
+}
+
+GlyphOutline Font::CachedOutline(uint16_t glyph) const {
+  if (glyph >= glyphCount_ || slots_[glyph].commandCount == UINT32_MAX) return {};
+
+  const Slot& slot = slots_[glyph];
+  GlyphOutline outline;
+
+  outline.commands = cache_.commands.data() + slot.commandStart;
+  outline.commandCount = slot.commandCount;
+  outline.coords = cache_.coords.data() + slot.coordStart;
+  outline.coordCount = slot.coordCount;
+
+  return outline;
+}
+
+void Font::DecodeTrueType(uint16_t glyph, const double* transform, int depth, PathBuffer* out) const {
+  size_t index = glyph;
+  size_t start = longLoca_ ? loca_.U32(4 * index) : 2 * static_cast<size_t>(loca_.U16(2 * index));
+  size_t end = longLoca_ ? loca_.U32(4 * index + 4) : 2 * static_cast<size_t>(loca_.U16(2 * index + 2));
+
+  if (end <= start) return;
+
+  FontSpan data = glyf_.Slice(start, end - start);
+  int16_t contourCount = data.S16(0);
+
+  if (contourCount >= 0) {
+    if (contourCount == 0) return;
+
+    size_t pointCount = static_cast<size_t>(data.U16(10 + 2 * (contourCount - 1))) + 1;
+    // Flags follow the end points and the hinting instructions.
+    size_t p = 12 + 2 * static_cast<size_t>(contourCount) + data.U16(10 + 2 * static_cast<size_t>(contourCount));
+
+    // Every point takes at least one flag byte, which bounds the work a damaged point count can cause.
+    if (p + pointCount > data.size) return;
+
+    std::vector<uint8_t> flags(pointCount);
+    std::vector<int32_t> xs(pointCount);
+    std::vector<int32_t> ys(pointCount);
+
+    for (size_t i = 0; i < pointCount;) {
+      uint8_t flag = data.U8(p++);
+      size_t repeat = flag & 8 ? data.U8(p++) : 0;
+
+      for (size_t k = 0; k <= repeat && i < pointCount; k += 1) flags[i++] = flag;
+    }
+
+    int32_t x = 0;
+    int32_t y = 0;
+
+    for (size_t i = 0; i < pointCount; i += 1) {
+      if (flags[i] & 2) {
+        x += flags[i] & 0x10 ? data.U8(p) : -data.U8(p);
+        p += 1;
+      } else if (!(flags[i] & 0x10)) {
+        x += data.S16(p);
+        p += 2;
+      }
+      xs[i] = x;
+    }
+    for (size_t i = 0; i < pointCount; i += 1) {
+      if (flags[i] & 4) {
+        y += flags[i] & 0x20 ? data.U8(p) : -data.U8(p);
+        p += 1;
+      } else if (!(flags[i] & 0x20)) {
+        y += data.S16(p);
+        p += 2;
+      }
+      ys[i] = y;
+    }
+
+    ContourWriter writer(transform, out);
+    size_t first = 0;
+
+    for (int16_t contour = 0; contour < contourCount; contour += 1) {
+      size_t last = data.U16(10 + 2 * static_cast<size_t>(contour));
+
+      if (last < first || last >= pointCount) break;
+      writer.Write(&xs[first], &ys[first], &flags[first], last - first + 1);
+      first = last + 1;
+    }
+
+    return;
+  }
+  if (depth >= kMaxCompositeDepth) return;
+
+  // Composite glyph: components placed with their own 2x2 transform and offset.
+  size_t p = 10;
+  uint16_t flags;
+
+  do {
+    flags = data.U16(p);
+
+    uint16_t component = data.U16(p + 2);
+    double dx;
+    double dy;
+
+    p += 4;
+    if (flags & 1) {
+      dx = data.S16(p);
+      dy = data.S16(p + 2);
+      p += 4;
+    } else {
+      dx = static_cast<int8_t>(data.U8(p));
+      dy = static_cast<int8_t>(data.U8(p + 1));
+      p += 2;
+    }
+    // Point-matched placement (ARGS_ARE_XY_VALUES clear) is rare; such components are placed at the origin.
+    if (!(flags & 2)) dx = dy = 0;
+
+    double a = 1;
+    double b = 0;
+    double c = 0;
+    double d = 1;
+
+    if (flags & 8) {
+      a = d = F2Dot14(data, p);
+      p += 2;
+    } else if (flags & 0x40) {
+      a = F2Dot14(data, p);
+      d = F2Dot14(data, p + 2);
+      p += 4;
+    } else if (flags & 0x80) {
+      a = F2Dot14(data, p);
+      b = F2Dot14(data, p + 2);
+      c = F2Dot14(data, p + 4);
+      d = F2Dot14(data, p + 6);
+      p += 8;
+    }
+    if (flags & 0x800) {
+      double scaledX = a * dx + c * dy;
+
+      dy = b * dx + d * dy;
+      dx = scaledX;
+    }
+
+    const double* m = transform;
+    double combined[6] = {m[0] * a + m[2] * b,          m[1] * a + m[3] * b,          m[0] * c + m[2] * d,
+                          m[1] * c + m[3] * d,          m[0] * dx + m[2] * dy + m[4], m[1] * dx + m[3] * dy + m[5]};
+
+    if (component < glyphCount_) DecodeTrueType(component, combined, depth + 1, out);
+  } while ((flags & 0x20) && p < data.size);
+}
+
+}  // namespace beam
@@ -0,0 +1,153 @@
+// OpenType / TrueType fonts: table directory, metrics, character map and glyph outlines (glyf and CFF), with every
+// outline decoded once and cached in font units.
+#ifndef BEAM_ADDON_FONT_H_
+#define BEAM_ADDON_FONT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "path-buffer.h"
+
+namespace beam {
+
+// Bounds-checked big-endian view of font data; reads past the end return 0 and slices are clamped, so damaged fonts
+// decode to empty or partial data instead of reading out of bounds.
+struct FontSpan {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+
+  uint8_t U8(size_t offset) const { return offset < size ? data[offset] : 0; }
+  uint16_t U16(size_t offset) const {
+    return offset + 2 <= size ? static_cast<uint16_t>(data[offset] << 8 | data[offset + 1]) : 0;
+  }
+  int16_t S16(size_t offset) const { return static_cast<int16_t>(U16(offset)); }
+  uint32_t U32(size_t offset) const { return static_cast<uint32_t>(U16(offset)) << 16 | U16(offset + 2); }
+  FontSpan Slice(size_t offset, size_t length = SIZE_MAX) const {
+    if (offset >= size) return {};
+
+    return {data + offset, length < size - offset ? length : size - offset};
+  }
+  bool Empty() const { return size == 0; }
+};
+
+// OpenType table or feature tag as a big-endian number, e.g. FontTag("GSUB").
+constexpr uint32_t FontTag(const char* tag) {
+  return static_cast<uint32_t>(tag[0]) << 24 | static_cast<uint32_t>(tag[1]) << 16 |
+         static_cast<uint32_t>(tag[2]) << 8 | static_cast<uint32_t>(tag[3]);
+}
+
+// Table `tag` of the face whose table directory starts at `directory`; empty when missing.
+FontSpan FindFontTable(FontSpan file, size_t directory, const char* tag);
+
+// Offsets of the table directory of every face: one for a TTF or OTF, one per face of a TTC. Empty when the file is
+// not a TrueType or OpenType font.
+std::vector<size_t> FontFaceDirectories(FontSpan file);
+
+struct FontNames {
+  // Typographic family and subfamily (name IDs 16 and 17) when present, else IDs 1 and 2.
+  std::string family;
+  std::string subfamily;
+  std::string postscript;
+};
+
+FontNames ReadFontNames(FontSpan name);
+
+// View of one cached outline: path-buffer.h commands in font units with y up.
+struct GlyphOutline {
+  const uint8_t* commands = nullptr;
+  size_t commandCount = 0;
+  const double* coords = nullptr;
+  size_t coordCount = 0;
+};
+
+class CffOutlines;
+
+class Font {
+ public:
+  // Parses face `index` of a TTF, OTF or TTC. The font keeps `data`. Returns null with a message in `error` for
+  // unsupported or damaged files.
+  static std::unique_ptr<Font> Load(std::vector<uint8_t> data, uint32_t index, std::string* error);
+
+  ~Font();
+
+  Font(const Font&) = delete;
+  Font& operator=(const Font&) = delete;
+
+  // Table by tag ("GSUB", "kern", ...); empty when missing.
+  FontSpan Table(const char* tag) const;
+
+  const std::string& PostscriptName() const { return postscriptName_; }
+  const std::string& FamilyName() const { return familyName_; }
+  const std::string& SubfamilyName() const { return subfamilyName_; }
+  uint16_t UnitsPerEm() const { return unitsPerEm_; }
+  int16_t Ascender() const { return ascender_; }
+  int16_t Descender() const { return descender_; }
+  int16_t LineGap() const { return lineGap_; }
+  uint16_t GlyphCount() const { return glyphCount_; }
+  bool IsCff() const { return !cff_.Empty(); }
+
+  // Glyph for a Unicode code point, 0 (.notdef) when the font has none.
+  uint16_t GlyphForCodePoint(uint32_t codePoint) const;
+  uint16_t AdvanceWidth(uint16_t glyph) const;
+
+  // Outline of a glyph: quadratic for TrueType, cubic for CFF, every contour closed. Decoded on first use; the view
+  // stays valid until the next Outline call. Not thread-safe.
+  GlyphOutline Outline(uint16_t glyph);
+  // Outline of a glyph already decoded by Outline, empty otherwise. Safe to call from several threads as long as no
+  // Outline call runs at the same time.
+  GlyphOutline CachedOutline(uint16_t glyph) const;
+
+  size_t MemoryUsage() const {
+    return data_.size() + cache_.commands.size() + cache_.coords.size() * sizeof(double) + slots_.size() * sizeof(Slot);
+  }
+
+ private:
+  struct Slot {
+    uint32_t commandStart = 0;
+    uint32_t commandCount = UINT32_MAX;
+    uint32_t coordStart = 0;
+    uint32_t coordCount = 0;
+  };
+
+  Font() = default;
+
+  bool Parse(uint32_t index, std::string* error);
+  void DecodeTrueType(uint16_t glyph, const double* transform, int depth, PathBuffer* out) const;
+
+  std::vector<uint8_t> data_;
+  FontSpan file_;
+  // Offset of the face's table directory in file_.
+  size_t directory_ = 0;
+
+  std::string postscriptName_;
+  std::string familyName_;
+  std::string subfamilyName_;
+  uint16_t unitsPerEm_ = 1000;
+  int16_t ascender_ = 0;
+  int16_t descender_ = 0;
+  int16_t lineGap_ = 0;
+  uint16_t glyphCount_ = 0;
+  uint16_t metricCount_ = 0;
+  bool longLoca_ = false;
+
+  // The best Unicode subtable of cmap and its format.
+  FontSpan cmap_;
+  uint16_t cmapFormat_ = 0;
+  bool cmapSymbol_ = false;
+  FontSpan hmtx_;
+  FontSpan loca_;
+  FontSpan glyf_;
+  FontSpan cff_;
+  std::unique_ptr<CffOutlines> cffOutlines_;
+
+  // Every decoded outline, appended to one buffer; a slot's commandCount is UINT32_MAX until its glyph is decoded.
+  PathBuffer cache_;
+  std::vector<Slot> slots_;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_FONT_H_
@@ -0,0 +1,140 @@
+#include "height-field.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace beam {
+
+namespace {
+
+// Points on a shared edge may miss both triangles by rounding; accept a tiny negative weight.
+constexpr double kBarycentricEpsilon = 1e-9;
+constexpr size_t kMaxGridSide = 4096;
+
+}  // namespace
+
+HeightField::HeightField(const double* xyz, const uint32_t* indices, size_t triangleCount, double cellSize) {
+  double maxX = -INFINITY;
+  double maxY = -INFINITY;
+
+  minX_ = INFINITY;
+  minY_ = INFINITY;
+  for (size_t i = 0; i < triangleCount * 3; i += 1) {
+    const double* p = &xyz[3 * indices[i]];
+
+    minX_ = std::min(minX_, p[0]);
+    minY_ = std::min(minY_, p[1]);
+    maxX = std::max(maxX, p[0]);
+    maxY = std::max(maxY, p[1]);
+  }
+  if (triangleCount == 0) {
+    minX_ = minY_ = 0;
+    maxX = maxY = 0;
+  }
+
+  double width = maxX - minX_;
+  double height = maxY - minY_;
+
+  if (!(cellSize > 0)) cellSize = std::sqrt(width * height / std::max<size_t>(triangleCount, 1));
+  cellSize = std::max({cellSize, width / kMaxGridSide, height / kMaxGridSide, 1e-9});
+  cellSize_ = cellSize;
+  columns_ = static_cast<size_t>(width / cellSize_) + 1;
+  rows_ = static_cast<size_t>(height / cellSize_) + 1;
+
+  triangles_.reserve(triangleCount);
+
+  std::vector<size_t> cellRanges;
+
+  for (size_t t = 0; t < triangleCount; t += 1) {
+    const double* p0 = &xyz[3 * indices[3 * t]];
+    const double* p1 = &xyz[3 * indices[3 * t + 1]];
+    const double* p2 = &xyz[3 * indices[3 * t + 2]];
+    double det = (p1[1] - p2[1]) * (p0[0] - p2[0]) + (p2[0] - p1[0]) * (p0[1] - p2[1]);
+
+    // Zero-area triangles cannot contain a point in their interior.
+    if (det == 0 || !std::isfinite(det)) continue;
+    triangles_.push_back({p2[0], p2[1], (p1[1] - p2[1]) / det, (p2[0] - p1[0]) / det, (p2[1] - p0[1]) / det,
+                          (p0[0] - p2[0]) / det, p0[2], p1[2], p2[2]});
+
+    size_t x0 = static_cast<size_t>((std::min({p0[0], p1[0], p2[0]}) - minX_) / cellSize_);
+    size_t x1 = static_cast<size_t>((std::max({p0[0], p1[0], p2[0]}) - minX_) / cellSize_);
+    size_t y0 = static_cast<size_t>((std::min({p0[1], p1[1], p2[1]}) - minY_) / cellSize_);
+    size_t y1 = static_cast<size_t>((std::max({p0[1], p1[1], p2[1]}) - minY_) / cellSize_);
+
+    cellRanges.insert(cellRanges.end(), {std::min(x0, columns_ - 1), std::min(x1, columns_ - 1),
+                                         std::min(y0, rows_ - 1), std::min(y1, rows_ - 1)});
+  }
+
+  // Two passes into a compressed (CSR) bucket list: count, then fill.
+  cellStart_.assign(columns_ * rows_ + 1, 0);
+  for (size_t t = 0; t < triangles_.size(); t += 1) {
+    const size_t* range = &cellRanges[4 * t];
+
+    for (size_t y = range[2]; y <= range[3]; y += 1) {
+      for (size_t x = range[0]; x <= range[1]; x += 1) cellStart_[y * columns_ + x + 1] += 1;
+    }
+  }
+  for (size_t i = 1; i < cellStart_.size(); i += 1) cellStart_[i] += cellStart_[i - 1];
+  cellTriangles_.resize(cellStart_.back());
+
+  std::vector<uint32_t> fill(cellStart_.begin(), cellStart_.end() - 1);
+
+  for (size_t t = 0; t < triangles_.size(); t += 1) {
+    const size_t* range = &cellRanges[4 * t];
+
+    for (size_t y = range[2]; y <= range[3]; y += 1) {
+      for (size_t x = range[0]; x <= range[1]; x += 1) {
+        cellTriangles_[fill[y * columns_ + x]++] = static_cast<uint32_t>(t);
+      }
+    }
+  }
+}
+
+bool HeightField::Interpolate(const Triangle& triangle, double x, double y, double* z) const {
+  double dx = x - triangle.x2;
+  double dy = y - triangle.y2;
+  double l0 = triangle.a * dx + triangle.b * dy;
+  double l1 = triangle.c * dx + triangle.d * dy;
+  double l2 = 1 - l0 - l1;
+
+  if (l0 < -kBarycentricEpsilon || l1 < -kBarycentricEpsilon || l2 < -kBarycentricEpsilon) return false;
+  *z = l0 * triangle.z0 + l1 * triangle.z1 + l2 * triangle.z2;
+
+  return true;
+}
+
+double HeightField::Sample(double x, double y, double outside, uint32_t* hint) const {
+  double z;
+
+  if (hint && *hint < triangles_.size() && Interpolate(triangles_[*hint], x, y, &z)) return z;
+
+  double column = (x - minX_) / cellSize_;
+  double row = (y - minY_) / cellSize_;
+
+  // Allow points on the far edge of the last cell; anything else beyond the grid is outside the mesh.
+  if (!(column >= -kBarycentricEpsilon && row >= -kBarycentricEpsilon && column <= columns_ && row <= rows_)) {
+    return outside;
+  }
+
+  size_t cell = std::min(static_cast<size_t>(std::max(row, 0.0)), rows_ - 1) * columns_ +
+                std::min(static_cast<size_t>(std::max(column, 0.0)), columns_ - 1);
+
+  for (uint32_t i = cellStart_[cell]; i < cellStart_[cell + 1]; i += 1) {
+    uint32_t t = cellTriangles_[i];
+
+    if (Interpolate(triangles_[t], x, y, &z)) {
+      if (hint) *hint = t;
+
+      return z;
+    }
+  }
+
+  return outside;
+}
+
+size_t HeightField::MemoryUsage() const {
+  return triangles_.size() * sizeof(Triangle) + cellStart_.size() * sizeof(uint32_t) +
+         cellTriangles_.size() * sizeof(uint32_t);
+}
+
+}  // namespace beam
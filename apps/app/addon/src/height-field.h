@@ -0,0 +1,45 @@
+// Z lookup on a triangulated height surface: a uniform grid of triangle buckets answers point queries with
+// barycentric interpolation of the triangle that contains them.
+#ifndef BEAM_ADDON_HEIGHT_FIELD_H_
+#define BEAM_ADDON_HEIGHT_FIELD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace beam {
+
+class HeightField {
+ public:
+  // `cellSize` <= 0 picks a size giving about one triangle per cell.
+  HeightField(const double* xyz, const uint32_t* indices, size_t triangleCount, double cellSize);
+
+  // Interpolated z at (x, y), or `outside` when no triangle contains the point. `hint` is the triangle found by the
+  // previous query of the same caller; consecutive toolpath points usually fall in the same one.
+  double Sample(double x, double y, double outside, uint32_t* hint) const;
+
+  size_t MemoryUsage() const;
+
+ private:
+  // Barycentric weights l0 = (a * dx + b * dy) / det, l1 = (c * dx + d * dy) / det relative to the third vertex.
+  struct Triangle {
+    double x2, y2;
+    double a, b, c, d;
+    double z0, z1, z2;
+  };
+
+  bool Interpolate(const Triangle& triangle, double x, double y, double* z) const;
+
+  std::vector<Triangle> triangles_;
+  std::vector<uint32_t> cellStart_;
+  std::vector<uint32_t> cellTriangles_;
+  double minX_ = 0;
+  double minY_ = 0;
+  double cellSize_ = 1;
+  size_t columns_ = 0;
+  size_t rows_ = 0;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_HEIGHT_FIELD_H_
@@ -0,0 +1,390 @@
+#include "journal.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+
+#include "beam-format.h"
+#include "beam-reader.h"
+#include "xxhash.h"
+
+namespace beam {
+
+namespace {
+
+constexpr uint8_t kJournalMagic[4] = {'B', 'J', 'N', 'L'};
+constexpr uint8_t kJournalVersion = 1;
+constexpr size_t kChecksumSize = 8;
+
+enum JournalRecordType : uint8_t {
+  // Payload: image or thumbnail bytes; the checksum doubles as their content hash.
+  kJournalBlob = 1,
+  // Payload: VINT metadata length, metadata; svg edit as VINT kept prefix, VINT kept suffix, VINT inserted length,
+  // inserted bytes; VINT misc length, misc; u8 has thumbnail, [u64 thumbnail hash];
+  // VINT image count, per image u8 id length, id, u64 hash.
+  kJournalState = 2,
+};
+
+void PushVint(std::vector<uint8_t>& out, uint64_t value) {
+  uint8_t bytes[kMaxVintSize];
+
+  out.insert(out.end(), bytes, bytes + WriteVint(value, bytes));
+}
+
+void PushBytes(std::vector<uint8_t>& out, const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+void PushU64(std::vector<uint8_t>& out, uint64_t value) {
+  for (int k = 0; k < 8; k += 1) out.push_back(static_cast<uint8_t>(value >> (8 * k)));
+}
+
+uint64_t ReadU64(const uint8_t* p) {
+  uint64_t value = 0;
+
+  for (int k = 0; k < 8; k += 1) value |= static_cast<uint64_t>(p[k]) << (8 * k);
+
+  return value;
+}
+
+std::vector<uint8_t> JournalHeader(uint64_t generation) {
+  std::vector<uint8_t> header(kJournalMagic, kJournalMagic + sizeof(kJournalMagic));
+
+  header.push_back(kJournalVersion);
+  PushVint(header, generation);
+
+  return header;
+}
+
+// Base generation named by a mapped journal, with `offset` set past the header.
+bool ReadJournalHeader(const MappedFile& file, size_t* offset, uint64_t* generation) {
+  *offset = sizeof(kJournalMagic) + 1;
+
+  return file.Size() >= *offset && memcmp(file.Data(), kJournalMagic, sizeof(kJournalMagic)) == 0 &&
+         file.Data()[sizeof(kJournalMagic)] == kJournalVersion &&
+         ReadVint(file.Data(), file.Size(), offset, generation);
+}
+
+// Records of one append: framing and state live in `buffers`, blob payloads point into the document.
+class RecordBatch {
+ public:
+  void Add(uint8_t type, const ByteSpan& payload, uint64_t hash) {
+    std::vector<uint8_t>& framing = NewBuffer();
+    std::vector<uint8_t>& checksum = NewBuffer();
+
+    framing.push_back(type);
+    PushVint(framing, payload.size);
+    PushU64(checksum, hash);
+    Push(framing);
+    if (payload.size > 0) chunks_.push_back(payload);
+    Push(checksum);
+    size_ += payload.size;
+  }
+
+  std::vector<uint8_t>& NewBuffer() {
+    buffers_.emplace_back();
+
+    return buffers_.back();
+  }
+
+  const std::vector<ByteSpan>& Chunks() const { return chunks_; }
+  uint64_t Size() const { return size_; }
+
+ private:
+  void Push(const std::vector<uint8_t>& buffer) {
+    chunks_.push_back({buffer.data(), buffer.size()});
+    size_ += buffer.size();
+  }
+
+  std::deque<std::vector<uint8_t>> buffers_;
+  std::vector<ByteSpan> chunks_;
+  uint64_t size_ = 0;
+};
+
+bool ReadString(const ByteSpan& payload, size_t* offset, std::string* out) {
+  uint64_t length;
+
+  if (!ReadVint(payload.data, payload.size, offset, &length) || length > payload.size - *offset) return false;
+  out->assign(reinterpret_cast<const char*>(payload.data + *offset), static_cast<size_t>(length));
+  *offset += static_cast<size_t>(length);
+
+  return true;
+}
+
+// Applies a state record on top of `document`; leaves it untouched when the record does not parse or names a blob
+// that was never stored.
+bool ApplyState(const ByteSpan& payload, const std::unordered_map<uint64_t, ByteSpan>& blobs, BeamDocument* document) {
+  BeamDocument next;
+  size_t offset = 0;
+  uint64_t keepPrefix;
+  uint64_t keepSuffix;
+  uint64_t count;
+  std::string inserted;
+
+  if (!ReadString(payload, &offset, &next.metadata) || !ReadVint(payload.data, payload.size, &offset, &keepPrefix) ||
+      !ReadVint(payload.data, payload.size, &offset, &keepSuffix) || !ReadString(payload, &offset, &inserted) ||
+      !ReadString(payload, &offset, &next.misc) || offset >= payload.size ||
+      keepPrefix + keepSuffix > document->svg.size()) {
+    return false;
+  }
+  next.hasThumbnail = payload.data[offset++] != 0;
+  if (next.hasThumbnail) {
+    if (payload.size - offset < 8) return false;
+
+    auto found = blobs.find(ReadU64(payload.data + offset));
+
+    if (found == blobs.end()) return false;
+    next.thumbnail = found->second;
+    offset += 8;
+  }
+  if (!ReadVint(payload.data, payload.size, &offset, &count) || count > payload.size) return false;
+  next.images.resize(static_cast<size_t>(count));
+  for (BeamImage& image : next.images) {
+    if (offset >= payload.size) return false;
+
+    size_t idSize = payload.data[offset++];
+
+    if (idSize + 8 > payload.size - offset) return false;
+    image.id.assign(reinterpret_cast<const char*>(payload.data + offset), idSize);
+    offset += idSize;
+
+    auto found = blobs.find(ReadU64(payload.data + offset));
+
+    if (found == blobs.end()) return false;
+    image.data = found->second;
+    offset += 8;
+  }
+
+  size_t removed = document->svg.size() - static_cast<size_t>(keepPrefix + keepSuffix);
+
+  next.svg.swap(document->svg);
+  next.svg.replace(static_cast<size_t>(keepPrefix), removed, inserted);
+  *document = std::move(next);
+
+  return true;
+}
+
+bool LoadBase(const std::string& path, JournalReplay* replay, std::unordered_map<uint64_t, ByteSpan>* blobs,
+              std::string* error) {
+  BeamIndex index;
+  BeamDocument& document = replay->document;
+
+  if (!replay->base.Open(path, error) ||
+      !ReadBeamIndex(replay->base.Data(), replay->base.Size(), BeamReadMode::kFull, &index, error)) {
+    return false;
+  }
+
+  std::vector<uint8_t> storage;
+  ByteSpan span;
+
+  document.metadata.assign(reinterpret_cast<const char*>(index.metadata.data), index.metadata.size);
+  if (index.svg.present) {
+    if (!DecodeBeamBlock(index.svg, index.svg.size, &storage, &span, error)) return false;
+    document.svg.assign(reinterpret_cast<const char*>(span.data), span.size);
+  }
+  if (index.misc.present) {
+    if (!DecodeBeamBlock(index.misc, index.misc.size, &storage, &span, error)) return false;
+    document.misc.assign(reinterpret_cast<const char*>(span.data), span.size);
+  }
+  for (const BeamImageEntry& entry : index.images) {
+    document.images.push_back({std::string(reinterpret_cast<const char*>(entry.id.data), entry.id.size), entry.data});
+    blobs->emplace(Xxh64(entry.data.data, entry.data.size), entry.data);
+  }
+  if (index.thumbnail.present) {
+    document.hasThumbnail = true;
+    document.thumbnail = index.thumbnail.stored;
+    blobs->emplace(Xxh64(document.thumbnail.data, document.thumbnail.size), document.thumbnail);
+  }
+
+  return true;
+}
+
+}  // namespace
+
+Journal::Journal(std::string prefix, uint64_t compactBytes) : prefix_(std::move(prefix)), compactBytes_(compactBytes) {}
+
+std::string Journal::BasePath(uint64_t generation) const {
+  return prefix_ + "." + std::to_string(generation) + ".beam";
+}
+
+bool Journal::Create(std::string* error) {
+  MappedFile previous;
+  std::string ignored;
+  size_t offset;
+  uint64_t generation;
+
+  if (previous.Open(JournalPath(), &ignored) && ReadJournalHeader(previous, &offset, &generation) && generation > 0) {
+    RemoveFile(BasePath(generation));
+  }
+  previous.Close();
+  svg_.clear();
+  blobs_.clear();
+  broken_ = false;
+  generation_ = 0;
+
+  return Reset(0, error);
+}
+
+bool Journal::Reset(uint64_t generation, std::string* error) {
+  std::vector<uint8_t> header = JournalHeader(generation);
+
+  // Windows cannot rename over a file that is still open.
+  file_.Close();
+  if (!WriteFileAtomically(JournalPath(), {{header.data(), header.size()}}, error)) return false;
+
+  return file_.Open(JournalPath(), error);
+}
+
+bool Journal::Append(BeamDocument&& document, const BlobHashes& hashes, uint64_t* written, bool* compacted,
+                     std::string* error) {
+  *compacted = false;
+  // A failed write may have left a torn record that would hide everything after it.
+  if (broken_) {
+    *compacted = true;
+
+    return Compact(std::move(document), hashes, written, error);
+  }
+
+  RecordBatch batch;
+  std::unordered_set<uint64_t> added;
+  auto storeBlob = [&](const ByteSpan& data, uint64_t hash) {
+    if (!blobs_.count(hash) && added.insert(hash).second) batch.Add(kJournalBlob, data, hash);
+  };
+  std::vector<uint8_t>& state = batch.NewBuffer();
+  size_t keepPrefix = 0;
+  size_t keepSuffix = 0;
+  size_t common = std::min(svg_.size(), document.svg.size());
+
+  while (keepPrefix < common && svg_[keepPrefix] == document.svg[keepPrefix]) keepPrefix += 1;
+  while (keepSuffix < common - keepPrefix &&
+         svg_[svg_.size() - 1 - keepSuffix] == document.svg[document.svg.size() - 1 - keepSuffix]) {
+    keepSuffix += 1;
+  }
+  PushVint(state, document.metadata.size());
+  PushBytes(state, document.metadata.data(), document.metadata.size());
+  PushVint(state, keepPrefix);
+  PushVint(state, keepSuffix);
+  PushVint(state, document.svg.size() - keepPrefix - keepSuffix);
+  PushBytes(state, document.svg.data() + keepPrefix, document.svg.size() - keepPrefix - keepSuffix);
+  PushVint(state, document.misc.size());
+  PushBytes(state, document.misc.data(), document.misc.size());
+  state.push_back(document.hasThumbnail ? 1 : 0);
+  if (document.hasThumbnail) {
+    storeBlob(document.thumbnail, hashes.thumbnail);
+    PushU64(state, hashes.thumbnail);
+  }
+  PushVint(state, document.images.size());
+  for (size_t i = 0; i < document.images.size(); i += 1) {
+    const BeamImage& image = document.images[i];
+
+    state.push_back(static_cast<uint8_t>(image.id.size()));
+    PushBytes(state, image.id.data(), image.id.size());
+    storeBlob(image.data, hashes.images[i]);
+    PushU64(state, hashes.images[i]);
+  }
+  batch.Add(kJournalState, {state.data(), state.size()}, Xxh64(state.data(), state.size()));
+
+  if (file_.Size() + batch.Size() > compactBytes_) {
+    *compacted = true;
+
+    return Compact(std::move(document), hashes, written, error);
+  }
+  if (!file_.Append(batch.Chunks(), error)) {
+    broken_ = true;
+
+    return false;
+  }
+  svg_ = std::move(document.svg);
+  blobs_.insert(added.begin(), added.end());
+  *written = batch.Size();
+
+  return true;
+}
+
+bool Journal::Compact(BeamDocument&& document, const BlobHashes& hashes, uint64_t* written, std::string* error) {
+  uint64_t next = generation_ + 1;
+  BeamSerializer serializer(document, BeamWriteOptions());
+
+  if (!serializer.WriteFile(BasePath(next), error)) return false;
+  if (!Reset(next, error)) {
+    // The journal still names the previous base unless the rename went through; then only reopening failed.
+    MappedFile current;
+    std::string ignored;
+    size_t offset;
+    uint64_t generation = 0;
+
+    if (current.Open(JournalPath(), &ignored) && ReadJournalHeader(current, &offset, &generation) &&
+        generation == next) {
+      if (generation_ > 0) RemoveFile(BasePath(generation_));
+      generation_ = next;
+    } else {
+      RemoveFile(BasePath(next));
+    }
+    broken_ = true;
+
+    return false;
+  }
+  if (generation_ > 0) RemoveFile(BasePath(generation_));
+  generation_ = next;
+  broken_ = false;
+  *written = serializer.Size() + file_.Size();
+  svg_ = std::move(document.svg);
+  blobs_.clear();
+  blobs_.insert(hashes.images.begin(), hashes.images.end());
+  if (document.hasThumbnail) blobs_.insert(hashes.thumbnail);
+
+  return true;
+}
+
+bool ReplayJournal(const std::string& prefix, JournalReplay* replay, std::string* error) {
+  MappedFile& journal = replay->journal;
+  size_t offset;
+  uint64_t generation;
+
+  if (!journal.Open(prefix + ".journal", error)) return false;
+  if (!ReadJournalHeader(journal, &offset, &generation)) {
+    *error = "not a beam journal";
+
+    return false;
+  }
+
+  std::unordered_map<uint64_t, ByteSpan> blobs;
+
+  if (generation > 0 && !LoadBase(prefix + "." + std::to_string(generation) + ".beam", replay, &blobs, error)) {
+    return false;
+  }
+
+  const uint8_t* data = journal.Data();
+  size_t size = journal.Size();
+
+  while (offset < size) {
+    uint8_t type = data[offset];
+    size_t cursor = offset + 1;
+    uint64_t length;
+
+    if (!ReadVint(data, size, &cursor, &length) || length > size - cursor ||
+        kChecksumSize > size - cursor - length) {
+      break;
+    }
+
+    ByteSpan payload = {data + cursor, static_cast<size_t>(length)};
+    uint64_t hash = ReadU64(payload.data + payload.size);
+
+    if (Xxh64(payload.data, payload.size) != hash) break;
+    if (type == kJournalBlob) {
+      blobs.emplace(hash, payload);
+    } else if (type == kJournalState) {
+      if (!ApplyState(payload, blobs, &replay->document)) break;
+      replay->records += 1;
+    }
+    offset = cursor + payload.size + kChecksumSize;
+  }
+
+  return true;
+}
+
+}  // namespace beam
@@ -0,0 +1,76 @@
+// Append-only autosave journal. Each save appends the svg as a diff against the previous save, the images that are
+// not stored yet (keyed by XXH64 of their bytes) and the small remaining state, so its cost follows the edit rather
+// than the project. Once the journal grows past a threshold it is compacted into a full .beam base file.
+//
+// Files for a journal `prefix`:
+//   prefix.journal     "BJNL", u8 version, VINT base generation, then records:
+//                      u8 type, VINT payload length, payload, u64 little-endian XXH64 of the payload
+//   prefix.<gen>.beam  the base the records apply to; generation 0 means no base
+// The journal names its base, so compaction writes the new base under a new name, switches the journal over with an
+// atomic rename and only then deletes the old base: a crash at any point leaves a consistent pair.
+#ifndef BEAM_ADDON_JOURNAL_H_
+#define BEAM_ADDON_JOURNAL_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "beam-writer.h"
+#include "file-io.h"
+
+namespace beam {
+
+// XXH64 of the blobs of a document, computed by the caller so it can skip buffers it has hashed before.
+struct BlobHashes {
+  std::vector<uint64_t> images;  // Parallel to BeamDocument::images.
+  uint64_t thumbnail = 0;        // Unused without a thumbnail.
+};
+
+class Journal {
+ public:
+  Journal(std::string prefix, uint64_t compactBytes);
+
+  Journal(const Journal&) = delete;
+  Journal& operator=(const Journal&) = delete;
+
+  // Starts an empty journal, replacing any previous one under the same prefix together with its base.
+  bool Create(std::string* error);
+  // Records `document` and flushes it to disk. Compacts instead when the journal would exceed the threshold or a
+  // previous write failed. `written` receives the bytes written. The svg is moved out of `document` on success.
+  bool Append(BeamDocument&& document, const BlobHashes& hashes, uint64_t* written, bool* compacted,
+              std::string* error);
+  // Writes `document` as the new base and empties the journal. The svg is moved out of `document` on success.
+  bool Compact(BeamDocument&& document, const BlobHashes& hashes, uint64_t* written, std::string* error);
+
+ private:
+  std::string JournalPath() const { return prefix_ + ".journal"; }
+  std::string BasePath(uint64_t generation) const;
+  bool Reset(uint64_t generation, std::string* error);
+
+  std::string prefix_;
+  uint64_t compactBytes_;
+  uint64_t generation_ = 0;
+  AppendFile file_;
+  bool broken_ = false;
+  // What the next record is relative to.
+  std::string svg_;
+  std::unordered_set<uint64_t> blobs_;
+};
+
+// State reconstructed from a journal and its base. Document spans point into the mapped files held here.
+struct JournalReplay {
+  MappedFile base;
+  MappedFile journal;
+  BeamDocument document;
+  // Records applied after the base; a torn or corrupt tail ends the replay early.
+  uint64_t records = 0;
+};
+
+// Replays `prefix`. Returns false with `error` set when there is no readable journal or its base is missing.
+bool ReplayJournal(const std::string& prefix, JournalReplay* replay, std::string* error);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_JOURNAL_H_
@@ -0,0 +1,778 @@
+#include "jpeg-codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace beam {
+
+namespace {
+
+constexpr uint8_t kMarkerSoi = 0xD8;
+constexpr uint8_t kMarkerEoi = 0xD9;
+constexpr uint8_t kMarkerSos = 0xDA;
+constexpr uint8_t kMarkerDqt = 0xDB;
+constexpr uint8_t kMarkerDri = 0xDD;
+constexpr uint8_t kMarkerDht = 0xC4;
+constexpr uint8_t kMarkerApp14 = 0xEE;
+
+// Natural index of each coefficient in zigzag order.
+constexpr uint8_t kZigzag[kJpegBlockSize] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+    30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+// Standard Huffman tables of ITU T.81 Annex K.3: code counts per length 1..16, then the symbols.
+constexpr uint8_t kDcLuminanceCounts[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+constexpr uint8_t kDcChrominanceCounts[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+constexpr uint8_t kDcValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+constexpr uint8_t kAcLuminanceCounts[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D};
+constexpr uint8_t kAcLuminanceValues[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+    0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83,
+    0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3,
+    0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+    0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA};
+constexpr uint8_t kAcChrominanceCounts[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+constexpr uint8_t kAcChrominanceValues[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+    0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15, 0x62, 0x72, 0xD1,
+    0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x35, 0x36,
+    0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A,
+    0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A,
+    0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA,
+    0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+    0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA};
+
+// Codes up to this length are decoded with one table lookup.
+constexpr int kLookupBits = 9;
+// Zero bytes fed past the end of the entropy data before a scan counts as truncated.
+constexpr int kMaxPadding = 64;
+
+uint16_t ReadU16(const uint8_t* data) { return static_cast<uint16_t>(data[0] << 8 | data[1]); }
+
+int Extend(int value, int bits) {
+  if (bits == 0) return 0;
+
+  return value < (1 << (bits - 1)) ? value - (1 << bits) + 1 : value;
+}
+
+struct HuffmanDecoder {
+  bool present = false;
+  uint8_t values[256] = {};
+  int32_t maxCode[18] = {};
+  int32_t valueOffset[17] = {};
+  // (length << 8) | symbol for every kLookupBits prefix of a short code, 0 otherwise.
+  uint16_t lookup[1 << kLookupBits] = {};
+};
+
+bool BuildDecoder(const uint8_t* counts, const uint8_t* values, HuffmanDecoder* decoder) {
+  int32_t code = 0;
+  int k = 0;
+
+  memset(decoder->lookup, 0, sizeof(decoder->lookup));
+  for (int length = 1; length <= 16; length += 1) {
+    decoder->valueOffset[length] = k - code;
+    for (int i = 0; i < counts[length - 1]; i += 1) {
+      if (length <= kLookupBits) {
+        int shift = kLookupBits - length;
+
+        for (int fill = 0; fill < (1 << shift); fill += 1) {
+          decoder->lookup[(code << shift) | fill] = static_cast<uint16_t>(length << 8 | values[k]);
+        }
+      }
+      decoder->values[k] = values[k];
+      code += 1;
+      k += 1;
+    }
+    decoder->maxCode[length] = counts[length - 1] ? code - 1 : -1;
+    if (code > (1 << length)) return false;
+    code <<= 1;
+  }
+  decoder->maxCode[17] = INT32_MAX;
+  decoder->present = true;
+
+  return true;
+}
+
+// Entropy-coded data with byte stuffing removed. At a marker or the end of the data it feeds zero bytes, which the
+// caller notices through Overrun() when a scan is cut short.
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, size_t size, size_t offset) : data_(data), size_(size), offset_(offset) {}
+
+  int Bits(int count) {
+    if (count == 0) return 0;
+    if (count_ < count) Fill();
+    count_ -= count;
+
+    return static_cast<int>(buffer_ >> count_) & ((1 << count) - 1);
+  }
+
+  int Decode(const HuffmanDecoder& decoder) {
+    if (count_ < 16) Fill();
+
+    uint32_t peek = static_cast<uint32_t>(buffer_ >> (count_ - 16)) & 0xFFFF;
+    uint16_t entry = decoder.lookup[peek >> (16 - kLookupBits)];
+
+    if (entry) {
+      count_ -= entry >> 8;
+
+      return entry & 0xFF;
+    }
+
+    int length = kLookupBits + 1;
+    int32_t code = static_cast<int32_t>(peek >> (16 - length));
+
+    while (code > decoder.maxCode[length]) {
+      length += 1;
+      if (length > 16) return -1;
+      code = static_cast<int32_t>(peek >> (16 - length));
+    }
+    count_ -= length;
+
+    return decoder.values[code + decoder.valueOffset[length]];
+  }
+
+  // Skips to the restart marker that ends the current interval.
+  bool Restart() {
+    buffer_ = 0;
+    count_ = 0;
+    padding_ = 0;
+    marker_ = false;
+    while (offset_ + 1 < size_ && !(data_[offset_] == 0xFF && (data_[offset_ + 1] & 0xF8) == 0xD0)) offset_ += 1;
+    if (offset_ + 1 >= size_) return false;
+    offset_ += 2;
+
+    return true;
+  }
+
+  bool Overrun() const { return padding_ > kMaxPadding; }
+
+  // Offset of the marker that ends the scan.
+  size_t End() {
+    while (offset_ + 1 < size_ && !(data_[offset_] == 0xFF && data_[offset_ + 1] != 0 && data_[offset_ + 1] != 0xFF)) {
+      offset_ += 1;
+    }
+
+    return offset_;
+  }
+
+ private:
+  void Fill() {
+    while (count_ <= 56) {
+      uint8_t byte = 0;
+
+      if (marker_ || offset_ >= size_) {
+        padding_ += 1;
+      } else if (data_[offset_] != 0xFF) {
+        byte = data_[offset_];
+        offset_ += 1;
+      } else if (offset_ + 1 < size_ && data_[offset_ + 1] == 0) {
+        byte = 0xFF;
+        offset_ += 2;
+      } else {
+        marker_ = true;
+        padding_ += 1;
+      }
+      buffer_ = buffer_ << 8 | byte;
+      count_ += 8;
+    }
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  size_t offset_;
+  uint64_t buffer_ = 0;
+  int count_ = 0;
+  int padding_ = 0;
+  bool marker_ = false;
+};
+
+// Finds the next marker at `offset`. Segments with a length get `segment` and `offset` moves past them.
+bool NextSegment(const uint8_t* data, size_t size, size_t* offset, uint8_t* marker, const uint8_t** segment,
+                 size_t* segmentSize, std::string* error) {
+  if (*offset >= size || data[*offset] != 0xFF) {
+    *error = *offset >= size ? "truncated jpeg" : "invalid jpeg marker";
+
+    return false;
+  }
+  while (*offset < size && data[*offset] == 0xFF) *offset += 1;
+  if (*offset >= size) {
+    *error = "truncated jpeg";
+
+    return false;
+  }
+  *marker = data[*offset];
+  *offset += 1;
+  *segment = nullptr;
+  *segmentSize = 0;
+  if (*marker == kMarkerSoi || *marker == kMarkerEoi || (*marker >= 0xD0 && *marker <= 0xD7) || *marker == 0x01) {
+    return true;
+  }
+  if (size - *offset < 2 || ReadU16(data + *offset) < 2 || ReadU16(data + *offset) > size - *offset) {
+    *error = "truncated jpeg";
+
+    return false;
+  }
+  *segment = data + *offset + 2;
+  *segmentSize = ReadU16(data + *offset) - 2;
+  *offset += *segmentSize + 2;
+
+  return true;
+}
+
+bool IsFrameMarker(uint8_t marker) {
+  return marker >= 0xC0 && marker <= 0xCF && marker != kMarkerDht && marker != 0xC8 && marker != 0xCC;
+}
+
+bool ReadFrame(uint8_t marker, const uint8_t* segment, size_t size, JpegImage* image, std::string* error) {
+  if (marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE) {
+    *error = "progressive jpeg is not supported";
+
+    return false;
+  }
+  if (marker != 0xC0 && marker != 0xC1) {
+    *error = "unsupported jpeg coding process";
+
+    return false;
+  }
+  if (size < 6 || segment[0] != 8) {
+    *error = size < 6 ? "invalid jpeg frame header" : "only 8-bit jpeg is supported";
+
+    return false;
+  }
+
+  int count = segment[5];
+
+  image->height = ReadU16(segment + 1);
+  image->width = ReadU16(segment + 3);
+  if (image->width == 0 || image->height == 0 || count < 1 || count > 4 || size < 6 + 3 * static_cast<size_t>(count)) {
+    *error = "invalid jpeg frame header";
+
+    return false;
+  }
+  image->components.assign(count, JpegComponent());
+  image->maxH = 1;
+  image->maxV = 1;
+  for (int i = 0; i < count; i += 1) {
+    JpegComponent& component = image->components[i];
+    const uint8_t* entry = segment + 6 + 3 * i;
+
+    component.id = entry[0];
+    component.h = entry[1] >> 4;
+    component.v = entry[1] & 15;
+    component.quantTable = entry[2];
+    if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quantTable > 3) {
+      *error = "invalid jpeg frame header";
+
+      return false;
+    }
+    image->maxH = std::max(image->maxH, component.h);
+    image->maxV = std::max(image->maxV, component.v);
+  }
+  image->AllocateBlocks();
+
+  return true;
+}
+
+bool ReadQuantTables(const uint8_t* segment, size_t size, JpegImage* image) {
+  size_t offset = 0;
+
+  while (offset < size) {
+    int precision = segment[offset] >> 4;
+    int index = segment[offset] & 15;
+    size_t entrySize = precision ? 2 : 1;
+
+    offset += 1;
+    if (precision > 1 || index > 3 || size - offset < kJpegBlockSize * entrySize) return false;
+    for (int k = 0; k < kJpegBlockSize; k += 1) {
+      uint16_t value = precision ? ReadU16(segment + offset + 2 * k) : segment[offset + k];
+
+      if (value == 0) return false;
+      image->quant[index][kZigzag[k]] = value;
+    }
+    offset += kJpegBlockSize * entrySize;
+  }
+
+  return true;
+}
+
+bool ReadHuffmanTables(const uint8_t* segment, size_t size, HuffmanDecoder* dc, HuffmanDecoder* ac) {
+  size_t offset = 0;
+
+  while (offset < size) {
+    if (size - offset < 17) return false;
+
+    int tableClass = segment[offset] >> 4;
+    int index = segment[offset] & 15;
+    const uint8_t* counts = segment + offset + 1;
+    size_t total = 0;
+
+    for (int i = 0; i < 16; i += 1) total += counts[i];
+    offset += 17;
+    if (tableClass > 1 || index > 3 || total > 256 || size - offset < total) return false;
+    if (!BuildDecoder(counts, segment + offset, tableClass ? &ac[index] : &dc[index])) return false;
+    offset += total;
+  }
+
+  return true;
+}
+
+struct ScanComponent {
+  JpegComponent* component;
+  const HuffmanDecoder* dc;
+  const HuffmanDecoder* ac;
+  int predictor = 0;
+};
+
+bool DecodeBlock(BitReader& reader, ScanComponent& scan, int16_t* block) {
+  int size = reader.Decode(*scan.dc);
+
+  if (size < 0 || size > 11) return false;
+  scan.predictor += Extend(reader.Bits(size), size);
+  block[0] = static_cast<int16_t>(scan.predictor);
+  for (int k = 1; k < kJpegBlockSize; k += 1) {
+    int symbol = reader.Decode(*scan.ac);
+
+    if (symbol < 0) return false;
+
+    int run = symbol >> 4;
+
+    size = symbol & 15;
+    if (size == 0) {
+      if (run != 15) break;
+      k += 15;
+      continue;
+    }
+    k += run;
+    if (k >= kJpegBlockSize) return false;
+    block[kZigzag[k]] = static_cast<int16_t>(Extend(reader.Bits(size), size));
+  }
+
+  return true;
+}
+
+// Decodes one sequential scan starting at `*offset` and moves `*offset` to the marker after it.
+bool DecodeScan(const uint8_t* data, size_t size, size_t* offset, const uint8_t* header, size_t headerSize,
+                const HuffmanDecoder* dc, const HuffmanDecoder* ac, int restartInterval, JpegImage* image,
+                std::string* error) {
+  int count = headerSize > 0 ? header[0] : 0;
+  std::vector<ScanComponent> scans;
+
+  *error = "invalid jpeg scan header";
+  if (count < 1 || count > 4 || headerSize < 4 + 2 * static_cast<size_t>(count) || image->components.empty()) {
+    return false;
+  }
+  for (int i = 0; i < count; i += 1) {
+    const uint8_t* entry = header + 1 + 2 * i;
+    auto found = std::find_if(image->components.begin(), image->components.end(),
+                              [&](const JpegComponent& component) { return component.id == entry[0]; });
+    int dcIndex = entry[1] >> 4;
+    int acIndex = entry[1] & 15;
+
+    if (found == image->components.end() || dcIndex > 3 || acIndex > 3) return false;
+    if (!dc[dcIndex].present || !ac[acIndex].present) {
+      *error = "missing jpeg huffman table";
+
+      return false;
+    }
+    scans.push_back({&*found, &dc[dcIndex], &ac[acIndex]});
+  }
+
+  const uint8_t* spectral = header + 1 + 2 * count;
+
+  if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0) return false;
+
+  BitReader reader(data, size, *offset);
+  int unitsWide = image->McusWide();
+  int unitsHigh = image->McusHigh();
+
+  // A single-component scan codes only the blocks inside the image, one per unit.
+  if (count == 1) {
+    const JpegComponent& component = *scans[0].component;
+    int componentWidth = (image->width * component.h + image->maxH - 1) / image->maxH;
+    int componentHeight = (image->height * component.v + image->maxV - 1) / image->maxV;
+
+    unitsWide = (componentWidth + 7) / 8;
+    unitsHigh = (componentHeight + 7) / 8;
+  }
+  *error = "corrupt jpeg data";
+  for (int unit = 0; unit < unitsWide * unitsHigh; unit += 1) {
+    int unitX = unit % unitsWide;
+    int unitY = unit / unitsWide;
+
+    if (restartInterval > 0 && unit > 0 && unit % restartInterval == 0) {
+      if (!reader.Restart()) return false;
+      for (ScanComponent& scan : scans) scan.predictor = 0;
+    }
+    if (count == 1) {
+      if (!DecodeBlock(reader, scans[0], scans[0].component->Block(unitX, unitY))) return false;
+    } else {
+      for (ScanComponent& scan : scans) {
+        JpegComponent& component = *scan.component;
+
+        for (int y = 0; y < component.v; y += 1) {
+          for (int x = 0; x < component.h; x += 1) {
+            if (!DecodeBlock(reader, scan, component.Block(unitX * component.h + x, unitY * component.v + y))) {
+              return false;
+            }
+          }
+        }
+      }
+    }
+    if (reader.Overrun()) {
+      *error = "truncated jpeg";
+
+      return false;
+    }
+  }
+  error->clear();
+  *offset = reader.End();
+
+  return true;
+}
+
+struct HuffmanEncoder {
+  uint16_t code[256] = {};
+  uint8_t size[256] = {};
+
+  HuffmanEncoder(const uint8_t* counts, const uint8_t* values) {
+    uint16_t next = 0;
+    int k = 0;
+
+    for (int length = 1; length <= 16; length += 1) {
+      for (int i = 0; i < counts[length - 1]; i += 1) {
+        code[values[k]] = next;
+        size[values[k]] = static_cast<uint8_t>(length);
+        next += 1;
+        k += 1;
+      }
+      next <<= 1;
+    }
+  }
+};
+
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>* out) : out_(out) {}
+
+  void Put(uint32_t bits, int count) {
+    buffer_ = buffer_ << count | (bits & ((1u << count) - 1));
+    count_ += count;
+    while (count_ >= 8) {
+      uint8_t byte = static_cast<uint8_t>(buffer_ >> (count_ - 8));
+
+      out_->push_back(byte);
+      if (byte == 0xFF) out_->push_back(0);
+      count_ -= 8;
+    }
+  }
+
+  void Symbol(const HuffmanEncoder& encoder, int symbol) { Put(encoder.code[symbol], encoder.size[symbol]); }
+
+  // Pads the last byte with one bits.
+  void Flush() {
+    if (count_ > 0) Put(0x7F, 8 - count_);
+  }
+
+ private:
+  std::vector<uint8_t>* out_;
+  uint32_t buffer_ = 0;
+  int count_ = 0;
+};
+
+int Category(int value) {
+  int magnitude = value < 0 ? -value : value;
+  int bits = 0;
+
+  while (magnitude > 0) {
+    bits += 1;
+    magnitude >>= 1;
+  }
+
+  return bits;
+}
+
+void EncodeBlock(BitWriter& writer, const int16_t* block, int* predictor, const HuffmanEncoder& dc,
+                 const HuffmanEncoder& ac) {
+  int value = std::max(-2047, std::min(2047, block[0] - *predictor));
+  int bits = Category(value);
+  int run = 0;
+
+  *predictor += value;
+  writer.Symbol(dc, bits);
+  writer.Put(value < 0 ? value - 1 : value, bits);
+  for (int k = 1; k < kJpegBlockSize; k += 1) {
+    value = std::max(-1023, std::min(1023, static_cast<int>(block[kZigzag[k]])));
+    if (value == 0) {
+      run += 1;
+      continue;
+    }
+    for (; run >= 16; run -= 16) writer.Symbol(ac, 0xF0);
+    bits = Category(value);
+    writer.Symbol(ac, run << 4 | bits);
+    writer.Put(value < 0 ? value - 1 : value, bits);
+    run = 0;
+  }
+  if (run > 0) writer.Symbol(ac, 0x00);
+}
+
+void PutU16(std::vector<uint8_t>* out, int value) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void PutMarker(std::vector<uint8_t>* out, uint8_t marker, size_t length) {
+  out->push_back(0xFF);
+  out->push_back(marker);
+  PutU16(out, static_cast<int>(length) + 2);
+}
+
+void PutHuffmanTable(std::vector<uint8_t>* out, int tableClass, int index, const uint8_t* counts,
+                     const uint8_t* values, size_t count) {
+  out->push_back(static_cast<uint8_t>(tableClass << 4 | index));
+  out->insert(out->end(), counts, counts + 16);
+  out->insert(out->end(), values, values + count);
+}
+
+void EncodeScan(const JpegImage& image, const std::vector<int>& indices, const HuffmanEncoder* dc,
+                const HuffmanEncoder* ac, std::vector<uint8_t>* out) {
+  BitWriter writer(out);
+  int predictors[4] = {};
+
+  PutMarker(out, kMarkerSos, 4 + 2 * indices.size());
+  out->push_back(static_cast<uint8_t>(indices.size()));
+  for (int index : indices) {
+    int table = index == 0 ? 0 : 1;
+
+    out->push_back(static_cast<uint8_t>(image.components[index].id));
+    out->push_back(static_cast<uint8_t>(table << 4 | table));
+  }
+  out->push_back(0);
+  out->push_back(63);
+  out->push_back(0);
+  if (indices.size() == 1) {
+    int index = indices[0];
+    const JpegComponent& component = image.components[index];
+    int blocksWide = ((image.width * component.h + image.maxH - 1) / image.maxH + 7) / 8;
+    int blocksHigh = ((image.height * component.v + image.maxV - 1) / image.maxV + 7) / 8;
+    int table = index == 0 ? 0 : 1;
+
+    for (int y = 0; y < blocksHigh; y += 1) {
+      for (int x = 0; x < blocksWide; x += 1) {
+        EncodeBlock(writer, component.Block(x, y), &predictors[index], dc[table], ac[table]);
+      }
+    }
+  } else {
+    for (int mcuY = 0; mcuY < image.McusHigh(); mcuY += 1) {
+      for (int mcuX = 0; mcuX < image.McusWide(); mcuX += 1) {
+        for (int index : indices) {
+          const JpegComponent& component = image.components[index];
+          int table = index == 0 ? 0 : 1;
+
+          for (int y = 0; y < component.v; y += 1) {
+            for (int x = 0; x < component.h; x += 1) {
+              EncodeBlock(writer, component.Block(mcuX * component.h + x, mcuY * component.v + y), &predictors[index],
+                          dc[table], ac[table]);
+            }
+          }
+        }
+      }
+    }
+  }
+  writer.Flush();
+}
+
+}  // namespace
+
+void JpegImage::AllocateBlocks() {
+  for (JpegComponent& component : components) {
+    component.blocksWide = McusWide() * component.h;
+    component.blocksHigh = McusHigh() * component.v;
+    component.coefficients.assign(
+        static_cast<size_t>(component.blocksWide) * component.blocksHigh * kJpegBlockSize, 0);
+  }
+}
+
+bool ReadJpegInfo(const uint8_t* data, size_t size, JpegInfo* info, std::string* error) {
+  size_t offset = 2;
+  size_t end = size;
+
+  if (size < 4 || data[0] != 0xFF || data[1] != kMarkerSoi) {
+    *error = "not a jpeg file";
+
+    return false;
+  }
+  // Some encoders pad the file after EOI.
+  while (end > 4 && data[end - 1] == 0) end -= 1;
+  if (data[end - 2] != 0xFF || data[end - 1] != kMarkerEoi) {
+    *error = "truncated jpeg";
+
+    return false;
+  }
+  while (true) {
+    uint8_t marker;
+    const uint8_t* segment;
+    size_t segmentSize;
+
+    if (!NextSegment(data, end, &offset, &marker, &segment, &segmentSize, error)) return false;
+    if (marker == kMarkerEoi) break;
+    if (IsFrameMarker(marker)) {
+      if (segmentSize < 6 || segment[5] < 1 || ReadU16(segment + 1) == 0 || ReadU16(segment + 3) == 0) {
+        *error = "invalid jpeg frame header";
+
+        return false;
+      }
+      info->height = ReadU16(segment + 1);
+      info->width = ReadU16(segment + 3);
+      info->components = segment[5];
+      info->progressive = marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE;
+    } else if (marker == kMarkerSos) {
+      break;
+    }
+  }
+  if (info->width == 0) {
+    *error = "jpeg has no frame header";
+
+    return false;
+  }
+
+  return true;
+}
+
+bool DecodeJpeg(const uint8_t* data, size_t size, JpegImage* image, std::string* error) {
+  HuffmanDecoder dc[4];
+  HuffmanDecoder ac[4];
+  size_t offset = 2;
+  int restartInterval = 0;
+  bool scanned = false;
+
+  if (size < 4 || data[0] != 0xFF || data[1] != kMarkerSoi) {
+    *error = "not a jpeg file";
+
+    return false;
+  }
+  while (true) {
+    uint8_t marker;
+    const uint8_t* segment;
+    size_t segmentSize;
+
+    if (!NextSegment(data, size, &offset, &marker, &segment, &segmentSize, error)) return false;
+    if (marker == kMarkerEoi) break;
+    if (IsFrameMarker(marker)) {
+      if (!ReadFrame(marker, segment, segmentSize, image, error)) return false;
+    } else if (marker == kMarkerDqt) {
+      if (!ReadQuantTables(segment, segmentSize, image)) {
+        *error = "invalid jpeg quantization table";
+
+        return false;
+      }
+    } else if (marker == kMarkerDht) {
+      if (!ReadHuffmanTables(segment, segmentSize, dc, ac)) {
+        *error = "invalid jpeg huffman table";
+
+        return false;
+      }
+    } else if (marker == kMarkerDri) {
+      restartInterval = segmentSize >= 2 ? ReadU16(segment) : 0;
+    } else if (marker == kMarkerApp14 && segmentSize >= 12 && memcmp(segment, "Adobe", 5) == 0) {
+      image->adobeTransform = segment[11];
+    } else if (marker == kMarkerSos) {
+      if (!DecodeScan(data, size, &offset, segment, segmentSize, dc, ac, restartInterval, image, error)) {
+        return false;
+      }
+      scanned = true;
+    }
+  }
+  if (!scanned) {
+    *error = "jpeg has no scan";
+
+    return false;
+  }
+
+  return true;
+}
+
+void EncodeJpeg(const JpegImage& image, std::vector<uint8_t>* out) {
+  static const HuffmanEncoder dc[2] = {{kDcLuminanceCounts, kDcValues}, {kDcChrominanceCounts, kDcValues}};
+  static const HuffmanEncoder ac[2] = {{kAcLuminanceCounts, kAcLuminanceValues},
+                                       {kAcChrominanceCounts, kAcChrominanceValues}};
+  bool usedTables[4] = {};
+  bool wideTables = false;
+  int blocksPerMcu = 0;
+
+  for (const JpegComponent& component : image.components) {
+    usedTables[component.quantTable] = true;
+    blocksPerMcu += component.h * component.v;
+  }
+  for (int table = 0; table < 4; table += 1) {
+    for (int k = 0; usedTables[table] && k < kJpegBlockSize; k += 1) wideTables |= image.quant[table][k] > 255;
+  }
+
+  out->push_back(0xFF);
+  out->push_back(kMarkerSoi);
+  if (image.adobeTransform >= 0) {
+    static const uint8_t adobe[] = {'A', 'd', 'o', 'b', 'e', 0, 100, 0, 0, 0, 0};
+
+    PutMarker(out, kMarkerApp14, sizeof(adobe) + 1);
+    out->insert(out->end(), adobe, adobe + sizeof(adobe));
+    out->push_back(static_cast<uint8_t>(image.adobeTransform));
+  } else {
+    static const uint8_t jfif[] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+
+    PutMarker(out, 0xE0, sizeof(jfif));
+    out->insert(out->end(), jfif, jfif + sizeof(jfif));
+  }
+  for (int table = 0; table < 4; table += 1) {
+    if (!usedTables[table]) continue;
+
+    bool wide = false;
+
+    for (int k = 0; k < kJpegBlockSize; k += 1) wide |= image.quant[table][k] > 255;
+    PutMarker(out, kMarkerDqt, 1 + kJpegBlockSize * (wide ? 2 : 1));
+    out->push_back(static_cast<uint8_t>((wide ? 0x10 : 0) | table));
+    for (int k = 0; k < kJpegBlockSize; k += 1) {
+      if (wide) out->push_back(static_cast<uint8_t>(image.quant[table][kZigzag[k]] >> 8));
+      out->push_back(static_cast<uint8_t>(image.quant[table][kZigzag[k]]));
+    }
+  }
+  PutMarker(out, wideTables ? 0xC1 : 0xC0, 6 + 3 * image.components.size());
+  out->push_back(8);
+  PutU16(out, image.height);
+  PutU16(out, image.width);
+  out->push_back(static_cast<uint8_t>(image.components.size()));
+  for (const JpegComponent& component : image.components) {
+    out->push_back(static_cast<uint8_t>(component.id));
+    out->push_back(static_cast<uint8_t>(component.h << 4 | component.v));
+    out->push_back(static_cast<uint8_t>(component.quantTable));
+  }
+
+  bool chroma = image.components.size() > 1;
+
+  PutMarker(out, kMarkerDht, (17 + 12 + 17 + 162) * (chroma ? 2 : 1));
+  PutHuffmanTable(out, 0, 0, kDcLuminanceCounts, kDcValues, 12);
+  PutHuffmanTable(out, 1, 0, kAcLuminanceCounts, kAcLuminanceValues, 162);
+  if (chroma) {
+    PutHuffmanTable(out, 0, 1, kDcChrominanceCounts, kDcValues, 12);
+    PutHuffmanTable(out, 1, 1, kAcChrominanceCounts, kAcChrominanceValues, 162);
+  }
+
+  std::vector<int> indices;
+
+  // An interleaved scan holds at most 10 blocks per MCU; otherwise every component gets a scan of its own.
+  for (int i = 0; i < static_cast<int>(image.components.size()); i += 1) indices.push_back(i);
+  if (indices.size() == 1 || blocksPerMcu <= 10) {
+    EncodeScan(image, indices, dc, ac, out);
+  } else {
+    for (int index : indices) EncodeScan(image, {index}, dc, ac, out);
+  }
+  out->push_back(0xFF);
+  out->push_back(kMarkerEoi);
+}
+
+}  // namespace beam
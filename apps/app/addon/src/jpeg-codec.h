@@ -0,0 +1,70 @@
+// Baseline JPEG at the level of quantized DCT coefficients: sequential Huffman files are entropy-decoded into
+// per-component block arrays and written back with the standard Huffman tables, so blocks can be moved, rotated and
+// cropped without a lossy decode and re-encode. Progressive and arithmetic-coded files are rejected.
+#ifndef BEAM_ADDON_JPEG_CODEC_H_
+#define BEAM_ADDON_JPEG_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace beam {
+
+constexpr int kJpegBlockSize = 64;
+
+struct JpegInfo {
+  int width = 0;
+  int height = 0;
+  int components = 0;
+  bool progressive = false;
+};
+
+// Checks SOI, walks the markers up to the first scan and checks that the data ends with EOI, without decoding.
+bool ReadJpegInfo(const uint8_t* data, size_t size, JpegInfo* info, std::string* error);
+
+struct JpegComponent {
+  int id = 0;
+  // Sampling factors.
+  int h = 1;
+  int v = 1;
+  int quantTable = 0;
+  // Block arrays cover whole MCUs, so the right and bottom edges may hold padding blocks.
+  int blocksWide = 0;
+  int blocksHigh = 0;
+  // kJpegBlockSize quantized coefficients per block in natural (row-major) order, blocks row by row.
+  std::vector<int16_t> coefficients;
+
+  int16_t* Block(int x, int y) { return &coefficients[(static_cast<size_t>(y) * blocksWide + x) * kJpegBlockSize]; }
+  const int16_t* Block(int x, int y) const {
+    return &coefficients[(static_cast<size_t>(y) * blocksWide + x) * kJpegBlockSize];
+  }
+};
+
+struct JpegImage {
+  int width = 0;
+  int height = 0;
+  // Largest sampling factors; an MCU covers 8 * maxH by 8 * maxV pixels.
+  int maxH = 1;
+  int maxV = 1;
+  // Quantization tables in natural order.
+  uint16_t quant[4][kJpegBlockSize] = {};
+  // Transform flag of an Adobe APP14 marker, or -1 when there was none; written back so the color space is kept.
+  int adobeTransform = -1;
+  std::vector<JpegComponent> components;
+
+  int McusWide() const { return (width + 8 * maxH - 1) / (8 * maxH); }
+  int McusHigh() const { return (height + 8 * maxV - 1) / (8 * maxV); }
+  // Sizes the block arrays for the current dimensions and sampling factors, zero-filled.
+  void AllocateBlocks();
+};
+
+bool DecodeJpeg(const uint8_t* data, size_t size, JpegImage* image, std::string* error);
+
+// Writes a baseline file (extended sequential when a quantization table needs 16 bits) with the standard Huffman
+// tables.
+void EncodeJpeg(const JpegImage& image, std::vector<uint8_t>* out);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_JPEG_CODEC_H_
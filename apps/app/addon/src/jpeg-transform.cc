@@ -0,0 +1,365 @@
+#include "jpeg-transform.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace beam {
+
+namespace {
+
+// Scale factors of the AAN DCT: cos(k * pi / 16) * sqrt(2), and 1 for k = 0.
+constexpr float kAanScale[8] = {1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                                1.0f, 0.785694958f, 0.541196100f, 0.275899379f};
+
+bool Swapped(const JpegTransform& transform) { return transform.rotate == 90 || transform.rotate == 270; }
+
+// Frame header of the transformed image, with zeroed blocks.
+void PrepareOutput(const JpegImage& source, const JpegTransform& transform, JpegImage* out) {
+  bool swapped = Swapped(transform);
+  int width;
+  int height;
+
+  RotatedSize(source, transform, &width, &height);
+  out->width = transform.cropWidth > 0 ? transform.cropWidth : width;
+  out->height = transform.cropWidth > 0 ? transform.cropHeight : height;
+  out->maxH = swapped ? source.maxV : source.maxH;
+  out->maxV = swapped ? source.maxH : source.maxV;
+  // Quantization tables are not symmetric, so they turn with the blocks.
+  for (int table = 0; table < 4; table += 1) {
+    for (int k = 0; k < kJpegBlockSize; k += 1) {
+      out->quant[table][k] = swapped ? source.quant[table][k % 8 * 8 + k / 8] : source.quant[table][k];
+    }
+  }
+  out->adobeTransform = source.adobeTransform;
+  out->components.assign(source.components.size(), JpegComponent());
+  for (size_t i = 0; i < source.components.size(); i += 1) {
+    const JpegComponent& from = source.components[i];
+    JpegComponent& to = out->components[i];
+
+    to.id = from.id;
+    to.quantTable = from.quantTable;
+    to.h = swapped ? from.v : from.h;
+    to.v = swapped ? from.h : from.v;
+  }
+  out->AllocateBlocks();
+}
+
+// Rotating a block is a transpose and sign flips of the odd frequencies along the mirrored axes.
+void RotateBlock(const int16_t* in, int rotate, int16_t* out) {
+  for (int v = 0; v < 8; v += 1) {
+    for (int u = 0; u < 8; u += 1) {
+      int16_t value;
+
+      if (rotate == 90) {
+        value = (u & 1) ? -in[u * 8 + v] : in[u * 8 + v];
+      } else if (rotate == 180) {
+        value = ((u + v) & 1) ? -in[v * 8 + u] : in[v * 8 + u];
+      } else if (rotate == 270) {
+        value = (v & 1) ? -in[u * 8 + v] : in[u * 8 + v];
+      } else {
+        value = in[v * 8 + u];
+      }
+      out[v * 8 + u] = value;
+    }
+  }
+}
+
+// AAN float IDCT as in libjpeg's jidctflt.c; `multipliers` fold in the dequantization, the AAN scales and the
+// final division by 8.
+void InverseDct(const int16_t* block, const float* multipliers, uint8_t* samples, size_t stride) {
+  float workspace[kJpegBlockSize];
+
+  for (int column = 0; column < 8; column += 1) {
+    const int16_t* in = block + column;
+    const float* q = multipliers + column;
+    float* out = workspace + column;
+    float tmp0 = in[0] * q[0];
+    float tmp1 = in[16] * q[16];
+    float tmp2 = in[32] * q[32];
+    float tmp3 = in[48] * q[48];
+    float tmp10 = tmp0 + tmp2;
+    float tmp11 = tmp0 - tmp2;
+    float tmp13 = tmp1 + tmp3;
+    float tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+
+    tmp0 = tmp10 + tmp13;
+    tmp3 = tmp10 - tmp13;
+    tmp1 = tmp11 + tmp12;
+    tmp2 = tmp11 - tmp12;
+
+    float tmp4 = in[8] * q[8];
+    float tmp5 = in[24] * q[24];
+    float tmp6 = in[40] * q[40];
+    float tmp7 = in[56] * q[56];
+    float z13 = tmp6 + tmp5;
+    float z10 = tmp6 - tmp5;
+    float z11 = tmp4 + tmp7;
+    float z12 = tmp4 - tmp7;
+    float z5 = (z10 + z12) * 1.847759065f;
+
+    tmp7 = z11 + z13;
+    tmp11 = (z11 - z13) * 1.414213562f;
+    tmp10 = 1.082392200f * z12 - z5;
+    tmp12 = -2.613125930f * z10 + z5;
+    tmp6 = tmp12 - tmp7;
+    tmp5 = tmp11 - tmp6;
+    tmp4 = tmp10 + tmp5;
+    out[0] = tmp0 + tmp7;
+    out[56] = tmp0 - tmp7;
+    out[8] = tmp1 + tmp6;
+    out[48] = tmp1 - tmp6;
+    out[16] = tmp2 + tmp5;
+    out[40] = tmp2 - tmp5;
+    out[32] = tmp3 + tmp4;
+    out[24] = tmp3 - tmp4;
+  }
+  for (int row = 0; row < 8; row += 1) {
+    const float* in = workspace + row * 8;
+    uint8_t* out = samples + row * stride;
+    float tmp10 = in[0] + in[4];
+    float tmp11 = in[0] - in[4];
+    float tmp13 = in[2] + in[6];
+    float tmp12 = (in[2] - in[6]) * 1.414213562f - tmp13;
+    float tmp0 = tmp10 + tmp13;
+    float tmp3 = tmp10 - tmp13;
+    float tmp1 = tmp11 + tmp12;
+    float tmp2 = tmp11 - tmp12;
+    float z13 = in[5] + in[3];
+    float z10 = in[5] - in[3];
+    float z11 = in[1] + in[7];
+    float z12 = in[1] - in[7];
+    float z5 = (z10 + z12) * 1.847759065f;
+    float tmp7 = z11 + z13;
+    float tmp6 = -2.613125930f * z10 + z5 - tmp7;
+    float tmp5 = (z11 - z13) * 1.414213562f - tmp6;
+    float tmp4 = 1.082392200f * z12 - z5 + tmp5;
+    float values[8] = {tmp0 + tmp7, tmp1 + tmp6, tmp2 + tmp5, tmp3 - tmp4,
+                       tmp3 + tmp4, tmp2 - tmp5, tmp1 - tmp6, tmp0 - tmp7};
+
+    for (int k = 0; k < 8; k += 1) {
+      out[k] = static_cast<uint8_t>(std::max(0, std::min(255, static_cast<int>(values[k] + 128.5f))));
+    }
+  }
+}
+
+// AAN float FDCT as in libjpeg's jfdctflt.c, quantized with `divisors` that fold in the AAN scales.
+void ForwardDct(const uint8_t* samples, size_t stride, const float* divisors, int16_t* block) {
+  float data[kJpegBlockSize];
+
+  for (int row = 0; row < 8; row += 1) {
+    for (int k = 0; k < 8; k += 1) data[row * 8 + k] = samples[row * stride + k] - 128.0f;
+  }
+  for (int pass = 0; pass < 2; pass += 1) {
+    // Rows first, then columns.
+    int step = pass == 0 ? 1 : 8;
+    int next = pass == 0 ? 8 : 1;
+
+    for (int line = 0; line < 8; line += 1) {
+      float* d = data + line * next;
+      float tmp0 = d[0] + d[7 * step];
+      float tmp7 = d[0] - d[7 * step];
+      float tmp1 = d[step] + d[6 * step];
+      float tmp6 = d[step] - d[6 * step];
+      float tmp2 = d[2 * step] + d[5 * step];
+      float tmp5 = d[2 * step] - d[5 * step];
+      float tmp3 = d[3 * step] + d[4 * step];
+      float tmp4 = d[3 * step] - d[4 * step];
+      float tmp10 = tmp0 + tmp3;
+      float tmp13 = tmp0 - tmp3;
+      float tmp11 = tmp1 + tmp2;
+      float tmp12 = tmp1 - tmp2;
+      float z1 = (tmp12 + tmp13) * 0.707106781f;
+
+      d[0] = tmp10 + tmp11;
+      d[4 * step] = tmp10 - tmp11;
+      d[2 * step] = tmp13 + z1;
+      d[6 * step] = tmp13 - z1;
+      tmp10 = tmp4 + tmp5;
+      tmp11 = tmp5 + tmp6;
+      tmp12 = tmp6 + tmp7;
+
+      float z5 = (tmp10 - tmp12) * 0.382683433f;
+      float z2 = 0.541196100f * tmp10 + z5;
+      float z4 = 1.306562965f * tmp12 + z5;
+      float z3 = tmp11 * 0.707106781f;
+      float z11 = tmp7 + z3;
+      float z13 = tmp7 - z3;
+
+      d[5 * step] = z13 + z2;
+      d[3 * step] = z13 - z2;
+      d[step] = z11 + z4;
+      d[7 * step] = z11 - z4;
+    }
+  }
+  for (int k = 0; k < kJpegBlockSize; k += 1) {
+    float value = data[k] * divisors[k];
+
+    block[k] = static_cast<int16_t>(value < 0 ? value - 0.5f : value + 0.5f);
+  }
+}
+
+// Source plane indices that each output sample of one axis averages, as offsets into `taps` per sample: the sample's
+// pixels after cropping, mapped back through the rotation (`reversed` when it mirrors this axis) and the scaling to
+// source pixels, and from there to the source component's subsampled plane.
+struct AxisTaps {
+  std::vector<int> starts;
+  std::vector<int> taps;
+  int first;
+  int last;
+
+  AxisTaps(int samples, int outMax, int outFactor, int outSize, int crop, bool reversed, int scaledSize, int scale,
+           int sourceSize, int sourceFactor, int sourceMax) {
+    for (int sample = 0; sample < samples; sample += 1) {
+      starts.push_back(static_cast<int>(taps.size()));
+      for (int x = sample * outMax / outFactor; x < (sample + 1) * outMax / outFactor; x += 1) {
+        int rotated = std::min(x, outSize - 1) + crop;
+        int scaled = reversed ? scaledSize - 1 - rotated : rotated;
+
+        for (int pixel = scaled * scale; pixel < std::min(scaled * scale + scale, sourceSize); pixel += 1) {
+          taps.push_back(pixel * sourceFactor / sourceMax);
+        }
+      }
+    }
+    starts.push_back(static_cast<int>(taps.size()));
+    first = *std::min_element(taps.begin(), taps.end());
+    last = *std::max_element(taps.begin(), taps.end());
+  }
+
+  // Every sample reads exactly one source sample.
+  bool Single() const { return taps.size() + 1 == starts.size(); }
+};
+
+}  // namespace
+
+void RotatedSize(const JpegImage& image, const JpegTransform& transform, int* width, int* height) {
+  int scaledWidth = (image.width + transform.scale - 1) / transform.scale;
+  int scaledHeight = (image.height + transform.scale - 1) / transform.scale;
+
+  *width = Swapped(transform) ? scaledHeight : scaledWidth;
+  *height = Swapped(transform) ? scaledWidth : scaledHeight;
+}
+
+bool IsLosslessTransform(const JpegImage& image, const JpegTransform& transform) {
+  int mcuWidth = 8 * image.maxH;
+  int mcuHeight = 8 * image.maxV;
+
+  if (transform.scale != 1) return false;
+  if ((transform.rotate == 90 || transform.rotate == 180) && image.height % mcuHeight != 0) return false;
+  if ((transform.rotate == 180 || transform.rotate == 270) && image.width % mcuWidth != 0) return false;
+
+  return transform.cropX % (Swapped(transform) ? mcuHeight : mcuWidth) == 0 &&
+         transform.cropY % (Swapped(transform) ? mcuWidth : mcuHeight) == 0;
+}
+
+void TransformCoefficients(const JpegImage& source, const JpegTransform& transform, JpegImage* out) {
+  PrepareOutput(source, transform, out);
+  for (size_t i = 0; i < source.components.size(); i += 1) {
+    const JpegComponent& from = source.components[i];
+    JpegComponent& to = out->components[i];
+    int offsetX = transform.cropX / (8 * out->maxH) * to.h;
+    int offsetY = transform.cropY / (8 * out->maxV) * to.v;
+
+    for (int y = 0; y < to.blocksHigh; y += 1) {
+      for (int x = 0; x < to.blocksWide; x += 1) {
+        // Block of the rotated frame, then of the source.
+        int rotatedX = x + offsetX;
+        int rotatedY = y + offsetY;
+        int sourceX = rotatedX;
+        int sourceY = rotatedY;
+
+        if (transform.rotate == 90) {
+          sourceX = rotatedY;
+          sourceY = from.blocksHigh - 1 - rotatedX;
+        } else if (transform.rotate == 180) {
+          sourceX = from.blocksWide - 1 - rotatedX;
+          sourceY = from.blocksHigh - 1 - rotatedY;
+        } else if (transform.rotate == 270) {
+          sourceX = from.blocksWide - 1 - rotatedY;
+          sourceY = rotatedX;
+        }
+        RotateBlock(from.Block(sourceX, sourceY), transform.rotate, to.Block(x, y));
+      }
+    }
+  }
+}
+
+void TransformSamples(const JpegImage& source, const JpegTransform& transform, JpegImage* out) {
+  bool swapped = Swapped(transform);
+  int scaledWidth = (source.width + transform.scale - 1) / transform.scale;
+  int scaledHeight = (source.height + transform.scale - 1) / transform.scale;
+  float tables[4][kJpegBlockSize];
+
+  PrepareOutput(source, transform, out);
+  for (int table = 0; table < 4; table += 1) {
+    for (int k = 0; k < kJpegBlockSize; k += 1) {
+      tables[table][k] = source.quant[table][k] * kAanScale[k / 8] * kAanScale[k % 8] / 8;
+    }
+  }
+  for (size_t i = 0; i < source.components.size(); i += 1) {
+    const JpegComponent& from = source.components[i];
+    JpegComponent& to = out->components[i];
+    // Output columns follow source rows when the frame is turned by 90 or 270 degrees.
+    AxisTaps columns(to.blocksWide * 8, out->maxH, to.h, out->width, transform.cropX,
+                     transform.rotate == 90 || transform.rotate == 180, swapped ? scaledHeight : scaledWidth,
+                     transform.scale, swapped ? source.height : source.width, swapped ? from.v : from.h,
+                     swapped ? source.maxV : source.maxH);
+    AxisTaps rows(to.blocksHigh * 8, out->maxV, to.v, out->height, transform.cropY,
+                  transform.rotate == 180 || transform.rotate == 270, swapped ? scaledWidth : scaledHeight,
+                  transform.scale, swapped ? source.width : source.height, swapped ? from.h : from.v,
+                  swapped ? source.maxH : source.maxV);
+    const AxisTaps& sourceColumns = swapped ? rows : columns;
+    const AxisTaps& sourceRows = swapped ? columns : rows;
+    size_t sourceStride = static_cast<size_t>(from.blocksWide) * 8;
+    std::vector<uint8_t> sourcePlane(sourceStride * from.blocksHigh * 8);
+
+    // Only the blocks under the crop are decoded.
+    for (int y = sourceRows.first / 8; y <= sourceRows.last / 8; y += 1) {
+      for (int x = sourceColumns.first / 8; x <= sourceColumns.last / 8; x += 1) {
+        InverseDct(from.Block(x, y), tables[from.quantTable], &sourcePlane[(y * sourceStride + x) * 8],
+                   sourceStride);
+      }
+    }
+
+    size_t stride = static_cast<size_t>(to.blocksWide) * 8;
+    std::vector<uint8_t> plane(stride * to.blocksHigh * 8);
+    std::vector<size_t> columnOffsets(columns.taps.begin(), columns.taps.end());
+    std::vector<size_t> rowOffsets(rows.taps.begin(), rows.taps.end());
+
+    for (size_t& offset : swapped ? columnOffsets : rowOffsets) offset *= sourceStride;
+    for (int y = 0; y < to.blocksHigh * 8; y += 1) {
+      uint8_t* line = &plane[y * stride];
+
+      if (columns.Single() && rows.Single()) {
+        const uint8_t* base = &sourcePlane[rowOffsets[y]];
+
+        for (int x = 0; x < to.blocksWide * 8; x += 1) line[x] = base[columnOffsets[x]];
+        continue;
+      }
+      for (int x = 0; x < to.blocksWide * 8; x += 1) {
+        int sum = 0;
+        int count = 0;
+
+        for (int a = columns.starts[x]; a < columns.starts[x + 1]; a += 1) {
+          for (int b = rows.starts[y]; b < rows.starts[y + 1]; b += 1) {
+            sum += sourcePlane[columnOffsets[a] + rowOffsets[b]];
+            count += 1;
+          }
+        }
+        line[x] = static_cast<uint8_t>(count > 0 ? (sum + count / 2) / count : 0);
+      }
+    }
+
+    float divisors[kJpegBlockSize];
+
+    for (int k = 0; k < kJpegBlockSize; k += 1) {
+      divisors[k] = 1.0f / (out->quant[to.quantTable][k] * kAanScale[k / 8] * kAanScale[k % 8] * 8);
+    }
+    for (int y = 0; y < to.blocksHigh; y += 1) {
+      for (int x = 0; x < to.blocksWide; x += 1) {
+        ForwardDct(&plane[(y * stride + x) * 8], stride, divisors, to.Block(x, y));
+      }
+    }
+  }
+}
+
+}  // namespace beam
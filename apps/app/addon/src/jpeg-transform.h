@@ -0,0 +1,38 @@
+// Rotation, cropping and downscaling of decoded JPEG frames. Whole-MCU rotations and crops move and sign-flip the
+// quantized blocks, losslessly and without an IDCT; anything else goes through sample planes and is quantized again
+// with the source tables. Both work per component, so the color space is never converted.
+#ifndef BEAM_ADDON_JPEG_TRANSFORM_H_
+#define BEAM_ADDON_JPEG_TRANSFORM_H_
+
+#include "jpeg-codec.h"
+
+namespace beam {
+
+struct JpegTransform {
+  // Downscale factor: 1, 2, 4 or 8.
+  int scale = 1;
+  // Clockwise degrees: 0, 90, 180 or 270.
+  int rotate = 0;
+  // Rectangle of the scaled and rotated frame to keep; ignored when cropWidth is 0.
+  int cropX = 0;
+  int cropY = 0;
+  int cropWidth = 0;
+  int cropHeight = 0;
+};
+
+// Size of the frame after scaling and rotation, before cropping.
+void RotatedSize(const JpegImage& image, const JpegTransform& transform, int* width, int* height);
+
+// True when `transform` only moves whole MCUs: no scaling, the edges that rotation mirrors are MCU multiples and the
+// crop starts on an MCU boundary.
+bool IsLosslessTransform(const JpegImage& image, const JpegTransform& transform);
+
+// Requires IsLosslessTransform.
+void TransformCoefficients(const JpegImage& source, const JpegTransform& transform, JpegImage* out);
+
+// Decodes to sample planes, resamples and re-encodes the blocks. Works for any transform with a valid crop.
+void TransformSamples(const JpegImage& source, const JpegTransform& transform, JpegImage* out);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_JPEG_TRANSFORM_H_
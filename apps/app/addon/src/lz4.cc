@@ -0,0 +1,151 @@
+#include "lz4.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace beam {
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+// The format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end.
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMatchFindLimit = 12;
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashBits = 16;
+
+inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+
+  memcpy(&value, p, sizeof(value));
+
+  return value;
+}
+
+inline uint32_t Hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - kHashBits); }
+
+uint8_t* WriteLength(uint8_t* out, size_t length) {
+  for (; length >= 255; length -= 255) *out++ = 255;
+  *out++ = static_cast<uint8_t>(length);
+
+  return out;
+}
+
+uint8_t* WriteSequence(uint8_t* out, const uint8_t* literals, size_t literalLength, size_t offset,
+                       size_t matchLength) {
+  uint8_t* token = out++;
+
+  *token = static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+  if (literalLength >= 15) out = WriteLength(out, literalLength - 15);
+  memcpy(out, literals, literalLength);
+  out += literalLength;
+  if (matchLength == 0) return out;
+  *out++ = static_cast<uint8_t>(offset);
+  *out++ = static_cast<uint8_t>(offset >> 8);
+  matchLength -= kMinMatch;
+  *token |= static_cast<uint8_t>(std::min<size_t>(matchLength, 15));
+  if (matchLength >= 15) out = WriteLength(out, matchLength - 15);
+
+  return out;
+}
+
+// Reads a length continued in 255 steps. Returns false when the input ends first.
+bool ReadLength(const uint8_t* data, size_t size, size_t* offset, size_t* length) {
+  uint8_t byte;
+
+  do {
+    if (*offset >= size) return false;
+    byte = data[(*offset)++];
+    *length += byte;
+  } while (byte == 255);
+
+  return true;
+}
+
+}  // namespace
+
+size_t Lz4Compress(const uint8_t* data, size_t size, uint8_t* out) {
+  uint8_t* start = out;
+  size_t anchor = 0;
+
+  if (size > kMatchFindLimit) {
+    std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+    size_t limit = size - kMatchFindLimit;
+    size_t matchLimit = size - kLastLiterals;
+    size_t i = 1;
+
+    while (i < limit) {
+      uint32_t sequence = Read32(data + i);
+      uint32_t& slot = table[Hash(sequence)];
+      size_t candidate = slot;
+
+      slot = static_cast<uint32_t>(i);
+      if (i - candidate > kMaxOffset || Read32(data + candidate) != sequence) {
+        // Skip faster through data that does not compress.
+        i += 1 + ((i - anchor) >> 6);
+        continue;
+      }
+      while (i > anchor && candidate > 0 && data[i - 1] == data[candidate - 1]) {
+        i -= 1;
+        candidate -= 1;
+      }
+
+      size_t length = kMinMatch;
+
+      while (i + length < matchLimit && data[i + length] == data[candidate + length]) length += 1;
+      out = WriteSequence(out, data + anchor, i - anchor, i - candidate, length);
+      i += length;
+      anchor = i;
+      if (i < limit) table[Hash(Read32(data + i - 2))] = static_cast<uint32_t>(i - 2);
+    }
+  }
+
+  out = WriteSequence(out, data + anchor, size - anchor, 0, 0);
+
+  return static_cast<size_t>(out - start);
+}
+
+size_t Lz4Decompress(const uint8_t* data, size_t size, uint8_t* out, size_t capacity) {
+  size_t in = 0;
+  size_t written = 0;
+
+  while (in < size && written < capacity) {
+    uint8_t token = data[in++];
+    size_t literalLength = token >> 4;
+
+    if (literalLength == 15 && !ReadLength(data, size, &in, &literalLength)) return SIZE_MAX;
+    if (literalLength > size - in) return SIZE_MAX;
+
+    size_t copy = std::min(literalLength, capacity - written);
+
+    memcpy(out + written, data + in, copy);
+    in += literalLength;
+    written += copy;
+    // The last sequence has literals only.
+    if (in == size || written == capacity) break;
+    if (size - in < 2) return SIZE_MAX;
+
+    size_t offset = data[in] | (data[in + 1] << 8);
+    size_t matchLength = token & 15;
+
+    in += 2;
+    if (matchLength == 15 && !ReadLength(data, size, &in, &matchLength)) return SIZE_MAX;
+    matchLength = std::min(matchLength + kMinMatch, capacity - written);
+    if (offset == 0 || offset > written) return SIZE_MAX;
+
+    const uint8_t* match = out + written - offset;
+
+    if (offset >= matchLength) {
+      memcpy(out + written, match, matchLength);
+    } else {
+      // Overlapping copy repeats the last `offset` bytes.
+      for (size_t k = 0; k < matchLength; k += 1) out[written + k] = match[k];
+    }
+    written += matchLength;
+  }
+
+  return written;
+}
+
+}  // namespace beam
@@ -0,0 +1,22 @@
+// LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md): a greedy single-pass compressor
+// and a bounds-checked decoder. Used for the text blocks of .beam files.
+#ifndef BEAM_ADDON_LZ4_H_
+#define BEAM_ADDON_LZ4_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace beam {
+
+inline size_t Lz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+// Compresses `size` bytes into `out`, which must hold Lz4CompressBound(size) bytes. Returns the compressed size.
+size_t Lz4Compress(const uint8_t* data, size_t size, uint8_t* out);
+
+// Decodes until the input ends or `capacity` bytes were produced, so a prefix can be decoded cheaply. Returns the
+// number of bytes written, or SIZE_MAX when the input is malformed.
+size_t Lz4Decompress(const uint8_t* data, size_t size, uint8_t* out, size_t capacity);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_LZ4_H_
@@ -0,0 +1,188 @@
+#include "mdns.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#endif
+
+namespace beam {
+
+namespace {
+
+constexpr size_t kHeaderSize = 12;
+// Compression pointers followed at most per name; real names need a handful.
+constexpr int kMaxNameHops = 32;
+
+uint16_t ReadUint16(const uint8_t* p) { return static_cast<uint16_t>(p[0] << 8 | p[1]); }
+uint32_t ReadUint32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8 |
+         p[3];
+}
+void WriteUint16(std::vector<uint8_t>* out, uint16_t value) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+// Reads the dotted name at *offset, following compression pointers, and moves *offset past it.
+bool ReadName(const uint8_t* data, size_t size, size_t* offset, std::string* name) {
+  size_t position = *offset;
+  bool jumped = false;
+  int hops = 0;
+
+  name->clear();
+  while (true) {
+    if (position >= size) return false;
+
+    uint8_t length = data[position];
+
+    if ((length & 0xc0) == 0xc0) {
+      hops += 1;
+      if (position + 1 >= size || hops > kMaxNameHops) return false;
+      if (!jumped) *offset = position + 2;
+      jumped = true;
+      position = static_cast<size_t>(length & 0x3f) << 8 | data[position + 1];
+      continue;
+    }
+    if (length & 0xc0) return false;
+    position += 1;
+    if (length == 0) break;
+    if (position + length > size || name->size() + length + 1 > 255) return false;
+    if (!name->empty()) name->push_back('.');
+    name->append(reinterpret_cast<const char*>(data + position), length);
+    position += length;
+  }
+  if (!jumped) *offset = position;
+
+  return true;
+}
+
+std::string FormatAddress(int family, const uint8_t* bytes) {
+  char text[64];
+
+  if (!inet_ntop(family, const_cast<uint8_t*>(bytes), text, sizeof(text))) return "";
+
+  return text;
+}
+
+// Reads the type-specific data of `record` from rdata[0, length).
+bool ReadRecordData(const uint8_t* data, size_t size, size_t offset, size_t length, DnsRecord* record) {
+  const uint8_t* rdata = data + offset;
+
+  switch (record->type) {
+    case kDnsA:
+      if (length != 4) return false;
+      record->data = FormatAddress(AF_INET, rdata);
+
+      return true;
+    case kDnsAaaa:
+      if (length != 16) return false;
+      record->data = FormatAddress(AF_INET6, rdata);
+
+      return true;
+    case kDnsPtr:
+      return ReadName(data, size, &offset, &record->data);
+    case kDnsSrv:
+      if (length < 7) return false;
+      record->port = ReadUint16(rdata + 4);
+      offset += 6;
+
+      return ReadName(data, size, &offset, &record->data);
+    case kDnsTxt:
+      for (size_t i = 0; i < length;) {
+        size_t stringLength = rdata[i];
+
+        if (i + 1 + stringLength > length) return false;
+        if (stringLength > 0) record->strings.emplace_back(reinterpret_cast<const char*>(rdata + i + 1), stringLength);
+        i += 1 + stringLength;
+      }
+
+      return true;
+    default:
+      return true;
+  }
+}
+
+}  // namespace
+
+std::vector<uint8_t> BuildDnsQuery(const std::vector<DnsQuestion>& questions, uint16_t id) {
+  std::vector<uint8_t> out;
+
+  WriteUint16(&out, id);
+  WriteUint16(&out, 0);
+  WriteUint16(&out, static_cast<uint16_t>(questions.size()));
+  out.resize(kHeaderSize, 0);
+  for (const DnsQuestion& question : questions) {
+    size_t start = 0;
+
+    while (start < question.name.size()) {
+      size_t end = question.name.find('.', start);
+
+      if (end == std::string::npos) end = question.name.size();
+      if (end > start && end - start <= 63) {
+        out.push_back(static_cast<uint8_t>(end - start));
+        out.insert(out.end(), question.name.begin() + static_cast<std::ptrdiff_t>(start),
+                   question.name.begin() + static_cast<std::ptrdiff_t>(end));
+      }
+      start = end + 1;
+    }
+    out.push_back(0);
+    WriteUint16(&out, question.type);
+    WriteUint16(&out, 1);
+  }
+
+  return out;
+}
+
+bool ParseDnsResponse(const uint8_t* data, size_t size, std::vector<DnsRecord>* records) {
+  if (size < kHeaderSize || !(data[2] & 0x80)) return false;
+
+  size_t questions = ReadUint16(data + 4);
+  size_t count = static_cast<size_t>(ReadUint16(data + 6)) + ReadUint16(data + 8) + ReadUint16(data + 10);
+  size_t offset = kHeaderSize;
+  std::string name;
+
+  for (size_t i = 0; i < questions; i += 1) {
+    if (!ReadName(data, size, &offset, &name) || offset + 4 > size) return false;
+    offset += 4;
+  }
+  for (size_t i = 0; i < count; i += 1) {
+    DnsRecord record;
+
+    if (!ReadName(data, size, &offset, &record.name) || offset + 10 > size) return false;
+    record.type = ReadUint16(data + offset);
+    record.ttl = ReadUint32(data + offset + 4);
+
+    size_t length = ReadUint16(data + offset + 8);
+
+    offset += 10;
+    if (offset + length > size) return false;
+    if (record.type == kDnsA || record.type == kDnsAaaa || record.type == kDnsPtr || record.type == kDnsSrv ||
+        record.type == kDnsTxt) {
+      if (!ReadRecordData(data, size, offset, length, &record)) return false;
+      records->push_back(std::move(record));
+    }
+    offset += length;
+  }
+
+  return true;
+}
+
+bool SameDnsName(const std::string& a, const std::string& b) {
+  size_t aLength = !a.empty() && a.back() == '.' ? a.size() - 1 : a.size();
+  size_t bLength = !b.empty() && b.back() == '.' ? b.size() - 1 : b.size();
+
+  if (aLength != bLength) return false;
+  for (size_t i = 0; i < aLength; i += 1) {
+    char x = a[i] >= 'A' && a[i] <= 'Z' ? static_cast<char>(a[i] + 32) : a[i];
+    char y = b[i] >= 'A' && b[i] <= 'Z' ? static_cast<char>(b[i] + 32) : b[i];
+
+    if (x != y) return false;
+  }
+
+  return true;
+}
+
+}  // namespace beam
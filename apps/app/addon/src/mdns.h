@@ -0,0 +1,49 @@
+// Multicast DNS (RFC 6762) messages, as far as device discovery needs them: queries for host addresses and service
+// instances, and the address, PTR, SRV and TXT records of the responses. Compressed names are followed with a hop
+// limit, so a malformed packet cannot loop.
+#ifndef BEAM_ADDON_MDNS_H_
+#define BEAM_ADDON_MDNS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace beam {
+
+constexpr uint16_t kDnsA = 1;
+constexpr uint16_t kDnsPtr = 12;
+constexpr uint16_t kDnsTxt = 16;
+constexpr uint16_t kDnsAaaa = 28;
+constexpr uint16_t kDnsSrv = 33;
+
+struct DnsQuestion {
+  // Dotted, e.g. "raspberrypi.local" or "_http._tcp.local".
+  std::string name;
+  uint16_t type;
+};
+
+struct DnsRecord {
+  std::string name;
+  uint16_t type = 0;
+  uint32_t ttl = 0;
+  // A and AAAA: the numeric address; PTR and SRV: the name pointed to.
+  std::string data;
+  // SRV only.
+  uint16_t port = 0;
+  // TXT only.
+  std::vector<std::string> strings;
+};
+
+std::vector<uint8_t> BuildDnsQuery(const std::vector<DnsQuestion>& questions, uint16_t id);
+
+// Appends the answer, authority and additional records of a response to `records`, skipping types other than those
+// above; false when the message is not a well-formed response.
+bool ParseDnsResponse(const uint8_t* data, size_t size, std::vector<DnsRecord>* records);
+
+// DNS names compare case-insensitively, with or without the trailing dot.
+bool SameDnsName(const std::string& a, const std::string& b);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_MDNS_H_
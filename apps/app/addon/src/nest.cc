@@ -0,0 +1,643 @@
+#include "nest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+#include "parallel.h"
+#include "simplify.h"
+
+namespace beam {
+
+namespace {
+
+constexpr double kEpsilon = 1e-7;
+// Pairwise NFP edge intersections are extra candidates; skip them when a part already has this many.
+constexpr size_t kMaxIntersectionCandidates = 200000;
+constexpr int kMaxGridCells = 64;
+constexpr int kSpacingDiscSides = 16;
+
+Polygon RotatePolygon(const Polygon& polygon, double degrees) {
+  double angle = degrees * kPi / 180;
+  double c = std::cos(angle);
+  double s = std::sin(angle);
+  Polygon rotated(polygon.size());
+
+  for (size_t i = 0; i < polygon.size(); i += 1) {
+    rotated[i] = {polygon[i].x * c - polygon[i].y * s, polygon[i].x * s + polygon[i].y * c};
+  }
+
+  return rotated;
+}
+
+Polygon Translate(const Polygon& polygon, Vec2 offset) {
+  Polygon translated(polygon.size());
+
+  for (size_t i = 0; i < polygon.size(); i += 1) translated[i] = polygon[i] + offset;
+
+  return translated;
+}
+
+// Drops the repeated closing vertex and simplifies with RDP, like svg-nest's curveTolerance cleanup.
+Polygon CleanPolygon(const Polygon& input, double tolerance) {
+  Polygon polygon = input;
+
+  while (polygon.size() > 1 && polygon.front().x == polygon.back().x && polygon.front().y == polygon.back().y) {
+    polygon.pop_back();
+  }
+  if (polygon.size() > 3 && tolerance > 0) {
+    std::vector<double> xy;
+    std::vector<double> simplified;
+
+    for (const Vec2& p : polygon) {
+      xy.push_back(p.x);
+      xy.push_back(p.y);
+    }
+    xy.push_back(polygon[0].x);
+    xy.push_back(polygon[0].y);
+    SimplifyRdp(xy.data(), polygon.size() + 1, tolerance, simplified);
+    if (simplified.size() >= 8) {
+      polygon.clear();
+      for (size_t i = 0; i + 2 < simplified.size(); i += 2) polygon.push_back({simplified[i], simplified[i + 1]});
+    }
+  }
+  if (polygon.size() < 3) {
+    // Lines and points nest as their (possibly degenerate) bounding box.
+    Bounds bounds = PolygonBounds(polygon);
+
+    polygon = {{bounds.minX, bounds.minY}, {bounds.maxX, bounds.minY}, {bounds.maxX, bounds.maxY},
+               {bounds.minX, bounds.maxY}};
+  }
+  if (SignedArea(polygon) < 0) std::reverse(polygon.begin(), polygon.end());
+
+  return polygon;
+}
+
+int Sign(double value) { return value > kEpsilon ? 1 : (value < -kEpsilon ? -1 : 0); }
+
+bool SegmentsCrossProperly(Vec2 a, Vec2 b, Vec2 c, Vec2 d) {
+  int o1 = Sign(Cross(b - a, c - a));
+  int o2 = Sign(Cross(b - a, d - a));
+  int o3 = Sign(Cross(d - c, a - c));
+  int o4 = Sign(Cross(d - c, b - c));
+
+  return o1 * o2 < 0 && o3 * o4 < 0;
+}
+
+bool SegmentIntersection(Vec2 a, Vec2 b, Vec2 c, Vec2 d, Vec2* out) {
+  Vec2 r = b - a;
+  Vec2 s = d - c;
+  double denominator = Cross(r, s);
+
+  if (std::fabs(denominator) < 1e-12) return false;
+
+  double t = Cross(c - a, s) / denominator;
+  double u = Cross(c - a, r) / denominator;
+
+  if (t < 0 || t > 1 || u < 0 || u > 1) return false;
+  *out = a + r * t;
+
+  return true;
+}
+
+bool InsideBounds(Vec2 p, const Bounds& bounds) {
+  return p.x >= bounds.minX - kEpsilon && p.x <= bounds.maxX + kEpsilon && p.y >= bounds.minY - kEpsilon &&
+         p.y <= bounds.maxY + kEpsilon;
+}
+
+// Uniform grid over the inner-fit rectangle used to find the NFP pieces that may contain a candidate position.
+class PieceGrid {
+ public:
+  struct Entry {
+    const Polygon* piece;
+    Bounds bounds;
+    Vec2 offset;
+  };
+
+  void Reset(const Bounds& area, size_t pieceCount) {
+    area_ = area;
+    cells_ = std::max(1, std::min(kMaxGridCells, static_cast<int>(std::sqrt(static_cast<double>(pieceCount)))));
+    cellWidth_ = std::max(area.Width() / cells_, kEpsilon);
+    cellHeight_ = std::max(area.Height() / cells_, kEpsilon);
+    grid_.assign(static_cast<size_t>(cells_) * cells_, std::vector<Entry>());
+  }
+
+  void Insert(const Polygon* piece, const Bounds& pieceBounds, Vec2 offset) {
+    Bounds bounds = {pieceBounds.minX + offset.x, pieceBounds.minY + offset.y, pieceBounds.maxX + offset.x,
+                     pieceBounds.maxY + offset.y};
+
+    if (!bounds.Intersects(area_)) return;
+
+    int x0 = CellX(bounds.minX), x1 = CellX(bounds.maxX), y0 = CellY(bounds.minY), y1 = CellY(bounds.maxY);
+
+    for (int y = y0; y <= y1; y += 1) {
+      for (int x = x0; x <= x1; x += 1) grid_[static_cast<size_t>(y) * cells_ + x].push_back({piece, bounds, offset});
+    }
+  }
+
+  bool IsFree(Vec2 p) const {
+    for (const Entry& entry : grid_[static_cast<size_t>(CellY(p.y)) * cells_ + CellX(p.x)]) {
+      if (p.x <= entry.bounds.minX || p.x >= entry.bounds.maxX || p.y <= entry.bounds.minY ||
+          p.y >= entry.bounds.maxY) {
+        continue;
+      }
+      if (PointStrictlyInsideConvex(p - entry.offset, *entry.piece, kEpsilon)) return false;
+    }
+
+    return true;
+  }
+
+ private:
+  int CellX(double x) const {
+    return std::max(0, std::min(cells_ - 1, static_cast<int>((x - area_.minX) / cellWidth_)));
+  }
+  int CellY(double y) const {
+    return std::max(0, std::min(cells_ - 1, static_cast<int>((y - area_.minY) / cellHeight_)));
+  }
+
+  Bounds area_;
+  int cells_ = 1;
+  double cellWidth_ = 1;
+  double cellHeight_ = 1;
+  std::vector<std::vector<Entry>> grid_;
+};
+
+}  // namespace
+
+NestEngine::NestEngine(const Polygon& container, const std::vector<Polygon>& parts, const NestConfig& config)
+    : config_(config), random_(config.seed) {
+  int rotations = std::max(config_.rotations, 1);
+
+  for (int i = 0; i < rotations; i += 1) angles_.push_back(i * (360.0 / rotations));
+
+  container_ = CleanPolygon(container, 0);
+  containerBounds_ = PolygonBounds(container_);
+  containerArea_ = std::fabs(SignedArea(container_));
+  rectangularContainer_ =
+      std::fabs(containerBounds_.Width() * containerBounds_.Height() - containerArea_) <= 1e-6 * containerArea_;
+
+  // Identical outlines (up to translation) share one shape, so copies of a part share their NFPs.
+  std::map<std::vector<double>, uint32_t> shapeIds;
+
+  for (const Polygon& input : parts) {
+    Polygon polygon = CleanPolygon(input, config_.curveTolerance);
+    Bounds bounds = PolygonBounds(polygon);
+    Polygon relative = Translate(polygon, {-bounds.minX, -bounds.minY});
+    std::vector<double> key;
+    Part part;
+
+    for (const Vec2& p : relative) {
+      key.push_back(std::round(p.x * 1e6));
+      key.push_back(std::round(p.y * 1e6));
+    }
+
+    auto found = shapeIds.find(key);
+
+    if (found == shapeIds.end()) {
+      Shape shape;
+
+      for (double angle : angles_) {
+        Polygon rotated = RotatePolygon(relative, angle);
+        Bounds rotatedBounds = PolygonBounds(rotated);
+        Polygon outline = Translate(rotated, {-rotatedBounds.minX, -rotatedBounds.minY});
+        std::vector<Polygon> pieces;
+
+        ConvexDecompose(outline, pieces);
+        shape.outlines.push_back(outline);
+        shape.pieces.push_back(pieces);
+        shape.sizes.push_back({rotatedBounds.Width(), rotatedBounds.Height()});
+      }
+      found = shapeIds.emplace(key, static_cast<uint32_t>(shapes_.size())).first;
+      shapes_.push_back(std::move(shape));
+    }
+
+    part.shape = found->second;
+    for (double angle : angles_) {
+      Bounds rotatedBounds = PolygonBounds(RotatePolygon(polygon, angle));
+
+      part.origins.push_back({rotatedBounds.minX, rotatedBounds.minY});
+    }
+    parts_.push_back(std::move(part));
+  }
+
+  // Seed with decreasing area, random rotations, then fill the population with mutants.
+  Individual adam;
+  std::vector<double> areas(parts_.size());
+
+  for (uint32_t i = 0; i < parts_.size(); i += 1) {
+    adam.order.push_back(i);
+    areas[i] = std::fabs(SignedArea(shapes_[parts_[i].shape].outlines[0]));
+  }
+  std::stable_sort(adam.order.begin(), adam.order.end(), [&](uint32_t a, uint32_t b) { return areas[a] > areas[b]; });
+  for (uint32_t part : adam.order) adam.rotations.push_back(RandomRotation(part));
+  population_.push_back(adam);
+  while (static_cast<int>(population_.size()) < std::max(config_.populationSize, 1)) {
+    population_.push_back(Mutate(population_[0]));
+  }
+}
+
+size_t NestEngine::CachedNfpCount() {
+  std::lock_guard<std::mutex> lock(cacheMutex_);
+
+  return nfpCache_.size();
+}
+
+std::shared_ptr<const NestEngine::Nfp> NestEngine::GetNfp(uint32_t shapeA, uint16_t rotationA, uint32_t shapeB,
+                                                          uint16_t rotationB) {
+  uint64_t key = (static_cast<uint64_t>(shapeA * angles_.size() + rotationA) << 32) |
+                 static_cast<uint64_t>(shapeB * angles_.size() + rotationB);
+
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    auto found = nfpCache_.find(key);
+
+    if (found != nfpCache_.end()) return found->second;
+  }
+
+  std::shared_ptr<Nfp> nfp = std::make_shared<Nfp>();
+  Polygon disc;
+  Polygon sum;
+
+  if (config_.spacing > 0) {
+    double radius = config_.spacing / std::cos(kPi / kSpacingDiscSides);
+
+    for (int i = 0; i < kSpacingDiscSides; i += 1) {
+      double angle = 2 * kPi * i / kSpacingDiscSides;
+
+      disc.push_back({radius * std::cos(angle), radius * std::sin(angle)});
+    }
+  }
+  // Positions of B's origin where B overlaps A: A ⊕ (−B), per pair of convex pieces.
+  for (const Polygon& a : shapes_[shapeA].pieces[rotationA]) {
+    for (const Polygon& b : shapes_[shapeB].pieces[rotationB]) {
+      Polygon negated(b.size());
+
+      for (size_t i = 0; i < b.size(); i += 1) negated[i] = -b[i];
+      MinkowskiSumConvex(a, negated, sum);
+      if (!disc.empty()) {
+        Polygon inflated;
+
+        MinkowskiSumConvex(sum, disc, inflated);
+        sum.swap(inflated);
+      }
+      if (sum.size() < 3) continue;
+      nfp->pieceBounds.push_back(PolygonBounds(sum));
+      nfp->bounds.Add(nfp->pieceBounds.back());
+      nfp->pieces.push_back(sum);
+    }
+  }
+
+  // An edge with both ends strictly inside one other (convex) piece is interior to the union.
+  for (size_t i = 0; i < nfp->pieces.size(); i += 1) {
+    const Polygon& piece = nfp->pieces[i];
+
+    for (size_t k = 0, l = piece.size() - 1; k < piece.size(); l = k, k += 1) {
+      NfpEdge edge = {piece[l], piece[k], Bounds()};
+      bool interior = false;
+
+      edge.bounds.Add(edge.a);
+      edge.bounds.Add(edge.b);
+      for (size_t j = 0; j < nfp->pieces.size() && !interior; j += 1) {
+        if (j == i || !nfp->pieceBounds[j].Intersects(edge.bounds)) continue;
+        interior = PointStrictlyInsideConvex(edge.a, nfp->pieces[j], kEpsilon) &&
+                   PointStrictlyInsideConvex(edge.b, nfp->pieces[j], kEpsilon);
+      }
+      if (!interior) nfp->edges.push_back(edge);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(cacheMutex_);
+
+  return nfpCache_.emplace(key, nfp).first->second;
+}
+
+bool NestEngine::FitsContainer(const Polygon& outline, Vec2 offset) const {
+  for (const Vec2& p : outline) {
+    if (!PointInPolygon(p + offset, container_)) {
+      // Accept vertices lying on the container boundary.
+      bool onBoundary = false;
+
+      for (size_t i = 0, j = container_.size() - 1; i < container_.size() && !onBoundary; j = i, i += 1) {
+        Vec2 edge = container_[i] - container_[j];
+        Vec2 q = p + offset - container_[j];
+        double t = Dot(q, edge) / std::max(Dot(edge, edge), 1e-300);
+
+        onBoundary = t >= 0 && t <= 1 && Length(q - edge * t) <= 1e-6;
+      }
+      if (!onBoundary) return false;
+    }
+  }
+  for (size_t i = 0, j = outline.size() - 1; i < outline.size(); j = i, i += 1) {
+    for (size_t k = 0, l = container_.size() - 1; k < container_.size(); l = k, k += 1) {
+      if (SegmentsCrossProperly(outline[j] + offset, outline[i] + offset, container_[l], container_[k])) return false;
+    }
+  }
+
+  return true;
+}
+
+NestResult NestEngine::Evaluate(const Individual& individual, const std::atomic<bool>& stop) {
+  struct Placed {
+    uint32_t part;
+    uint16_t rotation;
+    Vec2 position;
+  };
+  struct PlacedNfp {
+    std::shared_ptr<const Nfp> nfp;
+    Vec2 offset;
+  };
+
+  NestResult result;
+  std::vector<std::pair<uint32_t, uint16_t>> remaining;
+  std::vector<Vec2> candidates;
+  std::vector<std::pair<std::pair<double, double>, size_t>> ranked;
+  std::vector<PlacedNfp> nfps;
+  std::vector<NfpEdge> edgesB;
+  PieceGrid grid;
+  uint32_t bin = 0;
+
+  result.fitness = 0;
+  for (size_t i = 0; i < individual.order.size(); i += 1) {
+    remaining.emplace_back(individual.order[i], individual.rotations[i]);
+  }
+
+  while (!remaining.empty() && !stop) {
+    std::vector<Placed> placed;
+    std::vector<uint8_t> isPlaced(remaining.size(), 0);
+    Bounds binBounds;
+
+    result.fitness += 1;
+    for (size_t r = 0; r < remaining.size() && !stop; r += 1) {
+      uint32_t partIndex = remaining[r].first;
+      uint16_t rotation = remaining[r].second;
+      const Shape& shape = shapes_[parts_[partIndex].shape];
+      Vec2 size = shape.sizes[rotation];
+      const Polygon& outline = shape.outlines[rotation];
+      double margin = config_.spacing;
+      Bounds ifp = {containerBounds_.minX + margin, containerBounds_.minY + margin,
+                    containerBounds_.maxX - margin - size.x, containerBounds_.maxY - margin - size.y};
+
+      if (ifp.minX > ifp.maxX + kEpsilon || ifp.minY > ifp.maxY + kEpsilon) continue;
+      ifp.maxX = std::max(ifp.maxX, ifp.minX);
+      ifp.maxY = std::max(ifp.maxY, ifp.minY);
+
+      candidates.clear();
+      candidates.push_back({ifp.minX, ifp.minY});
+      candidates.push_back({ifp.maxX, ifp.minY});
+      candidates.push_back({ifp.minX, ifp.maxY});
+      candidates.push_back({ifp.maxX, ifp.maxY});
+      if (!rectangularContainer_) {
+        // Positions where a part vertex touches a container vertex.
+        for (const Vec2& c : container_) {
+          for (const Vec2& p : outline) candidates.push_back(c - p);
+        }
+      }
+
+      nfps.clear();
+      for (const Placed& other : placed) {
+        nfps.push_back({GetNfp(parts_[other.part].shape, other.rotation, parts_[partIndex].shape, rotation),
+                        other.position});
+      }
+
+      size_t pieceCount = 0;
+
+      for (const PlacedNfp& entry : nfps) {
+        pieceCount += entry.nfp->pieces.size();
+        for (const NfpEdge& edge : entry.nfp->edges) {
+          Vec2 a = edge.a + entry.offset;
+          Vec2 b = edge.b + entry.offset;
+          Vec2 hit;
+
+          candidates.push_back(b);
+          // Where NFP edges cross the inner-fit rectangle, the part slides along the container wall.
+          if (SegmentIntersection(a, b, {ifp.minX, ifp.minY}, {ifp.maxX, ifp.minY}, &hit)) candidates.push_back(hit);
+          if (SegmentIntersection(a, b, {ifp.maxX, ifp.minY}, {ifp.maxX, ifp.maxY}, &hit)) candidates.push_back(hit);
+          if (SegmentIntersection(a, b, {ifp.maxX, ifp.maxY}, {ifp.minX, ifp.maxY}, &hit)) candidates.push_back(hit);
+          if (SegmentIntersection(a, b, {ifp.minX, ifp.maxY}, {ifp.minX, ifp.minY}, &hit)) candidates.push_back(hit);
+        }
+      }
+      // Corners formed by two neighbouring parts are crossings of their NFP edges.
+      for (size_t i = 0; i < nfps.size() && candidates.size() < kMaxIntersectionCandidates; i += 1) {
+        for (size_t j = i + 1; j < nfps.size() && candidates.size() < kMaxIntersectionCandidates; j += 1) {
+          const Nfp& a = *nfps[i].nfp;
+          const Nfp& b = *nfps[j].nfp;
+          Vec2 offset = nfps[j].offset - nfps[i].offset;
+          Bounds shiftedB = {b.bounds.minX + offset.x, b.bounds.minY + offset.y, b.bounds.maxX + offset.x,
+                             b.bounds.maxY + offset.y};
+          Bounds shiftedA = {a.bounds.minX - offset.x, a.bounds.minY - offset.y, a.bounds.maxX - offset.x,
+                             a.bounds.maxY - offset.y};
+
+          if (!a.bounds.Intersects(shiftedB)) continue;
+          edgesB.clear();
+          for (const NfpEdge& edge : b.edges) {
+            if (edge.bounds.Intersects(shiftedA)) {
+              edgesB.push_back({edge.a + offset, edge.b + offset, Bounds()});
+              edgesB.back().bounds.Add(edgesB.back().a);
+              edgesB.back().bounds.Add(edgesB.back().b);
+            }
+          }
+          for (const NfpEdge& ea : a.edges) {
+            if (!ea.bounds.Intersects(shiftedB)) continue;
+            for (const NfpEdge& eb : edgesB) {
+              Vec2 hit;
+
+              if (ea.bounds.Intersects(eb.bounds) && SegmentIntersection(ea.a, ea.b, eb.a, eb.b, &hit)) {
+                candidates.push_back(hit + nfps[i].offset);
+              }
+            }
+          }
+        }
+      }
+
+      grid.Reset(ifp, pieceCount);
+      for (const PlacedNfp& entry : nfps) {
+        for (size_t i = 0; i < entry.nfp->pieces.size(); i += 1) {
+          grid.Insert(&entry.nfp->pieces[i], entry.nfp->pieceBounds[i], entry.offset);
+        }
+      }
+
+      // Rank by the svg-nest gravity metric (bounding box width weighted twice), then by x.
+      ranked.clear();
+      for (size_t i = 0; i < candidates.size(); i += 1) {
+        const Vec2& c = candidates[i];
+
+        if (!InsideBounds(c, ifp)) continue;
+
+        Bounds merged = binBounds;
+
+        merged.Add(c);
+        merged.Add(c + size);
+        ranked.push_back({{placed.empty() ? c.x : merged.Width() * 2 + merged.Height(), c.x}, i});
+      }
+      std::sort(ranked.begin(), ranked.end());
+
+      for (const auto& entry : ranked) {
+        Vec2 position = candidates[entry.second];
+
+        position.x = std::min(std::max(position.x, ifp.minX), ifp.maxX);
+        position.y = std::min(std::max(position.y, ifp.minY), ifp.maxY);
+        if (!grid.IsFree(position)) continue;
+        if (!rectangularContainer_ && !FitsContainer(outline, position)) continue;
+
+        placed.push_back({partIndex, rotation, position});
+        binBounds.Add(position);
+        binBounds.Add(position + size);
+        isPlaced[r] = 1;
+        break;
+      }
+    }
+
+    if (placed.empty()) break;
+
+    for (const Placed& p : placed) {
+      Vec2 origin = parts_[p.part].origins[p.rotation];
+
+      result.placements.push_back({p.part, bin, p.position.x - origin.x, p.position.y - origin.y,
+                                   angles_[p.rotation]});
+    }
+    result.fitness += binBounds.Width() / containerArea_;
+
+    std::vector<std::pair<uint32_t, uint16_t>> next;
+
+    for (size_t r = 0; r < remaining.size(); r += 1) {
+      if (!isPlaced[r]) next.push_back(remaining[r]);
+    }
+    remaining.swap(next);
+    bin += 1;
+  }
+
+  result.unplaced = remaining.size();
+  result.fitness += 2.0 * remaining.size();
+
+  return result;
+}
+
+uint16_t NestEngine::RandomRotation(uint32_t part) {
+  const Shape& shape = shapes_[parts_[part].shape];
+  std::vector<uint16_t> order(angles_.size());
+
+  for (size_t i = 0; i < order.size(); i += 1) order[i] = static_cast<uint16_t>(i);
+  std::shuffle(order.begin(), order.end(), random_);
+  // Don't use obviously bad angles where the part doesn't fit in the bin.
+  for (uint16_t rotation : order) {
+    if (shape.sizes[rotation].x <= containerBounds_.Width() + kEpsilon &&
+        shape.sizes[rotation].y <= containerBounds_.Height() + kEpsilon) {
+      return rotation;
+    }
+  }
+
+  return 0;
+}
+
+NestEngine::Individual NestEngine::Mutate(const Individual& individual) {
+  std::uniform_real_distribution<double> uniform(0, 1);
+  Individual clone = individual;
+
+  clone.fitness = NAN;
+  for (size_t i = 0; i < clone.order.size(); i += 1) {
+    if (uniform(random_) < 0.01 * config_.mutationRate && i + 1 < clone.order.size()) {
+      std::swap(clone.order[i], clone.order[i + 1]);
+      std::swap(clone.rotations[i], clone.rotations[i + 1]);
+    }
+    if (uniform(random_) < 0.01 * config_.mutationRate) clone.rotations[i] = RandomRotation(clone.order[i]);
+  }
+
+  return clone;
+}
+
+// Single point crossover.
+void NestEngine::Mate(const Individual& male, const Individual& female, Individual& child1, Individual& child2) {
+  std::uniform_real_distribution<double> uniform(0, 1);
+  size_t cutpoint = static_cast<size_t>(
+      std::round(std::min(std::max(uniform(random_), 0.1), 0.9) * (static_cast<double>(male.order.size()) - 1)));
+  auto cross = [&](const Individual& first, const Individual& second, Individual& child) {
+    std::vector<uint8_t> used(parts_.size(), 0);
+
+    child.order.assign(first.order.begin(), first.order.begin() + cutpoint);
+    child.rotations.assign(first.rotations.begin(), first.rotations.begin() + cutpoint);
+    child.fitness = NAN;
+    for (uint32_t part : child.order) used[part] = 1;
+    for (size_t i = 0; i < second.order.size(); i += 1) {
+      if (used[second.order[i]]) continue;
+      child.order.push_back(second.order[i]);
+      child.rotations.push_back(second.rotations[i]);
+    }
+  };
+
+  cross(male, female, child1);
+  cross(female, male, child2);
+}
+
+// Rank-weighted selection towards the front of the sorted population.
+const NestEngine::Individual& NestEngine::RandomWeightedIndividual(const Individual* exclude) {
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::vector<const Individual*> pool;
+
+  for (const Individual& individual : population_) {
+    if (&individual != exclude) pool.push_back(&individual);
+  }
+
+  double rand = uniform(random_);
+  double weight = 1.0 / pool.size();
+  double lower = 0;
+  double upper = weight;
+
+  for (size_t i = 0; i < pool.size(); i += 1) {
+    if (rand > lower && rand < upper) return *pool[i];
+    lower = upper;
+    upper += 2 * weight * (static_cast<double>(pool.size() - i) / pool.size());
+  }
+
+  return *pool[0];
+}
+
+bool NestEngine::Step(const std::atomic<bool>& stop, const std::function<void(double)>& onProgress) {
+  std::vector<size_t> pending;
+
+  for (size_t i = 0; i < population_.size(); i += 1) {
+    if (std::isnan(population_[i].fitness)) pending.push_back(i);
+  }
+
+  std::vector<NestResult> results(pending.size());
+  std::atomic<size_t> done(0);
+  bool improved = false;
+
+  ParallelFor(pending.size(), [&](size_t i) {
+    if (stop) return;
+    results[i] = Evaluate(population_[pending[i]], stop);
+    onProgress(static_cast<double>(done.fetch_add(1) + 1) / pending.size());
+  });
+  if (stop) return false;
+
+  for (size_t i = 0; i < pending.size(); i += 1) {
+    population_[pending[i]].fitness = results[i].fitness;
+    if (results[i].fitness < best_.fitness) {
+      best_ = std::move(results[i]);
+      improved = true;
+    }
+  }
+
+  // Breed the next generation, keeping the fittest individual (elitism).
+  std::stable_sort(population_.begin(), population_.end(),
+                   [](const Individual& a, const Individual& b) { return a.fitness < b.fitness; });
+
+  std::vector<Individual> next = {population_[0]};
+
+  while (next.size() < population_.size()) {
+    const Individual& male = RandomWeightedIndividual(nullptr);
+    const Individual& female = RandomWeightedIndividual(population_.size() > 1 ? &male : nullptr);
+    Individual child1;
+    Individual child2;
+
+    Mate(male, female, child1, child2);
+    next.push_back(Mutate(child1));
+    if (next.size() < population_.size()) next.push_back(Mutate(child2));
+  }
+  population_.swap(next);
+  generation_ += 1;
+
+  return improved;
+}
+
+}  // namespace beam
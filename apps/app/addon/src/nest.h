@@ -0,0 +1,115 @@
+// Native nesting engine following the svg-nest design (genetic algorithm over insertion order and rotation, greedy
+// bottom-left placement on no-fit polygons), see packages/core/public/js/lib/svg-nest/svgnest.js.
+//
+// Instead of Clipper unions, every no-fit polygon is kept as the set of convex Minkowski sums between the convex
+// pieces of both parts. A position is free when it is not strictly inside any of those pieces, which keeps the NFPs
+// exact for concave parts and cheap to cache.
+#ifndef BEAM_ADDON_NEST_H_
+#define BEAM_ADDON_NEST_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "polygon.h"
+
+namespace beam {
+
+struct NestConfig {
+  double spacing = 0;
+  int rotations = 4;
+  int populationSize = 10;
+  int mutationRate = 10;  // percent
+  double curveTolerance = 0.3;
+  uint32_t seed = 0;
+};
+
+struct NestPlacement {
+  uint32_t part;
+  uint32_t bin;
+  // The part is rotated by `rotation` degrees around the origin, then translated by (x, y).
+  double x;
+  double y;
+  double rotation;
+};
+
+struct NestResult {
+  double fitness = INFINITY;
+  std::vector<NestPlacement> placements;
+  size_t unplaced = 0;
+};
+
+class NestEngine {
+ public:
+  NestEngine(const Polygon& container, const std::vector<Polygon>& parts, const NestConfig& config);
+
+  // Evaluates the population (in parallel) and breeds the next generation.
+  // onProgress receives the fraction of the current generation that is done. Returns true when a new best was found.
+  bool Step(const std::atomic<bool>& stop, const std::function<void(double)>& onProgress);
+
+  const NestResult& Best() const { return best_; }
+  int Generation() const { return generation_; }
+  size_t CachedNfpCount();
+
+ private:
+  struct Shape {
+    // Convex pieces of the normalized (bbox min at origin) rotated polygon, per rotation.
+    std::vector<std::vector<Polygon>> pieces;
+    std::vector<Polygon> outlines;
+    std::vector<Vec2> sizes;
+  };
+  struct Part {
+    uint32_t shape;
+    std::vector<Vec2> origins;  // bbox min of the rotated input polygon, per rotation
+  };
+  struct NfpEdge {
+    Vec2 a;
+    Vec2 b;
+    Bounds bounds;
+  };
+  struct Nfp {
+    std::vector<Polygon> pieces;
+    std::vector<Bounds> pieceBounds;
+    // Piece edges that can lie on the boundary of the union; edges inside another piece never yield a free position.
+    std::vector<NfpEdge> edges;
+    Bounds bounds;
+  };
+  struct Individual {
+    std::vector<uint32_t> order;
+    std::vector<uint16_t> rotations;  // rotation index for order[i]
+    double fitness = NAN;
+  };
+
+  std::shared_ptr<const Nfp> GetNfp(uint32_t shapeA, uint16_t rotationA, uint32_t shapeB, uint16_t rotationB);
+  NestResult Evaluate(const Individual& individual, const std::atomic<bool>& stop);
+  bool FitsContainer(const Polygon& outline, Vec2 offset) const;
+  uint16_t RandomRotation(uint32_t part);
+  Individual Mutate(const Individual& individual);
+  void Mate(const Individual& male, const Individual& female, Individual& child1, Individual& child2);
+  const Individual& RandomWeightedIndividual(const Individual* exclude);
+
+  NestConfig config_;
+  Polygon container_;
+  Bounds containerBounds_;
+  bool rectangularContainer_;
+  double containerArea_;
+  std::vector<double> angles_;
+  std::vector<Shape> shapes_;
+  std::vector<Part> parts_;
+  std::vector<Individual> population_;
+  NestResult best_;
+  int generation_ = 0;
+  std::mt19937 random_;
+  std::mutex cacheMutex_;
+  // Persistent across generations: keyed by (shape, rotation) of both parts.
+  std::unordered_map<uint64_t, std::shared_ptr<const Nfp>> nfpCache_;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_NEST_H_
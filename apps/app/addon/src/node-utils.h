@@ -0,0 +1,188 @@
+// Small helpers shared by the addon bindings for moving packed buffers between V8 and native code.
+#ifndef BEAM_ADDON_NODE_UTILS_H_
+#define BEAM_ADDON_NODE_UTILS_H_
+
+#include <node.h>
+
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace beam {
+
+using v8::ArrayBuffer;
+using v8::Context;
+using v8::Exception;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::String;
+using v8::TypedArray;
+using v8::Value;
+
+inline Local<String> NewString(Isolate* isolate, const char* str) {
+  return String::NewFromUtf8(isolate, str).ToLocalChecked();
+}
+
+inline void ThrowTypeError(Isolate* isolate, const char* message) {
+  isolate->ThrowException(Exception::TypeError(NewString(isolate, message)));
+}
+
+inline void ThrowError(Isolate* isolate, const char* message) {
+  isolate->ThrowException(Exception::Error(NewString(isolate, message)));
+}
+
+// Pointer to the first element of a typed array view, honouring its byte offset.
+template <typename T>
+inline T* TypedArrayData(Local<TypedArray> array) {
+  char* base = static_cast<char*>(array->Buffer()->GetBackingStore()->Data());
+
+  return reinterpret_cast<T*>(base + array->ByteOffset());
+}
+
+inline char* ArrayBufferData(Local<ArrayBuffer> buffer) {
+  return static_cast<char*>(buffer->GetBackingStore()->Data());
+}
+
+// Output buffers are always allocated by V8 and filled by copy: Electron runs with the V8 memory cage enabled and
+// rejects ArrayBuffers that wrap externally allocated memory.
+template <typename ArrayT, typename T>
+inline Local<ArrayT> NewTypedArray(Isolate* isolate, const T* data, size_t length) {
+  Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, length * sizeof(T));
+
+  if (length > 0) memcpy(ArrayBufferData(buffer), data, length * sizeof(T));
+
+  return ArrayT::New(buffer, 0, length);
+}
+
+template <typename ArrayT, typename T>
+inline Local<ArrayT> NewTypedArray(Isolate* isolate, const std::vector<T>& data) {
+  return NewTypedArray<ArrayT, T>(isolate, data.data(), data.size());
+}
+
+inline Local<Value> GetProperty(Isolate* isolate, Local<Object> object, const char* key) {
+  Local<Context> context = isolate->GetCurrentContext();
+  Local<Value> value;
+
+  if (!object->Get(context, NewString(isolate, key)).ToLocal(&value)) return v8::Undefined(isolate);
+
+  return value;
+}
+
+inline void SetProperty(Isolate* isolate, Local<Object> object, const char* key, Local<Value> value) {
+  object->Set(isolate->GetCurrentContext(), NewString(isolate, key), value).Check();
+}
+
+// Reads a numeric field from an optional options object, falling back when it is missing or not a number.
+inline double GetNumberOption(Isolate* isolate, Local<Value> options, const char* key, double fallback) {
+  if (!options->IsObject()) return fallback;
+
+  Local<Value> value = GetProperty(isolate, options.As<Object>(), key);
+
+  return value->IsNumber() ? value.As<v8::Number>()->Value() : fallback;
+}
+
+inline bool GetBooleanOption(Isolate* isolate, Local<Value> options, const char* key, bool fallback) {
+  if (!options->IsObject()) return fallback;
+
+  Local<Value> value = GetProperty(isolate, options.As<Object>(), key);
+
+  return value->IsBoolean() ? value->IsTrue() : fallback;
+}
+
+inline std::string ToStdString(Isolate* isolate, Local<Value> value) {
+  v8::String::Utf8Value utf8(isolate, value);
+
+  return *utf8 ? std::string(*utf8, utf8.length()) : std::string();
+}
+
+// UTF-8 bytes of a string with lone surrogates replaced by U+FFFD, the same bytes Buffer.from(string) produces.
+inline std::string ToUtf8(Isolate* isolate, Local<String> value) {
+  std::string result;
+
+#if V8_MAJOR_VERSION >= 14
+  result.resize(value->Utf8LengthV2(isolate));
+  value->WriteUtf8V2(isolate, &result[0], result.size(), String::WriteFlags::kReplaceInvalidUtf8);
+#else
+  result.resize(value->Utf8Length(isolate));
+  value->WriteUtf8(isolate, &result[0], static_cast<int>(result.size()), nullptr,
+                   String::NO_NULL_TERMINATION | String::REPLACE_INVALID_UTF8);
+#endif
+
+  return result;
+}
+
+// UTF-16 code units of a string, indexed the way JS indexes it.
+inline void ToUtf16(Isolate* isolate, Local<String> value, std::vector<uint16_t>* result) {
+  result->resize(value->Length());
+  if (result->empty()) return;
+#if V8_MAJOR_VERSION >= 14
+  value->WriteV2(isolate, 0, static_cast<uint32_t>(result->size()), result->data());
+#else
+  value->Write(isolate, result->data(), 0, static_cast<int>(result->size()), String::NO_NULL_TERMINATION);
+#endif
+}
+
+// Byte range of an ArrayBuffer or view. The backing store keeps the bytes alive while native code works on them
+// off the JS thread.
+inline bool ReadBytes(Local<Value> value, std::shared_ptr<v8::BackingStore>* store, size_t* offset, size_t* length) {
+  if (value->IsArrayBuffer()) {
+    *store = value.As<ArrayBuffer>()->GetBackingStore();
+    *offset = 0;
+    *length = (*store)->ByteLength();
+
+    return true;
+  }
+  if (value->IsArrayBufferView()) {
+    Local<v8::ArrayBufferView> view = value.As<v8::ArrayBufferView>();
+
+    *store = view->Buffer()->GetBackingStore();
+    *offset = view->ByteOffset();
+    *length = view->ByteLength();
+
+    return true;
+  }
+
+  return false;
+}
+
+// Run boundaries (subpaths, parts) as point indices: [0, n0, n0 + n1, ..., total]. Missing offsets mean one run.
+inline bool ReadOffsets(Isolate* isolate, Local<Value> value, size_t pointCount, std::vector<uint32_t>& offsets) {
+  offsets.clear();
+  if (value->IsUndefined() || value->IsNull()) {
+    offsets.push_back(0);
+    offsets.push_back(static_cast<uint32_t>(pointCount));
+
+    return true;
+  }
+  if (!value->IsUint32Array()) {
+    ThrowTypeError(isolate, "offsets must be a Uint32Array");
+
+    return false;
+  }
+
+  Local<v8::Uint32Array> array = value.As<v8::Uint32Array>();
+  const uint32_t* data = TypedArrayData<uint32_t>(array);
+
+  offsets.assign(data, data + array->Length());
+  if (offsets.size() < 2) {
+    ThrowTypeError(isolate, "offsets must have at least 2 entries");
+
+    return false;
+  }
+  for (size_t i = 0; i < offsets.size(); i += 1) {
+    if (offsets[i] > pointCount || (i > 0 && offsets[i] < offsets[i - 1])) {
+      ThrowTypeError(isolate, "offsets must be ascending point indices");
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_NODE_UTILS_H_
@@ -0,0 +1,45 @@
+// Minimal work-sharing loop used to spread independent jobs (subpaths, parts, tiles) over the available cores.
+#ifndef BEAM_ADDON_PARALLEL_H_
+#define BEAM_ADDON_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace beam {
+
+inline unsigned WorkerCount() {
+  unsigned count = std::thread::hardware_concurrency();
+
+  return count == 0 ? 1 : count;
+}
+
+// Calls fn(i) for every i in [0, count). Jobs are handed out one by one so uneven job sizes still balance; fn must
+// only touch state owned by job i.
+template <typename Fn>
+void ParallelFor(size_t count, Fn&& fn) {
+  size_t workers = std::min<size_t>(WorkerCount(), count);
+
+  if (workers <= 1) {
+    for (size_t i = 0; i < count; i += 1) fn(i);
+
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  auto run = [&]() {
+    for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) fn(i);
+  };
+  std::vector<std::thread> threads;
+
+  threads.reserve(workers - 1);
+  for (size_t i = 1; i < workers; i += 1) threads.emplace_back(run);
+  run();
+  for (std::thread& thread : threads) thread.join();
+}
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_PARALLEL_H_
@@ -0,0 +1,73 @@
+// Packed path representation shared by the geometry, DXF, font and raster helpers.
+// A path is a command stream plus a flat coordinate stream; all coordinates are absolute.
+#ifndef BEAM_ADDON_PATH_BUFFER_H_
+#define BEAM_ADDON_PATH_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace beam {
+
+enum PathCommand : uint8_t {
+  kMoveTo = 0,   // x y
+  kLineTo = 1,   // x y
+  kQuadTo = 2,   // x1 y1 x y
+  kCubicTo = 3,  // x1 y1 x2 y2 x y
+  kArcTo = 4,    // rx ry xAxisRotation largeArcFlag sweepFlag x y (SVG endpoint parameterization)
+  kClose = 5,
+};
+
+constexpr uint8_t kPathCommandCount = 6;
+
+// Number of coordinates consumed by each command.
+constexpr uint8_t kPathCommandArity[kPathCommandCount] = {2, 2, 4, 6, 7, 0};
+
+struct PathBuffer {
+  std::vector<uint8_t> commands;
+  std::vector<double> coords;
+
+  void MoveTo(double x, double y) { Push(kMoveTo, {x, y}); }
+  void LineTo(double x, double y) { Push(kLineTo, {x, y}); }
+  void QuadTo(double x1, double y1, double x, double y) { Push(kQuadTo, {x1, y1, x, y}); }
+  void CubicTo(double x1, double y1, double x2, double y2, double x, double y) {
+    Push(kCubicTo, {x1, y1, x2, y2, x, y});
+  }
+  void ArcTo(double rx, double ry, double rotation, bool largeArc, bool sweep, double x, double y) {
+    Push(kArcTo, {rx, ry, rotation, largeArc ? 1.0 : 0.0, sweep ? 1.0 : 0.0, x, y});
+  }
+  void Close() { commands.push_back(kClose); }
+
+  void Clear() {
+    commands.clear();
+    coords.clear();
+  }
+
+  void Append(const PathBuffer& other) {
+    commands.insert(commands.end(), other.commands.begin(), other.commands.end());
+    coords.insert(coords.end(), other.coords.begin(), other.coords.end());
+  }
+
+ private:
+  void Push(PathCommand command, std::initializer_list<double> values) {
+    commands.push_back(command);
+    coords.insert(coords.end(), values);
+  }
+};
+
+// Checks that every command is known and the coordinate stream has exactly the expected length.
+inline bool IsValidPathBuffer(const uint8_t* commands, size_t commandCount, size_t coordCount) {
+  size_t expected = 0;
+
+  for (size_t i = 0; i < commandCount; i += 1) {
+    if (commands[i] >= kPathCommandCount) return false;
+    expected += kPathCommandArity[commands[i]];
+  }
+
+  return expected == coordCount;
+}
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_PATH_BUFFER_H_
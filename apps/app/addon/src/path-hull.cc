@@ -0,0 +1,355 @@
+#include "path-hull.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "flatten.h"
+#include "parallel.h"
+#include "path-buffer.h"
+
+namespace beam {
+
+namespace {
+
+// Sides of the polygon standing in for the round pen; its edges fall short of the circle by under 1% of the width.
+constexpr int kPenSides = 16;
+// Runs handed to each worker, so runs of uneven cost still balance.
+constexpr size_t kRunsPerWorker = 8;
+
+// Directions of the eight extreme points that seed the core hull.
+constexpr double kDirections[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+// Whole subpaths: commands [command, end) with their coordinates from `coord`.
+struct PathRun {
+  size_t command;
+  size_t end;
+  size_t coord;
+};
+
+struct Extremes {
+  std::array<double, 8> value;
+  std::array<Vec2, 8> point;
+
+  Extremes() { value.fill(-INFINITY); }
+  bool IsEmpty() const { return value[0] == -INFINITY; }
+  void Add(Vec2 p) {
+    for (int k = 0; k < 8; k += 1) {
+      double v = kDirections[k][0] * p.x + kDirections[k][1] * p.y;
+
+      if (v > value[k]) {
+        value[k] = v;
+        point[k] = p;
+      }
+    }
+  }
+};
+
+// A convex polygon as the half-planes of its edges, for a quick strictly-inside test.
+struct ConvexTest {
+  std::vector<std::array<double, 3>> edges;
+
+  explicit ConvexTest(const Polygon& convex) {
+    if (convex.size() < 3) return;
+    for (size_t i = 0, j = convex.size() - 1; i < convex.size(); j = i, i += 1) {
+      Vec2 edge = convex[i] - convex[j];
+
+      edges.push_back({-edge.y, edge.x, Cross(convex[j], convex[i])});
+    }
+  }
+  bool Inside(Vec2 p) const {
+    if (edges.empty()) return false;
+    for (const std::array<double, 3>& e : edges) {
+      if (e[0] * p.x + e[1] * p.y + e[2] <= 0) return false;
+    }
+
+    return true;
+  }
+};
+
+bool Contains(const Bounds& bounds, Vec2 p) {
+  return p.x >= bounds.minX && p.x <= bounds.maxX && p.y >= bounds.minY && p.y <= bounds.maxY;
+}
+
+// Calls fn(index, command, c, from, to) for every command of the run, c being its coordinates. A moveTo comes with
+// from equal to to and a close as the line back to the subpath start.
+template <typename Fn>
+void ForEachSegment(const uint8_t* commands, const double* coords, const PathRun& run, Fn&& fn) {
+  const double* c = coords + run.coord;
+  Vec2 current = {0, 0};
+  Vec2 start = {0, 0};
+
+  for (size_t i = run.command; i < run.end; i += 1) {
+    uint8_t command = commands[i];
+    Vec2 from = current;
+    int arity = kPathCommandArity[command];
+
+    current = command == kClose ? start : Vec2{c[arity - 2], c[arity - 1]};
+    if (command == kMoveTo) start = from = current;
+    fn(i, command, c, from, current);
+    c += arity;
+  }
+}
+
+// Liang–Barsky: the part of segment ab inside `window`, false when there is none.
+bool ClipSegment(Vec2 a, Vec2 b, const Bounds& window, Vec2* from, Vec2* to) {
+  Vec2 d = b - a;
+  double p[4] = {-d.x, d.x, -d.y, d.y};
+  double q[4] = {a.x - window.minX, window.maxX - a.x, a.y - window.minY, window.maxY - a.y};
+  double t0 = 0;
+  double t1 = 1;
+
+  for (int k = 0; k < 4; k += 1) {
+    if (p[k] == 0) {
+      if (q[k] < 0) return false;
+      continue;
+    }
+
+    double t = q[k] / p[k];
+
+    if (p[k] < 0) {
+      if (t > t1) return false;
+      if (t > t0) t0 = t;
+    } else {
+      if (t < t0) return false;
+      if (t < t1) t1 = t;
+    }
+  }
+  // Clamped, as the crossings may land a rounding error outside.
+  auto clamp = [&window](Vec2 p) {
+    return Vec2{std::min(std::max(p.x, window.minX), window.maxX), std::min(std::max(p.y, window.minY), window.maxY)};
+  };
+
+  *from = t0 == 0 ? a : clamp(a + d * t0);
+  *to = t1 == 1 ? b : clamp(a + d * t1);
+
+  return true;
+}
+
+// Sutherland–Hodgman against one side of the window, given as the inside test and the crossing with the side line.
+template <typename Inside, typename Cross>
+void ClipSide(const Polygon& polygon, Inside inside, Cross cross, Polygon& out) {
+  out.clear();
+  if (polygon.empty()) return;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i, i += 1) {
+    Vec2 previous = polygon[j];
+    Vec2 current = polygon[i];
+
+    if (inside(current)) {
+      if (!inside(previous)) out.push_back(cross(previous, current));
+      out.push_back(current);
+    } else if (inside(previous)) {
+      out.push_back(cross(previous, current));
+    }
+  }
+}
+
+void ClipConvex(Polygon& polygon, const Bounds& window) {
+  Polygon clipped;
+  auto atX = [](double x) {
+    return [x](Vec2 a, Vec2 b) { return Vec2{x, a.y + (b.y - a.y) * (x - a.x) / (b.x - a.x)}; };
+  };
+  auto atY = [](double y) {
+    return [y](Vec2 a, Vec2 b) { return Vec2{a.x + (b.x - a.x) * (y - a.y) / (b.y - a.y), y}; };
+  };
+
+  ClipSide(polygon, [&](Vec2 p) { return p.x >= window.minX; }, atX(window.minX), clipped);
+  ClipSide(clipped, [&](Vec2 p) { return p.x <= window.maxX; }, atX(window.maxX), polygon);
+  ClipSide(polygon, [&](Vec2 p) { return p.y >= window.minY; }, atY(window.minY), clipped);
+  ClipSide(clipped, [&](Vec2 p) { return p.y <= window.maxY; }, atY(window.maxY), polygon);
+}
+
+// Nonzero winding number of a closed polyline around p.
+int Winding(const double* xy, size_t count, Vec2 p) {
+  int winding = 0;
+
+  for (size_t i = 1; i < count; i += 1) {
+    Vec2 a = {xy[2 * i - 2], xy[2 * i - 1]};
+    Vec2 b = {xy[2 * i], xy[2 * i + 1]};
+
+    if (a.y <= p.y) {
+      if (b.y > p.y && Cross(b - a, p - a) > 0) winding += 1;
+    } else if (b.y <= p.y && Cross(b - a, p - a) < 0) {
+      winding -= 1;
+    }
+  }
+
+  return winding;
+}
+
+// Cuts the path at moveTos into about kRunsPerWorker runs per worker.
+void SplitRuns(const uint8_t* commands, size_t commandCount, std::vector<PathRun>& runs) {
+  size_t target = commandCount / (WorkerCount() * kRunsPerWorker) + 1;
+  size_t coord = 0;
+
+  runs.clear();
+  for (size_t i = 0; i < commandCount; i += 1) {
+    if (i == 0 || (commands[i] == kMoveTo && i - runs.back().command >= target)) {
+      if (!runs.empty()) runs.back().end = i;
+      runs.push_back({i, commandCount, coord});
+    }
+    coord += kPathCommandArity[commands[i]];
+  }
+}
+
+}  // namespace
+
+void PathWindowHull(const uint8_t* commands, size_t commandCount, const double* coords, const PathHullOptions& options,
+                    Polygon& hull) {
+  const Bounds& window = options.window;
+  double pen = options.strokeWidth > 0 ? options.strokeWidth / 2 : 0;
+  // Geometry up to half a stroke outside the window still paints inside it.
+  Bounds reach = {window.minX - pen, window.minY - pen, window.maxX + pen, window.maxY + pen};
+  std::array<Vec2, 4> corners = {{{reach.minX, reach.minY}, {reach.maxX, reach.minY}, {reach.maxX, reach.maxY},
+                                  {reach.minX, reach.maxY}}};
+  std::vector<PathRun> runs;
+
+  hull.clear();
+  if (window.IsEmpty()) return;
+  SplitRuns(commands, commandCount, runs);
+
+  // The hull of the extreme end points inside the window is part of the result, so segments whose points all lie
+  // strictly inside it are passed over without flattening or clipping: a curve stays within its control points.
+  std::vector<Extremes> extremes(runs.size());
+  Extremes merged;
+  Polygon core;
+
+  ParallelFor(runs.size(), [&](size_t r) {
+    bool moved = false;
+
+    // Every drawn point but a subpath's first ends a segment.
+    ForEachSegment(commands, coords, runs[r], [&](size_t, uint8_t command, const double*, Vec2 from, Vec2 to) {
+      if (command != kMoveTo && moved && Contains(reach, from)) extremes[r].Add(from);
+      if (command != kMoveTo && Contains(reach, to)) extremes[r].Add(to);
+      moved = command == kMoveTo;
+    });
+  });
+  for (const Extremes& run : extremes) {
+    if (!run.IsEmpty()) {
+      for (Vec2 p : run.point) merged.Add(p);
+    }
+  }
+  if (!merged.IsEmpty()) ConvexHull(std::vector<Vec2>(merged.point.begin(), merged.point.end()), core);
+
+  ConvexTest coreTest(core);
+  bool finite[4];
+  std::vector<Polygon> hulls(runs.size());
+  std::vector<std::array<int, 4>> windings(runs.size(), {{0, 0, 0, 0}});
+
+  for (int k = 0; k < 4; k += 1) finite[k] = std::isfinite(corners[k].x) && std::isfinite(corners[k].y);
+  ParallelFor(runs.size(), [&](size_t r) {
+    std::vector<Vec2> points;
+    Polylines chords;
+    Bounds extent;
+    size_t subpathCommand = runs[r].command;
+    const double* subpathCoords = coords + runs[r].coord;
+    auto inCore = [&](Vec2 p) { return coreTest.Inside(p); };
+    auto clip = [&](Vec2 a, Vec2 b) {
+      Vec2 from;
+      Vec2 to;
+
+      if (!ClipSegment(a, b, reach, &from, &to)) return;
+      points.push_back(from);
+      points.push_back(to);
+    };
+
+    ForEachSegment(commands, coords, runs[r], [&](size_t i, uint8_t command, const double* c, Vec2 from, Vec2 to) {
+      if (command == kMoveTo) {
+        subpathCommand = i;
+        subpathCoords = c;
+        extent = Bounds();
+        extent.Add(to);
+
+        return;
+      }
+
+      bool curve = command == kQuadTo || command == kCubicTo;
+      bool inside = inCore(from) && inCore(to) && (!curve || inCore({c[0], c[1]})) &&
+                    (command != kCubicTo || inCore({c[2], c[3]}));
+      Bounds segment;
+
+      segment.Add(from);
+      segment.Add(to);
+      if (curve) segment.Add(Vec2{c[0], c[1]});
+      if (command == kCubicTo) segment.Add(Vec2{c[2], c[3]});
+      extent.Add(segment);
+      // Lines and curves wholly outside the window are passed over too.
+      if (command != kArcTo && !segment.Intersects(reach)) inside = true;
+      if (command == kLineTo || command == kClose) {
+        if (!inside) clip(from, to);
+      } else if (command == kArcTo || !inside) {
+        chords.points.clear();
+        chords.Add(from);
+        if (command == kQuadTo) FlattenQuadratic(from, {c[0], c[1]}, to, options.tolerance, chords);
+        if (command == kCubicTo) FlattenCubic(from, {c[0], c[1]}, {c[2], c[3]}, to, options.tolerance, chords);
+        if (command == kArcTo) {
+          FlattenSvgArc(from, c[0], c[1], c[2], c[3] != 0, c[4] != 0, to, options.tolerance, chords);
+        }
+        for (size_t k = 1; k < chords.PointCount(); k += 1) {
+          Vec2 a = {chords.points[2 * k - 2], chords.points[2 * k - 1]};
+          Vec2 b = {chords.points[2 * k], chords.points[2 * k + 1]};
+
+          if (command == kArcTo) extent.Add(b);
+          clip(a, b);
+        }
+      }
+      if (command != kClose) return;
+
+      // Only a filled subpath reaching around a window corner adds the corner; its outline is the last closed
+      // polyline of the subpath flattened so far.
+      bool around = false;
+
+      for (int k = 0; k < 4; k += 1) around = around || (finite[k] && Contains(extent, corners[k]));
+      extent = Bounds();
+      extent.Add(to);
+      if (!around) return;
+
+      Polylines outline;
+
+      FlattenPath(commands + subpathCommand, i + 1 - subpathCommand, subpathCoords, options.tolerance, outline);
+      if (outline.closed.empty() || !outline.closed.back()) return;
+
+      size_t first = outline.offsets[outline.offsets.size() - 2];
+      const double* xy = outline.points.data() + 2 * first;
+
+      for (int k = 0; k < 4; k += 1) {
+        if (finite[k]) windings[r][k] += Winding(xy, outline.PointCount() - first, corners[k]);
+      }
+    });
+    ConvexHull(std::move(points), hulls[r]);
+  });
+
+  std::vector<Vec2> points;
+  std::array<int, 4> winding = {{0, 0, 0, 0}};
+
+  for (size_t r = 0; r < runs.size(); r += 1) {
+    points.insert(points.end(), hulls[r].begin(), hulls[r].end());
+    for (int k = 0; k < 4; k += 1) winding[k] += windings[r][k];
+  }
+  for (int k = 0; k < 4; k += 1) {
+    if (winding[k] != 0) points.push_back(corners[k]);
+  }
+  ConvexHull(std::move(points), hull);
+  if (pen == 0 || hull.empty()) return;
+
+  Polygon nib(kPenSides);
+  Polygon widened;
+
+  // Quarter turns of the first quadrant keep the points on the axes exact.
+  for (int k = 0; k < kPenSides / 4; k += 1) {
+    double angle = 2 * kPi * k / kPenSides;
+    double x = pen * std::cos(angle);
+    double y = pen * std::sin(angle);
+
+    nib[k] = {x, y};
+    nib[k + kPenSides / 4] = {-y, x};
+    nib[k + kPenSides / 2] = {-x, -y};
+    nib[k + 3 * kPenSides / 4] = {y, -x};
+  }
+  MinkowskiSumConvex(hull, nib, widened);
+  ClipConvex(widened, window);
+  ConvexHull(std::move(widened), hull);
+}
+
+}  // namespace beam
@@ -0,0 +1,30 @@
+// Convex hull of a packed path seen through a window, the outline the framing of a job traces: the same hull a render
+// of the job cropped to the window would give, taken from the geometry instead of the pixels.
+#ifndef BEAM_ADDON_PATH_HULL_H_
+#define BEAM_ADDON_PATH_HULL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "polygon.h"
+
+namespace beam {
+
+struct PathHullOptions {
+  // What the hull is cropped to; sides may be infinite.
+  Bounds window;
+  // Strokes widen the geometry by half of it, still within the window.
+  double strokeWidth = 0;
+  // Chord tolerance for the curves that reach past the hull of the end points.
+  double tolerance = 0.25;
+};
+
+// Hull of the parts of the path (path-buffer.h) inside the window, CCW without collinear points. Closed subpaths count
+// as filled with the nonzero rule, so a window corner inside one belongs to the hull. Fewer than three points when the
+// visible geometry is a point or a segment; empty when nothing is inside. Runs of subpaths are walked on all cores.
+void PathWindowHull(const uint8_t* commands, size_t commandCount, const double* coords, const PathHullOptions& options,
+                    Polygon& hull);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_PATH_HULL_H_
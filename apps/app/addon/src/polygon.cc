@@ -0,0 +1,316 @@
+#include "polygon.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace beam {
+
+namespace {
+
+constexpr double kEpsilon = 1e-12;
+
+inline uint64_t EdgeKey(uint32_t a, uint32_t b) { return (static_cast<uint64_t>(a) << 32) | b; }
+
+inline double Orientation(Vec2 a, Vec2 b, Vec2 c) { return Cross(b - a, c - a); }
+
+bool PointInTriangle(Vec2 p, Vec2 a, Vec2 b, Vec2 c) {
+  return Orientation(a, b, p) >= 0 && Orientation(b, c, p) >= 0 && Orientation(c, a, p) >= 0;
+}
+
+// Rotates the CCW convex polygon so that it starts at its lowest (then leftmost) vertex.
+void StartAtLowest(const Polygon& polygon, Polygon& out) {
+  size_t lowest = 0;
+
+  for (size_t i = 1; i < polygon.size(); i += 1) {
+    if (polygon[i].y < polygon[lowest].y || (polygon[i].y == polygon[lowest].y && polygon[i].x < polygon[lowest].x)) {
+      lowest = i;
+    }
+  }
+  out.assign(polygon.begin() + lowest, polygon.end());
+  out.insert(out.end(), polygon.begin(), polygon.begin() + lowest);
+}
+
+}  // namespace
+
+double SignedArea(const Polygon& polygon) {
+  double area = 0;
+
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i, i += 1) {
+    area += Cross(polygon[j], polygon[i]);
+  }
+
+  return area / 2;
+}
+
+Bounds PolygonBounds(const Polygon& polygon) {
+  Bounds bounds;
+
+  for (const Vec2& p : polygon) bounds.Add(p);
+
+  return bounds;
+}
+
+void ConvexHull(std::vector<Vec2> points, Polygon& hull) {
+  hull.clear();
+  std::sort(points.begin(), points.end(), [](Vec2 a, Vec2 b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+  points.erase(std::unique(points.begin(), points.end(), [](Vec2 a, Vec2 b) { return a.x == b.x && a.y == b.y; }),
+               points.end());
+  if (points.size() < 3) {
+    hull = points;
+
+    return;
+  }
+
+  hull.resize(2 * points.size());
+
+  size_t k = 0;
+
+  for (size_t i = 0; i < points.size(); i += 1) {
+    while (k >= 2 && Orientation(hull[k - 2], hull[k - 1], points[i]) <= 0) k -= 1;
+    hull[k++] = points[i];
+  }
+  for (size_t i = points.size() - 1, lower = k + 1; i > 0; i -= 1) {
+    while (k >= lower && Orientation(hull[k - 2], hull[k - 1], points[i - 1]) <= 0) k -= 1;
+    hull[k++] = points[i - 1];
+  }
+  hull.resize(k - 1);
+}
+
+void ConvexHull(const double* xy, size_t count, Polygon& hull) {
+  std::vector<Vec2> points(count);
+
+  for (size_t i = 0; i < count; i += 1) points[i] = {xy[2 * i], xy[2 * i + 1]};
+  ConvexHull(std::move(points), hull);
+}
+
+bool PointInPolygon(Vec2 p, const Polygon& polygon) {
+  bool inside = false;
+
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i, i += 1) {
+    const Vec2& a = polygon[i];
+    const Vec2& b = polygon[j];
+
+    if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x) inside = !inside;
+  }
+
+  return inside;
+}
+
+bool PointStrictlyInsideConvex(Vec2 p, const Polygon& convex, double eps) {
+  if (convex.size() < 3) return false;
+
+  for (size_t i = 0, j = convex.size() - 1; i < convex.size(); j = i, i += 1) {
+    Vec2 edge = convex[i] - convex[j];
+    double lengthSquared = Dot(edge, edge);
+
+    if (lengthSquared == 0) continue;
+
+    double cross = Cross(edge, p - convex[j]);
+
+    // Distance to the edge line is cross / |edge|, compared without the square root.
+    if (cross <= 0 || cross * cross <= eps * eps * lengthSquared) return false;
+  }
+
+  return true;
+}
+
+bool IsConvex(const Polygon& polygon) {
+  size_t n = polygon.size();
+
+  for (size_t i = 0; i < n; i += 1) {
+    if (Orientation(polygon[i], polygon[(i + 1) % n], polygon[(i + 2) % n]) < -kEpsilon) return false;
+  }
+
+  return true;
+}
+
+bool Triangulate(const Polygon& polygon, std::vector<std::array<uint32_t, 3>>& triangles) {
+  size_t n = polygon.size();
+  std::vector<uint32_t> remaining(n);
+
+  triangles.clear();
+  if (n < 3) return false;
+  for (size_t i = 0; i < n; i += 1) remaining[i] = static_cast<uint32_t>(i);
+  if (SignedArea(polygon) < 0) std::reverse(remaining.begin(), remaining.end());
+
+  while (remaining.size() > 3) {
+    size_t count = remaining.size();
+    bool clipped = false;
+
+    for (size_t i = 0; i < count && !clipped; i += 1) {
+      uint32_t prev = remaining[(i + count - 1) % count];
+      uint32_t current = remaining[i];
+      uint32_t next = remaining[(i + 1) % count];
+      Vec2 a = polygon[prev];
+      Vec2 b = polygon[current];
+      Vec2 c = polygon[next];
+      double orientation = Orientation(a, b, c);
+
+      if (orientation <= kEpsilon) continue;
+
+      bool isEar = true;
+
+      for (uint32_t index : remaining) {
+        if (index == prev || index == current || index == next) continue;
+
+        Vec2 p = polygon[index];
+
+        if ((p.x == a.x && p.y == a.y) || (p.x == b.x && p.y == b.y) || (p.x == c.x && p.y == c.y)) continue;
+        if (PointInTriangle(p, a, b, c)) {
+          isEar = false;
+          break;
+        }
+      }
+      if (isEar) {
+        triangles.push_back({prev, current, next});
+        remaining.erase(remaining.begin() + i);
+        clipped = true;
+      }
+    }
+
+    if (!clipped) {
+      // Drop one degenerate (collinear) vertex and retry; anything else means the polygon is not simple.
+      for (size_t i = 0; i < count && !clipped; i += 1) {
+        Vec2 a = polygon[remaining[(i + count - 1) % count]];
+        Vec2 b = polygon[remaining[i]];
+        Vec2 c = polygon[remaining[(i + 1) % count]];
+
+        if (std::fabs(Orientation(a, b, c)) <= kEpsilon) {
+          remaining.erase(remaining.begin() + i);
+          clipped = true;
+        }
+      }
+      if (!clipped) return false;
+    }
+  }
+  if (Orientation(polygon[remaining[0]], polygon[remaining[1]], polygon[remaining[2]]) > kEpsilon) {
+    triangles.push_back({remaining[0], remaining[1], remaining[2]});
+  }
+
+  return !triangles.empty();
+}
+
+void ConvexDecompose(const Polygon& polygon, std::vector<Polygon>& pieces) {
+  std::vector<std::array<uint32_t, 3>> triangles;
+
+  pieces.clear();
+  if (!Triangulate(polygon, triangles)) {
+    Polygon hull;
+
+    ConvexHull(std::vector<Vec2>(polygon.begin(), polygon.end()), hull);
+    if (hull.size() >= 3) pieces.push_back(hull);
+
+    return;
+  }
+
+  std::vector<std::vector<uint32_t>> parts(triangles.size());
+  std::vector<uint8_t> alive(triangles.size(), 1);
+  std::unordered_map<uint64_t, uint32_t> edgeOwner;
+  std::vector<std::pair<uint32_t, uint32_t>> diagonals;
+
+  for (uint32_t t = 0; t < triangles.size(); t += 1) {
+    parts[t].assign(triangles[t].begin(), triangles[t].end());
+    for (int k = 0; k < 3; k += 1) edgeOwner[EdgeKey(triangles[t][k], triangles[t][(k + 1) % 3])] = t;
+  }
+  for (const std::array<uint32_t, 3>& triangle : triangles) {
+    for (int k = 0; k < 3; k += 1) {
+      uint32_t a = triangle[k];
+      uint32_t b = triangle[(k + 1) % 3];
+
+      if (a < b && edgeOwner.count(EdgeKey(b, a))) diagonals.emplace_back(a, b);
+    }
+  }
+
+  Polygon merged;
+  std::vector<uint32_t> mergedIndices;
+
+  // Remove every diagonal whose removal keeps the union convex (Hertel–Mehlhorn), at most 4x the optimal count.
+  for (const std::pair<uint32_t, uint32_t>& diagonal : diagonals) {
+    uint32_t a = diagonal.first;
+    uint32_t b = diagonal.second;
+    auto first = edgeOwner.find(EdgeKey(a, b));
+    auto second = edgeOwner.find(EdgeKey(b, a));
+
+    if (first == edgeOwner.end() || second == edgeOwner.end() || first->second == second->second) continue;
+
+    std::vector<uint32_t>& p = parts[first->second];
+    std::vector<uint32_t>& q = parts[second->second];
+    size_t pb = std::find(p.begin(), p.end(), b) - p.begin();
+    size_t qa = std::find(q.begin(), q.end(), a) - q.begin();
+
+    mergedIndices.clear();
+    for (size_t k = 0; k < p.size(); k += 1) mergedIndices.push_back(p[(pb + k) % p.size()]);
+    for (size_t k = 1; k + 1 < q.size(); k += 1) mergedIndices.push_back(q[(qa + k) % q.size()]);
+    merged.clear();
+    for (uint32_t index : mergedIndices) merged.push_back(polygon[index]);
+    if (!IsConvex(merged)) continue;
+
+    uint32_t keep = first->second;
+    uint32_t drop = second->second;
+
+    edgeOwner.erase(EdgeKey(a, b));
+    edgeOwner.erase(EdgeKey(b, a));
+    for (size_t k = 0; k < q.size(); k += 1) {
+      auto owner = edgeOwner.find(EdgeKey(q[k], q[(k + 1) % q.size()]));
+
+      if (owner != edgeOwner.end()) owner->second = keep;
+    }
+    parts[keep] = mergedIndices;
+    parts[drop].clear();
+    alive[drop] = 0;
+  }
+
+  for (size_t t = 0; t < parts.size(); t += 1) {
+    if (!alive[t]) continue;
+
+    Polygon piece;
+
+    for (uint32_t index : parts[t]) piece.push_back(polygon[index]);
+    pieces.push_back(std::move(piece));
+  }
+}
+
+void MinkowskiSumConvex(const Polygon& a, const Polygon& b, Polygon& out) {
+  out.clear();
+  if (a.size() < 3 || b.size() < 3) {
+    std::vector<Vec2> sums;
+
+    for (const Vec2& p : a) {
+      for (const Vec2& q : b) sums.push_back(p + q);
+    }
+    ConvexHull(std::move(sums), out);
+
+    return;
+  }
+
+  Polygon p;
+  Polygon q;
+
+  StartAtLowest(a, p);
+  StartAtLowest(b, q);
+
+  size_t n = p.size();
+  size_t m = q.size();
+
+  p.push_back(p[0]);
+  p.push_back(p[1]);
+  q.push_back(q[0]);
+  q.push_back(q[1]);
+
+  size_t i = 0;
+  size_t j = 0;
+
+  while (i < n || j < m) {
+    out.push_back(p[i] + q[j]);
+
+    double cross = Cross(p[i + 1] - p[i], q[j + 1] - q[j]);
+
+    bool advanceP = j >= m || (i < n && cross >= 0);
+    bool advanceQ = i >= n || (j < m && cross <= 0);
+
+    if (advanceP) i += 1;
+    if (advanceQ) j += 1;
+  }
+}
+
+}  // namespace beam
@@ -0,0 +1,64 @@
+// Polygon utilities: area, hull, containment, triangulation, convex decomposition and convex Minkowski sums.
+// Polygons are vertex lists without a repeated closing point; "CCW" means positive signed area.
+#ifndef BEAM_ADDON_POLYGON_H_
+#define BEAM_ADDON_POLYGON_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vec2.h"
+
+namespace beam {
+
+typedef std::vector<Vec2> Polygon;
+
+struct Bounds {
+  double minX = INFINITY;
+  double minY = INFINITY;
+  double maxX = -INFINITY;
+  double maxY = -INFINITY;
+
+  bool IsEmpty() const { return !(minX <= maxX && minY <= maxY); }
+  double Width() const { return maxX - minX; }
+  double Height() const { return maxY - minY; }
+  void Add(Vec2 p) {
+    if (p.x < minX) minX = p.x;
+    if (p.x > maxX) maxX = p.x;
+    if (p.y < minY) minY = p.y;
+    if (p.y > maxY) maxY = p.y;
+  }
+  void Add(const Bounds& other) {
+    if (other.IsEmpty()) return;
+    Add(Vec2{other.minX, other.minY});
+    Add(Vec2{other.maxX, other.maxY});
+  }
+  bool Intersects(const Bounds& other) const {
+    return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+  }
+};
+
+double SignedArea(const Polygon& polygon);
+Bounds PolygonBounds(const Polygon& polygon);
+
+// Andrew's monotone chain; returns the hull in CCW order without collinear points.
+void ConvexHull(std::vector<Vec2> points, Polygon& hull);
+void ConvexHull(const double* xy, size_t count, Polygon& hull);
+
+// Even-odd point in polygon test; points on the boundary may go either way.
+bool PointInPolygon(Vec2 p, const Polygon& polygon);
+// True when p is inside the CCW convex polygon by more than eps.
+bool PointStrictlyInsideConvex(Vec2 p, const Polygon& convex, double eps);
+bool IsConvex(const Polygon& polygon);
+
+// Ear clipping of a simple polygon (any winding); triangles index the input vertices in CCW order.
+bool Triangulate(const Polygon& polygon, std::vector<std::array<uint32_t, 3>>& triangles);
+// Hertel–Mehlhorn decomposition into CCW convex pieces; falls back to the convex hull when the input is not simple.
+void ConvexDecompose(const Polygon& polygon, std::vector<Polygon>& pieces);
+// Minkowski sum of two CCW convex polygons, CCW result.
+void MinkowskiSumConvex(const Polygon& a, const Polygon& b, Polygon& out);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_POLYGON_H_
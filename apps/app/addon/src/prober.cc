@@ -0,0 +1,463 @@
+#include "prober.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+#include "socket.h"
+
+namespace beam {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+#ifdef _WIN32
+constexpr int kConnectionRefused = WSAECONNREFUSED;
+#else
+constexpr int kConnectionRefused = ECONNREFUSED;
+#endif
+
+constexpr uint8_t kEchoRequest4 = 8;
+constexpr uint8_t kEchoReply4 = 0;
+constexpr uint8_t kEchoRequest6 = 128;
+constexpr uint8_t kEchoReply6 = 129;
+// The ICMP header and a token of this run. Systems that do not filter echo replies by identifier hand datagram
+// sockets the replies of every ping on the machine; the token tells ours apart.
+constexpr size_t kEchoSize = 8 + 8;
+
+struct Host {
+  sockaddr_storage address = {};
+  socklen_t addressLength = 0;
+  bool icmp = false;
+  bool sending = false;
+  Clock::time_point nextSend;
+  double lastRttMs = -1;
+  double jitterSumMs = 0;
+  int jitterCount = 0;
+};
+
+struct Probe {
+  size_t host;
+  uint16_t sequence;
+  Clock::time_point sent;
+  Clock::time_point deadline;
+  // Connects in flight of a TCP probe, one per port.
+  std::vector<SocketHandle> sockets;
+};
+
+uint16_t Checksum(const uint8_t* data, size_t size) {
+  uint32_t sum = 0;
+
+  for (size_t i = 0; i + 1 < size; i += 2) sum += (data[i] << 8) | data[i + 1];
+  if (size % 2) sum += data[size - 1] << 8;
+  while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+
+  return static_cast<uint16_t>(~sum);
+}
+
+bool SameAddress(const sockaddr_storage& a, const sockaddr_storage& b) {
+  if (a.ss_family != b.ss_family) return false;
+  if (a.ss_family == AF_INET) {
+    return memcmp(&reinterpret_cast<const sockaddr_in&>(a).sin_addr, &reinterpret_cast<const sockaddr_in&>(b).sin_addr,
+                  sizeof(in_addr)) == 0;
+  }
+
+  return memcmp(&reinterpret_cast<const sockaddr_in6&>(a).sin6_addr,
+                &reinterpret_cast<const sockaddr_in6&>(b).sin6_addr, sizeof(in6_addr)) == 0;
+}
+
+std::string NumericAddress(const sockaddr_storage& address, socklen_t length) {
+  char text[NI_MAXHOST];
+
+  if (getnameinfo(reinterpret_cast<const sockaddr*>(&address), length, text, sizeof(text), nullptr, 0,
+                  NI_NUMERICHOST) != 0) {
+    return "";
+  }
+
+  return text;
+}
+
+class ProbeRun {
+ public:
+  ProbeRun(const ProbeOptions& options, const std::atomic<bool>& stop,
+           const std::function<void(const ProbeProgress&)>& progress, ProbeResult* result)
+      : options_(options), stop_(stop), report_(progress), result_(result) {
+    token_ = static_cast<uint64_t>(Clock::now().time_since_epoch().count()) * 0x9e3779b97f4a7c15ull ^
+             reinterpret_cast<uintptr_t>(this);
+  }
+
+  ~ProbeRun() {
+    for (Probe& probe : inFlight_) {
+      for (SocketHandle handle : probe.sockets) CloseSocket(handle);
+    }
+    for (SocketHandle handle : echo_) {
+      if (handle != kInvalidSocket) CloseSocket(handle);
+    }
+  }
+
+  void Run() {
+    Clock::time_point start = Clock::now();
+
+    if (!Resolve(start)) return;
+
+    Clock::time_point stopSending = options_.durationMs > 0 ? start + std::chrono::milliseconds(options_.durationMs)
+                                                            : Clock::time_point::max();
+    size_t concurrency = static_cast<size_t>(std::max(1, options_.concurrency));
+
+    while (!stop_) {
+      Clock::time_point now = Clock::now();
+      bool sending = false;
+
+      for (size_t i = inFlight_.size(); i-- > 0;) {
+        if (inFlight_[i].deadline <= now) Finish(i, now, false);
+      }
+      for (size_t i = 0; i < hosts_.size(); i += 1) {
+        Host& host = hosts_[i];
+
+        if (!host.sending) continue;
+        if (now >= stopSending || (options_.count > 0 && result_->hosts[i].sent >= options_.count)) {
+          host.sending = false;
+          continue;
+        }
+        sending = true;
+        if (host.nextSend > now || inFlight_.size() >= concurrency) continue;
+        host.nextSend = std::max(host.nextSend + std::chrono::milliseconds(options_.intervalMs), now);
+        Send(i, now);
+      }
+      if (!sending && inFlight_.empty()) break;
+      Report(start);
+      Wait(now, concurrency);
+    }
+    Report(start);
+  }
+
+ private:
+  // Resolves every host and picks its method; false when the run cannot start.
+  bool Resolve(Clock::time_point start) {
+    hosts_.resize(options_.hosts.size());
+    result_->hosts.resize(options_.hosts.size());
+    for (size_t i = 0; i < hosts_.size(); i += 1) {
+      ProbeStats& stats = result_->hosts[i];
+
+      stats.host = options_.hosts[i];
+      stats.method = options_.method == ProbeMethod::kIcmp ? ProbeMethod::kIcmp : ProbeMethod::kTcp;
+      stats.histogram.assign(static_cast<size_t>(options_.bins), 0);
+    }
+    for (size_t i = 0; i < hosts_.size() && !stop_; i += 1) {
+      Host& host = hosts_[i];
+      ProbeStats& stats = result_->hosts[i];
+      addrinfo hints = {};
+      addrinfo* addresses = nullptr;
+
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      if (getaddrinfo(stats.host.c_str(), nullptr, &hints, &addresses) != 0 || !addresses) {
+        stats.error = "cannot resolve '" + stats.host + "'";
+        continue;
+      }
+      memcpy(&host.address, addresses->ai_addr, addresses->ai_addrlen);
+      host.addressLength = static_cast<socklen_t>(addresses->ai_addrlen);
+      freeaddrinfo(addresses);
+      stats.address = NumericAddress(host.address, host.addressLength);
+      if (options_.method != ProbeMethod::kTcp) {
+        SocketHandle echo = EchoSocket(host.address.ss_family);
+
+        if (echo == kInvalidSocket && options_.method == ProbeMethod::kIcmp) {
+          result_->error = "ICMP echo sockets are not permitted: " + SocketErrorText(echoError_);
+
+          return false;
+        }
+        host.icmp = echo != kInvalidSocket;
+        stats.method = host.icmp ? ProbeMethod::kIcmp : ProbeMethod::kTcp;
+      }
+      host.sending = true;
+      host.nextSend = start;
+    }
+
+    return !stop_;
+  }
+
+  // The echo socket of an address family, opened on first use; kInvalidSocket when the system refuses it.
+  SocketHandle EchoSocket(int family) {
+    size_t slot = family == AF_INET ? 0 : 1;
+
+    if (echoTried_[slot]) return echo_[slot];
+    echoTried_[slot] = true;
+    echo_[slot] = socket(family, SOCK_DGRAM, family == AF_INET ? static_cast<int>(IPPROTO_ICMP) : IPPROTO_ICMPV6);
+    if (echo_[slot] == kInvalidSocket) {
+      echoError_ = LastSocketError();
+    } else if (!SetNonBlocking(echo_[slot])) {
+      echoError_ = LastSocketError();
+      CloseSocket(echo_[slot]);
+      echo_[slot] = kInvalidSocket;
+    }
+
+    return echo_[slot];
+  }
+
+  void Send(size_t index, Clock::time_point now) {
+    Host& host = hosts_[index];
+    Probe probe{index, nextSequence_, Clock::now(), now + std::chrono::milliseconds(options_.timeoutMs), {}};
+    bool answered = false;
+
+    nextSequence_ += 1;
+    result_->hosts[index].sent += 1;
+    progress_.sent += 1;
+    if (host.icmp) {
+      uint8_t packet[kEchoSize] = {};
+      bool v4 = host.address.ss_family == AF_INET;
+
+      // Linux replaces the identifier with the socket's own and computes the ICMPv6 checksum itself.
+      packet[0] = v4 ? kEchoRequest4 : kEchoRequest6;
+      packet[4] = static_cast<uint8_t>(token_ >> 8);
+      packet[5] = static_cast<uint8_t>(token_);
+      packet[6] = static_cast<uint8_t>(probe.sequence >> 8);
+      packet[7] = static_cast<uint8_t>(probe.sequence);
+      memcpy(packet + 8, &token_, sizeof(token_));
+
+      uint16_t checksum = Checksum(packet, sizeof(packet));
+
+      packet[2] = static_cast<uint8_t>(checksum >> 8);
+      packet[3] = static_cast<uint8_t>(checksum);
+      if (sendto(echo_[v4 ? 0 : 1], reinterpret_cast<const char*>(packet), sizeof(packet), 0,
+                 reinterpret_cast<const sockaddr*>(&host.address), host.addressLength) < 0) {
+        probe.deadline = now;
+      }
+    } else {
+      for (uint16_t port : options_.ports) {
+        sockaddr_storage address = host.address;
+        SocketHandle handle = socket(address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+
+        if (handle == kInvalidSocket) continue;
+        if (!SetNonBlocking(handle)) {
+          CloseSocket(handle);
+          continue;
+        }
+        if (address.ss_family == AF_INET) {
+          reinterpret_cast<sockaddr_in&>(address).sin_port = htons(port);
+        } else {
+          reinterpret_cast<sockaddr_in6&>(address).sin6_port = htons(port);
+        }
+
+        int code = connect(handle, reinterpret_cast<const sockaddr*>(&address), host.addressLength) == 0
+                       ? 0
+                       : LastSocketError();
+
+        if (code == 0 || code == kConnectionRefused) {
+          answered = true;
+          CloseSocket(handle);
+          break;
+        }
+        if (WouldBlock(code)) {
+          probe.sockets.push_back(handle);
+        } else {
+          CloseSocket(handle);
+        }
+      }
+      if (probe.sockets.empty()) probe.deadline = now;
+    }
+    inFlight_.push_back(std::move(probe));
+    if (answered) {
+      Finish(inFlight_.size() - 1, Clock::now(), true);
+    } else if (inFlight_.back().deadline <= now) {
+      Finish(inFlight_.size() - 1, now, false);
+    }
+  }
+
+  // Sleeps in poll() until a socket is ready, a probe times out or a host is due, but at most kSocketPollSlice
+  // milliseconds so that `stop` is seen; then takes in the answers.
+  void Wait(Clock::time_point now, size_t concurrency) {
+    Clock::time_point wake = now + std::chrono::milliseconds(kSocketPollSlice);
+
+    entries_.clear();
+    for (SocketHandle handle : echo_) {
+      if (handle != kInvalidSocket) entries_.push_back({handle, POLLIN, 0});
+    }
+    for (const Probe& probe : inFlight_) {
+      wake = std::min(wake, probe.deadline);
+      for (SocketHandle handle : probe.sockets) entries_.push_back({handle, POLLOUT, 0});
+    }
+    if (inFlight_.size() < concurrency) {
+      for (const Host& host : hosts_) {
+        if (host.sending) wake = std::min(wake, host.nextSend);
+      }
+    }
+
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(wake - Clock::now()).count();
+    int waitMs = static_cast<int>(std::max<int64_t>(0, micros + 999) / 1000);
+    int ready = PollSockets(entries_.data(), entries_.size(), waitMs);
+    Clock::time_point at = Clock::now();
+
+    if (ready <= 0) return;
+
+    std::unordered_map<SocketHandle, short> connects;
+
+    for (const PollEntry& entry : entries_) {
+      if (!entry.revents) continue;
+      if (entry.events == POLLIN) {
+        ReadEchoReplies(entry.handle, entry.handle == echo_[0] ? AF_INET : AF_INET6, at);
+      } else {
+        connects[entry.handle] = entry.revents;
+      }
+    }
+    // Backwards, so that a finished probe is replaced by one already checked.
+    for (size_t i = inFlight_.size(); i-- > 0 && !connects.empty();) {
+      Probe& probe = inFlight_[i];
+      bool answered = false;
+
+      for (size_t k = probe.sockets.size(); k-- > 0;) {
+        SocketHandle handle = probe.sockets[k];
+
+        if (!connects.count(handle)) continue;
+
+        int code = 0;
+        socklen_t length = sizeof(code);
+
+        if (getsockopt(handle, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&code), &length) != 0) {
+          code = LastSocketError();
+        }
+        if (code == 0 || code == kConnectionRefused) {
+          answered = true;
+          break;
+        }
+        CloseSocket(handle);
+        probe.sockets.erase(probe.sockets.begin() + static_cast<std::ptrdiff_t>(k));
+      }
+      if (answered) {
+        Finish(i, at, true);
+      } else if (probe.sockets.empty() && probe.deadline > at) {
+        // Every port failed with an error other than a refusal, such as an unreachable host.
+        Finish(i, at, false);
+      }
+    }
+  }
+
+  void ReadEchoReplies(SocketHandle handle, int family, Clock::time_point at) {
+    uint8_t buffer[1500];
+
+    while (true) {
+      sockaddr_storage from = {};
+      socklen_t fromLength = sizeof(from);
+      int size = static_cast<int>(recvfrom(handle, reinterpret_cast<char*>(buffer), sizeof(buffer), 0,
+                                           reinterpret_cast<sockaddr*>(&from), &fromLength));
+
+      if (size <= 0) return;
+
+      const uint8_t* icmp = buffer;
+      size_t length = static_cast<size_t>(size);
+
+      // macOS hands IPv4 datagram sockets the IP header as well.
+      if (family == AF_INET && length >= 20 && buffer[0] >> 4 == 4) {
+        size_t header = static_cast<size_t>(buffer[0] & 15) * 4;
+
+        if (length < header) continue;
+        icmp += header;
+        length -= header;
+      }
+      if (length < kEchoSize || icmp[0] != (family == AF_INET ? kEchoReply4 : kEchoReply6) ||
+          memcmp(icmp + 8, &token_, sizeof(token_)) != 0) {
+        continue;
+      }
+
+      uint16_t sequence = static_cast<uint16_t>(icmp[6] << 8 | icmp[7]);
+
+      for (size_t i = 0; i < inFlight_.size(); i += 1) {
+        const Host& host = hosts_[inFlight_[i].host];
+
+        if (inFlight_[i].sequence == sequence && host.icmp && SameAddress(from, host.address)) {
+          Finish(i, at, true);
+          break;
+        }
+      }
+    }
+  }
+
+  // Records the outcome of inFlight_[index] and drops it; a probe answered at `at` took at - sent.
+  void Finish(size_t index, Clock::time_point at, bool answered) {
+    Probe& probe = inFlight_[index];
+    Host& host = hosts_[probe.host];
+    ProbeStats& stats = result_->hosts[probe.host];
+
+    for (SocketHandle handle : probe.sockets) CloseSocket(handle);
+    if (answered) {
+      double rttMs = std::chrono::duration<double, std::milli>(at - probe.sent).count();
+      size_t bin = static_cast<size_t>(std::min(rttMs / options_.binMs, static_cast<double>(options_.bins - 1)));
+
+      stats.minMs = stats.received == 0 ? rttMs : std::min(stats.minMs, rttMs);
+      stats.maxMs = std::max(stats.maxMs, rttMs);
+      stats.sumMs += rttMs;
+      stats.received += 1;
+      stats.histogram[bin] += 1;
+      if (host.lastRttMs >= 0) {
+        host.jitterSumMs += std::fabs(rttMs - host.lastRttMs);
+        host.jitterCount += 1;
+        stats.jitterMs = host.jitterSumMs / host.jitterCount;
+      }
+      host.lastRttMs = rttMs;
+      if (options_.untilReply) host.sending = false;
+      progress_.received += 1;
+    } else {
+      progress_.lost += 1;
+    }
+    changed_ = true;
+    if (index + 1 != inFlight_.size()) inFlight_[index] = std::move(inFlight_.back());
+    inFlight_.pop_back();
+  }
+
+  void Report(Clock::time_point start) {
+    if (!changed_) return;
+    changed_ = false;
+    if (options_.durationMs > 0) {
+      double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+      progress_.fraction = std::min(1.0, elapsed / options_.durationMs);
+    } else {
+      double planned = static_cast<double>(options_.count) * hosts_.size();
+
+      progress_.fraction = planned > 0 ? std::min(1.0, (progress_.received + progress_.lost) / planned) : 1;
+    }
+    report_(progress_);
+  }
+
+  const ProbeOptions& options_;
+  const std::atomic<bool>& stop_;
+  const std::function<void(const ProbeProgress&)>& report_;
+  ProbeResult* result_;
+  std::vector<Host> hosts_;
+  std::vector<Probe> inFlight_;
+  std::vector<PollEntry> entries_;
+  SocketHandle echo_[2] = {kInvalidSocket, kInvalidSocket};
+  bool echoTried_[2] = {false, false};
+  int echoError_ = 0;
+  uint64_t token_;
+  uint16_t nextSequence_ = 0;
+  ProbeProgress progress_;
+  bool changed_ = false;
+};
+
+}  // namespace
+
+void RunProbes(const ProbeOptions& options, const std::atomic<bool>& stop,
+               const std::function<void(const ProbeProgress&)>& progress, ProbeResult* result) {
+  Clock::time_point start = Clock::now();
+  ProbeRun run(options, stop, progress, result);
+
+  run.Run();
+  result->elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}  // namespace beam
@@ -0,0 +1,77 @@
+// Reachability probes of many hosts at once: ICMP echo over unprivileged datagram sockets where the system allows
+// them (macOS, Linux within net.ipv4.ping_group_range), else TCP connects, where a refused connection proves the
+// host is up as well as an accepted one. One thread drives every probe in flight with poll() and per-probe
+// deadlines, so sweeping a subnet costs no more threads or processes than pinging one host.
+#ifndef BEAM_ADDON_PROBER_H_
+#define BEAM_ADDON_PROBER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace beam {
+
+enum class ProbeMethod : uint8_t { kAuto, kIcmp, kTcp };
+
+struct ProbeOptions {
+  std::vector<std::string> hosts;
+  // kAuto uses ICMP where a datagram socket for the address family opens, and TCP otherwise.
+  ProbeMethod method = ProbeMethod::kAuto;
+  // Probes per host; 0 keeps probing until durationMs.
+  int count = 4;
+  // Sending stops after this long when positive.
+  int durationMs = 0;
+  // Between the probes of one host, which may overlap when replies are slower.
+  int intervalMs = 1000;
+  int timeoutMs = 3000;
+  // Probes in flight at most, across all hosts.
+  int concurrency = 256;
+  // A host that answered is not probed again, as when only its existence matters.
+  bool untilReply = false;
+  // A TCP probe connects to all of these at once and takes the first answer.
+  std::vector<uint16_t> ports = {80, 443, 22};
+  // Round-trip time histogram: `bins` bins of binMs each, the last also counting everything slower.
+  double binMs = 1;
+  int bins = 100;
+};
+
+struct ProbeStats {
+  std::string host;
+  // Numeric form of the address probed; empty when the host did not resolve.
+  std::string address;
+  ProbeMethod method = ProbeMethod::kTcp;
+  std::string error;
+  int sent = 0;
+  int received = 0;
+  double minMs = 0;
+  double maxMs = 0;
+  double sumMs = 0;
+  // Mean absolute difference of consecutive round-trip times.
+  double jitterMs = 0;
+  std::vector<uint32_t> histogram;
+};
+
+struct ProbeProgress {
+  int sent = 0;
+  int received = 0;
+  int lost = 0;
+  // Of the probes planned, or of durationMs when probing by time.
+  double fraction = 0;
+};
+
+struct ProbeResult {
+  // Set when no probe could run at all, e.g. ICMP was required but is not permitted.
+  std::string error;
+  std::vector<ProbeStats> hosts;
+  double elapsedMs = 0;
+};
+
+// Runs all probes on the calling thread. `progress` is called whenever a probe was answered or timed out.
+void RunProbes(const ProbeOptions& options, const std::atomic<bool>& stop,
+               const std::function<void(const ProbeProgress&)>& progress, ProbeResult* result);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_PROBER_H_
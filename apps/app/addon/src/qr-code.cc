@@ -0,0 +1,492 @@
+#include "qr-code.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+namespace beam {
+
+namespace {
+
+// Error correction codewords per block and block counts, indexed by level (L, M, Q, H) and version; column 0 is unused.
+constexpr int8_t kEccCodewordsPerBlock[4][41] = {
+    {-1, 7,  10, 15, 20, 26, 18, 20, 24, 30, 18, 20, 24, 26, 30, 22, 24, 28, 30, 28, 28,
+     28, 28, 30, 30, 26, 28, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+    {-1, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26, 30, 22, 22, 24, 24, 28, 28, 26, 26, 26,
+     26, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28},
+    {-1, 13, 22, 18, 26, 18, 24, 18, 22, 20, 24, 28, 26, 24, 20, 30, 24, 28, 28, 26, 30,
+     28, 30, 30, 30, 30, 28, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+    {-1, 17, 28, 22, 16, 22, 28, 26, 26, 24, 28, 24, 28, 22, 24, 24, 30, 28, 28, 26, 28,
+     30, 24, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+};
+constexpr int8_t kErrorCorrectionBlocks[4][41] = {
+    {-1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 4, 4, 4, 4, 4, 6, 6, 6, 6, 7, 8,
+     8, 9, 9, 10, 12, 12, 12, 13, 14, 15, 16, 17, 18, 19, 19, 20, 21, 22, 24, 25},
+    {-1, 1, 1, 1, 2, 2, 4, 4, 4, 5, 5, 5, 8, 9, 9, 10, 10, 11, 13, 14, 16,
+     17, 17, 18, 20, 21, 23, 25, 26, 28, 29, 31, 33, 35, 37, 38, 40, 43, 45, 47, 49},
+    {-1, 1, 1, 2, 2, 4, 4, 6, 6, 8, 8, 8, 10, 12, 16, 12, 17, 16, 18, 21, 20,
+     23, 23, 25, 27, 29, 34, 34, 35, 38, 40, 43, 45, 48, 51, 53, 56, 59, 62, 65, 68},
+    {-1, 1, 1, 2, 4, 4, 4, 5, 6, 8, 8, 11, 11, 16, 16, 18, 16, 19, 21, 25, 25,
+     25, 34, 30, 32, 35, 37, 40, 42, 45, 48, 51, 54, 57, 60, 63, 66, 70, 74, 77, 81},
+};
+// Level bits of the format information, by level.
+constexpr int kFormatBits[4] = {1, 0, 3, 2};
+
+constexpr int kPenaltyRun = 3;
+constexpr int kPenaltyBlock = 3;
+constexpr int kPenaltyFinder = 40;
+constexpr int kPenaltyBalance = 10;
+
+constexpr const char* kAlphanumeric = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+
+enum class Mode { kNumeric = 1, kAlphanumeric = 2, kByte = 4 };
+
+int CharacterCountBits(Mode mode, int version) {
+  int range = version <= 9 ? 0 : version <= 26 ? 1 : 2;
+
+  switch (mode) {
+    case Mode::kNumeric:
+      return 10 + 2 * range;
+    case Mode::kAlphanumeric:
+      return 9 + 2 * range;
+    default:
+      return range == 0 ? 8 : 16;
+  }
+}
+
+// Data modules of a version: everything but the function patterns, including the remainder bits.
+int RawDataModules(int version) {
+  int result = (16 * version + 128) * version + 64;
+
+  if (version >= 2) {
+    int alignments = version / 7 + 2;
+
+    result -= (25 * alignments - 10) * alignments - 55;
+    if (version >= 7) result -= 36;
+  }
+
+  return result;
+}
+
+int DataCodewords(int version, int level) {
+  return RawDataModules(version) / 8 - kEccCodewordsPerBlock[level][version] * kErrorCorrectionBlocks[level][version];
+}
+
+struct BitBuffer {
+  std::vector<uint8_t> bits;
+
+  void Append(uint32_t value, int count) {
+    for (int i = count - 1; i >= 0; i -= 1) bits.push_back((value >> i) & 1);
+  }
+};
+
+// The single segment qrcodegen's makeSegments picks for `text`.
+Mode SegmentMode(std::string_view text) {
+  bool numeric = true;
+  bool alphanumeric = true;
+
+  for (char c : text) {
+    if (c < '0' || c > '9') numeric = false;
+    if (c == '\0' || !std::strchr(kAlphanumeric, c)) alphanumeric = false;
+  }
+
+  return numeric ? Mode::kNumeric : alphanumeric ? Mode::kAlphanumeric : Mode::kByte;
+}
+
+void AppendSegment(std::string_view text, Mode mode, BitBuffer* buffer) {
+  size_t i = 0;
+
+  if (mode == Mode::kNumeric) {
+    for (; i + 3 <= text.size(); i += 3) {
+      buffer->Append((text[i] - '0') * 100 + (text[i + 1] - '0') * 10 + (text[i + 2] - '0'), 10);
+    }
+    if (text.size() - i == 2) buffer->Append((text[i] - '0') * 10 + (text[i + 1] - '0'), 7);
+    if (text.size() - i == 1) buffer->Append(text[i] - '0', 4);
+  } else if (mode == Mode::kAlphanumeric) {
+    auto value = [](char c) { return static_cast<uint32_t>(std::strchr(kAlphanumeric, c) - kAlphanumeric); };
+
+    for (; i + 2 <= text.size(); i += 2) buffer->Append(value(text[i]) * 45 + value(text[i + 1]), 11);
+    if (i < text.size()) buffer->Append(value(text[i]), 6);
+  } else {
+    for (char c : text) buffer->Append(static_cast<uint8_t>(c), 8);
+  }
+}
+
+uint8_t GfMultiply(uint8_t x, uint8_t y) {
+  int z = 0;
+
+  for (int i = 7; i >= 0; i -= 1) {
+    z = (z << 1) ^ ((z >> 7) * 0x11D);
+    z ^= ((y >> i) & 1) * x;
+  }
+
+  return static_cast<uint8_t>(z);
+}
+
+// Generator polynomial of the Reed-Solomon code with `degree` check symbols, leading coefficient dropped.
+std::vector<uint8_t> ReedSolomonDivisor(int degree) {
+  std::vector<uint8_t> result(degree, 0);
+  uint8_t root = 1;
+
+  result[degree - 1] = 1;
+  for (int i = 0; i < degree; i += 1) {
+    for (int j = 0; j < degree; j += 1) {
+      result[j] = GfMultiply(result[j], root);
+      if (j + 1 < degree) result[j] ^= result[j + 1];
+    }
+    root = GfMultiply(root, 2);
+  }
+
+  return result;
+}
+
+void ReedSolomonRemainder(const uint8_t* data, size_t size, const std::vector<uint8_t>& divisor, uint8_t* out) {
+  size_t degree = divisor.size();
+
+  std::fill(out, out + degree, 0);
+  for (size_t i = 0; i < size; i += 1) {
+    uint8_t factor = data[i] ^ out[0];
+
+    std::copy(out + 1, out + degree, out);
+    out[degree - 1] = 0;
+    for (size_t j = 0; j < degree; j += 1) out[j] ^= GfMultiply(divisor[j], factor);
+  }
+}
+
+// Splits the data codewords into blocks, appends each block's check codewords and interleaves them.
+std::vector<uint8_t> AddErrorCorrection(const std::vector<uint8_t>& data, int version, int level) {
+  int blockCount = kErrorCorrectionBlocks[level][version];
+  int eccLength = kEccCodewordsPerBlock[level][version];
+  int rawCodewords = RawDataModules(version) / 8;
+  int shortBlocks = blockCount - rawCodewords % blockCount;
+  int shortLength = rawCodewords / blockCount;
+  std::vector<uint8_t> divisor = ReedSolomonDivisor(eccLength);
+  std::vector<std::vector<uint8_t>> blocks;
+  size_t k = 0;
+
+  for (int i = 0; i < blockCount; i += 1) {
+    size_t dataLength = shortLength - eccLength + (i < shortBlocks ? 0 : 1);
+    std::vector<uint8_t> block(data.begin() + k, data.begin() + k + dataLength);
+
+    k += dataLength;
+    // Short blocks get a placeholder byte so every block has the same layout; it is skipped when interleaving.
+    if (i < shortBlocks) block.push_back(0);
+    block.resize(block.size() + eccLength);
+    ReedSolomonRemainder(block.data(), dataLength, divisor, block.data() + block.size() - eccLength);
+    blocks.push_back(std::move(block));
+  }
+
+  std::vector<uint8_t> result;
+
+  result.reserve(rawCodewords);
+  for (size_t i = 0; i < blocks[0].size(); i += 1) {
+    for (int j = 0; j < blockCount; j += 1) {
+      if (i != static_cast<size_t>(shortLength - eccLength) || j >= shortBlocks) result.push_back(blocks[j][i]);
+    }
+  }
+
+  return result;
+}
+
+bool MaskBit(int mask, int x, int y) {
+  switch (mask) {
+    case 0:
+      return (x + y) % 2 == 0;
+    case 1:
+      return y % 2 == 0;
+    case 2:
+      return x % 3 == 0;
+    case 3:
+      return (x + y) % 3 == 0;
+    case 4:
+      return (x / 3 + y / 2) % 2 == 0;
+    case 5:
+      return x * y % 2 + x * y % 3 == 0;
+    case 6:
+      return (x * y % 2 + x * y % 3) % 2 == 0;
+    default:
+      return ((x + y) % 2 + x * y % 3) % 2 == 0;
+  }
+}
+
+// Run lengths of the last seven runs of a row or column, for the finder-like pattern penalty.
+class RunHistory {
+ public:
+  explicit RunHistory(int size) : size_(size) {}
+
+  void Add(int length) {
+    // The light border before the symbol counts towards the first run.
+    if (runs_[0] == 0) length += size_;
+    std::copy_backward(runs_, runs_ + 6, runs_ + 7);
+    runs_[0] = length;
+  }
+
+  // 1:1:3:1:1 dark patterns with four light modules on either side.
+  int CountPatterns() const {
+    int n = runs_[1];
+    bool core = n > 0 && runs_[2] == n && runs_[3] == n * 3 && runs_[4] == n && runs_[5] == n;
+
+    return (core && runs_[0] >= n * 4 && runs_[6] >= n ? 1 : 0) + (core && runs_[6] >= n * 4 && runs_[0] >= n ? 1 : 0);
+  }
+
+  int TerminateAndCount(bool dark, int length) {
+    if (dark) {
+      Add(length);
+      length = 0;
+    }
+    Add(length + size_);
+
+    return CountPatterns();
+  }
+
+ private:
+  int size_;
+  int runs_[7] = {};
+};
+
+}  // namespace
+
+bool QrCode::Encode(std::string_view text, QrErrorCorrection level) {
+  Mode mode = SegmentMode(text);
+  int ecc = static_cast<int>(level);
+  int version = 1;
+  long usedBits = 0;
+
+  for (;; version += 1) {
+    int countBits = CharacterCountBits(mode, version);
+    size_t count = text.size();
+    long dataBits = static_cast<long>(count * 8);
+
+    if (mode == Mode::kNumeric) {
+      dataBits = static_cast<long>(count / 3 * 10 + (count % 3 ? count % 3 * 3 + 1 : 0));
+    } else if (mode == Mode::kAlphanumeric) {
+      dataBits = static_cast<long>(count / 2 * 11 + count % 2 * 6);
+    }
+
+    usedBits = 4 + countBits + dataBits;
+    if (count < (static_cast<size_t>(1) << countBits) && usedBits <= DataCodewords(version, ecc) * 8) break;
+    if (version == 40) return false;
+  }
+  for (int boosted = ecc + 1; boosted <= static_cast<int>(QrErrorCorrection::kHigh); boosted += 1) {
+    if (usedBits <= DataCodewords(version, boosted) * 8) ecc = boosted;
+  }
+
+  size_t capacityBits = static_cast<size_t>(DataCodewords(version, ecc)) * 8;
+  BitBuffer buffer;
+
+  if (!text.empty()) {
+    buffer.Append(static_cast<uint32_t>(mode), 4);
+    buffer.Append(static_cast<uint32_t>(text.size()), CharacterCountBits(mode, version));
+    AppendSegment(text, mode, &buffer);
+  }
+  buffer.Append(0, static_cast<int>(std::min<size_t>(4, capacityBits - buffer.bits.size())));
+  buffer.Append(0, static_cast<int>((8 - buffer.bits.size() % 8) % 8));
+  for (uint32_t pad = 0xEC; buffer.bits.size() < capacityBits; pad ^= 0xEC ^ 0x11) buffer.Append(pad, 8);
+
+  std::vector<uint8_t> data(buffer.bits.size() / 8, 0);
+
+  for (size_t i = 0; i < buffer.bits.size(); i += 1) data[i >> 3] |= buffer.bits[i] << (7 - (i & 7));
+
+  version_ = version;
+  level_ = static_cast<QrErrorCorrection>(ecc);
+  size_ = version * 4 + 17;
+  modules_.assign(static_cast<size_t>(size_) * size_, 0);
+  function_.assign(modules_.size(), 0);
+  DrawFunctionPatterns();
+  DrawCodewords(AddErrorCorrection(data, version, ecc));
+
+  long best = LONG_MAX;
+
+  // Masks are XORs, so applying one twice restores the modules.
+  for (int mask = 0; mask < 8; mask += 1) {
+    ApplyMask(mask);
+    DrawFormatBits(mask);
+
+    long penalty = Penalty();
+
+    if (penalty < best) {
+      best = penalty;
+      mask_ = mask;
+    }
+    ApplyMask(mask);
+  }
+  ApplyMask(mask_);
+  DrawFormatBits(mask_);
+
+  return true;
+}
+
+void QrCode::SetFunction(int x, int y, bool dark) {
+  size_t index = static_cast<size_t>(y) * size_ + x;
+
+  modules_[index] = dark;
+  function_[index] = 1;
+}
+
+void QrCode::DrawFunctionPatterns() {
+  for (int i = 0; i < size_; i += 1) {
+    SetFunction(6, i, i % 2 == 0);
+    SetFunction(i, 6, i % 2 == 0);
+  }
+  DrawFinder(3, 3);
+  DrawFinder(size_ - 4, 3);
+  DrawFinder(3, size_ - 4);
+
+  if (version_ > 1) {
+    int count = version_ / 7 + 2;
+    int step = (version_ * 8 + count * 3 + 5) / (count * 4 - 4) * 2;
+    std::vector<int> positions(count);
+
+    positions[0] = 6;
+    for (int i = count - 1, position = size_ - 7; i >= 1; i -= 1, position -= step) positions[i] = position;
+    for (int i = 0; i < count; i += 1) {
+      for (int j = 0; j < count; j += 1) {
+        // Corners taken by the finder patterns.
+        if ((i == 0 && j == 0) || (i == 0 && j == count - 1) || (i == count - 1 && j == 0)) continue;
+        DrawAlignment(positions[i], positions[j]);
+      }
+    }
+  }
+  // Reserve the format areas before the codewords are placed; the real bits come with the mask.
+  DrawFormatBits(0);
+  DrawVersion();
+}
+
+void QrCode::DrawFormatBits(int mask) {
+  int data = kFormatBits[static_cast<int>(level_)] << 3 | mask;
+  int remainder = data;
+
+  for (int i = 0; i < 10; i += 1) remainder = (remainder << 1) ^ ((remainder >> 9) * 0x537);
+
+  int bits = (data << 10 | remainder) ^ 0x5412;
+  auto bit = [bits](int i) { return ((bits >> i) & 1) != 0; };
+
+  for (int i = 0; i <= 5; i += 1) SetFunction(8, i, bit(i));
+  SetFunction(8, 7, bit(6));
+  SetFunction(8, 8, bit(7));
+  SetFunction(7, 8, bit(8));
+  for (int i = 9; i < 15; i += 1) SetFunction(14 - i, 8, bit(i));
+  for (int i = 0; i < 8; i += 1) SetFunction(size_ - 1 - i, 8, bit(i));
+  for (int i = 8; i < 15; i += 1) SetFunction(8, size_ - 15 + i, bit(i));
+  SetFunction(8, size_ - 8, true);
+}
+
+void QrCode::DrawVersion() {
+  if (version_ < 7) return;
+
+  int remainder = version_;
+
+  for (int i = 0; i < 12; i += 1) remainder = (remainder << 1) ^ ((remainder >> 11) * 0x1F25);
+
+  long bits = static_cast<long>(version_) << 12 | remainder;
+
+  for (int i = 0; i < 18; i += 1) {
+    bool dark = ((bits >> i) & 1) != 0;
+    int a = size_ - 11 + i % 3;
+    int b = i / 3;
+
+    SetFunction(a, b, dark);
+    SetFunction(b, a, dark);
+  }
+}
+
+void QrCode::DrawFinder(int x, int y) {
+  for (int dy = -4; dy <= 4; dy += 1) {
+    for (int dx = -4; dx <= 4; dx += 1) {
+      int distance = std::max(std::abs(dx), std::abs(dy));
+      int xx = x + dx;
+      int yy = y + dy;
+
+      if (xx >= 0 && xx < size_ && yy >= 0 && yy < size_) SetFunction(xx, yy, distance != 2 && distance != 4);
+    }
+  }
+}
+
+void QrCode::DrawAlignment(int x, int y) {
+  for (int dy = -2; dy <= 2; dy += 1) {
+    for (int dx = -2; dx <= 2; dx += 1) SetFunction(x + dx, y + dy, std::max(std::abs(dx), std::abs(dy)) != 1);
+  }
+}
+
+// Places the bits in the zigzag order of the standard: two-module columns from the right, alternating upwards and
+// downwards, skipping the vertical timing pattern and every function module.
+void QrCode::DrawCodewords(const std::vector<uint8_t>& codewords) {
+  size_t bitCount = codewords.size() * 8;
+  size_t i = 0;
+
+  for (int right = size_ - 1; right >= 1; right -= 2) {
+    if (right == 6) right = 5;
+    for (int vertical = 0; vertical < size_; vertical += 1) {
+      for (int j = 0; j < 2; j += 1) {
+        int x = right - j;
+        bool upward = ((right + 1) & 2) == 0;
+        int y = upward ? size_ - 1 - vertical : vertical;
+        size_t index = static_cast<size_t>(y) * size_ + x;
+
+        if (function_[index] || i >= bitCount) continue;
+        modules_[index] = (codewords[i >> 3] >> (7 - (i & 7))) & 1;
+        i += 1;
+      }
+    }
+  }
+}
+
+void QrCode::ApplyMask(int mask) {
+  for (int y = 0; y < size_; y += 1) {
+    for (int x = 0; x < size_; x += 1) {
+      size_t index = static_cast<size_t>(y) * size_ + x;
+
+      if (!function_[index] && MaskBit(mask, x, y)) modules_[index] ^= 1;
+    }
+  }
+}
+
+long QrCode::Penalty() const {
+  long result = 0;
+
+  // Runs of five or more same-coloured modules and finder-like patterns, along rows and then columns.
+  for (int pass = 0; pass < 2; pass += 1) {
+    for (int line = 0; line < size_; line += 1) {
+      bool runDark = false;
+      int run = 0;
+      RunHistory history(size_);
+
+      for (int i = 0; i < size_; i += 1) {
+        bool dark = pass == 0 ? Dark(i, line) : Dark(line, i);
+
+        if (dark == runDark) {
+          run += 1;
+          if (run == 5) {
+            result += kPenaltyRun;
+          } else if (run > 5) {
+            result += 1;
+          }
+        } else {
+          history.Add(run);
+          if (!runDark) result += history.CountPatterns() * kPenaltyFinder;
+          runDark = dark;
+          run = 1;
+        }
+      }
+      result += history.TerminateAndCount(runDark, run) * kPenaltyFinder;
+    }
+  }
+
+  for (int y = 0; y + 1 < size_; y += 1) {
+    for (int x = 0; x + 1 < size_; x += 1) {
+      bool dark = Dark(x, y);
+
+      if (dark == Dark(x + 1, y) && dark == Dark(x, y + 1) && dark == Dark(x + 1, y + 1)) result += kPenaltyBlock;
+    }
+  }
+
+  long dark = std::count(modules_.begin(), modules_.end(), 1);
+  long total = static_cast<long>(size_) * size_;
+  // Every 5% the dark share strays from 50%.
+  long k = (std::abs(dark * 20 - total * 10) + total - 1) / total - 1;
+
+  return result + k * kPenaltyBalance;
+}
+
+}  // namespace beam
@@ -0,0 +1,50 @@
+// QR Code Model 2 encoder (ISO/IEC 18004) producing the same symbols as the qrcodegen library behind the editor's
+// QR code generator: one numeric, alphanumeric or byte segment, the smallest version that fits, the error correction
+// level raised while it still fits that version, and the mask with the lowest penalty score.
+#ifndef BEAM_ADDON_QR_CODE_H_
+#define BEAM_ADDON_QR_CODE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace beam {
+
+enum class QrErrorCorrection { kLow, kMedium, kQuartile, kHigh };
+
+class QrCode {
+ public:
+  // Encodes UTF-8 text; false when it does not fit version 40 at `level`.
+  bool Encode(std::string_view text, QrErrorCorrection level);
+
+  // Modules per side, without a quiet zone.
+  int Size() const { return size_; }
+  int Version() const { return version_; }
+  QrErrorCorrection Level() const { return level_; }
+  int Mask() const { return mask_; }
+  bool Dark(int x, int y) const { return modules_[static_cast<size_t>(y) * size_ + x] != 0; }
+
+ private:
+  void DrawFunctionPatterns();
+  void DrawFormatBits(int mask);
+  void DrawVersion();
+  void DrawFinder(int x, int y);
+  void DrawAlignment(int x, int y);
+  void SetFunction(int x, int y, bool dark);
+  void DrawCodewords(const std::vector<uint8_t>& codewords);
+  void ApplyMask(int mask);
+  long Penalty() const;
+
+  int version_ = 0;
+  int size_ = 0;
+  QrErrorCorrection level_ = QrErrorCorrection::kLow;
+  int mask_ = 0;
+  std::vector<uint8_t> modules_;
+  // Finder, timing, alignment, format and version modules, which masks leave alone.
+  std::vector<uint8_t> function_;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_QR_CODE_H_
@@ -0,0 +1,311 @@
+#include "raster-scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "flatten.h"
+
+namespace beam {
+
+namespace {
+
+// Chord tolerance in output pixels.
+constexpr double kTolerance = 0.2;
+
+// Outlines of a stroke, each wound counterclockwise so that overlapping pieces unite under nonzero.
+class StrokeOutliner {
+ public:
+  explicit StrokeOutliner(double halfWidth) : halfWidth_(halfWidth) {}
+
+  // A quad per segment plus a round wedge on the outer side of every turn; ends are butt caps as in SVG.
+  template <typename Sink>
+  void Outline(const Vec2* points, size_t count, bool closed, Sink&& sink) {
+    line_.clear();
+    for (size_t i = 0; i < count; i += 1) {
+      if (line_.empty() || Distance(line_.back(), points[i]) > 1e-9) line_.push_back(points[i]);
+    }
+    if (closed && line_.size() > 2 && Distance(line_.front(), line_.back()) <= 1e-9) line_.pop_back();
+    if (line_.size() < 2) return;
+
+    size_t n = line_.size();
+    size_t segmentCount = closed ? n : n - 1;
+
+    for (size_t i = 0; i < segmentCount; i += 1) {
+      Vec2 p = line_[i];
+      Vec2 q = line_[(i + 1) % n];
+      Vec2 direction = Normalize(q - p);
+      Vec2 offset = Vec2{-direction.y, direction.x} * halfWidth_;
+
+      polygon_ = {p + offset, q + offset, q - offset, p - offset};
+      Flush(sink);
+    }
+    for (size_t i = closed ? 0 : 1; i < (closed ? n : n - 1); i += 1) {
+      Vec2 p = line_[i];
+      Vec2 in = Normalize(p - line_[(i + n - 1) % n]);
+      Vec2 out = Normalize(line_[(i + 1) % n] - p);
+      double turn = Cross(in, out);
+
+      if (std::fabs(turn) < 1e-6 && Dot(in, out) > 0) continue;
+
+      // The outer side is the one the path turns away from.
+      double side = turn > 0 ? -1 : 1;
+      Vec2 from = Vec2{-in.y, in.x} * side;
+      Vec2 to = Vec2{-out.y, out.x} * side;
+      double sweep = std::atan2(Cross(from, to), Dot(from, to));
+      int steps = ArcSegmentCount(halfWidth_, sweep, kTolerance);
+
+      polygon_ = {p};
+      for (int k = 0; k <= steps; k += 1) {
+        double angle = sweep * k / steps;
+        double cosine = std::cos(angle);
+        double sine = std::sin(angle);
+
+        polygon_.push_back(p + Vec2{from.x * cosine - from.y * sine, from.x * sine + from.y * cosine} * halfWidth_);
+      }
+      Flush(sink);
+    }
+  }
+
+ private:
+  template <typename Sink>
+  void Flush(Sink& sink) {
+    double area = 0;
+
+    for (size_t i = 0; i < polygon_.size(); i += 1) area += Cross(polygon_[i], polygon_[(i + 1) % polygon_.size()]);
+    if (area < 0) std::reverse(polygon_.begin(), polygon_.end());
+    sink(polygon_.data(), polygon_.size());
+  }
+
+  double halfWidth_;
+  std::vector<Vec2> line_;
+  std::vector<Vec2> polygon_;
+};
+
+}  // namespace
+
+void RasterScene::Shape::AddContour(const Vec2* contour, size_t count) {
+  points.insert(points.end(), contour, contour + count);
+  offsets.push_back(static_cast<uint32_t>(points.size()));
+  for (size_t i = 0; i < count; i += 1) bounds.Add(contour[i]);
+}
+
+RasterScene::Color RasterScene::Premultiply(uint32_t rgb, double alpha) {
+  float a = static_cast<float>(alpha);
+
+  return {((rgb >> 16) & 255) / 255.0f * a, ((rgb >> 8) & 255) / 255.0f * a, (rgb & 255) / 255.0f * a, a};
+}
+
+RasterScene::RasterScene(const std::vector<RasterItem>& items, const Affine& view) {
+  for (const RasterItem& item : items) {
+    if (!(item.opacity > 0)) continue;
+    if (item.pixels) {
+      AddImage(item, view * item.matrix);
+    } else {
+      AddPath(item, view * item.matrix);
+    }
+  }
+}
+
+void RasterScene::SetBackground(uint32_t rgb) { background_ = Premultiply(rgb, 1); }
+
+void RasterScene::AddPath(const RasterItem& item, const Affine& transform) {
+  double stretch = transform.MaxScale();
+
+  if (!(stretch > 0)) return;
+
+  Polylines lines;
+
+  FlattenPath(item.path.commands.data(), item.path.commands.size(), item.path.coords.data(), kTolerance / stretch,
+              lines);
+
+  std::vector<Vec2> points(lines.PointCount());
+
+  for (size_t i = 0; i < points.size(); i += 1) {
+    points[i] = transform.Apply({lines.points[2 * i], lines.points[2 * i + 1]});
+  }
+
+  size_t subpathCount = lines.offsets.size() - 1;
+
+  if (item.hasFill && subpathCount > 0) {
+    Shape shape;
+
+    shape.rule = item.fillRule;
+    shape.color = Premultiply(item.fill, item.opacity);
+    for (size_t i = 0; i < subpathCount; i += 1) {
+      shape.AddContour(points.data() + lines.offsets[i], lines.offsets[i + 1] - lines.offsets[i]);
+    }
+    shapes_.push_back(std::move(shape));
+  }
+  if (item.hasStroke && item.strokeWidth > 0 && subpathCount > 0) {
+    // Hairlines are drawn one pixel wide and fainter instead of dropping out.
+    StrokeOutliner outliner(std::max(item.strokeWidth, 1.0) / 2);
+    Shape shape;
+
+    shape.color = Premultiply(item.stroke, item.opacity * std::min(item.strokeWidth, 1.0));
+    for (size_t i = 0; i < subpathCount; i += 1) {
+      outliner.Outline(points.data() + lines.offsets[i], lines.offsets[i + 1] - lines.offsets[i],
+                       lines.closed[i] != 0,
+                       [&shape](const Vec2* contour, size_t count) { shape.AddContour(contour, count); });
+    }
+    if (!shape.bounds.IsEmpty()) shapes_.push_back(std::move(shape));
+  }
+}
+
+void RasterScene::AddImage(const RasterItem& item, Affine transform) {
+  Image image{item.pixels, {}, false, item.imageWidth, item.imageHeight, {}, static_cast<float>(item.opacity)};
+
+  // Halve the image with a box filter while it is shrunk more than twice, so bilinear sampling does not alias.
+  while (std::sqrt(std::fabs(transform.a * transform.d - transform.b * transform.c)) < 0.5 && image.width > 1 &&
+         image.height > 1) {
+    int width = image.width / 2;
+    int height = image.height / 2;
+    std::vector<uint8_t> halved(static_cast<size_t>(width) * height * 4);
+
+    for (int y = 0; y < height; y += 1) {
+      const uint8_t* top = image.pixels + static_cast<size_t>(2 * y) * image.width * 4;
+      const uint8_t* bottom = top + static_cast<size_t>(image.width) * 4;
+      uint8_t* row = &halved[static_cast<size_t>(y) * width * 4];
+
+      for (int x = 0; x < width; x += 1) {
+        const uint8_t* quad[4] = {top + 8 * x, top + 8 * x + 4, bottom + 8 * x, bottom + 8 * x + 4};
+        unsigned sums[4] = {0, 0, 0, 0};
+
+        for (const uint8_t* p : quad) {
+          unsigned alpha = image.premultiplied ? 255 : p[3];
+
+          for (int k = 0; k < 3; k += 1) sums[k] += (p[k] * alpha + 127) / 255;
+          sums[3] += p[3];
+        }
+        for (int k = 0; k < 4; k += 1) row[4 * x + k] = static_cast<uint8_t>((sums[k] + 2) / 4);
+      }
+    }
+    transform = transform * Affine{static_cast<double>(image.width) / width, 0, 0,
+                                   static_cast<double>(image.height) / height, 0, 0};
+    image.reduced = std::move(halved);
+    image.pixels = image.reduced.data();
+    image.premultiplied = true;
+    image.width = width;
+    image.height = height;
+  }
+  image.inverse = transform.Inverse();
+  if (image.inverse.a == 0 && image.inverse.b == 0) return;
+
+  Shape shape;
+  Vec2 corners[4] = {transform.Apply({0, 0}), transform.Apply({static_cast<double>(image.width), 0}),
+                     transform.Apply({static_cast<double>(image.width), static_cast<double>(image.height)}),
+                     transform.Apply({0, static_cast<double>(image.height)})};
+
+  shape.AddContour(corners, 4);
+  shape.image = static_cast<int>(images_.size());
+  images_.push_back(std::move(image));
+  shapes_.push_back(std::move(shape));
+}
+
+// Bilinear sample at image coordinates (u, v), clamped to the edges.
+RasterScene::Color RasterScene::Image::Sample(double u, double v) const {
+  double fx = std::min(std::max(u - 0.5, 0.0), width - 1.0);
+  double fy = std::min(std::max(v - 0.5, 0.0), height - 1.0);
+  int x0 = static_cast<int>(fx);
+  int y0 = static_cast<int>(fy);
+  int x1 = std::min(x0 + 1, width - 1);
+  int y1 = std::min(y0 + 1, height - 1);
+  float tx = static_cast<float>(fx - x0);
+  float ty = static_cast<float>(fy - y0);
+  const uint8_t* texels[4] = {pixels + (static_cast<size_t>(y0) * width + x0) * 4,
+                              pixels + (static_cast<size_t>(y0) * width + x1) * 4,
+                              pixels + (static_cast<size_t>(y1) * width + x0) * 4,
+                              pixels + (static_cast<size_t>(y1) * width + x1) * 4};
+  float weights[4] = {(1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty};
+  Color color = {0, 0, 0, 0};
+
+  for (int i = 0; i < 4; i += 1) {
+    const uint8_t* p = texels[i];
+    float alpha = p[3] / 255.0f;
+    float scale = weights[i] / 255 * (premultiplied ? 1 : alpha);
+
+    color.r += p[0] * scale;
+    color.g += p[1] * scale;
+    color.b += p[2] * scale;
+    color.a += alpha * weights[i];
+  }
+
+  return color;
+}
+
+void RasterScene::RenderTile(int x, int y, int width, int height, TileScratch& scratch, uint8_t* rgba,
+                             size_t stride) const {
+  Rasterizer& raster = scratch.raster;
+
+  if (raster.Width() < width || raster.Height() < height) raster.Reset(width, height);
+  raster.SetOrigin({static_cast<double>(x), static_cast<double>(y)});
+
+  int gridWidth = raster.Width();
+  std::vector<float>& pixels = scratch.pixels;
+  Bounds tile{static_cast<double>(x), static_cast<double>(y), static_cast<double>(x + gridWidth),
+              static_cast<double>(y + raster.Height())};
+
+  pixels.resize(static_cast<size_t>(gridWidth) * raster.Height() * 4);
+  for (size_t i = 0; i < pixels.size(); i += 4) {
+    pixels[i] = background_.r;
+    pixels[i + 1] = background_.g;
+    pixels[i + 2] = background_.b;
+    pixels[i + 3] = background_.a;
+  }
+
+  // Source-over of `color` with its alpha scaled by `amount`.
+  auto blend = [&pixels, gridWidth](int px, int py, Color color, float amount) {
+    float* pixel = &pixels[(static_cast<size_t>(py) * gridWidth + px) * 4];
+    float keep = 1 - color.a * amount;
+
+    pixel[0] = color.r * amount + pixel[0] * keep;
+    pixel[1] = color.g * amount + pixel[1] * keep;
+    pixel[2] = color.b * amount + pixel[2] * keep;
+    pixel[3] = color.a * amount + pixel[3] * keep;
+  };
+
+  for (const Shape& shape : shapes_) {
+    if (!shape.bounds.Intersects(tile)) continue;
+    for (size_t i = 0; i + 1 < shape.offsets.size(); i += 1) {
+      raster.AddContour(shape.points.data() + shape.offsets[i], shape.offsets[i + 1] - shape.offsets[i]);
+    }
+    if (shape.image < 0) {
+      raster.Sweep(shape.rule, [&](int py, int x0, int x1, const float* coverage) {
+        for (int px = x0; px < x1; px += 1) {
+          if (coverage[px - x0] > 0) blend(px, py, shape.color, coverage[px - x0]);
+        }
+      });
+      continue;
+    }
+
+    const Image& image = images_[shape.image];
+
+    raster.Sweep(FillRule::kNonZero, [&](int py, int x0, int x1, const float* coverage) {
+      for (int px = x0; px < x1; px += 1) {
+        if (coverage[px - x0] <= 0) continue;
+
+        Vec2 uv = image.inverse.Apply({x + px + 0.5, y + py + 0.5});
+
+        blend(px, py, image.Sample(uv.x, uv.y), coverage[px - x0] * image.opacity);
+      }
+    });
+  }
+
+  for (int py = 0; py < height; py += 1) {
+    const float* source = &pixels[static_cast<size_t>(py) * gridWidth * 4];
+    uint8_t* row = rgba + py * stride;
+
+    for (int i = 0; i < 4 * width; i += 4) {
+      float alpha = std::min(source[i + 3], 1.0f);
+      // Pixels that round to transparent keep no color, so edge noise below half a level does not show.
+      float unpremultiply = alpha * 255 >= 0.5f ? 255 / alpha : 0;
+
+      for (int k = 0; k < 3; k += 1) {
+        row[i + k] = static_cast<uint8_t>(std::min(source[i + k] * unpremultiply, 255.0f) + 0.5f);
+      }
+      row[i + 3] = static_cast<uint8_t>(alpha * 255 + 0.5f);
+    }
+  }
+}
+
+}  // namespace beam
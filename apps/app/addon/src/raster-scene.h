@@ -0,0 +1,103 @@
+// Scenes for the raster helpers: filled and stroked paths and RGBA images composited in order. A scene is prepared
+// once in output pixels and then drawn tile by tile, so thumbnails and full-resolution layer bitmaps share the same
+// antialiased rendering while only one tile of floating-point pixels exists per worker.
+#ifndef BEAM_ADDON_RASTER_SCENE_H_
+#define BEAM_ADDON_RASTER_SCENE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "affine.h"
+#include "path-buffer.h"
+#include "polygon.h"
+#include "rasterizer.h"
+
+namespace beam {
+
+struct RasterItem {
+  // Maps the path coordinates, or image pixels, to document coordinates.
+  Affine matrix;
+  double opacity = 1;
+
+  // Paths. Colors are 0xRRGGBB; strokes are strokeWidth output pixels wide, whatever the scale.
+  PathBuffer path;
+  bool hasFill = false;
+  bool hasStroke = false;
+  uint32_t fill = 0;
+  uint32_t stroke = 0;
+  FillRule fillRule = FillRule::kNonZero;
+  double strokeWidth = 1;
+
+  // Images: straight RGBA rows, owned by the caller. An item with pixels is drawn as an image.
+  const uint8_t* pixels = nullptr;
+  int imageWidth = 0;
+  int imageHeight = 0;
+};
+
+// Per-worker state of RenderTile; keep one per thread and reuse it for every tile.
+struct TileScratch {
+  Rasterizer raster;
+  std::vector<float> pixels;
+};
+
+class RasterScene {
+ public:
+  // Maps `items` to output pixels by `view`, flattening paths and outlining strokes once. Image pixels must outlive
+  // the scene.
+  RasterScene(const std::vector<RasterItem>& items, const Affine& view);
+
+  void SetBackground(uint32_t rgb);
+
+  // Draws the output pixels [x, x + width) x [y, y + height) as straight RGBA rows `stride` bytes apart.
+  void RenderTile(int x, int y, int width, int height, TileScratch& scratch, uint8_t* rgba, size_t stride) const;
+
+ private:
+  // Premultiplied RGBA in [0, 1].
+  struct Color {
+    float r;
+    float g;
+    float b;
+    float a;
+  };
+
+  // An image at the resolution it is sampled from: the caller's straight pixels, or a premultiplied reduction.
+  struct Image {
+    const uint8_t* pixels;
+    std::vector<uint8_t> reduced;
+    bool premultiplied;
+    int width;
+    int height;
+    // Output pixels to image pixels.
+    Affine inverse;
+    float opacity;
+
+    Color Sample(double u, double v) const;
+  };
+
+  // One coverage pass in output pixels: a fill, a stroke or the footprint of an image.
+  struct Shape {
+    std::vector<Vec2> points;
+    // Contour boundaries as point indices: [0, n0, n0 + n1, ..., points.size()].
+    std::vector<uint32_t> offsets{0};
+    Bounds bounds;
+    FillRule rule = FillRule::kNonZero;
+    Color color;
+    // Index into images_ for image footprints, -1 otherwise.
+    int image = -1;
+
+    void AddContour(const Vec2* contour, size_t count);
+  };
+
+  static Color Premultiply(uint32_t rgb, double alpha);
+  void AddPath(const RasterItem& item, const Affine& transform);
+  void AddImage(const RasterItem& item, Affine transform);
+
+  std::vector<Shape> shapes_;
+  std::vector<Image> images_;
+  Color background_ = {0, 0, 0, 0};
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_RASTER_SCENE_H_
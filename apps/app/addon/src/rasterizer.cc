@@ -0,0 +1,162 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace beam {
+
+namespace {
+
+float Coverage(float winding, FillRule rule) {
+  float amount = std::fabs(winding);
+
+  if (rule == FillRule::kNonZero) return std::min(amount, 1.0f);
+  amount = std::fmod(amount, 2.0f);
+
+  return amount > 1 ? 2 - amount : amount;
+}
+
+}  // namespace
+
+void Rasterizer::Reset(int width, int height) {
+  width_ = width;
+  height_ = height;
+  cells_.assign(static_cast<size_t>(width + 2) * height, 0);
+  coverage_.assign(width, 0);
+  rowMin_.assign(height, width + 2);
+  rowMax_.assign(height, -1);
+  minY_ = height;
+  maxY_ = -1;
+}
+
+void Rasterizer::AddEdge(Vec2 from, Vec2 to) {
+  from = from - origin_;
+  to = to - origin_;
+  if (!(from.y != to.y) || std::max(from.y, to.y) <= 0 || std::min(from.y, to.y) >= height_) return;
+
+  // Clip to the rows of the grid.
+  auto atY = [&](double y) { return Vec2{from.x + (y - from.y) / (to.y - from.y) * (to.x - from.x), y}; };
+  double bottom = height_;
+  Vec2 a = from.y < 0 ? atY(0) : from.y > bottom ? atY(bottom) : from;
+  Vec2 b = to.y < 0 ? atY(0) : to.y > bottom ? atY(bottom) : to;
+
+  // Split where the edge crosses the left and right borders; the parts outside run along the border instead.
+  double splits[4] = {0, 0, 0, 0};
+  int count = 1;
+
+  for (double border : {0.0, static_cast<double>(width_)}) {
+    double t = (border - a.x) / (b.x - a.x);
+
+    if (t > 0 && t < 1) {
+      splits[count] = t;
+      count += 1;
+    }
+  }
+  if (count == 3 && splits[1] > splits[2]) std::swap(splits[1], splits[2]);
+  splits[count] = 1;
+  count += 1;
+
+  auto clamp = [this](Vec2 p) { return Vec2{std::min(std::max(p.x, 0.0), static_cast<double>(width_)), p.y}; };
+  Vec2 previous = clamp(a);
+
+  for (int i = 1; i < count; i += 1) {
+    Vec2 next = clamp(i == count - 1 ? b : a + (b - a) * splits[i]);
+
+    DrawLine(previous, next);
+    previous = next;
+  }
+}
+
+void Rasterizer::AddContour(const Vec2* points, size_t count) {
+  if (count < 2) return;
+  for (size_t i = 0; i < count; i += 1) AddEdge(points[i], points[i + 1 == count ? 0 : i + 1]);
+}
+
+void Rasterizer::DrawLine(Vec2 p0, Vec2 p1) {
+  if (p0.y == p1.y) return;
+
+  double direction = 1;
+
+  if (p0.y > p1.y) {
+    std::swap(p0, p1);
+    direction = -1;
+  }
+
+  size_t stride = static_cast<size_t>(width_) + 2;
+  double dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+  double x = p0.x;
+  int yStart = static_cast<int>(p0.y);
+  int yEnd = std::min(height_, static_cast<int>(std::ceil(p1.y)));
+
+  for (int y = yStart; y < yEnd; y += 1) {
+    float* cells = cells_.data() + stride * y;
+    double dy = std::min(y + 1.0, p1.y) - std::max(static_cast<double>(y), p0.y);
+    double xNext = x + dxdy * dy;
+    double d = dy * direction;
+    double x0 = std::min(x, xNext);
+    double x1 = std::max(x, xNext);
+    double x0Floor = std::floor(x0);
+    double x1Ceil = std::ceil(x1);
+    int x0i = static_cast<int>(x0Floor);
+    int x1i = static_cast<int>(x1Ceil);
+
+    if (x1i <= x0i + 1) {
+      // Within one column: split the area at the mean x.
+      double xm = 0.5 * (x + xNext) - x0Floor;
+
+      cells[x0i] += static_cast<float>(d - d * xm);
+      cells[x0i + 1] += static_cast<float>(d * xm);
+      x1i = x0i + 1;
+    } else {
+      double s = 1 / (x1 - x0);
+      double x0f = x0 - x0Floor;
+      double a0 = 0.5 * s * (1 - x0f) * (1 - x0f);
+      double x1f = x1 - x1Ceil + 1;
+      double am = 0.5 * s * x1f * x1f;
+
+      cells[x0i] += static_cast<float>(d * a0);
+      if (x1i == x0i + 2) {
+        cells[x0i + 1] += static_cast<float>(d * (1 - a0 - am));
+      } else {
+        double a1 = s * (1.5 - x0f);
+
+        cells[x0i + 1] += static_cast<float>(d * (a1 - a0));
+        for (int xi = x0i + 2; xi < x1i - 1; xi += 1) cells[xi] += static_cast<float>(d * s);
+
+        double a2 = a1 + (x1i - x0i - 3) * s;
+
+        cells[x1i - 1] += static_cast<float>(d * (1 - a2 - am));
+      }
+      cells[x1i] += static_cast<float>(d * am);
+    }
+    rowMin_[y] = std::min(rowMin_[y], x0i);
+    rowMax_[y] = std::max(rowMax_[y], x1i);
+    x = xNext;
+  }
+  minY_ = std::min(minY_, yStart);
+  maxY_ = std::max(maxY_, yEnd - 1);
+}
+
+int Rasterizer::SweepRow(int y, FillRule rule) {
+  float* cells = cells_.data() + (static_cast<size_t>(width_) + 2) * y;
+  int x0 = rowMin_[y];
+  int end = rowMax_[y] + 1;
+  float winding = 0;
+
+  // Edges right of the grid were moved onto its border, so every row sums back to zero within the cells written.
+  rowMin_[y] = width_ + 2;
+  rowMax_[y] = -1;
+  if (x0 >= end) return x0;
+
+  float* coverage = coverage_.data() - x0;
+
+  for (int x = x0; x < end; x += 1) {
+    winding += cells[x];
+    cells[x] = 0;
+    if (x < width_) coverage[x] = Coverage(winding, rule);
+  }
+
+  return std::min(end, width_);
+}
+
+}  // namespace beam
@@ -0,0 +1,67 @@
+// Antialiased scan conversion by exact area coverage, after font-rs: every edge adds the signed area it sweeps to an
+// accumulation buffer, and a running sum along each row turns that into the winding-weighted coverage of each pixel.
+// Overlapping edges within one pixel add up, the usual conflation of sparse scanline rasterizers.
+#ifndef BEAM_ADDON_RASTERIZER_H_
+#define BEAM_ADDON_RASTERIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vec2.h"
+
+namespace beam {
+
+enum class FillRule : uint8_t { kNonZero, kEvenOdd };
+
+class Rasterizer {
+ public:
+  // Sizes the pixel grid and drops all edges.
+  void Reset(int width, int height);
+  // Places the grid at `origin` in the coordinates edges are given in, so one grid can render tile after tile.
+  void SetOrigin(Vec2 origin) { origin_ = origin; }
+  // Adds a directed edge; grid pixel (x, y) covers [x, x + 1) x [y, y + 1) from the origin. Edges are clipped to the
+  // grid, but parts left of it still count towards the winding of the pixels they pass.
+  void AddEdge(Vec2 from, Vec2 to);
+  // Adds a closed contour.
+  void AddContour(const Vec2* points, size_t count);
+
+  // Calls fn(y, x0, x1, coverage) for every row an edge touched, where coverage[i] in [0, 1] belongs to pixel x0 + i
+  // and x0 < x1, then drops all edges.
+  template <typename Fn>
+  void Sweep(FillRule rule, Fn&& fn) {
+    for (int y = minY_; y <= maxY_; y += 1) {
+      int x0 = rowMin_[y];
+      int x1 = SweepRow(y, rule);
+
+      if (x0 < x1) fn(y, x0, x1, static_cast<const float*>(coverage_.data()));
+    }
+    minY_ = height_;
+    maxY_ = -1;
+  }
+
+  int Width() const { return width_; }
+  int Height() const { return height_; }
+
+ private:
+  // Deposits an edge lying within [0, width] x [0, height].
+  void DrawLine(Vec2 p0, Vec2 p1);
+  // Fills coverage_ for the row from rowMin_[y], clears it and returns the end of the covered span.
+  int SweepRow(int y, FillRule rule);
+
+  int width_ = 0;
+  int height_ = 0;
+  Vec2 origin_ = {0, 0};
+  // width_ + 2 cells per row: an edge on the right border still writes past it.
+  std::vector<float> cells_;
+  std::vector<float> coverage_;
+  // Cells written in each row; rowMin_ > rowMax_ for untouched rows.
+  std::vector<int> rowMin_;
+  std::vector<int> rowMax_;
+  int minY_ = 0;
+  int maxY_ = -1;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_RASTERIZER_H_
@@ -0,0 +1,77 @@
+#include "sha1.h"
+
+#include <cstring>
+#include <vector>
+
+namespace beam {
+
+namespace {
+
+inline uint32_t RotateLeft(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+void Compress(uint32_t state[5], const uint8_t* block) {
+  uint32_t w[80];
+
+  for (int i = 0; i < 16; i += 1) {
+    w[i] = static_cast<uint32_t>(block[4 * i]) << 24 | static_cast<uint32_t>(block[4 * i + 1]) << 16 |
+           static_cast<uint32_t>(block[4 * i + 2]) << 8 | block[4 * i + 3];
+  }
+  for (int i = 16; i < 80; i += 1) w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+  uint32_t a = state[0];
+  uint32_t b = state[1];
+  uint32_t c = state[2];
+  uint32_t d = state[3];
+  uint32_t e = state[4];
+
+  for (int i = 0; i < 80; i += 1) {
+    uint32_t f;
+    uint32_t k;
+
+    if (i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5a827999;
+    } else if (i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ed9eba1;
+    } else if (i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8f1bbcdc;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xca62c1d6;
+    }
+
+    uint32_t t = RotateLeft(a, 5) + f + e + k + w[i];
+
+    e = d;
+    d = c;
+    c = RotateLeft(b, 30);
+    b = a;
+    a = t;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+}  // namespace
+
+void Sha1(const void* data, size_t size, uint8_t digest[20]) {
+  uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+  uint64_t bits = static_cast<uint64_t>(size) * 8;
+  // The inputs are short, so the padded message is built whole.
+  std::vector<uint8_t> message(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+
+  message.push_back(0x80);
+  while (message.size() % 64 != 56) message.push_back(0);
+  for (int k = 0; k < 8; k += 1) message.push_back(static_cast<uint8_t>(bits >> (56 - 8 * k)));
+  for (size_t offset = 0; offset < message.size(); offset += 64) Compress(state, message.data() + offset);
+  for (int i = 0; i < 5; i += 1) {
+    for (int k = 0; k < 4; k += 1) digest[4 * i + k] = static_cast<uint8_t>(state[i] >> (24 - 8 * k));
+  }
+}
+
+}  // namespace beam
@@ -0,0 +1,14 @@
+// SHA-1 (FIPS 180-4), for the Sec-WebSocket-Accept check of the WebSocket handshake; not for verifying data.
+#ifndef BEAM_ADDON_SHA1_H_
+#define BEAM_ADDON_SHA1_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace beam {
+
+void Sha1(const void* data, size_t size, uint8_t digest[20]);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_SHA1_H_
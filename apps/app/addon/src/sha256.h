@@ -0,0 +1,31 @@
+// Incremental SHA-256 (FIPS 180-4), for verifying transferred files.
+#ifndef BEAM_ADDON_SHA256_H_
+#define BEAM_ADDON_SHA256_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace beam {
+
+class Sha256 {
+ public:
+  Sha256();
+
+  void Update(const void* data, size_t size);
+  // Finishes the hash; the object must not be updated afterwards.
+  void Final(uint8_t digest[32]);
+  std::string HexDigest();
+
+ private:
+  void Compress(const uint8_t* block);
+
+  uint32_t state_[8];
+  uint8_t buffer_[64];
+  size_t buffered_ = 0;
+  uint64_t length_ = 0;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_SHA256_H_
@@ -0,0 +1,137 @@
+#include "simplify.h"
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <queue>
+#include <utility>
+
+#include "vec2.h"
+
+namespace beam {
+
+namespace {
+
+inline Vec2 PointAt(const double* xy, size_t i) { return {xy[2 * i], xy[2 * i + 1]}; }
+
+inline double SegmentDistanceSquared(Vec2 p, Vec2 a, Vec2 b) {
+  Vec2 ab = b - a;
+  Vec2 ap = p - a;
+  double lengthSquared = Dot(ab, ab);
+  double t = lengthSquared > 0 ? Dot(ap, ab) / lengthSquared : 0;
+
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+
+  Vec2 d = ap - ab * t;
+
+  return Dot(d, d);
+}
+
+inline double TriangleArea(Vec2 a, Vec2 b, Vec2 c) { return std::fabs(Cross(b - a, c - a)) / 2; }
+
+}  // namespace
+
+void SimplifyRdp(const double* xy, size_t count, double tolerance, std::vector<double>& out) {
+  if (count <= 2) {
+    out.insert(out.end(), xy, xy + 2 * count);
+
+    return;
+  }
+
+  double toleranceSquared = tolerance * tolerance;
+  std::vector<uint8_t> keep(count, 0);
+  std::vector<std::pair<size_t, size_t>> stack;
+
+  keep[0] = keep[count - 1] = 1;
+  stack.emplace_back(0, count - 1);
+  while (!stack.empty()) {
+    size_t first = stack.back().first;
+    size_t last = stack.back().second;
+    Vec2 a = PointAt(xy, first);
+    Vec2 b = PointAt(xy, last);
+    double maxDistance = -1;
+    size_t farthest = first;
+
+    stack.pop_back();
+    for (size_t i = first + 1; i < last; i += 1) {
+      double distance = SegmentDistanceSquared(PointAt(xy, i), a, b);
+
+      if (distance > maxDistance) {
+        maxDistance = distance;
+        farthest = i;
+      }
+    }
+    if (maxDistance > toleranceSquared) {
+      keep[farthest] = 1;
+      stack.emplace_back(farthest, last);
+      stack.emplace_back(first, farthest);
+    }
+  }
+
+  for (size_t i = 0; i < count; i += 1) {
+    if (keep[i]) {
+      out.push_back(xy[2 * i]);
+      out.push_back(xy[2 * i + 1]);
+    }
+  }
+}
+
+void SimplifyVisvalingam(const double* xy, size_t count, double minArea, std::vector<double>& out) {
+  if (count <= 2) {
+    out.insert(out.end(), xy, xy + 2 * count);
+
+    return;
+  }
+
+  // Doubly linked list over the point indices plus a lazy min-heap keyed by effective area; stale heap entries are
+  // recognised by comparing against the current area.
+  typedef std::pair<double, size_t> Entry;
+  std::vector<size_t> prev(count);
+  std::vector<size_t> next(count);
+  std::vector<double> area(count, INFINITY);
+  std::vector<uint8_t> removed(count, 0);
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+
+  for (size_t i = 0; i < count; i += 1) {
+    prev[i] = i - 1;
+    next[i] = i + 1;
+  }
+  for (size_t i = 1; i + 1 < count; i += 1) {
+    area[i] = TriangleArea(PointAt(xy, i - 1), PointAt(xy, i), PointAt(xy, i + 1));
+    heap.emplace(area[i], i);
+  }
+
+  while (!heap.empty()) {
+    Entry top = heap.top();
+    size_t i = top.second;
+
+    heap.pop();
+    if (removed[i] || top.first != area[i]) continue;
+    if (top.first >= minArea) break;
+
+    removed[i] = 1;
+    next[prev[i]] = next[i];
+    prev[next[i]] = prev[i];
+
+    // Neighbours never get a smaller effective area than the point just removed, which keeps removal order monotonic.
+    for (size_t neighbour : {prev[i], next[i]}) {
+      if (neighbour == 0 || neighbour == count - 1) continue;
+
+      double value =
+          TriangleArea(PointAt(xy, prev[neighbour]), PointAt(xy, neighbour), PointAt(xy, next[neighbour]));
+
+      area[neighbour] = value < top.first ? top.first : value;
+      heap.emplace(area[neighbour], neighbour);
+    }
+  }
+
+  for (size_t i = 0; i < count; i += 1) {
+    if (!removed[i]) {
+      out.push_back(xy[2 * i]);
+      out.push_back(xy[2 * i + 1]);
+    }
+  }
+}
+
+}  // namespace beam
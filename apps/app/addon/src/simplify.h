@@ -0,0 +1,19 @@
+// Tolerance-bounded polyline simplification. End points of every run are always kept.
+#ifndef BEAM_ADDON_SIMPLIFY_H_
+#define BEAM_ADDON_SIMPLIFY_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace beam {
+
+// Ramer–Douglas–Peucker: no dropped point is farther than `tolerance` from the simplified polyline.
+void SimplifyRdp(const double* xy, size_t count, double tolerance, std::vector<double>& out);
+
+// Visvalingam–Whyatt: repeatedly drops the point whose triangle with its neighbours has the smallest area,
+// until every remaining triangle has at least `minArea`.
+void SimplifyVisvalingam(const double* xy, size_t count, double minArea, std::vector<double>& out);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_SIMPLIFY_H_
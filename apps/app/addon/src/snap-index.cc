@@ -0,0 +1,120 @@
+#include "snap-index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace beam {
+
+namespace {
+
+template <typename Key>
+bool Before(const Key& a, const Key& b) {
+  return a.major < b.major || (a.major == b.major && a.minor < b.minor);
+}
+
+}  // namespace
+
+void SnapIndex::Load(const double* xy, size_t count) {
+  points_[0].clear();
+  points_[1].clear();
+  Add(xy, count);
+}
+
+void SnapIndex::Add(const double* xy, size_t count) {
+  for (int axis = 0; axis < 2; axis += 1) {
+    std::vector<Key>& points = points_[axis];
+    size_t old = points.size();
+
+    points.reserve(old + count);
+    for (size_t i = 0; i < count; i += 1) points.push_back({xy[2 * i + axis], xy[2 * i + 1 - axis]});
+    std::sort(points.begin() + old, points.end(), Before<Key>);
+    std::inplace_merge(points.begin(), points.begin() + old, points.end(), Before<Key>);
+  }
+}
+
+size_t SnapIndex::Remove(const double* xy, size_t count) {
+  size_t removed = 0;
+
+  for (int axis = 0; axis < 2; axis += 1) {
+    std::vector<Key>& points = points_[axis];
+    std::vector<Key> gone(count);
+
+    for (size_t i = 0; i < count; i += 1) gone[i] = {xy[2 * i + axis], xy[2 * i + 1 - axis]};
+    std::sort(gone.begin(), gone.end(), Before<Key>);
+
+    // One pass over both sorted lists, dropping one copy per listed point.
+    size_t write = 0;
+    size_t next = 0;
+
+    for (size_t read = 0; read < points.size(); read += 1) {
+      while (next < gone.size() && Before(gone[next], points[read])) next += 1;
+      if (next < gone.size() && !Before(points[read], gone[next])) {
+        next += 1;
+        continue;
+      }
+      points[write] = points[read];
+      write += 1;
+    }
+    removed = points.size() - write;
+    points.resize(write);
+  }
+
+  return removed;
+}
+
+bool SnapIndex::Match(Vec2 target, int axis, double range, Vec2* nearest, Vec2* farthest) const {
+  const std::vector<Key>& points = points_[axis];
+  double t = axis == 0 ? target.x : target.y;
+  double s = axis == 0 ? target.y : target.x;
+  // The window the editor's binary searches find: |major - t| <= range, with the same arithmetic.
+  auto begin = std::partition_point(points.begin(), points.end(), [&](const Key& key) {
+    double diff = key.major - t;
+
+    return diff < 0 && std::fabs(diff) > range;
+  });
+  auto end = std::partition_point(begin, points.end(), [&](const Key& key) {
+    double diff = key.major - t;
+
+    return !(diff > 0 && std::fabs(diff) > range);
+  });
+
+  if (begin == end) return false;
+
+  // Runs of one major value are sorted by minor: the closest minor is next to its lower bound, the farthest one at an
+  // end of the run. Runs are visited from the largest major so ties keep the first found.
+  auto best = end;
+  auto bestRun = end;
+  auto bestRunEnd = end;
+  double bestDiff = INFINITY;
+
+  for (auto runEnd = end; runEnd != begin && bestDiff > 0;) {
+    double major = (runEnd - 1)->major;
+    auto runBegin = std::partition_point(begin, runEnd, [major](const Key& key) { return key.major < major; });
+    auto above = std::partition_point(runBegin, runEnd, [s](const Key& key) { return key.minor < s; });
+
+    auto consider = [&](std::vector<Key>::const_iterator candidate) {
+      double diff = std::fabs(candidate->minor - s);
+
+      if (diff < bestDiff) {
+        best = candidate;
+        bestRun = runBegin;
+        bestRunEnd = runEnd;
+        bestDiff = diff;
+      }
+    };
+
+    if (above != runEnd) consider(above);
+    if (above != runBegin) consider(above - 1);
+    runEnd = runBegin;
+  }
+
+  double dir = best->minor - s;
+  const Key& far = dir > 0 ? *(bestRunEnd - 1) : dir < 0 ? *bestRun : *best;
+
+  *nearest = axis == 0 ? Vec2{best->major, best->minor} : Vec2{best->minor, best->major};
+  *farthest = axis == 0 ? Vec2{far.major, far.minor} : Vec2{far.minor, far.major};
+
+  return true;
+}
+
+}  // namespace beam
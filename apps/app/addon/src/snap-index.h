@@ -0,0 +1,44 @@
+// Align points for smart snapping: the editor's two sorted align point arrays, kept sorted on the other axis as well
+// so a query needs only binary searches. Answers findNearestAndFarthestAlignPoints without allocating.
+#ifndef BEAM_ADDON_SNAP_INDEX_H_
+#define BEAM_ADDON_SNAP_INDEX_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "vec2.h"
+
+namespace beam {
+
+class SnapIndex {
+ public:
+  // Replaces all points.
+  void Load(const double* xy, size_t count);
+  // Adds points; a point may be present several times.
+  void Add(const double* xy, size_t count);
+  // Removes one copy of each point; returns how many were found.
+  size_t Remove(const double* xy, size_t count);
+
+  // Matches `target` on one axis (0 for x, 1 for y). Of the points within `range` of it on that axis, `nearest` is the
+  // one closest on the other axis and `farthest` the one farthest beyond it with exactly the same coordinate on the
+  // axis (nearest itself when there is none). Ties go to the larger coordinate on the axis, then on the other axis.
+  // False when no point is within range.
+  bool Match(Vec2 target, int axis, double range, Vec2* nearest, Vec2* farthest) const;
+
+  size_t Size() const { return points_[0].size(); }
+  size_t MemoryUsage() const { return (points_[0].capacity() + points_[1].capacity()) * sizeof(Key); }
+
+ private:
+  // A point seen from one axis: its coordinate on that axis, then on the other one.
+  struct Key {
+    double major;
+    double minor;
+  };
+
+  // points_[axis] is sorted by major, then minor.
+  std::vector<Key> points_[2];
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_SNAP_INDEX_H_
@@ -0,0 +1,251 @@
+#include "socket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace beam {
+
+#ifdef _WIN32
+
+// Winsock is started by libuv before any addon runs.
+int LastSocketError() { return WSAGetLastError(); }
+bool WouldBlock(int code) { return code == WSAEWOULDBLOCK || code == WSAEINPROGRESS; }
+bool SetNonBlocking(SocketHandle handle) {
+  u_long mode = 1;
+
+  return ioctlsocket(handle, FIONBIO, &mode) == 0;
+}
+void CloseSocket(SocketHandle handle) { closesocket(handle); }
+std::string SocketErrorText(int code) { return "socket error " + std::to_string(code); }
+int PollSockets(PollEntry* entries, size_t count, int timeoutMs) {
+  // WSAPoll fails on an empty set instead of waiting.
+  if (count == 0) {
+    Sleep(timeoutMs);
+
+    return 0;
+  }
+
+  std::vector<WSAPOLLFD> polled(count);
+
+  for (size_t i = 0; i < count; i += 1) polled[i] = {entries[i].handle, entries[i].events, 0};
+
+  int ready = WSAPoll(polled.data(), static_cast<ULONG>(count), timeoutMs);
+
+  for (size_t i = 0; i < count; i += 1) entries[i].revents = polled[i].revents;
+
+  return ready;
+}
+
+#else
+
+int LastSocketError() { return errno; }
+bool WouldBlock(int code) { return code == EAGAIN || code == EWOULDBLOCK || code == EINPROGRESS || code == EINTR; }
+bool SetNonBlocking(SocketHandle handle) {
+  int flags = fcntl(handle, F_GETFL, 0);
+
+  return flags >= 0 && fcntl(handle, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+void CloseSocket(SocketHandle handle) { close(handle); }
+std::string SocketErrorText(int code) { return strerror(code); }
+int PollSockets(PollEntry* entries, size_t count, int timeoutMs) {
+  std::vector<pollfd> polled(count);
+
+  for (size_t i = 0; i < count; i += 1) polled[i] = {entries[i].handle, entries[i].events, 0};
+
+  int ready = poll(polled.data(), count, timeoutMs);
+
+  for (size_t i = 0; i < count; i += 1) entries[i].revents = polled[i].revents;
+
+  return ready < 0 && errno == EINTR ? 0 : ready;
+}
+
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+#ifdef _WIN32
+
+int PollOne(SocketHandle handle, short events, int timeoutMs, short* revents) {
+  WSAPOLLFD entry = {handle, events, 0};
+  int ready = WSAPoll(&entry, 1, timeoutMs);
+
+  *revents = entry.revents;
+
+  return ready;
+}
+int SendSome(SocketHandle handle, const char* data, size_t size) {
+  return send(handle, data, static_cast<int>(std::min<size_t>(size, INT32_MAX)), 0);
+}
+int ReceiveSome(SocketHandle handle, char* data, size_t size) {
+  return recv(handle, data, static_cast<int>(std::min<size_t>(size, INT32_MAX)), 0);
+}
+
+#else
+
+int PollOne(SocketHandle handle, short events, int timeoutMs, short* revents) {
+  pollfd entry = {handle, events, 0};
+  int ready = poll(&entry, 1, timeoutMs);
+
+  *revents = entry.revents;
+
+  return ready < 0 && errno == EINTR ? 0 : ready;
+}
+int SendSome(SocketHandle handle, const char* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+  return static_cast<int>(send(handle, data, std::min<size_t>(size, INT32_MAX), MSG_NOSIGNAL));
+#else
+  return static_cast<int>(send(handle, data, std::min<size_t>(size, INT32_MAX), 0));
+#endif
+}
+int ReceiveSome(SocketHandle handle, char* data, size_t size) {
+  return static_cast<int>(recv(handle, data, std::min<size_t>(size, INT32_MAX), 0));
+}
+
+#endif
+
+}  // namespace
+
+bool TcpSocket::IsOpen() const { return handle_ != kInvalidSocket; }
+
+bool TcpSocket::Connect(const std::string& host, uint16_t port, int timeoutMs, const std::atomic<bool>& stop,
+                        std::string* error) {
+  addrinfo hints = {};
+  addrinfo* addresses = nullptr;
+
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0 || !addresses) {
+    *error = "cannot resolve '" + host + "'";
+
+    return false;
+  }
+  *error = "cannot connect to '" + host + "'";
+  for (addrinfo* address = addresses; address && !stop; address = address->ai_next) {
+    Close();
+    handle_ = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (handle_ == kInvalidSocket || !SetNonBlocking(handle_)) continue;
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+
+    setsockopt(handle_, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    if (connect(handle_, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0 &&
+        !WouldBlock(LastSocketError())) {
+      continue;
+    }
+    if (Wait(POLLOUT, timeoutMs, stop, error) <= 0) continue;
+
+    int code = 0;
+    socklen_t length = sizeof(code);
+
+    if (getsockopt(handle_, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&code), &length) == 0 && code == 0) {
+      int noDelay = 1;
+
+      setsockopt(handle_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+      freeaddrinfo(addresses);
+      error->clear();
+
+      return true;
+    }
+    *error = "cannot connect to '" + host + "': " + SocketErrorText(code);
+  }
+  freeaddrinfo(addresses);
+  Close();
+  if (stop) *error = "cancelled";
+
+  return false;
+}
+
+int TcpSocket::Wait(short events, int timeoutMs, const std::atomic<bool>& stop, std::string* error) {
+  Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+  while (!stop) {
+    int remaining = static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+    short revents = 0;
+    int ready = PollOne(handle_, events, std::max(0, std::min(remaining, kSocketPollSlice)), &revents);
+
+    if (ready < 0) {
+      *error = SocketErrorText(LastSocketError());
+
+      return -1;
+    }
+    // Errors and hang-ups are reported by the send or receive that follows.
+    if (ready > 0) return 1;
+    if (remaining <= 0) return 0;
+  }
+  *error = "cancelled";
+
+  return -1;
+}
+
+bool TcpSocket::Send(const void* data, size_t size, int timeoutMs, const std::atomic<bool>& stop,
+                     std::string* error) {
+  const char* p = static_cast<const char*>(data);
+
+  while (size > 0) {
+    int sent = SendSome(handle_, p, size);
+
+    if (sent > 0) {
+      p += sent;
+      size -= static_cast<size_t>(sent);
+      continue;
+    }
+    if (sent < 0 && !WouldBlock(LastSocketError())) {
+      *error = SocketErrorText(LastSocketError());
+
+      return false;
+    }
+
+    int ready = Wait(POLLOUT, timeoutMs, stop, error);
+
+    if (ready == 0) *error = "send timed out";
+    if (ready <= 0) return false;
+  }
+
+  return true;
+}
+
+int TcpSocket::Receive(void* data, size_t size, int timeoutMs, const std::atomic<bool>& stop, std::string* error) {
+  int ready = Wait(POLLIN, timeoutMs, stop, error);
+
+  if (ready <= 0) return ready;
+
+  int received = ReceiveSome(handle_, static_cast<char*>(data), size);
+
+  if (received > 0) return received;
+  if (received < 0 && WouldBlock(LastSocketError())) return 0;
+  *error = received == 0 ? "connection closed" : SocketErrorText(LastSocketError());
+
+  return -1;
+}
+
+void TcpSocket::SetSendBuffer(int bytes) {
+  setsockopt(handle_, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+}
+
+void TcpSocket::Close() {
+  if (handle_ != kInvalidSocket) CloseSocket(handle_);
+  handle_ = kInvalidSocket;
+}
+
+}  // namespace beam
@@ -0,0 +1,71 @@
+// Non-blocking TCP connections driven with poll() and explicit timeouts, on POSIX sockets and Winsock. Blocking
+// calls take a stop flag that is checked at least every kSocketPollSlice milliseconds, so a worker thread can be
+// cancelled while it waits on the network. The portable shims below serve code that drives raw sockets itself.
+#ifndef BEAM_ADDON_SOCKET_H_
+#define BEAM_ADDON_SOCKET_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace beam {
+
+constexpr int kSocketPollSlice = 100;
+
+#ifdef _WIN32
+using SocketHandle = uintptr_t;
+#else
+using SocketHandle = int;
+#endif
+
+constexpr SocketHandle kInvalidSocket = static_cast<SocketHandle>(-1);
+
+// One socket of a PollSockets() call; events and revents are POLLIN, POLLOUT, POLLERR and POLLHUP bits.
+struct PollEntry {
+  SocketHandle handle;
+  short events;
+  short revents;
+};
+
+int LastSocketError();
+// The error of a non-blocking call that has yet to complete.
+bool WouldBlock(int code);
+bool SetNonBlocking(SocketHandle handle);
+void CloseSocket(SocketHandle handle);
+std::string SocketErrorText(int code);
+// poll() over `count` sockets; returns the number ready, 0 on timeout or interruption, -1 on error.
+int PollSockets(PollEntry* entries, size_t count, int timeoutMs);
+
+class TcpSocket {
+ public:
+  TcpSocket() = default;
+  ~TcpSocket() { Close(); }
+
+  TcpSocket(const TcpSocket&) = delete;
+  TcpSocket& operator=(const TcpSocket&) = delete;
+
+  // Resolves `host` and connects to the first address that answers within `timeoutMs`.
+  bool Connect(const std::string& host, uint16_t port, int timeoutMs, const std::atomic<bool>& stop,
+               std::string* error);
+  // Sends all of `data`, waiting up to `timeoutMs` each time the send buffer is full.
+  bool Send(const void* data, size_t size, int timeoutMs, const std::atomic<bool>& stop, std::string* error);
+  // Waits up to `timeoutMs` for data. Returns the number of bytes read, 0 on timeout, or -1 with `error` set when the
+  // connection failed or was closed.
+  int Receive(void* data, size_t size, int timeoutMs, const std::atomic<bool>& stop, std::string* error);
+  // Caps the bytes the kernel queues for sending, which bounds the data in flight.
+  void SetSendBuffer(int bytes);
+  void Close();
+
+  bool IsOpen() const;
+
+ private:
+  // Waits for `events` (POLLIN or POLLOUT); returns 1 when ready, 0 on timeout, -1 on error or stop.
+  int Wait(short events, int timeoutMs, const std::atomic<bool>& stop, std::string* error);
+
+  SocketHandle handle_ = static_cast<SocketHandle>(-1);
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_SOCKET_H_
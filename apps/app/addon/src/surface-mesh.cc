@@ -0,0 +1,246 @@
+#include "surface-mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+
+#include "vec2.h"
+
+namespace beam {
+
+namespace {
+
+inline uint64_t EdgeKey(uint32_t a, uint32_t b) {
+  return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+double EdgeLength2D(const SurfaceMesh& mesh, uint32_t a, uint32_t b) {
+  const double* p = &mesh.positions[3 * a];
+  const double* q = &mesh.positions[3 * b];
+
+  return Hypot(q[0] - p[0], q[1] - p[1]);
+}
+
+uint32_t Midpoint(SurfaceMesh& mesh, std::unordered_map<uint64_t, uint32_t>& cache, uint32_t a, uint32_t b) {
+  auto found = cache.find(EdgeKey(a, b));
+
+  if (found != cache.end()) return found->second;
+
+  const double* p = &mesh.positions[3 * a];
+  const double* q = &mesh.positions[3 * b];
+  const double* s = &mesh.uvs[2 * a];
+  const double* t = &mesh.uvs[2 * b];
+  uint32_t index = mesh.AddVertex((p[0] + q[0]) / 2, (p[1] + q[1]) / 2, (p[2] + q[2]) / 2, (s[0] + t[0]) / 2,
+                                  (s[1] + t[1]) / 2);
+
+  cache.emplace(EdgeKey(a, b), index);
+
+  return index;
+}
+
+struct LoopEdge {
+  uint32_t opposite[2];
+  uint32_t faces = 0;
+  uint32_t vertex = 0;
+};
+
+}  // namespace
+
+uint32_t SurfaceMesh::AddVertex(double x, double y, double z, double u, double v) {
+  uint32_t index = static_cast<uint32_t>(VertexCount());
+
+  positions.push_back(x);
+  positions.push_back(y);
+  positions.push_back(z);
+  uvs.push_back(u);
+  uvs.push_back(v);
+
+  return index;
+}
+
+void SubdivideByEdgeLength(SurfaceMesh& mesh, double maxLength) {
+  std::vector<uint32_t> pending = mesh.indices;
+  std::vector<uint32_t> result;
+  std::unordered_map<uint64_t, uint32_t> midpoints;
+
+  result.reserve(pending.size());
+  // Same LIFO order as interpolateTriangles, so triangles come out in the same order.
+  while (!pending.empty()) {
+    uint32_t c = pending.back();
+    pending.pop_back();
+    uint32_t b = pending.back();
+    pending.pop_back();
+    uint32_t a = pending.back();
+    pending.pop_back();
+
+    double l12 = EdgeLength2D(mesh, a, b);
+    double l23 = EdgeLength2D(mesh, b, c);
+    double l31 = EdgeLength2D(mesh, c, a);
+    double longest = std::max(l12, std::max(l23, l31));
+
+    if (!(longest > maxLength)) {
+      result.insert(result.end(), {a, b, c});
+      continue;
+    }
+    if (longest == l12) {
+      uint32_t m = Midpoint(mesh, midpoints, a, b);
+
+      pending.insert(pending.end(), {a, m, c, m, b, c});
+    } else if (longest == l23) {
+      uint32_t m = Midpoint(mesh, midpoints, b, c);
+
+      pending.insert(pending.end(), {a, b, m, a, m, c});
+    } else {
+      uint32_t m = Midpoint(mesh, midpoints, c, a);
+
+      pending.insert(pending.end(), {a, b, m, m, b, c});
+    }
+  }
+  mesh.indices.swap(result);
+}
+
+void LoopSubdivide(SurfaceMesh& mesh, bool preserveEdges) {
+  size_t vertexCount = mesh.VertexCount();
+  size_t triangleCount = mesh.TriangleCount();
+  size_t cornerCount = triangleCount * 3;
+  std::vector<std::pair<uint64_t, uint32_t>> corners(cornerCount);
+
+  // Group the triangle edges by their vertex pair; sorting is much cheaper than hashing on large meshes.
+  for (size_t i = 0; i < cornerCount; i += 1) {
+    size_t t = i / 3;
+
+    corners[i] = {EdgeKey(mesh.indices[i], mesh.indices[3 * t + (i + 1) % 3]), static_cast<uint32_t>(i)};
+  }
+  std::sort(corners.begin(), corners.end());
+
+  std::vector<LoopEdge> edges;
+  std::vector<uint64_t> edgeKeys;
+  std::vector<uint32_t> edgeOf(cornerCount);
+
+  for (size_t i = 0; i < cornerCount; i += 1) {
+    if (i == 0 || corners[i].first != corners[i - 1].first) {
+      edges.emplace_back();
+      edgeKeys.push_back(corners[i].first);
+    }
+
+    LoopEdge& edge = edges.back();
+    uint32_t corner = corners[i].second;
+
+    if (edge.faces < 2) edge.opposite[edge.faces] = mesh.indices[3 * (corner / 3) + (corner + 2) % 3];
+    edge.faces += 1;
+    edgeOf[corner] = static_cast<uint32_t>(edges.size() - 1);
+  }
+
+  std::vector<double> neighbourSum(3 * vertexCount, 0);
+  std::vector<uint32_t> valence(vertexCount, 0);
+  std::vector<double> creaseSum(3 * vertexCount, 0);
+  std::vector<uint32_t> creaseCount(vertexCount, 0);
+  const std::vector<double>& p = mesh.positions;
+
+  for (size_t e = 0; e < edges.size(); e += 1) {
+    uint32_t a = static_cast<uint32_t>(edgeKeys[e] >> 32);
+    uint32_t b = static_cast<uint32_t>(edgeKeys[e]);
+    bool crease = edges[e].faces != 2;
+
+    for (int k = 0; k < 3; k += 1) {
+      neighbourSum[3 * a + k] += p[3 * b + k];
+      neighbourSum[3 * b + k] += p[3 * a + k];
+      if (crease) {
+        creaseSum[3 * a + k] += p[3 * b + k];
+        creaseSum[3 * b + k] += p[3 * a + k];
+      }
+    }
+    valence[a] += 1;
+    valence[b] += 1;
+    if (crease) {
+      creaseCount[a] += 1;
+      creaseCount[b] += 1;
+    }
+  }
+
+  SurfaceMesh next;
+
+  next.positions.resize(3 * vertexCount);
+  next.uvs.assign(mesh.uvs.begin(), mesh.uvs.end());
+  next.positions.reserve(3 * (vertexCount + edges.size()));
+  next.uvs.reserve(2 * (vertexCount + edges.size()));
+
+  // Even vertices.
+  for (size_t v = 0; v < vertexCount; v += 1) {
+    double weight = 1;
+    double neighbourWeight = 0;
+    const double* sum = &neighbourSum[3 * v];
+
+    if (creaseCount[v] > 0) {
+      if (!preserveEdges && creaseCount[v] == 2) {
+        weight = 3.0 / 4;
+        neighbourWeight = 1.0 / 8;
+        sum = &creaseSum[3 * v];
+      }
+    } else if (valence[v] > 0) {
+      double n = valence[v];
+      double term = 3.0 / 8 + std::cos(2 * kPi / n) / 4;
+      double beta = (5.0 / 8 - term * term) / n;
+
+      weight = 1 - n * beta;
+      neighbourWeight = beta;
+    }
+    for (int k = 0; k < 3; k += 1) next.positions[3 * v + k] = weight * p[3 * v + k] + neighbourWeight * sum[k];
+  }
+
+  // Odd vertices, one per edge.
+  for (size_t e = 0; e < edges.size(); e += 1) {
+    uint32_t a = static_cast<uint32_t>(edgeKeys[e] >> 32);
+    uint32_t b = static_cast<uint32_t>(edgeKeys[e]);
+    LoopEdge& edge = edges[e];
+    double position[3];
+
+    for (int k = 0; k < 3; k += 1) {
+      if (edge.faces == 2) {
+        position[k] = 3.0 / 8 * (p[3 * a + k] + p[3 * b + k]) +
+                      1.0 / 8 * (p[3 * edge.opposite[0] + k] + p[3 * edge.opposite[1] + k]);
+      } else {
+        position[k] = (p[3 * a + k] + p[3 * b + k]) / 2;
+      }
+    }
+    edge.vertex = next.AddVertex(position[0], position[1], position[2], (mesh.uvs[2 * a] + mesh.uvs[2 * b]) / 2,
+                                 (mesh.uvs[2 * a + 1] + mesh.uvs[2 * b + 1]) / 2);
+  }
+
+  next.indices.resize(triangleCount * 12);
+  for (size_t t = 0; t < triangleCount; t += 1) {
+    uint32_t a = mesh.indices[3 * t];
+    uint32_t b = mesh.indices[3 * t + 1];
+    uint32_t c = mesh.indices[3 * t + 2];
+    uint32_t ab = edges[edgeOf[3 * t]].vertex;
+    uint32_t bc = edges[edgeOf[3 * t + 1]].vertex;
+    uint32_t ca = edges[edgeOf[3 * t + 2]].vertex;
+    const uint32_t children[12] = {a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca};
+
+    std::copy(children, children + 12, next.indices.begin() + 12 * t);
+  }
+  mesh = std::move(next);
+}
+
+double FaceSlopeAngle(const SurfaceMesh& mesh, size_t triangle) {
+  const double* a = &mesh.positions[3 * mesh.indices[3 * triangle]];
+  const double* b = &mesh.positions[3 * mesh.indices[3 * triangle + 1]];
+  const double* c = &mesh.positions[3 * mesh.indices[3 * triangle + 2]];
+  double ux = b[0] - a[0];
+  double uy = b[1] - a[1];
+  double uz = b[2] - a[2];
+  double vx = c[0] - a[0];
+  double vy = c[1] - a[1];
+  double vz = c[2] - a[2];
+  double nx = uy * vz - uz * vy;
+  double ny = uz * vx - ux * vz;
+  double nz = ux * vy - uy * vx;
+  double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+  if (length == 0) return 90;
+
+  return std::acos(std::min(1.0, std::fabs(nz) / length)) * 180 / kPi;
+}
+
+}  // namespace beam
@@ -0,0 +1,39 @@
+// Indexed triangle meshes for the curve engraving height surface: edge-length refinement, Loop subdivision and
+// per-face slope angles, matching createTriangularGeometry.ts and preprocessData.ts.
+#ifndef BEAM_ADDON_SURFACE_MESH_H_
+#define BEAM_ADDON_SURFACE_MESH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace beam {
+
+struct SurfaceMesh {
+  std::vector<double> positions;  // xyz per vertex
+  std::vector<double> uvs;        // uv per vertex
+  std::vector<uint32_t> indices;  // three per triangle
+
+  size_t VertexCount() const { return positions.size() / 3; }
+  size_t TriangleCount() const { return indices.size() / 3; }
+  uint32_t AddVertex(double x, double y, double z, double u, double v);
+};
+
+// Splits every triangle whose longest 2D edge exceeds `maxLength` at the midpoint of that edge until all edges are
+// short enough, like interpolateTriangles. Midpoints are shared between neighbours, but a neighbour whose own
+// longest edge is elsewhere is not forced to split, so the result can have T-junctions exactly where the JS one does.
+void SubdivideByEdgeLength(SurfaceMesh& mesh, double maxLength);
+
+// One Loop subdivision step: every triangle becomes four, new edge points use the 3/8, 1/8 stencil and old vertices
+// are smoothed with Loop's weights. Edges with fewer or more than two faces are creases; with `preserveEdges` the
+// vertices on them keep their position, otherwise they follow the cubic B-spline boundary rule. uvs are interpolated
+// linearly.
+void LoopSubdivide(SurfaceMesh& mesh, bool preserveEdges);
+
+// Angle in degrees between the face normal and the Z axis, folded into [0, 90]. Degenerate faces report 90, like
+// THREE.Vector3.angleTo with a zero normal.
+double FaceSlopeAngle(const SurfaceMesh& mesh, size_t triangle);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_SURFACE_MESH_H_
@@ -0,0 +1,601 @@
+#include "svg-path.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#include "flatten.h"
+#include "vec2.h"
+
+namespace beam {
+
+namespace {
+
+// Digits beyond this only print the noise of the binary representation.
+constexpr int kMaxPrecision = 20;
+// Powers of ten that are exact doubles.
+constexpr double kPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f'; }
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Number of values in one parameter group of a command letter: 0 for closepath, -1 for anything else.
+int GroupSize(char command) {
+  switch (command | 0x20) {
+    case 'm':
+    case 'l':
+    case 't':
+      return 2;
+    case 'h':
+    case 'v':
+      return 1;
+    case 'q':
+    case 's':
+      return 4;
+    case 'c':
+      return 6;
+    case 'a':
+      return 7;
+    case 'z':
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+// Tokens of the SVG path grammar: numbers, arc flags and the comma-whitespace between them.
+class Scanner {
+ public:
+  Scanner(const char* data, size_t size) : begin_(data), p_(data), end_(data + size) {}
+
+  size_t Offset() const { return static_cast<size_t>(p_ - begin_); }
+  bool AtEnd() const { return p_ == end_; }
+  char Peek() const { return *p_; }
+  void Advance() { p_ += 1; }
+
+  void SkipSpace() {
+    while (p_ < end_ && IsSpace(*p_)) p_ += 1;
+  }
+
+  // Whitespace with at most one comma in it.
+  void SkipSeparator() {
+    SkipSpace();
+    if (p_ < end_ && *p_ == ',') {
+      p_ += 1;
+      SkipSpace();
+    }
+  }
+
+  bool AtNumber() const { return p_ < end_ && (IsDigit(*p_) || *p_ == '.' || *p_ == '-' || *p_ == '+'); }
+
+  // sign? (digits ('.' digits?)? | '.' digits) exponent?; "1.5.5" reads as 1.5 and .5, as in browsers.
+  bool Number(double* value) {
+    const char* start = p_;
+    bool negative = p_ < end_ && *p_ == '-';
+    // Up to 15 significant digits, the usual case, are read into an integer on the way.
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int scale = 0;
+    bool hasDigits = false;
+    auto digits = [&](bool fraction) {
+      for (; p_ < end_ && IsDigit(*p_); p_ += 1) {
+        hasDigits = true;
+        if (mantissa == 0 && *p_ == '0') {
+          scale -= fraction ? 1 : 0;
+          continue;
+        }
+        significant += 1;
+        if (significant <= 15) {
+          mantissa = mantissa * 10 + static_cast<uint64_t>(*p_ - '0');
+          scale -= fraction ? 1 : 0;
+        } else {
+          scale += fraction ? 0 : 1;
+        }
+      }
+    };
+
+    if (p_ < end_ && (*p_ == '-' || *p_ == '+')) p_ += 1;
+    digits(false);
+    if (p_ < end_ && *p_ == '.') {
+      p_ += 1;
+      digits(true);
+    }
+    if (!hasDigits) {
+      p_ = start;
+
+      return false;
+    }
+    if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+      const char* exponent = p_ + 1;
+      bool negativeExponent = exponent < end_ && *exponent == '-';
+
+      if (exponent < end_ && (*exponent == '-' || *exponent == '+')) exponent += 1;
+      if (exponent < end_ && IsDigit(*exponent)) {
+        int power = 0;
+
+        for (p_ = exponent; p_ < end_ && IsDigit(*p_); p_ += 1) power = std::min(power * 10 + (*p_ - '0'), 100000);
+        scale += negativeExponent ? -power : power;
+      }
+    }
+
+    // Clinger's fast path: an exact integer times or over an exact power of ten is one correctly rounded operation.
+    if (significant <= 15 && scale >= -22 && scale <= 22) {
+      double magnitude = static_cast<double>(mantissa);
+
+      magnitude = scale < 0 ? magnitude / kPowersOfTen[-scale] : magnitude * kPowersOfTen[scale];
+      *value = negative ? -magnitude : magnitude;
+
+      return true;
+    }
+
+    // from_chars rounds correctly like JS number parsing, but takes no leading plus.
+    const char* first = *start == '+' ? start + 1 : start;
+    auto result = std::from_chars(first, p_, *value);
+
+    if (result.ec != std::errc() || result.ptr != p_ || !std::isfinite(*value)) {
+      p_ = start;
+
+      return false;
+    }
+
+    return true;
+  }
+
+  // Arc flags are a single 0 or 1 and need no separator after them ("a1 1 0 00 1 1").
+  bool Flag(bool* value) {
+    if (p_ == end_ || (*p_ != '0' && *p_ != '1')) return false;
+    *value = *p_ == '1';
+    p_ += 1;
+
+    return true;
+  }
+
+ private:
+  const char* begin_;
+  const char* p_;
+  const char* end_;
+};
+
+enum class Previous { kOther, kCubic, kQuad };
+
+class Normalizer {
+ public:
+  Normalizer(const SvgPathParseOptions& options, PathBuffer* out) : options_(options), out_(out) {
+    const double* m = options.matrix;
+
+    identity_ = m[0] == 1 && m[1] == 0 && m[2] == 0 && m[3] == 1 && m[4] == 0 && m[5] == 0;
+  }
+
+  // Applies one parameter group of `command`; relative coordinates are resolved against the current point.
+  void Segment(char command, const double* v) {
+    bool relative = command >= 'a';
+    Vec2 base = relative ? current_ : Vec2{0, 0};
+    auto point = [&](int i) { return Vec2{base.x + v[i], base.y + v[i + 1]}; };
+    Previous previous = previous_;
+
+    previous_ = Previous::kOther;
+    switch (command | 0x20) {
+      case 'm':
+        start_ = current_ = point(0);
+        Emit(kMoveTo, {current_});
+        break;
+      case 'l':
+        current_ = point(0);
+        Emit(kLineTo, {current_});
+        break;
+      case 'h':
+        current_.x = base.x + v[0];
+        Emit(kLineTo, {current_});
+        break;
+      case 'v':
+        current_.y = (relative ? current_.y : 0) + v[0];
+        Emit(kLineTo, {current_});
+        break;
+      case 'c':
+      case 's': {
+        bool smooth = (command | 0x20) == 's';
+        Vec2 c1 = !smooth ? point(0) : previous == Previous::kCubic ? current_ * 2 - control_ : current_;
+        Vec2 c2 = point(smooth ? 0 : 2);
+
+        current_ = point(smooth ? 2 : 4);
+        control_ = c2;
+        previous_ = Previous::kCubic;
+        Emit(kCubicTo, {c1, c2, current_});
+        break;
+      }
+      case 'q':
+      case 't': {
+        bool smooth = (command | 0x20) == 't';
+        Vec2 c = !smooth ? point(0) : previous == Previous::kQuad ? current_ * 2 - control_ : current_;
+
+        current_ = point(smooth ? 0 : 2);
+        control_ = c;
+        previous_ = Previous::kQuad;
+        Emit(kQuadTo, {c, current_});
+        break;
+      }
+      case 'a':
+        Arc(v[0], v[1], v[2], v[3] != 0, v[4] != 0, point(5));
+        break;
+      default:
+        break;
+    }
+  }
+
+  void Close() {
+    out_->Close();
+    current_ = start_;
+    previous_ = Previous::kOther;
+  }
+
+ private:
+  Vec2 Apply(Vec2 p) const {
+    const double* m = options_.matrix;
+
+    return {m[0] * p.x + m[2] * p.y + m[4], m[1] * p.x + m[3] * p.y + m[5]};
+  }
+
+  void Emit(PathCommand command, std::initializer_list<Vec2> points) {
+    out_->commands.push_back(command);
+    for (Vec2 p : points) {
+      Vec2 q = identity_ ? p : Apply(p);
+
+      out_->coords.push_back(q.x);
+      out_->coords.push_back(q.y);
+    }
+  }
+
+  void Arc(double rx, double ry, double rotationDeg, bool largeArc, bool sweep, Vec2 to) {
+    Vec2 from = current_;
+    EllipseArc arc;
+
+    current_ = to;
+    if (from.x == to.x && from.y == to.y) return;
+    if (!SvgArcToCenter(from, rx, ry, rotationDeg, largeArc, sweep, to, &arc)) {
+      Emit(kLineTo, {to});
+
+      return;
+    }
+    if (options_.arcsToCubics) {
+      ArcToCubics(arc, to);
+
+      return;
+    }
+    if (identity_) {
+      out_->ArcTo(arc.rx, arc.ry, rotationDeg, largeArc, sweep, to.x, to.y);
+
+      return;
+    }
+
+    // The image of the ellipse is the ellipse of the singular values of matrix * rotate(rotation) * scale(rx, ry).
+    const double* m = options_.matrix;
+    double cosRotation = std::cos(arc.rotation);
+    double sinRotation = std::sin(arc.rotation);
+    double e00 = cosRotation * arc.rx;
+    double e01 = -sinRotation * arc.ry;
+    double e10 = sinRotation * arc.rx;
+    double e11 = cosRotation * arc.ry;
+    double m00 = m[0] * e00 + m[2] * e10;
+    double m01 = m[0] * e01 + m[2] * e11;
+    double m10 = m[1] * e00 + m[3] * e10;
+    double m11 = m[1] * e01 + m[3] * e11;
+    double determinant = m[0] * m[3] - m[1] * m[2];
+    Vec2 end = Apply(to);
+
+    if (determinant == 0) {
+      out_->LineTo(end.x, end.y);
+
+      return;
+    }
+
+    double p = m00 * m00 + m01 * m01;
+    double q = m00 * m10 + m01 * m11;
+    double r = m10 * m10 + m11 * m11;
+    double mean = (p + r) / 2;
+    double spread = std::hypot((p - r) / 2, q);
+    double angle = std::atan2(2 * q, p - r) / 2 * 180 / kPi;
+
+    // A mirroring transform turns the arc the other way round.
+    out_->ArcTo(std::sqrt(mean + spread), std::sqrt(std::max(0.0, mean - spread)), angle, largeArc,
+                determinant > 0 ? sweep : !sweep, end.x, end.y);
+  }
+
+  // Standard cubic approximation of elliptical arcs, a quarter turn at most per cubic.
+  void ArcToCubics(const EllipseArc& arc, Vec2 to) {
+    int count = std::max(1, static_cast<int>(std::ceil(std::fabs(arc.sweep) / (kPi / 2) - 1e-9)));
+    double step = arc.sweep / count;
+    double handle = 4.0 / 3 * std::tan(step / 4);
+    double cosRotation = std::cos(arc.rotation);
+    double sinRotation = std::sin(arc.rotation);
+    auto at = [&](double angle, double offset) {
+      double cosAngle = std::cos(angle);
+      double sinAngle = std::sin(angle);
+      double x = arc.rx * (cosAngle - offset * sinAngle);
+      double y = arc.ry * (sinAngle + offset * cosAngle);
+
+      return Vec2{arc.center.x + cosRotation * x - sinRotation * y, arc.center.y + sinRotation * x + cosRotation * y};
+    };
+
+    for (int i = 0; i < count; i += 1) {
+      double a0 = arc.startAngle + step * i;
+      double a1 = a0 + step;
+
+      // The last end point is the exact one so the path continues without drift.
+      Emit(kCubicTo, {at(a0, handle), at(a1, -handle), i + 1 == count ? to : at(a1, 0)});
+    }
+  }
+
+  const SvgPathParseOptions& options_;
+  PathBuffer* out_;
+  bool identity_;
+  Vec2 current_ = {0, 0};
+  Vec2 start_ = {0, 0};
+  // Second control point of the previous cubic, or control point of the previous quadratic.
+  Vec2 control_ = {0, 0};
+  Previous previous_ = Previous::kOther;
+};
+
+// Enough for the integer digits of any double plus kMaxPrecision + kTieDigits decimals.
+constexpr size_t kNumberCapacity = 400;
+// Decimals past the rounding digit that tell an exact half from a near one.
+constexpr int kTieDigits = 25;
+
+// value * 10^precision rounded half away from zero, when the double product decides it: the product is off by at most
+// one ulp, so it is on the same side of the nearest half as the exact product unless it is within an ulp of it.
+// (Near) halves and values past 2^52 are left to the caller.
+bool RoundScaled(double value, int precision, int64_t* rounded) {
+  double scaled = std::fabs(value) * kPowersOfTen[precision];
+
+  if (!(scaled < 0x1p52) || std::fabs(scaled - std::floor(scaled) - 0.5) <= scaled * 0x1p-52) return false;
+
+  auto magnitude = static_cast<int64_t>(scaled + 0.5);
+
+  *rounded = value < 0 ? -magnitude : magnitude;
+
+  return true;
+}
+
+// value.toFixed(precision) without trailing zeros or negative zero: exact halves round away from zero. Returns the end
+// of the text written to `buffer` (kNumberCapacity bytes).
+char* FormatFixed(double value, int precision, char* buffer) {
+  int64_t rounded;
+
+  if (RoundScaled(value, precision, &rounded)) {
+    // Digits of the rounded integer with the decimal point put back.
+    uint64_t magnitude = static_cast<uint64_t>(rounded < 0 ? -rounded : rounded);
+    char digits[24];
+    int count = 0;
+    char* end = buffer;
+
+    do {
+      digits[count++] = static_cast<char>('0' + magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude > 0);
+    while (count <= precision) digits[count++] = '0';
+    if (rounded < 0) *end++ = '-';
+    for (int i = count - 1; i >= precision; i -= 1) *end++ = digits[i];
+
+    int last = 0;
+
+    while (last < precision && digits[last] == '0') last += 1;
+    if (last < precision) {
+      *end++ = '.';
+      for (int i = precision - 1; i >= last; i -= 1) *end++ = digits[i];
+    }
+
+    return end;
+  }
+
+  auto print = [&](int digits) {
+    return std::to_chars(buffer, buffer + kNumberCapacity, value, std::chars_format::fixed, digits).ptr;
+  };
+  // Near a half: to_chars breaks exact ties to even, so the digits are printed further to see whether it is exact.
+  char* wide = print(precision + kTieDigits);
+  const char* tail = wide - kTieDigits;
+  bool tie = *tail == '5' && std::all_of(tail + 1, static_cast<const char*>(wide), [](char c) { return c == '0'; });
+
+  char* end = wide - kTieDigits - (precision == 0 ? 1 : 0);
+
+  if (tie) {
+    char* digit = end - 1;
+
+    while (digit >= buffer && (*digit == '9' || *digit == '.')) {
+      if (*digit == '9') *digit = '0';
+      digit -= 1;
+    }
+    if (digit >= buffer && *digit != '-') {
+      *digit += 1;
+    } else {
+      // Carried past the leading digit: 9.5 becomes 10.
+      char* first = digit + 1;
+
+      std::memmove(first + 1, first, end - first);
+      *first = '1';
+      end += 1;
+    }
+  } else {
+    end = print(precision);
+  }
+  if (precision > 0) {
+    while (end[-1] == '0') end -= 1;
+    if (end[-1] == '.') end -= 1;
+  }
+  if (end - buffer == 2 && buffer[0] == '-' && buffer[1] == '0') {
+    buffer[0] = '0';
+    end -= 1;
+  }
+
+  return end;
+}
+
+// Prints `value` the way +value.toFixed(precision) prints in JS: past 15 significant digits the fixed digits do not
+// survive the round trip through a number, which prints its shortest form instead.
+char* FormatNumber(double value, int precision, char* buffer) {
+  char* end = FormatFixed(value, precision, buffer);
+  int significant = 0;
+
+  for (const char* c = buffer; c < end; c += 1) {
+    if (IsDigit(*c) && (significant > 0 || *c != '0')) significant += 1;
+  }
+  if (significant <= 15) return end;
+
+  double parsed = 0;
+
+  std::from_chars(buffer, end, parsed);
+
+  return std::to_chars(buffer, buffer + kNumberCapacity, parsed, std::chars_format::fixed).ptr;
+}
+
+void AppendNumber(double value, int precision, std::string* out) {
+  char buffer[kNumberCapacity];
+
+  out->append(buffer, FormatNumber(value, precision, buffer) - buffer);
+}
+
+// The value a reader gets back from the printed number.
+double RoundNumber(double value, int precision) {
+  int64_t rounded;
+
+  // An integer over an exact power of ten is the correctly rounded value of the printed decimal.
+  if (RoundScaled(value, precision, &rounded)) return static_cast<double>(rounded) / kPowersOfTen[precision];
+
+  char buffer[kNumberCapacity];
+  double parsed = 0;
+
+  std::from_chars(buffer, FormatNumber(value, precision, buffer), parsed);
+
+  return parsed;
+}
+
+}  // namespace
+
+bool ParseSvgPath(const char* data, size_t size, const SvgPathParseOptions& options, PathBuffer* out,
+                  size_t* errorOffset) {
+  Scanner scanner(data, size);
+  Normalizer normalizer(options, out);
+  double values[7];
+  bool first = true;
+
+  scanner.SkipSpace();
+  while (!scanner.AtEnd()) {
+    size_t commandOffset = scanner.Offset();
+    char command = scanner.Peek();
+    int groupSize = GroupSize(command);
+
+    if (groupSize < 0 || (first && (command | 0x20) != 'm')) {
+      *errorOffset = commandOffset;
+
+      return false;
+    }
+    first = false;
+    scanner.Advance();
+    scanner.SkipSpace();
+    if (groupSize == 0) {
+      normalizer.Close();
+      continue;
+    }
+
+    // Parameter groups repeat until the next command letter; after a moveto they are implicit linetos.
+    while (true) {
+      size_t groupOffset = scanner.Offset();
+
+      for (int i = 0; i < groupSize; i += 1) {
+        bool ok;
+
+        if (i > 0) scanner.SkipSeparator();
+        if ((command | 0x20) == 'a' && (i == 3 || i == 4)) {
+          bool flag;
+
+          ok = scanner.Flag(&flag);
+          values[i] = flag ? 1 : 0;
+        } else {
+          ok = scanner.Number(&values[i]);
+        }
+        if (!ok) {
+          *errorOffset = i == 0 ? groupOffset : scanner.Offset();
+
+          return false;
+        }
+      }
+      normalizer.Segment(command, values);
+      if (command == 'M') command = 'L';
+      if (command == 'm') command = 'l';
+      scanner.SkipSpace();
+      if (!scanner.AtEnd() && scanner.Peek() == ',') {
+        scanner.Advance();
+        scanner.SkipSpace();
+        if (!scanner.AtNumber()) {
+          *errorOffset = scanner.Offset();
+
+          return false;
+        }
+      }
+      if (!scanner.AtNumber()) break;
+    }
+  }
+
+  return true;
+}
+
+void WriteSvgPath(const uint8_t* commands, size_t commandCount, const double* coords,
+                  const SvgPathWriteOptions& options, std::string* out) {
+  int precision = std::min(std::max(options.precision, 0), kMaxPrecision);
+  auto snap = [&](double value) { return RoundNumber(value, precision); };
+  // Rounded current point and subpath start, the origin of relative coordinates.
+  Vec2 current = {0, 0};
+  Vec2 start = {0, 0};
+  auto point = [&](const double* xy) {
+    Vec2 p = options.relative ? Vec2{snap(xy[0]) - current.x, snap(xy[1]) - current.y} : Vec2{xy[0], xy[1]};
+
+    AppendNumber(p.x, precision, out);
+    out->push_back(',');
+    AppendNumber(p.y, precision, out);
+  };
+
+  out->reserve(out->size() + commandCount * 12);
+  for (size_t i = 0; i < commandCount; i += 1) {
+    const double* c = coords;
+    uint8_t command = commands[i];
+    int arity = kPathCommandArity[command];
+
+    coords += arity;
+    if (command == kClose) {
+      out->push_back('z');
+      current = start;
+      continue;
+    }
+    out->push_back("MLQCA"[command] + (options.relative ? 'a' - 'A' : 0));
+    switch (command) {
+      case kQuadTo:
+        point(c);
+        out->push_back(' ');
+        break;
+      case kCubicTo:
+        point(c);
+        out->push_back(' ');
+        point(c + 2);
+        out->push_back(' ');
+        break;
+      case kArcTo:
+        AppendNumber(c[0], precision, out);
+        out->push_back(',');
+        AppendNumber(c[1], precision, out);
+        out->push_back(' ');
+        AppendNumber(c[2], precision, out);
+        out->append(c[3] != 0 ? " 1" : " 0");
+        out->append(c[4] != 0 ? " 1 " : " 0 ");
+        break;
+      default:
+        break;
+    }
+    point(c + arity - 2);
+    if (options.relative) current = {snap(c[arity - 2]), snap(c[arity - 1])};
+    if (command == kMoveTo) start = current;
+  }
+}
+
+}  // namespace beam
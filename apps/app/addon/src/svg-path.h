@@ -0,0 +1,39 @@
+// SVG path data (the d attribute) to and from the packed path-buffer.h representation.
+#ifndef BEAM_ADDON_SVG_PATH_H_
+#define BEAM_ADDON_SVG_PATH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "path-buffer.h"
+
+namespace beam {
+
+struct SvgPathParseOptions {
+  // Affine transform baked into every point, as SVG matrix(a, b, c, d, e, f).
+  double matrix[6] = {1, 0, 0, 1, 0, 0};
+  // Arcs become cubics of at most a quarter turn each; otherwise they stay arcs, with the ellipse transformed.
+  bool arcsToCubics = true;
+};
+
+// Normalizes path data into `out`: every coordinate absolute, H and V as lines, S and T with their reflected control
+// point spelled out. Returns false at the first syntax error, with `out` holding the segments before it (what SVG
+// renders) and `errorOffset` the byte offset of the error.
+bool ParseSvgPath(const char* data, size_t size, const SvgPathParseOptions& options, PathBuffer* out,
+                  size_t* errorOffset);
+
+struct SvgPathWriteOptions {
+  // Digits after the decimal point; trailing zeros are dropped (svgedit's shortFloat with round_digits).
+  int precision = 5;
+  // Lowercase commands relative to the previous end point, measured between rounded points so errors do not add up.
+  bool relative = false;
+};
+
+// Serializes a valid packed path in the compact form svgedit's convertPath writes ("M1,2L3,4C5,6 7,8 9,10z").
+void WriteSvgPath(const uint8_t* commands, size_t commandCount, const double* coords,
+                  const SvgPathWriteOptions& options, std::string* out);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_SVG_PATH_H_
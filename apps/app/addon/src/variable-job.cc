@@ -0,0 +1,310 @@
+#include "variable-job.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+
+#include "parallel.h"
+
+namespace beam {
+
+namespace {
+
+// U+0085, which joins the lines of a text element's content in the editor.
+constexpr std::string_view kLineSeparator = "\xC2\x85";
+
+// Decodes UTF-8, replacing malformed sequences with U+FFFD.
+void Utf8ToUtf16(std::string_view text, std::vector<uint16_t>* out) {
+  out->clear();
+  for (size_t i = 0; i < text.size();) {
+    uint8_t lead = static_cast<uint8_t>(text[i]);
+    size_t length = lead < 0x80 ? 1 : lead >= 0xF0 && lead < 0xF5 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC2 ? 2 : 0;
+    uint32_t codePoint = length == 1 ? lead : length == 2 ? lead & 0x1F : length == 3 ? lead & 0x0F : lead & 0x07;
+    size_t k = 1;
+
+    for (; k < length && i + k < text.size() && (static_cast<uint8_t>(text[i + k]) & 0xC0) == 0x80; k += 1) {
+      codePoint = codePoint << 6 | (static_cast<uint8_t>(text[i + k]) & 0x3F);
+    }
+
+    bool overlong = (length == 3 && codePoint < 0x800) || (length == 4 && codePoint < 0x10000);
+    bool invalid = (codePoint >= 0xD800 && codePoint < 0xE000) || codePoint > 0x10FFFF;
+
+    if (length == 0 || k < length || overlong || invalid) {
+      out->push_back(0xFFFD);
+      i += std::max<size_t>(k, 1);
+      continue;
+    }
+    if (codePoint >= 0x10000) {
+      codePoint -= 0x10000;
+      out->push_back(static_cast<uint16_t>(0xD800 + (codePoint >> 10)));
+      out->push_back(static_cast<uint16_t>(0xDC00 + (codePoint & 0x3FF)));
+    } else {
+      out->push_back(static_cast<uint16_t>(codePoint));
+    }
+    i += length;
+  }
+}
+
+// The product m * local of two affine matrices [a, b, c, d, e, f].
+void Multiply(const double* m, const double* local, double* out) {
+  out[0] = m[0] * local[0] + m[2] * local[1];
+  out[1] = m[1] * local[0] + m[3] * local[1];
+  out[2] = m[0] * local[2] + m[2] * local[3];
+  out[3] = m[1] * local[2] + m[3] * local[3];
+  out[4] = m[0] * local[4] + m[2] * local[5] + m[4];
+  out[5] = m[1] * local[4] + m[3] * local[5] + m[5];
+}
+
+void AppendRect(double x0, double y0, double x1, double y1, const double* m, PathBuffer* out) {
+  auto point = [m](double x, double y, double* px, double* py) {
+    *px = m[0] * x + m[2] * y + m[4];
+    *py = m[1] * x + m[3] * y + m[5];
+  };
+  double x;
+  double y;
+
+  point(x0, y0, &x, &y);
+  out->MoveTo(x, y);
+  point(x1, y0, &x, &y);
+  out->LineTo(x, y);
+  point(x1, y1, &x, &y);
+  out->LineTo(x, y);
+  point(x0, y1, &x, &y);
+  out->LineTo(x, y);
+  out->Close();
+}
+
+std::string SlotValue(const VariableSlot& slot, const VariableRun& run, size_t piece, const std::string& time) {
+  static const std::vector<std::string> kEmptyRow;
+  int64_t serial =
+      WrapSerial(run.current + static_cast<int64_t>(piece) * run.advanceBy + slot.offset, run.start, run.end);
+
+  switch (slot.source) {
+    case SlotSource::kNumber:
+      return FormatSerial(slot.content, serial);
+    case SlotSource::kTime:
+      return time;
+    case SlotSource::kCsv:
+      return FillCsvFields(slot.content,
+                           serial >= 0 && static_cast<uint64_t>(serial) < run.csv.size() ? run.csv[serial] : kEmptyRow);
+    default:
+      return slot.content;
+  }
+}
+
+// Splits a text value into lines and shapes each.
+void ShapeLines(const VariableSlot& slot, std::string_view value, std::vector<GlyphRun>* lines) {
+  std::vector<uint16_t> text;
+
+  lines->clear();
+  while (true) {
+    size_t end = value.find(kLineSeparator);
+
+    Utf8ToUtf16(value.substr(0, end), &text);
+    lines->emplace_back();
+    slot.shaper->Shape(text.data(), text.size(), slot.layout, &lines->back());
+    if (end == std::string_view::npos) break;
+    value.remove_prefix(end + kLineSeparator.size());
+  }
+}
+
+void AppendText(const VariableSlot& slot, const std::vector<GlyphRun>& lines, PathBuffer* out) {
+  double scale = slot.fontSize / slot.font->UnitsPerEm();
+
+  for (size_t line = 0; line < lines.size(); line += 1) {
+    const GlyphRun& run = lines[line];
+    double width = 0;
+
+    for (int32_t advance : run.advances) width += advance * scale + slot.letterSpacing;
+
+    double pen = slot.align == TextAlign::kMiddle ? -width / 2 : slot.align == TextAlign::kEnd ? -width : 0;
+    double baseline = static_cast<double>(line) * slot.fontSize * slot.lineSpacing;
+
+    for (size_t i = 0; i < run.glyphs.size(); i += 1) {
+      double local[6] = {scale, 0, 0, -scale, pen, baseline};
+      double m[6];
+      GlyphOutline outline = slot.font->CachedOutline(run.glyphs[i]);
+      size_t start = out->coords.size();
+
+      Multiply(slot.matrix, local, m);
+      out->commands.insert(out->commands.end(), outline.commands, outline.commands + outline.commandCount);
+      out->coords.resize(start + outline.coordCount);
+      for (size_t k = 0; k + 1 < outline.coordCount; k += 2) {
+        double x = outline.coords[k];
+        double y = outline.coords[k + 1];
+
+        out->coords[start + k] = m[0] * x + m[2] * y + m[4];
+        out->coords[start + k + 1] = m[1] * x + m[3] * y + m[5];
+      }
+      pen += run.advances[i] * scale + slot.letterSpacing;
+    }
+  }
+}
+
+// Rows of modules merged into runs, one rectangle each.
+bool AppendQrCode(const VariableSlot& slot, const std::string& value, PathBuffer* out) {
+  QrCode code;
+
+  if (!code.Encode(value, slot.errorLevel)) return false;
+
+  int margin = slot.margin;
+  int extent = code.Size() + 2 * margin;
+
+  for (int y = 0; y < extent; y += 1) {
+    for (int x = 0; x < extent;) {
+      auto dark = [&](int column) {
+        int cx = column - margin;
+        int cy = y - margin;
+        bool inside = cx >= 0 && cy >= 0 && cx < code.Size() && cy < code.Size();
+
+        return (inside && code.Dark(cx, cy)) != slot.invert;
+      };
+
+      if (!dark(x)) {
+        x += 1;
+        continue;
+      }
+
+      int end = x + 1;
+
+      while (end < extent && dark(end)) end += 1;
+      AppendRect(x, y, end, y + 1, slot.matrix, out);
+      x = end;
+    }
+  }
+
+  return true;
+}
+
+bool AppendBarcode(const VariableSlot& slot, const std::string& value, PathBuffer* out) {
+  std::vector<uint8_t> modules;
+
+  if (!EncodeCode128(value, slot.barcodeSet, &modules)) return false;
+
+  double margin = slot.barMargin;
+  double top = margin;
+  double bottom = margin + slot.barHeight;
+  double width = 2 * margin + modules.size() * slot.barWidth;
+  uint8_t drawn = slot.invert ? 0 : 1;
+
+  if (slot.invert && margin > 0) AppendRect(0, 0, width, top, slot.matrix, out);
+  for (size_t i = 0; i < modules.size();) {
+    if (modules[i] != drawn) {
+      i += 1;
+      continue;
+    }
+
+    size_t end = i + 1;
+
+    while (end < modules.size() && modules[end] == drawn) end += 1;
+    AppendRect(margin + i * slot.barWidth, top, margin + end * slot.barWidth, bottom, slot.matrix, out);
+    i = end;
+  }
+  if (slot.invert && margin > 0) {
+    AppendRect(0, top, margin, bottom, slot.matrix, out);
+    AppendRect(width - margin, top, width, bottom, slot.matrix, out);
+    AppendRect(0, bottom, width, bottom + margin, slot.matrix, out);
+  }
+
+  return true;
+}
+
+}  // namespace
+
+bool GenerateVariableBatch(const std::vector<VariableSlot>& slots, const VariableRun& run, VariableBatch* batch,
+                           std::string* error) {
+  size_t slotCount = slots.size();
+  size_t cells = run.count * slotCount;
+  std::vector<std::string> times(slotCount);
+
+  // A run is stamped with one instant, like the editor's single getLocalizedTime call.
+  for (size_t s = 0; s < slotCount; s += 1) {
+    if (slots[s].source != SlotSource::kTime) continue;
+    times[s] = FormatTime(slots[s].content, run.time, run.utcOffset, run.locale);
+  }
+
+  std::vector<std::vector<GlyphRun>> lines(cells);
+
+  batch->values.assign(cells, std::string());
+  ParallelFor(run.count, [&](size_t piece) {
+    for (size_t s = 0; s < slotCount; s += 1) {
+      std::string& value = batch->values[piece * slotCount + s];
+
+      value = SlotValue(slots[s], run, piece, times[s]);
+      if (slots[s].code == SlotCode::kText) ShapeLines(slots[s], value, &lines[piece * slotCount + s]);
+    }
+  });
+
+  // Outlines are decoded into each font's cache up front, which the pieces then only read.
+  for (size_t cell = 0; cell < cells; cell += 1) {
+    const VariableSlot& slot = slots[cell % slotCount];
+
+    if (slot.code != SlotCode::kText) continue;
+    for (const GlyphRun& line : lines[cell]) {
+      for (uint16_t glyph : line.glyphs) slot.font->Outline(glyph);
+    }
+  }
+
+  std::vector<PathBuffer> pieces(run.count);
+  // Command counts per slot, and the first slot that failed per piece.
+  std::vector<uint32_t> counts(cells, 0);
+  std::vector<size_t> failed(run.count, SIZE_MAX);
+
+  ParallelFor(run.count, [&](size_t piece) {
+    PathBuffer& path = pieces[piece];
+
+    for (size_t s = 0; s < slotCount; s += 1) {
+      size_t cell = piece * slotCount + s;
+      const std::string& value = batch->values[cell];
+      size_t before = path.commands.size();
+      bool encoded = true;
+
+      if (slots[s].code == SlotCode::kText) {
+        AppendText(slots[s], lines[cell], &path);
+      } else if (!value.empty()) {
+        encoded = slots[s].code == SlotCode::kQrCode ? AppendQrCode(slots[s], value, &path)
+                                                     : AppendBarcode(slots[s], value, &path);
+      }
+      if (!encoded) {
+        failed[piece] = s;
+
+        return;
+      }
+      counts[cell] = static_cast<uint32_t>(path.commands.size() - before);
+    }
+  });
+
+  for (size_t piece = 0; piece < run.count; piece += 1) {
+    if (failed[piece] == SIZE_MAX) continue;
+
+    size_t s = failed[piece];
+
+    *error = "piece " + std::to_string(piece) + ", slot " + std::to_string(s) + ": " +
+             (slots[s].code == SlotCode::kQrCode ? "too long for a QR code" : "not encodable as this barcode") +
+             ": \"" + batch->values[piece * slotCount + s] + "\"";
+
+    return false;
+  }
+
+  size_t commandCount = 0;
+  size_t coordCount = 0;
+
+  for (const PathBuffer& path : pieces) {
+    commandCount += path.commands.size();
+    coordCount += path.coords.size();
+  }
+  batch->path.Clear();
+  batch->path.commands.reserve(commandCount);
+  batch->path.coords.reserve(coordCount);
+  batch->offsets.assign(1, 0);
+  batch->offsets.reserve(cells + 1);
+  for (size_t cell = 0; cell < cells; cell += 1) batch->offsets.push_back(batch->offsets.back() + counts[cell]);
+  for (PathBuffer& path : pieces) {
+    batch->path.Append(path);
+    path = PathBuffer();
+  }
+
+  return true;
+}
+
+}  // namespace beam
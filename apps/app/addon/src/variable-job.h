@@ -0,0 +1,89 @@
+// Production runs of variable text: a template of slots (texts, QR codes and barcodes whose content is fixed, a serial
+// number, the date or a CSV row) evaluated for many pieces at once, each piece's geometry built on its own core.
+#ifndef BEAM_ADDON_VARIABLE_JOB_H_
+#define BEAM_ADDON_VARIABLE_JOB_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "code128.h"
+#include "font-layout.h"
+#include "font.h"
+#include "path-buffer.h"
+#include "qr-code.h"
+#include "variable-text.h"
+
+namespace beam {
+
+// Where a slot's value comes from, numbered like the editor's VariableTextType.
+enum class SlotSource { kFixed = 0, kNumber = 1, kTime = 2, kCsv = 3 };
+
+enum class SlotCode { kText, kQrCode, kBarcode };
+
+enum class TextAlign { kStart, kMiddle, kEnd };
+
+struct VariableSlot {
+  SlotSource source = SlotSource::kFixed;
+  SlotCode code = SlotCode::kText;
+  // Template the value is formatted from; lines of a text are separated by U+0085 as in the editor.
+  std::string content;
+  // Added to the serial number before wrapping, as data-vt-offset.
+  int64_t offset = 0;
+  // Placement of the slot's local geometry, as SVG matrix(a, b, c, d, e, f).
+  double matrix[6] = {1, 0, 0, 1, 0, 0};
+  // Draws the light modules or spaces instead of the dark ones, over the whole symbol with its margins.
+  bool invert = false;
+
+  // Texts: the first baseline starts at the origin, y down, further lines fontSize * lineSpacing apart.
+  Font* font = nullptr;
+  const TextShaper* shaper = nullptr;
+  double fontSize = 16;
+  double letterSpacing = 0;
+  double lineSpacing = 1;
+  TextAlign align = TextAlign::kStart;
+  LayoutOptions layout;
+
+  // QR codes: one unit per module, the symbol's top-left corner at the origin after `margin` light modules.
+  QrErrorCorrection errorLevel = QrErrorCorrection::kLow;
+  int margin = 0;
+
+  // Barcodes: JsBarcode's layout, with bars `barWidth` wide and `barHeight` high inside a `barMargin` border.
+  Code128Set barcodeSet = Code128Set::kAuto;
+  double barWidth = 2;
+  double barHeight = 100;
+  double barMargin = 10;
+};
+
+// The production run: the editor's variable text settings plus the pieces to generate.
+struct VariableRun {
+  int64_t start = 0;
+  int64_t end = 999;
+  int64_t current = 0;
+  int64_t advanceBy = 1;
+  size_t count = 1;
+  std::vector<std::vector<std::string>> csv;
+  int64_t time = 0;
+  int utcOffset = 0;
+  TimeLocale locale;
+};
+
+struct VariableBatch {
+  // Geometry of every slot of every piece in y-down user units.
+  PathBuffer path;
+  // Command range of slot s of piece i: offsets[i * slots + s] to the next entry.
+  std::vector<uint32_t> offsets;
+  // Value of slot s of piece i at i * slots + s.
+  std::vector<std::string> values;
+};
+
+// Formats every value, lays the texts out and encodes the codes on all cores. Empty values draw nothing. Returns
+// false with a message naming the piece and slot when a value cannot be encoded (a QR code too long, a barcode with
+// characters its set lacks); `batch` is then incomplete.
+bool GenerateVariableBatch(const std::vector<VariableSlot>& slots, const VariableRun& run, VariableBatch* batch,
+                           std::string* error);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_VARIABLE_JOB_H_
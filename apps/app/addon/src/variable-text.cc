@@ -0,0 +1,281 @@
+#include "variable-text.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+
+namespace beam {
+
+namespace {
+
+std::string Pad(int64_t value, size_t width) {
+  std::string text = std::to_string(value);
+
+  if (text.size() < width) text.insert(0, width - text.size(), '0');
+
+  return text;
+}
+
+std::string ToBase(int64_t value, int base, bool upper) {
+  const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  std::string text;
+
+  do {
+    text.push_back(digits[magnitude % base]);
+    magnitude /= base;
+  } while (magnitude > 0);
+  if (value < 0) text.push_back('-');
+  std::reverse(text.begin(), text.end());
+
+  return text;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date, and back (H. Hinnant's civil calendar algorithms).
+int64_t DaysFromCivil(int64_t year, int month, int day) {
+  year -= month <= 2;
+
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  int64_t yearOfEra = year - era * 400;
+  int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+  return era * 146097 + dayOfEra - 719468;
+}
+
+void CivilFromDays(int64_t days, int64_t* year, int* month, int* day) {
+  days += 719468;
+
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int64_t dayOfEra = days - era * 146097;
+  int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+
+  *day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+  *month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+  *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+int64_t FloorDiv(int64_t a, int64_t b) { return a / b - (a % b != 0 && (a < 0) != (b < 0)); }
+
+// Length of the run of `c` at `i`, at most `limit`.
+size_t RunLength(std::string_view text, size_t i, char c, size_t limit) {
+  size_t n = 0;
+
+  while (i + n < text.size() && text[i + n] == c && n < limit) n += 1;
+
+  return n;
+}
+
+std::string Name(const std::vector<std::string>& names, size_t i) { return i < names.size() ? names[i] : ""; }
+
+// dayjs's getShort: the short name, else the first `length` characters of the long one.
+std::string ShortName(const std::vector<std::string>& shortNames, const std::vector<std::string>& names, size_t i,
+                      size_t length) {
+  if (!shortNames.empty()) return Name(shortNames, i);
+
+  std::string name = Name(names, i);
+  size_t end = 0;
+
+  for (size_t count = 0; end < name.size() && count < length; count += 1) {
+    end += 1;
+    while (end < name.size() && (static_cast<uint8_t>(name[end]) & 0xC0) == 0x80) end += 1;
+  }
+
+  return name.substr(0, end);
+}
+
+}  // namespace
+
+int64_t WrapSerial(int64_t current, int64_t start, int64_t end) {
+  if (start >= end) return start;
+
+  int64_t range = end - start + 1;
+
+  return ((current - start) % range + range) % range + start;
+}
+
+std::string FormatSerial(std::string_view content, int64_t value) {
+  for (size_t i = 0; i < content.size(); i += 1) {
+    bool pad = content[i] == '0' && i + 1 < content.size() &&
+               (content[i + 1] == 'd' || content[i + 1] == 'h' || content[i + 1] == 'H');
+    size_t first = pad ? i + 1 : i;
+    char format = content[first];
+
+    if (format != 'd' && format != 'h' && format != 'H') continue;
+
+    size_t length = RunLength(content, first, format, content.size());
+    std::string digits = format == 'd' ? ToBase(value, 10, false) : ToBase(value, 16, format == 'H');
+
+    if (pad && digits.size() < length) digits.insert(0, length - digits.size(), '0');
+    if (digits.size() > length) digits.erase(0, digits.size() - length);
+
+    std::string result(content.substr(0, i));
+
+    result += digits;
+    result += content.substr(first + length);
+
+    return result;
+  }
+
+  return std::string(content);
+}
+
+std::string FillCsvFields(std::string_view content, const std::vector<std::string>& row) {
+  std::string result;
+
+  for (size_t i = 0; i < content.size(); i += 1) {
+    size_t end = i + 1;
+    size_t index = 0;
+
+    if (content[i] == '%') {
+      for (; end < content.size() && content[end] >= '0' && content[end] <= '9'; end += 1) {
+        index = std::min<size_t>(index * 10 + (content[end] - '0'), SIZE_MAX / 10);
+      }
+    }
+    if (end == i + 1) {
+      result.push_back(content[i]);
+      continue;
+    }
+    if (index < row.size()) result += row[index];
+    i = end - 1;
+  }
+
+  return result;
+}
+
+TimeLocale::TimeLocale()
+    : months({"January", "February", "March", "April", "May", "June", "July", "August", "September", "October",
+              "November", "December"}),
+      weekdays({"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"}) {}
+
+std::string FormatTime(std::string_view content, int64_t epochMs, int utcOffsetMinutes, const TimeLocale& locale) {
+  int64_t localMs = epochMs + static_cast<int64_t>(utcOffsetMinutes) * 60000;
+  int64_t days = FloorDiv(localMs, 86400000);
+  int64_t msOfDay = localMs - days * 86400000;
+  int64_t year;
+  int month;
+  int day;
+
+  CivilFromDays(days, &year, &month, &day);
+
+  int weekday = static_cast<int>(((days + 4) % 7 + 7) % 7);
+  int hour = static_cast<int>(msOfDay / 3600000);
+  int minute = static_cast<int>(msOfDay / 60000 % 60);
+  int second = static_cast<int>(msOfDay / 1000 % 60);
+  int millisecond = static_cast<int>(msOfDay % 1000);
+  int offset = std::abs(utcOffsetMinutes);
+  std::string zone = std::string(utcOffsetMinutes >= 0 ? "+" : "-") + Pad(offset / 60, 2) + ":" + Pad(offset % 60, 2);
+  std::string result;
+
+  for (size_t i = 0; i < content.size();) {
+    char c = content[i];
+
+    if (c == '[') {
+      size_t close = content.find(']', i + 1);
+
+      if (close != std::string_view::npos && close > i + 1) {
+        result += content.substr(i + 1, close - i - 1);
+        i = close + 1;
+        continue;
+      }
+    }
+
+    size_t limit = 0;
+
+    switch (c) {
+      case 'Y':
+      case 'M':
+      case 'd':
+        limit = 4;
+        break;
+      case 'D':
+      case 'H':
+      case 'h':
+      case 'm':
+      case 's':
+      case 'Z':
+        limit = 2;
+        break;
+      case 'a':
+      case 'A':
+        limit = 1;
+        break;
+      case 'S':
+        limit = RunLength(content, i, 'S', 3) == 3 ? 3 : 0;
+        break;
+      default:
+        break;
+    }
+
+    size_t length = RunLength(content, i, c, limit);
+
+    if (length == 0) {
+      result.push_back(c);
+      i += 1;
+      continue;
+    }
+
+    std::string token(length, c);
+    int hour12 = hour % 12 == 0 ? 12 : hour % 12;
+
+    if (token == "YY") {
+      std::string text = std::to_string(year);
+
+      result += text.substr(text.size() > 2 ? text.size() - 2 : 0);
+    } else if (token == "YYYY") {
+      result += Pad(year, 4);
+    } else if (c == 'M') {
+      result += length == 1   ? std::to_string(month)
+                : length == 2 ? Pad(month, 2)
+                : length == 3 ? ShortName(locale.monthsShort, locale.months, month - 1, 3)
+                              : Name(locale.months, month - 1);
+    } else if (c == 'D') {
+      result += length == 1 ? std::to_string(day) : Pad(day, 2);
+    } else if (c == 'd') {
+      result += length == 1   ? std::to_string(weekday)
+                : length == 2 ? ShortName(locale.weekdaysMin, locale.weekdays, weekday, 2)
+                : length == 3 ? ShortName(locale.weekdaysShort, locale.weekdays, weekday, 3)
+                              : Name(locale.weekdays, weekday);
+    } else if (c == 'H') {
+      result += length == 1 ? std::to_string(hour) : Pad(hour, 2);
+    } else if (c == 'h') {
+      result += length == 1 ? std::to_string(hour12) : Pad(hour12, 2);
+    } else if (c == 'a') {
+      result += hour < 12 ? "am" : "pm";
+    } else if (c == 'A') {
+      result += hour < 12 ? "AM" : "PM";
+    } else if (c == 'm') {
+      result += length == 1 ? std::to_string(minute) : Pad(minute, 2);
+    } else if (c == 's') {
+      result += length == 1 ? std::to_string(second) : Pad(second, 2);
+    } else if (c == 'S') {
+      result += Pad(millisecond, 3);
+    } else if (token == "Z") {
+      result += zone;
+    } else {
+      // ZZ, and like dayjs also the year tokens it has no case for (Y, YYY).
+      result += zone.substr(0, 3) + zone.substr(4);
+    }
+    i += length;
+  }
+
+  return result;
+}
+
+int LocalUtcOffset(int64_t epochMs) {
+  std::time_t seconds = static_cast<std::time_t>(FloorDiv(epochMs, 1000));
+  // std::localtime shares a static buffer; callers stay on the main thread.
+  const std::tm* local = std::localtime(&seconds);
+
+  if (!local) return 0;
+
+  int64_t localSeconds = DaysFromCivil(local->tm_year + 1900, local->tm_mon + 1, local->tm_mday) * 86400 +
+                         local->tm_hour * 3600 + local->tm_min * 60 + local->tm_sec;
+
+  return static_cast<int>(FloorDiv(localSeconds - static_cast<int64_t>(seconds), 60));
+}
+
+}  // namespace beam
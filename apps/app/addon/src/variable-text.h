@@ -0,0 +1,44 @@
+// Values of variable text (serial numbers, dates and CSV fields) for one piece of a production run, formatted with
+// the rules of the editor's helpers/variableText.tsx and dayjs.
+#ifndef BEAM_ADDON_VARIABLE_TEXT_H_
+#define BEAM_ADDON_VARIABLE_TEXT_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace beam {
+
+// getRealCurrent: `current` wrapped into [start, end]; `start` when the range is empty.
+int64_t WrapSerial(int64_t current, int64_t start, int64_t end);
+
+// NUMBER: the first run of d (decimal), h or H (lower or upper case hexadecimal) in `content` replaced by `value`,
+// keeping the run's length in trailing digits, zero-padded when the run follows a 0. Content without a run is
+// returned unchanged.
+std::string FormatSerial(std::string_view content, int64_t value);
+
+// CSV: every %n replaced by field n of `row`, or nothing when the row is shorter.
+std::string FillCsvFields(std::string_view content, const std::vector<std::string>& row);
+
+// Month and weekday names of a dayjs locale; English by default. Empty short lists are cut from the long names.
+struct TimeLocale {
+  std::vector<std::string> months;
+  std::vector<std::string> monthsShort;
+  std::vector<std::string> weekdays;
+  std::vector<std::string> weekdaysShort;
+  std::vector<std::string> weekdaysMin;
+
+  TimeLocale();
+};
+
+// TIME: dayjs format() of the instant `epochMs` at `utcOffsetMinutes` from UTC. Supports the core tokens (YY, YYYY,
+// M to MMMM, D, DD, d to dddd, H, HH, h, hh, a, A, m, mm, s, ss, SSS, Z, ZZ) and [escaped] text.
+std::string FormatTime(std::string_view content, int64_t epochMs, int utcOffsetMinutes, const TimeLocale& locale);
+
+// Offset of the machine's local time zone from UTC at `epochMs`, in minutes.
+int LocalUtcOffset(int64_t epochMs);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_VARIABLE_TEXT_H_
@@ -0,0 +1,69 @@
+// 2D vector helpers, mirroring packages/core/src/web/helpers/vector-2d.ts.
+#ifndef BEAM_ADDON_VEC2_H_
+#define BEAM_ADDON_VEC2_H_
+
+#include <cmath>
+#include <initializer_list>
+
+namespace beam {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct Vec2 {
+  double x;
+  double y;
+};
+
+inline Vec2 operator+(Vec2 a, Vec2 b) { return {a.x + b.x, a.y + b.y}; }
+inline Vec2 operator-(Vec2 a, Vec2 b) { return {a.x - b.x, a.y - b.y}; }
+inline Vec2 operator-(Vec2 v) { return {-v.x, -v.y}; }
+inline Vec2 operator*(Vec2 v, double scale) { return {v.x * scale, v.y * scale}; }
+
+inline double Dot(Vec2 a, Vec2 b) { return a.x * b.x + a.y * b.y; }
+inline double Cross(Vec2 a, Vec2 b) { return a.x * b.y - a.y * b.x; }
+
+// Same algorithm as V8's Math.hypot (scaled, Kahan-compensated sum) so lengths match the JS helpers bit for bit.
+inline double Hypot(double a, double b) {
+  a = std::fabs(a);
+  b = std::fabs(b);
+
+  double max = a > b ? a : b;
+
+  if (std::isinf(max)) return INFINITY;
+  if (std::isnan(a) || std::isnan(b)) return NAN;
+  if (max == 0) return 0;
+
+  double sum = 0;
+  double compensation = 0;
+
+  for (double value : {a / max, b / max}) {
+    double summand = value * value - compensation;
+    double preliminary = sum + summand;
+
+    compensation = (preliminary - sum) - summand;
+    sum = preliminary;
+  }
+
+  return std::sqrt(sum) * max;
+}
+
+inline double Length(Vec2 v) { return Hypot(v.x, v.y); }
+inline double Distance(Vec2 a, Vec2 b) { return Length(a - b); }
+
+inline Vec2 Normalize(Vec2 v) {
+  double len = Length(v);
+
+  return len >= 1e-5 ? Vec2{v.x / len, v.y / len} : Vec2{0, 0};
+}
+
+// Angle between two vectors in radians, NaN when either is zero (v2Angle returns null there).
+inline double Angle(Vec2 a, Vec2 b) {
+  double la = Length(a);
+  double lb = Length(b);
+
+  return la * lb == 0 ? NAN : std::acos(Dot(a, b) / (la * lb));
+}
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_VEC2_H_
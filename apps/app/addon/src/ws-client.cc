@@ -0,0 +1,307 @@
+#include "ws-client.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "sha1.h"
+
+namespace beam {
+
+namespace {
+
+enum WebSocketOpcode : uint8_t {
+  kOpContinuation = 0x0,
+  kOpText = 0x1,
+  kOpBinary = 0x2,
+  kOpClose = 0x8,
+  kOpPing = 0x9,
+  kOpPong = 0xA,
+};
+
+// Server messages are status replies; anything larger is a protocol error rather than something to buffer.
+constexpr uint64_t kMaxMessageSize = 16 << 20;
+constexpr size_t kMaxHandshakeSize = 16 << 10;
+constexpr size_t kReceiveSize = 64 << 10;
+
+std::string Base64(const uint8_t* data, size_t size) {
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+
+  for (size_t i = 0; i < size; i += 3) {
+    uint32_t group = static_cast<uint32_t>(data[i]) << 16;
+
+    if (i + 1 < size) group |= static_cast<uint32_t>(data[i + 1]) << 8;
+    if (i + 2 < size) group |= data[i + 2];
+    out.push_back(kAlphabet[(group >> 18) & 63]);
+    out.push_back(kAlphabet[(group >> 12) & 63]);
+    out.push_back(i + 1 < size ? kAlphabet[(group >> 6) & 63] : '=');
+    out.push_back(i + 2 < size ? kAlphabet[group & 63] : '=');
+  }
+
+  return out;
+}
+
+// Value of a response header, trimmed, or empty when the header is missing. Names are matched case-insensitively.
+std::string HeaderValue(const std::string& headers, const std::string& name) {
+  size_t start = 0;
+
+  while ((start = headers.find("\r\n", start)) != std::string::npos) {
+    start += 2;
+
+    size_t end = std::min(headers.find("\r\n", start), headers.size());
+    size_t colon = headers.find(':', start);
+    auto sameLetter = [](char a, char b) {
+      return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+    };
+
+    if (colon < end && colon - start == name.size() &&
+        std::equal(name.begin(), name.end(), headers.begin() + start, sameLetter)) {
+      size_t first = headers.find_first_not_of(" \t", colon + 1);
+      size_t last = headers.find_last_not_of(" \t", end - 1);
+
+      return first < end && last >= first ? headers.substr(first, last - first + 1) : std::string();
+    }
+  }
+
+  return std::string();
+}
+
+}  // namespace
+
+bool ParseWebSocketUrl(const std::string& url, std::string* host, uint16_t* port, std::string* path) {
+  const std::string scheme = "ws://";
+
+  if (url.compare(0, scheme.size(), scheme) != 0) return false;
+
+  size_t slash = url.find('/', scheme.size());
+  size_t end = slash == std::string::npos ? url.size() : slash;
+  std::string authority = url.substr(scheme.size(), end - scheme.size());
+  size_t colon = authority.rfind(':');
+
+  *path = slash == std::string::npos ? "/" : url.substr(slash);
+  *port = 80;
+  // Bracketed IPv6 literals keep their colons.
+  if (colon != std::string::npos && authority.find(']', colon) == std::string::npos) {
+    std::string digits = authority.substr(colon + 1);
+
+    if (digits.empty() || digits.size() > 5 || digits.find_first_not_of("0123456789") != std::string::npos) {
+      return false;
+    }
+
+    unsigned long value = std::stoul(digits);
+
+    if (value == 0 || value > 65535) return false;
+    *port = static_cast<uint16_t>(value);
+    authority.resize(colon);
+  }
+  if (authority.size() >= 2 && authority.front() == '[' && authority.back() == ']') {
+    authority = authority.substr(1, authority.size() - 2);
+  }
+  *host = authority;
+
+  return !host->empty();
+}
+
+WebSocketClient::WebSocketClient() : random_(std::random_device()()) {}
+
+bool WebSocketClient::Connect(const std::string& url, int timeoutMs, const std::atomic<bool>& stop,
+                              std::string* error) {
+  std::string host;
+  uint16_t port;
+  std::string path;
+
+  if (!ParseWebSocketUrl(url, &host, &port, &path)) {
+    *error = "invalid websocket url '" + url + "'";
+
+    return false;
+  }
+  if (!socket_.Connect(host, port, timeoutMs, stop, error)) return false;
+
+  uint8_t key[16];
+
+  for (uint8_t& byte : key) byte = static_cast<uint8_t>(random_());
+
+  std::string keyText = Base64(key, 16);
+  bool ipv6 = host.find(':') != std::string::npos;
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + (ipv6 ? "[" + host + "]" : host) + ":" +
+                        std::to_string(port) +
+                        "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " + keyText +
+                        "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+  if (!socket_.Send(request.data(), request.size(), timeoutMs, stop, error)) return false;
+
+  const char kEnd[] = "\r\n\r\n";
+  auto end = received_.end();
+
+  while ((end = std::search(received_.begin(), received_.end(), kEnd, kEnd + 4)) == received_.end()) {
+    uint8_t buffer[4096];
+    int received = socket_.Receive(buffer, sizeof(buffer), timeoutMs, stop, error);
+
+    if (received == 0) *error = "websocket handshake timed out";
+    if (received <= 0) return false;
+    received_.insert(received_.end(), buffer, buffer + received);
+    if (received_.size() > kMaxHandshakeSize) {
+      *error = "invalid websocket handshake";
+
+      return false;
+    }
+  }
+
+  std::string status(received_.begin(), std::find(received_.begin(), end, '\r'));
+
+  if (status.compare(0, 9, "HTTP/1.1 ") != 0 || status.compare(9, 3, "101") != 0) {
+    *error = "websocket upgrade refused: " + status;
+
+    return false;
+  }
+
+  // RFC 6455 section 4.2.2: the server proves it read this request by hashing the key with a fixed GUID.
+  std::string accepted = keyText + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  uint8_t digest[20];
+
+  Sha1(accepted.data(), accepted.size(), digest);
+  if (HeaderValue(std::string(received_.begin(), end), "Sec-WebSocket-Accept") != Base64(digest, 20)) {
+    *error = "websocket handshake has no valid Sec-WebSocket-Accept";
+
+    return false;
+  }
+  received_.erase(received_.begin(), end + 4);
+
+  return true;
+}
+
+bool WebSocketClient::SendText(const std::string& text, int timeoutMs, const std::atomic<bool>& stop,
+                               std::string* error) {
+  return SendFrame(kOpText, reinterpret_cast<const uint8_t*>(text.data()), text.size(), timeoutMs, stop, error);
+}
+
+bool WebSocketClient::SendBinary(const uint8_t* data, size_t size, int timeoutMs, const std::atomic<bool>& stop,
+                                 std::string* error) {
+  return SendFrame(kOpBinary, data, size, timeoutMs, stop, error);
+}
+
+bool WebSocketClient::SendFrame(uint8_t opcode, const uint8_t* data, size_t size, int timeoutMs,
+                                const std::atomic<bool>& stop, std::string* error) {
+  uint8_t mask[4];
+  uint32_t key = random_();
+
+  memcpy(mask, &key, 4);
+  frame_.clear();
+  frame_.push_back(0x80 | opcode);
+  if (size < 126) {
+    frame_.push_back(0x80 | static_cast<uint8_t>(size));
+  } else if (size <= 0xFFFF) {
+    frame_.push_back(0x80 | 126);
+    frame_.push_back(static_cast<uint8_t>(size >> 8));
+    frame_.push_back(static_cast<uint8_t>(size));
+  } else {
+    frame_.push_back(0x80 | 127);
+    for (int k = 7; k >= 0; k -= 1) frame_.push_back(static_cast<uint8_t>(static_cast<uint64_t>(size) >> (8 * k)));
+  }
+  frame_.insert(frame_.end(), mask, mask + 4);
+
+  // Clients must mask every frame, so the payload is copied once into the frame buffer.
+  size_t header = frame_.size();
+
+  frame_.resize(header + size);
+  for (size_t i = 0; i < size; i += 1) frame_[header + i] = data[i] ^ mask[i & 3];
+
+  return socket_.Send(frame_.data(), frame_.size(), timeoutMs, stop, error);
+}
+
+bool WebSocketClient::TakeFrame(uint8_t* opcode, bool* fin, std::vector<uint8_t>* payload, std::string* error) {
+  if (received_.size() < 2) return false;
+
+  size_t header = 2;
+  uint64_t length = received_[1] & 127;
+  bool masked = received_[1] & 128;
+
+  if (length == 126) {
+    if (received_.size() < 4) return false;
+    length = static_cast<uint64_t>(received_[2]) << 8 | received_[3];
+    header = 4;
+  } else if (length == 127) {
+    if (received_.size() < 10) return false;
+    length = 0;
+    for (int k = 0; k < 8; k += 1) length = length << 8 | received_[2 + k];
+    header = 10;
+  }
+  if (length > kMaxMessageSize) {
+    *error = "websocket message is too large";
+
+    return false;
+  }
+  if (masked) header += 4;
+  if (received_.size() < header + length) return false;
+  *fin = received_[0] & 0x80;
+  *opcode = received_[0] & 0x0F;
+  payload->assign(received_.begin() + header, received_.begin() + header + static_cast<size_t>(length));
+  if (masked) {
+    for (size_t i = 0; i < payload->size(); i += 1) (*payload)[i] ^= received_[header - 4 + (i & 3)];
+  }
+  received_.erase(received_.begin(), received_.begin() + header + static_cast<size_t>(length));
+
+  return true;
+}
+
+int WebSocketClient::ReceiveText(std::string* message, int timeoutMs, const std::atomic<bool>& stop,
+                                 std::string* error) {
+  std::vector<uint8_t> payload;
+
+  while (true) {
+    uint8_t opcode;
+    bool fin;
+
+    error->clear();
+    while (TakeFrame(&opcode, &fin, &payload, error)) {
+      if (opcode == kOpPing) {
+        if (!SendFrame(kOpPong, payload.data(), payload.size(), timeoutMs, stop, error)) return -1;
+        continue;
+      }
+      if (opcode == kOpPong) continue;
+      if (opcode == kOpClose) {
+        *error = "connection closed by server";
+        socket_.Close();
+
+        return -1;
+      }
+      if (opcode != kOpContinuation) {
+        messageOpcode_ = opcode;
+        message_.clear();
+      }
+      message_.insert(message_.end(), payload.begin(), payload.end());
+      if (message_.size() > kMaxMessageSize) {
+        *error = "websocket message is too large";
+
+        return -1;
+      }
+      if (fin && messageOpcode_ == kOpText) {
+        message->assign(message_.begin(), message_.end());
+        message_.clear();
+
+        return 1;
+      }
+    }
+    if (!error->empty()) return -1;
+
+    size_t size = received_.size();
+
+    received_.resize(size + kReceiveSize);
+
+    int received = socket_.Receive(received_.data() + size, kReceiveSize, timeoutMs, stop, error);
+
+    received_.resize(size + std::max(received, 0));
+    if (received <= 0) return received;
+  }
+}
+
+void WebSocketClient::Close() {
+  std::atomic<bool> stop(false);
+  std::string error;
+
+  if (socket_.IsOpen()) SendFrame(kOpClose, nullptr, 0, kSocketPollSlice, stop, &error);
+  socket_.Close();
+}
+
+}  // namespace beam
@@ -0,0 +1,57 @@
+// Client end of a WebSocket (RFC 6455) connection over TcpSocket: the HTTP upgrade, masked outgoing frames and
+// reassembled text messages from the server. Only what talking to the Beam Studio backend and devices needs: no
+// extensions, no TLS.
+#ifndef BEAM_ADDON_WS_CLIENT_H_
+#define BEAM_ADDON_WS_CLIENT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "socket.h"
+
+namespace beam {
+
+// ws://host[:port][/path]
+bool ParseWebSocketUrl(const std::string& url, std::string* host, uint16_t* port, std::string* path);
+
+class WebSocketClient {
+ public:
+  WebSocketClient();
+
+  WebSocketClient(const WebSocketClient&) = delete;
+  WebSocketClient& operator=(const WebSocketClient&) = delete;
+
+  bool Connect(const std::string& url, int timeoutMs, const std::atomic<bool>& stop, std::string* error);
+  // Each call sends one unfragmented message.
+  bool SendText(const std::string& text, int timeoutMs, const std::atomic<bool>& stop, std::string* error);
+  bool SendBinary(const uint8_t* data, size_t size, int timeoutMs, const std::atomic<bool>& stop, std::string* error);
+  // Waits up to `timeoutMs` (0 polls) for the next text message. Returns 1 with `message` set, 0 on timeout, or -1
+  // with `error` set once the connection fails or the server closes it. Pings are answered and binary messages
+  // skipped on the way.
+  int ReceiveText(std::string* message, int timeoutMs, const std::atomic<bool>& stop, std::string* error);
+  // Sends a close frame when possible and drops the connection.
+  void Close();
+
+  TcpSocket& Socket() { return socket_; }
+
+ private:
+  bool SendFrame(uint8_t opcode, const uint8_t* data, size_t size, int timeoutMs, const std::atomic<bool>& stop,
+                 std::string* error);
+  // Takes one complete frame off the front of received_; false when it is still incomplete.
+  bool TakeFrame(uint8_t* opcode, bool* fin, std::vector<uint8_t>* payload, std::string* error);
+
+  TcpSocket socket_;
+  std::mt19937 random_;
+  std::vector<uint8_t> frame_;
+  std::vector<uint8_t> received_;
+  std::vector<uint8_t> message_;
+  uint8_t messageOpcode_ = 0;
+};
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_WS_CLIENT_H_
@@ -0,0 +1,166 @@
+#include "ws-upload.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <limits>
+
+#include "crc32.h"
+#include "sha256.h"
+#include "ws-client.h"
+
+namespace beam {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A frame that drains faster than this doubles the next one; slower than kSlowFrame halves it.
+constexpr double kFastFrame = 0.01;
+constexpr double kSlowFrame = 0.1;
+
+double Seconds(Clock::time_point since) { return std::chrono::duration<double>(Clock::now() - since).count(); }
+
+// Reads replies until one is not a progress report; "continue" and "uploading" only mean the exchange goes on.
+int ReceiveReply(WebSocketClient& client, int timeoutMs, const std::atomic<bool>& stop, std::string* reply,
+                 std::string* error) {
+  while (true) {
+    int received = client.ReceiveText(reply, timeoutMs, stop, error);
+
+    if (received <= 0 || ResponseStatus(*reply) != "uploading") return received;
+  }
+}
+
+// Position of the value of a top-level `"key":` in a JSON reply, or npos.
+size_t ValueStart(const std::string& response, const std::string& key) {
+  std::string quoted = "\"" + key + "\"";
+  size_t found = response.find(quoted);
+
+  if (found == std::string::npos) return std::string::npos;
+
+  size_t colon = response.find_first_not_of(" \t\r\n", found + quoted.size());
+
+  if (colon == std::string::npos || response[colon] != ':') return std::string::npos;
+
+  return response.find_first_not_of(" \t\r\n", colon + 1);
+}
+
+// The non-negative integer `key` of a JSON reply; false when it is missing or does not fit.
+bool ResponseCount(const std::string& response, const std::string& key, uint64_t* value) {
+  size_t start = ValueStart(response, key);
+
+  if (start == std::string::npos || !isdigit(static_cast<unsigned char>(response[start]))) return false;
+  *value = 0;
+  for (size_t i = start; i < response.size() && isdigit(static_cast<unsigned char>(response[i])); i += 1) {
+    if (*value > (std::numeric_limits<uint64_t>::max() - 9) / 10) return false;
+    *value = *value * 10 + (response[i] - '0');
+  }
+
+  return true;
+}
+
+}  // namespace
+
+std::string ResponseStatus(const std::string& response) {
+  size_t open = ValueStart(response, "status");
+
+  if (open == std::string::npos || response[open] != '"') return std::string();
+
+  size_t close = response.find('"', open + 1);
+
+  return close == std::string::npos ? std::string() : response.substr(open + 1, close - open - 1);
+}
+
+void RunUpload(const UploadOptions& options, const ByteSpan& data, const std::atomic<bool>& stop,
+               const std::function<void(const UploadProgress&)>& progress, UploadResult* result) {
+  WebSocketClient client;
+  std::string& error = result->error;
+  std::string reply;
+
+  if (!client.Connect(options.url, options.timeoutMs, stop, &error)) return;
+  client.Socket().SetSendBuffer(options.window);
+  if (!client.SendText(options.command, options.timeoutMs, stop, &error)) return;
+
+  int received = ReceiveReply(client, options.timeoutMs, stop, &reply, &error);
+
+  if (received == 0) error = "no reply to '" + options.command + "'";
+  if (received <= 0) return;
+  result->response = reply;
+  if (ResponseStatus(reply) != "continue") {
+    error = "upload refused: " + reply;
+
+    return;
+  }
+
+  Clock::time_point start = Clock::now();
+  Sha256 sha;
+  UploadProgress state;
+  uint32_t crc = 0;
+
+  // Takes in a reply that came during the transfer; false when it ends the upload.
+  auto accept = [&](const std::string& text) {
+    std::string status = ResponseStatus(text);
+    uint64_t counted;
+
+    result->response = text;
+    if (status == "uploading" && ResponseCount(text, "sent", &counted)) {
+      state.acknowledged = std::max(state.acknowledged, std::min(counted, state.sent));
+    }
+    if (status == "uploading" || status == "continue") return true;
+    result->bytes = state.sent;
+    result->seconds = Seconds(start);
+
+    return false;
+  };
+
+  state.total = data.size;
+  state.frameSize = std::max<size_t>(options.minFrame, 1);
+  while (state.sent < data.size) {
+    size_t size = static_cast<size_t>(std::min<uint64_t>(state.frameSize, data.size - state.sent));
+
+    // A frame larger than the whole cap still goes out once everything before it is counted.
+    while (options.inFlight > 0 && state.sent > state.acknowledged &&
+           state.sent + size - state.acknowledged > options.inFlight) {
+      received = client.ReceiveText(&reply, options.timeoutMs, stop, &error);
+      if (received == 0) {
+        error = "no progress reply for " + std::to_string(state.sent - state.acknowledged) + " unacknowledged bytes";
+      }
+      if (received <= 0 || !accept(reply)) return;
+    }
+
+    const uint8_t* frame = data.data + state.sent;
+    Clock::time_point frameStart = Clock::now();
+
+    crc = Crc32(frame, size, crc);
+    sha.Update(frame, size);
+    if (!client.SendBinary(frame, size, options.timeoutMs, stop, &error)) return;
+    state.sent += size;
+
+    double elapsed = Seconds(frameStart);
+
+    if (elapsed < kFastFrame) {
+      state.frameSize = std::min(state.frameSize * 2, std::max(options.maxFrame, options.minFrame));
+    } else if (elapsed > kSlowFrame) {
+      state.frameSize = std::max(state.frameSize / 2, std::max<size_t>(options.minFrame, 1));
+    }
+    // Replies already waiting are read without blocking the next frame: progress counts, or the server giving up.
+    while ((received = client.ReceiveText(&reply, 0, stop, &error)) > 0) {
+      if (!accept(reply)) return;
+    }
+    if (received < 0) return;
+    state.bytesPerSecond = state.sent / std::max(Seconds(start), 1e-9);
+    progress(state);
+  }
+  result->bytes = state.sent;
+  result->crc32 = crc;
+  result->sha256 = sha.HexDigest();
+  received = ReceiveReply(client, options.timeoutMs, stop, &reply, &error);
+  result->seconds = Seconds(start);
+  if (received == 0) error = "no reply after upload";
+  if (received <= 0) return;
+  result->response = reply;
+  result->ok = ResponseStatus(reply) == "ok";
+  client.Close();
+}
+
+}  // namespace beam
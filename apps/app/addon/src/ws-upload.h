@@ -0,0 +1,63 @@
+// Pushes a file or buffer through a backend websocket command that answers "continue" and then reads the data as
+// binary messages, like `file upload` on /ws/control and `upload` on /ws/utils. Frames grow from minFrame to
+// maxFrame while the link keeps up and shrink when a frame stalls. `file upload` reports the bytes the device has
+// taken in "uploading" replies, and with inFlight set at most that many bytes are sent beyond the last count; `upload`
+// on /ws/utils sends no such replies, so the cap is off unless asked for.
+// CRC-32 and SHA-256 of the data are computed as it is sent.
+#ifndef BEAM_ADDON_WS_UPLOAD_H_
+#define BEAM_ADDON_WS_UPLOAD_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "file-io.h"
+
+namespace beam {
+
+struct UploadOptions {
+  std::string url;
+  std::string command;
+  int timeoutMs = 30000;
+  size_t minFrame = 64 << 10;
+  size_t maxFrame = 1 << 20;
+  int window = 4 << 20;
+  // Cap on sent bytes the device has not yet counted in a progress reply, for commands that send them. 0 leaves only
+  // the socket send buffer (window) between the app and the device.
+  uint64_t inFlight = 0;
+};
+
+struct UploadProgress {
+  uint64_t sent = 0;
+  // The largest "sent" count of the device's progress replies.
+  uint64_t acknowledged = 0;
+  uint64_t total = 0;
+  double bytesPerSecond = 0;
+  size_t frameSize = 0;
+};
+
+struct UploadResult {
+  // The final reply had status "ok".
+  bool ok = false;
+  // Transport failure or a reply other than "continue" to the command; empty otherwise.
+  std::string error;
+  // The last text message from the server, usually JSON.
+  std::string response;
+  uint64_t bytes = 0;
+  double seconds = 0;
+  uint32_t crc32 = 0;
+  std::string sha256;
+};
+
+// Runs the whole exchange on the calling thread. `progress` is called after every frame.
+void RunUpload(const UploadOptions& options, const ByteSpan& data, const std::atomic<bool>& stop,
+               const std::function<void(const UploadProgress&)>& progress, UploadResult* result);
+
+// The "status" string of a JSON reply, or an empty string.
+std::string ResponseStatus(const std::string& response);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_WS_UPLOAD_H_
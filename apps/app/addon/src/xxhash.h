@@ -0,0 +1,14 @@
+// XXH64 content hash (https://github.com/Cyan4973/xxHash), used to key deduplicated binary blobs.
+#ifndef BEAM_ADDON_XXHASH_H_
+#define BEAM_ADDON_XXHASH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace beam {
+
+uint64_t Xxh64(const void* data, size_t size, uint64_t seed = 0);
+
+}  // namespace beam
+
+#endif  // BEAM_ADDON_XXHASH_H_
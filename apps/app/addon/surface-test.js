@@ -0,0 +1,93 @@
+const assert = require('assert');
+const surface = require('./build/Release/cSurfaceHelper');
+
+const grid = (columns, rows, step, z) => {
+  const points = [];
+  for (let i = 0; i < columns; i += 1) {
+    for (let j = 0; j < rows; j += 1) points.push(i * step, j * step, z(i * step, j * step));
+  }
+  return new Float64Array(points);
+};
+
+// triangulate: Delaunay condition and Delaunator's clockwise winding on random points
+{
+  let seed = 1;
+  const random = () => {
+    seed = (seed * 16807) % 2147483647;
+    return seed / 2147483647;
+  };
+  const coords = Array.from({ length: 200 }, () => random() * 100);
+  const { triangles, halfedges, hull } = surface.triangulate(new Float64Array(coords));
+  assert.strictEqual(triangles.length / 3, 2 * 100 - hull.length - 2);
+  for (let t = 0; t < triangles.length; t += 3) {
+    const [ax, ay, bx, by, cx, cy] = [0, 1, 2].flatMap((k) => [coords[2 * triangles[t + k]], coords[2 * triangles[t + k] + 1]]);
+    assert.ok((bx - ax) * (cy - ay) - (by - ay) * (cx - ax) < 0);
+    for (let p = 0; p < 100; p += 1) {
+      const [dx, dy, ex, ey, fx, fy] = [ax, ay, bx, by, cx, cy].map((v, i) => v - coords[2 * p + (i % 2)]);
+      const det =
+        dx * (ey * (fx * fx + fy * fy) - (ex * ex + ey * ey) * fy) -
+        dy * (ex * (fx * fx + fy * fy) - (ex * ex + ey * ey) * fx) +
+        (dx * dx + dy * dy) * (ex * fy - ey * fx);
+      assert.ok(det >= -1e-6);
+    }
+  }
+  halfedges.forEach((opposite, e) => assert.ok(opposite === -1 || halfedges[opposite] === e));
+  assert.strictEqual(surface.triangulate(new Float64Array([0, 0, 1, 1, 2, 2])).triangles.length, 0);
+}
+
+// buildSurface: slope angles, edge-length refinement and Loop subdivision counts
+{
+  const slope = grid(5, 5, 10, (x) => x);
+  const { geometry, subdivided } = surface.buildSurface(slope, undefined, { subdivisionIterations: 2 });
+  assert.strictEqual(geometry.index.length, 32 * 3);
+  assert.strictEqual(geometry.position.length, 32 * 9);
+  assert.strictEqual(subdivided.index.length / 3, 32 * 16);
+  assert.ok(Math.abs(geometry.maxAngle - 45) < 1e-9);
+  assert.ok(Math.abs(subdivided.maxAngle - 45) < 1e-9);
+  assert.deepStrictEqual(Array.from(geometry.color.subarray(0, 3)), [1, 2 / 3, 2 / 3].map(Math.fround));
+
+  const flat = surface.buildSurface(grid(5, 5, 10, () => 0), undefined, { interpolateLength: 4 });
+  assert.strictEqual(flat.geometry.maxAngle, 0);
+  assert.deepStrictEqual(Array.from(flat.geometry.color.subarray(0, 3)), [1, 1, 1]);
+  const { vertices, triangles } = flat.geometry;
+  for (let t = 0; t < triangles.length; t += 3) {
+    for (let k = 0; k < 3; k += 1) {
+      const a = triangles[t + k];
+      const b = triangles[t + ((k + 1) % 3)];
+      assert.ok(Math.hypot(vertices[3 * a] - vertices[3 * b], vertices[3 * a + 1] - vertices[3 * b + 1]) <= 4);
+    }
+  }
+  // preserveEdges keeps the outline of the measured area in place.
+  const xs = Array.from(flat.subdivided.vertices).filter((_, i) => i % 3 === 0);
+  assert.strictEqual(Math.min(...xs), 0);
+  assert.strictEqual(Math.max(...xs), 40);
+}
+
+// buildSurface: a cached triangulation gives the same mesh
+{
+  const points = grid(6, 4, 5, (x, y) => Math.sin(x / 7) * Math.cos(y / 5));
+  const { triangles } = surface.triangulate(points, 3);
+  const fresh = surface.buildSurface(points, undefined, { interpolateLength: 3 });
+  const cached = surface.buildSurface(points, triangles, { interpolateLength: 3 });
+  assert.deepStrictEqual(cached.subdivided.position, fresh.subdivided.position);
+  assert.throws(() => surface.buildSurface(points, new Uint32Array([0, 1, 100])), TypeError);
+}
+
+// createHeightField: barycentric z inside the mesh, `outside` elsewhere
+{
+  const points = grid(4, 3, 10, (x, y) => 2 * x - y + 1);
+  const { triangles } = surface.triangulate(points, 3);
+  const field = surface.createHeightField(points, triangles);
+  const query = new Float64Array([0, 0, 12.5, 7.5, 30, 20, 29.9, 0.1, -1, 5, 15, 21]);
+  const z = field.sampleZ(query);
+  [1, 18.5, 41, 60.7].forEach((expected, i) => assert.ok(Math.abs(z[i] - expected) < 1e-9));
+  assert.ok(Number.isNaN(z[4]) && Number.isNaN(z[5]));
+  assert.strictEqual(field.sampleZ(new Float64Array([-1, 5]), { outside: 0 })[0], 0);
+  assert.throws(() => surface.createHeightField(points, new Uint32Array([0, 1, 12])), TypeError);
+  // Other wrapped objects are refused rather than read as a field.
+  const other = require('./build/Release/cCanvasHelper').createSpatialIndex();
+  assert.throws(() => field.sampleZ.call(other, query), /must be called on a height field/);
+  assert.throws(() => field.sampleZ.call({}, query), TypeError);
+}
+
+console.log('surface tests passed');
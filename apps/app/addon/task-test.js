@@ -0,0 +1,164 @@
+const assert = require('assert');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const zlib = require('zlib');
+const taskHelper = require('./build/Release/cTaskHelper');
+
+(async () => {
+  // G-code converts to task code that the reader takes back, with the motion and laser states parseGcode sees.
+  const gcode = [
+    'G28',
+    'G90',
+    'G1 F6000',
+    'G1 X10 Y5 ; first move',
+    'G1 S50',
+    'G1V0 X10 Y10',
+    'G1S0 X20',
+    'G91',
+    'G1V0 X-10 S30',
+    'G90',
+    'G4 P500',
+    'M3',
+    'F16 2',
+    'g1 z5',
+  ].join('\r\n');
+  const result = await taskHelper.gcodeToFcode(Buffer.from(gcode), { metadata: { MAX_X: 'x', AUTHOR: 'test' } });
+  assert.deepStrictEqual(
+    Array.from(await taskHelper.decodeFcode(result.fcode)),
+    [
+      [0, 0, 0, 0, 0, 6000, 0, 0, 0],
+      [0, 0, 0, 0, 0, 6000, 0, 0, 0],
+      [0, 10, -5, 0, 0, 6000, 0, 0, 0],
+      [1, 10, -10, 0, 0, 6000, 0, 50, 0],
+      [0, 20, -10, 0, 0, 6000, 0, 0, 0],
+      [1, 10, -10, 0, 0, 6000, 0, 30, 0],
+      [1, 10, -10, 5, 0, 6000, 0, 30, 0],
+    ].flat(),
+  );
+  const travel = Math.hypot(10, 5) + 30;
+  assert.strictEqual(result.bytes, result.fcode.length);
+  assert.ok(Math.abs(result.time - (travel / 100 + 0.5)) < 1e-9);
+  assert.ok(Math.abs(result.travelDistance - travel) < 1e-9);
+  assert.strictEqual(result.maxZ, 5);
+  assert.strictEqual(result.skippedLines, 2);
+  const written = taskHelper.readFcodeInfo(result.fcode);
+  assert.strictEqual(written.version, 1);
+  assert.deepStrictEqual(written.metadata, {
+    VERSION: '1',
+    HEAD_TYPE: 'LASER',
+    TIME_COST: (travel / 100 + 0.5).toFixed(2),
+    TRAVEL_DIST: travel.toFixed(2),
+    MAX_X: 'x',
+    MAX_Y: '10.00',
+    MAX_Z: '5.00',
+    MAX_R: Math.hypot(20, 10).toFixed(2),
+    AUTHOR: 'test',
+  });
+  assert.deepStrictEqual([written.thumbnail, written.previews], [null, []]);
+
+  // A file larger than one feed piece converts as the same bytes would, straight to disk.
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'task-fcode-test-'));
+  const lines = ['G1 F3000'];
+  for (let i = 0; i < 900000; i += 1) lines.push(`G1 X${(i % 300) + 0.5} Y${i % 7}`);
+  const large = Buffer.from(lines.join('\n'));
+  const thumbnail = new Uint8Array([0x89, 0x50, 0x4e, 0x47]);
+  fs.writeFileSync(path.join(dir, 'task.gcode'), large);
+  const inMemory = await taskHelper.gcodeToFcode(large, { thumbnail });
+  const fromFile = await taskHelper.gcodeToFcode(path.join(dir, 'task.gcode'), {
+    output: path.join(dir, 'task.fc'),
+    thumbnail,
+  });
+  assert.strictEqual(fromFile.fcode, undefined);
+  assert.deepStrictEqual(fs.readFileSync(path.join(dir, 'task.fc')), Buffer.from(inMemory.fcode));
+  assert.strictEqual((await taskHelper.decodeFcode(path.join(dir, 'task.fc'))).length, 900001 * 9);
+  const largeInfo = taskHelper.readFcodeInfo(inMemory.fcode);
+  assert.deepStrictEqual(largeInfo.previews, [thumbnail]);
+  assert.strictEqual(largeInfo.metadata.MAX_Y, '6.00');
+  assert.ok(inMemory.fcode.length < large.length);
+
+  await assert.rejects(taskHelper.gcodeToFcode(path.join(dir, 'missing.gcode')), /cannot open/);
+  assert.throws(() => taskHelper.gcodeToFcode(42), TypeError);
+  assert.throws(() => taskHelper.gcodeToFcode('', { metadata: 1 }), TypeError);
+
+  // Task code from fluxclient: every version and head decodes to the end, inside the bounds in its metadata.
+  const assets = path.join(__dirname, '../../../packages/core/src/web/assets/fcode');
+  const diode = path.join(assets, 'beam-series-diode.fc');
+  const info = taskHelper.readFcodeInfo(diode);
+  assert.strictEqual(info.version, 1);
+  assert.deepStrictEqual(
+    [info.metadata.TIME_COST, info.metadata.MAX_X, info.metadata.SOFTWARE],
+    ['27.31', '145.20', 'fluxclient-2.2.4-FS'],
+  );
+  assert.deepStrictEqual(info.previews, [info.thumbnail]);
+  const motion = await taskHelper.decodeFcode(fs.readFileSync(diode));
+  assert.strictEqual(motion.length, 75 * 9);
+  assert.deepStrictEqual(
+    Array.from(motion.subarray(0, 7 * 9)),
+    [
+      [0, 0, 0, 0, 0, 7500, 0, 0, 0],
+      [0, 0, 0, 0, 0, 7500, 0, 0, 0],
+      [0, 35, -77.5, 0, 0, 7500, 0, 0, 0],
+      [0, 35, -77.5, 0, 0, 900, 0, 0, 0],
+      [0, 35, -77.5, 0, 0, 900, 0, 0, 0],
+      [1, 76, -77.5, 0, 0, 900, 0, 100, 0],
+      [1, 76, -77.5, 0, 0, 7500, 0, 100, 0],
+    ].flat(),
+  );
+  const versions = {};
+  for (const name of fs.readdirSync(assets).filter((file) => file.endsWith('.fc'))) {
+    const { version, metadata, thumbnail } = taskHelper.readFcodeInfo(path.join(assets, name));
+    const parsed = await taskHelper.decodeFcode(path.join(assets, name));
+    const maxX = Number(metadata.max_x ?? metadata.MAX_X ?? Infinity);
+    const maxY = Number(metadata.max_y ?? metadata.MAX_Y);
+    let engraved = 0;
+    for (let i = 0; i < parsed.length; i += 9) {
+      assert.ok(parsed[i + 1] <= maxX + 0.01 && -parsed[i + 2] <= maxY + 0.01, `${name} moves out of bounds`);
+      engraved += parsed[i];
+    }
+    assert.ok(engraved > 0, `${name} has no engraving moves`);
+    assert.deepStrictEqual(Array.from(thumbnail.subarray(1, 4)), [0x50, 0x4e, 0x47]);
+    versions[version] = (versions[version] ?? 0) + 1;
+  }
+  assert.deepStrictEqual(versions, { 1: 3, 2: 3, 3: 7 });
+  const chunked = taskHelper.readFcodeInfo(path.join(assets, 'bb2-calibration.fc'));
+  assert.deepStrictEqual([chunked.version, chunked.metadata.max_x], [3, '361.50']);
+  const printer = await taskHelper.decodeFcode(path.join(assets, 'ador-printer.fc'));
+  assert.strictEqual(printer.filter((value, i) => i % 9 === 0 && value === 1).length, 19);
+
+  // Damaged files and commands the reader does not know are rejected rather than guessed at.
+  const original = fs.readFileSync(diode);
+  const corrupt = Buffer.from(original);
+  corrupt[20] ^= 1;
+  assert.strictEqual(taskHelper.readFcodeInfo(corrupt).metadata.MAX_X, '145.20');
+  await assert.rejects(taskHelper.decodeFcode(corrupt), /checksum mismatch/);
+  corrupt[8 + 4 + 772 + 4 + 10] ^= 1;
+  assert.throws(() => taskHelper.readFcodeInfo(corrupt), /metadata checksum mismatch/);
+  const withScript = (script) => {
+    const header = Buffer.alloc(4);
+    const crc = Buffer.alloc(4);
+    header.writeUInt32LE(script.length);
+    crc.writeUInt32LE(zlib.crc32(script));
+    return Buffer.concat([original.subarray(0, 8), header, script, crc, original.subarray(8 + 4 + 772 + 4)]);
+  };
+  const diodeScript = original.subarray(12, 12 + 772);
+  assert.strictEqual((await taskHelper.decodeFcode(withScript(diodeScript))).length, 75 * 9);
+  await assert.rejects(
+    taskHelper.decodeFcode(withScript(Buffer.concat([diodeScript, Buffer.from([0x7f])]))),
+    /unknown task code command 127/,
+  );
+  await assert.rejects(
+    taskHelper.decodeFcode(withScript(Buffer.concat([diodeScript, Buffer.from([0x10, 0x09])]))),
+    /unknown task code command 16 9/,
+  );
+  await assert.rejects(taskHelper.decodeFcode(withScript(diodeScript.subarray(0, 771))), /truncated task code command/);
+  const chunks = fs.readFileSync(path.join(assets, 'bm2-ir.fc'));
+  assert.throws(() => taskHelper.readFcodeInfo(chunks.subarray(0, 200)), /truncated task code/);
+  chunks.write('FCx0004', 0);
+  assert.throws(() => taskHelper.readFcodeInfo(chunks), /unsupported task code version 4/);
+  assert.throws(() => taskHelper.readFcodeInfo(Buffer.from('FCx0001\n\x10')), /truncated task code/);
+  assert.throws(() => taskHelper.readFcodeInfo(Buffer.from('gcode')), /not a task code file/);
+  fs.rmSync(dir, { recursive: true });
+
+  console.log('task tests passed');
+})();
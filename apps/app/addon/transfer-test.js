@@ -0,0 +1,169 @@
+const assert = require('assert');
+const crypto = require('crypto');
+const fs = require('fs');
+const net = require('net');
+const os = require('os');
+const path = require('path');
+const zlib = require('zlib');
+const transferHelper = require('./build/Release/cTransferHelper');
+
+// Minimal websocket server that answers an upload command the way the backend does.
+const startServer = (onCommand) =>
+  new Promise((resolve) => {
+    const server = net.createServer((socket) => {
+      let buffer = Buffer.alloc(0);
+      let upgraded = false;
+      // quiet withholds the "uploading" progress replies.
+      const session = { frames: 0, quiet: false, received: [], size: 0 };
+      const send = (object) => {
+        const payload = Buffer.from(JSON.stringify(object));
+        socket.write(Buffer.concat([Buffer.from([0x81, payload.length]), payload]));
+      };
+      socket.on('data', (data) => {
+        buffer = Buffer.concat([buffer, data]);
+        if (!upgraded) {
+          const end = buffer.indexOf('\r\n\r\n');
+          if (end < 0) return;
+          const key = /Sec-WebSocket-Key: (.*)\r\n/.exec(buffer.toString())[1];
+          // A path with /bad-accept gets the hash of another key.
+          const hashed = buffer.toString().includes('/bad-accept') ? `x${key}` : key;
+          const accept = crypto
+            .createHash('sha1')
+            .update(`${hashed}258EAFA5-E914-47DA-95CA-C5AB0DC85B11`)
+            .digest('base64');
+          socket.write(
+            'HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n' +
+              `Sec-WebSocket-Accept: ${accept}\r\n\r\n`,
+          );
+          buffer = buffer.subarray(end + 4);
+          upgraded = true;
+        }
+        while (buffer.length >= 2) {
+          let length = buffer[1] & 127;
+          let offset = 2;
+          if (length === 126) {
+            length = buffer.readUInt16BE(2);
+            offset = 4;
+          } else if (length === 127) {
+            length = Number(buffer.readBigUInt64BE(2));
+            offset = 10;
+          }
+          assert.ok(buffer[1] & 128, 'client frames are masked');
+          if (buffer.length < offset + 4 + length) return;
+          const mask = buffer.subarray(offset, offset + 4);
+          const payload = Buffer.from(buffer.subarray(offset + 4, offset + 4 + length));
+          for (let i = 0; i < payload.length; i += 1) payload[i] ^= mask[i % 4];
+          const opcode = buffer[0] & 15;
+          buffer = buffer.subarray(offset + 4 + length);
+          if (opcode === 1) {
+            session.size = Number(payload.toString().split(' ').pop());
+            session.send = send;
+            onCommand(payload.toString(), send, session);
+          } else if (opcode === 2) {
+            session.frames += 1;
+            session.received.push(payload);
+            const received = session.received.reduce((sum, part) => sum + part.length, 0);
+            if (!session.quiet) send({ status: 'uploading', sent: received });
+            if (received === session.size) send({ status: 'ok' });
+          } else if (opcode === 8) {
+            socket.end();
+          }
+        }
+      });
+      socket.on('error', () => {});
+    });
+    server.listen(0, '127.0.0.1', () => resolve(server));
+  });
+
+const upload = (url, command, data, options, onStart) =>
+  new Promise((resolve) => {
+    const progress = [];
+    const id = transferHelper.startUpload(url, command, data, options, {
+      onDone: (result) => resolve({ id, progress, result }),
+      onProgress: (state) => progress.push(state),
+    });
+    if (onStart) onStart(id);
+  });
+
+(async () => {
+  const sessions = [];
+  const server = await startServer((command, send, session) => {
+    sessions.push({ command, session });
+    if (command.startsWith('refuse')) send({ status: 'error', error: ['NOT_ALLOWED'] });
+    else if (!command.startsWith('hang')) send({ status: 'continue' });
+    if (command.startsWith('quiet')) session.quiet = true;
+  });
+  const url = `ws://127.0.0.1:${server.address().port}/ws/control/test`;
+  const data = crypto.randomBytes(3 * 1024 * 1024 + 17);
+
+  const { progress, result } = await upload(url, `file upload application/fcode ${data.length}`, data, {
+    minFrame: 65536,
+  });
+  assert.strictEqual(result.ok, true, result.error);
+  assert.strictEqual(result.bytes, data.length);
+  assert.strictEqual(JSON.parse(result.response).status, 'ok');
+  assert.strictEqual(result.crc32, zlib.crc32(data));
+  assert.strictEqual(result.sha256, crypto.createHash('sha256').update(data).digest('hex'));
+  assert.ok(result.bytesPerSecond > 0);
+  assert.deepStrictEqual(Buffer.concat(sessions[0].session.received), data);
+  assert.ok(sessions[0].session.frames < 50, `${sessions[0].session.frames} frames`);
+  assert.ok(sessions[0].session.received.every((frame) => frame.length <= 1024 * 1024));
+  assert.strictEqual(progress[progress.length - 1].sent, data.length);
+  assert.strictEqual(progress[0].frameSize >= 65536, true);
+
+  // From a file, with a server that refuses or never answers.
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'transfer-test-'));
+  const file = path.join(dir, 'task.fc');
+  fs.writeFileSync(file, data.subarray(0, 1000));
+  const fromFile = await upload(url, 'upload /tmp/task.fc 1000', file);
+  assert.strictEqual(fromFile.result.ok, true);
+  assert.strictEqual(fromFile.result.sha256, crypto.createHash('sha256').update(data.subarray(0, 1000)).digest('hex'));
+  const refused = await upload(url, 'refuse 10', new Uint8Array(10));
+  assert.strictEqual(refused.result.ok, false);
+  assert.match(refused.result.error, /upload refused: .*NOT_ALLOWED/);
+  const cancelled = await upload(url, 'hang 10', new Uint8Array(10), {}, (id) =>
+    setTimeout(() => assert.strictEqual(transferHelper.cancelUpload(id), true), 200),
+  );
+  assert.strictEqual(cancelled.result.error, 'cancelled');
+  assert.strictEqual(transferHelper.cancelUpload(cancelled.id), false);
+  const missing = await upload(url, 'upload x 1', path.join(dir, 'missing.fc'));
+  assert.match(missing.result.error, /cannot open/);
+  const unreachable = await upload('ws://127.0.0.1:1/ws', 'upload x 1', new Uint8Array(1), { timeout: 1000 });
+  assert.match(unreachable.result.error, /cannot connect/);
+  const badAccept = await upload(url.replace('/test', '/bad-accept'), 'upload x 1', new Uint8Array(1));
+  assert.match(badAccept.result.error, /Sec-WebSocket-Accept/);
+
+  // Without progress replies the upload stops at inFlight unacknowledged bytes until the server counts them.
+  const held = crypto.randomBytes(1024 * 1024);
+  const windowed = upload(url, `quiet ${held.length}`, held, { minFrame: 65536, maxFrame: 65536, inFlight: 262144 });
+  await new Promise((resolve) => setTimeout(resolve, 300));
+  const quiet = sessions[sessions.length - 1].session;
+  const heldBack = quiet.received.reduce((sum, part) => sum + part.length, 0);
+  assert.strictEqual(heldBack, 262144);
+  quiet.quiet = false;
+  quiet.send({ status: 'uploading', sent: heldBack });
+  const released = await windowed;
+  assert.strictEqual(released.result.ok, true, released.result.error);
+  assert.deepStrictEqual(Buffer.concat(quiet.received), held);
+  assert.ok(released.progress.every((state) => state.sent - state.acknowledged <= 262144));
+  assert.ok(released.progress[released.progress.length - 1].acknowledged >= heldBack);
+  const unanswered = await upload(url, `quiet ${held.length}`, held, {
+    inFlight: 65536,
+    minFrame: 65536,
+    timeout: 300,
+  });
+  assert.match(unanswered.result.error, /no progress reply for 65536 unacknowledged bytes/);
+  // Endpoints that send no progress replies upload past any window with the default options.
+  const silent = crypto.randomBytes(9 * 1024 * 1024);
+  const uncapped = await upload(url, `quiet ${silent.length}`, silent, { timeout: 1000 });
+  assert.strictEqual(uncapped.result.ok, true, uncapped.result.error);
+  assert.strictEqual(uncapped.result.sha256, crypto.createHash('sha256').update(silent).digest('hex'));
+  assert.ok(uncapped.progress.every((state) => state.acknowledged === 0));
+  assert.throws(() => transferHelper.startUpload('ws://x', 'c', 42), TypeError);
+  assert.throws(() => transferHelper.startUpload('ws://x', 'c', file, { minFrame: 0 }), TypeError);
+  assert.throws(() => transferHelper.startUpload('ws://x', 'c', file, { inFlight: -1 }), TypeError);
+
+  fs.rmSync(dir, { recursive: true });
+  server.close();
+  console.log('transfer tests passed');
+})();